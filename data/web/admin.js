@@ -40,6 +40,8 @@ function connectWS() {
 
   ws.onopen = () => {
     wsConnected = true;
+    // Logs SPI sólo llegan con suscripción; steps no se pintan aquí
+    ws.send(JSON.stringify({ cmd: 'subscribe', add: ['logs'], remove: ['steps'] }));
     setBadge('admWsBadge', '● WS ONLINE', 'badge-ok');
     admLog('WebSocket conectado', 'info');
   };
@@ -298,7 +298,7 @@ function initWebSocket() {
         updateStatus(true);
         syncLedMonoMode();
         
-        setTimeout(() => { sendWebSocket({ cmd: 'init' }); }, 100);
+        setTimeout(() => { sendWebSocket({ cmd: 'init', binProto: WS_BIN_CLIENT_PROTO, sv: wsStateVersion, se: wsStateEpoch, batch: true }); }, 100);
         setTimeout(() => { sendWebSocket({ cmd: 'getPattern' }); }, 300);
         setTimeout(() => { requestSampleCounts(); }, 1000);
     };
@@ -306,6 +306,9 @@ function initWebSocket() {
     ws.onclose = () => {
         console.warn('[WS] Closed, retrying in 3s', wsUrl);
         isConnected = false;
+        wsBinProto = 0;
+        _seqEventsActive = false;
+        _playheadAnchor = null;
         updateStatus(false);
         setTimeout(initWebSocket, 3000);
     };
@@ -318,6 +321,15 @@ function initWebSocket() {
     ws.onmessage = (event) => {
         // Handle binary audio level data (0xAA header)
         if (event.data instanceof ArrayBuffer) {
+            if (event.data.byteLength > 0 && new Uint8Array(event.data)[0] === SEQ_EVENT_MAGIC) {
+                handleSeqEventFrame(event.data);
+                return;
+            }
+            if (event.data.byteLength > 0 && new Uint8Array(event.data)[0] === PATTERN_BIN_MAGIC) {
+                const pat = decodeBinaryPattern(event.data);
+                if (pat) (window.handleWebSocketMessage || handleWebSocketMessage)(pat);
+                return;
+            }
             if (typeof handleWaveformBinaryMessage === 'function') {
                 handleWaveformBinaryMessage(event);
             }
@@ -325,6 +337,20 @@ function initWebSocket() {
         }
         if (typeof event.data !== 'string') return;
         const data = JSON.parse(event.data);
+        if (data.type === 'connected') {
+            wsBinProto = data.binProto | 0;
+        }
+        // Ecos de edición agrupados por el server (ventana ~20 ms)
+        if (data.type === 'batch' && Array.isArray(data.msgs)) {
+            const handler = window.handleWebSocketMessage || handleWebSocketMessage;
+            data.msgs.forEach(msg => handler(msg));
+            return;
+        }
+        // ACKs de comandos con rid + informe de latencia del server
+        if (data.type === 'ack' || data.type === 'ackStats') {
+            handleWsAck(data);
+            return;
+        }
         // Handle bulk ACK for MIDI import
         if (data.type === 'bulkAck' && typeof window._bulkAckCallback === 'function') {
             window._bulkAckCallback(data.p);
@@ -371,6 +397,10 @@ function handleWebSocketMessage(data) {
             }
             break;
         case 'state':
+            if (data.sv !== undefined) {
+                wsStateVersion = data.sv;
+                wsStateEpoch = data.se || 0;
+            }
             updateSequencerState(data);
             updateDeviceStats(data);
             if (Array.isArray(data.samples)) {
@@ -2776,10 +2806,14 @@ function triggerPad(padIndex) {
 
     // Enviar al ESP32 (Protocolo Binario para baja latencia)
     if (ws && ws.readyState === WebSocket.OPEN) {
-        const data = new Uint8Array(3);
+        // [0x90, pad, vel, ridLo, ridHi]: el server confirma la salida SPI
+        const rid = nextWsRid();
+        const data = new Uint8Array(5);
         data[0] = 0x90; // Comando Trigger (0x90)
         data[1] = padIndex;
         data[2] = 127;  // Velocity
+        data[3] = rid & 0xFF;
+        data[4] = rid >> 8;
         ws.send(data);
     } else {
         // Fallback por HTTP si WS no está conectado
@@ -2802,14 +2836,14 @@ function triggerSynthPad(padIndex) {
             ? window.getPadMelodyAssignment(padIndex)
             : null;
         const note = assignment && assignment.note ? assignment.note : (PAD_303_NOTES[padIndex] || 48);
-        ws.send(JSON.stringify({
+        sendWebSocket({
             cmd: 'synthNoteOnEx',
             engine: engine,
             note: note,
             velocity: assignment && assignment.velocity ? assignment.velocity : 127,
             accent: !!(assignment && assignment.accent),
             slide: !!(assignment && assignment.slide)
-        }));
+        });
         // Safety: auto NoteOff tras 2s si no llega pointerup (clicks fantasma)
         if (_synthPadAutoOffTimers[padIndex]) clearTimeout(_synthPadAutoOffTimers[padIndex]);
         _synthPadAutoOffTimers[padIndex] = setTimeout(() => {
@@ -2838,7 +2872,7 @@ function sendSynthNoteOffForPad(padIndex, engine) {
         clearTimeout(_synthPadAutoOffTimers[padIndex]);
         _synthPadAutoOffTimers[padIndex] = null;
     }
-    ws.send(JSON.stringify({ cmd: 'synthNoteOff', track: padIndex, engine }));
+    sendWebSocket({ cmd: 'synthNoteOff', track: padIndex, engine });
 }
 
 function setPadEnginePending(padIndex, pending) {
@@ -3730,7 +3764,7 @@ function _applyStepUpdate(step) {
     if (nextDot) nextDot.classList.add('current');
     const nextColumn = stepColumns[step] || [];
     nextColumn.forEach(el => el.classList.add('current'));
-    updateSequencerPlayhead(step);
+    if (!_playheadAnchor) updateSequencerPlayhead(step);  // con eventos 0xB4 lo mueve _tickPlayhead
 
     // Auto-scroll grid to keep active step visible (for 32/64 step grids)
     if (currentStepCount > 16) {
@@ -3752,11 +3786,9 @@ function _applyStepUpdate(step) {
     lastCurrentStep = step;
 
     // === SYNC LEDS: flash live pads in rhythm with sequencer ===
-    if (syncLedsEnabled && isPlaying) {
-        if (!_cachedPadEls) {
-            _cachedPadEls = new Array(16);
-            for (let i = 0; i < 16; i++) _cachedPadEls[i] = document.querySelector(`.pad[data-pad="${i}"]`);
-        }
+    // Con eventos 0xB4 los flashes vienen de los triggers reales (flashSeqTrigger)
+    if (syncLedsEnabled && isPlaying && !_seqEventsActive) {
+        _ensurePadElCache();
         const flashedPads = [];
         for (let track = 0; track < 16; track++) {
             if (circularSequencerData[track] && circularSequencerData[track][step]) {
@@ -3774,7 +3806,85 @@ function _applyStepUpdate(step) {
     }
 }
 
-function updateSequencerPlayhead(step) {
+function _ensurePadElCache() {
+    if (_cachedPadEls) return;
+    _cachedPadEls = new Array(16);
+    for (let i = 0; i < 16; i++) _cachedPadEls[i] = document.querySelector(`.pad[data-pad="${i}"]`);
+}
+
+// ============= EVENTOS DEL SECUENCIADOR (0xB4) =============
+// Espejo de src/SeqEventRing.h: cabecera [magic, count, flags, tempo×10 u16] +
+// count × [type, a, b, ago u16 (0.1 ms)]. Ningún step ni trigger se descarta.
+const SEQ_EVENT_MAGIC = 0xB4;
+let _seqEventsActive = false;   // true tras el primer frame 0xB4
+let _playheadAnchor = null;     // { step, t, stepMs } — último step con su hora real
+let _playheadRaf = 0;
+const _seqFlashTimers = new Array(16).fill(null);
+
+function handleSeqEventFrame(buf) {
+    if (buf.byteLength < 5) return;
+    const view = new DataView(buf);
+    const count = view.getUint8(1);
+    if (buf.byteLength < 5 + count * 5) return;
+    const playing = (view.getUint8(2) & 0x01) !== 0;
+    const tempo = view.getUint16(3, true) / 10;
+    const now = performance.now();
+    _seqEventsActive = true;
+
+    let lastStep = null;
+    let lastStepT = now;
+    for (let i = 0, off = 5; i < count; i++, off += 5) {
+        const type = view.getUint8(off);
+        const a = view.getUint8(off + 1);
+        const b = view.getUint8(off + 2);
+        const t = now - view.getUint16(off + 3, true) / 10;
+        if (type === 1) {
+            lastStep = a;
+            lastStepT = t;
+        } else if (type === 2) {
+            flashSeqTrigger(a, b);
+        } else if (type === 3) {
+            handleSongPatternChange(a, b);
+        }
+    }
+
+    if (!playing) {
+        _playheadAnchor = null;
+        return;
+    }
+    if (lastStep !== null) {
+        // 1 step = semicorchea: 60000 / tempo / 4 ms
+        _playheadAnchor = { step: lastStep, t: lastStepT, stepMs: tempo > 0 ? 15000 / tempo : 0 };
+        updateCurrentStep(lastStep);
+        if (!_playheadRaf) _playheadRaf = requestAnimationFrame(_tickPlayhead);
+    }
+}
+
+// Playhead interpolado entre steps a partir del último step recibido
+function _tickPlayhead() {
+    _playheadRaf = 0;
+    const anchor = _playheadAnchor;
+    if (!anchor || !anchor.stepMs) return;
+    const frac = (performance.now() - anchor.t) / anchor.stepMs;
+    if (frac > 4) return;  // sin steps nuevos: transporte parado o WS caído
+    updateSequencerPlayhead(anchor.step, Math.min(frac, 0.98));
+    _playheadRaf = requestAnimationFrame(_tickPlayhead);
+}
+
+function flashSeqTrigger(track, velocity) {
+    if (!syncLedsEnabled || track >= 16) return;
+    _ensurePadElCache();
+    const pad = _cachedPadEls[track];
+    if (!pad) return;
+    pad.classList.add('sync-flash');
+    if (_seqFlashTimers[track]) clearTimeout(_seqFlashTimers[track]);
+    _seqFlashTimers[track] = setTimeout(() => {
+        pad.classList.remove('sync-flash');
+        _seqFlashTimers[track] = null;
+    }, velocity > 100 ? 140 : 100);
+}
+
+function updateSequencerPlayhead(step, frac) {
     const gridWrapper = document.getElementById('sequencerContainer');
     if (!gridWrapper) return;
 
@@ -3794,9 +3904,12 @@ function updateSequencerPlayhead(step) {
 
     const wrapperRect = gridWrapper.getBoundingClientRect();
     const stepRect = stepEl.getBoundingClientRect();
-    const x = (stepRect.left - wrapperRect.left) + gridWrapper.scrollLeft + (stepRect.width / 2);
+    const interpolated = typeof frac === 'number';
+    const x = (stepRect.left - wrapperRect.left) + gridWrapper.scrollLeft + (stepRect.width / 2)
+        + (interpolated ? stepRect.width * frac : 0);
 
     playheadLine.style.transform = `translateX(${Math.round(x)}px)`;
+    playheadLine.classList.toggle('interpolated', interpolated);
     playheadLine.classList.add('visible');
 }
 
@@ -5087,14 +5200,265 @@ window.onSongModeActivated = function(length, midiFileName) {
 };
 
 // Send WebSocket message (returns true if sent)
+// ============= BINARY WS PROTOCOL v1 =============
+// Espejo de kBinSchemas en src/WsBinaryProtocol.cpp — mismos opcodes, mismo orden de campos.
+// Sólo se usa si el servidor anuncia binProto >= 1 en "connected" y las claves
+// del comando coinciden exactamente con un esquema; si no, JSON. Con binProto >= 4
+// el "rid" viaja en los 2 bytes finales del frame.
+const WS_BIN_CMD_V1 = 0xB1;
+let wsBinProto = 0;
+// Última versión de estado recibida (sobrevive a reconexiones → el server manda sólo el delta)
+let wsStateVersion = 0;
+let wsStateEpoch = 0;
+const WS_BIN_SCHEMAS = [
+    [0x01, 'setStep', [['track', 'u8'], ['step', 'u8'], ['active', 'b']]],
+    [0x02, 'setStep', [['track', 'u8'], ['step', 'u8'], ['active', 'b'], ['noteLen', 'u8']]],
+    [0x03, 'setStep', [['track', 'u8'], ['step', 'u8'], ['active', 'b'], ['silent', 'b']]],
+    [0x04, 'setStepVelocity', [['track', 'u8'], ['step', 'u8'], ['velocity', 'u8']]],
+    [0x05, 'setStepVelocity', [['track', 'u8'], ['step', 'u8'], ['velocity', 'u8'], ['silent', 'b']]],
+    [0x06, 'setStepProbability', [['track', 'u8'], ['step', 'u8'], ['probability', 'u8']]],
+    [0x07, 'start', []],
+    [0x08, 'stop', []],
+    [0x09, 'tempo', [['value', 'f32']]],
+    [0x0A, 'selectPattern', [['index', 'u8']]],
+    [0x0B, 'mute', [['track', 'u8'], ['value', 'b']]],
+    [0x0C, 'solo', [['track', 'u8'], ['value', 'b']]],
+    [0x0D, 'setTrackVolume', [['track', 'u8'], ['volume', 'u16']]],
+    [0x0E, 'setVolume', [['value', 'u16']]],
+    [0x0F, 'setSequencerVolume', [['value', 'u16']]],
+    [0x10, 'setLiveVolume', [['value', 'u16']]],
+    [0x11, 'setLivePitch', [['pitch', 'f32']]],
+    [0x12, 'setFilterCutoff', [['value', 'f32']]],
+    [0x13, 'setFilterResonance', [['value', 'f32']]],
+    [0x14, 'setDistortion', [['value', 'f32']]],
+    [0x15, 'setBitCrush', [['value', 'u8']]],
+    [0x16, 'setSampleRate', [['value', 'u16']]],
+    [0x17, 'setDelayTime', [['value', 'f32']]],
+    [0x18, 'setDelayFeedback', [['value', 'f32']]],
+    [0x19, 'setDelayMix', [['value', 'f32']]],
+    [0x1A, 'setPhaserRate', [['value', 'f32']]],
+    [0x1B, 'setPhaserDepth', [['value', 'f32']]],
+    [0x1C, 'setFlangerRate', [['value', 'f32']]],
+    [0x1D, 'setFlangerDepth', [['value', 'f32']]],
+    [0x1E, 'setTrackPan', [['track', 'u8'], ['value', 'f32']]],
+    [0x1F, 'setTrackReverbSend', [['track', 'u8'], ['value', 'f32']]],
+    [0x20, 'setTrackDelaySend', [['track', 'u8'], ['value', 'f32']]],
+    [0x21, 'setTrackChorusSend', [['track', 'u8'], ['value', 'f32']]],
+    [0x22, 'setReverse', [['track', 'u8'], ['value', 'b']]],
+    [0x23, 'setReverse', [['pad', 'u8'], ['value', 'b']]],
+    [0x24, 'setPitchShift', [['track', 'u8'], ['value', 'f32']]],
+    [0x25, 'setPitchShift', [['pad', 'u8'], ['value', 'f32']]],
+    [0x26, 'setStutter', [['track', 'u8'], ['value', 'b'], ['interval', 'u16']]],
+    [0x27, 'setStutter', [['track', 'u8'], ['active', 'b'], ['interval', 'u16']]],
+    [0x28, 'setStutter', [['pad', 'u8'], ['active', 'b'], ['interval', 'u16']]],
+    [0x29, 'synthNoteOnEx', [['engine', 'u8'], ['note', 'u8'], ['velocity', 'u8'], ['accent', 'b'], ['slide', 'b']]],
+    [0x2A, 'synthNoteOff', [['track', 'u8'], ['engine', 'u8']]],
+    [0x2B, 'synthParam', [['engine', 'u8'], ['instrument', 'u8'], ['paramId', 'u8'], ['value', 'f32']]],
+    [0x2C, 'synth303Param', [['paramId', 'u8'], ['value', 'f32']]]
+];
+const WS_BIN_FIELD_SIZE = { u8: 1, u16: 2, f32: 4, b: 1 };
+// Índice: "cmd|clave1,clave2" (claves ordenadas) → esquema
+const _wsBinIndex = new Map();
+WS_BIN_SCHEMAS.forEach(([opcode, cmd, fields]) => {
+    const size = 2 + fields.reduce((n, [, t]) => n + WS_BIN_FIELD_SIZE[t], 0);
+    _wsBinIndex.set(cmd + '|' + fields.map(([k]) => k).sort().join(','), { opcode, fields, size });
+});
+
+function encodeBinaryCommand(data) {
+    if (!data || typeof data.cmd !== 'string') return null;
+    const rid = data.rid;
+    if (rid !== undefined && (wsBinProto < 4 || !Number.isInteger(rid) || rid < 1 || rid > 0xFFFF)) return null;
+    const keys = Object.keys(data).filter(k => k !== 'cmd' && k !== 'rid' && data[k] !== undefined).sort();
+    const schema = _wsBinIndex.get(data.cmd + '|' + keys.join(','));
+    if (!schema) return null;
+    const buf = new ArrayBuffer(schema.size + (rid !== undefined ? 2 : 0));
+    const view = new DataView(buf);
+    view.setUint8(0, WS_BIN_CMD_V1);
+    view.setUint8(1, schema.opcode);
+    let off = 2;
+    for (const [key, type] of schema.fields) {
+        const v = data[key];
+        if (type === 'b') {
+            if (typeof v !== 'boolean') return null;
+            view.setUint8(off, v ? 1 : 0);
+        } else if (type === 'f32') {
+            if (typeof v !== 'number' || !Number.isFinite(v)) return null;
+            view.setFloat32(off, v, true);
+        } else {
+            const max = type === 'u8' ? 0xFF : 0xFFFF;
+            if (!Number.isInteger(v) || v < 0 || v > max) return null;
+            if (type === 'u8') view.setUint8(off, v); else view.setUint16(off, v, true);
+        }
+        off += WS_BIN_FIELD_SIZE[type];
+    }
+    if (rid !== undefined) view.setUint16(off, rid, true);
+    return buf;
+}
+
+// ============= BINARY PATTERN (0xB2) =============
+// Espejo de src/PatternCodec.h: cabecera + 16 máscaras u64 + secciones RLE/dispersas.
+const PATTERN_BIN_MAGIC = 0xB2;
+const WS_BIN_CLIENT_PROTO = 3;  // 2 = patrones 0xB2, 3 = + eventos 0xB4
+const PATTERN_RLE_SECTIONS = { 1: 'velocities', 2: 'noteLens', 3: 'probabilities', 4: 'ratchets', 5: 'stepNotes', 6: 'stepFlags' };
+const PATTERN_LOCK_SECTIONS = { 0x10: ['volumeLocks', 1], 0x11: ['cutoffLocks', 2], 0x12: ['reverbLocks', 1] };
+
+// Devuelve el mismo objeto que el mensaje JSON {type:'pattern', ...}
+function decodeBinaryPattern(buf) {
+    const view = new DataView(buf);
+    if (buf.byteLength < 133 || view.getUint8(1) !== 1) return null;
+    const stepCount = view.getUint8(3);
+    const msg = { type: 'pattern', index: view.getUint8(2), stepCount };
+    const perTrack = (fill) => {
+        const obj = {};
+        for (let t = 0; t < 16; t++) obj[t] = new Array(stepCount).fill(fill);
+        return obj;
+    };
+    for (let t = 0; t < 16; t++) {
+        const lo = view.getUint32(5 + t * 8, true);
+        const hi = view.getUint32(9 + t * 8, true);
+        const steps = new Array(stepCount);
+        for (let s = 0; s < stepCount; s++) {
+            steps[s] = s < 32 ? !!((lo >>> s) & 1) : !!((hi >>> (s - 32)) & 1);
+        }
+        msg[t] = steps;
+    }
+    ['volumeLocks', 'cutoffLocks', 'reverbLocks'].forEach(k => { msg[k] = perTrack(-1); });
+    const voices = {};
+    for (let off = 133; off + 3 <= buf.byteLength;) {
+        const id = view.getUint8(off);
+        const len = view.getUint16(off + 1, true);
+        const body = off + 3;
+        off = body + len;
+        if (off > buf.byteLength) return null;
+        if (PATTERN_RLE_SECTIONS[id]) {
+            const out = perTrack(0);
+            let idx = 0;
+            for (let i = 0; i + 1 < len && idx < 16 * stepCount; i += 2) {
+                const run = view.getUint8(body + i);
+                const v = view.getUint8(body + i + 1);
+                for (let r = 0; r < run && idx < 16 * stepCount; r++, idx++) {
+                    out[Math.floor(idx / stepCount)][idx % stepCount] = v;
+                }
+            }
+            msg[PATTERN_RLE_SECTIONS[id]] = out;
+        } else if (PATTERN_LOCK_SECTIONS[id] || id === 0x13) {
+            const count = view.getUint16(body, true);
+            const wide = id === 0x13 ? 3 : PATTERN_LOCK_SECTIONS[id][1];
+            for (let i = 0, e = body + 2; i < count; i++, e += 2 + wide) {
+                const t = view.getUint8(e), s = view.getUint8(e + 1);
+                if (t >= 16 || s >= stepCount) continue;
+                if (id === 0x13) {
+                    voices[`${t}-${s}`] = [view.getUint8(e + 2), view.getUint8(e + 3), view.getUint8(e + 4)];
+                } else {
+                    msg[PATTERN_LOCK_SECTIONS[id][0]][t][s] = wide === 2 ? view.getUint16(e + 2, true) : view.getUint8(e + 2);
+                }
+            }
+        }
+    }
+    if (msg.stepNotes) {
+        msg.stepNoteVoices = {};
+        for (let t = 0; t < 16; t++) {
+            msg.stepNoteVoices[t] = msg.stepNotes[t].map((n, s) => [n, ...(voices[`${t}-${s}`] || [0, 0, 0])]);
+        }
+    }
+    return msg;
+}
+
+// setBulk {p, s, v} → frame 0xB2 con máscaras + sección velocity (misma semántica que el JSON)
+function encodeBinaryPattern(data) {
+    if (!Array.isArray(data.s) || data.s.length > 16) return null;
+    const stepCount = Math.max(1, Math.min(64, ...data.s.map(t => (Array.isArray(t) ? t.length : 0))));
+    const vals = [];
+    for (let t = 0; t < 16; t++) {
+        const tv = (Array.isArray(data.v) && Array.isArray(data.v[t])) ? data.v[t] : [];
+        for (let s = 0; s < stepCount; s++) {
+            const v = tv[s] | 0;
+            vals.push(v > 0 && v <= 127 ? v : 127);
+        }
+    }
+    const rle = [];
+    for (let i = 0; i < vals.length;) {
+        let run = 1;
+        while (i + run < vals.length && run < 255 && vals[i + run] === vals[i]) run++;
+        rle.push(run, vals[i]);
+        i += run;
+    }
+    const buf = new ArrayBuffer(133 + 3 + rle.length);
+    const view = new DataView(buf);
+    const p = (typeof data.p === 'number' && data.p >= 0 && data.p < 128) ? data.p : 0xFF;
+    view.setUint8(0, PATTERN_BIN_MAGIC);
+    view.setUint8(1, 1);
+    view.setUint8(2, p);
+    view.setUint8(3, stepCount);
+    view.setUint8(4, 0);
+    for (let t = 0; t < 16; t++) {
+        let lo = 0, hi = 0;
+        const ts = Array.isArray(data.s[t]) ? data.s[t] : [];
+        for (let s = 0; s < Math.min(64, ts.length); s++) {
+            if (!ts[s]) continue;
+            if (s < 32) lo |= (1 << s); else hi |= (1 << (s - 32));
+        }
+        view.setUint32(5 + t * 8, lo >>> 0, true);
+        view.setUint32(9 + t * 8, hi >>> 0, true);
+    }
+    view.setUint8(133, 0x01);
+    view.setUint16(134, rle.length, true);
+    new Uint8Array(buf, 136).set(rle);
+    return buf;
+}
+
 function sendWebSocket(data) {
     if (ws && ws.readyState === WebSocket.OPEN) {
-        ws.send(JSON.stringify(data));
+        if (wsBinProto >= 2 && data && data.cmd === 'setBulk') {
+            const pat = encodeBinaryPattern(data);
+            if (pat) { ws.send(pat); return true; }
+        }
+        const bin = wsBinProto >= 1 ? encodeBinaryCommand(data) : null;
+        ws.send(bin || JSON.stringify(data));
         return true;
     }
     return false;
 }
 
+// ── ACKs de comandos ("rid", ver CmdAck.h) ──
+// El server contesta {"type":"ack","rid":N,"ok":..,"us":..} cuando el último
+// frame SPI del comando sale hacia la Daisy; cada 5 s manda {"type":"ackStats"}
+// con p50/p95 de su lado. Aquí se mide el RTT completo desde el navegador.
+const WS_ACK_MAX_PENDING = 64;
+let _wsRidSeq = 0;
+const _wsAckPending = new Map();   // rid → performance.now() del envío
+window.wsAckStats = { server: null, lastRttMs: 0, acks: 0, nacks: 0 };
+
+function nextWsRid() {
+    _wsRidSeq = (_wsRidSeq % 65535) + 1;   // 1..65535 (cabe en el trigger binario)
+    if (_wsAckPending.size >= WS_ACK_MAX_PENDING) {
+        _wsAckPending.delete(_wsAckPending.keys().next().value);   // el más antiguo
+    }
+    _wsAckPending.set(_wsRidSeq, performance.now());
+    return _wsRidSeq;
+}
+
+function handleWsAck(data) {
+    if (data.type === 'ackStats') {
+        window.wsAckStats.server = data;
+        return;
+    }
+    const sentAt = _wsAckPending.get(data.rid);
+    _wsAckPending.delete(data.rid);
+    if (data.ok) {
+        window.wsAckStats.acks++;
+        if (sentAt !== undefined) window.wsAckStats.lastRttMs = performance.now() - sentAt;
+    } else {
+        window.wsAckStats.nacks++;
+        console.warn(`[WS] comando rid=${data.rid} rechazado: ${data.err}`);
+    }
+}
+
+// Igual que sendWebSocket pero con confirmación de salida SPI (fuerza JSON)
+function sendWebSocketAcked(data) {
+    return sendWebSocket({ ...data, rid: nextWsRid() });
+}
+
 const WS_FX_THROTTLE_MS = 30;
 const _wsThrottleTimers = new Map();
 
@@ -5114,6 +5478,13 @@ function isWebSocketReady() {
     return ws && ws.readyState === WebSocket.OPEN;
 }
 
+// Pestaña oculta: sin meters ni steps (el servidor deja de codificarlos y, si
+// nadie más los pinta, de pedir peaks por SPI). Al volver se reanudan.
+document.addEventListener('visibilitychange', () => {
+    const live = ['levels', 'steps'];
+    sendWebSocket(document.hidden ? { cmd: 'subscribe', remove: live } : { cmd: 'subscribe', add: live });
+});
+
 // Export to window for keyboard-controls.js and midi-import.js
 window.sendWebSocket = sendWebSocket;
 window.sendWebSocketThrottled = sendWebSocketThrottled;
@@ -5276,11 +5647,11 @@ function selectPattern(index) {
 function togglePlayPause() {
     if (isPlaying) {
         // Pause
-        sendWebSocket({ cmd: 'stop' });
+        sendWebSocketAcked({ cmd: 'stop' });
         isPlaying = false;
     } else {
         // Play
-        sendWebSocket({ cmd: 'start' });
+        sendWebSocketAcked({ cmd: 'start' });
         isPlaying = true;
     }
     updateSequencerStatusMeter();
@@ -268,6 +268,10 @@ const WS_MIN_SEND_GAP_MS = 12;
 const WS_MAX_QUEUE = 240;
 const WS_BOOT_SYNC_DELAY_MS = 34;
 const WS_BOOT_SYNC_MAX_CABLES = 48;
+// Streams que pinta el patchbay (sin patrón ni logs)
+const PB_WS_TOPICS = ['levels', 'steps', 'transport', 'mixer', 'samples'];
+const WS_BATCH_MAX_CMDS = 48;       // firmware: kBatchMaxCmds = 64
+const WS_BATCH_MAX_BYTES = 6000;
 let activeMacroScene = 'A';
 let macrosEnabled = true;
 let macroScenes = {
@@ -604,6 +608,8 @@ function connectWS() {
   ws.onopen = () => {
     wsConnected = true;
     document.getElementById('pbWsStatus').classList.add('connected');
+    // Directo, fuera de la cola: "subscribe" no puede ir dentro de un batch
+    ws.send(JSON.stringify({ cmd: 'subscribe', topics: PB_WS_TOPICS }));
     flushWsQueue();
     syncConnectionsAfterReconnect();
     sendCmd('getTrackVolumes', {});
@@ -679,7 +685,7 @@ function flushWsQueue() {
     return;
   }
 
-  const payload = queuedWsPayloads.shift();
+  const payload = takeWsPayload();
   ws.send(payload);
   lastWsSendTs = performance.now();
 
@@ -688,6 +694,24 @@ function flushWsQueue() {
   }
 }
 
+// Varios comandos en cola (escena, preset, resync de cables): un solo envelope
+// "batch" → un round-trip, SPI coalescido y un único delta de estado.
+// Con cuantización de escena activa el firmware lo aplica en un límite de step.
+function takeWsPayload() {
+  if (queuedWsPayloads.length < 2) return queuedWsPayloads.shift();
+  const parts = [];
+  let bytes = 0;
+  while (queuedWsPayloads.length && parts.length < WS_BATCH_MAX_CMDS &&
+         bytes + queuedWsPayloads[0].length < WS_BATCH_MAX_BYTES) {
+    const p = queuedWsPayloads.shift();
+    parts.push(p);
+    bytes += p.length + 1;
+  }
+  if (!parts.length) return queuedWsPayloads.shift();
+  if (parts.length === 1) return parts[0];
+  return `{"cmd":"batch","atomic":${sceneQuantizeEnabled},"cmds":[${parts.join(',')}]}`;
+}
+
 function sendCmd(cmd, data) {
   if (!ws || ws.readyState !== 1) {
     console.warn('[PATCH] sendCmd DROPPED (WS not connected):', cmd, data);
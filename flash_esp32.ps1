@@ -6,13 +6,25 @@
 #   .\flash_esp32.ps1                   # firmware + LittleFS
 #   .\flash_esp32.ps1 -SkipFS          # solo firmware (más rápido)
 #   .\flash_esp32.ps1 -Port COM12      # otro puerto
+#   .\flash_esp32.ps1 -PcmStore        # env redmaster-s3-r8n16-pcmstore (+ partición pcmstore)
+#
+# -PcmStore flashea el build del env redmaster-s3-r8n16-pcmstore, con la tabla
+# partitions_pcmstore.csv (LittleFS 8MB + pcmstore ~4MB), y pcmstore.bin si
+# existe (python tools/pack_pcmstore.py; PCM pre-convertido, ver PcmStore.h).
+#
+# ATENCIÓN — CAMBIO DE TABLA DE PARTICIONES: el modo normal usa
+# partitions_custom.csv (LittleFS 11MB). Al pasar de una tabla a la otra el
+# LittleFS que ya hay en el equipo deja de montar y el firmware lo FORMATEA al
+# arrancar (LittleFS.begin(true)): se pierden los assets web y los samples.
+# En ese cambio no uses -SkipFS: flashea también littlefs.bin del mismo env.
 #
 # REQUISITO: poner el ESP32-S3 en modo bootloader (BOOT + RESET) antes de ejecutar.
 # =============================================================================
 param(
     [string]$Port     = "COM11",
     [int]   $Baud     = 460800,
-    [switch]$SkipFS
+    [switch]$SkipFS,
+    [switch]$PcmStore
 )
 
 $env:PYTHONIOENCODING = 'utf-8'
@@ -20,28 +32,36 @@ chcp 65001 > $null
 
 $py      = "$env:USERPROFILE\.platformio\penv\Scripts\python.exe"
 $esptool = "$env:USERPROFILE\.platformio\packages\tool-esptoolpy\esptool.py"
-$b       = "$PSScriptRoot\.pio\build\redmaster-s3-r8n16"
+$envName = if ($PcmStore) { "redmaster-s3-r8n16-pcmstore" } else { "redmaster-s3-r8n16" }
+$b       = "$PSScriptRoot\.pio\build\$envName"
 
 # Verificar archivos
 $required = @("$b\bootloader.bin", "$b\partitions.bin", "$b\firmware.bin")
 foreach ($f in $required) {
     if (-not (Test-Path $f)) {
         Write-Host "ERROR: No encontrado: $f" -ForegroundColor Red
-        Write-Host "Compila primero con: pio run (o PlatformIO: Build)" -ForegroundColor Yellow
+        Write-Host "Compila primero con: pio run -e $envName (o PlatformIO: Build)" -ForegroundColor Yellow
         exit 1
     }
 }
 if (-not $SkipFS -and -not (Test-Path "$b\littlefs.bin")) {
     Write-Host "AVISO: littlefs.bin no encontrado. Usa -SkipFS para omitir el filesystem." -ForegroundColor Yellow
-    Write-Host "       O compila con: pio run --target buildfs" -ForegroundColor Yellow
+    Write-Host "       O compila con: pio run -e $envName --target buildfs" -ForegroundColor Yellow
     exit 1
 }
+if ($PcmStore -and $SkipFS) {
+    Write-Host "AVISO: -PcmStore cambia la tabla de particiones si el equipo venía del modo normal." -ForegroundColor Yellow
+    Write-Host "       Sin littlefs.bin el firmware formateará LittleFS al arrancar (web y samples perdidos)." -ForegroundColor Yellow
+    Write-Host "Escribe SI si el equipo ya tiene la tabla pcmstore: " -NoNewline
+    if ((Read-Host) -ne "SI") { exit 1 }
+}
 
 Write-Host ""
 Write-Host "=== RED808 Master Flash ===" -ForegroundColor Cyan
 Write-Host "Puerto : $Port @ $Baud baud"
 Write-Host "Chip   : ESP32-S3 R8N16 (dio/80m/16MB, PSRAM OPI)"
 Write-Host "Build  : $b"
+if ($PcmStore) { Write-Host "Tabla  : partitions_pcmstore.csv (LittleFS 8MB + pcmstore)" -ForegroundColor Yellow }
 if ($SkipFS) { Write-Host "Modo   : Solo firmware (sin LittleFS)" -ForegroundColor Yellow }
 else         { Write-Host "Modo   : Firmware + LittleFS"            -ForegroundColor Green }
 Write-Host ""
@@ -67,7 +87,12 @@ if ($SkipFS) {
     exit 0
 }
 
-# ----- PASO 2: LittleFS -----
+# ----- PASO 2: LittleFS [+ pcmstore] -----
+$fsImages = @("0x410000", "$b\littlefs.bin")
+if ($PcmStore -and (Test-Path "$b\pcmstore.bin")) {
+    $fsImages += @("0xC10000", "$b\pcmstore.bin")
+    Write-Host "pcmstore.bin encontrado: se flashea en 0xC10000" -ForegroundColor Green
+}
 Write-Host ""
 Write-Host "--- Flashing LittleFS (web assets) ---" -ForegroundColor Cyan
 Write-Host "NOTA: Vuelve a poner en modo bootloader si el ESP32 ya arrancó (BOOT+RESET)" -ForegroundColor Yellow
@@ -78,7 +103,7 @@ Read-Host | Out-Null
     --chip esp32s3 --port $Port --baud $Baud `
     --before default-reset --after hard-reset `
     write-flash -z --flash-mode dio --flash-freq 80m --flash-size 16MB `
-    0x410000 "$b\littlefs.bin"
+    @fsImages
 
 if ($LASTEXITCODE -ne 0) {
     Write-Host "ERROR: LittleFS flash falló (exit $LASTEXITCODE)" -ForegroundColor Red
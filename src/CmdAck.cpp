@@ -0,0 +1,200 @@
+/*
+ * CmdAck.cpp
+ * RED808 acks extremo a extremo (ver CmdAck.h)
+ */
+
+#include "CmdAck.h"
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+
+struct CmdAckSlot {
+  bool     used;
+  bool     armed;         // dispatch terminado: expected ya es definitivo
+  bool     deferred;
+  CmdAckChannel channel;
+  uint32_t owner;
+  uint16_t port;
+  uint32_t rid;
+  uint32_t rxUs;
+  uint32_t openMs;
+  uint32_t lastUs;        // fin del último frame confirmado
+  uint16_t expected;
+  uint16_t done;
+  uint16_t failed;        // transferencias fallidas
+  uint16_t dropped;       // descartados al encolar
+};
+
+static CmdAckSlot _slots[CMDACK_SLOTS] = {};
+static uint8_t _nextSlot = 0;
+static portMUX_TYPE _ackMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Se llama con el mux tomado
+static void resolve(CmdAckSlot& s, CmdAckError timeoutErr, CmdAckDone* out) {
+  out->channel = s.channel;
+  out->owner = s.owner;
+  out->port = s.port;
+  out->rid = s.rid;
+  out->deferred = s.deferred;
+  out->frames = s.done;
+  out->us = s.lastUs - s.rxUs;
+  if (timeoutErr != CMDACK_OK)  out->err = timeoutErr;
+  else if (s.dropped > 0)       out->err = CMDACK_ERR_SPI_DROP;
+  else if (s.failed > 0)        out->err = CMDACK_ERR_SPI_FAIL;
+  else                          out->err = CMDACK_OK;
+  s.used = false;
+}
+
+uint8_t cmdAckOpen(CmdAckChannel ch, uint32_t owner, uint16_t port, uint32_t rid, uint32_t rxUs) {
+  uint8_t tag = 0;
+  portENTER_CRITICAL(&_ackMux);
+  // Round-robin: un tag recién liberado tarda en reutilizarse (frames tardíos)
+  for (uint8_t k = 0; k < CMDACK_SLOTS; k++) {
+    uint8_t i = (uint8_t)((_nextSlot + k) % CMDACK_SLOTS);
+    if (_slots[i].used) continue;
+    CmdAckSlot& s = _slots[i];
+    memset(&s, 0, sizeof(s));
+    s.used = true;
+    s.channel = ch;
+    s.owner = owner;
+    s.port = port;
+    s.rid = rid;
+    s.rxUs = rxUs;
+    s.lastUs = rxUs;
+    s.openMs = millis();
+    _nextSlot = (uint8_t)((i + 1) % CMDACK_SLOTS);
+    tag = i + 1;
+    break;
+  }
+  portEXIT_CRITICAL(&_ackMux);
+  return tag;
+}
+
+bool cmdAckArm(uint8_t tag, const SpiTagResult& r, uint32_t nowUs, CmdAckDone* out) {
+  if (tag == 0 || tag > CMDACK_SLOTS) return false;
+  bool resolved = false;
+  portENTER_CRITICAL(&_ackMux);
+  CmdAckSlot& s = _slots[tag - 1];
+  if (s.used && !s.armed) {
+    s.armed = true;
+    s.expected = r.queued;
+    s.dropped = r.dropped;
+    s.deferred = s.deferred || r.staged > 0 || r.untracked;
+    // Sin frames pendientes (comando sólo del ESP32, o Core1 ya los envió todos)
+    if (s.done + s.failed >= s.expected) {
+      if (s.expected == 0) s.lastUs = nowUs;
+      resolve(s, CMDACK_OK, out);
+      resolved = true;
+    }
+  }
+  portEXIT_CRITICAL(&_ackMux);
+  return resolved;
+}
+
+bool cmdAckComplete(const SpiTagCompletion& c, CmdAckDone* out) {
+  if (c.tag == 0 || c.tag > CMDACK_SLOTS) return false;
+  bool resolved = false;
+  portENTER_CRITICAL(&_ackMux);
+  CmdAckSlot& s = _slots[c.tag - 1];
+  if (s.used) {
+    if (c.ok) s.done++;
+    else s.failed++;
+    s.lastUs = c.us;
+    if (s.armed && s.done + s.failed >= s.expected) {
+      resolve(s, CMDACK_OK, out);
+      resolved = true;
+    }
+  }
+  portEXIT_CRITICAL(&_ackMux);
+  return resolved;
+}
+
+bool cmdAckExpire(uint32_t nowMs, CmdAckDone* out) {
+  bool resolved = false;
+  portENTER_CRITICAL(&_ackMux);
+  for (uint8_t i = 0; i < CMDACK_SLOTS; i++) {
+    CmdAckSlot& s = _slots[i];
+    if (!s.used || nowMs - s.openMs < CMDACK_TIMEOUT_MS) continue;
+    resolve(s, CMDACK_ERR_TIMEOUT, out);
+    resolved = true;
+    break;
+  }
+  portEXIT_CRITICAL(&_ackMux);
+  return resolved;
+}
+
+void cmdAckDropOwner(CmdAckChannel ch, uint32_t owner) {
+  portENTER_CRITICAL(&_ackMux);
+  for (uint8_t i = 0; i < CMDACK_SLOTS; i++) {
+    if (_slots[i].used && _slots[i].channel == ch && _slots[i].owner == owner) _slots[i].used = false;
+  }
+  portEXIT_CRITICAL(&_ackMux);
+}
+
+const char* cmdAckErrorName(CmdAckError e) {
+  switch (e) {
+    case CMDACK_OK:            return "ok";
+    case CMDACK_ERR_UNKNOWN:   return "unknown";
+    case CMDACK_ERR_RATE:      return "rate";
+    case CMDACK_ERR_SPI_DROP:  return "spi_drop";
+    case CMDACK_ERR_SPI_FAIL:  return "spi_fail";
+    case CMDACK_ERR_TIMEOUT:   return "timeout";
+    case CMDACK_ERR_ARGS:      return "args";
+    default:                   return "?";
+  }
+}
+
+size_t cmdAckFormat(char* buf, size_t cap, const CmdAckDone& d) {
+  const char* head = d.channel == CMDACK_UDP ? "\"s\":\"ack\"" : "\"type\":\"ack\"";
+  int n;
+  if (d.err == CMDACK_OK) {
+    n = snprintf(buf, cap, "{%s,\"rid\":%lu,\"ok\":true,\"us\":%lu,\"spi\":%u%s}",
+                 head, (unsigned long)d.rid, (unsigned long)d.us, (unsigned)d.frames,
+                 d.deferred ? ",\"deferred\":true" : "");
+  } else {
+    n = snprintf(buf, cap, "{%s,\"rid\":%lu,\"ok\":false,\"err\":\"%s\",\"spi\":%u}",
+                 head, (unsigned long)d.rid, cmdAckErrorName(d.err), (unsigned)d.frames);
+  }
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
+
+void CmdAckStats::reset() {
+  memset(this, 0, sizeof(*this));
+}
+
+void CmdAckStats::record(const CmdAckDone& d) {
+  dirty = true;
+  if (d.err != CMDACK_OK) {
+    nacks++;
+    return;
+  }
+  acks++;
+  if (d.frames == 0) return;   // sin SPI no hay latencia hasta la Daisy que medir
+  lat[pos] = d.us;
+  pos = (uint8_t)((pos + 1) % CMDACK_WINDOW);
+  if (n < CMDACK_WINDOW) n++;
+}
+
+uint32_t CmdAckStats::percentileUs(uint8_t pct) const {
+  if (n == 0) return 0;
+  uint32_t sorted[CMDACK_WINDOW];
+  memcpy(sorted, lat, n * sizeof(uint32_t));
+  // n <= 32: inserción
+  for (uint8_t i = 1; i < n; i++) {
+    uint32_t v = sorted[i];
+    int8_t j = (int8_t)i - 1;
+    while (j >= 0 && sorted[j] > v) { sorted[j + 1] = sorted[j]; j--; }
+    sorted[j + 1] = v;
+  }
+  uint8_t idx = (uint8_t)(((uint16_t)(n - 1) * pct + 50) / 100);
+  return sorted[idx];
+}
+
+size_t cmdAckStatsFormat(char* buf, size_t cap, const CmdAckStats& st) {
+  int n = snprintf(buf, cap,
+                   "{\"type\":\"ackStats\",\"acks\":%lu,\"nacks\":%lu,\"n\":%u,\"p50\":%lu,\"p95\":%lu,\"max\":%lu}",
+                   (unsigned long)st.acks, (unsigned long)st.nacks, (unsigned)st.n,
+                   (unsigned long)st.percentileUs(50), (unsigned long)st.percentileUs(95),
+                   (unsigned long)st.percentileUs(100));
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * CmdAck.h
+ * RED808 acks extremo a extremo de comandos con "rid" (WS y UDP): ACK cuando
+ * el último frame SPI del comando sale hacia la Daisy (al momento si el
+ * comando no genera SPI), NACK si la cola SPI lo descartó o no salió a tiempo.
+ * Latencia = recepción del frame WS/UDP → fin de la transferencia SPI.
+ */
+
+#ifndef CMD_ACK_H
+#define CMD_ACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SPIMaster.h"
+
+#define CMDACK_SLOTS        16    // comandos en vuelo (tag = slot + 1)
+#define CMDACK_TIMEOUT_MS   500
+#define CMDACK_WINDOW       32    // últimas latencias por cliente (p50/p95)
+
+enum CmdAckChannel : uint8_t {
+  CMDACK_WS = 0,
+  CMDACK_UDP
+};
+
+enum CmdAckError : uint8_t {
+  CMDACK_OK = 0,
+  CMDACK_ERR_UNKNOWN,     // comando desconocido
+  CMDACK_ERR_RATE,        // descartado por IngressLimiter
+  CMDACK_ERR_SPI_DROP,    // cola SPI llena
+  CMDACK_ERR_SPI_FAIL,    // transferencia fallida (mutex ocupado, tamaño)
+  CMDACK_ERR_TIMEOUT,     // sin confirmación de Core1 en CMDACK_TIMEOUT_MS
+  CMDACK_ERR_ARGS         // falta un campo obligatorio (commandRequiredFields)
+};
+
+struct CmdAckDone {
+  CmdAckChannel channel;
+  uint32_t owner;         // clientId WS o IPv4 del slave
+  uint16_t port;          // sólo UDP
+  uint32_t rid;
+  CmdAckError err;
+  bool     deferred;      // aceptado pero sale más tarde (PARAM coalescido, batch abierto) o sin seguimiento SPI
+  uint16_t frames;        // frames SPI que salieron
+  uint32_t us;            // recepción → último frame fuera (o fin del dispatch sin SPI)
+};
+
+// Tabla de comandos en vuelo (Core0: async_tcp abre/arma, systemTask completa/caduca)
+uint8_t cmdAckOpen(CmdAckChannel ch, uint32_t owner, uint16_t port, uint32_t rid, uint32_t rxUs);  // 0 = llena
+// Tras el dispatch: true si ya está resuelto (sin frames pendientes) → out
+bool cmdAckArm(uint8_t tag, const SpiTagResult& r, uint32_t nowUs, CmdAckDone* out);
+// Frame etiquetado enviado por Core1: true si era el último del comando → out
+bool cmdAckComplete(const SpiTagCompletion& c, CmdAckDone* out);
+// Un comando caducado por llamada (NACK timeout)
+bool cmdAckExpire(uint32_t nowMs, CmdAckDone* out);
+void cmdAckDropOwner(CmdAckChannel ch, uint32_t owner);   // cliente desconectado
+
+const char* cmdAckErrorName(CmdAckError e);
+// {"type":"ack","rid":N,"ok":true,"us":..,"spi":..} (WS) / {"s":"ack",...} (UDP)
+size_t cmdAckFormat(char* buf, size_t cap, const CmdAckDone& d);
+
+// Ventana móvil por cliente
+struct CmdAckStats {
+  uint32_t lat[CMDACK_WINDOW];
+  uint8_t  pos;
+  uint8_t  n;
+  bool     dirty;         // hay muestras nuevas desde el último informe
+  uint32_t acks;
+  uint32_t nacks;
+
+  void reset();
+  void record(const CmdAckDone& d);
+  uint32_t percentileUs(uint8_t pct) const;
+};
+// {"type":"ackStats","acks":..,"nacks":..,"n":..,"p50":..,"p95":..,"max":..}
+size_t cmdAckStatsFormat(char* buf, size_t cap, const CmdAckStats& st);
+
+#endif // CMD_ACK_H
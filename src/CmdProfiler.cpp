@@ -0,0 +1,134 @@
+/*
+ * CmdProfiler.cpp
+ * RED808 perfil de la ruta de comandos (ver CmdProfiler.h)
+ */
+
+#include "CmdProfiler.h"
+#include "HeapProfiler.h"
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <string.h>
+
+// Tabla por comando en PSRAM (~10 KB): sólo se reserva al activar el perfil
+static CmdProfStats* _cmdStats = nullptr;
+static CmdProfStats _pathStats[CMDPROF_PATH_COUNT];
+static CmdProfWindow _window = {};
+static volatile bool _enabled = false;
+static portMUX_TYPE _profMux = portMUX_INITIALIZER_UNLOCKED;
+
+void cmdProfEnable(bool on, bool reset) {
+  if (on && !_cmdStats) {
+    _cmdStats = (CmdProfStats*)hpCalloc(WSC_COUNT, sizeof(CmdProfStats), HP_HEAP_PSRAM, "cmdprof");
+    if (!_cmdStats) return;
+  }
+  portENTER_CRITICAL(&_profMux);
+  if (reset) {
+    if (_cmdStats) memset(_cmdStats, 0, WSC_COUNT * sizeof(CmdProfStats));
+    memset(_pathStats, 0, sizeof(_pathStats));
+  }
+  // Mínimos por ventana: arrancan en "sin muestra" al abrirla y con reset
+  if (reset || (on && !_window.enabled)) {
+    _window.minFreeHeap = 0xFFFFFFFF;
+    _window.minLargest = 0xFFFFFFFF;
+  }
+  if (on && !_window.enabled) _window.startMs = millis();
+  _window.enabled = on;
+  _enabled = on;
+  portEXIT_CRITICAL(&_profMux);
+}
+
+bool cmdProfEnabled() { return _enabled; }
+
+CmdProfMark cmdProfBegin() {
+  CmdProfMark m = { 0, 0 };
+  if (!_enabled) return m;
+  m.heap = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  m.us = micros();
+  if (m.us == 0) m.us = 1;   // 0 = perfil apagado
+  return m;
+}
+
+static uint8_t bucketOf(uint32_t us) {
+  uint8_t b = 0;
+  uint32_t limit = CMDPROF_BUCKET0_US;
+  while (b < CMDPROF_BUCKETS - 1 && us >= limit) {
+    limit <<= 1;
+    b++;
+  }
+  return b;
+}
+
+// Se llama con el mux tomado
+static void account(CmdProfStats& st, uint32_t us, int32_t heapDrop) {
+  st.count++;
+  st.totalUs += us;
+  if (us > st.maxUs) st.maxUs = us;
+  if (heapDrop > st.heapMax) st.heapMax = heapDrop;
+  st.hist[bucketOf(us)]++;
+}
+
+static void finish(const CmdProfMark& m, CmdProfStats* st) {
+  uint32_t us = micros() - m.us;
+  uint32_t heap = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  int32_t drop = (int32_t)m.heap - (int32_t)heap;
+  portENTER_CRITICAL(&_profMux);
+  if (_enabled && st) {
+    account(*st, us, drop);
+    if (heap < _window.minFreeHeap) _window.minFreeHeap = heap;
+    if (largest < _window.minLargest) _window.minLargest = largest;
+  }
+  portEXIT_CRITICAL(&_profMux);
+}
+
+void cmdProfEndCommand(const CmdProfMark& m, WsCmdId id) {
+  if (m.us == 0 || id >= WSC_COUNT || !_cmdStats) return;
+  finish(m, &_cmdStats[id]);
+}
+
+void cmdProfEndPath(const CmdProfMark& m, CmdProfPath path) {
+  if (m.us == 0 || path >= CMDPROF_PATH_COUNT) return;
+  finish(m, &_pathStats[path]);
+}
+
+bool cmdProfCommand(WsCmdId id, CmdProfStats* out) {
+  if (id >= WSC_COUNT || !_cmdStats) return false;
+  portENTER_CRITICAL(&_profMux);
+  *out = _cmdStats[id];
+  portEXIT_CRITICAL(&_profMux);
+  return out->count > 0;
+}
+
+void cmdProfPath(CmdProfPath path, CmdProfStats* out) {
+  portENTER_CRITICAL(&_profMux);
+  *out = _pathStats[path < CMDPROF_PATH_COUNT ? path : 0];
+  portEXIT_CRITICAL(&_profMux);
+}
+
+CmdProfWindow cmdProfWindow() {
+  portENTER_CRITICAL(&_profMux);
+  CmdProfWindow w = _window;
+  portEXIT_CRITICAL(&_profMux);
+  return w;
+}
+
+uint32_t cmdProfPercentileUs(const CmdProfStats& st, uint8_t pct) {
+  if (st.count == 0) return 0;
+  uint32_t target = (uint32_t)(((uint64_t)st.count * pct + 99) / 100);
+  uint32_t acc = 0;
+  uint32_t limit = CMDPROF_BUCKET0_US;
+  for (uint8_t b = 0; b < CMDPROF_BUCKETS; b++) {
+    acc += st.hist[b];
+    if (acc >= target) return (b == CMDPROF_BUCKETS - 1 || limit > st.maxUs) ? st.maxUs : limit;
+    limit <<= 1;
+  }
+  return st.maxUs;
+}
+
+const char* cmdProfPathName(CmdProfPath path) {
+  switch (path) {
+    case CMDPROF_PATH_WS:  return "ws";
+    case CMDPROF_PATH_UDP: return "udp";
+    default:               return "?";
+  }
+}
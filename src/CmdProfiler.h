@@ -0,0 +1,80 @@
+/*
+ * CmdProfiler.h
+ * RED808 perfil de la ruta de comandos: latencia por comando y por canal
+ * (WS/UDP), heap retenido y mínimos de heap durante una ventana de medida.
+ * Lo activa tools/loadtest.py vía /api/cmdprof; apagado no cuesta nada.
+ * Sin hardware, test/host/harness_commands.cpp mide lo mismo por comando.
+ */
+
+#ifndef CMD_PROFILER_H
+#define CMD_PROFILER_H
+
+#include <stdint.h>
+#include "CommandTable.h"
+
+// Histograma log2 de latencia: <32 µs, <64, ... <8 ms, >=8 ms
+#define CMDPROF_BUCKETS     10
+#define CMDPROF_BUCKET0_US  32
+
+// Canal completo (parse + admisión + dispatch + respuesta), aparte del
+// coste de cada comando en dispatchCommand
+enum CmdProfPath : uint8_t {
+  CMDPROF_PATH_WS = 0,     // frame de comando WS, JSON o 0xB1 (async_tcp)
+  CMDPROF_PATH_UDP,        // paquete UDP (systemTask)
+  CMDPROF_PATH_COUNT
+};
+
+struct CmdProfStats {
+  uint32_t count;
+  uint32_t totalUs;
+  uint32_t maxUs;
+  int32_t  heapMax;       // mayor caída de heap libre tras un comando (bytes retenidos)
+  uint32_t hist[CMDPROF_BUCKETS];
+};
+
+struct CmdProfWindow {
+  bool     enabled;
+  uint32_t startMs;
+  uint32_t minFreeHeap;   // mínimo de heap interno visto tras un comando
+  uint32_t minLargest;    // mínimo del bloque libre mayor (fragmentación)
+};
+
+// Arranque/parada de la ventana; reset borra todos los contadores
+void cmdProfEnable(bool on, bool reset);
+bool cmdProfEnabled();
+
+// Marca de inicio: 0 si el perfil está apagado (end no hace nada)
+struct CmdProfMark {
+  uint32_t us;
+  uint32_t heap;
+};
+CmdProfMark cmdProfBegin();
+void cmdProfEndCommand(const CmdProfMark& m, WsCmdId id);
+void cmdProfEndPath(const CmdProfMark& m, CmdProfPath path);
+
+// RAII para funciones con muchos return (dispatchCommand, handleUdp)
+class CmdProfScope {
+public:
+  explicit CmdProfScope(WsCmdId id) : m_(cmdProfBegin()), id_(id), path_(CMDPROF_PATH_COUNT) {}
+  explicit CmdProfScope(CmdProfPath path) : m_(cmdProfBegin()), id_(WSC_NONE), path_(path) {}
+  ~CmdProfScope() {
+    if (path_ < CMDPROF_PATH_COUNT) cmdProfEndPath(m_, path_);
+    else cmdProfEndCommand(m_, id_);
+  }
+  CmdProfScope(const CmdProfScope&) = delete;
+  CmdProfScope& operator=(const CmdProfScope&) = delete;
+private:
+  CmdProfMark m_;
+  WsCmdId id_;
+  CmdProfPath path_;
+};
+
+// Copias consistentes para /api/cmdprof
+bool cmdProfCommand(WsCmdId id, CmdProfStats* out);   // false si count == 0
+void cmdProfPath(CmdProfPath path, CmdProfStats* out);
+CmdProfWindow cmdProfWindow();
+// Percentil aproximado (límite superior del bucket) a partir del histograma
+uint32_t cmdProfPercentileUs(const CmdProfStats& st, uint8_t pct);
+const char* cmdProfPathName(CmdProfPath path);
+
+#endif // CMD_PROFILER_H
@@ -0,0 +1,271 @@
+/*
+ * CommandTable.cpp
+ * RED808 tabla de comandos JSON — hash abierto con sondeo lineal
+ */
+
+#include "CommandTable.h"
+#include <string.h>
+
+#define RED808_CMD_INFO(id, name, flags) { name, id, (uint8_t)(flags) },
+static const WsCommandInfo kCommands[WSC_COUNT] = {
+  RED808_COMMAND_LIST(RED808_CMD_INFO)
+};
+#undef RED808_CMD_INFO
+
+// 512 slots para ~170 comandos → factor de carga < 0.35, sondas medias ~1.2
+static constexpr uint16_t kSlotCount = 512;
+static constexpr uint16_t kSlotMask = kSlotCount - 1;
+static constexpr uint16_t kSlotEmpty = 0xFFFF;
+static_assert(WSC_COUNT < kSlotCount / 2, "command table too full");
+
+static uint16_t cmdSlots[kSlotCount];
+static bool cmdTableReady = false;
+
+void commandTableInit() {
+  if (cmdTableReady) return;
+  for (uint16_t i = 0; i < kSlotCount; i++) cmdSlots[i] = kSlotEmpty;
+  for (uint16_t i = 0; i < WSC_COUNT; i++) {
+    uint16_t slot = commandHash(kCommands[i].name) & kSlotMask;
+    while (cmdSlots[slot] != kSlotEmpty) slot = (slot + 1) & kSlotMask;
+    cmdSlots[slot] = i;
+  }
+  cmdTableReady = true;
+}
+
+const WsCommandInfo* commandLookup(const char* name) {
+  if (!name || !*name) return nullptr;
+  if (!cmdTableReady) commandTableInit();
+  uint16_t slot = commandHash(name) & kSlotMask;
+  while (cmdSlots[slot] != kSlotEmpty) {
+    const WsCommandInfo& info = kCommands[cmdSlots[slot]];
+    if (strcmp(info.name, name) == 0) return &info;
+    slot = (slot + 1) & kSlotMask;
+  }
+  return nullptr;
+}
+
+const WsCommandInfo* commandById(WsCmdId id) {
+  return (id < WSC_COUNT) ? &kCommands[id] : nullptr;
+}
+
+const char* const kCommandAddressFieldNames[CMDA_FIELD_COUNT] = {
+  "track", "pad", "engine", "instrument", "paramId"
+};
+
+uint8_t commandAddressFields(WsCmdId id) {
+  switch (id) {
+    // Master FX / volúmenes globales: un solo destino
+    case WSC_SET_FILTER:
+    case WSC_SET_FILTER_CUTOFF:
+    case WSC_SET_FILTER_RESONANCE:
+    case WSC_SET_BIT_CRUSH:
+    case WSC_SET_DISTORTION:
+    case WSC_SET_SAMPLE_RATE:
+    case WSC_SET_DELAY_TIME:
+    case WSC_SET_DELAY_FEEDBACK:
+    case WSC_SET_DELAY_MIX:
+    case WSC_SET_PHASER_RATE:
+    case WSC_SET_PHASER_DEPTH:
+    case WSC_SET_PHASER_FEEDBACK:
+    case WSC_SET_FLANGER_RATE:
+    case WSC_SET_FLANGER_DEPTH:
+    case WSC_SET_FLANGER_FEEDBACK:
+    case WSC_SET_FLANGER_MIX:
+    case WSC_SET_COMPRESSOR_THRESHOLD:
+    case WSC_SET_COMPRESSOR_RATIO:
+    case WSC_SET_COMPRESSOR_ATTACK:
+    case WSC_SET_COMPRESSOR_RELEASE:
+    case WSC_SET_COMPRESSOR_MAKEUP_GAIN:
+    case WSC_SET_REVERB_FEEDBACK:
+    case WSC_SET_REVERB_LP_FREQ:
+    case WSC_SET_REVERB_MIX:
+    case WSC_SET_CHORUS_RATE:
+    case WSC_SET_CHORUS_DEPTH:
+    case WSC_SET_CHORUS_MIX:
+    case WSC_SET_TREMOLO_RATE:
+    case WSC_SET_TREMOLO_DEPTH:
+    case WSC_SET_WAVEFOLDER_GAIN:
+    case WSC_SET_AUTO_WAH_LEVEL:
+    case WSC_SET_AUTO_WAH_MIX:
+    case WSC_SET_STEREO_WIDTH:
+    case WSC_SET_EARLY_REF_MIX:
+    case WSC_SET_SEQUENCER_VOLUME:
+    case WSC_SET_LIVE_VOLUME:
+    case WSC_SET_VOLUME:
+    case WSC_SET_LIVE_PITCH:
+      return 0;
+
+    case WSC_SET_PAD_DISTORTION:
+    case WSC_SET_PAD_BIT_CRUSH:
+    case WSC_SET_PAD_FILTER:
+      return CMDA_PAD;
+
+    case WSC_SET_TRACK_DISTORTION:
+    case WSC_SET_TRACK_BIT_CRUSH:
+    case WSC_SET_TRACK_ECHO:
+    case WSC_SET_TRACK_FLANGER:
+    case WSC_SET_TRACK_COMPRESSOR:
+    case WSC_SET_TRACK_FILTER:
+    case WSC_SET_TRACK_VOLUME:
+    case WSC_SET_TRACK_REVERB_SEND:
+    case WSC_SET_TRACK_DELAY_SEND:
+    case WSC_SET_TRACK_CHORUS_SEND:
+    case WSC_SET_TRACK_PAN:
+    case WSC_SET_TRACK_PITCH:
+    case WSC_SET_TRACK_EQ_LOW:
+    case WSC_SET_TRACK_EQ_MID:
+    case WSC_SET_TRACK_EQ_HIGH:
+      return CMDA_TRACK;
+
+    // {"cmd":"synthParam","engine":0,"instrument":2,"paramId":1,"value":0.5}
+    case WSC_SYNTH_PARAM:
+      return CMDA_ENGINE | CMDA_INSTRUMENT | CMDA_PARAM_ID;
+    // {"cmd":"synth303Param","paramId":3,"value":0.7}
+    case WSC_SYNTH303_PARAM:
+      return CMDA_PARAM_ID;
+
+    default:
+      return CMDA_TRACK | CMDA_PAD;
+  }
+}
+
+const char* const kCommandRequiredFieldNames[CMDR_FIELD_COUNT] = {
+  "track", "pad", "step", "value", "active", "enabled", "velocity", "volume",
+  "amount", "engine", "index", "count", "type", "pitch", "quality", "loopType",
+  "family", "filename", "folder", "file", "kit"
+};
+
+uint32_t commandRequiredFields(WsCmdId id) {
+  switch (id) {
+    // Master FX / volúmenes globales: {"cmd":..., "value": x}
+    case WSC_TEMPO:
+    case WSC_SET_LED_MONO_MODE:
+    case WSC_SET_FILTER_CUTOFF:
+    case WSC_SET_FILTER_RESONANCE:
+    case WSC_SET_BIT_CRUSH:
+    case WSC_SET_DISTORTION:
+    case WSC_SET_DISTORTION_MODE:
+    case WSC_SET_SAMPLE_RATE:
+    case WSC_SET_DELAY_ACTIVE:
+    case WSC_SET_DELAY_TIME:
+    case WSC_SET_DELAY_FEEDBACK:
+    case WSC_SET_DELAY_MIX:
+    case WSC_SET_PHASER_ACTIVE:
+    case WSC_SET_PHASER_RATE:
+    case WSC_SET_PHASER_DEPTH:
+    case WSC_SET_PHASER_FEEDBACK:
+    case WSC_SET_FLANGER_ACTIVE:
+    case WSC_SET_FLANGER_RATE:
+    case WSC_SET_FLANGER_DEPTH:
+    case WSC_SET_FLANGER_FEEDBACK:
+    case WSC_SET_FLANGER_MIX:
+    case WSC_SET_COMPRESSOR_ACTIVE:
+    case WSC_SET_COMPRESSOR_THRESHOLD:
+    case WSC_SET_COMPRESSOR_RATIO:
+    case WSC_SET_COMPRESSOR_ATTACK:
+    case WSC_SET_COMPRESSOR_RELEASE:
+    case WSC_SET_COMPRESSOR_MAKEUP_GAIN:
+    case WSC_SET_REVERB_ACTIVE:
+    case WSC_SET_REVERB_FEEDBACK:
+    case WSC_SET_REVERB_LP_FREQ:
+    case WSC_SET_REVERB_MIX:
+    case WSC_SET_CHORUS_ACTIVE:
+    case WSC_SET_CHORUS_RATE:
+    case WSC_SET_CHORUS_DEPTH:
+    case WSC_SET_CHORUS_MIX:
+    case WSC_SET_TREMOLO_ACTIVE:
+    case WSC_SET_TREMOLO_RATE:
+    case WSC_SET_TREMOLO_DEPTH:
+    case WSC_SET_WAVEFOLDER_GAIN:
+    case WSC_SET_LIMITER_ACTIVE:
+    case WSC_SET_SEQUENCER_VOLUME:
+    case WSC_SET_LIVE_VOLUME:
+    case WSC_SET_VOLUME:
+    // "track" o "pad" opcionales (containsKey), el valor no
+    case WSC_SET_REVERSE:
+    case WSC_SET_PITCH_SHIFT:
+      return CMDR_VALUE;
+
+    // Por pista: {"track": t, "value": x}
+    case WSC_MUTE:
+    case WSC_SOLO:
+    case WSC_SET_TRACK_REVERB_SEND:
+    case WSC_SET_TRACK_DELAY_SEND:
+    case WSC_SET_TRACK_CHORUS_SEND:
+    case WSC_SET_TRACK_PAN:
+    case WSC_SET_TRACK_DSP_MUTE:
+    case WSC_SET_TRACK_SOLO:
+    case WSC_SET_TRACK_PITCH:
+    case WSC_SET_TRACK_EQ_LOW:
+    case WSC_SET_TRACK_EQ_MID:
+    case WSC_SET_TRACK_EQ_HIGH:
+    case WSC_SET_TRACK_BIT_CRUSH:
+      return CMDR_TRACK | CMDR_VALUE;
+
+    // Por pista, resto de parámetros opcionales
+    case WSC_TOGGLE_LOOP:
+    case WSC_PAUSE_LOOP:
+    case WSC_SET_TRACK_PHASER:
+    case WSC_SET_TRACK_TREMOLO:
+    case WSC_SET_TRACK_GATE:
+    case WSC_SET_TRACK_EQ:
+    case WSC_CLEAR_TRACK_FX:
+    case WSC_SET_TRACK_ECHO:
+    case WSC_SET_TRACK_FLANGER:
+    case WSC_SET_TRACK_COMPRESSOR:
+    case WSC_CLEAR_TRACK_LIVE_FX:
+    case WSC_SET_TRACK_FILTER:
+    case WSC_CLEAR_TRACK_FILTER:
+    case WSC_GET_TRACK_VOLUME:
+      return CMDR_TRACK;
+    case WSC_SET_LOOP_TYPE:         return CMDR_TRACK | CMDR_LOOP_TYPE;
+    case WSC_SET_TRACK_DISTORTION:  return CMDR_TRACK | CMDR_AMOUNT;
+    case WSC_SET_TRACK_VOLUME:      return CMDR_TRACK | CMDR_VOLUME;
+    case WSC_SET_TRACK_SYNTH_ENGINE: return CMDR_TRACK | CMDR_ENGINE;
+
+    // Por pad
+    case WSC_TRIGGER:
+    case WSC_TRIM_SAMPLE:
+    case WSC_CLEAR_PAD_FX:
+    case WSC_SET_PAD_FILTER:
+    case WSC_CLEAR_PAD_FILTER:
+      return CMDR_PAD;
+    case WSC_SET_PAD_BIT_CRUSH:     return CMDR_PAD | CMDR_VALUE;
+    case WSC_SET_PAD_DISTORTION:    return CMDR_PAD | CMDR_AMOUNT;
+
+    // Por step: {"track": t, "step": s, ...}
+    case WSC_GET_STEP_VELOCITY:
+    case WSC_SET_STEP_VOLUME_LOCK:
+    case WSC_SET_STEP_PROBABILITY:
+    case WSC_SET_STEP_CUTOFF_LOCK:
+    case WSC_SET_STEP_REVERB_SEND_LOCK:
+    case WSC_SET_STEP_RATCHET:
+    case WSC_SET_STEP_NOTE:
+    case WSC_GET_STEP_VOLUME_LOCK:
+    case WSC_GET_STEP_CUTOFF_LOCK:
+    case WSC_GET_STEP_REVERB_SEND_LOCK:
+      return CMDR_TRACK | CMDR_STEP;
+    case WSC_SET_STEP:              return CMDR_TRACK | CMDR_STEP | CMDR_ACTIVE;
+    case WSC_SET_STEP_VELOCITY:     return CMDR_TRACK | CMDR_STEP | CMDR_VELOCITY;
+
+    case WSC_SET_SONG_MODE:
+    case WSC_SET_MIDI_SCAN:
+      return CMDR_ENABLED;
+    case WSC_SET_STEP_COUNT:        return CMDR_COUNT;
+    case WSC_SELECT_PATTERN:        return CMDR_INDEX;
+    case WSC_SET_FILTER:            return CMDR_TYPE;
+    case WSC_SET_LIVE_PITCH:        return CMDR_PITCH;
+    case WSC_SET_RESAMPLE_QUALITY:  return CMDR_QUALITY;
+    case WSC_APPLY_KIT_TO_ALL_PADS: return CMDR_ENGINE;
+
+    // Samples (LittleFS / SD de la Daisy)
+    case WSC_LOAD_SAMPLE:           return CMDR_FAMILY | CMDR_FILENAME | CMDR_PAD;
+    case WSC_LOAD_XTRA_SAMPLE:      return CMDR_FILENAME | CMDR_PAD;
+    case WSC_SD_LOAD_KIT:           return CMDR_KIT;
+    case WSC_SD_LOAD_SAMPLE:        return CMDR_PAD | CMDR_FOLDER | CMDR_FILE;
+    case WSC_SD_LIST_FILES:         return CMDR_FOLDER;
+
+    default:
+      return 0;
+  }
+}
@@ -0,0 +1,284 @@
+/*
+ * CommandTable.h
+ * RED808 tabla de comandos JSON (WebSocket + UDP)
+ * Nombre de comando → id + flags, resuelto con hash FNV-1a en O(1)
+ */
+
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include <stdint.h>
+
+// ═══════════════════════════════════════════════════════
+// Command flags
+// ═══════════════════════════════════════════════════════
+#define CMDF_FAST_MASTER  0x01  // throttle master FX (kFastMasterCmdMinMs)
+#define CMDF_FAST_TRACK   0x02  // throttle por track (kFastTrackCmdMinMs)
+#define CMDF_FAST_PAD     0x04  // throttle pad FX (kFastPadCmdMinMs)
+#define CMDF_FAST_VOLUME  0x08  // throttle volúmenes (kFastVolumeCmdMinMs)
+#define CMDF_UDP_SYNC     0x10  // enviar state_sync al cliente UDP tras el comando
+#define CMDF_WS_ONLY      0x20  // respondido en onWebSocketEvent, no en processCommand()
+
+#define CMDF_FAST_MASK    (CMDF_FAST_MASTER | CMDF_FAST_TRACK | CMDF_FAST_PAD | CMDF_FAST_VOLUME)
+
+// ═══════════════════════════════════════════════════════
+// Command list — X(id, "name", flags)
+// Orden = orden histórico de la cadena if/else de processCommand().
+// Añadir un comando: una línea aquí + su case en processCommand() + sus
+// campos obligatorios en commandRequiredFields().
+// ═══════════════════════════════════════════════════════
+#define RED808_COMMAND_LIST(X) \
+  X(WSC_HELLO,                      "hello",                   CMDF_UDP_SYNC) \
+  X(WSC_GET_STATE_LEGACY,           "get_state",               CMDF_UDP_SYNC) \
+  X(WSC_GET_STATE,                  "getState",                CMDF_UDP_SYNC) \
+  X(WSC_TRIGGER,                    "trigger",                 0) \
+  X(WSC_SET_STEP,                   "setStep",                 0) \
+  X(WSC_START,                      "start",                   CMDF_UDP_SYNC) \
+  X(WSC_STOP,                       "stop",                    CMDF_UDP_SYNC) \
+  X(WSC_CLEAR_PATTERN,              "clearPattern",            0) \
+  X(WSC_CLEAR_PATTERNS,             "clearPatterns",           0) \
+  X(WSC_SET_SONG_MODE,              "setSongMode",             0) \
+  X(WSC_TEMPO,                      "tempo",                   CMDF_UDP_SYNC) \
+  X(WSC_SET_STEP_COUNT,             "setStepCount",            0) \
+  X(WSC_SELECT_PATTERN,             "selectPattern",           CMDF_UDP_SYNC) \
+  X(WSC_LOAD_SAMPLE,                "loadSample",              0) \
+  X(WSC_TRIM_SAMPLE,                "trimSample",              0) \
+  X(WSC_GET_XTRA_SAMPLES,           "getXtraSamples",          0) \
+  X(WSC_LOAD_XTRA_SAMPLE,           "loadXtraSample",          0) \
+  X(WSC_MUTE,                       "mute",                    CMDF_UDP_SYNC) \
+  X(WSC_SOLO,                       "solo",                    CMDF_UDP_SYNC) \
+  X(WSC_TOGGLE_LOOP,                "toggleLoop",              0) \
+  X(WSC_SET_LOOP_TYPE,              "setLoopType",             0) \
+  X(WSC_PAUSE_LOOP,                 "pauseLoop",               0) \
+  X(WSC_SET_LED_MONO_MODE,          "setLedMonoMode",          0) \
+  X(WSC_SET_FILTER,                 "setFilter",               CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_FILTER_CUTOFF,          "setFilterCutoff",         CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_FILTER_RESONANCE,       "setFilterResonance",      CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_BIT_CRUSH,              "setBitCrush",             CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_DISTORTION,             "setDistortion",           CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_DISTORTION_MODE,        "setDistortionMode",       0) \
+  X(WSC_SET_SAMPLE_RATE,            "setSampleRate",           CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_DELAY_ACTIVE,           "setDelayActive",          CMDF_UDP_SYNC) \
+  X(WSC_SET_DELAY_TIME,             "setDelayTime",            CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_DELAY_FEEDBACK,         "setDelayFeedback",        CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_DELAY_MIX,              "setDelayMix",             CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_PHASER_ACTIVE,          "setPhaserActive",         CMDF_UDP_SYNC) \
+  X(WSC_SET_PHASER_RATE,            "setPhaserRate",           CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_PHASER_DEPTH,           "setPhaserDepth",          CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_PHASER_FEEDBACK,        "setPhaserFeedback",       CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_FLANGER_ACTIVE,         "setFlangerActive",        CMDF_UDP_SYNC) \
+  X(WSC_SET_FLANGER_RATE,           "setFlangerRate",          CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_FLANGER_DEPTH,          "setFlangerDepth",         CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_FLANGER_FEEDBACK,       "setFlangerFeedback",      CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_FLANGER_MIX,            "setFlangerMix",           CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_COMPRESSOR_ACTIVE,      "setCompressorActive",     CMDF_UDP_SYNC) \
+  X(WSC_SET_COMPRESSOR_THRESHOLD,   "setCompressorThreshold",  CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_COMPRESSOR_RATIO,       "setCompressorRatio",      CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_COMPRESSOR_ATTACK,      "setCompressorAttack",     CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_COMPRESSOR_RELEASE,     "setCompressorRelease",    CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_COMPRESSOR_MAKEUP_GAIN, "setCompressorMakeupGain", CMDF_FAST_MASTER | CMDF_UDP_SYNC) \
+  X(WSC_SET_REVERB_ACTIVE,          "setReverbActive",         CMDF_UDP_SYNC) \
+  X(WSC_SET_REVERB_FEEDBACK,        "setReverbFeedback",       CMDF_UDP_SYNC) \
+  X(WSC_SET_REVERB_LP_FREQ,         "setReverbLpFreq",         CMDF_UDP_SYNC) \
+  X(WSC_SET_REVERB_MIX,             "setReverbMix",            CMDF_UDP_SYNC) \
+  X(WSC_SET_CHORUS_ACTIVE,          "setChorusActive",         CMDF_UDP_SYNC) \
+  X(WSC_SET_CHORUS_RATE,            "setChorusRate",           CMDF_UDP_SYNC) \
+  X(WSC_SET_CHORUS_DEPTH,           "setChorusDepth",          CMDF_UDP_SYNC) \
+  X(WSC_SET_CHORUS_MIX,             "setChorusMix",            CMDF_UDP_SYNC) \
+  X(WSC_SET_TREMOLO_ACTIVE,         "setTremoloActive",        0) \
+  X(WSC_SET_TREMOLO_RATE,           "setTremoloRate",          0) \
+  X(WSC_SET_TREMOLO_DEPTH,          "setTremoloDepth",         0) \
+  X(WSC_SET_WAVEFOLDER_GAIN,        "setWavefolderGain",       0) \
+  X(WSC_SET_LIMITER_ACTIVE,         "setLimiterActive",        0) \
+  X(WSC_SET_TRACK_REVERB_SEND,      "setTrackReverbSend",      CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_DELAY_SEND,       "setTrackDelaySend",       CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_CHORUS_SEND,      "setTrackChorusSend",      CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_PAN,              "setTrackPan",             CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_DSP_MUTE,         "setTrackDspMute",         CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_SOLO,             "setTrackSolo",            CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_PHASER,           "setTrackPhaser",          CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_TREMOLO,          "setTrackTremolo",         CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_PITCH,            "setTrackPitch",           CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_GATE,             "setTrackGate",            CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_EQ,               "setTrackEq",              CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_EQ_LOW,           "setTrackEqLow",           CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_EQ_MID,           "setTrackEqMid",           CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_EQ_HIGH,          "setTrackEqHigh",          CMDF_UDP_SYNC) \
+  X(WSC_SET_PAD_DISTORTION,         "setPadDistortion",        CMDF_FAST_PAD) \
+  X(WSC_SET_PAD_BIT_CRUSH,          "setPadBitCrush",          CMDF_FAST_PAD) \
+  X(WSC_CLEAR_PAD_FX,               "clearPadFX",              0) \
+  X(WSC_SET_TRACK_DISTORTION,       "setTrackDistortion",      CMDF_FAST_TRACK | CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_BIT_CRUSH,        "setTrackBitCrush",        CMDF_FAST_TRACK | CMDF_UDP_SYNC) \
+  X(WSC_CLEAR_TRACK_FX,             "clearTrackFX",            0) \
+  X(WSC_SET_REVERSE,                "setReverse",              0) \
+  X(WSC_SET_PITCH_SHIFT,            "setPitchShift",           0) \
+  X(WSC_SET_STUTTER,                "setStutter",              0) \
+  X(WSC_SET_TRACK_ECHO,             "setTrackEcho",            CMDF_FAST_TRACK | CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_FLANGER,          "setTrackFlanger",         CMDF_FAST_TRACK | CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_COMPRESSOR,       "setTrackCompressor",      CMDF_FAST_TRACK | CMDF_UDP_SYNC) \
+  X(WSC_SET_SIDECHAIN_PRO,          "setSidechainPro",         0) \
+  X(WSC_CLEAR_TRACK_LIVE_FX,        "clearTrackLiveFX",        0) \
+  X(WSC_SET_SEQUENCER_VOLUME,       "setSequencerVolume",      CMDF_FAST_VOLUME) \
+  X(WSC_SET_LIVE_VOLUME,            "setLiveVolume",           CMDF_FAST_VOLUME) \
+  X(WSC_SET_VOLUME,                 "setVolume",               CMDF_FAST_VOLUME) \
+  X(WSC_STOP_ALL_SOUNDS,            "stopAllSounds",           0) \
+  X(WSC_SET_LIVE_PITCH,             "setLivePitch",            CMDF_FAST_VOLUME) \
+  X(WSC_SET_TRACK_FILTER,           "setTrackFilter",          CMDF_FAST_TRACK | CMDF_UDP_SYNC) \
+  X(WSC_CLEAR_TRACK_FILTER,         "clearTrackFilter",        0) \
+  X(WSC_SET_PAD_FILTER,             "setPadFilter",            CMDF_FAST_PAD) \
+  X(WSC_CLEAR_PAD_FILTER,           "clearPadFilter",          0) \
+  X(WSC_GET_FILTER_PRESETS,         "getFilterPresets",        0) \
+  X(WSC_SET_STEP_VELOCITY,          "setStepVelocity",         0) \
+  X(WSC_GET_STEP_VELOCITY,          "getStepVelocity",         0) \
+  X(WSC_SET_STEP_VOLUME_LOCK,       "setStepVolumeLock",       0) \
+  X(WSC_SET_STEP_PROBABILITY,       "setStepProbability",      0) \
+  X(WSC_SET_STEP_CUTOFF_LOCK,       "setStepCutoffLock",       0) \
+  X(WSC_SET_STEP_REVERB_SEND_LOCK,  "setStepReverbSendLock",   0) \
+  X(WSC_SET_STEP_RATCHET,           "setStepRatchet",          0) \
+  X(WSC_SET_STEP_NOTE,              "setStepNote",             0) \
+  X(WSC_SET_HUMANIZE,               "setHumanize",             0) \
+  X(WSC_GET_STEP_VOLUME_LOCK,       "getStepVolumeLock",       0) \
+  X(WSC_GET_STEP_CUTOFF_LOCK,       "getStepCutoffLock",       0) \
+  X(WSC_GET_STEP_REVERB_SEND_LOCK,  "getStepReverbSendLock",   0) \
+  X(WSC_GET_PATTERN_SYNC,           "get_pattern",             0) \
+  X(WSC_SET_TRACK_VOLUME,           "setTrackVolume",          CMDF_FAST_VOLUME | CMDF_UDP_SYNC) \
+  X(WSC_GET_TRACK_VOLUME,           "getTrackVolume",          0) \
+  X(WSC_GET_TRACK_VOLUMES,          "getTrackVolumes",         CMDF_UDP_SYNC) \
+  X(WSC_SET_TRACK_SYNTH_ENGINE,     "setTrackSynthEngine",     CMDF_UDP_SYNC) \
+  X(WSC_APPLY_KIT_TO_ALL_PADS,      "applyKitToAllPads",       0) \
+  X(WSC_SET_MIDI_SCAN,              "setMidiScan",             0) \
+  X(WSC_SD_LIST_KITS,               "sdListKits",              0) \
+  X(WSC_SD_LOAD_KIT,                "sdLoadKit",               CMDF_UDP_SYNC) \
+  X(WSC_SD_UNLOAD_KIT,              "sdUnloadKit",             CMDF_UDP_SYNC) \
+  X(WSC_SD_LOAD_SAMPLE,             "sdLoadSample",            CMDF_UDP_SYNC) \
+  X(WSC_SD_LIST_FOLDERS,            "sdListFolders",           0) \
+  X(WSC_SD_LIST_FILES,              "sdListFiles",             0) \
+  X(WSC_SD_GET_STATUS,              "sdGetStatus",             CMDF_UDP_SYNC) \
+  X(WSC_SD_ABORT,                   "sdAbort",                 0) \
+  X(WSC_SET_DAISY_PERF_STRESS,      "setDaisyPerfStress",      0) \
+  X(WSC_SYNTH_TRIGGER,              "synthTrigger",            0) \
+  X(WSC_SYNTH_PARAM,                "synthParam",              0) \
+  X(WSC_SET_WT_NOTE,                "setWtNote",               0) \
+  X(WSC_SYNTH303_NOTE_ON,           "synth303NoteOn",          0) \
+  X(WSC_SYNTH_NOTE_ON_EX,           "synthNoteOnEx",           0) \
+  X(WSC_MELODY_REC_TOGGLE,          "melodyRecToggle",         0) \
+  X(WSC_MELODY_SET_ENGINE,          "melodySetEngine",         0) \
+  X(WSC_MELODY_SET_OCTAVE,          "melodySetOctave",         0) \
+  X(WSC_MELODY_SET_PAD,             "melodySetPad",            0) \
+  X(WSC_MELODY_REC_NOTE,            "melodyRecNote",           0) \
+  X(WSC_MELODY_ASSIGN,              "melodyAssign",            0) \
+  X(WSC_MELODY_CLEAR,               "melodyClear",             0) \
+  X(WSC_SYNTH303_NOTE_OFF,          "synth303NoteOff",         0) \
+  X(WSC_SYNTH_NOTE_OFF,             "synthNoteOff",            0) \
+  X(WSC_SYNTH303_PARAM,             "synth303Param",           0) \
+  X(WSC_SYNTH_ACTIVE,               "synthActive",             0) \
+  X(WSC_SYNTH_PRESET,               "synthPreset",             0) \
+  X(WSC_SET_MASTER_FX_ROUTE,        "setMasterFxRoute",        0) \
+  X(WSC_SET_AUTO_WAH_ACTIVE,        "setAutoWahActive",        0) \
+  X(WSC_SET_AUTO_WAH_LEVEL,         "setAutoWahLevel",         0) \
+  X(WSC_SET_AUTO_WAH_MIX,           "setAutoWahMix",           0) \
+  X(WSC_SET_STEREO_WIDTH,           "setStereoWidth",          0) \
+  X(WSC_SET_TAPE_STOP,              "setTapeStop",             0) \
+  X(WSC_SET_BEAT_REPEAT,            "setBeatRepeat",           0) \
+  X(WSC_SET_DELAY_STEREO,           "setDelayStereo",          CMDF_UDP_SYNC) \
+  X(WSC_SET_CHORUS_STEREO,          "setChorusStereo",         CMDF_UDP_SYNC) \
+  X(WSC_SET_EARLY_REF_ACTIVE,       "setEarlyRefActive",       0) \
+  X(WSC_SET_EARLY_REF_MIX,          "setEarlyRefMix",          0) \
+  X(WSC_SET_CHOKE_GROUP,            "setChokeGroup",           0) \
+  X(WSC_SONG_CHAIN_UPLOAD,          "songChainUpload",         0) \
+  X(WSC_SONG_CHAIN_CONTROL,         "songChainControl",        0) \
+  X(WSC_SONG_GET_POS,               "songGetPos",              0) \
+  X(WSC_SET_TRACK_LFO,              "setTrackLfo",             CMDF_UDP_SYNC) \
+  X(WSC_SET_RESAMPLE_QUALITY,       "setResampleQuality",      0) \
+  X(WSC_SET_SAMPLE_CACHE,           "setSampleCache",          0) \
+  X(WSC_GET_PATTERN,                "getPattern",              CMDF_WS_ONLY) \
+  X(WSC_INIT,                       "init",                    CMDF_WS_ONLY) \
+  X(WSC_GET_SAMPLE_COUNTS,          "getSampleCounts",         CMDF_WS_ONLY) \
+  X(WSC_GET_SAMPLES,                "getSamples",              CMDF_WS_ONLY) \
+  X(WSC_BATCH,                      "batch",                   CMDF_WS_ONLY) \
+  X(WSC_SUBSCRIBE,                  "subscribe",               CMDF_WS_ONLY)
+
+#define RED808_CMD_ENUM(id, name, flags) id,
+enum WsCmdId : uint16_t {
+  RED808_COMMAND_LIST(RED808_CMD_ENUM)
+  WSC_COUNT,
+  WSC_NONE = 0xFFFF
+};
+#undef RED808_CMD_ENUM
+
+struct WsCommandInfo {
+  const char* name;
+  WsCmdId     id;
+  uint8_t     flags;
+};
+
+// ═══════════════════════════════════════════════════════
+// Campos de dirección — qué knob toca un comando (no su valor)
+// ═══════════════════════════════════════════════════════
+// Dos mensajes del mismo comando con los mismos campos de dirección actúan
+// sobre el mismo destino: la coalescencia de PARAM (IngressLimiter) los funde.
+// Un comando con un campo nuevo de dirección debe declararlo en
+// commandAddressFields(); sin declaración se asume track + pad.
+#define CMDA_TRACK        0x01  // "track"
+#define CMDA_PAD          0x02  // "pad"
+#define CMDA_ENGINE       0x04  // "engine"
+#define CMDA_INSTRUMENT   0x08  // "instrument"
+#define CMDA_PARAM_ID     0x10  // "paramId"
+#define CMDA_FIELD_COUNT  5
+
+// Nombre JSON del campo i (bit 1 << i)
+extern const char* const kCommandAddressFieldNames[CMDA_FIELD_COUNT];
+
+// Máscara CMDA_* de los campos que direccionan el comando
+uint8_t commandAddressFields(WsCmdId id);
+
+// ═══════════════════════════════════════════════════════
+// Campos obligatorios — lo que el handler lee sin valor por defecto
+// ═══════════════════════════════════════════════════════
+// Un campo ausente se lee como 0/false/nullptr: "setTrackPan" sin "track"
+// movería la pista 0. admitCommand y applyBatch rechazan el comando si falta
+// alguno (NACK "args"); los opcionales (containsKey o "| defecto") no van aquí.
+#define CMDR_TRACK        (1u << 0)
+#define CMDR_PAD          (1u << 1)
+#define CMDR_STEP         (1u << 2)
+#define CMDR_VALUE        (1u << 3)
+#define CMDR_ACTIVE       (1u << 4)
+#define CMDR_ENABLED      (1u << 5)
+#define CMDR_VELOCITY     (1u << 6)
+#define CMDR_VOLUME       (1u << 7)
+#define CMDR_AMOUNT       (1u << 8)
+#define CMDR_ENGINE       (1u << 9)
+#define CMDR_INDEX        (1u << 10)
+#define CMDR_COUNT        (1u << 11)
+#define CMDR_TYPE         (1u << 12)
+#define CMDR_PITCH        (1u << 13)
+#define CMDR_QUALITY      (1u << 14)
+#define CMDR_LOOP_TYPE    (1u << 15)
+#define CMDR_FAMILY       (1u << 16)
+#define CMDR_FILENAME     (1u << 17)
+#define CMDR_FOLDER       (1u << 18)
+#define CMDR_FILE         (1u << 19)
+#define CMDR_KIT          (1u << 20)
+#define CMDR_FIELD_COUNT  21
+
+// Nombre JSON del campo i (bit 1 << i)
+extern const char* const kCommandRequiredFieldNames[CMDR_FIELD_COUNT];
+
+// Máscara CMDR_* de los campos sin los que el comando no se ejecuta
+uint32_t commandRequiredFields(WsCmdId id);
+
+// Construye la tabla hash (llamar una vez en begin(), antes de aceptar tráfico).
+void commandTableInit();
+
+// Devuelve nullptr si el comando no existe. name puede ser nullptr.
+const WsCommandInfo* commandLookup(const char* name);
+
+// Acceso directo por id (protocolo binario). nullptr si id fuera de rango.
+const WsCommandInfo* commandById(WsCmdId id);
+
+// FNV-1a 32-bit — constexpr para poder hashear literales en compilación
+constexpr uint32_t commandHash(const char* s, uint32_t h = 2166136261u) {
+  return (*s == 0) ? h : commandHash(s + 1, (h ^ (uint8_t)*s) * 16777619u);
+}
+
+#endif // COMMAND_TABLE_H
@@ -0,0 +1,249 @@
+/*
+ * HeapProfiler.cpp
+ * RED808 trazador de asignaciones por sitio (ver HeapProfiler.h)
+ */
+
+#include "HeapProfiler.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <esp_idf_version.h>
+static portMUX_TYPE _hpMux = portMUX_INITIALIZER_UNLOCKED;
+#define HP_LOCK()   portENTER_CRITICAL(&_hpMux)
+#define HP_UNLOCK() portEXIT_CRITICAL(&_hpMux)
+static inline void* rawAlloc(size_t n, uint8_t heap) {
+  return heap == HP_HEAP_PSRAM ? heap_caps_malloc(n, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : malloc(n);
+}
+static inline void* rawRealloc(void* p, size_t n, uint8_t heap) {
+  return heap == HP_HEAP_PSRAM ? heap_caps_realloc(p, n, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : realloc(p, n);
+}
+#else
+// Host: mismo código con malloc() para ambos heaps (tests de fugas fuera del ESP32)
+#include <mutex>
+static std::mutex _hpMutex;
+#define HP_LOCK()   _hpMutex.lock()
+#define HP_UNLOCK() _hpMutex.unlock()
+static inline void* rawAlloc(size_t n, uint8_t) { return malloc(n); }
+static inline void* rawRealloc(void* p, size_t n, uint8_t) { return realloc(p, n); }
+#endif
+
+#if RED808_HEAP_PROFILE
+
+// Cabecera delante de cada bloque trazado; 16 B mantiene la alineación de malloc
+struct HpHeader {
+  uint32_t magic;
+  uint32_t size;
+  uint16_t site;
+  uint8_t  heap;
+  uint8_t  pad[5];
+};
+static_assert(sizeof(HpHeader) == 16, "HpHeader must keep 16-byte alignment");
+static constexpr uint32_t kHpMagic = 0x48505246;   // "HPRF"
+static constexpr uint16_t kHpNoSite = 0xFFFF;
+
+static HeapSiteStats _hpSites[HP_MAX_SITES];
+static uint8_t _hpSiteCount = 0;
+static uint32_t _hpUntracked = 0;
+
+// Llamar con HP_LOCK: busca o crea el sitio (tag tiene prioridad sobre caller)
+static uint16_t hpSiteFor(const char* tag, uintptr_t caller, uint8_t heap) {
+  for (uint8_t i = 0; i < _hpSiteCount; i++) {
+    HeapSiteStats& s = _hpSites[i];
+    if (s.heap != heap) continue;
+    if (tag ? (s.tag == tag) : (s.tag == nullptr && s.caller == caller)) return i;
+  }
+  if (_hpSiteCount >= HP_MAX_SITES) {
+    _hpUntracked++;
+    return kHpNoSite;
+  }
+  HeapSiteStats& s = _hpSites[_hpSiteCount];
+  memset(&s, 0, sizeof(s));
+  s.tag = tag;
+  s.caller = tag ? 0 : caller;
+  s.heap = heap;
+  return _hpSiteCount++;
+}
+
+static void* hpTrack(void* raw, size_t size, uint8_t heap, const char* tag, uintptr_t caller) {
+  HP_LOCK();
+  uint16_t site = hpSiteFor(tag, caller, heap);
+  if (site != kHpNoSite) {
+    HeapSiteStats& s = _hpSites[site];
+    if (!raw) {
+      s.failed++;
+    } else {
+      s.allocs++;
+      s.liveBytes += size;
+      if (s.liveBytes > s.peakBytes) s.peakBytes = s.liveBytes;
+    }
+  }
+  HP_UNLOCK();
+  if (!raw) return nullptr;
+  HpHeader* h = (HpHeader*)raw;
+  h->magic = kHpMagic;
+  h->size = (uint32_t)size;
+  h->site = site;
+  h->heap = heap;
+  return h + 1;
+}
+
+static void hpUntrack(HpHeader* h) {
+  HP_LOCK();
+  if (h->site != kHpNoSite && h->site < _hpSiteCount) {
+    HeapSiteStats& s = _hpSites[h->site];
+    s.frees++;
+    s.liveBytes -= (h->size <= s.liveBytes) ? h->size : s.liveBytes;
+  }
+  HP_UNLOCK();
+  h->magic = 0;
+}
+
+// size + cabecera sin desbordar: un tamaño absurdo cuenta como fallo, no como
+// un bloque de 15 B donde se escribiría la cabecera entera
+static inline void* rawAllocTracked(size_t size, uint8_t heap) {
+  if (size > SIZE_MAX - sizeof(HpHeader)) return nullptr;
+  return rawAlloc(size + sizeof(HpHeader), heap);
+}
+
+__attribute__((noinline)) void* hpAlloc(size_t size, uint8_t heap, const char* tag) {
+  uintptr_t caller = (uintptr_t)__builtin_return_address(0);
+  return hpTrack(rawAllocTracked(size, heap), size, heap, tag, caller);
+}
+
+__attribute__((noinline)) void* hpCalloc(size_t count, size_t size, uint8_t heap, const char* tag) {
+  uintptr_t caller = (uintptr_t)__builtin_return_address(0);
+  size_t total = count * size;
+  if (size && total / size != count) return nullptr;
+  void* raw = rawAllocTracked(total, heap);
+  if (raw) memset((uint8_t*)raw + sizeof(HpHeader), 0, total);
+  return hpTrack(raw, total, heap, tag, caller);
+}
+
+__attribute__((noinline)) void* hpRealloc(void* ptr, size_t size, uint8_t heap, const char* tag) {
+  uintptr_t caller = (uintptr_t)__builtin_return_address(0);
+  if (!ptr) return hpTrack(rawAllocTracked(size, heap), size, heap, tag, caller);
+  HpHeader* h = (HpHeader*)ptr - 1;
+  if (h->magic != kHpMagic) return rawRealloc(ptr, size, heap);   // bloque no trazado
+  if (size > SIZE_MAX - sizeof(HpHeader)) return nullptr;
+  HpHeader old = *h;
+  void* raw = rawRealloc(h, size + sizeof(HpHeader), old.heap);
+  if (!raw) return nullptr;   // el bloque original sigue vivo y contado
+  hpUntrack(&old);
+  return hpTrack(raw, size, old.heap, tag, caller);
+}
+
+void hpFree(void* ptr) {
+  if (!ptr) return;
+  HpHeader* h = (HpHeader*)ptr - 1;
+  if (h->magic != kHpMagic) {
+    free(ptr);   // asignado fuera de los wrappers
+    return;
+  }
+  hpUntrack(h);
+  free(h);
+}
+
+bool heapProfEnabled() { return true; }
+
+uint8_t heapProfSiteCount() {
+  return _hpSiteCount;
+}
+
+bool heapProfSite(uint8_t idx, HeapSiteStats* out) {
+  if (idx >= _hpSiteCount || !out) return false;
+  HP_LOCK();
+  *out = _hpSites[idx];
+  HP_UNLOCK();
+  return true;
+}
+
+uint32_t heapProfUntracked() { return _hpUntracked; }
+
+#else  // !RED808_HEAP_PROFILE — llamadas directas, coste cero
+
+void* hpAlloc(size_t size, uint8_t heap, const char*) { return rawAlloc(size, heap); }
+
+void* hpCalloc(size_t count, size_t size, uint8_t heap, const char*) {
+  size_t total = count * size;
+  if (size && total / size != count) return nullptr;
+  void* p = rawAlloc(total, heap);
+  if (p) memset(p, 0, total);
+  return p;
+}
+
+void* hpRealloc(void* ptr, size_t size, uint8_t heap, const char*) { return rawRealloc(ptr, size, heap); }
+void hpFree(void* ptr) { free(ptr); }
+bool heapProfEnabled() { return false; }
+uint8_t heapProfSiteCount() { return 0; }
+bool heapProfSite(uint8_t, HeapSiteStats*) { return false; }
+uint32_t heapProfUntracked() { return 0; }
+
+#endif // RED808_HEAP_PROFILE
+
+// ── Histograma de bloques libres ─────────────────────────────────────────────
+
+uint8_t heapProfBin(uint32_t size) {
+  uint8_t bin = 0;
+  uint32_t limit = 64;
+  while (bin < HP_HIST_BINS - 1 && size >= limit) {
+    bin++;
+    limit <<= 2;
+  }
+  return bin;
+}
+
+const char* heapProfBinLabel(uint8_t bin) {
+  static const char* const kLabels[HP_HIST_BINS] = {
+    "<64", "<256", "<1K", "<4K", "<16K", "<64K", "<256K", ">=256K"
+  };
+  return bin < HP_HIST_BINS ? kLabels[bin] : "?";
+}
+
+void heapProfHistAdd(HeapFreeInfo* info, uint32_t blockSize) {
+  info->hist[heapProfBin(blockSize)]++;
+}
+
+uint8_t heapProfFragPct(const HeapFreeInfo& info) {
+  if (!info.totalFree) return 0;
+  uint32_t largest = info.largestFree < info.totalFree ? info.largestFree : info.totalFree;
+  return (uint8_t)(100 - (uint64_t)largest * 100 / info.totalFree);
+}
+
+#define HP_CAN_WALK 0
+#ifdef ARDUINO
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+#undef HP_CAN_WALK
+#define HP_CAN_WALK 1
+// Callback de heap_caps_walk: corre con el heap bloqueado, no puede asignar
+static bool hpWalkFree(walker_heap_into_t, walker_block_info_t block, void* user) {
+  HeapFreeInfo* info = (HeapFreeInfo*)user;
+  if (!block.used) heapProfHistAdd(info, (uint32_t)block.size);
+  return true;
+}
+#endif
+#endif
+
+bool heapProfFreeInfo(uint8_t heap, HeapFreeInfo* out) {
+  if (!out || heap >= HP_HEAP_COUNT) return false;
+  memset(out, 0, sizeof(*out));
+#ifdef ARDUINO
+  uint32_t caps = (heap == HP_HEAP_PSRAM) ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+                                          : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  multi_heap_info_t mi;
+  heap_caps_get_info(&mi, caps);
+  out->totalFree = mi.total_free_bytes;
+  out->largestFree = mi.largest_free_block;
+  out->minEverFree = mi.minimum_free_bytes;
+  out->freeBlocks = mi.free_blocks;
+#if HP_CAN_WALK
+  heap_caps_walk(caps, hpWalkFree, out);
+  out->histValid = true;
+#endif
+  return true;
+#else
+  return false;   // host: sin heap propio que recorrer
+#endif
+}
@@ -0,0 +1,83 @@
+/*
+ * HeapProfiler.h
+ * RED808 trazador opcional de asignaciones por sitio + histograma de bloques
+ * libres (RAM interna / PSRAM) para /api/heapprof.
+ */
+
+#ifndef HEAP_PROFILER_H
+#define HEAP_PROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// -DRED808_HEAP_PROFILE=1 activa el trazado por sitio (cabecera de 16 B por
+// bloque + tabla de sitios). Con 0 los wrappers son llamadas directas al
+// allocator y sólo quedan el histograma y las estadísticas de heap_caps.
+#ifndef RED808_HEAP_PROFILE
+#define RED808_HEAP_PROFILE 0
+#endif
+
+// ═══════════════════════════════════════════════════════
+// WRAPPERS DE ASIGNACIÓN
+// ═══════════════════════════════════════════════════════
+// Usar en las rutas propias que asignan en caliente (slab fallback, samples,
+// waveform, uploads). tag = literal estático ("slab.fallback"); nullptr →
+// se usa la dirección de retorno como sitio. En host (sin ARDUINO) ambos
+// heaps son malloc(), así fugas y patrones de fragmentación se reproducen
+// fuera del ESP32 con los mismos wrappers.
+#define HP_HEAP_DEFAULT  0   // malloc(): interna salvo bloques grandes (CONFIG_SPIRAM_USE_MALLOC)
+#define HP_HEAP_PSRAM    1   // ps_malloc()
+#define HP_HEAP_COUNT    2
+
+void* hpAlloc(size_t size, uint8_t heap, const char* tag);
+void* hpCalloc(size_t count, size_t size, uint8_t heap, const char* tag);
+void* hpRealloc(void* ptr, size_t size, uint8_t heap, const char* tag);
+void  hpFree(void* ptr);
+
+// ═══════════════════════════════════════════════════════
+// SITIOS
+// ═══════════════════════════════════════════════════════
+#define HP_MAX_SITES 32
+
+struct HeapSiteStats {
+  const char* tag;      // nullptr si el sitio es una dirección de retorno
+  uintptr_t   caller;   // dirección de retorno (sitios sin tag)
+  uint8_t     heap;
+  uint32_t    allocs;
+  uint32_t    frees;
+  uint32_t    liveBytes;
+  uint32_t    peakBytes;
+  uint32_t    failed;   // asignaciones que devolvieron nullptr
+};
+
+bool heapProfEnabled();
+uint8_t heapProfSiteCount();
+bool heapProfSite(uint8_t idx, HeapSiteStats* out);   // copia consistente
+uint32_t heapProfUntracked();  // sitios que no cupieron en la tabla
+
+// ═══════════════════════════════════════════════════════
+// HISTOGRAMA DE BLOQUES LIBRES
+// ═══════════════════════════════════════════════════════
+// Bins por potencia de 4: <64, <256, <1K, <4K, <16K, <64K, <256K, >=256K
+#define HP_HIST_BINS 8
+
+struct HeapFreeInfo {
+  uint32_t totalFree;
+  uint32_t largestFree;
+  uint32_t minEverFree;
+  uint32_t freeBlocks;
+  uint32_t hist[HP_HIST_BINS];   // nº de bloques libres por bin
+  bool     histValid;            // false si la plataforma no permite recorrer el heap
+};
+
+// heap: HP_HEAP_DEFAULT → RAM interna (MALLOC_CAP_INTERNAL), HP_HEAP_PSRAM → PSRAM
+bool heapProfFreeInfo(uint8_t heap, HeapFreeInfo* out);
+uint8_t heapProfBin(uint32_t size);
+const char* heapProfBinLabel(uint8_t bin);
+// Cuenta un bloque libre en el histograma (walker del heap; en host, el
+// recorrido de un arena simulado en los tests)
+void heapProfHistAdd(HeapFreeInfo* info, uint32_t blockSize);
+// % del libre que no está en el bloque mayor: 0 = nada fragmentado
+uint8_t heapProfFragPct(const HeapFreeInfo& info);
+
+#endif // HEAP_PROFILER_H
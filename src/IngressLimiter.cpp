@@ -0,0 +1,256 @@
+/*
+ * IngressLimiter.cpp
+ * RED808 token buckets de entrada y coalescencia de PARAM (ver IngressLimiter.h)
+ */
+
+#include "IngressLimiter.h"
+#include <Arduino.h>
+
+struct IngressBudget {
+  uint16_t perSec;   // tokens/s
+  uint16_t burst;    // capacidad del bucket
+};
+
+// Un dedo en 16 pads con roll ≈ 60 triggers/s; un knob de P4 a 100 Hz cabe en PARAM
+static constexpr IngressBudget kIngressBudgets[ING_CLASS_COUNT] = {
+  { 200, 64 },   // TRIGGER
+  { 100, 30 },   // PARAM
+  {  60, 40 },   // EDIT (paste de steps / randomize desde la UI en ráfaga)
+  {   4,  6 },   // HEAVY
+};
+
+static IngressStats _ingressStats = {};
+
+IngressClass ingressClassOf(const WsCommandInfo& info) {
+  if (info.flags & CMDF_FAST_MASK) return ING_PARAM;
+  switch (info.id) {
+    case WSC_TRIGGER:
+    case WSC_SYNTH_TRIGGER:
+    case WSC_SYNTH303_NOTE_ON:
+    case WSC_SYNTH303_NOTE_OFF:
+    case WSC_SYNTH_NOTE_ON_EX:
+    case WSC_SYNTH_NOTE_OFF:
+    case WSC_SET_WT_NOTE:
+    case WSC_MELODY_REC_NOTE:
+    case WSC_STOP_ALL_SOUNDS:
+      return ING_TRIGGER;
+
+    case WSC_SET_REVERB_FEEDBACK:
+    case WSC_SET_REVERB_LP_FREQ:
+    case WSC_SET_REVERB_MIX:
+    case WSC_SET_CHORUS_RATE:
+    case WSC_SET_CHORUS_DEPTH:
+    case WSC_SET_CHORUS_MIX:
+    case WSC_SET_TREMOLO_RATE:
+    case WSC_SET_TREMOLO_DEPTH:
+    case WSC_SET_WAVEFOLDER_GAIN:
+    case WSC_SET_TRACK_REVERB_SEND:
+    case WSC_SET_TRACK_DELAY_SEND:
+    case WSC_SET_TRACK_CHORUS_SEND:
+    case WSC_SET_TRACK_PAN:
+    case WSC_SET_TRACK_PITCH:
+    case WSC_SET_TRACK_EQ_LOW:
+    case WSC_SET_TRACK_EQ_MID:
+    case WSC_SET_TRACK_EQ_HIGH:
+    case WSC_SYNTH_PARAM:
+    case WSC_SYNTH303_PARAM:
+    case WSC_SET_AUTO_WAH_LEVEL:
+    case WSC_SET_AUTO_WAH_MIX:
+    case WSC_SET_STEREO_WIDTH:
+    case WSC_SET_EARLY_REF_MIX:
+      return ING_PARAM;
+
+    case WSC_HELLO:
+    case WSC_GET_STATE_LEGACY:
+    case WSC_GET_STATE:
+    case WSC_INIT:
+    case WSC_GET_PATTERN:
+    case WSC_GET_PATTERN_SYNC:
+    case WSC_GET_SAMPLES:
+    case WSC_GET_SAMPLE_COUNTS:
+    case WSC_GET_XTRA_SAMPLES:
+    case WSC_GET_FILTER_PRESETS:
+    case WSC_GET_TRACK_VOLUMES:
+    case WSC_LOAD_SAMPLE:
+    case WSC_LOAD_XTRA_SAMPLE:
+    case WSC_TRIM_SAMPLE:
+    case WSC_CLEAR_PATTERNS:
+    case WSC_APPLY_KIT_TO_ALL_PADS:
+    case WSC_SD_LIST_KITS:
+    case WSC_SD_LOAD_KIT:
+    case WSC_SD_UNLOAD_KIT:
+    case WSC_SD_LOAD_SAMPLE:
+    case WSC_SD_LIST_FOLDERS:
+    case WSC_SD_LIST_FILES:
+    case WSC_SONG_CHAIN_UPLOAD:
+    case WSC_BATCH:
+      return ING_HEAVY;
+
+    default:
+      return ING_EDIT;
+  }
+}
+
+const char* ingressClassName(IngressClass cls) {
+  switch (cls) {
+    case ING_TRIGGER: return "trigger";
+    case ING_PARAM:   return "param";
+    case ING_EDIT:    return "edit";
+    case ING_HEAVY:   return "heavy";
+    default:          return "?";
+  }
+}
+
+// ── Token bucket ─────────────────────────────────────────────────────────────
+// milli-tokens: 1 ms × perSec = perSec milli-tokens, sin floats ni divisiones
+
+void IngressLimiter::reset() {
+  for (int c = 0; c < ING_CLASS_COUNT; c++) {
+    milliTokens_[c] = (uint32_t)kIngressBudgets[c].burst * 1000;
+    limited_[c] = 0;
+  }
+  lastMs_ = 0;
+  primed_ = false;
+}
+
+bool IngressLimiter::allow(IngressClass cls, uint32_t nowMs) {
+  if (!primed_) {
+    lastMs_ = nowMs;
+    primed_ = true;
+  }
+  uint32_t elapsed = nowMs - lastMs_;
+  if (elapsed > 0) {
+    if (elapsed > 10000) elapsed = 10000;  // evita overflow tras silencios largos
+    for (int c = 0; c < ING_CLASS_COUNT; c++) {
+      uint32_t cap = (uint32_t)kIngressBudgets[c].burst * 1000;
+      uint32_t t = milliTokens_[c] + elapsed * kIngressBudgets[c].perSec;
+      milliTokens_[c] = (t > cap) ? cap : t;
+    }
+    lastMs_ = nowMs;
+  }
+  if (milliTokens_[cls] >= 1000) {
+    milliTokens_[cls] -= 1000;
+    return true;
+  }
+  limited_[cls]++;
+  _ingressStats.limited[cls]++;
+  return false;
+}
+
+uint32_t IngressLimiter::totalLimited() const {
+  uint32_t n = 0;
+  for (int c = 0; c < ING_CLASS_COUNT; c++) n += limited_[c];
+  return n;
+}
+
+// ── Coalescencia ─────────────────────────────────────────────────────────────
+
+struct CoalesceKey {
+  uint32_t owner;
+  uint16_t id;
+  int32_t addr[CMDA_FIELD_COUNT];   // INT32_MIN = no declarado / ausente
+};
+
+struct CoalesceSlot {
+  bool used;
+  uint32_t seq;       // orden de llegada (el más antiguo se aplica primero)
+  CoalesceKey key;
+  uint16_t len;
+  char json[INGRESS_COALESCE_JSON_MAX];
+};
+
+static CoalesceSlot* _coalesce = nullptr;   // PSRAM
+static uint32_t _coalesceSeq = 0;
+static portMUX_TYPE _coalesceMux = portMUX_INITIALIZER_UNLOCKED;
+
+void ingressLimiterInit() {
+  if (_coalesce) return;
+  _coalesce = (CoalesceSlot*)ps_calloc(INGRESS_COALESCE_SLOTS, sizeof(CoalesceSlot));
+}
+
+static void coalesceKey(CoalesceKey& key, uint32_t owner, const WsCommandInfo& info, const JsonDocument& doc) {
+  key.owner = owner;
+  key.id = info.id;
+  uint8_t fields = commandAddressFields(info.id);
+  for (int f = 0; f < CMDA_FIELD_COUNT; f++) {
+    key.addr[f] = (fields & (1u << f)) ? (int32_t)(doc[kCommandAddressFieldNames[f]] | INT32_MIN)
+                                       : INT32_MIN;
+  }
+}
+
+static bool coalesceKeyEqual(const CoalesceKey& a, const CoalesceKey& b) {
+  if (a.owner != b.owner || a.id != b.id) return false;
+  for (int f = 0; f < CMDA_FIELD_COUNT; f++) {
+    if (a.addr[f] != b.addr[f]) return false;
+  }
+  return true;
+}
+
+bool ingressCoalescePut(uint32_t owner, const WsCommandInfo& info, const JsonDocument& doc) {
+  if (!_coalesce) {
+    _ingressStats.coalesceOverflow++;
+    return false;
+  }
+
+  char buf[INGRESS_COALESCE_JSON_MAX];
+  if (measureJson(doc) >= sizeof(buf)) {
+    _ingressStats.coalesceOverflow++;
+    return false;
+  }
+  size_t len = serializeJson(doc, buf, sizeof(buf));
+  if (len == 0) {
+    _ingressStats.coalesceOverflow++;
+    return false;
+  }
+  CoalesceKey key;
+  coalesceKey(key, owner, info, doc);
+
+  bool stored = false;
+  portENTER_CRITICAL(&_coalesceMux);
+  int freeSlot = -1;
+  bool same = false;
+  for (int i = 0; i < INGRESS_COALESCE_SLOTS; i++) {
+    if (_coalesce[i].used && coalesceKeyEqual(_coalesce[i].key, key)) { freeSlot = i; same = true; break; }
+    if (freeSlot < 0 && !_coalesce[i].used) freeSlot = i;
+  }
+  if (freeSlot >= 0) {
+    CoalesceSlot& s = _coalesce[freeSlot];
+    if (!same) s.seq = ++_coalesceSeq;   // un valor nuevo conserva su turno
+    s.used = true;
+    s.key = key;
+    s.len = (uint16_t)len;
+    memcpy(s.json, buf, len);
+    stored = true;
+  }
+  portEXIT_CRITICAL(&_coalesceMux);
+
+  if (stored) _ingressStats.coalesced++;
+  else _ingressStats.coalesceOverflow++;
+  return stored;
+}
+
+size_t ingressCoalesceTake(char* out, size_t cap, WsCmdId* id) {
+  if (!_coalesce) return 0;
+  size_t len = 0;
+  portENTER_CRITICAL(&_coalesceMux);
+  int oldest = -1;
+  for (int i = 0; i < INGRESS_COALESCE_SLOTS; i++) {
+    if (!_coalesce[i].used) continue;
+    if (oldest < 0 || (int32_t)(_coalesce[i].seq - _coalesce[oldest].seq) < 0) oldest = i;
+  }
+  if (oldest >= 0 && _coalesce[oldest].len < cap) {
+    CoalesceSlot& s = _coalesce[oldest];
+    len = s.len;
+    memcpy(out, s.json, len);
+    out[len] = '\0';
+    *id = (WsCmdId)s.key.id;
+    s.used = false;
+  }
+  portEXIT_CRITICAL(&_coalesceMux);
+  if (len) _ingressStats.coalesceApplied++;
+  return len;
+}
+
+IngressStats& ingressStats() {
+  return _ingressStats;
+}
@@ -0,0 +1,88 @@
+/*
+ * IngressLimiter.h
+ * RED808 límite de entrada por cliente (WS / UDP): token bucket por clase de
+ * comando y coalescencia de parámetros continuos.
+ */
+
+#ifndef INGRESS_LIMITER_H
+#define INGRESS_LIMITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+#include "CommandTable.h"
+
+// ═══════════════════════════════════════════════════════
+// CLASES DE COMANDO
+// ═══════════════════════════════════════════════════════
+// TRIGGER  pads / notas: presupuesto alto, nunca se coalescen
+// PARAM    knobs y faders (CMDF_FAST_* y envíos/EQ/synth params): si se agota
+//          el bucket el último valor se guarda y se aplica en update()
+// EDIT     edición de steps, mute/solo, transporte...
+// HEAVY    respuestas grandes o trabajo en flash/SPI: getPattern, getSamples,
+//          setBulk, sdLoadKit, batch (un token por envelope, sea cual sea
+//          su contenido)...
+// Presupuestos en IngressLimiter.cpp (kIngressBudgets). Con 4 WS + 10 UDP el
+// peor caso de Core0 queda acotado a la suma de los ritmos, haga lo que haga
+// cada cliente.
+enum IngressClass : uint8_t {
+  ING_TRIGGER = 0,
+  ING_PARAM,
+  ING_EDIT,
+  ING_HEAVY,
+  ING_CLASS_COUNT
+};
+
+IngressClass ingressClassOf(const WsCommandInfo& info);
+
+// Resultado de admitir un mensaje
+enum IngressVerdict : uint8_t {
+  ING_ADMIT = 0,     // ejecutar ahora
+  ING_COALESCED,     // PARAM guardado: se aplica en el siguiente flush
+  ING_DROPPED,       // descartado (contado en limited)
+  ING_INVALID        // falta un campo obligatorio (commandRequiredFields): sin token
+};
+
+class IngressLimiter {
+public:
+  void reset();                                  // buckets llenos
+  bool allow(IngressClass cls, uint32_t nowMs);  // consume 1 token
+  uint32_t limited(IngressClass cls) const { return limited_[cls]; }
+  uint32_t totalLimited() const;
+
+private:
+  uint32_t milliTokens_[ING_CLASS_COUNT];
+  uint32_t lastMs_;
+  uint32_t limited_[ING_CLASS_COUNT];
+  bool primed_;
+};
+
+// ═══════════════════════════════════════════════════════
+// COALESCENCIA DE PARAM
+// ═══════════════════════════════════════════════════════
+// Clave = owner (clientId WS / IP UDP) + comando + todos sus campos de
+// dirección (commandAddressFields): el valor nuevo sobrescribe al pendiente.
+// La clave se guarda completa, no como hash, para que dos knobs distintos
+// nunca compartan slot. Tabla compartida en PSRAM protegida con
+// portMUX (escribe el task de AsyncWebServer o handleUdp, vacía update()).
+#define INGRESS_COALESCE_SLOTS    16
+#define INGRESS_COALESCE_JSON_MAX 200
+#define INGRESS_COALESCE_FLUSH_MS 20   // ritmo de aplicación de valores guardados
+#define INGRESS_COALESCE_PER_TICK 4    // slots aplicados por tick (≤ 200/s en total)
+
+// Reserva la tabla (llamar una vez en begin(), antes de aceptar tráfico)
+void ingressLimiterInit();
+bool ingressCoalescePut(uint32_t owner, const WsCommandInfo& info, const JsonDocument& doc);
+// Saca el slot más antiguo; devuelve longitud del JSON (0 = vacío)
+size_t ingressCoalesceTake(char* out, size_t cap, WsCmdId* id);
+
+struct IngressStats {
+  uint32_t limited[ING_CLASS_COUNT];  // mensajes rechazados por clase (todos los clientes)
+  uint32_t coalesced;                 // PARAM guardados en lugar de descartados
+  uint32_t coalesceApplied;
+  uint32_t coalesceOverflow;          // tabla llena o JSON demasiado grande
+};
+IngressStats& ingressStats();
+const char* ingressClassName(IngressClass cls);
+
+#endif // INGRESS_LIMITER_H
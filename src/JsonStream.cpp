@@ -0,0 +1,143 @@
+/*
+ * JsonStream.cpp
+ * RED808 writer JSON en streaming (ver JsonStream.h)
+ */
+
+#include "JsonStream.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+static constexpr uint8_t kMaxDepth = 31;
+
+JsonStreamWriter::JsonStreamWriter(char* buf, size_t cap)
+  : buf_(buf), cap_(buf ? cap : 0), pos_(0), firstMask_(1), depth_(0),
+    afterKey_(false), ok_(true) {}
+
+void JsonStreamWriter::put(const char* s, size_t n) {
+  if (!buf_) { pos_ += n; return; }   // modo conteo
+  if (!ok_ || pos_ + n > cap_) { ok_ = false; return; }
+  memcpy(buf_ + pos_, s, n);
+  pos_ += n;
+}
+
+void JsonStreamWriter::putChar(char c) {
+  if (!buf_) { pos_++; return; }
+  if (!ok_ || pos_ + 1 > cap_) { ok_ = false; return; }
+  buf_[pos_++] = c;
+}
+
+// Coma antes de cada elemento salvo el primero; tras una key no se escribe nada
+void JsonStreamWriter::separator() {
+  if (afterKey_) { afterKey_ = false; return; }
+  uint32_t bit = 1UL << depth_;
+  if (firstMask_ & bit) firstMask_ &= ~bit;
+  else putChar(',');
+}
+
+void JsonStreamWriter::putString(const char* s) {
+  putChar('"');
+  if (s) {
+    const char* run = s;
+    for (; *s; s++) {
+      unsigned char c = (unsigned char)*s;
+      if (c >= 0x20 && c != '"' && c != '\\') continue;
+      put(run, s - run);
+      run = s + 1;
+      char esc[8];
+      switch (c) {
+        case '"':  put("\\\"", 2); break;
+        case '\\': put("\\\\", 2); break;
+        case '\n': put("\\n", 2); break;
+        case '\r': put("\\r", 2); break;
+        case '\t': put("\\t", 2); break;
+        default:
+          snprintf(esc, sizeof(esc), "\\u%04x", c);
+          put(esc, 6);
+          break;
+      }
+    }
+    put(run, s - run);
+  }
+  putChar('"');
+}
+
+void JsonStreamWriter::open(char c) {
+  separator();
+  putChar(c);
+  if (depth_ >= kMaxDepth) { ok_ = false; return; }
+  depth_++;
+  firstMask_ |= (1UL << depth_);
+}
+
+void JsonStreamWriter::close(char c) {
+  if (depth_ == 0) { ok_ = false; return; }
+  firstMask_ &= ~(1UL << depth_);
+  depth_--;
+  putChar(c);
+}
+
+void JsonStreamWriter::beginObject() { open('{'); }
+void JsonStreamWriter::beginObject(const char* k) { key(k); open('{'); }
+void JsonStreamWriter::endObject() { close('}'); }
+void JsonStreamWriter::beginArray() { open('['); }
+void JsonStreamWriter::beginArray(const char* k) { key(k); open('['); }
+void JsonStreamWriter::endArray() { close(']'); }
+
+void JsonStreamWriter::key(const char* k) {
+  separator();
+  putString(k);
+  putChar(':');
+  afterKey_ = true;
+}
+
+void JsonStreamWriter::value(bool v) {
+  separator();
+  if (v) put("true", 4);
+  else put("false", 5);
+}
+
+void JsonStreamWriter::value(int v) { value((long)v); }
+void JsonStreamWriter::value(unsigned v) { value((unsigned long)v); }
+
+void JsonStreamWriter::value(long v) {
+  separator();
+  char tmp[24];
+  int n = snprintf(tmp, sizeof(tmp), "%ld", v);
+  put(tmp, (size_t)n);
+}
+
+void JsonStreamWriter::value(unsigned long v) {
+  separator();
+  char tmp[24];
+  int n = snprintf(tmp, sizeof(tmp), "%lu", v);
+  put(tmp, (size_t)n);
+}
+
+// Igual que ArduinoJson: NaN/Inf → null, enteros sin decimales
+void JsonStreamWriter::value(double v) {
+  separator();
+  if (isnan(v) || isinf(v)) { put("null", 4); return; }
+  char tmp[32];
+  int n = snprintf(tmp, sizeof(tmp), "%.7g", v);
+  put(tmp, (size_t)n);
+}
+
+void JsonStreamWriter::value(float v) { value((double)v); }
+
+void JsonStreamWriter::value(const char* v) {
+  separator();
+  putString(v ? v : "");
+}
+
+void JsonStreamWriter::rawMembers(const char* json, size_t len) {
+  if (!json || len == 0) return;
+  separator();
+  put(json, len);
+}
+
+void JsonStreamWriter::padToCapacity() {
+  if (!buf_ || !ok_) return;
+  if (pos_ < cap_) memset(buf_ + pos_, ' ', cap_ - pos_);
+  pos_ = cap_;
+}
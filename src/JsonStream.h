@@ -0,0 +1,74 @@
+/*
+ * JsonStream.h
+ * RED808 writer JSON en streaming (sin DOM) para respuestas grandes:
+ * estado completo, patrón JSON y state_sync/pattern_sync UDP.
+ */
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ═══════════════════════════════════════════════════════
+// JsonStreamWriter
+// ═══════════════════════════════════════════════════════
+// Escribe el JSON directamente en un buffer fijo (PSRAM o el buffer de un
+// AsyncWebSocketMessageBuffer). Con buf == nullptr sólo cuenta bytes, para
+// dimensionar el buffer de salida en una primera pasada.
+// Si no cabe, ok() == false y finish() devuelve 0: nunca se envía JSON truncado.
+// Sin heap: el único estado es el puntero, la profundidad y una máscara de comas.
+class JsonStreamWriter {
+public:
+  JsonStreamWriter(char* buf, size_t cap);
+
+  void beginObject();
+  void beginObject(const char* key);
+  void endObject();
+  void beginArray();
+  void beginArray(const char* key);
+  void endArray();
+
+  void key(const char* k);
+
+  void value(bool v);
+  void value(int v);
+  void value(unsigned v);
+  void value(long v);
+  void value(unsigned long v);
+  void value(float v);
+  void value(double v);
+  void value(const char* v);   // nullptr → ""
+
+  template <typename T>
+  void kv(const char* k, T v) { key(k); value(v); }
+
+  // Inserta miembros ya serializados ("a":1,"b":2) en el objeto actual (cache de secciones)
+  void rawMembers(const char* json, size_t len);
+
+  // Rellena con espacios hasta cap (JSON permite whitespace final): para
+  // buffers de tamaño exacto reservados con margen tras la pasada de conteo.
+  void padToCapacity();
+
+  size_t finish() const { return (ok_ && depth_ == 0) ? pos_ : 0; }
+  size_t length() const { return pos_; }
+  bool ok() const { return ok_; }
+
+private:
+  void separator();
+  void put(const char* s, size_t n);
+  void putChar(char c);
+  void putString(const char* s);
+  void open(char c);
+  void close(char c);
+
+  char* buf_;
+  size_t cap_;
+  size_t pos_;
+  uint32_t firstMask_;  // bit d = el siguiente elemento en profundidad d es el primero
+  uint8_t depth_;
+  bool afterKey_;
+  bool ok_;
+};
+
+#endif // JSON_STREAM_H
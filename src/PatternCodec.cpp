@@ -0,0 +1,244 @@
+/*
+ * PatternCodec.cpp
+ * RED808 codificación binaria de patrones (ver PatternCodec.h)
+ */
+
+#include "PatternCodec.h"
+#include "Sequencer.h"
+#include <string.h>
+
+typedef uint8_t (Sequencer::*StepGetter)(int pattern, int track, int step);
+
+// ── Writer acotado: todas las escrituras comprueban capacidad ──
+struct PatWriter {
+  uint8_t* out;
+  size_t cap;
+  size_t pos;
+  bool ok;
+
+  void u8(uint8_t v) {
+    if (pos + 1 > cap) { ok = false; return; }
+    out[pos++] = v;
+  }
+  void u16(uint16_t v) {
+    if (pos + 2 > cap) { ok = false; return; }
+    out[pos++] = v & 0xFF;
+    out[pos++] = v >> 8;
+  }
+  // Reserva cabecera de sección; devuelve offset del campo len
+  size_t beginSection(uint8_t id) {
+    u8(id);
+    size_t lenPos = pos;
+    u16(0);
+    return lenPos;
+  }
+  void endSection(size_t lenPos) {
+    if (!ok) return;
+    size_t len = pos - lenPos - 2;
+    out[lenPos] = len & 0xFF;
+    out[lenPos + 1] = len >> 8;
+  }
+};
+
+static void writeRle(PatWriter& w, Sequencer& seq, int pattern, int stepCount,
+                     uint8_t id, StepGetter get) {
+  size_t lenPos = w.beginSection(id);
+  uint8_t run = 0;
+  uint8_t cur = 0;
+  for (int t = 0; t < MAX_TRACKS && w.ok; t++) {
+    for (int s = 0; s < stepCount; s++) {
+      uint8_t v = (seq.*get)(pattern, t, s);
+      if (run > 0 && (v != cur || run == 255)) {
+        w.u8(run);
+        w.u8(cur);
+        run = 0;
+      }
+      cur = v;
+      run++;
+    }
+  }
+  if (run > 0) { w.u8(run); w.u8(cur); }
+  w.endSection(lenPos);
+}
+
+size_t patternEncode(Sequencer& seq, int pattern, int stepCount, uint8_t flags,
+                     uint8_t* out, size_t cap) {
+  if (!out || pattern < 0 || pattern >= MAX_PATTERNS) return 0;
+  if (stepCount < 1 || stepCount > STEPS_PER_PATTERN) stepCount = STEPS_PER_PATTERN;
+
+  PatWriter w = { out, cap, 0, true };
+  w.u8(PATTERN_BIN_MAGIC);
+  w.u8(PATTERN_BIN_VERSION);
+  w.u8((uint8_t)pattern);
+  w.u8((uint8_t)stepCount);
+  w.u8(flags);
+
+  for (int t = 0; t < MAX_TRACKS; t++) {
+    uint64_t mask = 0;
+    for (int s = 0; s < STEPS_PER_PATTERN; s++) {
+      if (seq.getStep(pattern, t, s)) mask |= (1ULL << s);
+    }
+    for (int b = 0; b < 8; b++) w.u8((uint8_t)(mask >> (b * 8)));
+  }
+
+  writeRle(w, seq, pattern, stepCount, PSEC_VELOCITY,
+           static_cast<StepGetter>(&Sequencer::getStepVelocity));
+  writeRle(w, seq, pattern, stepCount, PSEC_NOTE_LEN,
+           static_cast<StepGetter>(&Sequencer::getStepNoteLen));
+  writeRle(w, seq, pattern, stepCount, PSEC_PROBABILITY,
+           static_cast<StepGetter>(&Sequencer::getStepProbability));
+  writeRle(w, seq, pattern, stepCount, PSEC_RATCHET,
+           static_cast<StepGetter>(&Sequencer::getStepRatchet));
+  writeRle(w, seq, pattern, stepCount, PSEC_NOTE,
+           static_cast<StepGetter>(&Sequencer::getStepNote));
+  writeRle(w, seq, pattern, stepCount, PSEC_FLAGS,
+           static_cast<StepGetter>(&Sequencer::getStepFlags));
+
+  // ── Locks dispersos: sólo steps con lock activo ──
+  const uint8_t lockIds[3] = { PSEC_VOLUME_LOCK, PSEC_CUTOFF_LOCK, PSEC_REVERB_LOCK };
+  for (int k = 0; k < 3 && w.ok; k++) {
+    size_t lenPos = w.beginSection(lockIds[k]);
+    size_t countPos = w.pos;
+    w.u16(0);
+    uint16_t count = 0;
+    for (int t = 0; t < MAX_TRACKS; t++) {
+      for (int s = 0; s < stepCount; s++) {
+        if (k == 0 && seq.hasStepVolumeLock(pattern, t, s)) {
+          w.u8(t); w.u8(s); w.u8(seq.getStepVolumeLock(pattern, t, s));
+        } else if (k == 1 && seq.hasStepCutoffLock(pattern, t, s)) {
+          w.u8(t); w.u8(s); w.u16(seq.getStepCutoffLock(pattern, t, s));
+        } else if (k == 2 && seq.hasStepReverbSendLock(pattern, t, s)) {
+          w.u8(t); w.u8(s); w.u8(seq.getStepReverbSendLock(pattern, t, s));
+        } else {
+          continue;
+        }
+        count++;
+      }
+    }
+    if (w.ok) { out[countPos] = count & 0xFF; out[countPos + 1] = count >> 8; }
+    w.endSection(lenPos);
+  }
+
+  // ── Voces 1..3 (la voz 0 es stepNotes) ──
+  {
+    size_t lenPos = w.beginSection(PSEC_VOICES);
+    size_t countPos = w.pos;
+    w.u16(0);
+    uint16_t count = 0;
+    for (int t = 0; t < MAX_TRACKS; t++) {
+      for (int s = 0; s < stepCount; s++) {
+        uint8_t v1 = seq.getStepNoteVoice(pattern, t, s, 1);
+        uint8_t v2 = seq.getStepNoteVoice(pattern, t, s, 2);
+        uint8_t v3 = seq.getStepNoteVoice(pattern, t, s, 3);
+        if (!v1 && !v2 && !v3) continue;
+        w.u8(t); w.u8(s); w.u8(v1); w.u8(v2); w.u8(v3);
+        count++;
+      }
+    }
+    if (w.ok) { out[countPos] = count & 0xFF; out[countPos + 1] = count >> 8; }
+    w.endSection(lenPos);
+  }
+
+  return w.ok ? w.pos : 0;
+}
+
+// ── Decode ──
+
+static inline uint16_t rdU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+int patternDecodeApply(Sequencer& seq, const uint8_t* data, size_t len) {
+  if (!data || len < PATTERN_BIN_HEADER_SIZE) return -1;
+  if (data[0] != PATTERN_BIN_MAGIC || data[1] != PATTERN_BIN_VERSION) return -1;
+
+  int pattern = (data[2] == PATTERN_BIN_CURRENT) ? seq.getCurrentPattern() : data[2];
+  int stepCount = data[3];
+  if (pattern < 0 || pattern >= MAX_PATTERNS) return -1;
+  if (stepCount < 1 || stepCount > STEPS_PER_PATTERN) return -1;
+
+  // Mismo layout que el path JSON de setBulk (2 KB de stack)
+  bool stepsData[MAX_TRACKS][STEPS_PER_PATTERN];
+  uint8_t velsData[MAX_TRACKS][STEPS_PER_PATTERN];
+  memset(velsData, 127, sizeof(velsData));
+  const uint8_t* p = data + 5;
+  for (int t = 0; t < MAX_TRACKS; t++) {
+    uint64_t mask = 0;
+    for (int b = 0; b < 8; b++) mask |= (uint64_t)p[b] << (b * 8);
+    p += 8;
+    for (int s = 0; s < STEPS_PER_PATTERN; s++) stepsData[t][s] = (mask >> s) & 1ULL;
+  }
+
+  // Primera pasada: validar secciones y extraer velocity (necesaria para setPatternBulk)
+  const uint8_t* sec = data + PATTERN_BIN_HEADER_SIZE;
+  const uint8_t* end = data + len;
+  const int total = MAX_TRACKS * stepCount;
+  while (sec < end) {
+    if (end - sec < 3) return -1;
+    uint16_t secLen = rdU16(sec + 1);
+    if ((size_t)(end - sec - 3) < secLen) return -1;
+    if (sec[0] == PSEC_VELOCITY) {
+      int idx = 0;
+      for (uint16_t i = 0; i + 1 < secLen && idx < total; i += 2) {
+        uint8_t run = sec[3 + i];
+        uint8_t v = sec[3 + i + 1];
+        if (v == 0 || v > 127) v = 127;
+        for (uint8_t r = 0; r < run && idx < total; r++, idx++) {
+          velsData[idx / stepCount][idx % stepCount] = v;
+        }
+      }
+    }
+    sec += 3 + secLen;
+  }
+
+  seq.setPatternBulk(pattern, stepsData, velsData);
+
+  // Segunda pasada: secciones opcionales
+  sec = data + PATTERN_BIN_HEADER_SIZE;
+  while (sec < end) {
+    uint8_t id = sec[0];
+    uint16_t secLen = rdU16(sec + 1);
+    const uint8_t* pl = sec + 3;
+    sec += 3 + secLen;
+
+    if (id >= PSEC_NOTE_LEN && id <= PSEC_FLAGS) {
+      if (id == PSEC_NOTE) {
+        for (int t = 0; t < MAX_TRACKS; t++)
+          for (int s = 0; s < stepCount; s++) seq.clearStepNoteVoices(pattern, t, s);
+      }
+      int idx = 0;
+      for (uint16_t i = 0; i + 1 < secLen && idx < total; i += 2) {
+        uint8_t run = pl[i];
+        uint8_t v = pl[i + 1];
+        for (uint8_t r = 0; r < run && idx < total; r++, idx++) {
+          int t = idx / stepCount, s = idx % stepCount;
+          switch (id) {
+            case PSEC_NOTE_LEN:    seq.setStepNoteLen(pattern, t, s, v); break;
+            case PSEC_PROBABILITY: seq.setStepProbability(pattern, t, s, v); break;
+            case PSEC_RATCHET:     seq.setStepRatchet(pattern, t, s, v); break;
+            case PSEC_NOTE:        seq.setStepNote(pattern, t, s, v); break;
+            case PSEC_FLAGS:       seq.setStepFlags(pattern, t, s, v); break;
+          }
+        }
+      }
+    } else if (id >= PSEC_VOLUME_LOCK && id <= PSEC_VOICES && secLen >= 2) {
+      uint16_t count = rdU16(pl);
+      size_t entry = (id == PSEC_CUTOFF_LOCK) ? 4 : (id == PSEC_VOICES) ? 5 : 3;
+      if (2 + (size_t)count * entry > secLen) continue;
+      const uint8_t* e = pl + 2;
+      for (uint16_t i = 0; i < count; i++, e += entry) {
+        int t = e[0], s = e[1];
+        if (t >= MAX_TRACKS || s >= STEPS_PER_PATTERN) continue;
+        switch (id) {
+          case PSEC_VOLUME_LOCK: seq.setStepVolumeLock(pattern, t, s, true, e[2]); break;
+          case PSEC_CUTOFF_LOCK: seq.setStepCutoffLock(pattern, t, s, true, rdU16(e + 2)); break;
+          case PSEC_REVERB_LOCK: seq.setStepReverbSendLock(pattern, t, s, true, e[2]); break;
+          case PSEC_VOICES:
+            seq.setStepNoteVoice(pattern, t, s, 1, e[2]);
+            seq.setStepNoteVoice(pattern, t, s, 2, e[3]);
+            seq.setStepNoteVoice(pattern, t, s, 3, e[4]);
+            break;
+        }
+      }
+    }
+  }
+  return pattern;
+}
@@ -0,0 +1,63 @@
+/*
+ * PatternCodec.h
+ * RED808 formato binario compacto de patrón (WS getPattern/selectPattern/setBulk + UDP pattern_sync)
+ * El JSON sigue existiendo como fallback para clientes que no anuncian binProto >= 2.
+ */
+
+#ifndef PATTERN_CODEC_H
+#define PATTERN_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Sequencer;
+
+// ═══════════════════════════════════════════════════════
+// FRAME FORMAT (little-endian)
+// ═══════════════════════════════════════════════════════
+// [0]      0xB2 magic
+// [1]      versión (1)
+// [2]      pattern index (0xFF en upload = patrón actual)
+// [3]      stepCount (16..64)
+// [4]      flags (bit0 = patrón activo, hint para slaves UDP)
+// [5..132] 16 × uint64 step mask (bit s = step s activo)
+// [133..]  secciones: [id u8][len u16][payload]
+//
+// Secciones RLE — 16 tracks × stepCount valores, pares (run u8, valor u8):
+//   0x01 velocity  0x02 noteLen  0x03 probability  0x04 ratchet
+//   0x05 note      0x06 flags
+// Secciones dispersas — u16 count + entradas:
+//   0x10 volumeLock (track, step, u8)     0x11 cutoffLock (track, step, u16 Hz)
+//   0x12 reverbLock (track, step, u8)     0x13 voices 1..3 (track, step, 3 × u8)
+//
+// Un patrón típico ocupa < 1 KB; peor caso teórico ~29 KB (cabe en _patternBuf).
+// Mantener sincronizado con decodeBinaryPattern()/encodeBinaryPattern() en data/web/app.js.
+
+#define PATTERN_BIN_MAGIC        0xB2
+#define PATTERN_BIN_VERSION      1
+#define PATTERN_BIN_HEADER_SIZE  (5 + 16 * 8)
+#define PATTERN_BIN_CURRENT      0xFF
+#define PATTERN_BIN_FLAG_ACTIVE  0x01
+
+#define PSEC_VELOCITY     0x01
+#define PSEC_NOTE_LEN     0x02
+#define PSEC_PROBABILITY  0x03
+#define PSEC_RATCHET      0x04
+#define PSEC_NOTE         0x05
+#define PSEC_FLAGS        0x06
+#define PSEC_VOLUME_LOCK  0x10
+#define PSEC_CUTOFF_LOCK  0x11
+#define PSEC_REVERB_LOCK  0x12
+#define PSEC_VOICES       0x13
+
+// Serializa el patrón completo en out (sin heap). Devuelve bytes escritos o 0 si no cabe.
+size_t patternEncode(Sequencer& seq, int pattern, int stepCount, uint8_t flags,
+                     uint8_t* out, size_t cap);
+
+// Aplica un frame recibido (upload). Misma semántica que setBulk JSON:
+// steps + velocities siempre, probabilidad/ratchet/locks a defaults salvo que
+// venga su sección; noteLen/notes/flags/voices sólo si vienen.
+// Devuelve el índice de patrón escrito o -1 si el frame no es válido.
+int patternDecodeApply(Sequencer& seq, const uint8_t* data, size_t len);
+
+#endif // PATTERN_CODEC_H
@@ -0,0 +1,189 @@
+/*
+ * PcmConvert.cpp
+ * RED808 kernels de conversión PCM (ver PcmConvert.h)
+ *
+ * Con la fuente alineada a 4 bytes (staging de SampleManager, buffers
+ * ps_malloc) cada kernel lee palabras de 32 bits y desempaqueta varias
+ * muestras por lectura: 24-bit son 4 muestras cada 3 palabras, 8-bit 4 por
+ * palabra. Xtensa no admite lecturas desalineadas, así que los chunks HTTP
+ * de WavStream (alineación arbitraria) van por la ruta byte a byte.
+ */
+
+#include "PcmConvert.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WAV_FMT_PCM         1
+#define WAV_FMT_IEEE_FLOAT  3
+#define WAV_FMT_EXTENSIBLE  0xFFFE   // tratado como PCM entero
+
+bool pcmSpecFromWav(uint16_t audioFormat, uint16_t bits, uint16_t channels,
+                    PcmSpec* out, char* err, size_t errCap) {
+  if (audioFormat != WAV_FMT_PCM && audioFormat != WAV_FMT_EXTENSIBLE && audioFormat != WAV_FMT_IEEE_FLOAT) {
+    snprintf(err, errCap, "Unsupported format %u", audioFormat);
+    return false;
+  }
+  if (audioFormat == WAV_FMT_IEEE_FLOAT) {
+    if (bits != 32) {
+      snprintf(err, errCap, "Need 32-bit float, got %u-bit", bits);
+      return false;
+    }
+    out->format = PCM_F32;
+  } else if (bits == 8) {
+    out->format = PCM_U8;
+  } else if (bits == 16) {
+    out->format = PCM_S16;
+  } else if (bits == 24) {
+    out->format = PCM_S24;
+  } else {
+    snprintf(err, errCap, "Need 8/16/24-bit PCM, got %u-bit", bits);
+    return false;
+  }
+  if (channels < 1 || channels > 2) {
+    snprintf(err, errCap, "Bad channel count %u", channels);
+    return false;
+  }
+  out->channels = (uint8_t)channels;
+  out->frameBytes = (uint8_t)((bits / 8) * channels);
+  return true;
+}
+
+// ── Muestra a muestra ──
+
+static inline int16_t mix2(int32_t l, int32_t r) { return (int16_t)((l + r) / 2); }
+static inline int16_t rdS16(const uint8_t* p) { return (int16_t)(p[0] | (p[1] << 8)); }
+// 24-bit LE con signo >> 8 == los dos bytes altos
+static inline int16_t rdS24(const uint8_t* p) { return (int16_t)(p[1] | (p[2] << 8)); }
+static inline int16_t u8ToS16(uint32_t b) { return (int16_t)(((int32_t)(b & 0xFF) - 128) * 256); }
+
+static inline int16_t f32ToS16(float x) {
+  if (x != x) return 0;                 // NaN
+  if (x >= 1.0f) return 32767;
+  if (x <= -1.0f) return -32767;
+  return (int16_t)(x * 32767.0f + (x < 0.0f ? -0.5f : 0.5f));
+}
+
+static inline float rdF32(const uint8_t* p) {
+  float f;
+  memcpy(&f, p, 4);
+  return f;
+}
+
+// ── Kernels ──
+
+static void convS16Stereo(const uint8_t* src, int16_t* dst, size_t frames) {
+  size_t i = 0;
+  if (((uintptr_t)src & 3) == 0) {
+    const uint32_t* w = (const uint32_t*)src;
+    for (; i + 4 <= frames; i += 4) {
+      uint32_t a = w[i], b = w[i + 1], c = w[i + 2], d = w[i + 3];
+      dst[i]     = mix2((int16_t)a, (int16_t)(a >> 16));
+      dst[i + 1] = mix2((int16_t)b, (int16_t)(b >> 16));
+      dst[i + 2] = mix2((int16_t)c, (int16_t)(c >> 16));
+      dst[i + 3] = mix2((int16_t)d, (int16_t)(d >> 16));
+    }
+  }
+  for (; i < frames; i++) dst[i] = mix2(rdS16(src + i * 4), rdS16(src + i * 4 + 2));
+}
+
+// 3 palabras = 12 bytes = 4 muestras de 24 bit: s0 = bytes 1-2, s1 = 4-5,
+// s2 = 7-8 (cruza palabra), s3 = 10-11
+#define S24_UNPACK4(w, s0, s1, s2, s3)                       \
+  uint32_t a_ = (w)[0], b_ = (w)[1], c_ = (w)[2];            \
+  int16_t s0 = (int16_t)(a_ >> 8);                           \
+  int16_t s1 = (int16_t)b_;                                  \
+  int16_t s2 = (int16_t)((b_ >> 24) | (c_ << 8));            \
+  int16_t s3 = (int16_t)(c_ >> 16)
+
+static void convS24Mono(const uint8_t* src, int16_t* dst, size_t frames) {
+  size_t i = 0;
+  if (((uintptr_t)src & 3) == 0) {
+    const uint32_t* w = (const uint32_t*)src;
+    for (; i + 4 <= frames; i += 4, w += 3) {
+      S24_UNPACK4(w, s0, s1, s2, s3);
+      dst[i] = s0;
+      dst[i + 1] = s1;
+      dst[i + 2] = s2;
+      dst[i + 3] = s3;
+    }
+  }
+  for (; i < frames; i++) dst[i] = rdS24(src + i * 3);
+}
+
+static void convS24Stereo(const uint8_t* src, int16_t* dst, size_t frames) {
+  size_t i = 0;
+  if (((uintptr_t)src & 3) == 0) {
+    const uint32_t* w = (const uint32_t*)src;
+    for (; i + 2 <= frames; i += 2, w += 3) {
+      S24_UNPACK4(w, l0, r0, l1, r1);
+      dst[i] = mix2(l0, r0);
+      dst[i + 1] = mix2(l1, r1);
+    }
+  }
+  for (; i < frames; i++) dst[i] = mix2(rdS24(src + i * 6), rdS24(src + i * 6 + 3));
+}
+
+static void convU8(const uint8_t* src, int16_t* dst, size_t frames, uint8_t channels) {
+  size_t i = 0;
+  if (((uintptr_t)src & 3) == 0) {
+    const uint32_t* w = (const uint32_t*)src;
+    if (channels == 1) {
+      for (; i + 4 <= frames; i += 4, w++) {
+        uint32_t a = *w;
+        dst[i]     = u8ToS16(a);
+        dst[i + 1] = u8ToS16(a >> 8);
+        dst[i + 2] = u8ToS16(a >> 16);
+        dst[i + 3] = u8ToS16(a >> 24);
+      }
+    } else {
+      for (; i + 2 <= frames; i += 2, w++) {
+        uint32_t a = *w;
+        dst[i]     = mix2(u8ToS16(a), u8ToS16(a >> 8));
+        dst[i + 1] = mix2(u8ToS16(a >> 16), u8ToS16(a >> 24));
+      }
+    }
+  }
+  if (channels == 1) {
+    for (; i < frames; i++) dst[i] = u8ToS16(src[i]);
+  } else {
+    for (; i < frames; i++) dst[i] = mix2(u8ToS16(src[i * 2]), u8ToS16(src[i * 2 + 1]));
+  }
+}
+
+static void convF32(const uint8_t* src, int16_t* dst, size_t frames, uint8_t channels) {
+  if (((uintptr_t)src & 3) == 0) {
+    const float* f = (const float*)src;
+    if (channels == 1) {
+      for (size_t i = 0; i < frames; i++) dst[i] = f32ToS16(f[i]);
+    } else {
+      for (size_t i = 0; i < frames; i++) dst[i] = mix2(f32ToS16(f[i * 2]), f32ToS16(f[i * 2 + 1]));
+    }
+    return;
+  }
+  if (channels == 1) {
+    for (size_t i = 0; i < frames; i++) dst[i] = f32ToS16(rdF32(src + i * 4));
+  } else {
+    for (size_t i = 0; i < frames; i++) {
+      dst[i] = mix2(f32ToS16(rdF32(src + i * 8)), f32ToS16(rdF32(src + i * 8 + 4)));
+    }
+  }
+}
+
+void pcmConvert(const PcmSpec& spec, const uint8_t* src, int16_t* dst, size_t frames) {
+  switch (spec.format) {
+    case PCM_S16:
+      if (spec.channels == 1) memcpy(dst, src, frames * 2);  // little-endian: copia directa
+      else convS16Stereo(src, dst, frames);
+      break;
+    case PCM_S24:
+      if (spec.channels == 1) convS24Mono(src, dst, frames);
+      else convS24Stereo(src, dst, frames);
+      break;
+    case PCM_U8:
+      convU8(src, dst, frames, spec.channels);
+      break;
+    case PCM_F32:
+      convF32(src, dst, frames, spec.channels);
+      break;
+  }
+}
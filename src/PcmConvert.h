@@ -0,0 +1,41 @@
+/*
+ * PcmConvert.h
+ * RED808 conversión por bloques de PCM WAV → int16 mono (formato de la Daisy).
+ * u8, s16, s24 y float32; estéreo → mixdown (L+R)/2 truncando hacia cero.
+ * s16/s24 dan lo mismo bit a bit que la conversión frame a frame anterior,
+ * salvo s16 estéreo de parseWavFile, que hacía L/2 + R/2 (difiere en ±1 LSB
+ * en parte de los frames con algún canal impar). Ver test/host/test_pcm_convert.cpp.
+ */
+
+#ifndef PCM_CONVERT_H
+#define PCM_CONVERT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum PcmFormat : uint8_t {
+  PCM_U8 = 0,    // 8-bit sin signo (centro 128)
+  PCM_S16,
+  PCM_S24,       // se descartan los 8 bits bajos
+  PCM_F32        // IEEE float [-1, 1], ×32767 redondeado, saturado
+};
+
+struct PcmSpec {
+  PcmFormat format;
+  uint8_t channels;     // 1 o 2
+  uint8_t frameBytes;   // bytes por frame de entrada
+};
+
+// Staging de la lectura por bloques (RAM interna). Múltiplo de todos los
+// tamaños de frame (1, 2, 3, 4, 6, 8) → nunca queda un frame partido.
+#define PCM_STAGING_BYTES  12288
+
+// Campos del chunk "fmt " → spec. false + mensaje en err si no se soporta
+bool pcmSpecFromWav(uint16_t audioFormat, uint16_t bits, uint16_t channels,
+                    PcmSpec* out, char* err, size_t errCap);
+
+// Convierte `frames` frames completos. src sin requisito de alineación (con
+// src alineado a 4 los kernels leen palabras de 32 bits); dst alineado a 2
+void pcmConvert(const PcmSpec& spec, const uint8_t* src, int16_t* dst, size_t frames);
+
+#endif // PCM_CONVERT_H
@@ -0,0 +1,156 @@
+/*
+ * PcmStore.cpp
+ * RED808 almacén de PCM en flash (ver PcmStore.h)
+ */
+
+#include "PcmStore.h"
+#include "Resampler.h"     // RS_TARGET_RATE
+#include "SampleHash.h"
+#include "SampleIndex.h"
+#include "SysLog.h"
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_idf_version.h>
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#define PCM_MMAP_DATA       ESP_PARTITION_MMAP_DATA
+typedef esp_partition_mmap_handle_t PcmMmapHandle;
+#else
+#define PCM_MMAP_DATA       SPI_FLASH_MMAP_DATA
+typedef spi_flash_mmap_handle_t PcmMmapHandle;
+#endif
+
+struct __attribute__((packed)) PcmStoreHeader {
+  char     magic[4];
+  uint16_t version;
+  uint16_t entrySize;
+  uint32_t count;
+  uint32_t rate;
+  uint32_t imageBytes;
+  uint32_t indexHash;
+  uint32_t reserved[2];
+};
+static_assert(sizeof(PcmStoreHeader) == 32, "PcmStoreHeader: 32 bytes en flash");
+
+static const uint8_t* _map = nullptr;          // imagen mapeada (cabecera incluida)
+static const PcmStoreEntry* _entries = nullptr;
+static PcmMmapHandle _mapHandle;
+static PcmStoreStats _stats = {};
+
+static int compareKey(const PcmStoreEntry& e, const char* folder, const char* name) {
+  int c = strncmp(e.folder, folder, sizeof(e.folder));
+  return c ? c : strncmp(e.name, name, sizeof(e.name));
+}
+
+// Cabecera + índice coherentes con la partición; el PCM no se recorre (4 MB
+// leídos por caché de flash en cada boot costarían más que lo que ahorra)
+static bool validateImage(const PcmStoreHeader& h, uint32_t partSize) {
+  if (memcmp(h.magic, PCM_STORE_MAGIC, 4) != 0) return false;
+  if (h.version != PCM_STORE_VERSION || h.entrySize != sizeof(PcmStoreEntry)) {
+    syslog("PCM", "versión %u / registro %u no soportados", h.version, h.entrySize);
+    return false;
+  }
+  if (h.rate != RS_TARGET_RATE) {
+    syslog("PCM", "imagen a %u Hz, se esperaba %u", (unsigned)h.rate, (unsigned)RS_TARGET_RATE);
+    return false;
+  }
+  uint32_t indexEnd = sizeof(PcmStoreHeader) + h.count * sizeof(PcmStoreEntry);
+  return h.count > 0 && h.count <= PCM_STORE_MAX && h.imageBytes >= indexEnd && h.imageBytes <= partSize;
+}
+
+bool pcmStoreBegin() {
+  if (_stats.ready) return true;
+  const esp_partition_t* part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                         ESP_PARTITION_SUBTYPE_ANY, PCM_STORE_LABEL);
+  if (!part) return false;
+  _stats.partitionBytes = part->size;
+
+  PcmStoreHeader h;
+  if (esp_partition_read(part, 0, &h, sizeof(h)) != ESP_OK || !validateImage(h, part->size)) {
+    return false;   // partición sin flashear (0xFF) o imagen de otra versión
+  }
+
+  const void* ptr = nullptr;
+  if (esp_partition_mmap(part, 0, h.imageBytes, PCM_MMAP_DATA, &ptr, &_mapHandle) != ESP_OK) {
+    syslog("PCM", "mmap de %u bytes falló", (unsigned)h.imageBytes);
+    return false;
+  }
+  const uint8_t* map = (const uint8_t*)ptr;
+  const PcmStoreEntry* entries = (const PcmStoreEntry*)(map + sizeof(PcmStoreHeader));
+  uint32_t indexEnd = sizeof(PcmStoreHeader) + h.count * sizeof(PcmStoreEntry);
+
+  bool ok = xxh32(entries, h.count * sizeof(PcmStoreEntry), 0) == h.indexHash;
+  for (uint32_t i = 0; ok && i < h.count; i++) {
+    const PcmStoreEntry& e = entries[i];
+    ok = e.folder[sizeof(e.folder) - 1] == '\0' && e.name[sizeof(e.name) - 1] == '\0' &&
+         (e.offset & 3) == 0 && e.offset >= indexEnd && e.samples > 0 &&
+         (uint64_t)e.offset + (uint64_t)e.samples * sizeof(int16_t) <= h.imageBytes &&
+         (i == 0 || compareKey(entries[i - 1], e.folder, e.name) < 0);
+  }
+  if (!ok) {
+    syslog("PCM", "índice corrupto, se ignora la partición");
+    esp_partition_munmap(_mapHandle);
+    return false;
+  }
+
+  _map = map;
+  _entries = entries;
+  _stats.entries = h.count;
+  _stats.imageBytes = h.imageBytes;
+  _stats.ready = true;
+  return true;
+}
+
+bool pcmStoreReady() {
+  return _stats.ready;
+}
+
+const PcmStoreEntry* pcmStoreFind(const char* path) {
+  if (!_stats.ready || !path) return nullptr;
+  // "/carpeta/fichero": sólo un nivel, como la librería de LittleFS
+  if (*path == '/') path++;
+  const char* slash = strchr(path, '/');
+  if (!slash || strchr(slash + 1, '/')) return nullptr;
+  size_t folderLen = (size_t)(slash - path);
+  if (folderLen == 0 || folderLen >= sizeof(PcmStoreEntry::folder)) return nullptr;
+  char folder[sizeof(PcmStoreEntry::folder)];
+  memcpy(folder, path, folderLen);
+  folder[folderLen] = '\0';
+  const char* name = slash + 1;
+
+  uint32_t lo = 0, hi = _stats.entries;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    int c = compareKey(_entries[mid], folder, name);
+    if (c == 0) {
+      // El WAV pudo cambiar en LittleFS después de empaquetar: samples.idx
+      // de la misma build lleva el CRC del fichero (0 = registro del equipo)
+      sampleIndexLock(UINT32_MAX);
+      const SampleIndexEntry* ie = sampleIndexFind(folder, name);
+      bool fresh = ie && ie->size == _entries[mid].srcSize && ie->srcCrc != 0 &&
+                   ie->srcCrc == _entries[mid].srcCrc;
+      sampleIndexUnlock();
+      if (!fresh) {
+        _stats.stale++;
+        return nullptr;
+      }
+      return &_entries[mid];
+    }
+    if (c < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return nullptr;
+}
+
+const int16_t* pcmStoreSamples(const PcmStoreEntry* e) {
+  if (!_stats.ready || !e) return nullptr;
+  return (const int16_t*)(_map + e->offset);
+}
+
+bool pcmStoreContains(const void* p) {
+  return _stats.ready && (const uint8_t*)p >= _map && (const uint8_t*)p < _map + _stats.imageBytes;
+}
+
+const PcmStoreStats& pcmStoreStats() {
+  return _stats;
+}
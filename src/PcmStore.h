@@ -0,0 +1,66 @@
+/*
+ * PcmStore.h
+ * RED808 almacén de PCM ya convertido en la partición "pcmstore" de la flash:
+ * int16 mono a RS_TARGET_RATE, contiguo y con índice en cabecera. Lo genera
+ * tools/pack_pcmstore.py; el firmware lo mapea (esp_partition_mmap) y los pads
+ * apuntan directamente a la flash: sin abrir el WAV, sin parseo, sin conversión
+ * y sin copia a PSRAM antes del SPI.
+ */
+
+#ifndef PCM_STORE_H
+#define PCM_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ═══════════════════════════════════════════════════════
+// FORMATO DE LA PARTICIÓN (little-endian)
+// ═══════════════════════════════════════════════════════
+// Cabecera 32 B: "R8PC", u16 versión, u16 tamaño de registro, u32 nº de
+// registros, u32 rate, u32 bytes de imagen (cabecera + índice + PCM), u32
+// XXH32 del índice, u32 reservado ×2. Después los registros, ordenados por
+// (folder, name) igual que SampleIndex, y el PCM de cada uno alineado a 4.
+// Mantener sincronizado con tools/pack_pcmstore.py.
+#define PCM_STORE_LABEL    "pcmstore"
+#define PCM_STORE_MAGIC    "R8PC"
+#define PCM_STORE_VERSION  3
+#define PCM_STORE_MAX      1024
+
+struct __attribute__((packed)) PcmStoreEntry {
+  char     folder[16];   // carpeta de LittleFS sin '/' (como SampleIndexEntry)
+  char     name[40];
+  uint32_t srcSize;      // bytes del WAV de origen
+  uint32_t srcCrc;       // CRC-32 del WAV de origen; tamaño y CRC deben coincidir con samples.idx
+  uint32_t offset;       // desde el inicio de la partición
+  uint32_t samples;
+  uint32_t hash;         // sampleHash() del PCM (dedup de uploads, SampleHash.h)
+};
+static_assert(sizeof(PcmStoreEntry) == 76, "PcmStoreEntry: 76 bytes en flash");
+
+struct PcmStoreStats {
+  bool     ready;
+  uint32_t entries;
+  uint32_t imageBytes;
+  uint32_t partitionBytes;   // 0 = la tabla de particiones no tiene "pcmstore"
+  uint32_t stale;            // búsquedas descartadas por WAV cambiado en LittleFS
+};
+
+// ═══════════════════════════════════════════════════════
+// API
+// ═══════════════════════════════════════════════════════
+// Opcional: sin partición o con imagen vacía/inválida todo sigue por LittleFS.
+// Sólo lectura tras begin() → sin lock.
+bool pcmStoreBegin();      // después de sampleIndexBegin()
+bool pcmStoreReady();
+
+// Ruta de LittleFS ("/BD/BD0000.wav"). nullptr si no está empaquetado o si el
+// WAV de LittleFS ya no es el que se empaquetó: tamaño o CRC distintos en
+// SampleIndex (o CRC desconocido, índice regenerado en el equipo). Sin abrir
+// el WAV: samples.idx y la partición salen de la misma carpeta data/.
+const PcmStoreEntry* pcmStoreFind(const char* path);
+const int16_t* pcmStoreSamples(const PcmStoreEntry* e);
+// true si p apunta dentro de la partición mapeada (buffer de pad en flash: no se libera ni se escribe)
+bool pcmStoreContains(const void* p);
+const PcmStoreStats& pcmStoreStats();
+
+#endif // PCM_STORE_H
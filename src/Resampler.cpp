@@ -0,0 +1,277 @@
+/*
+ * Resampler.cpp
+ * RED808 resampler polifase (ver Resampler.h)
+ */
+
+#include "Resampler.h"
+#include "HeapProfiler.h"
+#include <math.h>
+#include <string.h>
+
+struct RsQualityParams {
+  uint16_t taps;      // por fase al interpolar (al decimar se escala por M/L)
+  float    beta;      // Kaiser: atenuación ≈ 8.7 + beta / 0.1102 dB
+};
+
+static const RsQualityParams kRsQuality[RS_Q_COUNT] = {
+  { 16, 5.0f },
+  { 32, 7.0f },
+  { 64, 9.0f },
+};
+
+const char* resampleQualityName(ResampleQuality q) {
+  switch (q) {
+    case RS_Q_FAST:   return "fast";
+    case RS_Q_MEDIUM: return "medium";
+    case RS_Q_HIGH:   return "high";
+    default:          return "?";
+  }
+}
+
+static uint32_t gcdU32(uint32_t a, uint32_t b) {
+  while (b) { uint32_t t = a % b; a = b; b = t; }
+  return a;
+}
+
+// Bessel modificada de orden 0 (serie, converge en < 30 términos para beta ≤ 12)
+static double besselI0(double x) {
+  double sum = 1.0, term = 1.0, q = x * x / 4.0;
+  for (int k = 1; k < 40; k++) {
+    term *= q / ((double)k * k);
+    sum += term;
+    if (term < sum * 1e-12) break;
+  }
+  return sum;
+}
+
+Resampler::~Resampler() {
+  release();
+}
+
+void Resampler::release() {
+  if (coef_) hpFree(coef_);
+  if (buf_) hpFree(buf_);
+  coef_ = nullptr;
+  buf_ = nullptr;
+  tableL_ = tableM_ = 0;
+  tableQ_ = RS_Q_COUNT;
+  active_ = false;
+}
+
+bool Resampler::begin(uint32_t srcRate, uint32_t dstRate, ResampleQuality q, uint32_t inFrames) {
+  active_ = false;
+  failed_ = false;
+  if (srcRate == 0 || dstRate == 0 || srcRate == dstRate || q >= RS_Q_COUNT) return false;
+
+  uint32_t g = gcdU32(srcRate, dstRate);
+  uint32_t L = dstRate / g;
+  uint32_t M = srcRate / g;
+  L_ = L;
+  M_ = M;
+  q_ = q;
+  // Rate "raro" (44056 Hz...): ratio exacto, coeficientes interpolados entre
+  // RS_MAX_PHASES fases. Aproximar M/L desplazaba el tono y la longitud.
+  if (L_ > RS_MAX_PHASES) {
+    rows_ = RS_MAX_PHASES + 1;
+    phaseScale_ = ((uint64_t)RS_MAX_PHASES << 32) / L_;
+  } else {
+    rows_ = L_;
+    phaseScale_ = 0;
+  }
+
+  uint32_t taps = kRsQuality[q].taps;
+  if (M_ > L_) taps = (uint32_t)(((uint64_t)taps * M_ + L_ - 1) / L_);   // decimación: filtro más largo
+  taps = (taps + 1) & ~1u;
+  if (taps > RS_MAX_TAPS) taps = RS_MAX_TAPS;
+  taps_ = (uint16_t)taps;
+
+  if (!buildTable()) {
+    failed_ = true;
+    return false;
+  }
+  if (!buf_) {
+    // RAM interna: es lo que recorre el bucle de taps
+    buf_ = (float*)hpAlloc((RS_MAX_TAPS + RS_BLOCK) * sizeof(float), HP_HEAP_DEFAULT, "resample.buf");
+    if (!buf_) {
+      failed_ = true;
+      return false;
+    }
+  }
+
+  // Historia inicial de taps/2 - 1 ceros: la salida 0 queda centrada en x[0]
+  len_ = taps_ / 2 - 1;
+  memset(buf_, 0, len_ * sizeof(float));
+  start_ = 0;
+  frac_ = 0;
+  produced_ = 0;
+  outTotal_ = (uint32_t)(((uint64_t)inFrames * L_ + M_ - 1) / M_);
+  active_ = true;
+  return true;
+}
+
+bool Resampler::buildTable() {
+  if (coef_ && tableL_ == L_ && tableM_ == M_ && tableQ_ == q_) return true;
+  if (coef_) hpFree(coef_);
+  coef_ = (float*)hpAlloc((size_t)rows_ * taps_ * sizeof(float), HP_HEAP_PSRAM, "resample.coef");
+  tableL_ = tableM_ = 0;
+  tableQ_ = RS_Q_COUNT;
+  if (!coef_) return false;
+
+  // h(x) = fc·sinc(fc·x)·kaiser(x / (taps/2)), x en muestras de entrada.
+  // Corte elegido para que la banda eliminada empiece justo en el Nyquist del
+  // rate menor: ni alias (decimar) ni imágenes (interpolar) por encima de -A dB.
+  // Ancho de transición de Kaiser: Δ ≈ (A - 7.95) / (14.36 · taps) del rate menor.
+  const RsQualityParams& qp = kRsQuality[q_];
+  const double atten = 8.7 + qp.beta / 0.1102;
+  const double delta = (atten - 7.95) / (14.36 * qp.taps);
+  const double fc = (1.0 - delta) * (M_ > L_ ? (double)L_ / M_ : 1.0);
+  const double half = taps_ / 2.0;
+  const double i0b = besselI0(qp.beta);
+  // Fila p = fase p / phases; al interpolar la última (p = RS_MAX_PHASES) es
+  // la fase 1.0, vecina superior de la fase RS_MAX_PHASES - 1
+  const uint32_t phases = (rows_ == L_) ? L_ : RS_MAX_PHASES;
+  for (uint32_t p = 0; p < rows_; p++) {
+    float* row = coef_ + (size_t)p * taps_;
+    double sum = 0.0;
+    for (uint32_t k = 0; k < taps_; k++) {
+      // tap k ↔ x[ipos + k - (taps/2 - 1)], salida en ipos + p/phases
+      double x = ((double)k - (half - 1.0)) - (double)p / phases;
+      double r = x / half;
+      double w = (r <= -1.0 || r >= 1.0) ? 0.0 : besselI0(qp.beta * sqrt(1.0 - r * r)) / i0b;
+      double u = M_PI * fc * x;
+      double s = (fabs(u) < 1e-9) ? 1.0 : sin(u) / u;
+      double h = fc * s * w;
+      row[k] = (float)h;
+      sum += h;
+    }
+    // Ganancia DC exacta por fase: sin rizado de amplitud entre fases
+    if (sum != 0.0) {
+      for (uint32_t k = 0; k < taps_; k++) row[k] = (float)(row[k] / sum);
+    }
+  }
+  tableL_ = L_;
+  tableM_ = M_;
+  tableQ_ = q_;
+  return true;
+}
+
+static inline int16_t rsClip(float v) {
+  v += (v < 0.0f) ? -0.5f : 0.5f;
+  if (v > 32767.0f) return 32767;
+  if (v < -32768.0f) return -32768;
+  return (int16_t)v;
+}
+
+static inline float rsDot(const float* x, const float* h, uint32_t n) {
+  float acc0 = 0.0f, acc1 = 0.0f;
+  uint32_t k = 0;
+  for (; k + 2 <= n; k += 2) {
+    acc0 += x[k] * h[k];
+    acc1 += x[k + 1] * h[k + 1];
+  }
+  if (k < n) acc0 += x[k] * h[k];
+  return acc0 + acc1;
+}
+
+size_t Resampler::drain(int16_t* out, size_t outCap) {
+  size_t w = 0;
+  uint32_t left = outTotal_ - produced_;
+  if (outCap > left) outCap = left;
+  const uint32_t T = taps_;
+
+  if (L_ == 1) {
+    // Decimación entera: una fila, avance fijo de M
+    while (w < outCap && start_ + T <= len_) {
+      out[w++] = rsClip(rsDot(buf_ + start_, coef_, T));
+      start_ += M_;
+    }
+  } else if (M_ == 1) {
+    // Interpolación entera: L fases por muestra de entrada
+    while (w < outCap && start_ + T <= len_) {
+      const float* x = buf_ + start_;
+      while (frac_ < L_ && w < outCap) {
+        out[w++] = rsClip(rsDot(x, coef_ + (size_t)frac_ * T, T));
+        frac_++;
+      }
+      if (frac_ < L_) break;
+      frac_ = 0;
+      start_++;
+    }
+  } else if (rows_ != L_) {
+    // Fase exacta frac_/L_ → fila 32.32 de la tabla; interpolar los
+    // coeficientes equivale a interpolar los dos productos
+    while (w < outCap && start_ + T <= len_) {
+      uint64_t pos = (uint64_t)frac_ * phaseScale_;
+      uint32_t row = (uint32_t)(pos >> 32);
+      float t = (float)(uint32_t)pos * (1.0f / 4294967296.0f);
+      const float* h0 = coef_ + (size_t)row * T;
+      float y0 = rsDot(buf_ + start_, h0, T);
+      float y1 = rsDot(buf_ + start_, h0 + T, T);
+      out[w++] = rsClip(y0 + t * (y1 - y0));
+      frac_ += M_;
+      while (frac_ >= L_) {
+        frac_ -= L_;
+        start_++;
+      }
+    }
+  } else {
+    while (w < outCap && start_ + T <= len_) {
+      out[w++] = rsClip(rsDot(buf_ + start_, coef_ + (size_t)frac_ * T, T));
+      frac_ += M_;
+      while (frac_ >= L_) {
+        frac_ -= L_;
+        start_++;
+      }
+    }
+  }
+  produced_ += w;
+
+  // Compactar: sólo queda la historia que aún necesita alguna salida
+  if (start_ >= len_) {
+    start_ -= len_;   // decimación: el salto puede pasar del final del buffer
+    len_ = 0;
+  } else if (start_ > 0) {
+    memmove(buf_, buf_ + start_, (len_ - start_) * sizeof(float));
+    len_ -= start_;
+    start_ = 0;
+  }
+  return w;
+}
+
+size_t Resampler::process(const int16_t* in, size_t n, int16_t* out, size_t outCap) {
+  if (!active_) return 0;
+  size_t w = 0;
+  while (n > 0 && produced_ < outTotal_) {
+    // start_ > 0 tras compactar = muestras que aún hay que saltar (decimación)
+    size_t skip = start_ < n ? start_ : n;
+    if (len_ == 0 && skip > 0) {
+      in += skip;
+      n -= skip;
+      start_ -= skip;
+      continue;
+    }
+    size_t room = (size_t)RS_MAX_TAPS + RS_BLOCK - len_;
+    size_t take = n < room ? n : room;
+    float* dst = buf_ + len_;
+    for (size_t i = 0; i < take; i++) dst[i] = (float)in[i];
+    len_ += take;
+    in += take;
+    n -= take;
+    size_t got = drain(out + w, outCap - w);
+    w += got;
+    if (got == 0 && len_ >= (size_t)RS_MAX_TAPS + RS_BLOCK) break;   // salida llena
+  }
+  return w;
+}
+
+size_t Resampler::flush(int16_t* out, size_t outCap) {
+  if (!active_) return 0;
+  size_t w = 0;
+  // Ceros tras la última muestra hasta completar outTotal_
+  for (int guard = 0; guard < 64 && produced_ < outTotal_ && w < outCap; guard++) {
+    static const int16_t kZeros[RS_BLOCK / 4] = {};
+    w += process(kZeros, RS_BLOCK / 4, out + w, outCap - w);
+  }
+  active_ = false;
+  return w;
+}
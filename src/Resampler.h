@@ -0,0 +1,89 @@
+/*
+ * Resampler.h
+ * RED808 conversión de sample rate para la carga de samples: polifase con
+ * sinc enventanado (Kaiser), tabla de coeficientes precalculada por
+ * (ratio, calidad) e incremental bloque a bloque sobre int16 mono.
+ */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Rate al que se entregan los samples a la Daisy. Los kits de fábrica son
+// 44.1 kHz y la Daisy reproduce el buffer 1:1, así que 44.1 kHz pasa intacto
+// y todo lo demás (48k, 22.05k, 96k...) se convierte a este rate.
+#define RS_TARGET_RATE   44100
+
+#define RS_MAX_PHASES    512    // ratios con más fases interpolan entre RS_MAX_PHASES + 1 filas
+#define RS_MAX_TAPS      128    // taps por fase (al decimar crecen con M/L)
+#define RS_BLOCK         512    // muestras de entrada por pasada
+
+enum ResampleQuality : uint8_t {
+  RS_Q_FAST = 0,     // 16 taps, ~-55 dB, plano hasta ~0.6·Nyquist
+  RS_Q_MEDIUM,       // 32 taps, ~-72 dB, plano hasta ~0.75·Nyquist (por defecto)
+  RS_Q_HIGH,         // 64 taps, ~-90 dB, plano hasta ~0.85·Nyquist
+  RS_Q_COUNT
+};
+
+const char* resampleQualityName(ResampleQuality q);
+
+// ═══════════════════════════════════════════════════════
+// Resampler
+// ═══════════════════════════════════════════════════════
+// src/dst se reducen a L/M (salida n ↔ entrada n·M/L). Tres rutas:
+//   L == M      → inactivo, quien llama copia sin tocar
+//   L == 1      → decimación entera: una sola fila de coeficientes
+//   M == 1      → interpolación entera: L salidas por muestra sin fase fraccional
+//   resto       → polifase genérico con acumulador de fase entero (sin divisiones)
+// L/M es siempre el ratio exacto. Con L > RS_MAX_PHASES (44056 Hz → L = 11025)
+// la tabla tiene RS_MAX_PHASES + 1 filas y cada salida interpola linealmente
+// entre las dos fases vecinas (fase frac/L llevada a la tabla con un producto
+// en coma fija). La tabla se conserva entre begin() con el mismo ratio y
+// calidad (un kit entero a 48 kHz la calcula una vez). Memoria: tabla
+// filas×taps float + un buffer de taps + RS_BLOCK floats; la salida va
+// directa al buffer final.
+class Resampler {
+public:
+  ~Resampler();
+
+  // false si no hay que convertir (mismo rate, rate inválido) o no hay memoria
+  bool begin(uint32_t srcRate, uint32_t dstRate, ResampleQuality q, uint32_t inFrames);
+  bool active() const { return active_; }
+  bool failed() const { return failed_; }
+  // Muestras de salida totales: ceil(inFrames · L / M)
+  uint32_t outputLength() const { return outTotal_; }
+
+  // Consume n muestras y escribe las salidas disponibles (máx. outCap)
+  size_t process(const int16_t* in, size_t n, int16_t* out, size_t outCap);
+  // Cola del filtro hasta completar outputLength()
+  size_t flush(int16_t* out, size_t outCap);
+  void end() { active_ = false; }
+  void release();   // libera tabla y buffer
+
+private:
+  bool buildTable();
+  size_t drain(int16_t* out, size_t outCap);
+
+  uint32_t L_ = 1;
+  uint32_t M_ = 1;
+  uint16_t taps_ = 0;
+  ResampleQuality q_ = RS_Q_MEDIUM;
+  uint32_t rows_ = 0;            // filas de coef_: L_, o RS_MAX_PHASES + 1 si interpola
+  uint64_t phaseScale_ = 0;      // frac·phaseScale_ = fila (32.32) si rows_ != L_
+  float* coef_ = nullptr;        // [rows_][taps_]
+  uint32_t tableL_ = 0;          // clave de la tabla construida
+  uint32_t tableM_ = 0;
+  ResampleQuality tableQ_ = RS_Q_COUNT;
+  float* buf_ = nullptr;         // historia + bloque, RS_MAX_TAPS + RS_BLOCK
+  uint32_t len_ = 0;             // muestras válidas en buf_
+  uint32_t start_ = 0;           // primer tap de la próxima salida
+  uint32_t frac_ = 0;            // fase 0..L-1 (exacta, también al interpolar)
+  uint32_t outTotal_ = 0;
+  uint32_t produced_ = 0;
+  bool active_ = false;
+  bool failed_ = false;
+};
+
+#endif // RESAMPLER_H
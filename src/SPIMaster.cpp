@@ -5,6 +5,7 @@
  */
 
 #include "SPIMaster.h"
+#include "HeapProfiler.h"
 #include <SPI.h>
 #include <esp_task_wdt.h>
 
@@ -37,8 +38,23 @@ static const FilterPreset filterPresets[] = {
 // CONSTRUCTOR / DESTRUCTOR
 // ═══════════════════════════════════════════════════════
 
-SPIMaster::SPIMaster() : seqNumber(0), spiErrorCount(0), stm32Connected(false), spiMutex(nullptr), spiCmdQueue(nullptr), spiLogCallback(nullptr) {
+SPIMaster::SPIMaster() : seqNumber(0), spiErrorCount(0), stm32Connected(false), spiMutex(nullptr), spiCmdQueue(nullptr),
+                         batchCmds(nullptr), batchCount(0), batchState(SPI_BATCH_IDLE), batchPendingMs(0), batchCoalesced(0),
+                         batchOwner(nullptr), batchReleaseIdx(0),
+                         spiLogCallback(nullptr) {
     spiMutex = xSemaphoreCreateMutex();
+    portMUX_INITIALIZE(&batchMux);
+    portMUX_INITIALIZE(&tagMux);
+    portMUX_INITIALIZE(&slotMux);
+    memset(daisySlots, 0, sizeof(daisySlots));
+    daisySlotHashes = false;
+    slotSyncPending = false;
+    lastDaisyUptime = 0;
+    dedupStats = {};
+    memset(tagCtx, 0, sizeof(tagCtx));
+    tagCtxOpen = 0;
+    tagHead = 0;
+    tagTail = 0;
     // Initialize cached state
     cachedMasterVolume = 100;
     cachedSeqVolume = 100;
@@ -94,6 +110,7 @@ SPIMaster::SPIMaster() : seqNumber(0), spiErrorCount(0), stm32Connected(false),
     
     cachedMasterPeak = 0.0f;
     lastPeakRequest = 0;
+    peakPolling = true;   // hasta el primer rebuildTopicSets() de WebInterface
     lastStatusPoll = 0;
     eventCallback = nullptr;
     eventUserData = nullptr;
@@ -132,7 +149,8 @@ bool SPIMaster::begin() {
     uint32_t rtt;
     for (int attempt = 0; attempt < 10; attempt++) {
         if (ping(rtt)) {
-            stm32Connected = true;
+            // La Daisy puede seguir con samples de antes del reboot del ESP32
+            syncSlotHashes();
             return true;
         }
         delay(200);
@@ -162,22 +180,320 @@ void SPIMaster::drainCmdQueue() {
     if (!spiCmdQueue) return;
     SpiQueuedCmd env;
     while (xQueueReceive(spiCmdQueue, &env, 0) == pdTRUE) {
-        sendCommandDirect(env.cmd, env.payload, env.payloadLen);
+        bool ok = sendCommandDirect(env.cmd, env.payload, env.payloadLen);
+        if (env.tag) pushTagCompletion(env.tag, ok);
+    }
+}
+
+// ── Tags de ack (CmdAck.h) ───────────────────────────────────────────────────
+// Un contexto por task: async_tcp (WS) y systemTask (UDP) comparten Core0 y
+// pueden intercalarse entre beginTag y endTag; cada una cuenta sus frames.
+void SPIMaster::beginTag(uint8_t tag) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&tagMux);
+    SpiTagCtx* slot = nullptr;
+    for (uint8_t i = 0; i < SPI_TAG_TASKS; i++) {
+        if (tagCtx[i].task == self) { slot = &tagCtx[i]; break; }   // beginTag sin endTag previo
+        if (!slot && tagCtx[i].task == nullptr) slot = &tagCtx[i];
+    }
+    if (slot) {
+        if (slot->task == nullptr) tagCtxOpen++;
+        slot->task = self;
+        slot->tag = tag;
+        slot->res = {};
+    }
+    portEXIT_CRITICAL(&tagMux);
+}
+
+SpiTagResult SPIMaster::endTag() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    SpiTagResult r = {};
+    r.untracked = true;
+    portENTER_CRITICAL(&tagMux);
+    for (uint8_t i = 0; i < SPI_TAG_TASKS; i++) {
+        if (tagCtx[i].task != self) continue;
+        r = tagCtx[i].res;
+        tagCtx[i].task = nullptr;
+        tagCtx[i].tag = 0;
+        tagCtxOpen--;
+        break;
+    }
+    portEXIT_CRITICAL(&tagMux);
+    return r;
+}
+
+// Sólo la task dueña escribe su contexto: la búsqueda no necesita el lock
+SpiTagCtx* SPIMaster::currentTagCtx() {
+    if (tagCtxOpen == 0) return nullptr;
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (uint8_t i = 0; i < SPI_TAG_TASKS; i++) {
+        if (tagCtx[i].task == self) return &tagCtx[i];
+    }
+    return nullptr;
+}
+
+void SPIMaster::pushTagCompletion(uint8_t tag, bool ok) {
+    uint32_t now = micros();
+    portENTER_CRITICAL(&tagMux);
+    uint8_t next = (uint8_t)((tagHead + 1) % SPI_TAG_RING);
+    if (next != tagTail) {   // lleno: el ack caduca por timeout en CmdAck
+        tagRing[tagHead].tag = tag;
+        tagRing[tagHead].ok = ok;
+        tagRing[tagHead].us = now;
+        tagHead = next;
+    }
+    portEXIT_CRITICAL(&tagMux);
+}
+
+bool SPIMaster::popTagCompletion(SpiTagCompletion* out) {
+    bool got = false;
+    portENTER_CRITICAL(&tagMux);
+    if (tagTail != tagHead) {
+        *out = tagRing[tagTail];
+        tagTail = (uint8_t)((tagTail + 1) % SPI_TAG_RING);
+        got = true;
+    }
+    portEXIT_CRITICAL(&tagMux);
+    return got;
+}
+
+// ── Batch staging (ver beginBatch en SPIMaster.h) ─────────────────────────────
+// Bytes de payload que identifican al destino de un setter: dos frames con el
+// mismo cmd y el mismo prefijo son el mismo parámetro → sólo cuenta el último.
+// -1 = no coalescible (triggers, clears, acciones, uploads, consultas).
+static int8_t batchKeyPrefix(uint8_t cmd) {
+    switch (cmd) {
+        case CMD_TRACK_CLEAR_FILTER:
+        case CMD_TRACK_CLEAR_LIVE:
+        case CMD_TRACK_CLEAR_FX:
+        case CMD_PAD_CLEAR_FILTER:
+        case CMD_PAD_CLEAR_FX:
+            return -1;
+        case CMD_TRACK_VOLUME:
+        case CMD_MASTER_FX_ROUTE:
+        case CMD_CHOKE_GROUP:
+        case CMD_SYNTH_303_PARAM:
+        case CMD_DSQ_SET_MUTE:
+        case CMD_DSQ_SET_TRACK_ENGINE:
+        case CMD_DSQ_SET_TRACK_SWING:
+            return 1;
+        case CMD_SYNTH_PARAM:
+        case CMD_DSQ_SET_STEP:
+        case CMD_DSQ_SET_PARAM_LOCK:
+            return 3;
+        case CMD_MASTER_VOLUME:
+        case CMD_SEQ_VOLUME:
+        case CMD_LIVE_VOLUME:
+        case CMD_LIVE_PITCH:
+        case CMD_TEMPO:
+        case CMD_AUTOWAH_ACTIVE:
+        case CMD_AUTOWAH_LEVEL:
+        case CMD_AUTOWAH_MIX:
+        case CMD_STEREO_WIDTH:
+        case CMD_DELAY_STEREO:
+        case CMD_CHORUS_STEREO:
+        case CMD_EARLY_REF_ACTIVE:
+        case CMD_EARLY_REF_MIX:
+        case CMD_SYNTH_ACTIVE:
+        case CMD_DSQ_SET_SWING:
+        case CMD_DSQ_SET_HUMANIZE:
+            return 0;
+        default:
+            break;
+    }
+    if (cmd >= CMD_FILTER_SET && cmd <= CMD_LIMITER_ACTIVE) return 0;      // FX master
+    if (cmd >= CMD_TRACK_FILTER && cmd <= CMD_TRACK_LFO_CONFIG) return 1;  // [track, ...]
+    if (cmd >= CMD_PAD_FILTER && cmd <= CMD_PAD_LFO_RETRIG) return 1;      // [pad, ...]
+    return -1;
+}
+
+bool SPIMaster::beginBatch() {
+    if (!spiCmdQueue) return false;
+    if (!batchCmds) {
+        batchCmds = (SpiQueuedCmd*)hpAlloc(sizeof(SpiQueuedCmd) * SPI_BATCH_MAX_CMDS, HP_HEAP_PSRAM, "spi.batch");
+        if (!batchCmds) return false;
+    }
+    bool opened = false;
+    portENTER_CRITICAL(&batchMux);
+    if (batchState == SPI_BATCH_IDLE) {
+        batchState = SPI_BATCH_STAGING;
+        batchCount = 0;
+        batchOwner = xTaskGetCurrentTaskHandle();
+        opened = true;
+    }
+    portEXIT_CRITICAL(&batchMux);
+    return opened;
+}
+
+// Core0: añade o sustituye; false = no hay batch abierto (va por la cola normal)
+bool SPIMaster::stageBatchCmd(uint8_t cmd, const void* payload, uint16_t payloadLen) {
+    const int8_t prefix = batchKeyPrefix(cmd);
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool staged = false;
+        bool full = false;
+        portENTER_CRITICAL(&batchMux);
+        if (batchState == SPI_BATCH_STAGING) {
+            uint16_t n = batchCount;
+            if (prefix >= 0 && payloadLen >= (uint16_t)prefix) {
+                // Mismo parámetro ya en el batch: se quita y el valor nuevo va al final,
+                // así un clear intermedio sigue quedando antes del último set
+                for (uint16_t i = 0; i < n; i++) {
+                    SpiQueuedCmd& e = batchCmds[i];
+                    if (e.cmd != cmd || e.payloadLen == SPI_BATCH_DEAD || e.payloadLen < (uint16_t)prefix) continue;
+                    if (prefix > 0 && memcmp(e.payload, payload, prefix) != 0) continue;
+                    memmove(&batchCmds[i], &batchCmds[i + 1], (n - i - 1) * sizeof(SpiQueuedCmd));
+                    n--;
+                    batchCoalesced++;
+                    break;
+                }
+            }
+            if (n < SPI_BATCH_MAX_CMDS) {
+                SpiQueuedCmd& e = batchCmds[n];
+                e.cmd = cmd;
+                e.tag = 0;
+                e.payloadLen = payloadLen;
+                if (payload && payloadLen > 0) memcpy(e.payload, payload, payloadLen);
+                n++;
+                staged = true;
+            } else {
+                full = true;
+            }
+            batchCount = n;
+        }
+        portEXIT_CRITICAL(&batchMux);
+        if (staged) return true;
+        if (!full) return false;
+        // Lleno: lo acumulado sale ya por la cola (en orden) y se reintenta
+        spillBatchToQueue();
+    }
+    return false;
+}
+
+// Core0, frame de otra task (o posterior al batch): un setter del mismo
+// parámetro deja muerta la entrada del batch, que ya no sale. Así el valor que
+// llega por la cola no queda pisado por uno anterior retenido hasta el step.
+void SPIMaster::supersedeBatchCmd(uint8_t cmd, const void* payload, uint16_t payloadLen) {
+    const int8_t prefix = batchKeyPrefix(cmd);
+    if (prefix < 0 || payloadLen < (uint16_t)prefix) return;
+    portENTER_CRITICAL(&batchMux);
+    if (batchState == SPI_BATCH_STAGING || batchState == SPI_BATCH_PENDING || batchState == SPI_BATCH_RELEASING) {
+        uint16_t first = (batchState == SPI_BATCH_RELEASING) ? batchReleaseIdx : 0;
+        for (uint16_t i = first; i < batchCount; i++) {
+            SpiQueuedCmd& e = batchCmds[i];
+            if (e.cmd != cmd || e.payloadLen == SPI_BATCH_DEAD || e.payloadLen < (uint16_t)prefix) continue;
+            if (prefix > 0 && memcmp(e.payload, payload, prefix) != 0) continue;
+            e.payloadLen = SPI_BATCH_DEAD;
+            batchCoalesced++;
+        }
+    }
+    portEXIT_CRITICAL(&batchMux);
+}
+
+// Core0: vuelca el batch a la cola en orden. Si estaba abierto sigue abierto (vacío).
+void SPIMaster::spillBatchToQueue() {
+    SpiBatchState prev;
+    uint16_t n;
+    portENTER_CRITICAL(&batchMux);
+    prev = batchState;
+    n = batchCount;
+    if (prev == SPI_BATCH_STAGING || prev == SPI_BATCH_PENDING) batchState = SPI_BATCH_FLUSHING;
+    portEXIT_CRITICAL(&batchMux);
+    if (prev != SPI_BATCH_STAGING && prev != SPI_BATCH_PENDING) return;
+
+    uint16_t i = 0;
+    for (; i < n; i++) {
+        if (batchCmds[i].payloadLen == SPI_BATCH_DEAD) continue;   // anulado por un frame posterior
+        if (xQueueSend(spiCmdQueue, &batchCmds[i], pdMS_TO_TICKS(10)) != pdTRUE) break;
+    }
+    if (i < n) {
+        spiErrorCount += n - i;
+        Serial.printf("[SPI] batch spill: queue full, dropped %u/%u\n", (unsigned)(n - i), (unsigned)n);
+    }
+    portENTER_CRITICAL(&batchMux);
+    batchCount = 0;
+    batchState = (prev == SPI_BATCH_STAGING) ? SPI_BATCH_STAGING : SPI_BATCH_IDLE;
+    portEXIT_CRITICAL(&batchMux);
+}
+
+uint16_t SPIMaster::endBatch(bool atStepBoundary) {
+    uint16_t n;
+    bool closed = false;
+    portENTER_CRITICAL(&batchMux);
+    n = batchCount;
+    if (batchState == SPI_BATCH_STAGING) {
+        batchState = (n == 0) ? SPI_BATCH_IDLE : SPI_BATCH_PENDING;
+        batchPendingMs = millis();
+        closed = n > 0;
+    }
+    portEXIT_CRITICAL(&batchMux);
+    // Sin espera: a la cola de una vez; Core1 lo drena en el mismo process()
+    if (closed && !atStepBoundary) spillBatchToQueue();
+    return n;
+}
+
+// Core1, en el límite de step: sólo cambia de estado. El envío va en process(),
+// detrás de los triggers del step y de lo que ya estaba en la cola.
+void SPIMaster::releaseBatch() {
+    portENTER_CRITICAL(&batchMux);
+    if (batchState == SPI_BATCH_PENDING) {
+        batchState = SPI_BATCH_RELEASING;
+        batchReleaseIdx = 0;
+    }
+    portEXIT_CRITICAL(&batchMux);
+}
+
+// Core1 (process): hasta SPI_BATCH_RELEASE_CHUNK frames vivos por pasada
+void SPIMaster::sendBatchChunk() {
+    for (uint16_t sent = 0; sent < SPI_BATCH_RELEASE_CHUNK; ) {
+        SpiQueuedCmd e;
+        bool have = false;
+        portENTER_CRITICAL(&batchMux);
+        while (batchReleaseIdx < batchCount && batchCmds[batchReleaseIdx].payloadLen == SPI_BATCH_DEAD) {
+            batchReleaseIdx++;
+        }
+        if (batchReleaseIdx < batchCount) {
+            e = batchCmds[batchReleaseIdx++];
+            have = true;
+        } else {
+            batchCount = 0;
+            batchReleaseIdx = 0;
+            batchState = SPI_BATCH_IDLE;
+        }
+        portEXIT_CRITICAL(&batchMux);
+        if (!have) return;
+        sendCommandDirect(e.cmd, e.payload, e.payloadLen);
+        sent++;
     }
 }
 
 // ── High-level sendCommand: enqueues from Core0, sends directly from Core1 ───
 bool SPIMaster::sendCommand(uint8_t cmd, const void* payload, uint16_t payloadLen) {
+    SpiTagCtx* tc = currentTagCtx();
+    const uint8_t tag = tc ? tc->tag : 0;
     // Core0 (WiFi/WS task): enqueue for Core1 to send — never block WS handler
     if (xPortGetCoreID() == 0 && spiCmdQueue && payloadLen <= SPI_QUEUE_PAYLOAD_MAX) {
+        if (batchState != SPI_BATCH_IDLE) {
+            // Batch abierto por esta task: se acumula (y coalesce) ahí
+            if (batchState == SPI_BATCH_STAGING && batchOwner == xTaskGetCurrentTaskHandle() &&
+                stageBatchCmd(cmd, payload, payloadLen)) {
+                if (tc) tc->res.staged++;
+                return true;
+            }
+            // Cualquier otro frame va ya por la cola: el batch no retiene triggers ajenos
+            supersedeBatchCmd(cmd, payload, payloadLen);
+        }
         SpiQueuedCmd env;
         env.cmd = cmd;
+        env.tag = tag;
         env.payloadLen = (uint16_t)payloadLen;
         if (payload && payloadLen > 0) memcpy(env.payload, payload, payloadLen);
         // Non-blocking enqueue; if queue full, DROP command (never fall through
         // to sendCommandDirect which would block Core0 on spiMutex and risk WDT)
         BaseType_t queued = xQueueSend(spiCmdQueue, &env, pdMS_TO_TICKS(5));
-        if (queued == pdTRUE) return true;
+        if (queued == pdTRUE) {
+            if (tc) tc->res.queued++;
+            return true;
+        }
 
         spiErrorCount++;
         Serial.printf("[SPI] queue full, dropped cmd=0x%02X len=%u waiting=%u\n",
@@ -189,12 +505,21 @@ bool SPIMaster::sendCommand(uint8_t cmd, const void* payload, uint16_t payloadLe
             cmd == CMD_DSQ_SET_STEP || cmd == CMD_DSQ_SELECT_PATTERN) {
             vTaskDelay(pdMS_TO_TICKS(1));
             queued = xQueueSend(spiCmdQueue, &env, pdMS_TO_TICKS(10));
-            if (queued == pdTRUE) return true;
+            if (queued == pdTRUE) {
+                if (tc) tc->res.queued++;
+                return true;
+            }
             Serial.printf("[SPI] retry failed, dropped critical cmd=0x%02X\n", (unsigned)cmd);
         }
+        if (tc) tc->res.dropped++;
         return false;
     }
-    return sendCommandDirect(cmd, payload, payloadLen);
+    bool ok = sendCommandDirect(cmd, payload, payloadLen);
+    if (tc) {
+        tc->res.queued++;
+        pushTagCompletion(tag, ok);
+    }
+    return ok;
 }
 
 // ── Raw SPI send (always executes synchronously) ─────────────────────────────
@@ -341,9 +666,19 @@ bool SPIMaster::sendAndReceive(uint8_t cmd, const void* payload, uint16_t payloa
 // ═══════════════════════════════════════════════════════
 
 void SPIMaster::process() {
+    // ── 0. Batch atómico sin step que lo suelte (tempo muy lento o transporte parado) ──
+    if (batchState == SPI_BATCH_PENDING && millis() - batchPendingMs >= SPI_BATCH_MAX_HOLD_MS) {
+        releaseBatch();
+    }
+
     // ── 1. Drain commands queued from Core0 (WS/WiFi task) ──
     drainCmdQueue();
 
+    // ── 1b. Batch soltado en el último step: por tramos, tras los triggers del step ──
+    if (batchState == SPI_BATCH_RELEASING) {
+        sendBatchChunk();
+    }
+
     // ── 2. Keepalive PING every 2s (with RTT tracking for telemetry) ──
     static uint32_t lastHeartbeat = 0;
     if (stm32Connected && (millis() - lastHeartbeat > 2000)) {
@@ -355,8 +690,9 @@ void SPIMaster::process() {
     }
 
     // ── 3. Poll audio peaks every 200ms (was 120ms — reduces SPI mutex hold time) ──
+    //    Sólo con algún cliente suscrito a "levels" (setPeakPolling)
     static uint32_t lastPeakPoll = 0;
-    if (stm32Connected && (millis() - lastPeakPoll > 200)) {
+    if (peakPolling && stm32Connected && (millis() - lastPeakPoll > 200)) {
         requestPeaks();
         lastPeakPoll = millis();
     }
@@ -378,12 +714,17 @@ void SPIMaster::process() {
         lastStatusPoll = millis();
     }
 
+    // ── 4b. Tabla de pads tras un reboot de la Daisy (uptime hacia atrás) ──
+    if (slotSyncPending && stm32Connected) {
+        syncSlotHashes();
+    }
+
     // ── 5. Reconnect if link dropped ──
     if (!stm32Connected) {
         static uint32_t lastRetry = 0;
         if (millis() - lastRetry > 3000) {
             uint32_t rtt;
-            if (ping(rtt)) stm32Connected = true;
+            ping(rtt);   // al responder, markConnected() y el paso 4b resincroniza
             lastRetry = millis();
         }
     }
@@ -1086,12 +1427,12 @@ void SPIMaster::setStutter(int padIndex, bool active, int intervalMs) {
 // SAMPLE TRANSFER
 // ═══════════════════════════════════════════════════════
 
-bool SPIMaster::setSampleBuffer(int padIndex, int16_t* buffer, uint32_t length) {
+bool SPIMaster::setSampleBuffer(int padIndex, int16_t* buffer, uint32_t length, uint32_t hash) {
     if (padIndex < 0 || padIndex >= MAX_PADS) return false;
     
     // Transfer sample data to STM32
     if (buffer && length > 0) {
-        return transferSample(padIndex, buffer, length);
+        return transferSample(padIndex, buffer, length, hash);
     } else {
         // Unload
         unloadSample(padIndex);
@@ -1099,43 +1440,165 @@ bool SPIMaster::setSampleBuffer(int padIndex, int16_t* buffer, uint32_t length)
     }
 }
 
-bool SPIMaster::transferSample(int padIndex, int16_t* buffer, uint32_t numSamples) {
+bool SPIMaster::transferSample(int padIndex, int16_t* buffer, uint32_t numSamples, uint32_t hash) {
     if (!buffer || numSamples == 0) return false;
-    
-    uint32_t totalBytes = numSamples * sizeof(int16_t);
-    
-    
+    if (padIndex < 0 || padIndex >= MAX_PADS) return false;
+
+    if (hash != 0) {
+        // 1. El pad ya tiene exactamente este audio (recarga de kit, mismo fichero)
+        DaisySlot cur = getSlot(padIndex);
+        if (cur.hash == hash && cur.samples == numSamples) {
+            dedupStats.skipped++;
+            dedupStats.bytesSaved += numSamples * sizeof(int16_t);
+            return true;
+        }
+        // 2. Otro pad lo tiene: copia dentro de la Daisy. Sólo con firmware que
+        //    conoce la tabla (respondió a CMD_SAMPLE_HASHES)
+        int src = daisySlotHashes ? findSlot(hash, numSamples, padIndex) : -1;
+        if (src >= 0) {
+            SampleCopyPayload cp = {};
+            cp.srcPad = (uint8_t)src;
+            cp.dstPad = (uint8_t)padIndex;
+            cp.hash = hash;
+            cp.totalSamples = numSamples;
+            // La Daisy ignora la copia si el origen no cuadra: entonces va entero
+            if (sendCommandDirect(CMD_SAMPLE_COPY, &cp, sizeof(cp)) &&
+                confirmSlotContent(padIndex, hash, numSamples)) {
+                dedupStats.copies++;
+                dedupStats.bytesSaved += numSamples * sizeof(int16_t);
+                return true;
+            }
+        }
+    }
+
+    // 3. Transferencia completa
+    sampleStreamBegin(padIndex, numSamples);
+    bool ok = sampleStreamData(padIndex, buffer, 0, numSamples * sizeof(int16_t));
+    ok = sampleStreamEnd(padIndex, buffer, numSamples) && ok;
+    dedupStats.uploads++;
+    // Con algún chunk o el END perdidos la Daisy no tiene este audio: el próximo envío va entero
+    if (ok && hash != 0) confirmSlotContent(padIndex, hash, numSamples);
+    return ok;
+}
+
+// ── Tabla de pads de la Daisy ────────────────────────────────────────────────
+
+DaisySlot SPIMaster::getSlot(int padIndex) {
+    DaisySlot s = {};
+    if (padIndex < 0 || padIndex >= MAX_PADS) return s;
+    portENTER_CRITICAL(&slotMux);
+    s = daisySlots[padIndex];
+    portEXIT_CRITICAL(&slotMux);
+    return s;
+}
+
+// Tras END/COPY: con tabla (CMD_SAMPLE_HASHES) manda lo que diga la Daisy;
+// sin ella basta con que el END saliera entero. false → el pad queda sin hash
+bool SPIMaster::confirmSlotContent(int padIndex, uint32_t hash, uint32_t numSamples) {
+    if (padIndex < 0 || padIndex >= MAX_PADS || hash == 0) return false;
+    if (!daisySlotHashes) {
+        noteSlotContent(padIndex, hash, numSamples);
+        return true;
+    }
+    DaisySlot s = {};
+    if (syncSlotHashes()) s = getSlot(padIndex);
+    if (s.hash == hash && s.samples == numSamples) return true;
+    invalidateSlots(padIndex, 1);
+    return false;
+}
+
+void SPIMaster::noteSlotContent(int padIndex, uint32_t hash, uint32_t numSamples) {
+    if (padIndex < 0 || padIndex >= MAX_PADS) return;
+    portENTER_CRITICAL(&slotMux);
+    daisySlots[padIndex].hash = hash;
+    daisySlots[padIndex].samples = hash ? numSamples : 0;
+    portEXIT_CRITICAL(&slotMux);
+}
+
+void SPIMaster::invalidateSlots(int firstPad, int count) {
+    if (firstPad < 0) firstPad = 0;
+    int last = firstPad + count;
+    if (last > MAX_PADS) last = MAX_PADS;
+    portENTER_CRITICAL(&slotMux);
+    for (int p = firstPad; p < last; p++) daisySlots[p] = {};
+    portEXIT_CRITICAL(&slotMux);
+}
+
+int SPIMaster::findSlot(uint32_t hash, uint32_t numSamples, int exceptPad) {
+    int found = -1;
+    portENTER_CRITICAL(&slotMux);
+    for (int p = 0; p < MAX_PADS; p++) {
+        if (p != exceptPad && daisySlots[p].hash == hash && daisySlots[p].samples == numSamples) {
+            found = p;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&slotMux);
+    return found;
+}
+
+// Tras conectar o tras un reboot de la Daisy: qué tiene cada pad. Firmware
+// antiguo no responde → tabla vacía (todo se envía entero) y sin COPY
+bool SPIMaster::syncSlotHashes() {
+    slotSyncPending = false;
+    SampleHashesResponse resp = {};
+    if (!sendAndReceive(CMD_SAMPLE_HASHES, nullptr, 0, &resp, sizeof(resp))) {
+        daisySlotHashes = false;
+        return false;
+    }
+    daisySlotHashes = true;
+    dedupStats.syncs++;
+    uint8_t n = resp.count < MAX_PADS ? resp.count : MAX_PADS;
+    portENTER_CRITICAL(&slotMux);
+    for (int p = 0; p < MAX_PADS; p++) {
+        daisySlots[p] = {};
+        if (p < n && resp.slots[p].hash != 0) {
+            daisySlots[p].hash = resp.slots[p].hash;
+            daisySlots[p].samples = resp.slots[p].totalSamples;
+        }
+    }
+    portEXIT_CRITICAL(&slotMux);
+    return true;
+}
+
+void SPIMaster::sampleStreamBegin(int padIndex, uint32_t numSamples) {
+    invalidateSlots(padIndex, 1);   // a medio escribir hasta que alguien anote el hash
+
     // 1. BEGIN
     SampleBeginPayload beginP = {};
     beginP.padIndex = (uint8_t)padIndex;
     beginP.bitsPerSample = 16;
     beginP.sampleRate = SAMPLE_RATE;
-    beginP.totalBytes = totalBytes;
+    beginP.totalBytes = numSamples * sizeof(int16_t);
     beginP.totalSamples = numSamples;
-    
-    sendCommand(CMD_SAMPLE_BEGIN, &beginP, sizeof(beginP));
+
+    // Directo (no por la cola de Core1): los DATA van directos y no deben adelantarse al BEGIN
+    sendCommandDirect(CMD_SAMPLE_BEGIN, &beginP, sizeof(beginP));
     delayMicroseconds(200);  // Give STM32 time to allocate
-    
+}
+
+bool SPIMaster::sampleStreamData(int padIndex, const int16_t* buffer, uint32_t fromByte, uint32_t toByte) {
     // 2. DATA chunks (max 512 bytes = 256 samples per chunk)
     const uint16_t CHUNK_BYTES = 512;
-    uint32_t offset = 0;
+    uint32_t offset = fromByte;
     uint32_t chunkCount = 0;
-    
+
     // Build data packet: SampleDataHeader + raw audio data
     uint8_t dataPkt[8 + CHUNK_BYTES];
-    
-    while (offset < totalBytes) {
-        uint16_t chunkSize = (uint16_t)min((uint32_t)CHUNK_BYTES, totalBytes - offset);
-        
+    bool allOk = true;
+
+    while (offset < toByte) {
+        uint16_t chunkSize = (uint16_t)min((uint32_t)CHUNK_BYTES, toByte - offset);
+
         SampleDataHeader* hdr = (SampleDataHeader*)dataPkt;
         hdr->padIndex = (uint8_t)padIndex;
         hdr->reserved = 0;
         hdr->chunkSize = chunkSize;
         hdr->offset = offset;
-        
-        memcpy(dataPkt + sizeof(SampleDataHeader), ((uint8_t*)buffer) + offset, chunkSize);
-        
-        sendCommand(CMD_SAMPLE_DATA, dataPkt, sizeof(SampleDataHeader) + chunkSize);
+
+        memcpy(dataPkt + sizeof(SampleDataHeader), ((const uint8_t*)buffer) + offset, chunkSize);
+
+        if (!sendCommand(CMD_SAMPLE_DATA, dataPkt, sizeof(SampleDataHeader) + chunkSize)) allOk = false;
 
         offset += chunkSize;
         chunkCount++;
@@ -1150,30 +1613,36 @@ bool SPIMaster::transferSample(int padIndex, int16_t* buffer, uint32_t numSample
             esp_task_wdt_reset();
         }
     }
-    
+    return allOk;
+}
+
+bool SPIMaster::sampleStreamEnd(int padIndex, const int16_t* buffer, uint32_t numSamples) {
+    uint32_t totalBytes = numSamples * sizeof(int16_t);
+
     // 3. END
     SampleEndPayload endP = {};
     endP.padIndex = (uint8_t)padIndex;
     endP.status = 0;
-    endP.checksum = crc16((uint8_t*)buffer, totalBytes > 65535 ? 65535 : (uint16_t)totalBytes);
-    
-    sendCommand(CMD_SAMPLE_END, &endP, sizeof(endP));
+    endP.checksum = crc16((const uint8_t*)buffer, totalBytes > 65535 ? 65535 : (uint16_t)totalBytes);
+
+    bool ok = sendCommandDirect(CMD_SAMPLE_END, &endP, sizeof(endP));
 
     // Da tiempo a la Daisy para finalizar el buffer tras CMD_SAMPLE_END.
     // Sin este delay, samples grandes (>32KB) producen ruido al disparar
     // inmediatamente porque la STM32 aún está procesando los últimos chunks.
     uint32_t waitMs = totalBytes < 32768 ? 60 : (totalBytes < 131072 ? 120 : 200);
     vTaskDelay(pdMS_TO_TICKS(waitMs));
-
-    return true;
+    return ok;
 }
 
 void SPIMaster::unloadSample(int padIndex) {
+    invalidateSlots(padIndex, 1);
     SampleUnloadPayload p = {(uint8_t)padIndex};
     sendCommand(CMD_SAMPLE_UNLOAD, &p, sizeof(p));
 }
 
 void SPIMaster::unloadAllSamples() {
+    invalidateSlots();
     sendCommand(CMD_SAMPLE_UNLOAD_ALL, nullptr, 0);
 }
 
@@ -1204,6 +1673,7 @@ bool SPIMaster::sdLoadSample(int padIndex, const char* folder, const char* file)
     strncpy(p.folderName, folder, sizeof(p.folderName) - 1);
     strncpy(p.fileName, file, sizeof(p.fileName) - 1);
     p.padIndex = (uint8_t)padIndex;
+    invalidateSlots(padIndex, 1);
     return sendCommand(CMD_SD_LOAD_SAMPLE, &p, sizeof(p));
 }
 
@@ -1212,6 +1682,7 @@ bool SPIMaster::sdLoadKit(const char* kitName, uint8_t startPad, uint8_t maxPads
     strncpy(p.kitName, kitName, sizeof(p.kitName) - 1);
     p.startPad = startPad;
     p.maxPads = maxPads;
+    invalidateSlots(startPad, maxPads);
     return sendCommand(CMD_SD_LOAD_KIT, &p, sizeof(p));
 }
 
@@ -1224,6 +1695,7 @@ bool SPIMaster::sdGetStatus(SdStatusResponse& out) {
 }
 
 void SPIMaster::sdUnloadKit() {
+    invalidateSlots();
     sendCommand(CMD_SD_UNLOAD_KIT, nullptr, 0);
 }
 
@@ -1253,13 +1725,19 @@ void SPIMaster::getTrackPeaks(float* outPeaks, int count) {
     memcpy(outPeaks, cachedTrackPeaks, n * sizeof(float));
 }
 
+void SPIMaster::setPeakPolling(bool on) {
+    if (peakPolling == on) return;
+    peakPolling = on;
+    // Sin polling la caché conserva los últimos valores (/api/sysinfo los sigue mostrando)
+}
+
 bool SPIMaster::requestPeaks() {
     PeaksResponse resp;
     if (sendAndReceive(CMD_GET_PEAKS, nullptr, 0, &resp, sizeof(resp))) {
         memcpy(cachedTrackPeaks, resp.trackPeaks, sizeof(cachedTrackPeaks));
         cachedMasterPeak = resp.masterPeak;
         /* Si la comunicación funciona, confirmar conexión aunque el boot ping fallara */
-        if (!stm32Connected) stm32Connected = true;
+        markConnected();
         return true;
     }
     return false;
@@ -1280,14 +1758,28 @@ bool SPIMaster::ping(uint32_t& roundtripUs) {
     uint32_t start = micros();
     if (sendAndReceive(CMD_PING, &pingP, sizeof(pingP), &pong, sizeof(pong))) {
         roundtripUs = micros() - start;
-        if (!stm32Connected) stm32Connected = true;  // auto-reconnect si el boot ping falló
+        markConnected();  // auto-reconnect si el boot ping falló
         return true;
     }
     return false;
 }
 
+// Mientras no había enlace requestStatus() no mira el uptime: la Daisy pudo
+// reiniciarse (SDRAM vacía) o cargar otros samples sin que nos enterásemos.
+// Al (re)conectar la tabla de pads se da por perdida hasta el próximo
+// CMD_SAMPLE_HASHES y el uptime vuelve a contar desde cero.
+void SPIMaster::markConnected() {
+    if (stm32Connected) return;
+    invalidateSlots();
+    lastDaisyUptime = 0;
+    slotSyncPending = true;
+    stm32Connected = true;
+}
+
 void SPIMaster::resetDSP() {
     sendCommand(CMD_RESET, nullptr, 0);
+    invalidateSlots();
+    slotSyncPending = true;
     
     // Reset cached state
     for (int i = 0; i < MAX_AUDIO_TRACKS; i++) {
@@ -1614,6 +2106,12 @@ bool SPIMaster::requestStatus() {
     StatusResponse resp = {};
     if (sendAndReceive(CMD_GET_STATUS, nullptr, 0, &resp, sizeof(resp))) {
         cachedStatus = resp;
+        if (resp.uptime < lastDaisyUptime) {
+            // Reboot de la Daisy: su SDRAM ya no tiene lo que le enviamos
+            invalidateSlots();
+            slotSyncPending = true;
+        }
+        lastDaisyUptime = resp.uptime;
         return true;
     }
     return false;
@@ -1642,6 +2140,11 @@ bool SPIMaster::drainEvents() {
         for (int i = 0; i < evtResp.count; i++) {
             const NotifyEvent& evt = evtResp.events[i];
             totalDrained++;
+            // Cargas desde la SD de la Daisy: esos pads ya no tienen nuestro audio
+            uint32_t mask = evt.padMaskLo | ((uint32_t)evt.padMaskHi << 8) | ((uint32_t)evt.padMaskXtra << 16);
+            for (int p = 0; p < MAX_PADS; p++) {
+                if (mask & (1u << p)) invalidateSlots(p, 1);
+            }
             if (eventCallback) {
                 eventCallback(evt, eventUserData);
             }
@@ -17,10 +17,64 @@
 static constexpr uint16_t SPI_QUEUE_PAYLOAD_MAX = 96;
 struct SpiQueuedCmd {
     uint8_t  cmd;
+    uint8_t  tag;          // 0 = sin ack; si no, slot de CmdAck (beginTag)
     uint16_t payloadLen;
     uint8_t  payload[SPI_QUEUE_PAYLOAD_MAX];
 };
 
+// Acks extremo a extremo (CmdAck.h): los frames que genera un comando con
+// "rid" llevan un tag; Core1 publica cuándo sale cada uno por SPI.
+static constexpr uint8_t SPI_TAG_RING = 32;
+struct SpiTagResult {
+    uint16_t queued;    // frames encolados (o enviados en directo) con el tag
+    uint16_t dropped;   // cola llena: descartados
+    uint16_t staged;    // absorbidos por un batch abierto (salen con él, sin tag)
+    bool     untracked; // sin contexto libre para la task: frames sin tag
+};
+// Tag abierto por task (async_tcp y systemTask etiquetan a la vez sin pisarse)
+static constexpr uint8_t SPI_TAG_TASKS = 4;
+struct SpiTagCtx {
+    TaskHandle_t task;  // nullptr = libre
+    uint8_t      tag;
+    SpiTagResult res;
+};
+struct SpiTagCompletion {
+    uint8_t  tag;
+    bool     ok;        // sendCommandDirect completó la transferencia
+    uint32_t us;        // micros() al terminar
+};
+
+// Batch de comandos (WebInterface::applyBatch): mientras está abierto, los
+// sendCommand de la task que lo abrió se acumulan aquí en vez de ir a la cola;
+// los setters repetidos (mismo cmd + mismo índice) se quedan con el último
+// valor. Los frames de otras tasks (triggers en vivo de otro cliente, UDP)
+// siguen por la cola normal y anulan la entrada del batch que pisan.
+static constexpr uint16_t SPI_BATCH_MAX_CMDS = 96;
+static constexpr uint32_t SPI_BATCH_MAX_HOLD_MS = 250;   // espera máx. a un límite de step
+static constexpr uint16_t SPI_BATCH_RELEASE_CHUNK = 16;  // frames por process() al soltarlo
+static constexpr uint16_t SPI_BATCH_DEAD = 0xFFFF;       // payloadLen de una entrada anulada
+// Dedup de uploads de samples (CMD_SAMPLE_COPY / CMD_SAMPLE_HASHES): lo que
+// el master sabe que guarda cada pad de la Daisy
+struct DaisySlot {
+    uint32_t hash;       // XXH32 (SampleHash.h); 0 = vacío / desconocido
+    uint32_t samples;
+};
+struct SampleDedupStats {
+    uint32_t uploads;      // transferencias completas
+    uint32_t skipped;      // el pad ya tenía ese audio
+    uint32_t copies;       // CMD_SAMPLE_COPY desde otro pad
+    uint32_t bytesSaved;
+    uint32_t syncs;        // CMD_SAMPLE_HASHES respondidos
+};
+
+enum SpiBatchState : uint8_t {
+    SPI_BATCH_IDLE = 0,
+    SPI_BATCH_STAGING,      // Core0 acumulando (applyBatch en curso)
+    SPI_BATCH_PENDING,      // cerrado, esperando el siguiente step en Core1
+    SPI_BATCH_FLUSHING,     // Core0 lo está volcando a la cola (lleno / no atómico)
+    SPI_BATCH_RELEASING     // Core1 lo envía por tramos en process(), tras los triggers del step
+};
+
 // Audio constants (shared with STM32)
 #define SAMPLE_RATE 48000
 #define MAX_VOICES 10
@@ -316,11 +370,29 @@ public:
     // ══════════════════════════════════════════════════
     // SAMPLE TRANSFER (ESP32 PSRAM → STM32)
     // ══════════════════════════════════════════════════
-    bool setSampleBuffer(int padIndex, int16_t* buffer, uint32_t length);
-    bool transferSample(int padIndex, int16_t* buffer, uint32_t numSamples);
+    // hash = sampleHash() del buffer (0 = desconocido → siempre se envía). Si el
+    // pad ya tiene ese audio no se envía nada; si lo tiene otro pad, CMD_SAMPLE_COPY
+    bool setSampleBuffer(int padIndex, int16_t* buffer, uint32_t length, uint32_t hash = 0);
+    bool transferSample(int padIndex, int16_t* buffer, uint32_t numSamples, uint32_t hash = 0);
+    // Transferencia por tramos (upload en streaming): BEGIN con la longitud final,
+    // DATA según se convierte el audio, END cuando todo está enviado
+    void sampleStreamBegin(int padIndex, uint32_t numSamples);
+    bool sampleStreamData(int padIndex, const int16_t* buffer, uint32_t fromByte, uint32_t toByte);  // false si falló algún chunk
+    bool sampleStreamEnd(int padIndex, const int16_t* buffer, uint32_t numSamples);  // false si el END no salió
     void unloadSample(int padIndex);
     void unloadAllSamples();
 
+    // Tabla de pads de la Daisy. Un hash sólo se anota tras un END entregado:
+    // confirmSlotContent lo contrasta con CMD_SAMPLE_HASHES si la Daisy tiene
+    // tabla (si no, lo anota) e invalida el pad si no cuadra
+    bool confirmSlotContent(int padIndex, uint32_t hash, uint32_t numSamples);
+    void noteSlotContent(int padIndex, uint32_t hash, uint32_t numSamples);
+    void invalidateSlots(int firstPad = 0, int count = MAX_PADS);
+    bool syncSlotHashes();
+    bool hasSlotHashes() const { return daisySlotHashes; }
+    DaisySlot getSlot(int padIndex);
+    const SampleDedupStats& getDedupStats() const { return dedupStats; }
+
     // ══════════════════════════════════════════════════
     // DAISY SD CARD FILE SYSTEM
     //   Read kit folders/files from Daisy's SD card.
@@ -344,6 +416,9 @@ public:
     float getMasterPeak();
     void getTrackPeaks(float* outPeaks, int count);
     bool requestPeaks();               // Request peaks from slave (updates cache)
+    // Polling de peaks en process(): WebInterface lo apaga sin suscriptores de "levels"
+    void setPeakPolling(bool on);
+    bool isPeakPolling() const { return peakPolling; }
     bool requestActiveVoices();        // Request active voice count from slave
     bool requestCpuLoad();             // Request CPU % from slave
     bool requestStatus();              // Request full StatusResponse from slave
@@ -439,6 +514,27 @@ public:
     // JSON: {"type":"spi_log","name":"PING","cmd":238,"seq":3,"len":4,"ok":true,"try":1,"ms":12345}
     typedef void (*SpiLogCallback)(const char* json);
     void setSpiLogCallback(SpiLogCallback cb) { spiLogCallback = cb; }
+
+    // ══════════════════════════════════════════════════
+    // COMMAND BATCH (Core0 → Core1)
+    // ══════════════════════════════════════════════════
+    // beginBatch: false si ya hay otro batch abierto/pendiente (los comandos
+    // van entonces por la cola normal y anulan lo que pisen del anterior).
+    // endBatch: atStepBoundary = retener hasta releaseBatch() en el siguiente
+    // step (máx. SPI_BATCH_MAX_HOLD_MS); si no, pasa a la cola en orden.
+    // Devuelve el nº de frames SPI tras coalescer.
+    bool beginBatch();
+    uint16_t endBatch(bool atStepBoundary);
+    // Core1 (stepChangeCallback / process()): sólo marca el batch para salir;
+    // process() lo envía después de los triggers del step, SPI_BATCH_RELEASE_CHUNK
+    // frames por pasada, para no retrasar el step al que se alinea
+    void releaseBatch();
+    uint32_t getBatchCoalesced() const { return batchCoalesced; }
+
+    // Tags de ack: los sendCommand de la task que llama llevan tag hasta endTag()
+    void beginTag(uint8_t tag);
+    SpiTagResult endTag();
+    bool popTagCompletion(SpiTagCompletion* out);   // Core0 (WebInterface::update)
     
     // Process (called from task loop — handles IRQ, peak polling)
     void process();
@@ -448,6 +544,7 @@ private:
     uint32_t spiErrorCount;
     bool stm32Connected;
     float lastPingRttMs = -1.0f;
+    void markConnected();   // desconectado → conectado: tabla de pads a resincronizar
     
     // TX/RX buffers
     uint8_t txBuffer[SPI_MAX_PAYLOAD];
@@ -526,12 +623,46 @@ private:
     float cachedTrackPeaks[MAX_AUDIO_TRACKS];
     float cachedMasterPeak;
     uint32_t lastPeakRequest;
+    volatile bool peakPolling;
     
     // SPI mutex for thread safety (Core0 triggers vs Core1 process)
     SemaphoreHandle_t spiMutex;
     // Core0 → Core1 fire-and-forget command queue (avoids blocking WS handler)
     QueueHandle_t     spiCmdQueue;
 
+    // Batch staging (PSRAM, reservado en el primer beginBatch)
+    SpiQueuedCmd*     batchCmds;
+    volatile uint16_t batchCount;
+    volatile SpiBatchState batchState;
+    uint32_t          batchPendingMs;
+    uint32_t          batchCoalesced;   // frames ahorrados desde el arranque
+    TaskHandle_t      batchOwner;       // task de beginBatch: sólo sus frames se acumulan
+    uint16_t          batchReleaseIdx;  // siguiente entrada a enviar (RELEASING)
+    portMUX_TYPE      batchMux;
+    bool stageBatchCmd(uint8_t cmd, const void* payload, uint16_t payloadLen);
+    void supersedeBatchCmd(uint8_t cmd, const void* payload, uint16_t payloadLen);
+    void spillBatchToQueue();
+    void sendBatchChunk();
+
+    // Tags abiertos (uno por task) y anillo de frames etiquetados ya enviados
+    SpiTagCtx         tagCtx[SPI_TAG_TASKS];
+    volatile uint8_t  tagCtxOpen;       // nº de contextos en uso (atajo sin tags)
+    SpiTagCtx* currentTagCtx();
+    SpiTagCompletion  tagRing[SPI_TAG_RING];
+    volatile uint8_t  tagHead;
+    volatile uint8_t  tagTail;
+    portMUX_TYPE      tagMux;
+    void pushTagCompletion(uint8_t tag, bool ok);
+
+    // Pads de la Daisy (Core0 transfiere, Core1 invalida en eventos/reboot)
+    DaisySlot         daisySlots[MAX_PADS];
+    portMUX_TYPE      slotMux;
+    bool              daisySlotHashes;     // la Daisy respondió a CMD_SAMPLE_HASHES
+    volatile bool     slotSyncPending;
+    uint32_t          lastDaisyUptime;
+    SampleDedupStats  dedupStats;
+    int               findSlot(uint32_t hash, uint32_t numSamples, int exceptPad);
+
     // SPI log callback (diagnostics via WebSocket admin panel)
     SpiLogCallback spiLogCallback;
 
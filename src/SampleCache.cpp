@@ -0,0 +1,211 @@
+/*
+ * SampleCache.cpp
+ * RED808 caché LRU de PCM convertido (ver SampleCache.h)
+ */
+
+#include "SampleCache.h"
+#include "HeapProfiler.h"
+#include <Arduino.h>
+#include <freertos/semphr.h>
+
+struct SampleCacheEntry {
+  uint32_t pathHash;   // filtro rápido; la ruta completa está en _cachePaths
+  uint32_t fileSize;
+  uint32_t mtime;
+  uint32_t lastUse;
+  uint32_t samples;
+  int16_t* pcm;
+};
+
+static SampleCacheEntry _cache[SAMPLE_CACHE_SLOTS];
+static uint32_t _cacheTick = 0;
+static SampleCacheStats _stats = { 0, 0, SAMPLE_CACHE_DEFAULT_BUDGET, 0, 0, 0, 0 };
+static SemaphoreHandle_t _cacheMutex = nullptr;
+// Ruta completa de cada slot (PSRAM): dos rutas con el mismo FNV-1a de 32 bits
+// no deben devolver el PCM de la otra. Sin tabla la caché no admite entradas.
+static char (*_cachePaths)[SAMPLE_CACHE_PATH_MAX] = nullptr;
+
+static uint32_t cachePathHash(const char* path) {
+  uint32_t h = 2166136261u;   // FNV-1a
+  while (*path) {
+    h ^= (uint8_t)*path++;
+    h *= 16777619u;
+  }
+  return h ? h : 1;
+}
+
+void sampleCacheBegin() {
+  if (!_cacheMutex) _cacheMutex = xSemaphoreCreateRecursiveMutex();
+  if (!_cachePaths) {
+    _cachePaths = (char(*)[SAMPLE_CACHE_PATH_MAX])hpCalloc(SAMPLE_CACHE_SLOTS, SAMPLE_CACHE_PATH_MAX,
+                                                           HP_HEAP_PSRAM, "sample.cache.path");
+  }
+}
+
+bool sampleCacheLock(uint32_t waitMs) {
+  if (!_cacheMutex) return true;   // antes de begin(): sólo el arranque
+  TickType_t ticks = (waitMs == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(waitMs);
+  return xSemaphoreTakeRecursive(_cacheMutex, ticks) == pdTRUE;
+}
+
+void sampleCacheUnlock() {
+  if (_cacheMutex) xSemaphoreGiveRecursive(_cacheMutex);
+}
+
+// Lock de alcance para las funciones públicas
+struct CacheGuard {
+  CacheGuard() { sampleCacheLock(UINT32_MAX); }
+  ~CacheGuard() { sampleCacheUnlock(); }
+};
+
+static bool cacheSamePath(const SampleCacheEntry& e, uint32_t h, const char* path) {
+  return e.pcm && e.pathHash == h && strcmp(_cachePaths[&e - _cache], path) == 0;
+}
+
+static void cacheDrop(SampleCacheEntry& e) {
+  if (!e.pcm) return;
+  _stats.bytes -= e.samples * sizeof(int16_t);
+  _stats.entries--;
+  hpFree(e.pcm);
+  e.pcm = nullptr;
+  e.pathHash = 0;
+  _cachePaths[&e - _cache][0] = '\0';
+}
+
+static SampleCacheEntry* cacheOldest() {
+  SampleCacheEntry* oldest = nullptr;
+  for (auto& e : _cache) {
+    if (e.pcm && (!oldest || e.lastUse < oldest->lastUse)) oldest = &e;
+  }
+  return oldest;
+}
+
+// Entrada válida para la clave; una entrada de la misma ruta con otro
+// tamaño/mtime (fichero reescrito) se descarta
+static SampleCacheEntry* cacheLookup(const char* path, uint32_t fileSize, uint32_t mtime) {
+  if (!_cachePaths) return nullptr;
+  uint32_t h = cachePathHash(path);
+  for (auto& e : _cache) {
+    if (cacheSamePath(e, h, path)) {
+      if (e.fileSize == fileSize && e.mtime == mtime) return &e;
+      cacheDrop(e);
+      return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+uint32_t sampleCacheLength(const char* path, uint32_t fileSize, uint32_t mtime) {
+  CacheGuard g;
+  SampleCacheEntry* e = cacheLookup(path, fileSize, mtime);
+  if (!e) {
+    _stats.misses++;
+    return 0;
+  }
+  return e->samples;
+}
+
+bool sampleCacheCopy(const char* path, uint32_t fileSize, uint32_t mtime, int16_t* dst, uint32_t dstCap) {
+  CacheGuard g;
+  SampleCacheEntry* e = cacheLookup(path, fileSize, mtime);
+  if (!e || e->samples > dstCap) return false;
+  memcpy(dst, e->pcm, e->samples * sizeof(int16_t));
+  e->lastUse = ++_cacheTick;
+  _stats.hits++;
+  return true;
+}
+
+bool sampleCacheTouch(const char* path, uint32_t fileSize, uint32_t mtime) {
+  CacheGuard g;
+  SampleCacheEntry* e = cacheLookup(path, fileSize, mtime);
+  if (!e) return false;
+  e->lastUse = ++_cacheTick;
+  return true;
+}
+
+// Hace sitio para `bytes` dentro del presupuesto y devuelve un slot libre
+static SampleCacheEntry* cacheMakeRoom(uint32_t bytes) {
+  for (;;) {
+    SampleCacheEntry* freeSlot = nullptr;
+    for (auto& e : _cache) {
+      if (!e.pcm) { freeSlot = &e; break; }
+    }
+    if (freeSlot && _stats.bytes + bytes <= _stats.budget) return freeSlot;
+    SampleCacheEntry* oldest = cacheOldest();
+    if (!oldest) return nullptr;
+    cacheDrop(*oldest);
+    _stats.evictions++;
+  }
+}
+
+bool sampleCacheAdopt(const char* path, uint32_t fileSize, uint32_t mtime, int16_t* pcm, uint32_t samples) {
+  if (!pcm) return false;
+  CacheGuard g;
+  uint32_t bytes = samples * sizeof(int16_t);
+  size_t pathLen = strlen(path);
+  if (!_cachePaths || pathLen >= SAMPLE_CACHE_PATH_MAX) {
+    hpFree(pcm);
+    return false;
+  }
+  uint32_t h = cachePathHash(path);
+  for (auto& e : _cache) {
+    if (cacheSamePath(e, h, path)) cacheDrop(e);
+  }
+  SampleCacheEntry* slot = (bytes > 0 && bytes <= _stats.budget) ? cacheMakeRoom(bytes) : nullptr;
+  if (!slot) {
+    hpFree(pcm);
+    return false;
+  }
+  slot->pathHash = h;
+  memcpy(_cachePaths[slot - _cache], path, pathLen + 1);
+  slot->fileSize = fileSize;
+  slot->mtime = mtime;
+  slot->lastUse = ++_cacheTick;
+  slot->samples = samples;
+  slot->pcm = pcm;
+  _stats.bytes += bytes;
+  _stats.entries++;
+  _stats.inserts++;
+  return true;
+}
+
+bool sampleCacheInsert(const char* path, uint32_t fileSize, uint32_t mtime, const int16_t* pcm, uint32_t samples) {
+  size_t bytes = (size_t)samples * sizeof(int16_t);
+  if (!pcm || bytes == 0 || bytes > _stats.budget || !_cachePaths) return false;
+  if (strlen(path) >= SAMPLE_CACHE_PATH_MAX) return false;
+  if (ESP.getFreePsram() < bytes + SAMPLE_CACHE_PSRAM_RESERVE) return false;
+  int16_t* copy = (int16_t*)hpAlloc(bytes, HP_HEAP_PSRAM, "sample.cache");
+  if (!copy) return false;
+  memcpy(copy, pcm, bytes);
+  return sampleCacheAdopt(path, fileSize, mtime, copy, samples);
+}
+
+void sampleCacheReclaim(size_t bytes) {
+  CacheGuard g;
+  while (ESP.getFreePsram() < bytes) {
+    SampleCacheEntry* oldest = cacheOldest();
+    if (!oldest) break;
+    cacheDrop(*oldest);
+    _stats.evictions++;
+  }
+}
+
+void sampleCacheSetBudget(uint32_t bytes) {
+  CacheGuard g;
+  _stats.budget = bytes;
+  while (_stats.bytes > _stats.budget) {
+    SampleCacheEntry* oldest = cacheOldest();
+    if (!oldest) break;
+    cacheDrop(*oldest);
+    _stats.evictions++;
+  }
+}
+
+void sampleCacheClear() {
+  CacheGuard g;
+  for (auto& e : _cache) cacheDrop(e);
+}
+
+const SampleCacheStats& sampleCacheStats() {
+  return _stats;
+}
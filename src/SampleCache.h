@@ -0,0 +1,59 @@
+/*
+ * SampleCache.h
+ * RED808 caché LRU en PSRAM del PCM ya convertido (int16 mono a RS_TARGET_RATE)
+ * por ruta + tamaño + mtime: volver a cargar un sample reciente en un pad no
+ * relee ni reconvierte el WAV de LittleFS.
+ */
+
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SAMPLE_CACHE_SLOTS          64
+#define SAMPLE_CACHE_PATH_MAX       64    // ruta completa por entrada (como path[64] de SampleManager)
+#define SAMPLE_CACHE_DEFAULT_BUDGET (2 * 1024 * 1024)
+// La caché nunca deja menos PSRAM libre que esto (buffers de pads, uploads,
+// pirámides); al cargar un pad sin sitio se expulsan entradas (sampleCacheReclaim)
+#define SAMPLE_CACHE_PSRAM_RESERVE  (1024 * 1024)
+
+struct SampleCacheStats {
+  uint8_t  entries;
+  uint32_t bytes;
+  uint32_t budget;
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t inserts;
+  uint32_t evictions;
+};
+
+// ═══════════════════════════════════════════════════════
+// API
+// ═══════════════════════════════════════════════════════
+// Lock recursivo: loadSample / prefetch lo mantienen durante toda la carga
+// (comparten el resampler de SampleManager) y las funciones de abajo lo toman
+// también, así un upload en streaming (async_tcp) puede llamar a Reclaim.
+void sampleCacheBegin();
+bool sampleCacheLock(uint32_t waitMs);
+void sampleCacheUnlock();
+
+// Rutas de SAMPLE_CACHE_PATH_MAX o más no se cachean
+// Copia el PCM cacheado a dst (capacidad dstCap muestras). 0 = no está
+uint32_t sampleCacheLength(const char* path, uint32_t fileSize, uint32_t mtime);
+bool sampleCacheCopy(const char* path, uint32_t fileSize, uint32_t mtime, int16_t* dst, uint32_t dstCap);
+// true si está (y lo marca como recién usado), sin contar hit/miss
+bool sampleCacheTouch(const char* path, uint32_t fileSize, uint32_t mtime);
+
+// Copia pcm a una entrada nueva; false si no cabe en el presupuesto / PSRAM
+bool sampleCacheInsert(const char* path, uint32_t fileSize, uint32_t mtime, const int16_t* pcm, uint32_t samples);
+// Toma posesión de pcm (hpAlloc PSRAM); lo libera si no cabe
+bool sampleCacheAdopt(const char* path, uint32_t fileSize, uint32_t mtime, int16_t* pcm, uint32_t samples);
+
+// Expulsa por LRU hasta que haya `bytes` de PSRAM libre o la caché quede vacía
+void sampleCacheReclaim(size_t bytes);
+void sampleCacheSetBudget(uint32_t bytes);   // 0 = desactivada
+void sampleCacheClear();
+const SampleCacheStats& sampleCacheStats();
+
+#endif // SAMPLE_CACHE_H
@@ -0,0 +1,67 @@
+/*
+ * SampleHash.cpp
+ * RED808 XXH32 (ver SampleHash.h)
+ */
+
+#include "SampleHash.h"
+#include <string.h>
+
+static const uint32_t P1 = 2654435761u;
+static const uint32_t P2 = 2246822519u;
+static const uint32_t P3 = 3266489917u;
+static const uint32_t P4 = 668265263u;
+static const uint32_t P5 = 374761393u;
+
+static inline uint32_t rotl(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+static inline uint32_t round32(uint32_t acc, uint32_t in) { return rotl(acc + in * P2, 13) * P1; }
+
+static inline uint32_t rd32(const uint8_t* p, bool aligned) {
+  if (aligned) return *(const uint32_t*)p;
+  uint32_t v;
+  memcpy(&v, p, 4);   // Xtensa: sin lecturas desalineadas
+  return v;
+}
+
+uint32_t xxh32(const void* data, size_t len, uint32_t seed) {
+  const uint8_t* p = (const uint8_t*)data;
+  const uint8_t* end = p + len;
+  const bool aligned = ((uintptr_t)p & 3) == 0;
+  uint32_t h;
+
+  if (len >= 16) {
+    uint32_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+    const uint8_t* limit = end - 16;
+    do {
+      v1 = round32(v1, rd32(p, aligned));
+      v2 = round32(v2, rd32(p + 4, aligned));
+      v3 = round32(v3, rd32(p + 8, aligned));
+      v4 = round32(v4, rd32(p + 12, aligned));
+      p += 16;
+    } while (p <= limit);
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+  } else {
+    h = seed + P5;
+  }
+  h += (uint32_t)len;
+
+  while (p + 4 <= end) {
+    h = rotl(h + rd32(p, aligned) * P3, 17) * P4;
+    p += 4;
+  }
+  while (p < end) {
+    h = rotl(h + (*p++) * P5, 11) * P1;
+  }
+
+  h ^= h >> 15;
+  h *= P2;
+  h ^= h >> 13;
+  h *= P3;
+  h ^= h >> 16;
+  return h;
+}
+
+uint32_t sampleHash(const int16_t* pcm, uint32_t samples) {
+  if (!pcm || samples == 0) return 0;
+  uint32_t h = xxh32(pcm, (size_t)samples * sizeof(int16_t), 0);
+  return h ? h : 1;
+}
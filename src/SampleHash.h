@@ -0,0 +1,20 @@
+/*
+ * SampleHash.h
+ * RED808 hash de contenido del PCM de un pad (XXH32, semilla 0): identifica
+ * audio idéntico para no reenviarlo a la Daisy (ver SPIMaster::transferSample).
+ */
+
+#ifndef SAMPLE_HASH_H
+#define SAMPLE_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// XXH32 estándar (mismo resultado que xxhash.xxh32 de Python / la Daisy).
+// Con data alineado a 4 lee palabras de 32 bits; si no, byte a byte
+uint32_t xxh32(const void* data, size_t len, uint32_t seed);
+
+// Hash de un buffer de pad; 0 se reserva para "desconocido"
+uint32_t sampleHash(const int16_t* pcm, uint32_t samples);
+
+#endif // SAMPLE_HASH_H
@@ -0,0 +1,362 @@
+/*
+ * SampleIndex.cpp
+ * RED808 índice de samples de LittleFS (ver SampleIndex.h)
+ */
+
+#include "SampleIndex.h"
+#include "HeapProfiler.h"
+#include "SPIMaster.h"   // SAMPLE_RATE para .raw
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <freertos/semphr.h>
+
+#define SAMPLE_INDEX_MAX        4096
+#define SAMPLE_INDEX_HEADROOM   32     // altas sin realloc
+#define SAMPLE_INDEX_MAX_FOLDERS 32
+
+struct SampleFolderRange {
+  char     name[16];
+  uint32_t first;
+  uint16_t count;
+};
+
+static SampleIndexEntry* _idx = nullptr;   // PSRAM, ordenado por (folder, name)
+static uint32_t _idxCount = 0;
+static uint32_t _idxCap = 0;
+static bool _idxReady = false;
+static SampleFolderRange _folders[SAMPLE_INDEX_MAX_FOLDERS];
+static uint8_t _folderCount = 0;
+static SemaphoreHandle_t _idxMutex = nullptr;
+
+bool sampleIndexLock(uint32_t waitMs) {
+  if (!_idxMutex) return true;   // antes de begin(): sólo el arranque
+  TickType_t ticks = (waitMs == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(waitMs);
+  return xSemaphoreTakeRecursive(_idxMutex, ticks) == pdTRUE;
+}
+
+void sampleIndexUnlock() {
+  if (_idxMutex) xSemaphoreGiveRecursive(_idxMutex);
+}
+
+// Lock de alcance para las funciones públicas
+struct IndexGuard {
+  IndexGuard() { sampleIndexLock(UINT32_MAX); }
+  ~IndexGuard() { sampleIndexUnlock(); }
+};
+
+static int compareEntries(const void* a, const void* b) {
+  const SampleIndexEntry* x = (const SampleIndexEntry*)a;
+  const SampleIndexEntry* y = (const SampleIndexEntry*)b;
+  int c = strncmp(x->folder, y->folder, sizeof(x->folder));
+  return c ? c : strncmp(x->name, y->name, sizeof(x->name));
+}
+
+static int compareKey(const SampleIndexEntry& e, const char* folder, const char* name) {
+  int c = strncmp(e.folder, folder, sizeof(e.folder));
+  return c ? c : strncmp(e.name, name, sizeof(e.name));
+}
+
+// Tabla de rangos por carpeta: sampleIndexFolder no recorre los registros
+static void rebuildFolderRanges() {
+  _folderCount = 0;
+  for (uint32_t i = 0; i < _idxCount; i++) {
+    if (_folderCount > 0 &&
+        strncmp(_folders[_folderCount - 1].name, _idx[i].folder, sizeof(_idx[i].folder)) == 0) {
+      _folders[_folderCount - 1].count++;
+      continue;
+    }
+    if (_folderCount >= SAMPLE_INDEX_MAX_FOLDERS) break;
+    SampleFolderRange& r = _folders[_folderCount++];
+    memcpy(r.name, _idx[i].folder, sizeof(r.name));
+    r.first = i;
+    r.count = 1;
+  }
+}
+
+static bool reserveEntries(uint32_t cap) {
+  if (cap <= _idxCap) return true;
+  if (cap > SAMPLE_INDEX_MAX) return false;
+  SampleIndexEntry* n = (SampleIndexEntry*)hpRealloc(_idx, cap * sizeof(SampleIndexEntry),
+                                                     HP_HEAP_PSRAM, "sample.index");
+  if (!n) return false;
+  _idx = n;
+  _idxCap = cap;
+  return true;
+}
+
+static bool isSampleExt(const char* name) {
+  size_t n = strlen(name);
+  return n > 4 && (strcasecmp(name + n - 4, ".wav") == 0 || strcasecmp(name + n - 4, ".raw") == 0);
+}
+
+static bool loadIndexFile() {
+  File f = LittleFS.open(SAMPLE_INDEX_PATH, "r");
+  if (!f) return false;
+  uint8_t hdr[16];
+  bool ok = f.read(hdr, sizeof(hdr)) == sizeof(hdr) &&
+            memcmp(hdr, SAMPLE_INDEX_MAGIC, 4) == 0 &&
+            (hdr[4] | (hdr[5] << 8)) == SAMPLE_INDEX_VERSION &&
+            (hdr[6] | (hdr[7] << 8)) == sizeof(SampleIndexEntry);
+  uint32_t count = hdr[8] | (hdr[9] << 8) | ((uint32_t)hdr[10] << 16) | ((uint32_t)hdr[11] << 24);
+  ok = ok && count <= SAMPLE_INDEX_MAX &&
+       f.size() == sizeof(hdr) + (size_t)count * sizeof(SampleIndexEntry) &&
+       reserveEntries(count + SAMPLE_INDEX_HEADROOM);
+  if (ok && count > 0) {
+    size_t bytes = (size_t)count * sizeof(SampleIndexEntry);
+    ok = f.read((uint8_t*)_idx, bytes) == bytes;
+  }
+  f.close();
+  if (!ok) return false;
+
+  _idxCount = count;
+  for (uint32_t i = 0; i < count; i++) {
+    _idx[i].folder[sizeof(_idx[i].folder) - 1] = '\0';
+    _idx[i].name[sizeof(_idx[i].name) - 1] = '\0';
+  }
+  // El script ya lo entrega ordenado; qsort sólo si alguien lo editó a mano
+  for (uint32_t i = 1; i < count; i++) {
+    if (compareEntries(&_idx[i - 1], &_idx[i]) > 0) {
+      qsort(_idx, count, sizeof(SampleIndexEntry), compareEntries);
+      break;
+    }
+  }
+  return true;
+}
+
+// Fallback sin índice de build: un único recorrido de LittleFS, luego se persiste
+static uint32_t scanLibrary() {
+  _idxCount = 0;
+  File root = LittleFS.open("/");
+  if (!root || !root.isDirectory()) return 0;
+  File dir = root.openNextFile();
+  while (dir) {
+    String folder = dir.name();
+    int slash = folder.lastIndexOf('/');
+    if (slash >= 0) folder = folder.substring(slash + 1);
+    if (dir.isDirectory() && folder != "web" && folder != "midi" &&
+        folder.length() < sizeof(SampleIndexEntry::folder)) {
+      File f = dir.openNextFile();
+      while (f) {
+        String name = f.name();
+        slash = name.lastIndexOf('/');
+        if (slash >= 0) name = name.substring(slash + 1);
+        bool want = !f.isDirectory() && isSampleExt(name.c_str()) &&
+                    name.length() < sizeof(SampleIndexEntry::name);
+        f.close();
+        if (want && (_idxCount < _idxCap || reserveEntries(_idxCap + 64))) {
+          if (sampleIndexProbeFile(folder.c_str(), name.c_str(), &_idx[_idxCount])) _idxCount++;
+          if ((_idxCount & 7) == 0) yield();
+        }
+        f = dir.openNextFile();
+      }
+    }
+    dir.close();
+    dir = root.openNextFile();
+  }
+  root.close();
+  if (_idxCount > 1) qsort(_idx, _idxCount, sizeof(SampleIndexEntry), compareEntries);
+  return _idxCount;
+}
+
+bool sampleIndexBegin() {
+  if (_idxReady) return true;
+  if (!_idxMutex) _idxMutex = xSemaphoreCreateRecursiveMutex();
+  IndexGuard g;
+  uint32_t t0 = millis();
+  bool fromFile = loadIndexFile();
+  if (!fromFile) {
+    if (!reserveEntries(64)) return false;
+    scanLibrary();
+    sampleIndexSave();
+  }
+  rebuildFolderRanges();
+  _idxReady = true;
+  Serial.printf("[SampleIndex] %lu samples en %u carpetas (%s, %lu ms)\n",
+                (unsigned long)_idxCount, _folderCount, fromFile ? "samples.idx" : "escaneo",
+                (unsigned long)(millis() - t0));
+  return true;
+}
+
+bool sampleIndexReady() { return _idxReady; }
+uint32_t sampleIndexCount() { return _idxCount; }
+
+bool sampleIndexFolder(const char* folder, const SampleIndexEntry** first, uint16_t* count) {
+  *first = nullptr;
+  *count = 0;
+  if (!_idxReady || !folder) return false;
+  IndexGuard g;
+  for (uint8_t i = 0; i < _folderCount; i++) {
+    if (strncmp(_folders[i].name, folder, sizeof(_folders[i].name)) == 0) {
+      *first = &_idx[_folders[i].first];
+      *count = _folders[i].count;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Posición del registro o punto de inserción (found = false)
+static uint32_t lowerBound(const char* folder, const char* name, bool* found) {
+  uint32_t lo = 0, hi = _idxCount;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (compareKey(_idx[mid], folder, name) < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  *found = lo < _idxCount && compareKey(_idx[lo], folder, name) == 0;
+  return lo;
+}
+
+const SampleIndexEntry* sampleIndexFind(const char* folder, const char* name) {
+  if (!_idxReady || !folder || !name) return nullptr;
+  IndexGuard g;
+  bool found;
+  uint32_t pos = lowerBound(folder, name, &found);
+  return found ? &_idx[pos] : nullptr;
+}
+
+static bool indexUpsert(const SampleIndexEntry& e) {
+  bool found;
+  uint32_t pos = lowerBound(e.folder, e.name, &found);
+  if (!found) {
+    if (_idxCount >= _idxCap && !reserveEntries(_idxCap + SAMPLE_INDEX_HEADROOM)) return false;
+    memmove(&_idx[pos + 1], &_idx[pos], (_idxCount - pos) * sizeof(SampleIndexEntry));
+    _idxCount++;
+  }
+  _idx[pos] = e;
+  rebuildFolderRanges();
+  return true;
+}
+
+static bool indexRemove(const char* folder, const char* name) {
+  bool found;
+  uint32_t pos = lowerBound(folder, name, &found);
+  if (!found) return false;
+  memmove(&_idx[pos], &_idx[pos + 1], (_idxCount - pos - 1) * sizeof(SampleIndexEntry));
+  _idxCount--;
+  rebuildFolderRanges();
+  return true;
+}
+
+bool sampleIndexRefresh(const char* folder, const char* name) {
+  if (!_idxReady || !folder || !name) return false;
+  // La cabecera se lee fuera del lock: los lectores sólo esperan al cambio
+  SampleIndexEntry e;
+  bool probed = sampleIndexProbeFile(folder, name, &e);
+  IndexGuard g;
+  const SampleIndexEntry* cur = sampleIndexFind(folder, name);
+  bool changed;
+  if (!probed) {
+    changed = cur && indexRemove(folder, name);
+  } else if (cur && cur->size == e.size) {
+    return false;   // el pico medido en build sigue valiendo
+  } else {
+    changed = indexUpsert(e);
+  }
+  if (changed) sampleIndexSave();
+  return changed;
+}
+
+bool sampleIndexSave() {
+  IndexGuard g;
+  File f = LittleFS.open(SAMPLE_INDEX_PATH, "w");
+  if (!f) return false;
+  uint8_t hdr[16] = {};
+  memcpy(hdr, SAMPLE_INDEX_MAGIC, 4);
+  hdr[4] = SAMPLE_INDEX_VERSION & 0xFF;
+  hdr[5] = SAMPLE_INDEX_VERSION >> 8;
+  hdr[6] = sizeof(SampleIndexEntry) & 0xFF;
+  hdr[7] = sizeof(SampleIndexEntry) >> 8;
+  for (int b = 0; b < 4; b++) hdr[8 + b] = (uint8_t)(_idxCount >> (b * 8));
+  size_t bytes = (size_t)_idxCount * sizeof(SampleIndexEntry);
+  bool ok = f.write(hdr, sizeof(hdr)) == sizeof(hdr) &&
+            (bytes == 0 || f.write((const uint8_t*)_idx, bytes) == bytes);
+  f.close();
+  if (!ok) LittleFS.remove(SAMPLE_INDEX_PATH);   // mejor sin índice que con uno truncado
+  return ok;
+}
+
+bool sampleIndexProbeFile(const char* folder, const char* name, SampleIndexEntry* out) {
+  if (strlen(folder) >= sizeof(out->folder) || strlen(name) >= sizeof(out->name)) return false;
+  char path[64];
+  snprintf(path, sizeof(path), "/%s/%s", folder, name);
+  File f = LittleFS.open(path, "r");
+  if (!f) return false;
+
+  memset(out, 0, sizeof(*out));
+  strncpy(out->folder, folder, sizeof(out->folder) - 1);
+  strncpy(out->name, name, sizeof(out->name) - 1);
+  out->size = f.size();
+  out->peak = SAMPLE_PEAK_UNKNOWN;
+  out->knobCount = sampleIndexParseKnobs(folder, name, out->knobs);
+
+  size_t n = strlen(name);
+  bool ok = true;
+  if (strcasecmp(name + n - 4, ".raw") == 0) {
+    out->format = SAMPLE_FMT_RAW;
+    out->rate = SAMPLE_RATE;
+    out->channels = 1;
+    out->bits = 16;
+    out->frames = out->size / 2;
+  } else {
+    // Mismo recorrido de chunks que SampleManager::parseWavFile, sin leer PCM
+    out->format = SAMPLE_FMT_WAV;
+    uint8_t hdr[16];
+    ok = f.read(hdr, 12) == 12 && memcmp(hdr, "RIFF", 4) == 0 && memcmp(hdr + 8, "WAVE", 4) == 0;
+    uint32_t pos = 12;
+    bool fmtFound = false;
+    int guard = 32;
+    while (ok && pos + 8 <= out->size && guard-- > 0) {
+      f.seek(pos);
+      if (f.read(hdr, 8) != 8) break;
+      uint32_t chunkSize = hdr[4] | (hdr[5] << 8) | ((uint32_t)hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+      if (memcmp(hdr, "fmt ", 4) == 0) {
+        if (chunkSize < 16 || f.read(hdr, 16) != 16) { ok = false; break; }
+        out->channels = (uint8_t)(hdr[2] | (hdr[3] << 8));
+        out->rate = hdr[4] | (hdr[5] << 8) | ((uint32_t)hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+        out->bits = (uint8_t)(hdr[14] | (hdr[15] << 8));
+        fmtFound = true;
+      } else if (memcmp(hdr, "data", 4) == 0) {
+        uint32_t avail = out->size - (pos + 8);
+        if (chunkSize > avail) chunkSize = avail;
+        uint32_t frameBytes = (out->bits / 8) * out->channels;
+        if (fmtFound && frameBytes > 0) out->frames = chunkSize / frameBytes;
+        break;
+      }
+      pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    // Igual que readWavInfo: un WAV ilegible se lista con formato a 0
+    if (!ok || !fmtFound) {
+      out->channels = 0;
+      out->rate = 0;
+      out->bits = 0;
+      out->frames = 0;
+    }
+  }
+  f.close();
+  return true;
+}
+
+uint8_t sampleIndexParseKnobs(const char* folder, const char* name, uint8_t knobs[3]) {
+  size_t fl = strlen(folder);
+  if (fl == 0 || strncasecmp(name, folder, fl) != 0) return 0;
+  const char* p = name + fl;
+  const char* dot = strrchr(p, '.');
+  if (!dot) return 0;
+  size_t digits = dot - p;
+  if (digits == 0 || (digits & 1) || digits > 6) return 0;
+  for (size_t i = 0; i < digits; i++) {
+    if (p[i] < '0' || p[i] > '9') return 0;
+  }
+  uint8_t n = (uint8_t)(digits / 2);
+  for (uint8_t k = 0; k < n; k++) knobs[k] = (uint8_t)((p[k * 2] - '0') * 10 + (p[k * 2 + 1] - '0'));
+  return n;
+}
+
+const char* sampleIndexFormatName(uint8_t format) {
+  switch (format) {
+    case SAMPLE_FMT_WAV: return "wav";
+    case SAMPLE_FMT_RAW: return "raw";
+    default:             return "";
+  }
+}
@@ -0,0 +1,77 @@
+/*
+ * SampleIndex.h
+ * RED808 índice binario de la librería de samples de LittleFS (/samples.idx):
+ * lo genera tools/prepare_data_gz.py y el firmware lo carga una vez en PSRAM.
+ * Listados y conteos por familia sin abrir directorios ni cabeceras WAV.
+ */
+
+#ifndef SAMPLE_INDEX_H
+#define SAMPLE_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ═══════════════════════════════════════════════════════
+// FORMATO DEL FICHERO (little-endian)
+// ═══════════════════════════════════════════════════════
+// Cabecera 16 B: "S8IX", u16 versión, u16 tamaño de registro, u32 nº de
+// registros, u32 reservado. Después los registros, ordenados por
+// (folder, name) con comparación de bytes → cada carpeta es un rango
+// contiguo y la búsqueda por nombre es binaria.
+// Mantener sincronizado con _write_sample_index en tools/prepare_data_gz.py.
+#define SAMPLE_INDEX_PATH     "/samples.idx"
+#define SAMPLE_INDEX_MAGIC    "S8IX"
+#define SAMPLE_INDEX_VERSION  2
+
+#define SAMPLE_FMT_WAV   1
+#define SAMPLE_FMT_RAW   2
+
+#define SAMPLE_PEAK_UNKNOWN  0xFFFF   // índice generado en el equipo (sin leer el PCM)
+
+struct __attribute__((packed)) SampleIndexEntry {
+  char     folder[16];   // carpeta de primer nivel sin '/' ("BD", "xtra", "RED 808 KARZ")
+  char     name[40];     // nombre de fichero, NUL-terminado
+  uint32_t size;         // bytes del fichero
+  uint32_t frames;       // frames de audio (por canal)
+  uint32_t rate;
+  uint16_t peak;         // |pico| en escala 16-bit, SAMPLE_PEAK_UNKNOWN si no se midió
+  uint8_t  channels;
+  uint8_t  bits;
+  uint8_t  format;       // SAMPLE_FMT_*
+  uint8_t  knobCount;    // posiciones de knob codificadas en el nombre (BD2550 → 25, 50)
+  uint8_t  knobs[3];
+  uint8_t  reserved[3];
+  uint32_t srcCrc;       // CRC-32 (zlib) del fichero entero, 0 = desconocido (registro hecho en el equipo)
+};
+static_assert(sizeof(SampleIndexEntry) == 84, "SampleIndexEntry: 84 bytes en disco");
+
+// ═══════════════════════════════════════════════════════
+// API
+// ═══════════════════════════════════════════════════════
+// sampleIndexRefresh llega desde loadSample por WS (async_tcp) y por UDP
+// (systemTask) y puede mover/realocar el array. Lock recursivo: quien use
+// los punteros de Folder/Find lo mantiene mientras los lee; las funciones de
+// abajo lo toman también. Orden: caché de samples → índice, nunca al revés.
+bool sampleIndexBegin();      // crea el lock; carga SAMPLE_INDEX_PATH o escanea y lo guarda
+bool sampleIndexLock(uint32_t waitMs);
+void sampleIndexUnlock();      // carga SAMPLE_INDEX_PATH o, si falta/no vale, escanea y lo guarda
+bool sampleIndexReady();
+uint32_t sampleIndexCount();
+
+// Rango de una carpeta; false si no existe (first/count quedan a nullptr/0).
+// Los punteros sólo valen con sampleIndexLock tomado.
+bool sampleIndexFolder(const char* folder, const SampleIndexEntry** first, uint16_t* count);
+const SampleIndexEntry* sampleIndexFind(const char* folder, const char* name);
+
+// Alta/baja incremental de un fichero según lo que haya en LittleFS (nuevo,
+// cambiado de tamaño o borrado); persiste el índice si cambió. true = cambió
+bool sampleIndexRefresh(const char* folder, const char* name);
+bool sampleIndexSave();
+
+// Rellena un registro leyendo la cabecera del fichero de LittleFS (sin PCM)
+bool sampleIndexProbeFile(const char* folder, const char* name, SampleIndexEntry* out);
+// Knobs del nombre: prefijo de familia + pares de dígitos ("BD2550.WAV")
+uint8_t sampleIndexParseKnobs(const char* folder, const char* name, uint8_t knobs[3]);
+const char* sampleIndexFormatName(uint8_t format);
+
+#endif // SAMPLE_INDEX_H
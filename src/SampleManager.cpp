@@ -4,6 +4,12 @@
  */
 
 #include "SampleManager.h"
+#include "HeapProfiler.h"
+#include "PcmConvert.h"
+#include "PcmStore.h"
+#include "SampleCache.h"
+#include "SampleHash.h"
+#include "SampleIndex.h"
 
 extern SPIMaster spiMaster;
 
@@ -11,7 +17,10 @@ SampleManager::SampleManager() {
   for (int i = 0; i < MAX_SAMPLES; i++) {
     sampleBuffers[i] = nullptr;
     sampleLengths[i] = 0;
+    sampleHashes[i] = 0;
+    peakPyramids[i] = nullptr;
     memset(sampleNames[i], 0, 32);
+    samplePaths[i][0] = '\0';
   }
 }
 
@@ -23,6 +32,7 @@ bool SampleManager::begin() {
   if (!psramFound()) {
     return false;
   }
+  sampleCacheBegin();
   
   return true;
 }
@@ -31,69 +41,238 @@ bool SampleManager::loadSample(const char* filename, int padIndex) {
   if (padIndex < 0 || padIndex >= MAX_SAMPLES) {
     return false;
   }
+
+  // Serializa con el prefetch y con otras cargas (comparten resampler y caché)
+  sampleCacheLock(UINT32_MAX);
   
-  // Unload existing sample if any
-  if (sampleBuffers[padIndex] != nullptr) {
-    unloadSample(padIndex);
+  // Sólo la copia local: si el audio nuevo es el mismo que ya tiene la Daisy
+  // (recarga de kit) no hace falta ni el UNLOAD ni la transferencia
+  freeSampleBuffer(padIndex);
+  
+  uint32_t t0 = micros();
+  int16_t* buf = nullptr;
+  uint32_t numSamples = 0;
+  uint32_t fileBytes = 0;
+  bool cached = false;
+  bool success;
+  // Empaquetado en la partición PCM: el pad apunta a la flash mapeada
+  const PcmStoreEntry* stored = pcmStoreFind(filename);
+  if (stored) {
+    buf = (int16_t*)pcmStoreSamples(stored);
+    numSamples = stored->samples;
+    fileBytes = stored->srcSize;
+    success = true;
+  } else {
+    success = readSampleFile(filename, &buf, &numSamples, &fileBytes, &cached);
   }
+  sampleCacheUnlock();
+  
+  if (!success) {
+    spiMaster.unloadSample(padIndex);
+    return false; 
+  }
+
+  uint32_t us = micros() - t0;
+  loadStats.loads++;
+  loadStats.lastUs = us;
+  loadStats.lastBytes = fileBytes;
+  loadStats.lastCached = cached;
+  loadStats.lastStored = stored != nullptr;
+  if (stored) {
+    loadStats.storeHits++;
+  } else if (cached) {
+    loadStats.cacheHits++;
+  } else {
+    // máximo y media sólo de cargas reales (fichero + conversión)
+    if (us > loadStats.maxUs) loadStats.maxUs = us;
+    loadStats.totalUs += us;
+    loadStats.totalBytes += fileBytes;
+  }
+  
+  sampleBuffers[padIndex] = buf;
+  sampleLengths[padIndex] = numSamples;
+  sampleHashes[padIndex] = stored ? stored->hash : sampleHash(buf, numSamples);
+  strncpy(samplePaths[padIndex], filename, sizeof(samplePaths[padIndex]) - 1);
+  samplePaths[padIndex][sizeof(samplePaths[padIndex]) - 1] = '\0';
+
+  // Store sample name
+  const char* name = strrchr(filename, '/');
+  if (name) name++; // Skip '/'
+  else name = filename;
+  strncpy(sampleNames[padIndex], name, 31);
+  sampleNames[padIndex][31] = '\0';
+  rebuildPeaks(padIndex);
   
-  // Open file
+  // Register with SPI Master → STM32 audio slave
+  spiMaster.setSampleBuffer(padIndex, sampleBuffers[padIndex], sampleLengths[padIndex], sampleHashes[padIndex]);
+  
+  
+  return true;
+}
+
+// Fichero de LittleFS → PCM en un buffer nuevo. Primero la caché (clave
+// ruta + tamaño + mtime); si no está, lectura + conversión y copia a la caché.
+// outBuf == nullptr → sólo calentar la caché (prefetch). Con el lock tomado.
+bool SampleManager::readSampleFile(const char* filename, int16_t** outBuf, uint32_t* outLen,
+                                   uint32_t* outFileBytes, bool* outCached) {
+  if (!outBuf && pcmStoreFind(filename)) return true;   // ya en flash, nada que calentar
   fs::File file = LittleFS.open(filename, "r");
   if (!file) {
     return false;
   }
-  
+  uint32_t fileBytes = (uint32_t)file.size();
+  uint32_t mtime = (uint32_t)file.getLastWrite();
+  if (outFileBytes) *outFileBytes = fileBytes;
+  if (outCached) *outCached = false;
+
+  if (!outBuf) {
+    if (sampleCacheTouch(filename, fileBytes, mtime)) {
+      file.close();
+      return true;
+    }
+  } else {
+    uint32_t n = sampleCacheLength(filename, fileBytes, mtime);
+    int16_t* buf = n ? allocPsramSamples(n) : nullptr;
+    if (buf) {
+      if (sampleCacheCopy(filename, fileBytes, mtime, buf, n)) {
+        file.close();
+        *outBuf = buf;
+        *outLen = n;
+        if (outCached) *outCached = true;
+        return true;
+      }
+      hpFree(buf);   // expulsada por el propio allocPsramSamples: leer del fichero
+    }
+  }
+
+  int16_t* buf = nullptr;
+  uint32_t numSamples = 0;
   bool success = false;
   String fname = String(filename);
 
   // DETECT .RAW OR .WAV
   if (fname.endsWith(".raw") || fname.endsWith(".RAW")) {
     // --- LOAD RAW (No Header, 16-bit signed, Mono) ---
-    size_t fileSize = file.size();
-    
-    uint32_t numSamples = fileSize / 2; // 16-bit = 2 bytes per sample
-    
-    if (allocateSampleBuffer(padIndex, numSamples)) {
-      size_t bytesRead = file.read((uint8_t*)sampleBuffers[padIndex], fileSize);
-      if (bytesRead == fileSize) {
-        sampleLengths[padIndex] = numSamples;
+    numSamples = fileBytes / 2; // 16-bit = 2 bytes per sample
+    buf = allocPsramSamples(numSamples);
+    if (buf) {
+      size_t bytesRead = file.read((uint8_t*)buf, numSamples * 2);
+      if (bytesRead == numSamples * 2) {
         success = true;
       } else {
-        freeSampleBuffer(padIndex);
+        hpFree(buf);
       }
     }
   } else {
     // --- LOAD WAV (With Header Parsing) ---
     String parseErr;
-    success = parseWavFile(file, padIndex, parseErr);
-    if (!success) {
-      // Store last error for caller to surface
+    success = parseWavFile(file, &buf, &numSamples, parseErr);
+    if (!success && outBuf) {
+      // Store last error for caller to surface (el prefetch no lo pisa)
       strncpy(lastParseError, parseErr.c_str(), sizeof(lastParseError) - 1);
       lastParseError[sizeof(lastParseError) - 1] = '\0';
     }
   }
   
   file.close();
-  
-  if (!success) {
-    return false; 
+  if (!success) return false;
+
+  if (!outBuf) {
+    // Prefetch: el buffer pasa a la caché sin copia
+    return sampleCacheAdopt(filename, fileBytes, mtime, buf, numSamples);
   }
-  
-  // Store sample name
-  const char* name = strrchr(filename, '/');
-  if (name) name++; // Skip '/'
-  else name = filename;
-  strncpy(sampleNames[padIndex], name, 31);
-  sampleNames[padIndex][31] = '\0';
-  
-  // Register with SPI Master → STM32 audio slave
-  spiMaster.setSampleBuffer(padIndex, sampleBuffers[padIndex], sampleLengths[padIndex]);
-  
-  
+  sampleCacheInsert(filename, fileBytes, mtime, buf, numSamples);
+  *outBuf = buf;
+  *outLen = numSamples;
   return true;
 }
 
-bool SampleManager::parseWavFile(fs::File& file, int padIndex, String& errOut) {
+// ─── Prefetch ────────────────────────────────────────────────────────────────
+// Cola pequeña de rutas a calentar en la caché; la vacía prefetchStep() desde
+// systemTask, un fichero por llamada y sólo si nadie está cargando.
+static portMUX_TYPE _prefetchMux = portMUX_INITIALIZER_UNLOCKED;
+
+void SampleManager::queuePrefetch(const char* path) {
+  if (!path || !path[0] || sampleCacheStats().budget == 0) return;
+  portENTER_CRITICAL(&_prefetchMux);
+  bool dup = false;
+  for (uint8_t i = 0; i < prefetchCount; i++) {
+    uint8_t slot = (prefetchHead + i) % SAMPLE_PREFETCH_QUEUE;
+    if (strcmp(prefetchQueue[slot], path) == 0) { dup = true; break; }
+  }
+  if (!dup) {
+    if (prefetchCount == SAMPLE_PREFETCH_QUEUE) {
+      // Llena: lo más nuevo manda (el usuario ya navegó a otra parte)
+      prefetchHead = (prefetchHead + 1) % SAMPLE_PREFETCH_QUEUE;
+      prefetchCount--;
+    }
+    uint8_t slot = (prefetchHead + prefetchCount) % SAMPLE_PREFETCH_QUEUE;
+    strncpy(prefetchQueue[slot], path, sizeof(prefetchQueue[slot]) - 1);
+    prefetchQueue[slot][sizeof(prefetchQueue[slot]) - 1] = '\0';
+    prefetchCount++;
+  }
+  portEXIT_CRITICAL(&_prefetchMux);
+}
+
+// Vecinos de `filename` en el listado de la familia (orden del índice, el
+// mismo que ve el navegador): +1, -1, +2, -2... Sin filename, los primeros.
+void SampleManager::prefetchNeighbours(const char* family, const char* filename) {
+  const SampleIndexEntry* entries;
+  uint16_t count;
+  if (!family || !sampleIndexLock(UINT32_MAX)) return;
+  if (!sampleIndexFolder(family, &entries, &count) || count == 0) {
+    sampleIndexUnlock();
+    return;
+  }
+  int center = -1;
+  if (filename) {
+    const SampleIndexEntry* e = sampleIndexFind(family, filename);
+    if (e) center = (int)(e - entries);
+  }
+  char path[64];
+  for (int d = 1; d <= SAMPLE_PREFETCH_SPAN; d++) {
+    int around[2] = { center + d, center - d };
+    for (int k = 0; k < 2; k++) {
+      int i = around[k];
+      if (center < 0 && k == 1) continue;
+      if (i < 0 || i >= count) continue;
+      snprintf(path, sizeof(path), "/%s/%s", entries[i].folder, entries[i].name);
+      queuePrefetch(path);
+    }
+  }
+  sampleIndexUnlock();
+}
+
+// Sample actual del pad (p. ej. pistas de los próximos patrones del song chain)
+void SampleManager::prefetchPad(int padIndex) {
+  if (padIndex < 0 || padIndex >= MAX_SAMPLES || !sampleBuffers[padIndex]) return;
+  queuePrefetch(samplePaths[padIndex]);
+}
+
+bool SampleManager::prefetchStep() {
+  char path[64];
+  portENTER_CRITICAL(&_prefetchMux);
+  bool any = prefetchCount > 0;
+  if (any) strcpy(path, prefetchQueue[prefetchHead]);
+  portEXIT_CRITICAL(&_prefetchMux);
+  if (!any) return false;
+  // Una carga en curso (WS en async_tcp) tiene prioridad: reintentar luego
+  if (streamPad >= 0 || !sampleCacheLock(0)) return false;
+
+  portENTER_CRITICAL(&_prefetchMux);
+  if (prefetchCount > 0 && strcmp(prefetchQueue[prefetchHead], path) == 0) {
+    prefetchHead = (prefetchHead + 1) % SAMPLE_PREFETCH_QUEUE;
+    prefetchCount--;
+  }
+  portEXIT_CRITICAL(&_prefetchMux);
+
+  if (readSampleFile(path, nullptr, nullptr, nullptr, nullptr)) prefetchDone++;
+  sampleCacheUnlock();
+  return true;
+}
+
+// PCM convertido en un buffer nuevo de PSRAM (*outBuf, *outLen muestras)
+bool SampleManager::parseWavFile(fs::File& file, int16_t** outBuf, uint32_t* outLen, String& errOut) {
   size_t fileSize = file.size();
 
   if (fileSize < 12) {
@@ -119,6 +298,7 @@ bool SampleManager::parseWavFile(fs::File& file, int padIndex, String& errOut) {
   uint16_t audioFormat   = 0;
   uint16_t numChannels   = 0;
   uint16_t bitsPerSample = 0;
+  uint32_t sampleRate    = 0;
   uint32_t dataPos       = 0;
   uint32_t dataSize      = 0;
 
@@ -139,6 +319,7 @@ bool SampleManager::parseWavFile(fs::File& file, int padIndex, String& errOut) {
 
       audioFormat   = (uint16_t)fmt[0]  | ((uint16_t)fmt[1]  << 8);
       numChannels   = (uint16_t)fmt[2]  | ((uint16_t)fmt[3]  << 8);
+      sampleRate    = (uint32_t)fmt[4] | ((uint32_t)fmt[5] << 8) | ((uint32_t)fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
       bitsPerSample = (uint16_t)fmt[14] | ((uint16_t)fmt[15] << 8);
       fmtFound = true;
 
@@ -155,108 +336,83 @@ bool SampleManager::parseWavFile(fs::File& file, int padIndex, String& errOut) {
   if (!fmtFound)  { errOut = "No fmt chunk found";  return false; }
   if (!dataFound) { errOut = "No data chunk found"; return false; }
 
-  // Aceptar PCM (1) y WAVE_FORMAT_EXTENSIBLE (0xFFFE, tratado como PCM 16-bit)
-  if (audioFormat != 1 && audioFormat != 0xFFFE) {
-    errOut = "Unsupported format " + String(audioFormat);
-    return false;
-  }
-
-  // Aceptamos 16-bit nativo y 24-bit convertido a 16-bit
-  if (bitsPerSample != 16 && bitsPerSample != 24) {
-    errOut = "Need 16/24-bit PCM, got " + String(bitsPerSample) + "-bit";
-    return false;
-  }
-
-  if (numChannels < 1 || numChannels > 2) {
-    errOut = "Bad channel count " + String(numChannels);
+  // PCM 8/16/24-bit, float32 y EXTENSIBLE (tratado como PCM entero), mono o estéreo
+  PcmSpec spec;
+  char specErr[48];
+  if (!pcmSpecFromWav(audioFormat, bitsPerSample, numChannels, &spec, specErr, sizeof(specErr))) {
+    errOut = specErr;
     return false;
   }
 
-  // Número de frames (muestras mono)
-  uint32_t bytesPerSample = bitsPerSample / 8;
-  uint32_t numSamples = dataSize / (bytesPerSample * numChannels);
+  // Número de frames (muestras mono); con otro rate, las que salgan del resampler
+  uint32_t numFrames = dataSize / spec.frameBytes;
+  bool resample = beginResample(sampleRate, numFrames, errOut);
+  if (!resample && errOut.length() > 0) return false;
+  uint32_t numSamples = resample ? resampler.outputLength() : numFrames;
 
-  if (!allocateSampleBuffer(padIndex, numSamples)) {
+  int16_t* dst = allocPsramSamples(numSamples);
+  if (!dst) {
+    resampler.end();
     errOut = "No PSRAM for sample";
     return false;
   }
 
   file.seek(dataPos);
 
-  if (bitsPerSample == 16) {
-    if (numChannels == 1) {
-      size_t bytesRead = file.read((uint8_t*)sampleBuffers[padIndex], numSamples * 2);
-      if (bytesRead != numSamples * 2) {
-        errOut = "Short read mono16";
-        freeSampleBuffer(padIndex);
-        return false;
-      }
-    } else {
-      // Stereo 16-bit → mixdown mono
-      int16_t stereoBuffer[2];
-      for (uint32_t i = 0; i < numSamples; i++) {
-        if (file.read((uint8_t*)stereoBuffer, 4) != 4) {
-          errOut = "Short read stereo16";
-          freeSampleBuffer(padIndex);
-          return false;
-        }
-        sampleBuffers[padIndex][i] = (stereoBuffer[0] / 2) + (stereoBuffer[1] / 2);
-        if ((i & 0x0FFF) == 0) {
-          yield();
-        }
-      }
+  if (!resample && spec.format == PCM_S16 && spec.channels == 1) {
+    // Mono 16-bit al rate de los kits: lectura directa al buffer final
+    size_t bytesRead = file.read((uint8_t*)dst, numSamples * 2);
+    if (bytesRead != numSamples * 2) {
+      errOut = "Short read mono16";
+      hpFree(dst);
+      return false;
     }
   } else {
-    // 24-bit PCM → convertir a 16-bit (descartar 8 bits menos significativos)
-    auto s24_to_s16 = [](const uint8_t* b) -> int16_t {
-      int32_t v = (int32_t)b[0] | ((int32_t)b[1] << 8) | ((int32_t)b[2] << 16);
-      if (v & 0x00800000) {
-        v |= ~0x00FFFFFF;  // sign-extend
-      }
-      return (int16_t)(v >> 8);
-    };
-
-    if (numChannels == 1) {
-      uint8_t mono24[3];
-      for (uint32_t i = 0; i < numSamples; i++) {
-        if (file.read(mono24, 3) != 3) {
-          errOut = "Short read mono24";
-          freeSampleBuffer(padIndex);
-          return false;
-        }
-        sampleBuffers[padIndex][i] = s24_to_s16(mono24);
-        if ((i & 0x0FFF) == 0) {
-          yield();
-        }
-      }
-    } else {
-      // Stereo 24-bit → mixdown mono
-      uint8_t stereo24[6];
-      for (uint32_t i = 0; i < numSamples; i++) {
-        if (file.read(stereo24, 6) != 6) {
-          errOut = "Short read stereo24";
-          freeSampleBuffer(padIndex);
-          return false;
-        }
-        int16_t l = s24_to_s16(&stereo24[0]);
-        int16_t r = s24_to_s16(&stereo24[3]);
-        sampleBuffers[padIndex][i] = (int16_t)(((int32_t)l + (int32_t)r) / 2);
-        if ((i & 0x0FFF) == 0) {
-          yield();
-        }
+    // Resto: lecturas de PCM_STAGING_BYTES a RAM interna y conversión por bloque
+    // (antes un file.read() de 3-6 bytes por frame). Con resampler, bloques de
+    // RS_BLOCK·4 frames para acotar el int16 intermedio.
+    uint32_t blockFrames = PCM_STAGING_BYTES / spec.frameBytes;
+    if (resample && blockFrames > RS_BLOCK * 4) blockFrames = RS_BLOCK * 4;
+    size_t monoBytes = resample ? blockFrames * sizeof(int16_t) : 0;
+    uint8_t* staging = (uint8_t*)hpAlloc(PCM_STAGING_BYTES + monoBytes, HP_HEAP_DEFAULT, "sample.stage");
+    if (!staging) {
+      resampler.end();
+      errOut = "No RAM for staging";
+      hpFree(dst);
+      return false;
+    }
+    int16_t* mono = resample ? (int16_t*)(staging + PCM_STAGING_BYTES) : nullptr;
+    uint32_t written = 0;
+    for (uint32_t done = 0; done < numFrames; ) {
+      uint32_t n = numFrames - done;
+      if (n > blockFrames) n = blockFrames;
+      size_t bytes = (size_t)n * spec.frameBytes;
+      if (file.read(staging, bytes) != bytes) {
+        resampler.end();
+        errOut = "Short read";
+        hpFree(staging);
+        hpFree(dst);
+        return false;
       }
+      written += emitFrames(spec, staging, n, dst + written, numSamples - written, mono);
+      done += n;
+      yield();
     }
+    if (resample) written += resampler.flush(dst + written, numSamples - written);
+    if (written < numSamples) memset(dst + written, 0, (numSamples - written) * 2);
+    hpFree(staging);
   }
 
-  sampleLengths[padIndex] = numSamples;
+  *outBuf = dst;
+  *outLen = numSamples;
   return true;
 }
 
-bool SampleManager::allocateSampleBuffer(int padIndex, uint32_t size) {
+int16_t* SampleManager::allocPsramSamples(uint32_t size) {
   size_t bytes = size * sizeof(int16_t);
   
   if (bytes > MAX_SAMPLE_SIZE) {
-    return false;
+    return nullptr;
   }
   
   // Verificar PSRAM disponible
@@ -264,25 +420,30 @@ bool SampleManager::allocateSampleBuffer(int padIndex, uint32_t size) {
   size_t minRequired = bytes + (100 * 1024); // +100KB margen de seguridad
   
   if (freePsram < minRequired) {
-    return false;
+    // Los pads mandan sobre la caché de samples: expulsar LRU y reintentar
+    sampleCacheReclaim(minRequired);
+    if (ESP.getFreePsram() < minRequired) return nullptr;
   }
   
   // Allocate in PSRAM
-  sampleBuffers[padIndex] = (int16_t*)ps_malloc(bytes);
-  
-  if (sampleBuffers[padIndex] == nullptr) {
-    return false;
-  }
-  
-  return true;
+  return (int16_t*)hpAlloc(bytes, HP_HEAP_PSRAM, "sample.pcm");
+}
+
+bool SampleManager::allocateSampleBuffer(int padIndex, uint32_t size) {
+  sampleBuffers[padIndex] = allocPsramSamples(size);
+  return sampleBuffers[padIndex] != nullptr;
 }
 
 void SampleManager::freeSampleBuffer(int padIndex) {
   if (sampleBuffers[padIndex] != nullptr) {
-    free(sampleBuffers[padIndex]);
+    if (!pcmStoreContains(sampleBuffers[padIndex])) hpFree(sampleBuffers[padIndex]);
     sampleBuffers[padIndex] = nullptr;
     sampleLengths[padIndex] = 0;
+    sampleHashes[padIndex] = 0;
+    PeakPyramid::destroy(peakPyramids[padIndex]);
+    peakPyramids[padIndex] = nullptr;
     memset(sampleNames[padIndex], 0, 32);
+    samplePaths[padIndex][0] = '\0';
   }
 }
 
@@ -308,7 +469,7 @@ bool SampleManager::trimSample(int padIndex, float startNorm, float endNorm) {
   if (newLen < 64) return false;  // Minimum sample length
   
   // Allocate new buffer
-  int16_t* newBuf = (int16_t*)ps_malloc(newLen * sizeof(int16_t));
+  int16_t* newBuf = (int16_t*)hpAlloc(newLen * sizeof(int16_t), HP_HEAP_PSRAM, "sample.trim");
   if (!newBuf) {
     return false;
   }
@@ -317,12 +478,14 @@ bool SampleManager::trimSample(int padIndex, float startNorm, float endNorm) {
   memcpy(newBuf, sampleBuffers[padIndex] + newStart, newLen * sizeof(int16_t));
   
   // Free old buffer and replace
-  free(sampleBuffers[padIndex]);
+  if (!pcmStoreContains(sampleBuffers[padIndex])) hpFree(sampleBuffers[padIndex]);
   sampleBuffers[padIndex] = newBuf;
   sampleLengths[padIndex] = newLen;
+  sampleHashes[padIndex] = sampleHash(newBuf, newLen);
+  rebuildPeaks(padIndex);
   
   // Update SPI Master → STM32
-  spiMaster.setSampleBuffer(padIndex, newBuf, newLen);
+  spiMaster.setSampleBuffer(padIndex, newBuf, newLen, sampleHashes[padIndex]);
   
   return true;
 }
@@ -335,6 +498,14 @@ bool SampleManager::applyFade(int padIndex, float fadeInSec, float fadeOutSec) {
   uint32_t len = sampleLengths[padIndex];
   if (len < 4) return false;
   
+  // Buffer en la partición PCM (sólo lectura): primero una copia en PSRAM
+  if (pcmStoreContains(sampleBuffers[padIndex])) {
+    int16_t* copy = allocPsramSamples(len);
+    if (!copy) return false;
+    memcpy(copy, sampleBuffers[padIndex], len * sizeof(int16_t));
+    sampleBuffers[padIndex] = copy;
+  }
+  
   // Fade in: ramp up gain from 0 to 1 over the first fadeInSamples
   if (fadeInSec > 0.001f) {
     uint32_t fadeInSamples = (uint32_t)(fadeInSec * SAMPLE_RATE);
@@ -356,6 +527,8 @@ bool SampleManager::applyFade(int padIndex, float fadeInSec, float fadeOutSec) {
     }
   }
   
+  sampleHashes[padIndex] = sampleHash(sampleBuffers[padIndex], len);
+  rebuildPeaks(padIndex);
   return true;
 }
 
@@ -369,7 +542,9 @@ bool SampleManager::loadSampleFromBuffer(const uint8_t* data, size_t size, int p
   }
 
   String parseErr;
+  sampleCacheLock(UINT32_MAX);   // resampler compartido con loadSample / prefetch
   bool success = parseWavFromBuffer(data, size, padIndex, parseErr);
+  sampleCacheUnlock();
   if (!success) {
     strncpy(lastParseError, parseErr.c_str(), sizeof(lastParseError) - 1);
     lastParseError[sizeof(lastParseError) - 1] = '\0';
@@ -378,10 +553,77 @@ bool SampleManager::loadSampleFromBuffer(const uint8_t* data, size_t size, int p
   lastParseError[0] = '\0';
 
   snprintf(sampleNames[padIndex], 32, "pad%d", padIndex);
-  spiMaster.setSampleBuffer(padIndex, sampleBuffers[padIndex], sampleLengths[padIndex]);
+  sampleHashes[padIndex] = sampleHash(sampleBuffers[padIndex], sampleLengths[padIndex]);
+  rebuildPeaks(padIndex);
+  spiMaster.setSampleBuffer(padIndex, sampleBuffers[padIndex], sampleLengths[padIndex], sampleHashes[padIndex]);
   return true;
 }
 
+// ─── Stream load (upload HTTP) ───────────────────────────────────────────────
+// El PCM convertido va directo a un buffer nuevo; el sample anterior del pad
+// sigue publicado (y sonando en el ESP) hasta commitStreamLoad, que los
+// intercambia cuando el SPI ya terminó y sólo entonces libera el viejo.
+int16_t* SampleManager::allocStreamBuffer(void* ctx, uint32_t numSamples) {
+  SampleManager* self = (SampleManager*)ctx;
+  self->streamBuf = allocPsramSamples(numSamples);
+  return self->streamBuf;
+}
+
+bool SampleManager::beginStreamLoad(int padIndex, size_t sizeHint) {
+  if (padIndex < 0 || padIndex >= MAX_SAMPLES) return false;
+  abortStreamLoad();
+  streamPad = padIndex;
+  lastParseError[0] = '\0';
+  wavStream.begin(allocStreamBuffer, this, sizeHint, resampleQuality);
+  return true;
+}
+
+bool SampleManager::feedStreamLoad(const uint8_t* data, size_t len) {
+  if (streamPad < 0) return false;
+  if (wavStream.feed(data, len)) return true;
+  strncpy(lastParseError, wavStream.error(), sizeof(lastParseError) - 1);
+  lastParseError[sizeof(lastParseError) - 1] = '\0';
+  return false;
+}
+
+bool SampleManager::finishStreamLoad() {
+  if (streamPad < 0) return false;
+  if (wavStream.finish()) return true;
+  strncpy(lastParseError, wavStream.error(), sizeof(lastParseError) - 1);
+  lastParseError[sizeof(lastParseError) - 1] = '\0';
+  return false;
+}
+
+void SampleManager::commitStreamLoad(bool spiComplete) {
+  if (streamPad < 0 || !streamBuf) return;
+  int16_t* old = sampleBuffers[streamPad];
+  sampleBuffers[streamPad] = streamBuf;
+  if (old && !pcmStoreContains(old)) hpFree(old);
+  samplePaths[streamPad][0] = '\0';
+  sampleLengths[streamPad] = wavStream.numSamples();
+  sampleHashes[streamPad] = sampleHash(streamBuf, sampleLengths[streamPad]);
+  // El SPI ya salió por tramos durante el upload: sólo queda anotar qué tiene el pad
+  if (spiComplete) spiMaster.confirmSlotContent(streamPad, sampleHashes[streamPad], sampleLengths[streamPad]);
+  snprintf(sampleNames[streamPad], 32, "pad%d", streamPad);
+  rebuildPeaks(streamPad);
+  streamBuf = nullptr;
+  streamPad = -1;
+}
+
+void SampleManager::abortStreamLoad(bool spiBegun) {
+  if (streamBuf) {
+    hpFree(streamBuf);
+    streamBuf = nullptr;
+  }
+  // El stream ya pisó el pad en la Daisy: vuelve a enviarle el sample que
+  // el ESP conservó (o la vacía si el pad no tenía ninguno)
+  if (spiBegun && streamPad >= 0) {
+    spiMaster.setSampleBuffer(streamPad, sampleBuffers[streamPad], sampleLengths[streamPad],
+                              sampleHashes[streamPad]);
+  }
+  streamPad = -1;
+}
+
 // ─── parseWavFromBuffer ───────────────────────────────────────────────────────
 // Igual que parseWavFile pero opera sobre un bloque de memoria en PSRAM
 bool SampleManager::parseWavFromBuffer(const uint8_t* buf, size_t size, int padIndex, String& errOut) {
@@ -393,7 +635,7 @@ bool SampleManager::parseWavFromBuffer(const uint8_t* buf, size_t size, int padI
   uint32_t pos = 12;
   bool fmtFound = false, dataFound = false;
   uint16_t audioFormat = 0, numChannels = 0, bitsPerSample = 0;
-  uint32_t dataPos = 0, dataSize = 0;
+  uint32_t sampleRate = 0, dataPos = 0, dataSize = 0;
 
   while (pos + 8 <= (uint32_t)size) {
     uint32_t chunkSize = (uint32_t)buf[pos+4]
@@ -406,6 +648,7 @@ bool SampleManager::parseWavFromBuffer(const uint8_t* buf, size_t size, int padI
       const uint8_t* fmt = buf + pos + 8;
       audioFormat   = (uint16_t)fmt[0]  | ((uint16_t)fmt[1]  << 8);
       numChannels   = (uint16_t)fmt[2]  | ((uint16_t)fmt[3]  << 8);
+      sampleRate    = (uint32_t)fmt[4] | ((uint32_t)fmt[5] << 8) | ((uint32_t)fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
       bitsPerSample = (uint16_t)fmt[14] | ((uint16_t)fmt[15] << 8);
       fmtFound = true;
     } else if (memcmp(buf + pos, "data", 4) == 0) {
@@ -419,63 +662,88 @@ bool SampleManager::parseWavFromBuffer(const uint8_t* buf, size_t size, int padI
 
   if (!fmtFound)  { errOut = "No fmt chunk found";  return false; }
   if (!dataFound) { errOut = "No data chunk found"; return false; }
-  if (audioFormat != 1 && audioFormat != 0xFFFE) {
-    errOut = "Unsupported format " + String(audioFormat); return false;
-  }
-  if (bitsPerSample != 16 && bitsPerSample != 24) {
-    errOut = "Need 16/24-bit PCM, got " + String(bitsPerSample) + "-bit"; return false;
-  }
-  if (numChannels < 1 || numChannels > 2) {
-    errOut = "Bad channel count " + String(numChannels); return false;
+  PcmSpec spec;
+  char specErr[48];
+  if (!pcmSpecFromWav(audioFormat, bitsPerSample, numChannels, &spec, specErr, sizeof(specErr))) {
+    errOut = specErr; return false;
   }
   if (dataPos + dataSize > (uint32_t)size) {
     dataSize = (uint32_t)size - dataPos;  // truncar si el tamaño del chunk excede el buffer
   }
 
-  uint32_t bytesPerSample = bitsPerSample / 8;
-  uint32_t numSamples = dataSize / (bytesPerSample * numChannels);
+  uint32_t numFrames = dataSize / spec.frameBytes;
+  bool resample = beginResample(sampleRate, numFrames, errOut);
+  if (!resample && errOut.length() > 0) return false;
+  uint32_t numSamples = resample ? resampler.outputLength() : numFrames;
 
   if (!allocateSampleBuffer(padIndex, numSamples)) {
+    resampler.end();
     errOut = "No PSRAM for sample"; return false;
   }
 
+  // Por bloques para ceder la CPU entre conversiones (antes yield cada 4096 frames)
   const uint8_t* src = buf + dataPos;
-
-  if (bitsPerSample == 16) {
-    if (numChannels == 1) {
-      memcpy(sampleBuffers[padIndex], src, numSamples * 2);
-    } else {
-      // Stereo 16-bit → mixdown mono
-      const int16_t* s = (const int16_t*)src;
-      for (uint32_t i = 0; i < numSamples; i++) {
-        sampleBuffers[padIndex][i] = (int16_t)(((int32_t)s[i*2] + (int32_t)s[i*2+1]) / 2);
-        if ((i & 0x0FFF) == 0) yield();
-      }
-    }
-  } else {
-    // 24-bit → 16-bit
-    auto s24_to_s16 = [](const uint8_t* b) -> int16_t {
-      int32_t v = (int32_t)b[0] | ((int32_t)b[1] << 8) | ((int32_t)b[2] << 16);
-      if (v & 0x00800000) v |= ~0x00FFFFFF;
-      return (int16_t)(v >> 8);
-    };
-    uint32_t stride = (uint32_t)numChannels * 3;
-    for (uint32_t i = 0; i < numSamples; i++) {
-      if (numChannels == 1) {
-        sampleBuffers[padIndex][i] = s24_to_s16(src + i * 3);
-      } else {
-        int16_t l = s24_to_s16(src + i * stride);
-        int16_t r = s24_to_s16(src + i * stride + 3);
-        sampleBuffers[padIndex][i] = (int16_t)(((int32_t)l + (int32_t)r) / 2);
-      }
-      if ((i & 0x0FFF) == 0) yield();
+  uint32_t blockFrames = PCM_STAGING_BYTES / spec.frameBytes;
+  int16_t* mono = nullptr;
+  if (resample) {
+    if (blockFrames > RS_BLOCK * 4) blockFrames = RS_BLOCK * 4;
+    mono = (int16_t*)hpAlloc(blockFrames * sizeof(int16_t), HP_HEAP_DEFAULT, "sample.stage");
+    if (!mono) {
+      resampler.end();
+      freeSampleBuffer(padIndex);
+      errOut = "No RAM for staging"; return false;
     }
   }
+  uint32_t written = 0;
+  for (uint32_t done = 0; done < numFrames; ) {
+    uint32_t n = numFrames - done;
+    if (n > blockFrames) n = blockFrames;
+    written += emitFrames(spec, src + (size_t)done * spec.frameBytes, n,
+                          sampleBuffers[padIndex] + written, numSamples - written, mono);
+    done += n;
+    yield();
+  }
+  if (resample) {
+    written += resampler.flush(sampleBuffers[padIndex] + written, numSamples - written);
+    hpFree(mono);
+  }
+  if (written < numSamples) memset(sampleBuffers[padIndex] + written, 0, (numSamples - written) * 2);
 
   sampleLengths[padIndex] = numSamples;
   return true;
 }
 
+// ─── Conversión de rate ──────────────────────────────────────────────────────
+// El PCM cacheado depende de la calidad: al cambiarla se vacía la caché
+void SampleManager::setResampleQuality(ResampleQuality q) {
+  if (q >= RS_Q_COUNT || q == resampleQuality) return;
+  sampleCacheLock(UINT32_MAX);
+  resampleQuality = q;
+  sampleCacheClear();
+  sampleCacheUnlock();
+}
+
+// true si el sample no está a RS_TARGET_RATE y el resampler quedó preparado.
+// false con errOut vacío = se carga tal cual; con errOut = sin memoria.
+bool SampleManager::beginResample(uint32_t srcRate, uint32_t numFrames, String& errOut) {
+  if (srcRate == 0 || srcRate == RS_TARGET_RATE) return false;
+  if (resampler.begin(srcRate, RS_TARGET_RATE, resampleQuality, numFrames)) return true;
+  if (resampler.failed()) errOut = "No memory for resampler";
+  return false;
+}
+
+// frames de src → buffer del pad (a través del resampler si está activo).
+// mono: int16 intermedio de `frames` muestras, sólo con resampler
+uint32_t SampleManager::emitFrames(const PcmSpec& spec, const uint8_t* src, uint32_t frames,
+                                   int16_t* dst, uint32_t dstCap, int16_t* mono) {
+  if (!resampler.active()) {
+    pcmConvert(spec, src, dst, frames);
+    return frames;
+  }
+  pcmConvert(spec, src, mono, frames);
+  return (uint32_t)resampler.process(mono, frames, dst, dstCap);
+}
+
 void SampleManager::unloadAll() {
   for (int i = 0; i < MAX_SAMPLES; i++) {
     if (sampleBuffers[i] != nullptr) {
@@ -494,6 +762,11 @@ uint32_t SampleManager::getSampleLength(int padIndex) {
   return sampleLengths[padIndex];
 }
 
+uint32_t SampleManager::getSampleHash(int padIndex) {
+  if (padIndex < 0 || padIndex >= MAX_SAMPLES) return 0;
+  return sampleHashes[padIndex];
+}
+
 const char* SampleManager::getSampleName(int padIndex) {
   if (padIndex < 0 || padIndex >= MAX_SAMPLES) return "";
   return sampleNames[padIndex];
@@ -502,7 +775,7 @@ const char* SampleManager::getSampleName(int padIndex) {
 size_t SampleManager::getTotalPSRAMUsed() {
   size_t total = 0;
   for (int i = 0; i < MAX_SAMPLES; i++) {
-    if (sampleBuffers[i] != nullptr) {
+    if (sampleBuffers[i] != nullptr && !pcmStoreContains(sampleBuffers[i])) {
       total += sampleLengths[i] * sizeof(int16_t);
     }
   }
@@ -533,31 +806,47 @@ int16_t* SampleManager::getSampleBuffer(int padIndex) {
 }
 
 int SampleManager::getWaveformPeaks(int padIndex, int8_t* outPeaks, int maxPoints) {
+  return getWaveformPeaks(padIndex, outPeaks, maxPoints, 0, 0xFFFFFFFF);
+}
+
+int SampleManager::getWaveformPeaks(int padIndex, int8_t* outPeaks, int maxPoints, uint32_t start, uint32_t end) {
   if (padIndex < 0 || padIndex >= MAX_SAMPLES || !sampleBuffers[padIndex] || maxPoints <= 0) return 0;
   
   uint32_t len = sampleLengths[padIndex];
   if (len == 0) return 0;
+  if (end > len) end = len;
   
   int points = (maxPoints > 200) ? 200 : maxPoints;
-  uint32_t samplesPerPoint = len / points;
-  if (samplesPerPoint == 0) samplesPerPoint = 1;
+  // Sin pirámide (PSRAM justa al cargar): reintentar y, si sigue sin caber,
+  // escanear el rango directamente como antes
+  if (!peakPyramids[padIndex]) rebuildPeaks(padIndex);
+  if (peakPyramids[padIndex]) {
+    return peakPyramids[padIndex]->query(start, end, points, outPeaks, sampleBuffers[padIndex]);
+  }
   
+  if (start >= end) return 0;
+  uint32_t span = end - start;
+  if ((uint32_t)points > span) points = span;
+  const int16_t* buf = sampleBuffers[padIndex];
   for (int i = 0; i < points; i++) {
-    uint32_t start = i * samplesPerPoint;
-    uint32_t end = start + samplesPerPoint;
-    if (end > len) end = len;
-    
+    uint32_t s0 = start + (uint32_t)((uint64_t)span * i / points);
+    uint32_t s1 = start + (uint32_t)((uint64_t)span * (i + 1) / points);
     int16_t maxVal = 0;
     int16_t minVal = 0;
-    for (uint32_t j = start; j < end; j++) {
-      int16_t s = sampleBuffers[padIndex][j];
-      if (s > maxVal) maxVal = s;
-      if (s < minVal) minVal = s;
+    for (uint32_t j = s0; j < s1; j++) {
+      if (buf[j] > maxVal) maxVal = buf[j];
+      if (buf[j] < minVal) minVal = buf[j];
     }
-    // Scale 16-bit to 8-bit signed (-128..127)
-    // Use the peak (max of abs(min), abs(max)) for upper, negative for lower
     outPeaks[i * 2]     = (int8_t)(maxVal >> 8);  // positive peak
     outPeaks[i * 2 + 1] = (int8_t)(minVal >> 8);  // negative peak
   }
   return points;
 }
+
+// Un escaneo completo al cargar / editar el PCM; después /api/waveform es O(points)
+void SampleManager::rebuildPeaks(int padIndex) {
+  PeakPyramid::destroy(peakPyramids[padIndex]);
+  peakPyramids[padIndex] = nullptr;
+  if (!sampleBuffers[padIndex] || sampleLengths[padIndex] == 0) return;
+  peakPyramids[padIndex] = PeakPyramid::build(sampleBuffers[padIndex], sampleLengths[padIndex]);
+}
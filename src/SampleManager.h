@@ -10,9 +10,31 @@
 #include <LittleFS.h>
 #include <FS.h>
 #include "SPIMaster.h"
+#include "WavStream.h"
+#include "WavePeaks.h"
+#include "PcmConvert.h"
+#include "Resampler.h"
 
 #define MAX_SAMPLES 24  // 16 sequencer + 8 XTRA pads
 #define MAX_SAMPLE_SIZE (4 * 1024 * 1024) // 4MB per sample
+#define SAMPLE_PREFETCH_QUEUE 8  // rutas pendientes de calentar en SampleCache
+#define SAMPLE_PREFETCH_SPAN  2  // vecinos a cada lado del sample elegido en el navegador
+
+// Tiempos de loadSample() (lectura LittleFS + conversión, copia desde
+// SampleCache o PCM de la partición pcmstore), en /api/sysinfo. maxUs/totalUs
+// sólo cuentan cargas del fichero
+struct SampleLoadStats {
+  uint32_t loads;
+  uint32_t cacheHits;
+  uint32_t storeHits;
+  uint32_t lastUs;
+  uint32_t lastBytes;     // bytes del fichero
+  uint32_t maxUs;
+  uint64_t totalUs;
+  uint64_t totalBytes;
+  bool lastCached;
+  bool lastStored;
+};
 
 // WAV file header structure
 struct WavHeader {
@@ -42,6 +64,15 @@ public:
   // Sample loading
   bool loadSample(const char* filename, int padIndex);
   bool loadSampleFromBuffer(const uint8_t* data, size_t size, int padIndex);  // Load WAV from PSRAM buffer
+  // Upload en streaming: el WAV se convierte chunk a chunk a un buffer nuevo; el
+  // sample actual del pad se conserva hasta commit, que los intercambia y libera el viejo.
+  // El SPI lo envía quien llama (uploadStream().samplesReady()).
+  bool beginStreamLoad(int padIndex, size_t sizeHint);
+  bool feedStreamLoad(const uint8_t* data, size_t len);
+  bool finishStreamLoad();
+  void commitStreamLoad(bool spiComplete);   // spiComplete: la Daisy recibió todo (tabla de dedup)
+  void abortStreamLoad(bool spiBegun = false);   // spiBegun: reenvía a la Daisy el sample conservado
+  const WavStreamParser& uploadStream() const { return wavStream; }
   bool trimSample(int padIndex, float startNorm, float endNorm);
   bool applyFade(int padIndex, float fadeInSec, float fadeOutSec);  // Apply fade in/out to buffer
   bool unloadSample(int padIndex);
@@ -51,12 +82,26 @@ public:
   bool isSampleLoaded(int padIndex);
   uint32_t getSampleLength(int padIndex);
   const char* getSampleName(int padIndex);
+  uint32_t getSampleHash(int padIndex);   // sampleHash() del PCM del pad, 0 = vacío
   int getLoadedSamplesCount();
   const char* getLastParseError() { return lastParseError; }
+  const SampleLoadStats& getLoadStats() const { return loadStats; }
+  
+  // Prefetch a SampleCache en segundo plano (prefetchStep desde systemTask)
+  void queuePrefetch(const char* path);
+  void prefetchNeighbours(const char* family, const char* filename);
+  void prefetchPad(int padIndex);
+  bool prefetchStep();   // true si procesó una ruta
+  uint32_t getPrefetchDone() const { return prefetchDone; }
+  // Calidad del resampler para WAVs que no están a RS_TARGET_RATE
+  void setResampleQuality(ResampleQuality q);
+  ResampleQuality getResampleQuality() const { return resampleQuality; }
   
   // Waveform data access (for visualizer)
   int16_t* getSampleBuffer(int padIndex);
   int getWaveformPeaks(int padIndex, int8_t* outPeaks, int maxPoints);
+  // Rango [start, end) en muestras (zoom del editor); lee la pirámide de picos
+  int getWaveformPeaks(int padIndex, int8_t* outPeaks, int maxPoints, uint32_t start, uint32_t end);
   
   // Memory info
   size_t getTotalPSRAMUsed();
@@ -66,13 +111,35 @@ public:
 private:
   int16_t* sampleBuffers[MAX_SAMPLES];
   uint32_t sampleLengths[MAX_SAMPLES];
+  uint32_t sampleHashes[MAX_SAMPLES];       // XXH32 del PCM (dedup de uploads a la Daisy)
   char sampleNames[MAX_SAMPLES][32];
+  char samplePaths[MAX_SAMPLES][64];        // ruta LittleFS de origen (prefetch del song chain)
+  PeakPyramid* peakPyramids[MAX_SAMPLES];   // min/max por niveles, se rehace al cambiar el PCM
   char lastParseError[64] = {};
+  SampleLoadStats loadStats = {};
+  Resampler resampler;            // conserva la tabla entre cargas del mismo rate
+  ResampleQuality resampleQuality = RS_Q_MEDIUM;
+  WavStreamParser wavStream;
+  int streamPad = -1;
+  int16_t* streamBuf = nullptr;   // buffer del upload en curso (aún no publicado en sampleBuffers)
+  char prefetchQueue[SAMPLE_PREFETCH_QUEUE][64];
+  uint8_t prefetchHead = 0;
+  uint8_t prefetchCount = 0;
+  uint32_t prefetchDone = 0;
+
+  static int16_t* allocStreamBuffer(void* ctx, uint32_t numSamples);
+  static int16_t* allocPsramSamples(uint32_t numSamples);
 
-  bool parseWavFile(fs::File& file, int padIndex, String& errOut);
+  bool readSampleFile(const char* filename, int16_t** outBuf, uint32_t* outLen,
+                      uint32_t* outFileBytes, bool* outCached);
+  bool parseWavFile(fs::File& file, int16_t** outBuf, uint32_t* outLen, String& errOut);
   bool parseWavFromBuffer(const uint8_t* data, size_t size, int padIndex, String& errOut);
+  bool beginResample(uint32_t srcRate, uint32_t numFrames, String& errOut);
+  uint32_t emitFrames(const PcmSpec& spec, const uint8_t* src, uint32_t frames,
+                      int16_t* dst, uint32_t dstCap, int16_t* mono);
   bool allocateSampleBuffer(int padIndex, uint32_t size);
   void freeSampleBuffer(int padIndex);
+  void rebuildPeaks(int padIndex);
 };
 
 #endif // SAMPLEMANAGER_H
@@ -0,0 +1,18 @@
+/*
+ * SeqEventRing.cpp
+ * RED808 cola SPSC de eventos del secuenciador (ver SeqEventRing.h)
+ */
+
+#include "SeqEventRing.h"
+
+size_t SeqEventRing::pop(SeqEvent* out, size_t max) {
+  uint16_t tail = tail_.load(std::memory_order_relaxed);
+  uint16_t head = head_.load(std::memory_order_acquire);
+  size_t n = 0;
+  while (tail != head && n < max) {
+    out[n++] = buf_[tail & (SEQ_EVENT_RING_SIZE - 1)];
+    tail++;
+  }
+  tail_.store(tail, std::memory_order_release);
+  return n;
+}
@@ -0,0 +1,84 @@
+/*
+ * SeqEventRing.h
+ * RED808 cola SPSC lock-free Core1 (secuenciador) → Core0 (WebInterface)
+ * para eventos de step / trigger con timestamp, y su frame WebSocket 0xB4.
+ */
+
+#ifndef SEQ_EVENT_RING_H
+#define SEQ_EVENT_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// ═══════════════════════════════════════════════════════
+// EVENTOS
+// ═══════════════════════════════════════════════════════
+#define SEQEV_STEP      0x01   // a = step, b = stepCount
+#define SEQEV_TRIGGER   0x02   // a = track, b = velocity (tras probabilidad/ratchet)
+#define SEQEV_PATTERN   0x03   // a = pattern, b = songLength (song mode / chain)
+
+struct SeqEvent {
+  uint32_t us;     // micros() en el momento del evento
+  uint8_t  type;
+  uint8_t  a;
+  uint8_t  b;
+};
+
+// ═══════════════════════════════════════════════════════
+// FRAME WS 0xB4 (server → browser, little-endian)
+// ═══════════════════════════════════════════════════════
+// [0]     0xB4 magic
+// [1]     count (u8)
+// [2]     flags (b0 playing)
+// [3..4]  tempo×10 (u16) — el cliente interpola el playhead con 60000/tempo/4 ms
+// [5..]   count × [type u8, a u8, b u8, ago u16] — ago = antigüedad en 0.1 ms
+//         al construir el frame (satura a 6.5 s)
+// Sólo para clientes con binProto >= 3; el resto sigue recibiendo
+// {"type":"step"} / {"type":"songPattern"} en JSON.
+// Mantener sincronizado con handleSeqEventFrame en data/web/app.js.
+
+#define SEQ_EVENT_MAGIC        0xB4
+#define SEQ_EVENT_HEADER_SIZE  5
+#define SEQ_EVENT_RECORD_SIZE  5
+#define SEQ_EVENT_RING_SIZE    256   // potencia de 2: ~1 s de 16 tracks a 300 BPM
+#define SEQ_EVENT_MAX_PER_FRAME 64
+
+// Un único productor (spiAudioTask, Core1) y un único consumidor
+// (WebInterface::update, Core0). head_ sólo lo escribe el productor y
+// tail_ sólo el consumidor: basta con acquire/release, sin portMUX.
+// Si la cola está llena el evento nuevo se descarta y se cuenta en dropped().
+class SeqEventRing {
+public:
+  bool push(uint8_t type, uint8_t a, uint8_t b, uint32_t us) {
+    uint16_t head = head_.load(std::memory_order_relaxed);
+    uint16_t tail = tail_.load(std::memory_order_acquire);
+    if ((uint16_t)(head - tail) >= SEQ_EVENT_RING_SIZE) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    SeqEvent& e = buf_[head & (SEQ_EVENT_RING_SIZE - 1)];
+    e.us = us;
+    e.type = type;
+    e.a = a;
+    e.b = b;
+    head_.store((uint16_t)(head + 1), std::memory_order_release);
+    return true;
+  }
+
+  // Consumidor: copia hasta max eventos en orden; devuelve cuántos
+  size_t pop(SeqEvent* out, size_t max);
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);
+  }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  SeqEvent buf_[SEQ_EVENT_RING_SIZE];
+  std::atomic<uint16_t> head_{0};
+  std::atomic<uint16_t> tail_{0};
+  std::atomic<uint32_t> dropped_{0};
+};
+
+#endif // SEQ_EVENT_RING_H
@@ -347,6 +347,14 @@ void Sequencer::setStepNoteLen(int track, int step, uint8_t div) {
   pd->noteLenDivs[currentPattern][track][step] = div;
 }
 
+void Sequencer::setStepNoteLen(int pattern, int track, int step, uint8_t div) {
+  if (pattern < 0 || pattern >= MAX_PATTERNS) return;
+  if (track < 0 || track >= MAX_TRACKS) return;
+  if (step < 0 || step >= STEPS_PER_PATTERN) return;
+  if (div == 0) div = 1;  // Sanitize
+  pd->noteLenDivs[pattern][track][step] = div;
+}
+
 uint8_t Sequencer::getStepNoteLen(int track, int step) {
   if (track < 0 || track >= MAX_TRACKS) return 1;
   if (step < 0 || step >= STEPS_PER_PATTERN) return 1;
@@ -595,6 +603,13 @@ bool Sequencer::hasStepCutoffLock(int track, int step) {
   return pd->stepCutoffLockEnabled[currentPattern][track][step];
 }
 
+bool Sequencer::hasStepCutoffLock(int pattern, int track, int step) {
+  if (pattern < 0 || pattern >= MAX_PATTERNS) return false;
+  if (track < 0 || track >= MAX_TRACKS) return false;
+  if (step < 0 || step >= STEPS_PER_PATTERN) return false;
+  return pd->stepCutoffLockEnabled[pattern][track][step];
+}
+
 uint16_t Sequencer::getStepCutoffLock(int track, int step) {
   if (track < 0 || track >= MAX_TRACKS) return 1000;
   if (step < 0 || step >= STEPS_PER_PATTERN) return 1000;
@@ -631,6 +646,13 @@ bool Sequencer::hasStepReverbSendLock(int track, int step) {
   return pd->stepReverbSendLockEnabled[currentPattern][track][step];
 }
 
+bool Sequencer::hasStepReverbSendLock(int pattern, int track, int step) {
+  if (pattern < 0 || pattern >= MAX_PATTERNS) return false;
+  if (track < 0 || track >= MAX_TRACKS) return false;
+  if (step < 0 || step >= STEPS_PER_PATTERN) return false;
+  return pd->stepReverbSendLockEnabled[pattern][track][step];
+}
+
 uint8_t Sequencer::getStepReverbSendLock(int track, int step) {
   if (track < 0 || track >= MAX_TRACKS) return 0;
   if (step < 0 || step >= STEPS_PER_PATTERN) return 0;
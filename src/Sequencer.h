@@ -78,6 +78,7 @@ public:
   
   // Note length per step (divider: 1=full, 2=half, 4=quarter, 8=eighth)
   void setStepNoteLen(int track, int step, uint8_t div);
+  void setStepNoteLen(int pattern, int track, int step, uint8_t div);
   uint8_t getStepNoteLen(int track, int step);
   uint8_t getStepNoteLen(int pattern, int track, int step);
 
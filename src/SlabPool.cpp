@@ -0,0 +1,112 @@
+/*
+ * SlabPool.cpp
+ * RED808 pools de bloques fijos en PSRAM (ver SlabPool.h)
+ */
+
+#include "SlabPool.h"
+#include "HeapProfiler.h"
+#include <Arduino.h>
+
+struct SlabClass {
+  uint8_t* base;       // región contigua en PSRAM
+  uint16_t* freeStack; // índices libres (top = freeTop)
+  uint16_t freeTop;
+  SlabClassStats st;
+};
+
+static constexpr uint32_t kSlabSizes[SLAB_CLASS_COUNT]  = { 256, 1024, 4096, 32 * 1024 + 64 };
+static constexpr uint16_t kSlabCounts[SLAB_CLASS_COUNT] = { 48, 24, 12, 4 };
+
+static SlabClass _slabs[SLAB_CLASS_COUNT];
+static uint32_t _slabOversize = 0;
+static bool _slabReady = false;
+static portMUX_TYPE _slabMux = portMUX_INITIALIZER_UNLOCKED;
+
+void slabPoolInit() {
+  if (_slabReady) return;
+  for (int c = 0; c < SLAB_CLASS_COUNT; c++) {
+    SlabClass& s = _slabs[c];
+    s.st.blockSize = kSlabSizes[c];
+    s.base = (uint8_t*)hpAlloc((size_t)kSlabSizes[c] * kSlabCounts[c], HP_HEAP_PSRAM, "slab.pool");
+    s.freeStack = (uint16_t*)hpAlloc(kSlabCounts[c] * sizeof(uint16_t), HP_HEAP_PSRAM, "slab.pool");
+    if (!s.base || !s.freeStack) {
+      // Sin PSRAM: la clase queda vacía y todo va por fallback
+      hpFree(s.base); hpFree(s.freeStack);
+      s.base = nullptr; s.freeStack = nullptr;
+      s.st.blocks = 0;
+      s.freeTop = 0;
+      continue;
+    }
+    s.st.blocks = kSlabCounts[c];
+    for (uint16_t i = 0; i < kSlabCounts[c]; i++) s.freeStack[i] = kSlabCounts[c] - 1 - i;
+    s.freeTop = kSlabCounts[c];
+  }
+  _slabReady = true;
+}
+
+static inline int slabClassOf(const void* ptr) {
+  const uint8_t* p = (const uint8_t*)ptr;
+  for (int c = 0; c < SLAB_CLASS_COUNT; c++) {
+    const SlabClass& s = _slabs[c];
+    if (s.base && p >= s.base && p < s.base + (size_t)s.st.blockSize * s.st.blocks) return c;
+  }
+  return -1;
+}
+
+void* slabAlloc(size_t size) {
+  if (size == 0) return nullptr;
+  for (int c = 0; c < SLAB_CLASS_COUNT; c++) {
+    if (size > kSlabSizes[c]) continue;
+    SlabClass& s = _slabs[c];
+    void* p = nullptr;
+    portENTER_CRITICAL(&_slabMux);
+    if (s.freeTop > 0) {
+      uint16_t idx = s.freeStack[--s.freeTop];
+      p = s.base + (size_t)idx * s.st.blockSize;
+      s.st.used++;
+      if (s.st.used > s.st.peak) s.st.peak = s.st.used;
+    } else {
+      s.st.fallback++;
+    }
+    portEXIT_CRITICAL(&_slabMux);
+    if (p) return p;
+    break;  // clase agotada: no robar bloques de la siguiente (son escasos)
+  }
+  if (size > kSlabSizes[SLAB_CLASS_COUNT - 1]) _slabOversize++;
+  return hpAlloc(size, HP_HEAP_PSRAM, "slab.fallback");
+}
+
+void slabFree(void* ptr) {
+  if (!ptr) return;
+  int c = slabClassOf(ptr);
+  if (c < 0) {
+    hpFree(ptr);   // fallback / oversize
+    return;
+  }
+  SlabClass& s = _slabs[c];
+  uint16_t idx = (uint16_t)(((uint8_t*)ptr - s.base) / s.st.blockSize);
+  portENTER_CRITICAL(&_slabMux);
+  s.freeStack[s.freeTop++] = idx;
+  s.st.used--;
+  portEXIT_CRITICAL(&_slabMux);
+}
+
+void* slabRealloc(void* ptr, size_t size) {
+  if (!ptr) return slabAlloc(size);
+  int c = slabClassOf(ptr);
+  if (c < 0) return hpRealloc(ptr, size, HP_HEAP_PSRAM, "slab.fallback");
+  if (size <= kSlabSizes[c]) return ptr;   // cabe en el mismo bloque
+  void* p = slabAlloc(size);
+  if (!p) return nullptr;
+  memcpy(p, ptr, kSlabSizes[c]);
+  slabFree(ptr);
+  return p;
+}
+
+const SlabClassStats& slabClassStats(int cls) {
+  return _slabs[cls].st;
+}
+
+uint32_t slabOversize() {
+  return _slabOversize;
+}
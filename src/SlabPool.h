@@ -0,0 +1,68 @@
+/*
+ * SlabPool.h
+ * RED808 pools de bloques fijos en PSRAM para los buffers de red (frames WS,
+ * reensamblado, documentos JSON, respuestas): alloc/free O(1) sin tocar el
+ * heap interno, que deja de fragmentarse en sesiones largas.
+ */
+
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+
+// ═══════════════════════════════════════════════════════
+// CLASES DE TAMAÑO
+// ═══════════════════════════════════════════════════════
+// Cada clase es una región contigua en PSRAM partida en bloques iguales con
+// una pila de índices libres: slabFree() deduce la clase por rango de
+// direcciones. Si una clase se agota se cae a heap_caps_malloc(SPIRAM) y se
+// cuenta en fallback (nunca al heap interno).
+//   256 B  × 48  frames WS pequeños, respuestas cortas
+//   1 KB   × 24  frames WS medianos, JSON de comandos
+//   4 KB   × 12  documentos UDP / respuestas de listados
+//   32 KB  × 4   reensamblado de patrón (kWsMaxPatternBytes + 2) y setBulk
+// Total ≈ 212 KB de PSRAM reservados en slabPoolInit().
+#define SLAB_CLASS_COUNT 4
+
+void  slabPoolInit();
+void* slabAlloc(size_t size);
+void  slabFree(void* ptr);
+void* slabRealloc(void* ptr, size_t size);
+
+struct SlabClassStats {
+  uint32_t blockSize;
+  uint16_t blocks;
+  uint16_t used;
+  uint16_t peak;
+  uint32_t fallback;   // peticiones que no cupieron en la clase
+};
+const SlabClassStats& slabClassStats(int cls);
+uint32_t slabOversize();  // peticiones > clase mayor (van directas a PSRAM)
+
+// Allocator para ArduinoJson: SlabJsonDocument doc(4096) sustituye a
+// DynamicJsonDocument / StaticJsonDocument grandes en la ruta de red
+struct SlabAllocator {
+  void* allocate(size_t size) { return slabAlloc(size); }
+  void deallocate(void* ptr) { slabFree(ptr); }
+  void* reallocate(void* ptr, size_t size) { return slabRealloc(ptr, size); }
+};
+using SlabJsonDocument = BasicJsonDocument<SlabAllocator>;
+
+// Buffer de texto con vida de ámbito (serializar respuestas sin String)
+class SlabBuffer {
+public:
+  explicit SlabBuffer(size_t size) : data_((char*)slabAlloc(size)), size_(data_ ? size : 0) {}
+  ~SlabBuffer() { slabFree(data_); }
+  SlabBuffer(const SlabBuffer&) = delete;
+  SlabBuffer& operator=(const SlabBuffer&) = delete;
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  char* data_;
+  size_t size_;
+};
+
+#endif // SLAB_POOL_H
@@ -0,0 +1,48 @@
+/*
+ * UdpSync.cpp
+ * RED808 historial de paquetes de sync UDP binarios (ver UdpSync.h)
+ */
+
+#include "UdpSync.h"
+#include <Arduino.h>
+
+// Ring de paquetes en PSRAM: se codifica directamente en el slot, así un
+// sync_nack reenvía los mismos bytes sin volver a serializar.
+static uint8_t* _syncHistoryBuf = nullptr;
+static UdpSyncPacket _syncHistory[UDP_SYNC_HISTORY];
+static uint16_t _syncNextSeq = 1;
+static uint8_t _syncHead = 0;
+
+UdpSyncPacket* udpSyncBegin() {
+  if (!_syncHistoryBuf) {
+    _syncHistoryBuf = (uint8_t*)ps_malloc(UDP_SYNC_HISTORY * UDP_SYNC_MAX_PACKET);
+    if (!_syncHistoryBuf) return nullptr;
+    for (int i = 0; i < UDP_SYNC_HISTORY; i++) {
+      _syncHistory[i].data = _syncHistoryBuf + i * UDP_SYNC_MAX_PACKET;
+      _syncHistory[i].len = 0;
+      _syncHistory[i].seq = 0;
+    }
+  }
+
+  UdpSyncPacket& slot = _syncHistory[_syncHead];
+  _syncHead = (_syncHead + 1) % UDP_SYNC_HISTORY;
+  slot.seq = _syncNextSeq++;
+  if (_syncNextSeq == 0) _syncNextSeq = 1;  // 0 = slot vacío
+  slot.len = 0;
+
+  uint32_t ms = millis();
+  slot.data[0] = UDP_SYNC_MAGIC;
+  slot.data[1] = UDP_SYNC_VERSION;
+  slot.data[2] = slot.seq & 0xFF;
+  slot.data[3] = slot.seq >> 8;
+  for (int b = 0; b < 4; b++) slot.data[4 + b] = (uint8_t)(ms >> (b * 8));
+  return &slot;
+}
+
+const UdpSyncPacket* udpSyncFind(uint16_t seq) {
+  if (!_syncHistoryBuf || seq == 0) return nullptr;
+  for (int i = 0; i < UDP_SYNC_HISTORY; i++) {
+    if (_syncHistory[i].seq == seq && _syncHistory[i].len > 0) return &_syncHistory[i];
+  }
+  return nullptr;
+}
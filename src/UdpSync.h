@@ -0,0 +1,117 @@
+/*
+ * UdpSync.h
+ * RED808 protocolo binario de sincronización UDP master → slaves (P4/S3)
+ * Sustituye state_sync / melody_sync JSON para slaves que anuncian binProto >= 3.
+ */
+
+#ifndef UDP_SYNC_H
+#define UDP_SYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ═══════════════════════════════════════════════════════
+// PACKET FORMAT (little-endian)
+// ═══════════════════════════════════════════════════════
+// [0]     0xB3 magic
+// [1]     versión (1)
+// [2..3]  seq u16 — global, +1 por paquete; un hueco = paquete perdido
+// [4..7]  millis() del master (u32)
+// [8..]   secciones TLV: [type u8][len u16][payload]; tipos desconocidos se saltan
+//
+// 0x01 TRANSPORT  pattern, playing, step, stepCount (u8), tempo×10 (u16),
+//                 masterVol, seqVol, liveVol (u8)
+// 0x02 MIXER      16 × [flags u8 (b0 mute, b1 solo, b2 echo, b3 flanger, b4 comp),
+//                       volume, filter, reverbSend, delaySend, chorusSend (u8), pan (i8)]
+// 0x03 MASTER_FX  filterType, bitCrush, flags (b0 delay, b1 phaser, b2 flanger,
+//                 b3 comp, b4 reverb, b5 chorus) (u8), sampleRate (u16),
+//                 cutoff, resonance, distortion (f32)
+// 0x04 SAMPLES    sdPresent (u8), sdLoadedMask (u32), kit (u8 len + chars),
+//                 count (u8) × [pad u8, nameLen u8, name]
+// 0x05 PATTERN    pattern (u8), stepCount (u8), 16 × u64 step mask
+// 0x06 MELODY     engine, octave, rec, step, pad (u8), 16 × u16 grid (bit r = fila r)
+//
+// Los paquetes enviados se guardan en un historial de UDP_SYNC_HISTORY entradas;
+// un slave que detecta un hueco pide {"cmd":"sync_nack","seq":N,"count":K}.
+// Mantener sincronizado con UDP_PROTOCOL_MASTER_SLAVE.md.
+
+#define UDP_SYNC_MAGIC        0xB3
+#define UDP_SYNC_VERSION      1
+#define UDP_SYNC_HEADER_SIZE  8
+#define UDP_SYNC_MAX_PACKET   1024   // < MTU tras IP/UDP: nunca se fragmenta
+#define UDP_SYNC_HISTORY      16
+#define UDP_SYNC_BIN_PROTO    3      // binProto mínimo del slave para recibir 0xB3
+
+#define USYNC_TRANSPORT   0x01
+#define USYNC_MIXER       0x02
+#define USYNC_MASTER_FX   0x03
+#define USYNC_SAMPLES     0x04
+#define USYNC_PATTERN     0x05
+#define USYNC_MELODY      0x06
+
+// Multicast opcional (-DUDP_SYNC_MULTICAST=1): un solo envío al grupo en vez de
+// un unicast por slave. Los slaves deben unirse al grupo y escuchar en el puerto.
+#ifndef UDP_SYNC_MULTICAST
+#define UDP_SYNC_MULTICAST 0
+#endif
+#define UDP_SYNC_MCAST_GROUP  239, 80, 8, 8
+#define UDP_SYNC_MCAST_PORT   8889
+
+// Slot del historial donde se codifica el paquete (sin copia al reenviar)
+struct UdpSyncPacket {
+  uint8_t* data;
+  size_t len;
+  uint16_t seq;
+};
+
+// Reserva el siguiente slot del historial y escribe la cabecera. nullptr sin PSRAM.
+UdpSyncPacket* udpSyncBegin();
+// Paquete del historial con ese seq, o nullptr si ya se sobrescribió.
+const UdpSyncPacket* udpSyncFind(uint16_t seq);
+
+// ── Writer TLV acotado: cualquier desborde invalida el paquete ──
+class UdpSyncWriter {
+public:
+  explicit UdpSyncWriter(UdpSyncPacket* pkt)
+    : pkt_(pkt), pos_(UDP_SYNC_HEADER_SIZE), secPos_(0), ok_(pkt != nullptr) {}
+
+  void begin(uint8_t type) { u8(type); secPos_ = pos_; u16(0); }
+  void end() {
+    if (!ok_) return;
+    size_t len = pos_ - secPos_ - 2;
+    pkt_->data[secPos_] = len & 0xFF;
+    pkt_->data[secPos_ + 1] = len >> 8;
+  }
+
+  void u8(uint8_t v) { if (room(1)) pkt_->data[pos_++] = v; }
+  void u16(uint16_t v) { if (room(2)) { pkt_->data[pos_++] = v & 0xFF; pkt_->data[pos_++] = v >> 8; } }
+  void u32(uint32_t v) { for (int b = 0; b < 4; b++) u8((uint8_t)(v >> (b * 8))); }
+  void u64(uint64_t v) { for (int b = 0; b < 8; b++) u8((uint8_t)(v >> (b * 8))); }
+  void f32(float v) { uint32_t bits; memcpy(&bits, &v, 4); u32(bits); }
+  void str8(const char* s, size_t maxLen) {
+    size_t n = s ? strnlen(s, maxLen) : 0;
+    if (n > 255) n = 255;
+    u8((uint8_t)n);
+    if (room(n)) { memcpy(pkt_->data + pos_, s, n); pos_ += n; }
+  }
+
+  // Cierra el paquete; 0 si no cupo
+  size_t finish() {
+    if (!pkt_) return 0;
+    pkt_->len = ok_ ? pos_ : 0;
+    return pkt_->len;
+  }
+
+private:
+  bool room(size_t n) {
+    if (!ok_ || pos_ + n > UDP_SYNC_MAX_PACKET) { ok_ = false; return false; }
+    return true;
+  }
+  UdpSyncPacket* pkt_;
+  size_t pos_;
+  size_t secPos_;
+  bool ok_;
+};
+
+#endif // UDP_SYNC_H
@@ -0,0 +1,225 @@
+/*
+ * WavStream.cpp
+ * RED808 parser WAV incremental (ver WavStream.h)
+ */
+
+#include "WavStream.h"
+#include <string.h>
+#include <stdio.h>
+
+static inline uint32_t rdU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static inline uint16_t rdU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+void WavStreamParser::begin(AllocFn alloc, void* ctx, size_t sizeHint, ResampleQuality quality) {
+  alloc_ = alloc;
+  ctx_ = ctx;
+  sizeHint_ = sizeHint;
+  consumed_ = 0;
+  state_ = ST_RIFF;
+  hdrLen_ = 0;
+  hdrNeed_ = 12;
+  skip_ = 0;
+  dataLeft_ = 0;
+  carryLen_ = 0;
+  fmtFound_ = false;
+  spec_ = {};
+  frameBytes_ = 0;
+  srcRate_ = 0;
+  quality_ = quality;
+  resampler_.end();
+  out_ = nullptr;
+  numSamples_ = 0;
+  written_ = 0;
+  samplesReady_.store(0, std::memory_order_relaxed);
+  hasFormat_.store(false, std::memory_order_release);
+  error_[0] = '\0';
+}
+
+bool WavStreamParser::fail(const char* msg) {
+  strncpy(error_, msg, sizeof(error_) - 1);
+  error_[sizeof(error_) - 1] = '\0';
+  state_ = ST_ERROR;
+  return false;
+}
+
+bool WavStreamParser::onChunkHeader() {
+  uint32_t chunkSize = rdU32(hdr_ + 4);
+  if (memcmp(hdr_, "fmt ", 4) == 0) {
+    if (chunkSize < 16) return fail("fmt chunk too small");
+    skip_ = chunkSize - 16 + (chunkSize & 1);
+    state_ = ST_FMT;
+    hdrNeed_ = 16;
+    return true;
+  }
+  if (memcmp(hdr_, "data", 4) != 0) {
+    skip_ = chunkSize + (chunkSize & 1);  // alineado a 2 bytes
+    state_ = ST_SKIP;
+    return true;
+  }
+
+  if (!fmtFound_) return fail("No fmt chunk found");
+  // Truncar si el chunk declara más de lo que puede traer el upload
+  uint32_t maxData = (sizeHint_ > consumed_) ? (uint32_t)(sizeHint_ - consumed_) : 0;
+  if (chunkSize == 0 || chunkSize > maxData) chunkSize = maxData;
+  uint32_t frames = chunkSize / frameBytes_;
+  if (frames == 0) return fail("Empty data chunk");
+  // Otro rate: se reserva ya la longitud de salida (la que anuncia BEGIN al SPI)
+  numSamples_ = frames;
+  if (srcRate_ != 0 && srcRate_ != RS_TARGET_RATE) {
+    if (resampler_.begin(srcRate_, RS_TARGET_RATE, quality_, frames)) {
+      numSamples_ = resampler_.outputLength();
+    } else if (resampler_.failed()) {
+      return fail("No memory for resampler");
+    }
+  }
+  out_ = alloc_ ? alloc_(ctx_, numSamples_) : nullptr;
+  if (!out_) {
+    resampler_.end();
+    return fail("No PSRAM for sample");
+  }
+  dataLeft_ = frames * frameBytes_;
+  state_ = ST_DATA;
+  hasFormat_.store(true, std::memory_order_release);
+  return true;
+}
+
+bool WavStreamParser::onFmt() {
+  char msg[48];
+  if (!pcmSpecFromWav(rdU16(hdr_), rdU16(hdr_ + 14), rdU16(hdr_ + 2), &spec_, msg, sizeof(msg))) {
+    return fail(msg);
+  }
+  frameBytes_ = spec_.frameBytes;
+  srcRate_ = rdU32(hdr_ + 4);
+  fmtFound_ = true;
+  state_ = skip_ ? ST_SKIP : ST_CHUNK_HDR;
+  return true;
+}
+
+// frames completos → out_ (directo, o por el resampler en tramos de 256)
+void WavStreamParser::emit(const uint8_t* src, size_t frames) {
+  if (!resampler_.active()) {
+    pcmConvert(spec_, src, out_ + written_, frames);
+    written_ += frames;
+    return;
+  }
+  int16_t mono[256];
+  while (frames > 0) {
+    size_t n = frames < 256 ? frames : 256;
+    pcmConvert(spec_, src, mono, n);
+    written_ += resampler_.process(mono, n, out_ + written_, numSamples_ - written_);
+    src += n * frameBytes_;
+    frames -= n;
+  }
+}
+
+size_t WavStreamParser::consumeData(const uint8_t* data, size_t len) {
+  size_t used = 0;
+  if (len > dataLeft_) len = dataLeft_;
+
+  // Completar el frame partido del chunk anterior
+  if (carryLen_ > 0) {
+    size_t take = frameBytes_ - carryLen_;
+    if (take > len) take = len;
+    memcpy(carry_ + carryLen_, data, take);
+    carryLen_ += take;
+    used += take;
+    if (carryLen_ == frameBytes_) {
+      emit(carry_, 1);
+      carryLen_ = 0;
+    }
+  }
+
+  size_t frames = (len - used) / frameBytes_;
+  const uint8_t* src = data + used;
+  emit(src, frames);
+  used += frames * frameBytes_;
+
+  size_t rest = len - used;
+  if (rest > 0) {
+    memcpy(carry_, data + used, rest);
+    carryLen_ = (uint8_t)rest;
+    used += rest;
+  }
+
+  dataLeft_ -= used;
+  if (dataLeft_ == 0) {
+    // Cola del filtro: completa outputLength()
+    if (resampler_.active()) written_ += resampler_.flush(out_ + written_, numSamples_ - written_);
+    state_ = ST_DONE;
+  }
+  samplesReady_.store(written_, std::memory_order_release);
+  return used;
+}
+
+bool WavStreamParser::feed(const uint8_t* data, size_t len) {
+  while (len > 0) {
+    size_t used = 0;
+    switch (state_) {
+      case ST_RIFF:
+      case ST_CHUNK_HDR:
+      case ST_FMT: {
+        used = hdrNeed_ - hdrLen_;
+        if (used > len) used = len;
+        memcpy(hdr_ + hdrLen_, data, used);
+        hdrLen_ += used;
+        if (hdrLen_ < hdrNeed_) break;
+        hdrLen_ = 0;
+        if (state_ == ST_RIFF) {
+          if (memcmp(hdr_, "RIFF", 4) != 0 || memcmp(hdr_ + 8, "WAVE", 4) != 0) {
+            return fail("Not a WAV file");
+          }
+          state_ = ST_CHUNK_HDR;
+          hdrNeed_ = 8;
+        } else if (state_ == ST_CHUNK_HDR) {
+          consumed_ += used;   // onChunkHeader usa consumed_ como inicio del payload
+          if (!onChunkHeader()) return false;
+          data += used;
+          len -= used;
+          continue;
+        } else {
+          if (!onFmt()) return false;
+          hdrNeed_ = 8;
+        }
+        break;
+      }
+      case ST_SKIP:
+        used = (skip_ < len) ? skip_ : len;
+        skip_ -= used;
+        if (skip_ == 0) {
+          state_ = ST_CHUNK_HDR;
+          hdrNeed_ = 8;
+        }
+        break;
+      case ST_DATA:
+        used = consumeData(data, len);
+        break;
+      case ST_DONE:
+        return true;  // chunks tras "data" (LIST, id3...) se ignoran
+      case ST_ERROR:
+        return false;
+    }
+    consumed_ += used;
+    data += used;
+    len -= used;
+  }
+  return true;
+}
+
+bool WavStreamParser::finish() {
+  if (state_ == ST_ERROR) return false;
+  if (!hasFormat()) {
+    return fail(fmtFound_ ? "No data chunk found" : (state_ == ST_RIFF ? "File too small" : "No fmt chunk found"));
+  }
+  // Upload más corto que el chunk declarado: el resto es silencio, así la
+  // longitud anunciada al SPI (BEGIN) sigue siendo válida
+  if (resampler_.active()) written_ += resampler_.flush(out_ + written_, numSamples_ - written_);
+  if (written_ < numSamples_) {
+    memset(out_ + written_, 0, (numSamples_ - written_) * sizeof(int16_t));
+    written_ = numSamples_;
+  }
+  state_ = ST_DONE;
+  samplesReady_.store(written_, std::memory_order_release);
+  return true;
+}
@@ -0,0 +1,80 @@
+/*
+ * WavStream.h
+ * RED808 parser WAV incremental para uploads HTTP: consume los chunks según
+ * llegan y convierte el PCM directamente al buffer final de 16-bit mono
+ * (pasando por el resampler si el WAV no está a RS_TARGET_RATE).
+ */
+
+#ifndef WAV_STREAM_H
+#define WAV_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "PcmConvert.h"
+#include "Resampler.h"
+
+// ═══════════════════════════════════════════════════════
+// WavStreamParser
+// ═══════════════════════════════════════════════════════
+// Máquina de estados RIFF → chunks → fmt → data. Mismos formatos que
+// SampleManager::parseWavFromBuffer (PcmConvert.h): PCM 8/16/24-bit, float32,
+// mono/estéreo (estéreo → mixdown mono). Los frames partidos entre dos chunks
+// HTTP se guardan en carry_ (máx. 8 bytes); nunca hay copia del fichero completo.
+//
+// Un productor (feed, task de AsyncWebServer) y un lector (update en Core0):
+// samplesReady() se publica con release tras escribir las muestras, así el
+// lector puede enviar por SPI todo lo anterior sin lock. buffer() y
+// numSamples() se fijan antes de publicar hasFormat(): leerlos sólo después.
+class WavStreamParser {
+public:
+  // Llamado una vez al encontrar el chunk "data"; nullptr → error "No PSRAM"
+  typedef int16_t* (*AllocFn)(void* ctx, uint32_t numSamples);
+
+  void begin(AllocFn alloc, void* ctx, size_t sizeHint, ResampleQuality quality = RS_Q_MEDIUM);
+  bool feed(const uint8_t* data, size_t len);   // false → error()
+  bool finish();                                // rellena con silencio si faltó audio
+
+  bool hasFormat() const { return hasFormat_.load(std::memory_order_acquire); }
+  uint32_t samplesReady() const { return samplesReady_.load(std::memory_order_acquire); }
+  uint32_t numSamples() const { return numSamples_; }
+  int16_t* buffer() const { return out_; }
+  bool failed() const { return state_ == ST_ERROR; }
+  const char* error() const { return error_; }
+
+private:
+  enum State : uint8_t { ST_RIFF, ST_CHUNK_HDR, ST_FMT, ST_SKIP, ST_DATA, ST_DONE, ST_ERROR };
+
+  bool fail(const char* msg);
+  bool onChunkHeader();
+  bool onFmt();
+  size_t consumeData(const uint8_t* data, size_t len);
+  void emit(const uint8_t* src, size_t frames);
+
+  AllocFn alloc_;
+  void* ctx_;
+  size_t sizeHint_;
+  size_t consumed_;       // bytes del fichero consumidos (para acotar con sizeHint)
+  State state_;
+  uint8_t hdr_[16];       // cabecera RIFF / chunk / cuerpo fmt en construcción
+  uint8_t hdrLen_;
+  uint8_t hdrNeed_;
+  uint32_t skip_;         // bytes a saltar del chunk actual (+ padding)
+  uint32_t dataLeft_;     // bytes de audio restantes en el chunk data
+  uint8_t carry_[8];
+  uint8_t carryLen_;
+  bool fmtFound_;
+  PcmSpec spec_;
+  uint8_t frameBytes_;
+  uint32_t srcRate_;
+  ResampleQuality quality_;
+  Resampler resampler_;   // propio: el upload corre en async_tcp, loadSample en systemTask
+  int16_t* out_;
+  uint32_t numSamples_;
+  uint32_t written_;
+  std::atomic<uint32_t> samplesReady_{0};
+  std::atomic<bool> hasFormat_{false};
+  char error_[48];
+};
+
+#endif // WAV_STREAM_H
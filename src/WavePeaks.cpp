@@ -0,0 +1,262 @@
+/*
+ * WavePeaks.cpp
+ * RED808 pirámide de picos para el visualizador (ver WavePeaks.h)
+ */
+
+#include "WavePeaks.h"
+#include "HeapProfiler.h"
+#include <string.h>
+#include <new>
+
+// ═══════════════════════════════════════════════════════
+// PeakPyramid
+// ═══════════════════════════════════════════════════════
+PeakPyramid* PeakPyramid::create(uint32_t numSamples, uint8_t baseShift) {
+  if (numSamples == 0 || baseShift > 16) return nullptr;
+
+  uint32_t count[PEAK_MAX_LEVELS];
+  uint32_t offset[PEAK_MAX_LEVELS];
+  uint8_t levels = 0;
+  uint32_t total = 0;
+  uint32_t c = ((numSamples - 1) >> baseShift) + 1;
+  while (levels < PEAK_MAX_LEVELS) {
+    count[levels] = c;
+    offset[levels] = total;
+    total += c;
+    levels++;
+    if (c == 1) break;
+    c = (c + 1) / 2;
+  }
+
+  size_t bytes = sizeof(PeakPyramid) + (size_t)total * 2;
+  void* mem = hpAlloc(bytes, HP_HEAP_PSRAM, "waveform.pyramid");
+  if (!mem) return nullptr;
+
+  PeakPyramid* p = new (mem) PeakPyramid();
+  p->numSamples_ = numSamples;
+  p->fed_ = 0;
+  p->base_ = 0;
+  p->accMax_ = 0;
+  p->accMin_ = 0;
+  p->accN_ = 0;
+  p->bytes_ = bytes;
+  p->baseShift_ = baseShift;
+  p->levels_ = levels;
+  memcpy(p->count_, count, levels * sizeof(uint32_t));
+  memcpy(p->offset_, offset, levels * sizeof(uint32_t));
+  return p;
+}
+
+PeakPyramid* PeakPyramid::build(const int16_t* samples, uint32_t numSamples) {
+  if (!samples) return nullptr;
+  PeakPyramid* p = create(numSamples);
+  if (!p) return nullptr;
+  p->feed(samples, numSamples);
+  p->finish();
+  return p;
+}
+
+void PeakPyramid::destroy(PeakPyramid* p) {
+  if (p) hpFree(p);   // trivialmente destructible: basta con liberar el bloque
+}
+
+void PeakPyramid::pushBase(int16_t mx, int16_t mn) {
+  if (base_ >= count_[0]) return;
+  int8_t* d = pairs() + (size_t)base_ * 2;
+  d[0] = (int8_t)(mx >> 8);
+  d[1] = (int8_t)(mn >> 8);
+  base_++;
+}
+
+void PeakPyramid::feed(const int16_t* samples, size_t n) {
+  if (fed_ + n > numSamples_) n = numSamples_ - fed_;
+  const uint32_t block = 1u << baseShift_;
+  int16_t mx = accMax_, mn = accMin_;
+  uint32_t acc = accN_;
+  while (n > 0) {
+    uint32_t take = block - acc;
+    if (take > n) take = n;
+    for (uint32_t j = 0; j < take; j++) {
+      int16_t s = samples[j];
+      if (s > mx) mx = s;
+      if (s < mn) mn = s;
+    }
+    samples += take;
+    n -= take;
+    fed_ += take;
+    acc += take;
+    if (acc == block) {
+      pushBase(mx, mn);
+      mx = 0;
+      mn = 0;
+      acc = 0;
+    }
+  }
+  accMax_ = mx;
+  accMin_ = mn;
+  accN_ = acc;
+}
+
+void PeakPyramid::finish() {
+  if (accN_ > 0) {
+    pushBase(accMax_, accMin_);
+    accN_ = 0;
+  }
+  // Fichero más corto que lo anunciado en la cabecera: silencio
+  while (base_ < count_[0]) pushBase(0, 0);
+
+  int8_t* d = pairs();
+  for (uint8_t l = 1; l < levels_; l++) {
+    const int8_t* src = d + (size_t)offset_[l - 1] * 2;
+    int8_t* dst = d + (size_t)offset_[l] * 2;
+    uint32_t srcCount = count_[l - 1];
+    for (uint32_t i = 0; i < count_[l]; i++) {
+      const int8_t* a = src + (size_t)i * 4;
+      int8_t mx = a[0], mn = a[1];
+      if (i * 2 + 1 < srcCount) {
+        if (a[2] > mx) mx = a[2];
+        if (a[3] < mn) mn = a[3];
+      }
+      dst[i * 2] = mx;
+      dst[i * 2 + 1] = mn;
+    }
+  }
+}
+
+int PeakPyramid::query(uint32_t start, uint32_t end, int points, int8_t* out,
+                       const int16_t* raw) const {
+  if (end > numSamples_) end = numSamples_;
+  if (start >= end || points <= 0 || !out) return 0;
+  uint32_t span = end - start;
+  if ((uint32_t)points > span) points = (int)span;
+
+  // Nivel más alto cuyo bloque no supera las muestras por punto: cada punto
+  // lee como mucho 3 pares. -1 → PCM directo (zoom por debajo del nivel 0).
+  uint32_t spp = span / (uint32_t)points;
+  int level = -1;
+  if (!raw || spp >= (1u << baseShift_)) {
+    level = 0;
+    while (level + 1 < levels_ && (1u << (baseShift_ + level + 1)) <= spp) level++;
+  }
+
+  const int8_t* lv = (level >= 0) ? pairs() + (size_t)offset_[level] * 2 : nullptr;
+  uint8_t shift = (uint8_t)(baseShift_ + (level >= 0 ? level : 0));
+  for (int i = 0; i < points; i++) {
+    uint32_t s = start + (uint32_t)((uint64_t)span * i / points);
+    uint32_t e = start + (uint32_t)((uint64_t)span * (i + 1) / points);
+    if (level < 0) {
+      int16_t mx = 0, mn = 0;
+      for (uint32_t j = s; j < e; j++) {
+        int16_t v = raw[j];
+        if (v > mx) mx = v;
+        if (v < mn) mn = v;
+      }
+      out[i * 2] = (int8_t)(mx >> 8);
+      out[i * 2 + 1] = (int8_t)(mn >> 8);
+    } else {
+      int8_t mx = 0, mn = 0;
+      for (uint32_t j = s >> shift; j <= (e - 1) >> shift; j++) {
+        if (lv[j * 2] > mx) mx = lv[j * 2];
+        if (lv[j * 2 + 1] < mn) mn = lv[j * 2 + 1];
+      }
+      out[i * 2] = mx;
+      out[i * 2 + 1] = mn;
+    }
+  }
+  return points;
+}
+
+// ═══════════════════════════════════════════════════════
+// CACHE DE PREVIEWS
+// ═══════════════════════════════════════════════════════
+struct PeakCacheEntry {
+  uint32_t pathHash;   // 0 = libre
+  uint32_t fileSize;
+  uint32_t mtime;
+  uint32_t lastUse;
+  PeakPyramid* pyr;
+};
+
+static PeakCacheEntry _peakCache[PEAK_CACHE_SLOTS];
+static uint32_t _peakCacheTick = 0;
+static uint32_t _peakCacheBytes = 0;
+static uint32_t _peakCacheHits = 0;
+static uint32_t _peakCacheMisses = 0;
+
+static uint32_t peakPathHash(const char* path) {
+  uint32_t h = 2166136261u;   // FNV-1a
+  while (*path) {
+    h ^= (uint8_t)*path++;
+    h *= 16777619u;
+  }
+  return h ? h : 1;
+}
+
+static void peakCacheDrop(PeakCacheEntry& e) {
+  if (!e.pyr) return;
+  _peakCacheBytes -= e.pyr->bytes();
+  PeakPyramid::destroy(e.pyr);
+  e.pyr = nullptr;
+  e.pathHash = 0;
+}
+
+const PeakPyramid* peakCacheFind(const char* path, uint32_t fileSize, uint32_t mtime) {
+  uint32_t h = peakPathHash(path);
+  for (auto& e : _peakCache) {
+    if (e.pyr && e.pathHash == h) {
+      if (e.fileSize == fileSize && e.mtime == mtime) {
+        e.lastUse = ++_peakCacheTick;
+        _peakCacheHits++;
+        return e.pyr;
+      }
+      peakCacheDrop(e);   // fichero reescrito: la entrada ya no vale
+      break;
+    }
+  }
+  _peakCacheMisses++;
+  return nullptr;
+}
+
+const PeakPyramid* peakCachePut(const char* path, uint32_t fileSize, uint32_t mtime, PeakPyramid* p) {
+  if (!p) return nullptr;
+  if (p->bytes() > PEAK_CACHE_BUDGET) {
+    PeakPyramid::destroy(p);
+    return nullptr;
+  }
+  uint32_t h = peakPathHash(path);
+  for (auto& e : _peakCache) {
+    if (e.pathHash == h) peakCacheDrop(e);
+  }
+
+  // Expulsar por LRU hasta que quepa y haya slot libre
+  for (;;) {
+    PeakCacheEntry* freeSlot = nullptr;
+    PeakCacheEntry* oldest = nullptr;
+    for (auto& e : _peakCache) {
+      if (!e.pyr) { if (!freeSlot) freeSlot = &e; continue; }
+      if (!oldest || e.lastUse < oldest->lastUse) oldest = &e;
+    }
+    if (freeSlot && _peakCacheBytes + p->bytes() <= PEAK_CACHE_BUDGET) {
+      freeSlot->pathHash = h;
+      freeSlot->fileSize = fileSize;
+      freeSlot->mtime = mtime;
+      freeSlot->lastUse = ++_peakCacheTick;
+      freeSlot->pyr = p;
+      _peakCacheBytes += p->bytes();
+      return p;
+    }
+    if (!oldest) break;
+    peakCacheDrop(*oldest);
+  }
+  PeakPyramid::destroy(p);
+  return nullptr;
+}
+
+void peakCacheStats(uint8_t* entries, uint32_t* bytes, uint32_t* hits, uint32_t* misses) {
+  uint8_t n = 0;
+  for (auto& e : _peakCache) if (e.pyr) n++;
+  if (entries) *entries = n;
+  if (bytes) *bytes = _peakCacheBytes;
+  if (hits) *hits = _peakCacheHits;
+  if (misses) *misses = _peakCacheMisses;
+}
@@ -0,0 +1,78 @@
+/*
+ * WavePeaks.h
+ * RED808 pirámide min/max de picos para /api/waveform: se construye una vez
+ * por sample (o por fichero de LittleFS) y cada petición lee el nivel cuyo
+ * bloque se acerca más a las muestras por punto → coste O(points).
+ */
+
+#ifndef WAVE_PEAKS_H
+#define WAVE_PEAKS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ═══════════════════════════════════════════════════════
+// PeakPyramid
+// ═══════════════════════════════════════════════════════
+// Nivel 0: un par (max, min) int8 por bloque de 2^baseShift muestras; cada
+// nivel siguiente agrupa 2 pares del anterior. Misma cuantización que el
+// visualizador (>> 8) y mismo convenio: max >= 0, min <= 0.
+// Coste en PSRAM ≈ numSamples / 2^(baseShift-2) bytes: 1/32 del PCM con el
+// bloque por defecto de 64 muestras.
+#define PEAK_BASE_SHIFT   6
+#define PEAK_MAX_LEVELS   24
+
+class PeakPyramid {
+public:
+  // Reserva cabecera + niveles en un solo bloque de PSRAM; nullptr si no cabe
+  static PeakPyramid* create(uint32_t numSamples, uint8_t baseShift = PEAK_BASE_SHIFT);
+  static PeakPyramid* build(const int16_t* samples, uint32_t numSamples);  // create + feed + finish
+  static void destroy(PeakPyramid* p);
+
+  // Construcción incremental (en orden); finish rellena con silencio lo que falte
+  void feed(const int16_t* samples, size_t n);
+  void finish();
+
+  // Picos de [start, end) en `points` pares (max, min) en out. Si el nivel 0 es
+  // más grueso que las muestras por punto y hay raw, se escanea el PCM (como
+  // mucho 2^baseShift muestras por punto). Devuelve los puntos escritos.
+  int query(uint32_t start, uint32_t end, int points, int8_t* out,
+            const int16_t* raw = nullptr) const;
+
+  uint32_t numSamples() const { return numSamples_; }
+  size_t bytes() const { return bytes_; }
+
+private:
+  PeakPyramid() {}
+  int8_t* pairs() { return (int8_t*)(this + 1); }
+  const int8_t* pairs() const { return (const int8_t*)(this + 1); }
+  void pushBase(int16_t mx, int16_t mn);
+
+  uint32_t numSamples_;
+  uint32_t fed_;
+  uint32_t base_;          // pares de nivel 0 ya escritos
+  int16_t  accMax_;
+  int16_t  accMin_;
+  uint32_t accN_;
+  size_t   bytes_;
+  uint8_t  baseShift_;
+  uint8_t  levels_;
+  uint32_t count_[PEAK_MAX_LEVELS];    // pares por nivel
+  uint32_t offset_[PEAK_MAX_LEVELS];   // primer par del nivel
+};
+
+// ═══════════════════════════════════════════════════════
+// CACHE DE PREVIEWS (modo ?file=)
+// ═══════════════════════════════════════════════════════
+// LRU pequeño en PSRAM por ruta + tamaño + mtime: volver a abrir el mismo
+// fichero en el navegador de samples no vuelve a leerlo entero. Sólo lo usa
+// el handler HTTP (task async_tcp), así que no lleva lock.
+#define PEAK_CACHE_SLOTS   8
+#define PEAK_CACHE_BUDGET  (512 * 1024)
+
+const PeakPyramid* peakCacheFind(const char* path, uint32_t fileSize, uint32_t mtime);
+// Toma posesión de p (lo libera si no cabe en el presupuesto); devuelve p o nullptr
+const PeakPyramid* peakCachePut(const char* path, uint32_t fileSize, uint32_t mtime, PeakPyramid* p);
+void peakCacheStats(uint8_t* entries, uint32_t* bytes, uint32_t* hits, uint32_t* misses);
+
+#endif // WAVE_PEAKS_H
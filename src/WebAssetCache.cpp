@@ -0,0 +1,121 @@
+/*
+ * WebAssetCache.cpp
+ * RED808 caché PSRAM de assets web (ver WebAssetCache.h)
+ */
+
+#include "WebAssetCache.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+
+static WebAsset _assets[WEB_ASSET_MAX];
+static uint8_t _assetCount = 0;
+static WebAssetCacheStats _assetStats = {};
+
+// Lee "nombre etag" por línea (nombre sin .gz, etag hex sin comillas)
+static bool lookupManifestEtag(const String& manifest, const char* name, char* out, size_t outSize) {
+  size_t nameLen = strlen(name);
+  int pos = 0;
+  while (pos < (int)manifest.length()) {
+    int eol = manifest.indexOf('\n', pos);
+    if (eol < 0) eol = manifest.length();
+    if (eol - pos > (int)nameLen + 1 &&
+        strncmp(manifest.c_str() + pos, name, nameLen) == 0 &&
+        manifest[pos + nameLen] == ' ') {
+      String tag = manifest.substring(pos + nameLen + 1, eol);
+      tag.trim();
+      if (tag.length() == 0 || tag.length() + 3 > outSize) return false;
+      snprintf(out, outSize, "\"%s\"", tag.c_str());
+      return true;
+    }
+    pos = eol + 1;
+  }
+  return false;
+}
+
+static void hashEtag(const uint8_t* data, uint32_t len, char* out, size_t outSize) {
+  uint64_t h = 0xcbf29ce484222325ULL;   // FNV-1a 64
+  for (uint32_t i = 0; i < len; i++) {
+    h ^= data[i];
+    h *= 0x100000001b3ULL;
+  }
+  snprintf(out, outSize, "\"%08lx%08lx\"", (unsigned long)(h >> 32), (unsigned long)(h & 0xFFFFFFFF));
+}
+
+void webAssetCacheBegin() {
+  if (_assetCount > 0) return;
+
+  String manifest;
+  File mf = LittleFS.open(WEB_ASSET_ETAG_MANIFEST, "r");
+  if (mf) {
+    manifest = mf.readString();
+    mf.close();
+  }
+
+  File dir = LittleFS.open("/web");
+  if (!dir || !dir.isDirectory()) {
+    Serial.println("[AssetCache] /web no encontrado, se sirve desde LittleFS");
+    return;
+  }
+
+  uint16_t fromManifest = 0;
+  File f = dir.openNextFile();
+  while (f && _assetCount < WEB_ASSET_MAX) {
+    String name = f.name();                       // sin directorio en LittleFS de Arduino 3
+    int slash = name.lastIndexOf('/');
+    if (slash >= 0) name = name.substring(slash + 1);
+    size_t size = f.size();
+
+    bool skip = f.isDirectory() || name == "etags.txt" || size == 0 ||
+                size > WEB_ASSET_MAX_FILE || _assetStats.bytes + size > WEB_ASSET_MAX_TOTAL;
+    if (!skip) {
+      bool gz = name.endsWith(".gz");
+      if (gz) name.remove(name.length() - 3);
+      WebAsset& a = _assets[_assetCount];
+      if (name.length() + 2 > sizeof(a.route)) {
+        skip = true;
+      } else {
+        a.data = (uint8_t*)ps_malloc(size);
+        if (a.data && f.read(a.data, size) == size) {
+          snprintf(a.route, sizeof(a.route), "/%s", name.c_str());
+          a.len = size;
+          a.gzip = gz;
+          if (lookupManifestEtag(manifest, name.c_str(), a.etag, sizeof(a.etag))) {
+            fromManifest++;
+          } else {
+            hashEtag(a.data, a.len, a.etag, sizeof(a.etag));
+          }
+          _assetStats.bytes += size;
+          _assetCount++;
+        } else if (a.data) {
+          free(a.data);
+          a.data = nullptr;
+        }
+      }
+    }
+    f.close();
+    f = dir.openNextFile();
+  }
+  dir.close();
+
+  _assetStats.files = _assetCount;
+  Serial.printf("[AssetCache] %u assets en PSRAM (%lu KB), %u ETags de build\n",
+                _assetCount, (unsigned long)(_assetStats.bytes / 1024), fromManifest);
+}
+
+const WebAsset* webAssetFind(const char* route) {
+  for (uint8_t i = 0; i < _assetCount; i++) {
+    if (strcmp(_assets[i].route, route) == 0) return &_assets[i];
+  }
+  return nullptr;
+}
+
+// If-None-Match puede traer una lista ("a", W/"b") o "*"
+bool webAssetEtagMatches(const WebAsset* asset, const char* ifNoneMatch) {
+  if (!asset || !ifNoneMatch || !ifNoneMatch[0]) return false;
+  if (strcmp(ifNoneMatch, "*") == 0) return true;
+  return strstr(ifNoneMatch, asset->etag) != nullptr;
+}
+
+WebAssetCacheStats& webAssetCacheStats() {
+  return _assetStats;
+}
@@ -0,0 +1,50 @@
+/*
+ * WebAssetCache.h
+ * RED808 caché en PSRAM de los assets web (.gz) con ETag fuerte:
+ * las recargas de la UI no vuelven a leer LittleFS.
+ */
+
+#ifndef WEB_ASSET_CACHE_H
+#define WEB_ASSET_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ═══════════════════════════════════════════════════════
+// ASSETS
+// ═══════════════════════════════════════════════════════
+// Al arrancar se cargan en PSRAM todos los ficheros de /web (app.js.gz →
+// ruta "/app.js" con gzip=true; favicon.ico tal cual). El ETag sale de
+// /web/etags.txt, que genera tools/prepare_data_gz.py en build (sha1 del
+// fuente sin comprimir, así no cambia si el .gz se regenera igual); si falta
+// el manifest o la entrada se calcula FNV-1a del contenido al cargar.
+// Tras webAssetCacheBegin() la tabla es de sólo lectura: segura desde el
+// task de AsyncWebServer sin locks.
+
+#define WEB_ASSET_MAX          32
+#define WEB_ASSET_MAX_FILE     (256 * 1024)
+#define WEB_ASSET_MAX_TOTAL    (1024 * 1024)   // tope PSRAM para toda la caché
+#define WEB_ASSET_ETAG_MANIFEST "/web/etags.txt"
+
+struct WebAsset {
+  char     route[32];      // "/app.js"
+  uint8_t* data;           // PSRAM
+  uint32_t len;
+  bool     gzip;
+  char     etag[20];       // con comillas: "\"0123abcd...\""
+};
+
+struct WebAssetCacheStats {
+  uint16_t files;
+  uint32_t bytes;
+  uint32_t hits;           // 200 servidos desde PSRAM
+  uint32_t notModified;    // 304
+  uint32_t misses;         // fallback a LittleFS
+};
+
+void webAssetCacheBegin();
+const WebAsset* webAssetFind(const char* route);
+bool webAssetEtagMatches(const WebAsset* asset, const char* ifNoneMatch);
+WebAssetCacheStats& webAssetCacheStats();
+
+#endif // WEB_ASSET_CACHE_H
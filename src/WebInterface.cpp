@@ -8,6 +8,21 @@
 #include "Sequencer.h"
 #include "SampleManager.h"
 #include "SysLog.h"
+#include "CommandTable.h"
+#include "WsBinaryProtocol.h"
+#include "PatternCodec.h"
+#include "JsonStream.h"
+#include "UdpSync.h"
+#include "WebAssetCache.h"
+#include "IngressLimiter.h"
+#include "SlabPool.h"
+#include "HeapProfiler.h"
+#include "SampleIndex.h"
+#include "PcmStore.h"
+#include "CmdProfiler.h"
+#include "CmdAck.h"
+#include "PcmConvert.h"
+#include "SampleCache.h"
 #include <esp_wifi.h>
 #include <esp_heap_caps.h>
 #include <esp_task_wdt.h>
@@ -22,11 +37,22 @@
 // Hardening de estabilidad WS bajo estrés
 static constexpr size_t kWsMaxTextBytes = 24576;
 static constexpr size_t kWsMaxBinaryBytes = 256;
+static constexpr size_t kWsMaxPatternBytes = 32768;  // frame 0xB2 (PatternCodec.h)
 static constexpr unsigned long kFastMasterCmdMinMs = 8;
 static constexpr unsigned long kFastTrackCmdMinMs = 8;
 static constexpr unsigned long kFastPadCmdMinMs = 8;
 static constexpr unsigned long kFastVolumeCmdMinMs = 8;
 static constexpr size_t kUdpMaxPacketBytes = 4096;
+// Batch: límite de comandos por envelope y documento del slab según el texto
+// (~1.5× bytes en nodos ArduinoJson con strings sin copiar)
+static constexpr uint16_t kBatchMaxCmds = 64;
+static constexpr size_t kBatchDocBytes(size_t textLen) {
+  return (textLen * 2 + 256 <= 4096) ? 4096 : 32768;
+}
+// Frame de texto WS: comandos sueltos en un bloque de 1 KB, envelopes grandes como batch
+static constexpr size_t kTextDocBytes(size_t textLen) {
+  return (textLen * 2 + 256 <= 1024) ? 1024 : kBatchDocBytes(textLen);
+}
 
 // ── Pre-allocated broadcast buffer in PSRAM to avoid heap fragmentation ──
 // broadcastSequencerState() was the #1 cause of heap fragmentation:
@@ -39,23 +65,29 @@ static constexpr size_t kStateBufSize = 8192;  // serialized JSON fits in ~5-6KB
 static char* _patternBuf = nullptr;
 static constexpr size_t kPatternBufSize = 40960;  // pattern JSON ~18-32KB (with melody data)
 
-// PSRAM allocator for ArduinoJson — documents allocated here never touch internal heap
-struct PsramAllocator {
-  void* allocate(size_t size) {
-    return ps_malloc(size);
-  }
-  void deallocate(void* ptr) {
-    free(ptr);
-  }
-  void* reallocate(void* ptr, size_t new_size) {
-    return ps_realloc(ptr, new_size);
-  }
+// Documentos JSON y buffers de red grandes: SlabJsonDocument / slabAlloc (SlabPool.h)
+
+// Margen del buffer de estado entre la pasada de conteo y la escritura real
+// (step/heap pueden ganar dígitos entre ambas; el sobrante va como espacios)
+static constexpr size_t kStateJsonSlack = 64;
+
+// ── Edit-echo batcher (ver queueEditEcho) — slots y frame combinado en PSRAM ──
+static constexpr size_t kEditEchoSlots = 48;
+static constexpr size_t kEditEchoMaxLen = 192;
+static constexpr unsigned long kEditEchoWindowMs = 20;
+struct EditEchoSlot {
+  uint32_t key;      // hash de type/param/fx + track/step/pad
+  uint16_t len;
+  uint8_t topic;     // TOPIC_MIXER / TOPIC_PATTERN (wsTopicOfEcho)
+  char json[kEditEchoMaxLen];
 };
-using PsramJsonDocument = BasicJsonDocument<PsramAllocator>;
-
-// Persistent JSON document in PSRAM — reused for every state broadcast.
-// Allocated once in begin(), never freed. clear() between uses.
-static PsramJsonDocument* _stateDoc = nullptr;
+static EditEchoSlot* _editEchoSlots = nullptr;
+static char* _editEchoOut = nullptr;
+static char* _editEchoAlt = nullptr;   // frame filtrado para clientes suscritos a un solo topic
+static constexpr size_t kEditEchoOutSize = kEditEchoSlots * (kEditEchoMaxLen + 1) + 32;
+static volatile uint8_t _editEchoCount = 0;
+static unsigned long _editEchoFirstMs = 0;
+static portMUX_TYPE _editEchoMux = portMUX_INITIALIZER_UNLOCKED;
 
 extern SPIMaster spiMaster;
 extern Sequencer sequencer;
@@ -135,12 +167,6 @@ static void clearDaisyPadFilesNotInMask(uint32_t loadedMask) {
   }
 }
 
-static bool isSupportedSampleFile(const String& filename) {
-  String lower = filename;
-  lower.toLowerCase();
-  return lower.endsWith(".raw") || lower.endsWith(".wav");
-}
-
 static const char* detectSampleFormat(const char* filename) {
   if (!filename) {
     return "";
@@ -155,26 +181,32 @@ static const char* detectSampleFormat(const char* filename) {
   return "";
 }
 
-static bool readWavInfo(File& file, uint32_t& rate, uint16_t& channels, uint16_t& bits) {
-  if (!file) return false;
-  file.seek(0, SeekSet);
-  uint8_t header[44];
-  if (file.read(header, sizeof(header)) != sizeof(header)) {
-    return false;
-  }
-  if (memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
-    return false;
-  }
-  channels = header[22] | (header[23] << 8);
-  rate = header[24] | (header[25] << 8) | (header[26] << 16) | (header[27] << 24);
-  bits = header[34] | (header[35] << 8);
-  return true;
-}
-
 static void sendWebAsset(AsyncWebServerRequest *request,
                          const char* routePath,
                          const char* contentType,
                          const char* cacheControl = "no-cache") {
+  // ── Caché PSRAM (WebAssetCache): sin tocar LittleFS, 304 si el navegador ya lo tiene ──
+  const WebAsset* asset = webAssetFind(routePath);
+  if (asset) {
+    WebAssetCacheStats& st = webAssetCacheStats();
+    AsyncWebServerResponse *response;
+    if (request->hasHeader("If-None-Match") &&
+        webAssetEtagMatches(asset, request->header("If-None-Match").c_str())) {
+      st.notModified++;
+      response = request->beginResponse(304);
+    } else {
+      st.hits++;
+      response = request->beginResponse(200, contentType, asset->data, asset->len);
+      if (asset->gzip) response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", asset->etag);
+    response->addHeader("Cache-Control", cacheControl);
+    response->addHeader("Vary", "Accept-Encoding");
+    request->send(response);
+    return;
+  }
+  webAssetCacheStats().misses++;
+
   String fsPath = "/web";
   fsPath += routePath;
 
@@ -193,7 +225,114 @@ static void sendWebAsset(AsyncWebServerRequest *request,
   request->send(response);
 }
 
-static void populateStateDocument(JsonDocument& doc) {
+// ═══════════════════════════════════════════════════════
+// STATE SNAPSHOT — secciones versionadas con fragmento JSON cacheado
+// ═══════════════════════════════════════════════════════
+// Cada sección se serializa a un fragmento ("k":v,...) en PSRAM y sólo se
+// reconstruye si está marcada dirty o si su fragmento tiene más de
+// kStateRevalidateMs (cubre cambios que no pasan por dispatchCommand: Core1,
+// botones físicos, carga de samples en Daisy). La versión de la sección sólo
+// avanza si el contenido cambió (hash FNV-1a), así los deltas quedan mínimos.
+// playing/step/heap/psramFree van siempre en la cabecera (cambian continuamente).
+enum StateSectionId : uint8_t {
+  SS_TRANSPORT = 0,
+  SS_MIXER,
+  SS_FX,
+  SS_PATTERN,
+  SS_SAMPLES,
+  SS_COUNT
+};
+
+struct StateSectionCache {
+  char* frag;             // PSRAM, kStateSectionCap bytes
+  uint16_t len;
+  uint32_t hash;
+  uint32_t version;       // _stateVersion en el último cambio de contenido
+  unsigned long builtMs;
+};
+
+static constexpr size_t kStateSectionCap = 3072;
+static constexpr unsigned long kStateRevalidateMs = 2000;
+static StateSectionCache _stateSections[SS_COUNT] = {};
+static char* _stateSectionScratch = nullptr;
+static uint32_t _stateVersion = 0;
+static uint32_t _stateEpoch = 0;        // distinto en cada arranque: invalida "sv" de clientes
+static volatile uint8_t _stateDirtyMask = STATE_SEC_ALL;
+
+static uint32_t stateFragmentHash(const char* data, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)data[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static void writeTransportSection(JsonStreamWriter& w) {
+  w.kv("tempo", sequencer.getTempo());
+  w.kv("songMode", sequencer.isSongMode());
+  w.kv("songLength", sequencer.getSongLength());
+  w.kv("humanizeTimingMs", sequencer.getHumanizeTimingMs());
+  w.kv("humanizeVelocity", sequencer.getHumanizeVelocityAmount());
+  // Song Chain state
+  w.kv("songChainActive", sequencer.isSongChainActive());
+  w.kv("songChainIdx", sequencer.getSongChainIdx());
+  w.kv("songChainRepeat", sequencer.getSongChainRepeatCnt());
+  w.kv("songChainCount", sequencer.getSongChainCount());
+}
+
+static void writeMixerSection(JsonStreamWriter& w) {
+  w.kv("sequencerVolume", spiMaster.getSequencerVolume());
+  w.kv("liveVolume", spiMaster.getLiveVolume());
+
+  w.beginArray("loopActive");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(sequencer.isLooping(track));
+  w.endArray();
+  w.beginArray("loopPaused");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(sequencer.isLoopPaused(track));
+  w.endArray();
+
+  w.beginArray("trackMuted");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(sequencer.isTrackMuted(track));
+  w.endArray();
+
+  w.beginArray("trackVolumes");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(sequencer.getTrackVolume(track));
+  w.endArray();
+
+  w.beginArray("trackSynthEngines");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value((int)gTrackSynthEngine[track]);
+  w.endArray();
+
+  // New state: synth engine mask (16-bit for 9 engines)
+  w.kv("synthActiveMask", spiMaster.getSynthActiveMask16());
+
+  // Choke groups
+  w.beginArray("chokeGroups");
+  for (int i = 0; i < 16; i++) w.value(spiMaster.getChokeGroup(i));
+  w.endArray();
+}
+
+static void writeFxSection(JsonStreamWriter& w) {
+  // Send pad filter states (for live pads)
+  w.beginArray("padFilters");
+  for (int pad = 0; pad < 16; pad++) w.value((int)spiMaster.getPadFilter(pad));
+  w.endArray();
+
+  // Send track filter states (for sequencer tracks)
+  w.beginArray("trackFilters");
+  for (int track = 0; track < 16; track++) w.value((int)spiMaster.getTrackFilter(track));
+  w.endArray();
+
+  w.kv("lfoActive", 0);
+}
+
+static void writePatternSection(JsonStreamWriter& w) {
+  w.kv("pattern", sequencer.getCurrentPattern());
+  w.kv("stepCount", sequencer.getPatternLength());
+}
+
+static void writeSamplesSection(JsonStreamWriter& w) {
   SdStatusResponse sdStat = {};
   bool sdOk = spiMaster.getCachedSdStatus(sdStat);  // Non-blocking: reads cache updated by Core1
   uint32_t sdLoadedMask = sdOk ? sdStat.samplesLoaded : 0;
@@ -207,165 +346,364 @@ static void populateStateDocument(JsonDocument& doc) {
   }
 
   int localLoadedCount = sampleManager.getLoadedSamplesCount();
-  doc["type"] = "state";
-  doc["playing"] = sequencer.isPlaying();
-  doc["tempo"] = sequencer.getTempo();
-  doc["pattern"] = sequencer.getCurrentPattern();
-  doc["step"] = sequencer.getCurrentStep();
-  doc["sequencerVolume"] = spiMaster.getSequencerVolume();
-  doc["liveVolume"] = spiMaster.getLiveVolume();
-  doc["samplesLoaded"] = max(localLoadedCount, sdLoadedCount);
-  doc["memoryUsed"] = sampleManager.getTotalMemoryUsed();
-  doc["psramFree"] = sampleManager.getFreePSRAM();
-  doc["songMode"] = sequencer.isSongMode();
-  doc["songLength"] = sequencer.getSongLength();
-  doc["stepCount"] = sequencer.getPatternLength();
-  doc["humanizeTimingMs"] = sequencer.getHumanizeTimingMs();
-  doc["humanizeVelocity"] = sequencer.getHumanizeVelocityAmount();
-  doc["heap"] = ESP.getFreeHeap();
-
-  JsonArray loopActive = doc.createNestedArray("loopActive");
-  JsonArray loopPaused = doc.createNestedArray("loopPaused");
-  for (int track = 0; track < MAX_TRACKS; track++) {
-    loopActive.add(sequencer.isLooping(track));
-    loopPaused.add(sequencer.isLoopPaused(track));
+  w.kv("samplesLoaded", max(localLoadedCount, sdLoadedCount));
+  w.kv("memoryUsed", sampleManager.getTotalMemoryUsed());
+
+  // Compact samples: only send loaded sample info (not empty pads)
+  w.beginArray("samples");
+  for (int pad = 0; pad < MAX_SAMPLES; pad++) {
+    bool loadedLocal = sampleManager.isSampleLoaded(pad);
+    bool loadedDaisy = (sdLoadedMask & (1UL << pad)) != 0;
+    if (!loadedLocal && !loadedDaisy) continue;
+    const char* localName = sampleManager.getSampleName(pad);
+    const char* daisyName = gDaisyPadFiles[pad];
+    const char* finalName = (loadedLocal && localName) ? localName : daisyName;
+    w.beginObject();
+    w.kv("pad", pad);
+    w.kv("loaded", true);
+    w.kv("name", (finalName && finalName[0]) ? finalName : "");
+    w.kv("size", loadedLocal ? (sampleManager.getSampleLength(pad) * 2) : 0);
+    w.kv("format", detectSampleFormat(finalName));
+    w.endObject();
   }
+  w.endArray();
 
-  JsonArray trackMuted = doc.createNestedArray("trackMuted");
-  for (int track = 0; track < MAX_TRACKS; track++) {
-    trackMuted.add(sequencer.isTrackMuted(track));
+  // Daisy SD card info (explicit SD status query in strict boundary mode)
+  if (sdOk) {
+    char kit[sizeof(sdStat.currentKit) + 1];
+    memcpy(kit, sdStat.currentKit, sizeof(sdStat.currentKit));
+    kit[sizeof(sdStat.currentKit)] = '\0';
+    w.kv("sdPresent", (bool)sdStat.present);
+    w.kv("sdKit", kit);
+    w.kv("sdPadsLoaded", sdLoadedCount);
+    w.kv("sdLoadedMask", sdLoadedMask);
+  } else {
+    w.kv("sdPresent", false);
+    w.kv("sdKit", "");
+    w.kv("sdPadsLoaded", 0);
+    w.kv("sdLoadedMask", 0);
   }
-  
-  JsonArray trackVolumes = doc.createNestedArray("trackVolumes");
-  for (int track = 0; track < MAX_TRACKS; track++) {
-    trackVolumes.add(sequencer.getTrackVolume(track));
+}
+
+typedef void (*StateSectionWriter)(JsonStreamWriter& w);
+static const StateSectionWriter kStateSectionWriters[SS_COUNT] = {
+  writeTransportSection, writeMixerSection, writeFxSection, writePatternSection, writeSamplesSection
+};
+
+// Reconstruye las secciones dirty/caducadas de need (STATE_SEC_*): las que
+// ningún cliente suscrito ve conservan su bit dirty. false si no hay PSRAM.
+static bool refreshStateSections(uint8_t need = STATE_SEC_ALL) {
+  if (!_stateSectionScratch) _stateSectionScratch = (char*)ps_malloc(kStateSectionCap);
+  if (!_stateSectionScratch) return false;
+
+  const unsigned long now = millis();
+  const uint8_t dirty = __atomic_fetch_and(&_stateDirtyMask, (uint8_t)~need, __ATOMIC_RELAXED);
+  for (int i = 0; i < SS_COUNT; i++) {
+    if (!(need & (1 << i))) continue;
+    StateSectionCache& sec = _stateSections[i];
+    if (!sec.frag) {
+      sec.frag = (char*)ps_malloc(kStateSectionCap);
+      if (!sec.frag) return false;
+      sec.builtMs = now - kStateRevalidateMs;
+    }
+    if (!(dirty & (1 << i)) && now - sec.builtMs < kStateRevalidateMs) continue;
+    sec.builtMs = now;
+
+    JsonStreamWriter w(_stateSectionScratch, kStateSectionCap);
+    w.beginObject();
+    kStateSectionWriters[i](w);
+    w.endObject();
+    size_t n = w.finish();
+    if (n < 2) continue;  // no cabe: se mantiene el fragmento anterior
+    const char* body = _stateSectionScratch + 1;  // sin llaves
+    size_t bodyLen = n - 2;
+    uint32_t h = stateFragmentHash(body, bodyLen);
+    if (sec.version != 0 && h == sec.hash && bodyLen == sec.len) continue;
+    memcpy(sec.frag, body, bodyLen);
+    sec.len = (uint16_t)bodyLen;
+    sec.hash = h;
+    sec.version = ++_stateVersion;
   }
+  return true;
+}
 
-  JsonArray trackSynthEngines = doc.createNestedArray("trackSynthEngines");
-  for (int track = 0; track < MAX_TRACKS; track++) {
-    trackSynthEngines.add((int)gTrackSynthEngine[track]);
+// Mensaje "state": completo si sinceVersion == 0, si no sólo las secciones
+// con version > sinceVersion (+ cabecera, "delta":true). secMask = secciones
+// de los topics del cliente (WsTopics.h).
+static void writeStateMessage(JsonStreamWriter& w, uint32_t sinceVersion, uint8_t secMask) {
+  w.beginObject();
+  w.kv("type", "state");
+  w.kv("sv", _stateVersion);
+  w.kv("se", _stateEpoch);
+  if (sinceVersion) w.kv("delta", true);
+  w.kv("playing", sequencer.isPlaying());
+  w.kv("step", sequencer.getCurrentStep());
+  w.kv("heap", ESP.getFreeHeap());
+  w.kv("psramFree", sampleManager.getFreePSRAM());
+  for (int i = 0; i < SS_COUNT; i++) {
+    const StateSectionCache& sec = _stateSections[i];
+    if (!(secMask & (1 << i)) || sec.version == 0) continue;
+    if (sinceVersion && sec.version <= sinceVersion) continue;
+    w.rawMembers(sec.frag, sec.len);
+  }
+  w.endObject();
+}
+
+// Patrón JSON (fallback de clientes sin binProto >= 2). full = también noteLens,
+// melodía y flags (getPattern); selectPattern sólo manda la parte de drums.
+static void writePatternJson(JsonStreamWriter& w, int pattern, int stepCount, bool full) {
+  static const char* const kTrackKeys[16] = {
+    "0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11", "12", "13", "14", "15"
+  };
+  w.beginObject();
+  w.kv("type", "pattern");
+  w.kv("index", pattern);
+  w.kv("stepCount", stepCount);
+
+  // Send steps (active/inactive) - 16 tracks activos
+  for (int track = 0; track < 16; track++) {
+    w.beginArray(kTrackKeys[track]);
+    for (int step = 0; step < stepCount; step++) w.value(sequencer.getStep(pattern, track, step));
+    w.endArray();
   }
 
-  // Compact samples: only send loaded sample info (not empty pads)
-  JsonArray sampleArray = doc.createNestedArray("samples");
-  for (int pad = 0; pad < MAX_SAMPLES; pad++) {
-    bool loadedLocal = sampleManager.isSampleLoaded(pad);
-    bool loadedDaisy = (sdLoadedMask & (1UL << pad)) != 0;
-    bool loaded = loadedLocal || loadedDaisy;
-    if (loaded) {
-      JsonObject sampleObj = sampleArray.createNestedObject();
-      sampleObj["pad"] = pad;
-      sampleObj["loaded"] = true;
-      const char* localName = sampleManager.getSampleName(pad);
-      const char* daisyName = gDaisyPadFiles[pad];
-      const char* finalName = (loadedLocal && localName) ? localName : daisyName;
-      sampleObj["name"] = (finalName && finalName[0]) ? finalName : "";
-      sampleObj["size"] = loadedLocal ? (sampleManager.getSampleLength(pad) * 2) : 0;
-      sampleObj["format"] = detectSampleFormat(finalName);
+  w.beginObject("velocities");
+  for (int track = 0; track < 16; track++) {
+    w.beginArray(kTrackKeys[track]);
+    for (int step = 0; step < stepCount; step++) w.value(sequencer.getStepVelocity(pattern, track, step));
+    w.endArray();
+  }
+  w.endObject();
+
+  if (full) {
+    // Note lengths (1=full, 2=half, 4=quarter, 8=eighth)
+    w.beginObject("noteLens");
+    for (int track = 0; track < 16; track++) {
+      w.beginArray(kTrackKeys[track]);
+      for (int step = 0; step < stepCount; step++) w.value(sequencer.getStepNoteLen(pattern, track, step));
+      w.endArray();
     }
+    w.endObject();
   }
-  
-  // Send pad filter states (for live pads)
-  JsonArray padFilters = doc.createNestedArray("padFilters");
-  for (int pad = 0; pad < 16; pad++) {
-    FilterType filterType = spiMaster.getPadFilter(pad);
-    padFilters.add((int)filterType);
+
+  w.beginObject("volumeLocks");
+  for (int track = 0; track < 16; track++) {
+    w.beginArray(kTrackKeys[track]);
+    for (int step = 0; step < stepCount; step++) {
+      if (sequencer.hasStepVolumeLock(pattern, track, step)) w.value(sequencer.getStepVolumeLock(pattern, track, step));
+      else w.value(-1);
+    }
+    w.endArray();
   }
-  
-  // Send track filter states (for sequencer tracks)
-  JsonArray trackFilters = doc.createNestedArray("trackFilters");
+  w.endObject();
+
+  w.beginObject("probabilities");
   for (int track = 0; track < 16; track++) {
-    FilterType filterType = spiMaster.getTrackFilter(track);
-    trackFilters.add((int)filterType);
+    w.beginArray(kTrackKeys[track]);
+    for (int step = 0; step < stepCount; step++) w.value(sequencer.getStepProbability(pattern, track, step));
+    w.endArray();
   }
-  
-  // Daisy SD card info (explicit SD status query in strict boundary mode)
-  if (sdOk) {
-    doc["sdPresent"] = (bool)sdStat.present;
-    doc["sdKit"] = String(sdStat.currentKit);
-    doc["sdPadsLoaded"] = sdLoadedCount;
-    doc["sdLoadedMask"] = sdLoadedMask;
-  } else {
-    doc["sdPresent"] = false;
-    doc["sdKit"] = "";
-    doc["sdPadsLoaded"] = 0;
-    doc["sdLoadedMask"] = 0;
+  w.endObject();
+
+  w.beginObject("ratchets");
+  for (int track = 0; track < 16; track++) {
+    w.beginArray(kTrackKeys[track]);
+    for (int step = 0; step < stepCount; step++) w.value(sequencer.getStepRatchet(pattern, track, step));
+    w.endArray();
   }
-  
-  doc["lfoActive"] = 0;
+  w.endObject();
 
-  // New state: synth engine mask (16-bit for 9 engines)
-  doc["synthActiveMask"] = spiMaster.getSynthActiveMask16();
+  w.beginObject("cutoffLocks");
+  for (int track = 0; track < 16; track++) {
+    w.beginArray(kTrackKeys[track]);
+    for (int step = 0; step < stepCount; step++) {
+      if (sequencer.hasStepCutoffLock(pattern, track, step)) w.value((int)sequencer.getStepCutoffLock(pattern, track, step));
+      else w.value(-1);
+    }
+    w.endArray();
+  }
+  w.endObject();
 
-  // Song Chain state
-  doc["songChainActive"] = sequencer.isSongChainActive();
-  doc["songChainIdx"] = sequencer.getSongChainIdx();
-  doc["songChainRepeat"] = sequencer.getSongChainRepeatCnt();
-  doc["songChainCount"] = sequencer.getSongChainCount();
+  w.beginObject("reverbLocks");
+  for (int track = 0; track < 16; track++) {
+    w.beginArray(kTrackKeys[track]);
+    for (int step = 0; step < stepCount; step++) {
+      if (sequencer.hasStepReverbSendLock(pattern, track, step)) w.value((int)sequencer.getStepReverbSendLock(pattern, track, step));
+      else w.value(-1);
+    }
+    w.endArray();
+  }
+  w.endObject();
 
-  // Choke groups
-  JsonArray chokeArr = doc.createNestedArray("chokeGroups");
-  for (int i = 0; i < 16; i++) {
-    chokeArr.add(spiMaster.getChokeGroup(i));
+  if (full) {
+    // Melody: per-step MIDI notes (0 = rest)
+    w.beginObject("stepNotes");
+    for (int track = 0; track < 16; track++) {
+      w.beginArray(kTrackKeys[track]);
+      for (int step = 0; step < stepCount; step++) w.value(sequencer.getStepNote(pattern, track, step));
+      w.endArray();
+    }
+    w.endObject();
+
+    w.beginObject("stepNoteVoices");
+    for (int track = 0; track < 16; track++) {
+      w.beginArray(kTrackKeys[track]);
+      for (int step = 0; step < stepCount; step++) {
+        w.beginArray();
+        for (int voice = 0; voice < MELODY_STEP_VOICES; voice++) {
+          w.value(sequencer.getStepNoteVoice(pattern, track, step, voice));
+        }
+        w.endArray();
+      }
+      w.endArray();
+    }
+    w.endObject();
+
+    // Melody: per-step flags (bit0=accent, bit1=slide)
+    w.beginObject("stepFlags");
+    for (int track = 0; track < 16; track++) {
+      w.beginArray(kTrackKeys[track]);
+      for (int step = 0; step < stepCount; step++) w.value(sequencer.getStepFlags(pattern, track, step));
+      w.endArray();
+    }
+    w.endObject();
+  }
+  w.endObject();
+}
+
+// Serializa el patrón JSON en _patternBuf (PSRAM). Devuelve longitud o 0.
+static size_t buildPatternJson(int pattern, int stepCount, bool full) {
+  if (!_patternBuf) _patternBuf = (char*)ps_malloc(kPatternBufSize);
+  if (!_patternBuf) return 0;
+  JsonStreamWriter w(_patternBuf, kPatternBufSize);
+  writePatternJson(w, pattern, stepCount, full);
+  return w.finish();
+}
+
+// pattern_sync UDP (sólo steps) en _patternBuf. activeHint = campo "active" de broadcast.
+static size_t buildPatternSyncJson(int patternNum, bool activeHint) {
+  if (!_patternBuf) _patternBuf = (char*)ps_malloc(kPatternBufSize);
+  if (!_patternBuf) return 0;
+  JsonStreamWriter w(_patternBuf, kPatternBufSize);
+  w.beginObject();
+  w.kv("cmd", "pattern_sync");
+  w.kv("pattern", patternNum);
+  if (activeHint) w.kv("active", true);   /* hint to slaves: this IS the active pattern */
+  w.kv("stepCount", sequencer.getPatternLength());
+  w.beginArray("data");
+  for (int t = 0; t < MAX_TRACKS; t++) {
+    w.beginArray();
+    for (int s = 0; s < STEPS_PER_PATTERN; s++) {
+      w.value(sequencer.getStep(patternNum, t, s) ? 1 : 0);
+    }
+    w.endArray();
   }
+  w.endArray();
+  w.endObject();
+  return w.finish();
+}
+
+// Estado → AsyncWebSocketMessageBuffer del tamaño justo. Primera pasada sólo cuenta
+// bytes; la segunda escribe en el buffer que la librería envía (cero copias).
+// Requiere refreshStateSections() previo.
+static AsyncWebSocketMessageBuffer* buildStateMessage(AsyncWebSocket* ws, uint32_t sinceVersion, uint8_t secMask) {
+  if (!ws) return nullptr;
+  JsonStreamWriter counter(nullptr, 0);
+  writeStateMessage(counter, sinceVersion, secMask);
+  size_t len = counter.length() + kStateJsonSlack;
+  AsyncWebSocketMessageBuffer* buffer = ws->makeBuffer(len);
+  if (!buffer) return nullptr;
+  if (buffer->length() < len) { delete buffer; return nullptr; }
+  JsonStreamWriter w((char*)buffer->get(), len);
+  writeStateMessage(w, sinceVersion, secMask);
+  if (w.finish() == 0) { delete buffer; return nullptr; }
+  w.padToCapacity();
+  return buffer;
 }
 
 static bool isClientReady(AsyncWebSocketClient* client) {
   return client != nullptr && client->status() == WS_CONNECTED;
 }
 
-// Cache of sample counts per family — avoid scanning filesystem in WS callback
-static int cachedSampleCounts[16] = {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1};
-static const char* sampleFamilies[] = {"BD", "SD", "CH", "OH", "CP", "CB", "RS", "CL", "MA", "CY", "HT", "LT", "MC", "MT", "HC", "LC"};
+// Serializa en un bloque del slab (PSRAM) en vez de un String del heap interno
+static void sendJsonToClient(AsyncWebSocketClient* client, const JsonDocument& doc) {
+  size_t len = measureJson(doc);
+  SlabBuffer buf(len + 1);
+  if (!buf.data()) return;
+  serializeJson(doc, buf.data(), buf.size());
+  client->text(buf.data(), len);
+}
 
-static void rebuildSampleCountCache() {
-  for (int i = 0; i < 16; i++) {
-    String path = String("/") + String(sampleFamilies[i]);
-    int count = 0;
-    
-    File dir = LittleFS.open(path);
-    if (dir && dir.isDirectory()) {
-      File file = dir.openNextFile();
-      while (file) {
-        if (!file.isDirectory()) {
-          String fullName = file.name();
-          int lastSlash = fullName.lastIndexOf('/');
-          String fileName = lastSlash >= 0 ? fullName.substring(lastSlash + 1) : fullName;
-          if (isSupportedSampleFile(fileName)) {
-            count++;
-          }
-        }
-        file.close();
-        file = dir.openNextFile();
-      }
-      dir.close();
-    }
-    cachedSampleCounts[i] = count;
-  }
+// sampleList de una familia escrito directo en el buffer del mensaje: ~190 B por
+// entrada (frames, peak, knobs), una familia grande no cabe en un documento fijo
+static void writeSampleList(JsonStreamWriter& w, const char* family, int pad,
+                            const SampleIndexEntry* entries, uint16_t count) {
+  w.beginObject();
+  w.kv("type", "sampleList");
+  w.kv("family", family);
+  w.kv("pad", pad);
+  w.beginArray("samples");
+  for (uint16_t i = 0; i < count; i++) {
+    const SampleIndexEntry& e = entries[i];
+    w.beginObject();
+    w.kv("name", (const char*)e.name);
+    w.kv("size", (unsigned long)e.size);
+    w.kv("format", sampleIndexFormatName(e.format));
+    w.kv("rate", (unsigned long)e.rate);
+    w.kv("channels", (unsigned)e.channels);
+    w.kv("bits", (unsigned)e.bits);
+    w.kv("frames", (unsigned long)e.frames);
+    if (e.peak != SAMPLE_PEAK_UNKNOWN) w.kv("peak", (unsigned)e.peak);
+    if (e.knobCount > 0) {
+      w.beginArray("knobs");
+      for (uint8_t k = 0; k < e.knobCount; k++) w.value((unsigned)e.knobs[k]);
+      w.endArray();
+    }
+    w.endObject();
+  }
+  w.endArray();
+  w.endObject();
 }
 
+// Dos pasadas como buildStateMessage(): contar y escribir en el buffer exacto
+static AsyncWebSocketMessageBuffer* buildSampleListMessage(AsyncWebSocket* ws, const char* family, int pad,
+                                                           const SampleIndexEntry* entries, uint16_t count) {
+  if (!ws) return nullptr;
+  JsonStreamWriter counter(nullptr, 0);
+  writeSampleList(counter, family, pad, entries, count);
+  size_t len = counter.length();
+  AsyncWebSocketMessageBuffer* buffer = ws->makeBuffer(len);
+  if (!buffer) return nullptr;
+  if (buffer->length() < len) { delete buffer; return nullptr; }
+  JsonStreamWriter w((char*)buffer->get(), len);
+  writeSampleList(w, family, pad, entries, count);
+  if (w.finish() == 0) { delete buffer; return nullptr; }
+  w.padToCapacity();
+  return buffer;
+}
+
+static const char* sampleFamilies[] = {"BD", "SD", "CH", "OH", "CP", "CB", "RS", "CL", "MA", "CY", "HT", "LT", "MC", "MT", "HC", "LC"};
+
 static void sendSampleCounts(AsyncWebSocketClient* client) {
   if (!client || !isClientReady(client)) {
     return;
   }
   
-  // Build cache on first request
-  if (cachedSampleCounts[0] < 0) {
-    rebuildSampleCountCache();
-  }
-  
+  // Conteos del índice de samples (SampleIndex.h): sin recorrer LittleFS
   StaticJsonDocument<512> sampleCountDoc;
   sampleCountDoc["type"] = "sampleCounts";
   
+  sampleIndexLock(UINT32_MAX);
   for (int i = 0; i < 16; i++) {
-    sampleCountDoc[sampleFamilies[i]] = cachedSampleCounts[i];
+    const SampleIndexEntry* first;
+    uint16_t count;
+    sampleIndexFolder(sampleFamilies[i], &first, &count);
+    sampleCountDoc[sampleFamilies[i]] = count;
   }
-  
-  String countOutput;
-  serializeJson(sampleCountDoc, countOutput);
+  sampleIndexUnlock();
   
   if (isClientReady(client)) {
-    client->text(countOutput);
+    sendJsonToClient(client, sampleCountDoc);
   }
 }
 
@@ -378,6 +716,9 @@ WebInterface::WebInterface() {
   for (auto& slot : wsReassemblySlots) {
     slot.clientId = 0xFFFFFFFF;
   }
+  for (auto& st : wsClientStates) {
+    st.reset(0xFFFFFFFF);
+  }
   
   // Inicializar variables de rate limiting
   lastTriggerTime = 0;
@@ -408,6 +749,10 @@ bool WebInterface::begin(const char* apSsid, const char* apPassword,
                          const char* staSSID, const char* staPassword,
                          unsigned long staTimeoutMs) {
   _staConnected = false;
+  commandTableInit();   // tabla hash de comandos antes de aceptar WS/UDP
+  ingressLimiterInit();
+  slabPoolInit();       // buffers de red en PSRAM antes del primer frame
+  _ingressFallback.reset();
 
   WiFi.setSleep(false);
   WiFi.persistent(false);          // no guarda credenciales en NVS (evita flash corrupto)
@@ -481,6 +826,9 @@ bool WebInterface::begin(const char* apSsid, const char* apPassword,
 
   WiFi.setSleep(false);
   
+  // Assets web a PSRAM antes de aceptar peticiones (la tabla queda de sólo lectura)
+  webAssetCacheBegin();
+
   // Crear servidor web
   server = new AsyncWebServer(80);
   ws = new AsyncWebSocket("/ws");
@@ -497,12 +845,12 @@ bool WebInterface::begin(const char* apSsid, const char* apPassword,
   server->on("/", HTTP_GET, [this](AsyncWebServerRequest *request){
     // Pause periodic broadcasts during page transition to free TCP/Core0
     pageTransitionMs = millis();
-    sendWebAsset(request, "/index.html", "text/html", "no-cache, no-store, must-revalidate");
+    sendWebAsset(request, "/index.html", "text/html", "no-cache");
   });
 
   
   server->on("/index.html", HTTP_GET, [](AsyncWebServerRequest *request){
-    sendWebAsset(request, "/index.html", "text/html", "no-cache, no-store, must-revalidate");
+    sendWebAsset(request, "/index.html", "text/html", "no-cache");
   });
   
   server->on("/app.js", HTTP_GET, [](AsyncWebServerRequest *request){
@@ -653,7 +1001,7 @@ bool WebInterface::begin(const char* apSsid, const char* apPassword,
   
   server->on("/api/getPattern", HTTP_GET, [](AsyncWebServerRequest *request){
     int pattern = sequencer.getCurrentPattern();
-    DynamicJsonDocument doc(4096);
+    SlabJsonDocument doc(4096);
     
     for (int track = 0; track < 16; track++) {
       JsonArray trackSteps = doc.createNestedArray(String(track));
@@ -786,7 +1134,7 @@ refresh();if(auto_)startAuto();
   });
 
   server->on("/api/sysinfo", HTTP_GET, [this](AsyncWebServerRequest *request){
-    StaticJsonDocument<3072> doc;
+    StaticJsonDocument<6144> doc;
     
     // Info de memoria
     doc["heapFree"] = ESP.getFreeHeap();
@@ -819,9 +1167,61 @@ refresh();if(auto_)startAuto();
         c["id"] = client.id();
         c["ip"] = client.remoteIP().toString();
         c["status"] = client.status();
+        c["queue"] = client.queueLen();
+        WsClientState* st = findWsClientState(client.id(), false);
+        if (st) {
+          c["maxQueue"] = st->maxQueue;
+          c["lag"] = st->lagLevel;
+          c["dropped"] = st->dropped;
+          c["limited"] = st->ingress.totalLimited();
+        }
       }
     }
     
+    // Caché de assets web (PSRAM)
+    const WebAssetCacheStats& assetSt = webAssetCacheStats();
+    JsonObject assets = doc.createNestedObject("assetCache");
+    assets["files"] = assetSt.files;
+    assets["bytes"] = assetSt.bytes;
+    assets["hits"] = assetSt.hits;
+    assets["notModified"] = assetSt.notModified;
+    assets["misses"] = assetSt.misses;
+
+    // Pirámides de picos de previews (?file=) en PSRAM
+    uint8_t peakEntries;
+    uint32_t peakBytes, peakHits, peakMisses;
+    peakCacheStats(&peakEntries, &peakBytes, &peakHits, &peakMisses);
+    JsonObject peakC = doc.createNestedObject("peakCache");
+    peakC["entries"] = peakEntries;
+    peakC["bytes"] = peakBytes;
+    peakC["hits"] = peakHits;
+    peakC["misses"] = peakMisses;
+
+    // Pools de red (SlabPool.h): used/peak planos + heapLargestBlock estable = sin fragmentación
+    doc["heapLargestBlock"] = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+    JsonArray slabs = doc.createNestedArray("slab");
+    for (int c = 0; c < SLAB_CLASS_COUNT; c++) {
+      const SlabClassStats& ss = slabClassStats(c);
+      JsonObject so = slabs.createNestedObject();
+      so["size"] = ss.blockSize;
+      so["blocks"] = ss.blocks;
+      so["used"] = ss.used;
+      so["peak"] = ss.peak;
+      so["fallback"] = ss.fallback;
+    }
+    doc["slabOversize"] = slabOversize();
+
+    // Límite de entrada (todos los clientes)
+    const IngressStats& ingSt = ingressStats();
+    JsonObject ingress = doc.createNestedObject("ingress");
+    JsonObject ingLimited = ingress.createNestedObject("limited");
+    for (int c = 0; c < ING_CLASS_COUNT; c++) {
+      ingLimited[ingressClassName((IngressClass)c)] = ingSt.limited[c];
+    }
+    ingress["coalesced"] = ingSt.coalesced;
+    ingress["coalesceApplied"] = ingSt.coalesceApplied;
+    ingress["coalesceOverflow"] = ingSt.coalesceOverflow;
+
     // Info de clientes UDP
     // Serial.printf("[sysinfo] UDP clients count: %d\n", udpClients.size()); // Comentado
     doc["udpClients"] = udpClients.size();
@@ -833,6 +1233,7 @@ refresh();if(auto_)startAuto();
       c["port"] = pair.second.port;
       c["lastSeen"] = (now - pair.second.lastSeen) / 1000;
       c["packets"] = pair.second.packetCount;
+      c["limited"] = pair.second.ingress.totalLimited();
       // Serial.printf("[sysinfo] Adding UDP client: %s:%d (packets: %d)\n", // Comentado
       //               pair.second.ip.toString().c_str(), pair.second.port, pair.second.packetCount);
     }
@@ -843,6 +1244,49 @@ refresh();if(auto_)startAuto();
     doc["pattern"] = sequencer.getCurrentPattern();
     doc["samplesLoaded"] = sampleManager.getLoadedSamplesCount();
     doc["memoryUsed"] = sampleManager.getTotalMemoryUsed();
+    const SampleLoadStats& ls = sampleManager.getLoadStats();
+    JsonObject sl = doc.createNestedObject("sampleLoad");
+    sl["n"] = ls.loads;
+    sl["lastUs"] = ls.lastUs;
+    sl["lastBytes"] = ls.lastBytes;
+    sl["maxUs"] = ls.maxUs;
+    sl["kbps"] = ls.totalUs ? (uint32_t)(ls.totalBytes * 1000 / ls.totalUs) : 0;   // bytes/ms ≈ KB/s
+    sl["cached"] = ls.lastCached;
+    sl["cacheHits"] = ls.cacheHits;
+    sl["stored"] = ls.lastStored;
+    sl["storeHits"] = ls.storeHits;
+    sl["resampleTo"] = RS_TARGET_RATE;
+    sl["resampleQ"] = resampleQualityName(sampleManager.getResampleQuality());
+
+    // PCM convertido en PSRAM (SampleCache.h) + prefetch en segundo plano
+    const SampleCacheStats& sc = sampleCacheStats();
+    JsonObject scj = doc.createNestedObject("sampleCache");
+    scj["entries"] = sc.entries;
+    scj["bytes"] = sc.bytes;
+    scj["budget"] = sc.budget;
+    scj["hits"] = sc.hits;
+    scj["misses"] = sc.misses;
+    scj["evictions"] = sc.evictions;
+    scj["prefetched"] = sampleManager.getPrefetchDone();
+
+    // PCM empaquetado en la partición pcmstore (PcmStore.h)
+    const PcmStoreStats& ps = pcmStoreStats();
+    JsonObject psj = doc.createNestedObject("pcmStore");
+    psj["ready"] = ps.ready;
+    psj["entries"] = ps.entries;
+    psj["usedKb"] = ps.imageBytes / 1024;
+    psj["sizeKb"] = ps.partitionBytes / 1024;
+    psj["stale"] = ps.stale;
+
+    // Uploads a la Daisy evitados por hash (SampleHash.h, CMD_SAMPLE_COPY)
+    const SampleDedupStats& dd = spiMaster.getDedupStats();
+    JsonObject ddj = doc.createNestedObject("sampleDedup");
+    ddj["uploads"] = dd.uploads;
+    ddj["skipped"] = dd.skipped;
+    ddj["copies"] = dd.copies;
+    ddj["bytesSaved"] = dd.bytesSaved;
+    ddj["syncs"] = dd.syncs;
+    ddj["daisyHashes"] = spiMaster.hasSlotHashes();
 
     // Daisy realtime telemetry — uses cached data only (no SPI calls)
     doc["daisyConnected"] = spiMaster.isConnected();
@@ -853,6 +1297,7 @@ refresh();if(auto_)startAuto();
     doc["daisyCpuPeak"] = spiMaster.getCpuPeak();
     doc["daisyPerfStress"] = spiMaster.isPerformanceStressMode();
     doc["daisyMasterPeak"] = spiMaster.getMasterPeak();
+    doc["daisyPeaksLive"] = spiMaster.isPeakPolling();   // false: últimos valores leídos
     doc["daisyKit"] = String(spiMaster.getCurrentKitName());
     // Diagnostics
     StatusResponse daisyStat = {};
@@ -892,7 +1337,141 @@ refresh();if(auto_)startAuto();
     serializeJson(doc, output);
     request->send(200, "application/json", output);
   });
+
+  // Perfil de heap: histograma de bloques libres + sitios de asignación
+  // (los sitios sólo se rellenan con -DRED808_HEAP_PROFILE=1)
+  server->on("/api/heapprof", HTTP_GET, [](AsyncWebServerRequest *request){
+    SlabJsonDocument doc(4096);
+    doc["enabled"] = heapProfEnabled();
+
+    static const char* const kHeapNames[HP_HEAP_COUNT] = { "internal", "psram" };
+    for (uint8_t h = 0; h < HP_HEAP_COUNT; h++) {
+      HeapFreeInfo fi;
+      if (!heapProfFreeInfo(h, &fi)) continue;
+      JsonObject o = doc.createNestedObject(kHeapNames[h]);
+      o["free"] = fi.totalFree;
+      o["largest"] = fi.largestFree;
+      o["minFree"] = fi.minEverFree;
+      o["freeBlocks"] = fi.freeBlocks;
+      o["frag"] = heapProfFragPct(fi);
+      if (fi.histValid) {
+        JsonObject hist = o.createNestedObject("hist");
+        for (uint8_t b = 0; b < HP_HIST_BINS; b++) hist[heapProfBinLabel(b)] = fi.hist[b];
+      } else {
+        o["hist"] = nullptr;
+      }
+    }
+
+    JsonArray sites = doc.createNestedArray("sites");
+    uint8_t n = heapProfSiteCount();
+    for (uint8_t i = 0; i < n; i++) {
+      HeapSiteStats st;
+      if (!heapProfSite(i, &st)) continue;
+      JsonObject so = sites.createNestedObject();
+      if (st.tag) {
+        so["tag"] = st.tag;
+      } else {
+        char addr[12];
+        snprintf(addr, sizeof(addr), "0x%08x", (unsigned)st.caller);
+        so["tag"] = addr;   // copia: ArduinoJson duplica char*
+      }
+      so["heap"] = kHeapNames[st.heap < HP_HEAP_COUNT ? st.heap : 0];
+      so["allocs"] = st.allocs;
+      so["frees"] = st.frees;
+      so["live"] = st.liveBytes;
+      so["peak"] = st.peakBytes;
+      so["failed"] = st.failed;
+    }
+    doc["untracked"] = heapProfUntracked();
+
+    String output;
+    serializeJson(doc, output);
+    request->send(200, "application/json", output);
+  });
   
+  // Perfil de la ruta de comandos para tools/loadtest.py
+  // POST ?enable=1|0&reset=1 abre/cierra la ventana; GET devuelve la tabla
+  server->on("/api/cmdprof", HTTP_POST, [](AsyncWebServerRequest *request){
+    bool on = request->hasParam("enable") ? request->getParam("enable")->value().toInt() != 0
+                                          : cmdProfEnabled();
+    bool reset = request->hasParam("reset") && request->getParam("reset")->value().toInt() != 0;
+    cmdProfEnable(on, reset);
+    request->send(200, "application/json", cmdProfEnabled() ? "{\"enabled\":true}" : "{\"enabled\":false}");
+  });
+
+  server->on("/api/cmdprof", HTTP_GET, [](AsyncWebServerRequest *request){
+    SlabJsonDocument doc(32768);   // ~170 comandos en el peor caso
+    CmdProfWindow w = cmdProfWindow();
+    doc["enabled"] = w.enabled;
+    doc["windowMs"] = w.enabled ? millis() - w.startMs : 0;
+    doc["minFreeHeap"] = w.minFreeHeap == 0xFFFFFFFF ? 0 : w.minFreeHeap;
+    doc["minLargest"] = w.minLargest == 0xFFFFFFFF ? 0 : w.minLargest;
+
+    auto fill = [](JsonObject o, const CmdProfStats& st) {
+      o["n"] = st.count;
+      o["avgUs"] = st.count ? st.totalUs / st.count : 0;
+      o["p50Us"] = cmdProfPercentileUs(st, 50);
+      o["p99Us"] = cmdProfPercentileUs(st, 99);
+      o["maxUs"] = st.maxUs;
+      o["heapMax"] = st.heapMax;
+    };
+    JsonObject paths = doc.createNestedObject("paths");
+    for (uint8_t p = 0; p < CMDPROF_PATH_COUNT; p++) {
+      CmdProfStats st;
+      cmdProfPath((CmdProfPath)p, &st);
+      fill(paths.createNestedObject(cmdProfPathName((CmdProfPath)p)), st);
+    }
+    JsonArray cmds = doc.createNestedArray("cmds");
+    for (uint16_t id = 0; id < WSC_COUNT; id++) {
+      CmdProfStats st;
+      if (!cmdProfCommand((WsCmdId)id, &st)) continue;
+      JsonObject o = cmds.createNestedObject();
+      o["cmd"] = commandById((WsCmdId)id)->name;
+      fill(o, st);
+    }
+
+    String output;
+    serializeJson(doc, output);
+    request->send(200, "application/json", output);
+  });
+
+  // POST /api/batch — mismo envelope que por WS: {"cmds":[{...},...],"atomic":bool,"id":n}
+  server->on("/api/batch", HTTP_POST, [](AsyncWebServerRequest *request){}, NULL,
+    [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+      if (total > kWsMaxTextBytes) {
+        if (index == 0) request->send(413, "application/json", "{\"error\":\"too_large\"}");
+        return;
+      }
+      // Cuerpo en varios trozos: se junta en PSRAM (ESPAsyncWebServer libera _tempObject con free)
+      char* body = (char*)data;
+      if (len != total) {
+        if (index == 0) request->_tempObject = ps_malloc(total + 1);
+        if (!request->_tempObject) {
+          if (index == 0) request->send(503, "application/json", "{\"error\":\"no_memory\"}");
+          return;
+        }
+        memcpy((char*)request->_tempObject + index, data, len);
+        if (index + len < total) return;
+        body = (char*)request->_tempObject;
+      }
+
+      SlabJsonDocument doc(kBatchDocBytes(total));
+      if (deserializeJson(doc, body, total)) {
+        request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+        return;
+      }
+      JsonArrayConst cmds = doc["cmds"];
+      if (cmds.isNull()) {
+        request->send(400, "application/json", "{\"error\":\"Missing cmds array\"}");
+        return;
+      }
+      BatchResult r = applyBatch(cmds, doc["atomic"] | false);
+      char ackBuf[160];
+      size_t ackLen = formatBatchAck(ackBuf, sizeof(ackBuf), r, doc["id"] | -1L);
+      request->send(r.busy ? 409 : 200, "application/json", String(ackBuf, ackLen));
+    }
+  );
+
   // Endpoint para subir samples WAV
   server->on("/api/upload", HTTP_POST, 
     [](AsyncWebServerRequest *request){
@@ -1038,6 +1617,7 @@ refresh();if(auto_)startAuto();
       // Parse WAV header to find data chunk
       uint32_t dataOffset = 0;
       uint32_t dataSize = 0;
+      uint16_t audioFormat = 1;
       uint16_t numChannels = 1;
       uint16_t bitsPerSample = 16;
       uint32_t sampleRate = SAMPLE_RATE;
@@ -1050,6 +1630,7 @@ refresh();if(auto_)startAuto();
         uint8_t header[44];
         file.seek(0);
         if (file.read(header, 44) == 44 && memcmp(header, "RIFF", 4) == 0) {
+          audioFormat = header[20] | (header[21] << 8);
           numChannels = header[22] | (header[23] << 8);
           sampleRate = header[24] | (header[25] << 8) | (header[26] << 16) | (header[27] << 24);
           bitsPerSample = header[34] | (header[35] << 8);
@@ -1082,14 +1663,20 @@ refresh();if(auto_)startAuto();
         dataSize = fileSize;
       }
       
-      uint32_t bytesPerSample = bitsPerSample / 8;
-      uint32_t totalSamples = dataSize / bytesPerSample;
-      if (numChannels == 2) totalSamples /= 2;
-      
-      uint32_t samplesPerPoint = totalSamples / points;
-      if (samplesPerPoint == 0) samplesPerPoint = 1;
-      int actualPoints = totalSamples / samplesPerPoint;
-      if (actualPoints > points) actualPoints = points;
+      PcmSpec spec;
+      char specErr[48];
+      if (!pcmSpecFromWav(audioFormat, bitsPerSample, numChannels, &spec, specErr, sizeof(specErr))) {
+        file.close();
+        request->send(400, "application/json", "{\"error\":\"Unsupported format\"}");
+        return;
+      }
+      uint32_t frameBytes = spec.frameBytes;
+      uint32_t totalSamples = dataSize / frameBytes;
+      if (totalSamples == 0) {
+        file.close();
+        request->send(400, "application/json", "{\"error\":\"Invalid WAV\"}");
+        return;
+      }
       
       float durationMs = (totalSamples * 1000.0f) / sampleRate;
       
@@ -1098,7 +1685,57 @@ refresh();if(auto_)startAuto();
       int lastSlash = name.lastIndexOf('/');
       if (lastSlash >= 0) name = name.substring(lastSlash + 1);
       
-      // Build response while reading file in chunks
+      // Pirámide de picos cacheada por ruta+tamaño+mtime: sólo la primera
+      // preview lee el fichero entero, los zooms siguientes son O(points)
+      uint32_t mtime = (uint32_t)file.getLastWrite();
+      const PeakPyramid* pyr = peakCacheFind(filePath.c_str(), fileSize, mtime);
+      PeakPyramid* built = nullptr;
+      if (!pyr) {
+        // Sin PCM en RAM no hay fallback a muestras: bloque base ≤ muestras por
+        // punto del máximo de 400 para no perder detalle en ficheros cortos
+        uint8_t shift = 0;
+        while (shift < PEAK_BASE_SHIFT && (totalSamples >> (shift + 1)) >= 400) shift++;
+        built = PeakPyramid::create(totalSamples, shift);
+        const int CHUNK_FRAMES = 256;
+        uint8_t* chunkBuf = (uint8_t*)hpAlloc(CHUNK_FRAMES * 8 + CHUNK_FRAMES * sizeof(int16_t),
+                                              HP_HEAP_DEFAULT, "waveform.chunk");
+        if (!built || !chunkBuf) {
+          if (chunkBuf) hpFree(chunkBuf);
+          PeakPyramid::destroy(built);
+          file.close();
+          request->send(500, "application/json", "{\"error\":\"Memory\"}");
+          return;
+        }
+        int16_t* mono = (int16_t*)(chunkBuf + CHUNK_FRAMES * 8);
+        
+        file.seek(dataOffset);
+        uint32_t remaining = totalSamples;
+        uint32_t chunks = 0;
+        while (remaining > 0) {
+          uint32_t toRead = remaining < CHUNK_FRAMES ? remaining : CHUNK_FRAMES;
+          size_t bytesRead = file.read(chunkBuf, toRead * frameBytes);
+          uint32_t frames = bytesRead / frameBytes;
+          if (frames == 0) break;
+          pcmConvert(spec, chunkBuf, mono, frames);   // mismo PCM que cargará SampleManager
+          built->feed(mono, frames);
+          remaining -= frames;
+          if (++chunks % 16 == 0) yield();
+        }
+        built->finish();
+        hpFree(chunkBuf);
+        pyr = built;
+      }
+      file.close();
+      
+      int8_t* peaks = (int8_t*)hpAlloc(points * 2, HP_HEAP_DEFAULT, "waveform.peaks");
+      if (!peaks) {
+        PeakPyramid::destroy(built);
+        request->send(500, "application/json", "{\"error\":\"Memory\"}");
+        return;
+      }
+      int actualPoints = pyr->query(0, totalSamples, points, peaks);
+      if (built) peakCachePut(filePath.c_str(), fileSize, mtime, built);  // ya no se usa built
+      
       // Pre-reserve String to avoid repeated reallocs (~14 bytes per point)
       String json;
       json.reserve(200 + actualPoints * 14);
@@ -1113,58 +1750,17 @@ refresh();if(auto_)startAuto();
       json += ",\"points\":";
       json += actualPoints;
       json += ",\"peaks\":[";
-      
-      // Read peaks in small chunks — heap allocated to avoid stack overflow in async handler
-      const int CHUNK_SAMPLES = 256;  // Reduced for safety
-      int16_t* chunkBuf = (int16_t*)malloc(CHUNK_SAMPLES * 2 * sizeof(int16_t));
-      if (!chunkBuf) {
-        file.close();
-        request->send(500, "application/json", "{\"error\":\"Memory\"}");
-        return;
-      }
-      
-      file.seek(dataOffset);
-      
       for (int p = 0; p < actualPoints; p++) {
-        int16_t maxVal = 0, minVal = 0;
-        uint32_t remaining = samplesPerPoint;
-        
-        while (remaining > 0) {
-          uint32_t toRead = remaining;
-          if (toRead > CHUNK_SAMPLES) toRead = CHUNK_SAMPLES;
-          
-          size_t bytesToRead = toRead * bytesPerSample * numChannels;
-          size_t bytesRead = file.read((uint8_t*)chunkBuf, bytesToRead);
-          if (bytesRead == 0) break;
-          
-          uint32_t samplesRead = bytesRead / (bytesPerSample * numChannels);
-          
-          for (uint32_t j = 0; j < samplesRead; j++) {
-            int16_t s;
-            if (numChannels == 2) {
-              s = (chunkBuf[j * 2] / 2) + (chunkBuf[j * 2 + 1] / 2);
-            } else {
-              s = chunkBuf[j];
-            }
-            if (s > maxVal) maxVal = s;
-            if (s < minVal) minVal = s;
-          }
-          remaining -= samplesRead;
-        }
-        
         if (p > 0) json += ",";
         json += "[";
-        json += (int)(maxVal >> 8);
+        json += (int)peaks[p * 2];
         json += ",";
-        json += (int)(minVal >> 8);
+        json += (int)peaks[p * 2 + 1];
         json += "]";
-        
-        if (p % 10 == 9) yield();
       }
       json += "]}";
       
-      free(chunkBuf);
-      file.close();
+      hpFree(peaks);
       request->send(200, "application/json", json);
       return;
     }
@@ -1185,18 +1781,28 @@ refresh();if(auto_)startAuto();
     }
     
     // 'points' already declared at top of lambda
+    // Zoom opcional: ?start=&end= en muestras (por defecto el sample entero)
+    uint32_t sampleLen = sampleManager.getSampleLength(pad);
+    uint32_t rangeStart = 0, rangeEnd = sampleLen;
+    bool ranged = request->hasParam("start") || request->hasParam("end");
+    if (request->hasParam("start")) rangeStart = (uint32_t)request->getParam("start")->value().toInt();
+    if (request->hasParam("end")) rangeEnd = (uint32_t)request->getParam("end")->value().toInt();
+    if (rangeEnd > sampleLen) rangeEnd = sampleLen;
+    if (rangeStart >= rangeEnd) {
+      request->send(400, "application/json", "{\"error\":\"Invalid range\"}");
+      return;
+    }
     
     // Get waveform peaks (pairs: max, min per point)
-    int8_t* peaks = (int8_t*)malloc(points * 2);
+    int8_t* peaks = (int8_t*)hpAlloc(points * 2, HP_HEAP_DEFAULT, "waveform.peaks");
     if (!peaks) {
       request->send(500, "application/json", "{\"error\":\"Memory\"}");
       return;
     }
     
-    int actualPoints = sampleManager.getWaveformPeaks(pad, peaks, points);
+    int actualPoints = sampleManager.getWaveformPeaks(pad, peaks, points, rangeStart, rangeEnd);
     
     // Build compact JSON response
-    uint32_t sampleLen = sampleManager.getSampleLength(pad);
     float durationMs = (sampleLen * 1000.0f) / SAMPLE_RATE;
     
     // Use chunked response to avoid large buffer allocation
@@ -1208,6 +1814,12 @@ refresh();if(auto_)startAuto();
     json += sampleLen;
     json += ",\"duration\":";
     json += String(durationMs, 1);
+    if (ranged) {
+      json += ",\"start\":";
+      json += rangeStart;
+      json += ",\"end\":";
+      json += rangeEnd;
+    }
     json += ",\"points\":";
     json += actualPoints;
     json += ",\"peaks\":[";
@@ -1223,7 +1835,7 @@ refresh();if(auto_)startAuto();
     }
     json += "]}";
     
-    free(peaks);
+    hpFree(peaks);
     request->send(200, "application/json", json);
   });
 
@@ -1316,14 +1928,14 @@ refresh();if(auto_)startAuto();
   if (!_stateBuf) {
     _stateBuf = (char*)ps_malloc(kStateBufSize);
   }
+  // Época del snapshot de estado: un "sv" de antes del reinicio no vale
+  _stateEpoch = esp_random() | 1;
+  // Sin clientes: sin suscriptores de "levels" → el polling SPI de peaks se para
+  rebuildTopicSets();
   // Pre-allocate pattern JSON buffer in PSRAM (one-time, never freed)
   if (!_patternBuf) {
     _patternBuf = (char*)ps_malloc(kPatternBufSize);
   }
-  // Pre-allocate JSON document in PSRAM (one-time, reused via clear())
-  if (!_stateDoc) {
-    _stateDoc = new PsramJsonDocument(8192);
-  }
 
   // Iniciar servidor UDP
   if (udp.begin(UDP_PORT)) {
@@ -1362,32 +1974,405 @@ void WebInterface::releaseWsReassemblySlot(uint32_t clientId) {
 void WebInterface::releaseWsReassemblySlot(WsReassemblySlot* slot) {
   if (!slot) return;
   if (slot->buffer) {
-    free(slot->buffer);
+    slabFree(slot->buffer);
   }
   slot->buffer = nullptr;
   slot->size = 0;
   slot->clientId = 0xFFFFFFFF;
 }
 
-void WebInterface::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, 
-                                     AwsEventType type, void *arg, uint8_t *data, size_t len) {
-  if (type == WS_EVT_CONNECT) {
-    // ⚠️ LÍMITE DE 3 CLIENTES para estabilidad
-    if (ws->count() > 3) {
-      client->close(1008, "Max clients reached");
-      syslog("WS", "client %u rejected (max clients)", client->id());
-      return;
+WebInterface::WsClientState* WebInterface::findWsClientState(uint32_t clientId, bool create) {
+  WsClientState* freeState = nullptr;
+  for (auto& st : wsClientStates) {
+    if (st.clientId == clientId) return &st;
+    if (create && !freeState && st.clientId == 0xFFFFFFFF) freeState = &st;
+  }
+  if (freeState) freeState->reset(clientId);
+  return freeState;
+}
+
+void WebInterface::releaseWsClientState(uint32_t clientId) {
+  WsClientState* st = findWsClientState(clientId, false);
+  if (st) st->reset(0xFFFFFFFF);
+}
+
+// ═══════════════════════════════════════════════════════
+// BACKPRESSURE POR CLIENTE
+// ═══════════════════════════════════════════════════════
+// AsyncWebSocket encola por cliente sin límite de bytes: un móvil con WiFi
+// débil acumula meters/steps/estado hasta fragmentar el heap. La profundidad
+// de cola (queueLen) y el hueco de la ventana TCP (space) deciden qué se
+// descarta; el cliente sólo se desconecta si sigue congestionado kWsLagKickMs.
+static constexpr size_t kWsQueueLive = 4;           // más → se descartan LIVE
+static constexpr size_t kWsQueueState = 12;         // más → se descartan STATE
+static constexpr unsigned long kWsLagKickMs = 15000;
+static constexpr unsigned long kWsLagCheckMs = 250;
+
+bool WebInterface::wsAllowSend(WsClientState& st, AsyncWebSocketClient* c, uint8_t frameClass) {
+  if (!isClientReady(c)) return false;
+  size_t q = c->queueLen();
+  bool allow;
+  switch (frameClass) {
+    case WS_FRAME_LIVE:  allow = st.lagLevel < WS_LAG_CONGESTED && q < kWsQueueLive; break;
+    case WS_FRAME_STATE: allow = q < kWsQueueState; break;
+    default:             allow = !c->queueIsFull(); break;
+  }
+  if (!allow) st.dropped++;
+  return allow;
+}
+
+void WebInterface::assessWsBackpressure(unsigned long now) {
+  for (auto& st : wsClientStates) {
+    if (st.clientId == 0xFFFFFFFF) continue;
+    AsyncWebSocketClient* c = ws->client(st.clientId);
+    if (!isClientReady(c)) continue;
+
+    size_t q = c->queueLen();
+    AsyncClient* tcp = c->client();
+    bool windowFull = tcp && tcp->space() == 0;
+    if (q > st.maxQueue) st.maxQueue = (uint16_t)q;
+
+    uint8_t level = WS_LAG_OK;
+    if (q >= kWsQueueState || (windowFull && q >= kWsQueueLive)) level = WS_LAG_CONGESTED;
+    else if (q >= kWsQueueLive || windowFull) level = WS_LAG_SLOW;
+
+    if (level != st.lagLevel) {
+      syslog("WS", "client %u lag %u->%u queue=%u dropped=%u",
+             st.clientId, st.lagLevel, level, (unsigned)q, st.dropped);
+      st.lagLevel = level;
+    }
+    if (level == WS_LAG_OK) {
+      st.lagSinceMs = 0;
+    } else if (st.lagSinceMs == 0) {
+      st.lagSinceMs = now ? now : 1;
+    } else if (level == WS_LAG_CONGESTED && now - st.lagSinceMs >= kWsLagKickMs) {
+      // Último recurso: el cliente recarga y recibe estado completo al reconectar
+      syslog("WS", "client %u closed: congested %lus", st.clientId, (now - st.lagSinceMs) / 1000);
+      c->close(1013, "Client too slow");
+      st.lagSinceMs = 0;
     }
-    syslog("WS", "client %u connected (total=%d) heap=%u",
-           client->id(), ws->count(), ESP.getFreeHeap());
-    
-    
-    StaticJsonDocument<512> basicState;
-    basicState["type"] = "connected";
+  }
+}
+
+// Heap crítico: cerrar el cliente más retrasado antes de contar un strike de
+// reinicio. Sólo candidatos que de verdad van atrasados (cola >= kWsQueueLive o
+// lagLevel != OK): un cliente sano con un frame en vuelo no se toca.
+bool WebInterface::kickWorstWsClient() {
+  if (!ws) return false;
+  AsyncWebSocketClient* worst = nullptr;
+  size_t worstQ = 0;
+  uint8_t worstLag = WS_LAG_OK;
+  for (auto& st : wsClientStates) {
+    if (st.clientId == 0xFFFFFFFF) continue;
+    AsyncWebSocketClient* c = ws->client(st.clientId);
+    if (!isClientReady(c)) continue;
+    size_t q = c->queueLen();
+    if (q < kWsQueueLive && st.lagLevel == WS_LAG_OK) continue;
+    if (!worst || st.lagLevel > worstLag || (st.lagLevel == worstLag && q > worstQ)) {
+      worst = c;
+      worstQ = q;
+      worstLag = st.lagLevel;
+    }
+  }
+  if (!worst) return false;
+  syslog("HEAP", "closing ws client %u (queue=%u lag=%u) to recover heap",
+         worst->id(), (unsigned)worstQ, worstLag);
+  worst->close(1013, "Low memory");
+  return true;
+}
+
+bool WebInterface::wsClientWantsBinaryPattern(AsyncWebSocketClient* client) {
+  if (!client) return false;
+  WsClientState* st = findWsClientState(client->id(), false);
+  return st && st->binProto >= 2;
+}
+
+size_t WebInterface::encodePatternFrame(int pattern, uint8_t flags) {
+  if (!_patternBuf) _patternBuf = (char*)ps_malloc(kPatternBufSize);
+  if (!_patternBuf) return 0;
+  return patternEncode(sequencer, pattern, sequencer.getPatternLength(), flags,
+                       (uint8_t*)_patternBuf, kPatternBufSize);
+}
+
+bool WebInterface::broadcastPatternBinary(int pattern) {
+  if (!ws || !topicHasWs(TOPIC_PATTERN)) return false;
+  size_t binLen = 0;
+  bool needJson = false;
+  for (auto& st : wsClientStates) {
+    if (st.clientId == 0xFFFFFFFF || !wsTopicWantsPattern(st.topics, st.patternSub, pattern)) continue;
+    AsyncWebSocketClient* c = ws->client(st.clientId);
+    if (!isClientReady(c)) continue;
+    if (st.binProto < 2) { needJson = true; continue; }
+    if (binLen == 0) binLen = encodePatternFrame(pattern, 0);
+    if (binLen == 0) return needJson;  // sin buffer PSRAM (el peor caso ~28 KB cabe en kPatternBufSize)
+    c->binary((uint8_t*)_patternBuf, binLen);
+  }
+  return needJson;
+}
+
+void WebInterface::textToJsonPatternClients(const char* json, size_t len, int pattern) {
+  if (!ws) return;
+  for (auto& st : wsClientStates) {
+    if (st.clientId == 0xFFFFFFFF || st.binProto >= 2) continue;
+    if (!wsTopicWantsPattern(st.topics, st.patternSub, pattern)) continue;
+    AsyncWebSocketClient* c = ws->client(st.clientId);
+    if (isClientReady(c)) c->text(json, len);
+  }
+}
+
+// ═══════════════════════════════════════════════════════
+// TOPICS — suscripción por cliente (WsTopics.h)
+// ═══════════════════════════════════════════════════════
+// spi_log llega desde sendCommandDirect (Core1 casi siempre): anillo corto
+// bajo portMUX, update() lo vacía hacia los suscriptores de "logs". Lleno →
+// se pierde la línea (diagnóstico, no estado).
+static constexpr uint8_t kSpiLogSlots = 16;
+static constexpr size_t kSpiLogMaxLen = 96;
+static char _spiLogRing[kSpiLogSlots][kSpiLogMaxLen];
+static uint8_t _spiLogLen[kSpiLogSlots];
+static volatile uint8_t _spiLogHead = 0;
+static volatile uint8_t _spiLogTail = 0;
+static portMUX_TYPE _spiLogMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void spiLogToRing(const char* json) {
+  size_t len = strnlen(json, kSpiLogMaxLen - 1);
+  portENTER_CRITICAL(&_spiLogMux);
+  uint8_t next = (uint8_t)((_spiLogHead + 1) % kSpiLogSlots);
+  if (next != _spiLogTail) {
+    memcpy(_spiLogRing[_spiLogHead], json, len);
+    _spiLogLen[_spiLogHead] = (uint8_t)len;
+    _spiLogHead = next;
+  }
+  portEXIT_CRITICAL(&_spiLogMux);
+}
+
+void WebInterface::flushSpiLogs() {
+  for (uint8_t n = 0; n < 8 && _spiLogTail != _spiLogHead; n++) {
+    char line[kSpiLogMaxLen];
+    size_t len;
+    portENTER_CRITICAL(&_spiLogMux);
+    len = _spiLogLen[_spiLogTail];
+    memcpy(line, _spiLogRing[_spiLogTail], len);
+    _spiLogTail = (uint8_t)((_spiLogTail + 1) % kSpiLogSlots);
+    portEXIT_CRITICAL(&_spiLogMux);
+    wsTextTopic(TOPIC_LOGS, line, len);
+  }
+}
+
+void WebInterface::rebuildTopicSets() {
+  uint8_t sets[TOPIC_COUNT] = {};
+  for (uint8_t i = 0; i < sizeof(wsClientStates) / sizeof(wsClientStates[0]); i++) {
+    const WsClientState& st = wsClientStates[i];
+    if (st.clientId == 0xFFFFFFFF) continue;
+    for (uint8_t t = 0; t < TOPIC_COUNT; t++) {
+      if (st.topics & TOPIC_BIT(t)) sets[t] |= (uint8_t)(1u << i);
+    }
+  }
+  uint8_t udpMask = 0;
+  for (const auto& entry : udpClients) udpMask |= entry.second.topics;
+
+  bool logsBefore = _topicWs[TOPIC_LOGS] != 0;
+  memcpy(_topicWs, sets, sizeof(_topicWs));
+  _topicUdp = udpMask;
+
+  // Meters por SPI sólo si alguien pinta niveles (WS o UDP); logs SPI sólo con suscriptor
+  spiMaster.setPeakPolling(sets[TOPIC_LEVELS] != 0 || (udpMask & TOPIC_BIT(TOPIC_LEVELS)));
+  if (logsBefore != (sets[TOPIC_LOGS] != 0)) {
+    spiMaster.setSpiLogCallback(sets[TOPIC_LOGS] ? spiLogToRing : nullptr);
+  }
+}
+
+uint8_t WebInterface::applySubscribe(uint8_t current, const JsonDocument& doc) {
+  uint8_t mask = current;
+  if (doc.containsKey("topics")) mask = wsTopicMaskFromJson(doc["topics"]);
+  mask |= wsTopicMaskFromJson(doc["add"]);
+  mask &= (uint8_t)~wsTopicMaskFromJson(doc["remove"]);
+  return mask;
+}
+
+void WebInterface::handleWsSubscribe(AsyncWebSocketClient* client, const JsonDocument& doc) {
+  WsClientState* st = findWsClientState(client->id(), true);
+  if (!st) return;
+  uint8_t before = st->topics;
+  st->topics = applySubscribe(before, doc);
+  if (doc.containsKey("pattern")) {
+    int p = doc["pattern"] | -1;
+    st->patternSub = (p >= 0 && p < MAX_PATTERNS) ? (uint8_t)p : TOPIC_PATTERN_ANY;
+  }
+  rebuildTopicSets();
+
+  StaticJsonDocument<256> resp;
+  resp["type"] = "subscribed";
+  wsTopicMaskToJson(st->topics, resp.createNestedArray("topics"));
+  resp["pattern"] = st->patternSub == TOPIC_PATTERN_ANY ? -1 : (int)st->patternSub;
+  if (isClientReady(client)) sendJsonToClient(client, resp);
+
+  // Secciones de estado nuevas: el cliente no tiene su contenido → estado completo
+  uint8_t addedSec = wsTopicStateSections(st->topics) & (uint8_t)~wsTopicStateSections(before);
+  if (addedSec) {
+    st->stateVersion = 0;
+    sendSequencerStateToClient(client);
+  }
+}
+
+// Difusión a los suscriptores de un topic (pattern: sólo quien sigue el patrón actual)
+void WebInterface::wsTextTopic(WsTopic t, const char* data, size_t len) {
+  if (!ws || !topicHasWs(t)) return;
+  int curPattern = sequencer.getCurrentPattern();
+  for (auto& st : wsClientStates) {
+    if (st.clientId == 0xFFFFFFFF || !(st.topics & TOPIC_BIT(t))) continue;
+    if (t == TOPIC_PATTERN && !wsTopicWantsPattern(st.topics, st.patternSub, curPattern)) continue;
+    AsyncWebSocketClient* c = ws->client(st.clientId);
+    if (isClientReady(c)) c->text(data, len);
+  }
+}
+
+void WebInterface::wsTextTopicJson(WsTopic t, const JsonDocument& doc) {
+  if (!ws || !topicHasWs(t)) return;   // sin suscriptores ni se serializa
+  size_t len = measureJson(doc);
+  SlabBuffer buf(len + 1);
+  if (!buf.data()) return;
+  serializeJson(doc, buf.data(), buf.size());
+  wsTextTopic(t, buf.data(), len);
+}
+
+// ═══════════════════════════════════════════════════════
+// ACKS DE COMANDO ("rid")
+// ═══════════════════════════════════════════════════════
+// Un comando con "rid" recibe {"type":"ack"} (UDP: {"s":"ack"}) cuando su
+// último frame SPI sale hacia la Daisy: Core1 lo confirma por el anillo de
+// tags de SPIMaster. La Daisy no contesta a los comandos fire-and-forget,
+// así que la salida del ESP32 es el último punto observable. NACK si la cola
+// SPI lo descartó, si no salió en CMDACK_TIMEOUT_MS o si nunca se ejecutó.
+static constexpr unsigned long kAckStatsMs = 5000;
+
+uint8_t WebInterface::cmdAckBegin(CmdAckChannel ch, uint32_t owner, uint16_t port, uint32_t rid, uint32_t rxUs) {
+  uint8_t tag = cmdAckOpen(ch, owner, port, rid, rxUs);
+  if (tag) spiMaster.beginTag(tag);
+  return tag;
+}
+
+void WebInterface::cmdAckEnd(uint8_t tag, CmdAckChannel ch, uint32_t owner, uint16_t port, uint32_t rid, uint32_t rxUs) {
+  if (tag == 0) {
+    // Tabla llena: se ejecutó igualmente, sin seguimiento de la salida SPI
+    cmdAckNow(ch, owner, port, rid, rxUs, CMDACK_OK, true);
+    return;
+  }
+  SpiTagResult r = spiMaster.endTag();
+  CmdAckDone d;
+  if (cmdAckArm(tag, r, micros(), &d)) sendCmdAck(d);
+}
+
+void WebInterface::cmdAckNow(CmdAckChannel ch, uint32_t owner, uint16_t port, uint32_t rid, uint32_t rxUs,
+                             CmdAckError err, bool deferred) {
+  CmdAckDone d = {};
+  d.channel = ch;
+  d.owner = owner;
+  d.port = port;
+  d.rid = rid;
+  d.err = err;
+  d.deferred = deferred;
+  d.us = micros() - rxUs;
+  sendCmdAck(d);
+}
+
+void WebInterface::sendCmdAck(const CmdAckDone& d) {
+  char buf[112];
+  size_t len = cmdAckFormat(buf, sizeof(buf), d);
+  if (len == 0) return;
+  if (d.channel == CMDACK_UDP) {
+    udp.beginPacket(IPAddress(d.owner), d.port);
+    udp.write((const uint8_t*)buf, len);
+    udp.endPacket();
+    return;
+  }
+  if (!ws) return;
+  WsClientState* st = findWsClientState(d.owner, false);
+  if (!st) return;
+  portENTER_CRITICAL(&_ackStatsMux);
+  st->ackStats.record(d);
+  portEXIT_CRITICAL(&_ackStatsMux);
+  AsyncWebSocketClient* c = ws->client(d.owner);
+  if (wsAllowSend(*st, c, WS_FRAME_CRITICAL)) c->text(buf, len);
+}
+
+void WebInterface::flushCmdAcks(unsigned long now) {
+  CmdAckDone d;
+  SpiTagCompletion c;
+  for (uint8_t n = 0; n < SPI_TAG_RING && spiMaster.popTagCompletion(&c); n++) {
+    if (cmdAckComplete(c, &d)) sendCmdAck(d);
+  }
+  while (cmdAckExpire((uint32_t)now, &d)) sendCmdAck(d);
+
+  // Informe de latencia por cliente, sólo si hubo acks desde el anterior
+  if (now - _lastAckStatsMs < kAckStatsMs) return;
+  _lastAckStatsMs = now;
+  for (auto& st : wsClientStates) {
+    if (st.clientId == 0xFFFFFFFF || !st.ackStats.dirty) continue;
+    CmdAckStats snap;
+    portENTER_CRITICAL(&_ackStatsMux);
+    st.ackStats.dirty = false;
+    snap = st.ackStats;
+    portEXIT_CRITICAL(&_ackStatsMux);
+    char buf[128];
+    size_t len = cmdAckStatsFormat(buf, sizeof(buf), snap);
+    AsyncWebSocketClient* client = ws->client(st.clientId);
+    if (len > 0 && wsAllowSend(st, client, WS_FRAME_STATE)) client->text(buf, len);
+  }
+}
+
+// Los patrones no llevan sample propio (pista N = pad N), así que lo que se
+// prefetchea es el fichero de origen de cada pad con steps en los próximos
+// patrones: si un cambio de kit/audición lo sacó del pad, volver es inmediato
+static constexpr unsigned long kChainPrefetchMs = 1000;
+static constexpr uint8_t kChainPrefetchAhead = 2;
+
+void WebInterface::prefetchSongChain(unsigned long now) {
+  if (now - _lastChainPrefetchMs < kChainPrefetchMs) return;
+  _lastChainPrefetchMs = now;
+  if (!sequencer.isSongChainActive() || sequencer.getSongChainCount() == 0) return;
+
+  const Sequencer::SongChainEntry* chain = sequencer.getSongChain();
+  uint8_t count = sequencer.getSongChainCount();
+  uint16_t tracks = 0;
+  for (uint8_t a = 1; a <= kChainPrefetchAhead; a++) {
+    uint8_t pattern = chain[(sequencer.getSongChainIdx() + a) % count].pattern;
+    for (int t = 0; t < MAX_TRACKS; t++) {
+      if (tracks & (1u << t)) continue;
+      for (int st = 0; st < STEPS_PER_PATTERN; st++) {
+        if (sequencer.getStep(pattern, t, st)) { tracks |= (1u << t); break; }
+      }
+    }
+  }
+  for (int t = 0; t < MAX_TRACKS; t++) {
+    if (tracks & (1u << t)) sampleManager.prefetchPad(t);
+  }
+}
+
+void WebInterface::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, 
+                                     AwsEventType type, void *arg, uint8_t *data, size_t len) {
+  if (type == WS_EVT_CONNECT) {
+    // ⚠️ LÍMITE DE 3 CLIENTES para estabilidad
+    if (ws->count() > 3) {
+      client->close(1008, "Max clients reached");
+      syslog("WS", "client %u rejected (max clients)", client->id());
+      return;
+    }
+    syslog("WS", "client %u connected (total=%d) heap=%u",
+           client->id(), ws->count(), ESP.getFreeHeap());
+    findWsClientState(client->id(), true);
+    rebuildTopicSets();   // topics por defecto hasta su "subscribe"
+    // La cola llena descarta en vez de cerrar: assessWsBackpressure decide
+    client->setCloseClientOnQueueFull(false);
+    
+    
+    StaticJsonDocument<512> basicState;
+    basicState["type"] = "connected";
     basicState["playing"] = sequencer.isPlaying();
     basicState["tempo"] = sequencer.getTempo();
     basicState["pattern"] = sequencer.getCurrentPattern();
     basicState["clientId"] = client->id();
+    basicState["binProto"] = WS_BIN_PROTO_VERSION;
     
     // Serialize to stack buffer — avoid heap String
     char connectBuf[256];
@@ -1399,15 +2384,21 @@ void WebInterface::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient
     syslog("WS", "client %u disconnected (remaining=%d) heap=%u",
            client->id(), ws->count() > 0 ? ws->count()-1 : 0, ESP.getFreeHeap());
     releaseWsReassemblySlot(client->id());
+    releaseWsClientState(client->id());
+    cmdAckDropOwner(CMDACK_WS, client->id());
+    rebuildTopicSets();
   } else if (type == WS_EVT_DATA) {
     AwsFrameInfo *info = (AwsFrameInfo*)arg;
+    const uint32_t rxUs = micros();   // base de la latencia de los ACK
 
     // Guard rails de payload para evitar OOM/fragmentación bajo cargas anómalas
     if (info->opcode == WS_TEXT && info->len > kWsMaxTextBytes) {
       return;
     }
     if (info->opcode == WS_BINARY && info->len > kWsMaxBinaryBytes) {
-      return;
+      // Sólo los uploads de patrón binario superan 256 B; se validan en el primer chunk
+      if (info->len > kWsMaxPatternBytes) return;
+      if (info->index == 0 && (len == 0 || data[0] != PATTERN_BIN_MAGIC)) return;
     }
     
     bool _wsFreeAfter = false;
@@ -1436,7 +2427,7 @@ void WebInterface::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient
         if (ESP.getFreeHeap() < (uint32_t)(info->len + 4096)) {
           return;
         }
-        reassemblySlot->buffer = (uint8_t*)malloc(info->len + 2); // +2 for null terminator safety
+        reassemblySlot->buffer = (uint8_t*)slabAlloc(info->len + 2); // +2 for null terminator safety
         if (!reassemblySlot->buffer) {
           releaseWsReassemblySlot(reassemblySlot);
           return;
@@ -1466,15 +2457,50 @@ void WebInterface::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient
       
     // 1. MANEJO DE BINARIO (Baja latencia para Triggers)
     if (info->opcode == WS_BINARY) {
-      // Protocolo: [0x90, PAD, VEL]
-      if (len == 3 && data[0] == 0x90) {
+      // Protocolo: [0x90, PAD, VEL] o [0x90, PAD, VEL, RID_LO, RID_HI] con ACK
+      if ((len == 3 || len == 5) && data[0] == WS_BIN_TRIGGER) {
          int pad = data[1];
          int velocity = data[2];
-         triggerPadWithLED(pad, velocity);
+         uint32_t rid = (len == 5) ? (uint32_t)(data[3] | (data[4] << 8)) : 0;
+         if (wsIngress(client->id()).allow(ING_TRIGGER, millis())) {
+           uint8_t tag = rid ? cmdAckBegin(CMDACK_WS, client->id(), 0, rid, rxUs) : 0;
+           triggerPadWithLED(pad, velocity);
+           if (rid) cmdAckEnd(tag, CMDACK_WS, client->id(), 0, rid, rxUs);
+         } else if (rid) {
+           cmdAckNow(CMDACK_WS, client->id(), 0, rid, rxUs, CMDACK_ERR_RATE, false);
+         }
+      }
+      // Protocolo v1: [0xB1, OPCODE, ARGS..., (RID_LO, RID_HI)] — sin malloc ni parseo JSON
+      else if (len >= 2 && data[0] == WS_BIN_CMD_V1) {
+        CmdProfScope profScope(CMDPROF_PATH_WS);
+        StaticJsonDocument<192> binDoc;
+        uint32_t rid = 0;
+        const WsCommandInfo* cmdInfo = wsBinaryDecode(data, len, binDoc, &rid);
+        // Frame malformado: sin opcode fiable no hay rid que confirmar
+        if (cmdInfo) runWsCommand(client, cmdInfo, binDoc, rid, rxUs);
+      }
+      // Upload de patrón binario (equivalente a setBulk) — sin SlabJsonDocument de 32 KB
+      else if (len >= PATTERN_BIN_HEADER_SIZE && data[0] == PATTERN_BIN_MAGIC) {
+        if (!wsIngress(client->id()).allow(ING_HEAVY, millis())) {
+          static const char kRateErr[] = "{\"type\":\"error\",\"msg\":\"rate_limited\"}";
+          if (isClientReady(client)) client->text(kRateErr, sizeof(kRateErr) - 1);
+          cleanupWsReassembly();
+          return;
+        }
+        int pattern = patternDecodeApply(sequencer, data, len);
+        syslog("CMD", "setBulk bin len=%u p=%d heap=%u", (unsigned)len, pattern, ESP.getFreeHeap());
+        if (pattern >= 0) {
+          char ackBuf[40];
+          int ackLen = snprintf(ackBuf, sizeof(ackBuf),
+            "{\"type\":\"bulkAck\",\"p\":%d}", pattern);
+          if (isClientReady(client)) client->text(ackBuf, ackLen);
+        }
       }
+      cleanupWsReassembly();
     }
     // 2. MANEJO DE TEXTO (JSON normal)
     else if (info->opcode == WS_TEXT) {
+      CmdProfScope profScope(CMDPROF_PATH_WS);
       // Reject if heap critically low — prevent crash during JSON processing
       if (ESP.getFreeHeap() < 15000) {
         cleanupWsReassembly();
@@ -1487,7 +2513,7 @@ void WebInterface::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient
         safeData = (char*)data;
       } else {
         // Non-fragmented message: copy to safe buffer
-        safeData = (char*)malloc(len + 1);
+        safeData = (char*)slabAlloc(len + 1);
         if (!safeData) {
           cleanupWsReassembly();
           return;
@@ -1502,16 +2528,16 @@ void WebInterface::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient
         // Check for bulk pattern command (needs larger JSON doc)
         if (len > 400 && strstr((char*)data, "\"setBulk\"") != nullptr) {
           syslog("CMD", "setBulk len=%u heap=%u", (unsigned)len, ESP.getFreeHeap());
-          if (ESP.getFreeHeap() < 35000) {
+          bool bulkLimited = !wsIngress(client->id()).allow(ING_HEAVY, millis());
+          if (bulkLimited || ESP.getFreeHeap() < 35000) {
             StaticJsonDocument<64> errDoc;
-            errDoc["type"] = "error"; errDoc["msg"] = "low_heap";
-            String errStr; serializeJson(errDoc, errStr);
-            if (isClientReady(client)) client->text(errStr);
-            if (safeFreeNeeded) free(safeData);
+            errDoc["type"] = "error"; errDoc["msg"] = bulkLimited ? "rate_limited" : "low_heap";
+            if (isClientReady(client)) sendJsonToClient(client, errDoc);
+            if (safeFreeNeeded) slabFree(safeData);
             cleanupWsReassembly();
             return;
           }
-          PsramJsonDocument bulkDoc(32768);  // PSRAM — avoids 32KB spike on internal DRAM
+          SlabJsonDocument bulkDoc(32768);  // bloque de 32 KB del slab — sin pico en DRAM ni fragmentación
           DeserializationError bulkErr = deserializeJson(bulkDoc, (char*)data);
           if (!bulkErr) {
             int pattern = bulkDoc["p"].as<int>();
@@ -1554,160 +2580,97 @@ void WebInterface::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient
           if (_wsFreeAfter) {
             cleanupWsReassembly();
           } else if (safeFreeNeeded) {
-            free(safeData);
+            slabFree(safeData);
           }
           return; // Already handled
         }
 
-        StaticJsonDocument<512> doc;
+        // Un solo parseo: documento del slab según tamaño (un envelope batch
+        // puede traer decenas de comandos) y ruta por el "cmd" de la tabla
+        SlabJsonDocument doc(kTextDocBytes(len));
         DeserializationError error = deserializeJson(doc, (char*)data);
-        
+        const WsCommandInfo* cmdInfo = error ? nullptr : commandLookup(doc["cmd"] | "");
+
+        // Envelope batch: un token HEAVY por envelope
+        if (cmdInfo && cmdInfo->id == WSC_BATCH) {
+          char ackBuf[160];
+          int ackLen;
+          if (!wsIngress(client->id()).allow(ING_HEAVY, millis())) {
+            ackLen = snprintf(ackBuf, sizeof(ackBuf), "{\"type\":\"error\",\"msg\":\"rate_limited\"}");
+          } else if (!doc["cmds"].is<JsonArrayConst>()) {
+            ackLen = snprintf(ackBuf, sizeof(ackBuf), "{\"type\":\"error\",\"msg\":\"bad_batch\"}");
+          } else {
+            BatchResult r = applyBatch(doc["cmds"], doc["atomic"] | false);
+            ackLen = (int)formatBatchAck(ackBuf, sizeof(ackBuf), r, doc["id"] | -1L);
+            syslog("CMD", "batch len=%u n=%u skip=%u spi=%u heap=%u", (unsigned)len,
+                   r.applied, r.skipped, r.spiFrames, ESP.getFreeHeap());
+          }
+          if (ackLen > 0 && isClientReady(client)) client->text(ackBuf, ackLen);
+          if (_wsFreeAfter) {
+            cleanupWsReassembly();
+          } else if (safeFreeNeeded) {
+            slabFree(safeData);
+          }
+          return;
+        }
+
         if (!error) {
-          // Procesar comandos comunes primero (start, stop, tempo, etc.)
-          processCommand(doc);
-          
+          // Comandos comunes primero (start, stop, tempo, etc.); no admitido → sin respuesta
+          if (!runWsCommand(client, cmdInfo, doc, doc["rid"] | 0u, rxUs)) cmdInfo = nullptr;
+
           // Comandos específicos del WebSocket que requieren respuesta
-          String cmd = doc["cmd"];
+          const WsCmdId cmdId = cmdInfo ? cmdInfo->id : WSC_NONE;
           
-          if (cmd == "getPattern") {
+          if (cmdId == WSC_GET_PATTERN && wsClientWantsBinaryPattern(client)) {
+            // Formato binario compacto (PatternCodec.h) — sin DOM ni String
+            int pattern = sequencer.getCurrentPattern();
+            size_t binLen = encodePatternFrame(pattern, 0);
+            syslog("CMD", "getPattern bin idx=%d len=%u", pattern, (unsigned)binLen);
+            if (binLen > 0 && isClientReady(client)) {
+              client->binary((uint8_t*)_patternBuf, binLen);
+            }
+          }
+          else if (cmdId == WSC_GET_PATTERN) {
             int pattern = sequencer.getCurrentPattern();
             syslog("CMD", "getPattern idx=%d heap=%u", pattern, ESP.getFreeHeap());
             // 6 data structures × 16 tracks × 16 steps — needs ~13-15KB ArduinoJson pool
             if (ESP.getFreeHeap() < 35000) {
               StaticJsonDocument<64> err; err["type"] = "error"; err["msg"] = "low_heap";
-              String errStr; serializeJson(err, errStr);
-              if (isClientReady(client)) client->text(errStr);
-              if (safeFreeNeeded) free(safeData);
+              if (isClientReady(client)) sendJsonToClient(client, err);
+              if (safeFreeNeeded) slabFree(safeData);
               cleanupWsReassembly();
               return;
             }
             yield();
-            int stepCount = sequencer.getPatternLength();
-            // Using PSRAM allocator to avoid 32KB spike on internal DRAM heap
-            PsramJsonDocument responseDoc(stepCount > 16 ? 49152 : 24576);
-            responseDoc["stepCount"] = stepCount;  // 8+ structures × 16×steps values
-            responseDoc["type"] = "pattern";
-            responseDoc["index"] = pattern;
-            
-            // Send steps (active/inactive) - 16 tracks activos
-            for (int track = 0; track < 16; track++) {
-              JsonArray trackSteps = responseDoc.createNestedArray(String(track));
-              for (int step = 0; step < stepCount; step++) {
-                trackSteps.add(sequencer.getStep(track, step));
-              }
-            }
-            
-            // Send velocities
-            JsonObject velocitiesObj = responseDoc.createNestedObject("velocities");
-            for (int track = 0; track < 16; track++) {
-              JsonArray trackVels = velocitiesObj.createNestedArray(String(track));
-              for (int step = 0; step < stepCount; step++) {
-                trackVels.add(sequencer.getStepVelocity(track, step));
-              }
-            }
-            
-            // Send note lengths (1=full, 2=half, 4=quarter, 8=eighth)
-            JsonObject noteLensObj = responseDoc.createNestedObject("noteLens");
-            for (int track = 0; track < 16; track++) {
-              JsonArray trackNL = noteLensObj.createNestedArray(String(track));
-              for (int step = 0; step < stepCount; step++) {
-                trackNL.add(sequencer.getStepNoteLen(track, step));
-              }
-            }
-
-            JsonObject volumeLocksObj = responseDoc.createNestedObject("volumeLocks");
-            for (int track = 0; track < 16; track++) {
-              JsonArray trackLocks = volumeLocksObj.createNestedArray(String(track));
-              for (int step = 0; step < stepCount; step++) {
-                if (sequencer.hasStepVolumeLock(track, step)) {
-                  trackLocks.add(sequencer.getStepVolumeLock(track, step));
-                } else {
-                  trackLocks.add(-1);
-                }
-              }
-            }
-
-            JsonObject probabilitiesObj = responseDoc.createNestedObject("probabilities");
-            for (int track = 0; track < 16; track++) {
-              JsonArray trackProb = probabilitiesObj.createNestedArray(String(track));
-              for (int step = 0; step < stepCount; step++) {
-                trackProb.add(sequencer.getStepProbability(track, step));
-              }
-            }
-
-            JsonObject ratchetsObj = responseDoc.createNestedObject("ratchets");
-            for (int track = 0; track < 16; track++) {
-              JsonArray trackRat = ratchetsObj.createNestedArray(String(track));
-              for (int step = 0; step < stepCount; step++) {
-                trackRat.add(sequencer.getStepRatchet(track, step));
-              }
-            }
-
-            JsonObject cutoffLocksObj = responseDoc.createNestedObject("cutoffLocks");
-            for (int track = 0; track < 16; track++) {
-              JsonArray trackLocks = cutoffLocksObj.createNestedArray(String(track));
-              for (int step = 0; step < stepCount; step++) {
-                if (sequencer.hasStepCutoffLock(track, step)) {
-                  trackLocks.add((int)sequencer.getStepCutoffLock(track, step));
-                } else {
-                  trackLocks.add(-1);
-                }
-              }
-            }
-
-            JsonObject reverbLocksObj = responseDoc.createNestedObject("reverbLocks");
-            for (int track = 0; track < 16; track++) {
-              JsonArray trackLocks = reverbLocksObj.createNestedArray(String(track));
-              for (int step = 0; step < stepCount; step++) {
-                if (sequencer.hasStepReverbSendLock(track, step)) {
-                  trackLocks.add((int)sequencer.getStepReverbSendLock(track, step));
-                } else {
-                  trackLocks.add(-1);
-                }
-              }
-            }
-
-            // Melody: per-step MIDI notes (0 = rest)
-            JsonObject notesObj = responseDoc.createNestedObject("stepNotes");
-            JsonObject noteVoicesObj = responseDoc.createNestedObject("stepNoteVoices");
-            for (int track = 0; track < 16; track++) {
-              JsonArray trackNotes = notesObj.createNestedArray(String(track));
-              JsonArray trackVoices = noteVoicesObj.createNestedArray(String(track));
-              for (int step = 0; step < stepCount; step++) {
-                trackNotes.add(sequencer.getStepNote(track, step));
-                JsonArray stepVoices = trackVoices.createNestedArray();
-                for (int voice = 0; voice < MELODY_STEP_VOICES; voice++) {
-                  stepVoices.add(sequencer.getStepNoteVoice(track, step, voice));
-                }
-              }
-            }
-
-            // Melody: per-step flags (bit0=accent, bit1=slide)
-            JsonObject flagsObj = responseDoc.createNestedObject("stepFlags");
-            for (int track = 0; track < 16; track++) {
-              JsonArray trackFlags = flagsObj.createNestedArray(String(track));
-              for (int step = 0; step < stepCount; step++) {
-                trackFlags.add(sequencer.getStepFlags(track, step));
-              }
-            }
-            
-            // Serialize to PSRAM buffer to avoid String heap fragmentation
-            if (!_patternBuf) _patternBuf = (char*)ps_malloc(kPatternBufSize);
-            if (_patternBuf) {
-              size_t len = serializeJson(responseDoc, _patternBuf, kPatternBufSize);
-              syslog("CMD", "getPat JSON len=%u heap=%u", (unsigned)len, ESP.getFreeHeap());
-              if (len > 0 && len < kPatternBufSize) {
-                if (isClientReady(client)) {
-                  client->text(_patternBuf, len);
-                } else {
-                  ws->textAll(_patternBuf, len);
-                }
+            // Streaming directo a _patternBuf (PSRAM) — sin documento JSON de 24-49 KB
+            size_t len = buildPatternJson(pattern, sequencer.getPatternLength(), true);
+            syslog("CMD", "getPat JSON len=%u heap=%u", (unsigned)len, ESP.getFreeHeap());
+            if (len > 0) {
+              if (isClientReady(client)) {
+                client->text(_patternBuf, len);
+              } else {
+                ws->textAll(_patternBuf, len);
               }
             }
             syslog("CMD", "getPat DONE heap=%u", ESP.getFreeHeap());
           }
-          else if (cmd == "init") {
-            // Cliente solicita inicialización completa
+          else if (cmdId == WSC_INIT) {
+            // Cliente solicita inicialización completa (y anuncia su versión binaria)
+            WsClientState* st = findWsClientState(client->id(), true);
+            if (st) {
+              st->binProto = doc["binProto"] | 0;
+              st->editBatch = doc["batch"] | false;
+              // "sv"/"se" = última versión de estado vista antes de reconectar → sólo delta
+              st->stateDelta = doc.containsKey("sv");
+              uint32_t sv = doc["sv"] | 0u;
+              uint32_t se = doc["se"] | 0u;
+              st->stateVersion = (st->stateDelta && se == _stateEpoch) ? sv : 0;
+              // "topics" en init = subscribe sin un round-trip más
+              if (doc.containsKey("topics")) {
+                st->topics = applySubscribe(st->topics, doc);
+                rebuildTopicSets();
+              }
+            }
             // State doc lives in PSRAM — safe to send regardless of heap
             if (isClientReady(client)) {
               sendSequencerStateToClient(client);
@@ -1723,94 +2686,47 @@ void WebInterface::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient
               if (mLen > 0) client->text(midiBuf, mLen);
             }
           }
-          else if (cmd == "getSampleCounts") {
+          else if (cmdId == WSC_SUBSCRIBE) {
+            handleWsSubscribe(client, doc);
+          }
+          else if (cmdId == WSC_GET_SAMPLE_COUNTS) {
             // Nuevo comando para obtener conteos de samples
             sendSampleCounts(client);
           }
-          else if (cmd == "getSamples") {
+          else if (cmdId == WSC_GET_SAMPLES) {
             // Obtener lista de samples de una familia desde LittleFS
             const char* family = doc["family"];
             int padIndex = doc["pad"];
 
-            DynamicJsonDocument responseDoc(4096);  // Heap-allocated, flexible size
-            responseDoc["type"] = "sampleList";
-            responseDoc["family"] = family;
-            responseDoc["pad"] = padIndex;
-
             if (!family) {
+              SlabJsonDocument responseDoc(256);
+              responseDoc["type"] = "sampleList";
+              responseDoc["family"] = family;
+              responseDoc["pad"] = padIndex;
               responseDoc.createNestedArray("samples");
-              String emptyOut;
-              serializeJson(responseDoc, emptyOut);
-              if (isClientReady(client)) client->text(emptyOut);
-              else ws->textAll(emptyOut);
-              if (safeFreeNeeded) free(safeData);
+              if (isClientReady(client)) sendJsonToClient(client, responseDoc);
+              else wsTextAllJson(responseDoc);
+              if (safeFreeNeeded) slabFree(safeData);
               cleanupWsReassembly();
               return;
             }
 
-            String path = String("/") + String(family);
-
-            File dir = LittleFS.open(path, "r");
-
-            if (dir && dir.isDirectory()) {
-              JsonArray samples = responseDoc.createNestedArray("samples");
-              File file = dir.openNextFile();
-              int count = 0;
-
-              while (file) {
-                if (!file.isDirectory()) {
-                  String filename = file.name();
-                  int lastSlash = filename.lastIndexOf('/');
-                  if (lastSlash >= 0) {
-                    filename = filename.substring(lastSlash + 1);
-                  }
-
-                  if (isSupportedSampleFile(filename)) {
-                    JsonObject sampleObj = samples.createNestedObject();
-                    sampleObj["name"] = filename;
-                    sampleObj["size"] = file.size();
-                    const char* format = detectSampleFormat(filename.c_str());
-                    sampleObj["format"] = format;
-                    uint32_t rate = 0;
-                    uint16_t channels = 0;
-                    uint16_t bits = 0;
-                    if (format && String(format) == "wav") {
-                      if (readWavInfo(file, rate, channels, bits)) {
-                        sampleObj["rate"] = rate;
-                        sampleObj["channels"] = channels;
-                        sampleObj["bits"] = bits;
-                      } else {
-                        sampleObj["rate"] = 0;
-                        sampleObj["channels"] = 0;
-                        sampleObj["bits"] = 0;
-                      }
-                    } else {
-                      sampleObj["rate"] = SAMPLE_RATE;
-                      sampleObj["channels"] = 1;
-                      sampleObj["bits"] = 16;
-                    }
-                    count++;
-
-                    // Yield cada 3 samples para evitar watchdog
-                    if (count % 3 == 0) {
-                      yield();
-                    }
-                  }
-                }
-                file.close();
-                file = dir.openNextFile();
-              }
-              dir.close();
-            } else {
-              responseDoc.createNestedArray("samples");  // folder not found → empty list
-            }
-
-            String output;
-            serializeJson(responseDoc, output);
-            if (isClientReady(client)) {
-              client->text(output);
+            // Listado desde el índice (SampleIndex.h): sin abrir directorio ni cabeceras
+            // (lock mientras se leen los registros: un loadSample por UDP puede refrescarlo)
+            const SampleIndexEntry* entries;
+            uint16_t count;
+            sampleIndexLock(UINT32_MAX);
+            sampleIndexFolder(family, &entries, &count);
+            // Familia abierta en el navegador: calentar los vecinos del sample del pad
+            sampleManager.prefetchNeighbours(family,
+                (padIndex >= 0 && padIndex < MAX_SAMPLES) ? sampleManager.getSampleName(padIndex) : nullptr);
+            AsyncWebSocketMessageBuffer* buffer = buildSampleListMessage(ws, family, padIndex, entries, count);
+            sampleIndexUnlock();
+            if (buffer) {
+              if (isClientReady(client)) client->text(buffer);
+              else ws->textAll(buffer);
             } else {
-              ws->textAll(output);
+              syslog("WS", "getSamples %s: no buffer for %u entries", family, count);
             }
           }
           // getSamples y loadSample ahora manejados en processCommand()
@@ -1819,7 +2735,7 @@ void WebInterface::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient
       }
     // Cleanup safe buffer if we allocated one (non-fragmented path)
     if (safeFreeNeeded) {
-      free(safeData);
+      slabFree(safeData);
     }
     // Cleanup reassembly buffer after processing
     cleanupWsReassembly();
@@ -1835,128 +2751,311 @@ void WebInterface::broadcastSequencerState() {
   if (now - lastBroadcast < 500) return;
   lastBroadcast = now;
   
-  // All memory lives in PSRAM — zero heap allocation in this path
-  if (_stateDoc && _stateBuf) {
-    _stateDoc->clear();
-    populateStateDocument(*_stateDoc);
-    size_t len = serializeJson(*_stateDoc, _stateBuf, kStateBufSize);
-    if (len > 0 && len < kStateBufSize) {
-      ws->textAll(_stateBuf, len);
+  pushStateToClients();
+}
+
+// Sólo se reconstruyen las secciones dirty que algún suscriptor ve; cada
+// cliente recibe el delta desde su versión, limitado a sus topics
+void WebInterface::pushStateToClients() {
+  if (!initialized || !ws || ws->count() == 0) return;
+  uint8_t need = 0;
+  for (auto& st : wsClientStates) {
+    if (st.clientId != 0xFFFFFFFF) need |= wsTopicStateSections(st.topics);
+  }
+  if (need == 0 || !refreshStateSections(need)) return;
+  for (auto& st : wsClientStates) {
+    if (st.clientId == 0xFFFFFFFF || wsTopicStateSections(st.topics) == 0) continue;
+    AsyncWebSocketClient* c = ws->client(st.clientId);
+    if (wsAllowSend(st, c, WS_FRAME_STATE)) sendStateToClient(c, &st);
+  }
+}
+
+void WebInterface::markStateDirty(uint8_t sections) {
+  __atomic_fetch_or(&_stateDirtyMask, (uint8_t)(sections & STATE_SEC_ALL), __ATOMIC_RELAXED);
+}
+
+// Clave de coalescencia: mismo type/param/fx sobre la misma celda → se sobrescribe
+static uint32_t editEchoKey(const JsonDocument& resp) {
+  uint32_t h = 2166136261u;
+  auto mixStr = [&h](const char* str) {
+    for (; str && *str; str++) { h ^= (uint8_t)*str; h *= 16777619u; }
+    h ^= 0xFF; h *= 16777619u;
+  };
+  auto mixInt = [&h](int v) {
+    for (int b = 0; b < 4; b++) { h ^= (uint8_t)(v >> (b * 8)); h *= 16777619u; }
+  };
+  mixStr(resp["type"] | "");
+  mixStr(resp["param"] | "");
+  mixStr(resp["fx"] | "");
+  mixInt(resp["track"] | -1);
+  mixInt(resp["step"] | -1);
+  mixInt(resp["pad"] | -1);
+  return h;
+}
+
+void WebInterface::queueEditEcho(const JsonDocument& resp) {
+  if (!ws || ws->count() == 0) return;
+  const WsTopic topic = wsTopicOfEcho(resp["type"] | "");
+  if (!topicHasWs(topic)) return;   // nadie pinta este eco: ni se serializa
+  char tmp[kEditEchoMaxLen];
+  size_t len = serializeJson(resp, tmp, sizeof(tmp));
+  if (len == 0) return;
+  if (!_editEchoSlots) _editEchoSlots = (EditEchoSlot*)ps_malloc(sizeof(EditEchoSlot) * kEditEchoSlots);
+  if (!_editEchoOut) _editEchoOut = (char*)ps_malloc(kEditEchoOutSize);
+  if (len >= sizeof(tmp) || !_editEchoSlots || !_editEchoOut) {
+    // Demasiado grande o sin PSRAM: envío directo, respetando el orden de lo ya encolado
+    flushEditEchoes();
+    wsTextTopicJson(topic, resp);
+    return;
+  }
+  const uint32_t key = editEchoKey(resp);
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool queued = false;
+    portENTER_CRITICAL(&_editEchoMux);
+    uint8_t count = _editEchoCount;
+    EditEchoSlot* slot = nullptr;
+    for (uint8_t i = 0; i < count; i++) {
+      if (_editEchoSlots[i].key == key) { slot = &_editEchoSlots[i]; break; }
+    }
+    if (!slot && count < kEditEchoSlots) {
+      slot = &_editEchoSlots[count];
+      if (count == 0) _editEchoFirstMs = millis();
+      _editEchoCount = count + 1;
+    }
+    if (slot) {
+      slot->key = key;
+      slot->len = (uint16_t)len;
+      slot->topic = topic;
+      memcpy(slot->json, tmp, len);
+      queued = true;
+    }
+    portEXIT_CRITICAL(&_editEchoMux);
+    if (queued) return;
+    flushEditEchoes();  // lleno: vaciar y reintentar
+  }
+}
+
+void WebInterface::flushEditEchoes() {
+  if (!_editEchoSlots || !_editEchoOut || _editEchoCount == 0) return;
+
+  // Copia bajo lock al frame combinado; los mensajes sueltos son substrings de él
+  static constexpr char kPrefix[] = "{\"type\":\"batch\",\"msgs\":[";
+  uint16_t offs[kEditEchoSlots];
+  uint16_t lens[kEditEchoSlots];
+  uint8_t topics[kEditEchoSlots];
+  uint8_t slotTopics = 0;   // TOPIC_BIT de los ecos presentes
+  size_t pos = sizeof(kPrefix) - 1;
+  memcpy(_editEchoOut, kPrefix, pos);
+  portENTER_CRITICAL(&_editEchoMux);
+  uint8_t count = _editEchoCount;
+  for (uint8_t i = 0; i < count; i++) {
+    if (i) _editEchoOut[pos++] = ',';
+    offs[i] = (uint16_t)pos;
+    lens[i] = _editEchoSlots[i].len;
+    topics[i] = _editEchoSlots[i].topic;
+    slotTopics |= TOPIC_BIT(topics[i]);
+    memcpy(_editEchoOut + pos, _editEchoSlots[i].json, lens[i]);
+    pos += lens[i];
+  }
+  _editEchoCount = 0;
+  portEXIT_CRITICAL(&_editEchoMux);
+  _editEchoOut[pos++] = ']';
+  _editEchoOut[pos++] = '}';
+
+  if (!ws || count == 0) return;
+  if (count == 1) {
+    wsTextTopic((WsTopic)topics[0], _editEchoOut + offs[0], lens[0]);
+    return;
+  }
+
+  // Topics de eco que ve cada cliente (pattern: sólo si sigue el patrón actual)
+  const int curPattern = sequencer.getCurrentPattern();
+  auto echoMask = [&](const WsClientState& st) -> uint8_t {
+    uint8_t m = st.topics & TOPIC_BIT(TOPIC_MIXER);
+    if (wsTopicWantsPattern(st.topics, st.patternSub, curPattern)) m |= TOPIC_BIT(TOPIC_PATTERN);
+    return m & slotTopics;
+  };
+
+  int plainClients = 0;
+  int partialClients = 0;   // ven sólo parte de los ecos (o ninguno)
+  for (auto& st : wsClientStates) {
+    if (st.clientId == 0xFFFFFFFF || !isClientReady(ws->client(st.clientId))) continue;
+    if (echoMask(st) != slotTopics) partialClients++;
+    else if (!st.editBatch) plainClients++;
+  }
+  if (plainClients == 0 && partialClients == 0) {
+    ws->textAll(_editEchoOut, pos);  // un solo buffer compartido
+    return;
+  }
+
+  // Frame filtrado por topic, construido sólo si hay un cliente batch parcial
+  size_t altLen = 0;
+  uint8_t altMask = 0;
+  for (auto& st : wsClientStates) {
+    if (st.clientId == 0xFFFFFFFF) continue;
+    AsyncWebSocketClient* c = ws->client(st.clientId);
+    if (!isClientReady(c)) continue;
+    uint8_t m = echoMask(st);
+    if (m == 0) continue;
+    if (m == slotTopics && st.editBatch) {
+      c->text(_editEchoOut, pos);
+    } else if (!st.editBatch) {
+      for (uint8_t i = 0; i < count; i++) {
+        if (m & TOPIC_BIT(topics[i])) c->text(_editEchoOut + offs[i], lens[i]);
+      }
+    } else {
+      if (altMask != m) {
+        if (!_editEchoAlt) _editEchoAlt = (char*)ps_malloc(kEditEchoOutSize);
+        if (!_editEchoAlt) continue;
+        altLen = sizeof(kPrefix) - 1;
+        memcpy(_editEchoAlt, kPrefix, altLen);
+        bool first = true;
+        for (uint8_t i = 0; i < count; i++) {
+          if (!(m & TOPIC_BIT(topics[i]))) continue;
+          if (!first) _editEchoAlt[altLen++] = ',';
+          first = false;
+          memcpy(_editEchoAlt + altLen, _editEchoOut + offs[i], lens[i]);
+          altLen += lens[i];
+        }
+        _editEchoAlt[altLen++] = ']';
+        _editEchoAlt[altLen++] = '}';
+        altMask = m;
+      }
+      c->text(_editEchoAlt, altLen);
     }
   }
 }
 
+// Completo para clientes sin "sv" o sin versión previa; delta (JSON escrito
+// directamente en el buffer del mensaje) para el resto.
+void WebInterface::sendStateToClient(AsyncWebSocketClient* client, WsClientState* st) {
+  uint32_t since = (st && st->stateDelta) ? st->stateVersion : 0;
+  if (since > _stateVersion) since = 0;
+  uint8_t secMask = st ? wsTopicStateSections(st->topics) : STATE_SEC_ALL;
+  AsyncWebSocketMessageBuffer* buffer = buildStateMessage(ws, since, secMask);
+  if (!buffer) return;
+  client->text(buffer);
+  if (st) st->stateVersion = _stateVersion;
+}
+
 bool WebInterface::shouldSendUdpStateSync(const char* cmd) const {
-  if (!cmd) return false;
-  return strcmp(cmd, "hello") == 0 ||
-         strcmp(cmd, "get_state") == 0 ||
-         strcmp(cmd, "getState") == 0 ||
-         strcmp(cmd, "selectPattern") == 0 ||
-         strcmp(cmd, "start") == 0 ||
-         strcmp(cmd, "stop") == 0 ||
-         strcmp(cmd, "tempo") == 0 ||
-         strcmp(cmd, "mute") == 0 ||
-         strcmp(cmd, "solo") == 0 ||
-         strcmp(cmd, "setTrackSolo") == 0 ||
-         strcmp(cmd, "setTrackVolume") == 0 ||
-         strcmp(cmd, "getTrackVolumes") == 0 ||
-         strncmp(cmd, "setFilter", 9) == 0 ||
-         strncmp(cmd, "setDelay", 8) == 0 ||
-         strncmp(cmd, "setReverb", 9) == 0 ||
-         strncmp(cmd, "setChorus", 9) == 0 ||
-         strncmp(cmd, "setPhaser", 9) == 0 ||
-         strncmp(cmd, "setFlanger", 10) == 0 ||
-         strncmp(cmd, "setCompressor", 13) == 0 ||
-         strcmp(cmd, "setDistortion") == 0 ||
-         strcmp(cmd, "setBitCrush") == 0 ||
-         strcmp(cmd, "setSampleRate") == 0 ||
-         strncmp(cmd, "setTrack", 8) == 0 ||
-         strncmp(cmd, "sdLoad", 6) == 0 ||
-         strcmp(cmd, "sdUnloadKit") == 0 ||
-         strcmp(cmd, "sdGetStatus") == 0;
+  const WsCommandInfo* info = commandLookup(cmd);
+  return info && (info->flags & CMDF_UDP_SYNC);
 }
 
 void WebInterface::sendUdpStateSync(IPAddress ip, uint16_t port) {
   if (!initialized || ip == IPAddress(0, 0, 0, 0) || port == 0) return;
 
-  PsramJsonDocument doc(4096);
+  // Slaves binarios: un solo paquete 0xB3 con estado + melody (~700 B vs ~4 KB JSON)
+  UdpClient* uc = findUdpClient(ip);
+  if (uc && uc->binProto >= UDP_SYNC_BIN_PROTO) {
+    const UdpSyncPacket* pkt = encodeUdpSyncState();
+    if (pkt) {
+      sendUdpSyncPacket(pkt, ip, port);
+      return;
+    }
+  }
+
+  if (!_stateBuf) _stateBuf = (char*)ps_malloc(kStateBufSize);
+  if (!_stateBuf) return;
+
   SdStatusResponse sdStat = {};
   bool sdOk = spiMaster.getCachedSdStatus(sdStat);
   uint32_t sdLoadedMask = sdOk ? sdStat.samplesLoaded : 0;
-
-  doc["cmd"] = "state_sync";
-  doc["pattern"] = sequencer.getCurrentPattern();
-  doc["playing"] = sequencer.isPlaying();
-  doc["tempo"] = sequencer.getTempo();
-  doc["step"] = sequencer.getCurrentStep();
-  doc["stepCount"] = sequencer.getPatternLength();
-  doc["masterVolume"] = spiMaster.getMasterVolume();
-  doc["sequencerVolume"] = spiMaster.getSequencerVolume();
-  doc["liveVolume"] = spiMaster.getLiveVolume();
-  doc["kit"] = sdOk ? String(sdStat.currentKit) : "";
-  doc["sdPresent"] = sdOk ? (bool)sdStat.present : false;
-  doc["sdLoadedMask"] = sdLoadedMask;
-
-  JsonArray mute = doc.createNestedArray("mute");
-  JsonArray solo = doc.createNestedArray("solo");
-  JsonArray volumes = doc.createNestedArray("trackVolumes");
-  for (int track = 0; track < MAX_TRACKS; track++) {
-    mute.add(sequencer.isTrackMuted(track) || spiMaster.getTrackMute(track));
-    solo.add(spiMaster.getTrackSolo(track));
-    volumes.add(sequencer.getTrackVolume(track));
-  }
-
-  JsonObject fx = doc.createNestedObject("fx");
-  fx["filterType"] = gMasterFilterType;
-  fx["filterCutoff"] = gMasterFilterCutoff;
-  fx["filterResonance"] = gMasterFilterResonance;
-  fx["distortion"] = gMasterDistortion;
-  fx["bitCrush"] = gMasterBitCrushBits;
-  fx["sampleRate"] = gMasterSampleRateReduction;
-  fx["delayActive"] = gMasterDelayActive;
-  fx["phaserActive"] = gMasterPhaserActive;
-  fx["flangerActive"] = gMasterFlangerActive;
-  fx["compressorActive"] = gMasterCompressorActive;
-  fx["reverbActive"] = spiMaster.isReverbActive();
-  fx["chorusActive"] = spiMaster.isChorusActive();
-
-  JsonArray trackFilters = fx.createNestedArray("trackFilters");
-  JsonArray trackReverbSend = fx.createNestedArray("trackReverbSend");
-  JsonArray trackDelaySend = fx.createNestedArray("trackDelaySend");
-  JsonArray trackChorusSend = fx.createNestedArray("trackChorusSend");
-  JsonArray trackPan = fx.createNestedArray("trackPan");
-  JsonArray trackEcho = fx.createNestedArray("trackEcho");
-  JsonArray trackFlanger = fx.createNestedArray("trackFlanger");
-  JsonArray trackCompressor = fx.createNestedArray("trackCompressor");
+  char kit[sizeof(sdStat.currentKit) + 1] = "";
+  if (sdOk) {
+    memcpy(kit, sdStat.currentKit, sizeof(sdStat.currentKit));
+    kit[sizeof(sdStat.currentKit)] = '\0';
+  }
+
+  // Streaming directo a _stateBuf, acotado al tamaño máximo de paquete UDP
+  JsonStreamWriter w(_stateBuf, kUdpMaxPacketBytes);
+  w.beginObject();
+  w.kv("cmd", "state_sync");
+  w.kv("pattern", sequencer.getCurrentPattern());
+  w.kv("playing", sequencer.isPlaying());
+  w.kv("tempo", sequencer.getTempo());
+  w.kv("step", sequencer.getCurrentStep());
+  w.kv("stepCount", sequencer.getPatternLength());
+  w.kv("masterVolume", spiMaster.getMasterVolume());
+  w.kv("sequencerVolume", spiMaster.getSequencerVolume());
+  w.kv("liveVolume", spiMaster.getLiveVolume());
+  w.kv("kit", kit);
+  w.kv("sdPresent", sdOk ? (bool)sdStat.present : false);
+  w.kv("sdLoadedMask", sdLoadedMask);
+
+  w.beginArray("mute");
   for (int track = 0; track < MAX_TRACKS; track++) {
-    trackFilters.add((int)spiMaster.getTrackFilter(track));
-    trackReverbSend.add(spiMaster.getTrackReverbSend(track));
-    trackDelaySend.add(spiMaster.getTrackDelaySend(track));
-    trackChorusSend.add(spiMaster.getTrackChorusSend(track));
-    trackPan.add(spiMaster.getTrackPan(track));
-    trackEcho.add(spiMaster.getTrackEchoActive(track));
-    trackFlanger.add(spiMaster.getTrackFlangerActive(track));
-    trackCompressor.add(spiMaster.getTrackCompressorActive(track));
-  }
-
-  JsonArray samples = doc.createNestedArray("samples");
+    w.value(sequencer.isTrackMuted(track) || spiMaster.getTrackMute(track));
+  }
+  w.endArray();
+  w.beginArray("solo");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(spiMaster.getTrackSolo(track));
+  w.endArray();
+  w.beginArray("trackVolumes");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(sequencer.getTrackVolume(track));
+  w.endArray();
+
+  w.beginObject("fx");
+  w.kv("filterType", gMasterFilterType);
+  w.kv("filterCutoff", gMasterFilterCutoff);
+  w.kv("filterResonance", gMasterFilterResonance);
+  w.kv("distortion", gMasterDistortion);
+  w.kv("bitCrush", gMasterBitCrushBits);
+  w.kv("sampleRate", gMasterSampleRateReduction);
+  w.kv("delayActive", gMasterDelayActive);
+  w.kv("phaserActive", gMasterPhaserActive);
+  w.kv("flangerActive", gMasterFlangerActive);
+  w.kv("compressorActive", gMasterCompressorActive);
+  w.kv("reverbActive", spiMaster.isReverbActive());
+  w.kv("chorusActive", spiMaster.isChorusActive());
+
+  w.beginArray("trackFilters");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value((int)spiMaster.getTrackFilter(track));
+  w.endArray();
+  w.beginArray("trackReverbSend");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(spiMaster.getTrackReverbSend(track));
+  w.endArray();
+  w.beginArray("trackDelaySend");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(spiMaster.getTrackDelaySend(track));
+  w.endArray();
+  w.beginArray("trackChorusSend");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(spiMaster.getTrackChorusSend(track));
+  w.endArray();
+  w.beginArray("trackPan");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(spiMaster.getTrackPan(track));
+  w.endArray();
+  w.beginArray("trackEcho");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(spiMaster.getTrackEchoActive(track));
+  w.endArray();
+  w.beginArray("trackFlanger");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(spiMaster.getTrackFlangerActive(track));
+  w.endArray();
+  w.beginArray("trackCompressor");
+  for (int track = 0; track < MAX_TRACKS; track++) w.value(spiMaster.getTrackCompressorActive(track));
+  w.endArray();
+  w.endObject();
+
+  w.beginArray("samples");
   for (int pad = 0; pad < MAX_PADS; pad++) {
     bool loadedLocal = (pad < MAX_SAMPLES) && sampleManager.isSampleLoaded(pad);
     bool loadedDaisy = (sdLoadedMask & (1UL << pad)) != 0;
     if (!loadedLocal && !loadedDaisy) continue;
-    JsonObject sample = samples.createNestedObject();
-    sample["pad"] = pad;
-    sample["loaded"] = true;
     const char* localName = loadedLocal ? sampleManager.getSampleName(pad) : nullptr;
     const char* daisyName = gDaisyPadFiles[pad];
     const char* name = (localName && localName[0]) ? localName : daisyName;
-    sample["name"] = (name && name[0]) ? name : "";
+    w.beginObject();
+    w.kv("pad", pad);
+    w.kv("loaded", true);
+    w.kv("name", (name && name[0]) ? name : "");
+    w.endObject();
   }
+  w.endArray();
+  w.endObject();
 
-  if (!_stateBuf) _stateBuf = (char*)ps_malloc(kStateBufSize);
-  if (!_stateBuf) return;
-  size_t len = serializeJson(doc, _stateBuf, kUdpMaxPacketBytes);
-  if (len == 0 || len >= kUdpMaxPacketBytes) return;
+  size_t len = w.finish();
+  if (len == 0) return;
   udp.beginPacket(ip, port);
   udp.write((uint8_t*)_stateBuf, len);
   udp.endPacket();
@@ -1967,13 +3066,186 @@ void WebInterface::sendUdpStateSync(IPAddress ip, uint16_t port) {
 }
 
 void WebInterface::broadcastUdpStateSync() {
-  if (udpClients.empty()) return;
+  static constexpr uint8_t kTopics = TOPIC_BIT(TOPIC_TRANSPORT) | TOPIC_BIT(TOPIC_MIXER);
+  if (udpClients.empty() || !topicHasUdp(kTopics)) return;
+
+  // Codificado una vez por broadcast y compartido por todos los slaves binarios
+  const UdpSyncPacket* pkt = nullptr;
+  if (hasUdpSyncBinaryClients(kTopics)) pkt = encodeUdpSyncState();
+#if UDP_SYNC_MULTICAST
+  if (pkt) sendUdpSyncPacket(pkt, IPAddress(UDP_SYNC_MCAST_GROUP), UDP_SYNC_MCAST_PORT);
+#endif
+
   for (auto& entry : udpClients) {
+    if (!(entry.second.topics & kTopics)) continue;
+    if (pkt && entry.second.binProto >= UDP_SYNC_BIN_PROTO) {
+#if !UDP_SYNC_MULTICAST
+      sendUdpSyncPacket(pkt, entry.second.ip, entry.second.port);
+#endif
+      continue;
+    }
     sendUdpStateSync(entry.second.ip, entry.second.port);
     yield();
   }
 }
 
+// ═══════════════════════════════════════════════════════
+// SYNC UDP BINARIO (0xB3, ver UdpSync.h)
+// ═══════════════════════════════════════════════════════
+
+bool WebInterface::hasUdpSyncBinaryClients(uint8_t topics) const {
+  for (const auto& entry : udpClients) {
+    if (entry.second.binProto >= UDP_SYNC_BIN_PROTO && (entry.second.topics & topics)) return true;
+  }
+  return false;
+}
+
+void WebInterface::writeUdpSyncMelody(UdpSyncWriter& w) {
+  w.begin(USYNC_MELODY);
+  w.u8(melodyEngine);
+  w.u8(melodyOctave);
+  w.u8(melodyRecActive ? 1 : 0);
+  w.u8(melodyStep);
+  w.u8(melodyPad);
+  for (int c = 0; c < 16; c++) {
+    uint16_t col = 0;
+    for (int r = 0; r < 12; r++) {
+      if (melodyGrid[c][r]) col |= (1u << r);
+    }
+    w.u16(col);
+  }
+  w.end();
+}
+
+const UdpSyncPacket* WebInterface::encodeUdpSyncState() {
+  UdpSyncPacket* pkt = udpSyncBegin();
+  if (!pkt) return nullptr;
+  UdpSyncWriter w(pkt);
+
+  int pattern = sequencer.getCurrentPattern();
+  int stepCount = sequencer.getPatternLength();
+
+  w.begin(USYNC_TRANSPORT);
+  w.u8((uint8_t)pattern);
+  w.u8(sequencer.isPlaying() ? 1 : 0);
+  w.u8((uint8_t)sequencer.getCurrentStep());
+  w.u8((uint8_t)stepCount);
+  w.u16((uint16_t)(sequencer.getTempo() * 10.0f + 0.5f));
+  w.u8(spiMaster.getMasterVolume());
+  w.u8(spiMaster.getSequencerVolume());
+  w.u8(spiMaster.getLiveVolume());
+  w.end();
+
+  w.begin(USYNC_MIXER);
+  for (int track = 0; track < MAX_TRACKS; track++) {
+    uint8_t flags = 0;
+    if (sequencer.isTrackMuted(track) || spiMaster.getTrackMute(track)) flags |= 0x01;
+    if (spiMaster.getTrackSolo(track))             flags |= 0x02;
+    if (spiMaster.getTrackEchoActive(track))       flags |= 0x04;
+    if (spiMaster.getTrackFlangerActive(track))    flags |= 0x08;
+    if (spiMaster.getTrackCompressorActive(track)) flags |= 0x10;
+    w.u8(flags);
+    w.u8(sequencer.getTrackVolume(track));
+    w.u8((uint8_t)spiMaster.getTrackFilter(track));
+    w.u8(spiMaster.getTrackReverbSend(track));
+    w.u8(spiMaster.getTrackDelaySend(track));
+    w.u8(spiMaster.getTrackChorusSend(track));
+    w.u8((uint8_t)spiMaster.getTrackPan(track));
+  }
+  w.end();
+
+  w.begin(USYNC_MASTER_FX);
+  w.u8((uint8_t)gMasterFilterType);
+  w.u8((uint8_t)gMasterBitCrushBits);
+  uint8_t fxFlags = 0;
+  if (gMasterDelayActive)          fxFlags |= 0x01;
+  if (gMasterPhaserActive)         fxFlags |= 0x02;
+  if (gMasterFlangerActive)        fxFlags |= 0x04;
+  if (gMasterCompressorActive)     fxFlags |= 0x08;
+  if (spiMaster.isReverbActive())  fxFlags |= 0x10;
+  if (spiMaster.isChorusActive())  fxFlags |= 0x20;
+  w.u8(fxFlags);
+  w.u16((uint16_t)gMasterSampleRateReduction);
+  w.f32((float)gMasterFilterCutoff);
+  w.f32((float)gMasterFilterResonance);
+  w.f32((float)gMasterDistortion);
+  w.end();
+
+  SdStatusResponse sdStat = {};
+  bool sdOk = spiMaster.getCachedSdStatus(sdStat);
+  uint32_t sdLoadedMask = sdOk ? sdStat.samplesLoaded : 0;
+  w.begin(USYNC_SAMPLES);
+  w.u8((sdOk && sdStat.present) ? 1 : 0);
+  w.u32(sdLoadedMask);
+  w.str8(sdOk ? sdStat.currentKit : "", sizeof(sdStat.currentKit));
+  uint8_t loadedCount = 0;
+  for (int pad = 0; pad < MAX_PADS; pad++) {
+    bool loadedLocal = (pad < MAX_SAMPLES) && sampleManager.isSampleLoaded(pad);
+    if (loadedLocal || (sdLoadedMask & (1UL << pad))) loadedCount++;
+  }
+  w.u8(loadedCount);
+  for (int pad = 0; pad < MAX_PADS; pad++) {
+    bool loadedLocal = (pad < MAX_SAMPLES) && sampleManager.isSampleLoaded(pad);
+    bool loadedDaisy = (sdLoadedMask & (1UL << pad)) != 0;
+    if (!loadedLocal && !loadedDaisy) continue;
+    const char* localName = loadedLocal ? sampleManager.getSampleName(pad) : nullptr;
+    const char* name = (localName && localName[0]) ? localName : gDaisyPadFiles[pad];
+    w.u8((uint8_t)pad);
+    w.str8(name, 31);   // 16 × 33 B en el peor caso: el paquete sigue < 1 KB
+  }
+  w.end();
+
+  w.begin(USYNC_PATTERN);
+  w.u8((uint8_t)pattern);
+  w.u8((uint8_t)stepCount);
+  for (int track = 0; track < MAX_TRACKS; track++) {
+    uint64_t mask = 0;
+    for (int s = 0; s < STEPS_PER_PATTERN; s++) {
+      if (sequencer.getStep(pattern, track, s)) mask |= (1ULL << s);
+    }
+    w.u64(mask);
+  }
+  w.end();
+
+  writeUdpSyncMelody(w);
+  return w.finish() ? pkt : nullptr;
+}
+
+const UdpSyncPacket* WebInterface::encodeUdpSyncMelody() {
+  UdpSyncPacket* pkt = udpSyncBegin();
+  if (!pkt) return nullptr;
+  UdpSyncWriter w(pkt);
+  writeUdpSyncMelody(w);
+  return w.finish() ? pkt : nullptr;
+}
+
+void WebInterface::sendUdpSyncPacket(const UdpSyncPacket* pkt, IPAddress ip, uint16_t port) {
+  if (!pkt || pkt->len == 0) return;
+  udp.beginPacket(ip, port);
+  udp.write(pkt->data, pkt->len);
+  udp.endPacket();
+}
+
+// {"cmd":"sync_nack","seq":N,"count":K} — el slave detectó un hueco en seq.
+// Reenvía los paquetes aún en el historial; si alguno ya se sobrescribió,
+// un estado completo nuevo lo sustituye (el estado es idempotente).
+void WebInterface::handleUdpSyncNack(const JsonDocument& doc, IPAddress ip, uint16_t port) {
+  uint16_t seq = doc["seq"] | 0;
+  int count = doc["count"] | 1;
+  if (count < 1) count = 1;
+  if (count > UDP_SYNC_HISTORY) count = UDP_SYNC_HISTORY;
+
+  bool missing = false;
+  for (int i = 0; i < count; i++) {
+    uint16_t s = (uint16_t)(seq + i);
+    if (s == 0) s = 1;  // el seq salta el 0
+    const UdpSyncPacket* pkt = udpSyncFind(s);
+    if (pkt) sendUdpSyncPacket(pkt, ip, port);
+    else missing = true;
+  }
+  if (missing) sendUdpStateSync(ip, port);
+}
+
 // v2.9 — Build & send melody_sync packet (engine/octave/rec/step/pad/grid)
 // to a single UDP slave. Used both for broadcast and on-hello replies so any
 // slave that joins/reconnects immediately sees the authoritative melody state.
@@ -1982,6 +3254,15 @@ void WebInterface::melodyClearGrid() {
 }
 
 void WebInterface::sendMelodySyncTo(IPAddress ip, uint16_t port) {
+  UdpClient* uc = findUdpClient(ip);
+  if (uc && uc->binProto >= UDP_SYNC_BIN_PROTO) {
+    const UdpSyncPacket* pkt = encodeUdpSyncMelody();
+    if (pkt) {
+      sendUdpSyncPacket(pkt, ip, port);
+      return;
+    }
+  }
+
   // Compact stack buffer — grid is 16*12=192 chars + JSON overhead < 700 bytes.
   char buf[800];
   int n = snprintf(buf, sizeof(buf),
@@ -2011,7 +3292,7 @@ void WebInterface::sendMelodySyncTo(IPAddress ip, uint16_t port) {
 }
 
 void WebInterface::broadcastMelodySync() {
-  if (udpClients.empty()) return;
+  if (udpClients.empty() || !topicHasUdp(TOPIC_BIT(TOPIC_PATTERN))) return;
   static unsigned long lastLog = 0;
   unsigned long nowMs = millis();
   if (nowMs - lastLog > 5000) {
@@ -2020,7 +3301,19 @@ void WebInterface::broadcastMelodySync() {
                   (unsigned)udpClients.size(), (int)melodyRecActive,
                   melodyEngine, melodyOctave, melodyPad, melodyStep);
   }
+  const UdpSyncPacket* pkt = nullptr;
+  if (hasUdpSyncBinaryClients(TOPIC_BIT(TOPIC_PATTERN))) pkt = encodeUdpSyncMelody();
+#if UDP_SYNC_MULTICAST
+  if (pkt) sendUdpSyncPacket(pkt, IPAddress(UDP_SYNC_MCAST_GROUP), UDP_SYNC_MCAST_PORT);
+#endif
   for (auto& entry : udpClients) {
+    if (!(entry.second.topics & TOPIC_BIT(TOPIC_PATTERN))) continue;
+    if (pkt && entry.second.binProto >= UDP_SYNC_BIN_PROTO) {
+#if !UDP_SYNC_MULTICAST
+      sendUdpSyncPacket(pkt, entry.second.ip, entry.second.port);
+#endif
+      continue;
+    }
     sendMelodySyncTo(entry.second.ip, entry.second.port);
     yield();
   }
@@ -2030,30 +3323,31 @@ void WebInterface::broadcastMelodySync() {
  * known UDP slave. Triggered whenever the active pattern changes via web/UI
  * so the LCD slaves don't show a stale pattern. */
 void WebInterface::broadcastUdpPatternSync(int patternNum) {
-  if (udpClients.empty()) return;
+  if (udpClients.empty() || !topicHasUdp(TOPIC_BIT(TOPIC_PATTERN))) return;
   if (patternNum < 0 || patternNum >= MAX_PATTERNS) return;
   if (ESP.getFreeHeap() < 30000) return;
 
-  PsramJsonDocument response(8192);
-  response["cmd"]       = "pattern_sync";
-  response["pattern"]   = patternNum;
-  response["active"]    = true;   /* hint to slaves: this IS the active pattern */
-  response["stepCount"] = sequencer.getPatternLength();
-
-  JsonArray data = response.createNestedArray("data");
-  for (int t = 0; t < MAX_TRACKS; t++) {
-    JsonArray track = data.createNestedArray();
-    for (int s = 0; s < STEPS_PER_PATTERN; s++) {
-      track.add(sequencer.getStep(patternNum, t, s) ? 1 : 0);
-    }
+  // Slaves con binProto >= 2: frame binario (PatternCodec.h), ~200 B en vez de ~2.5 KB
+  size_t binLen = 0;
+  bool needJson = false;
+  for (auto& entry : udpClients) {
+    if (!(entry.second.topics & TOPIC_BIT(TOPIC_PATTERN))) continue;
+    if (entry.second.binProto < 2) { needJson = true; continue; }
+    if (binLen == 0) binLen = encodePatternFrame(patternNum, PATTERN_BIN_FLAG_ACTIVE);
+    if (binLen == 0) { needJson = true; break; }
+    udp.beginPacket(entry.second.ip, entry.second.port);
+    udp.write((uint8_t*)_patternBuf, binLen);
+    udp.endPacket();
+    yield();
   }
+  if (!needJson) return;
 
-  if (!_patternBuf) _patternBuf = (char*)ps_malloc(kPatternBufSize);
-  if (!_patternBuf) return;
-  size_t jsonLen = serializeJson(response, _patternBuf, kPatternBufSize);
-  if (jsonLen == 0 || jsonLen >= kPatternBufSize) return;
+  size_t jsonLen = buildPatternSyncJson(patternNum, true);
+  if (jsonLen == 0) return;
 
   for (auto& entry : udpClients) {
+    if (!(entry.second.topics & TOPIC_BIT(TOPIC_PATTERN))) continue;
+    if (entry.second.binProto >= 2 && binLen > 0) continue;
     udp.beginPacket(entry.second.ip, entry.second.port);
     udp.write((uint8_t*)_patternBuf, jsonLen);
     udp.endPacket();
@@ -2064,36 +3358,39 @@ void WebInterface::broadcastUdpPatternSync(int patternNum) {
 void WebInterface::sendSequencerStateToClient(AsyncWebSocketClient* client) {
   if (!initialized || !ws || !isClientReady(client)) return;
   
-  // All memory in PSRAM — zero heap allocation
-  if (_stateDoc && _stateBuf) {
-    _stateDoc->clear();
-    populateStateDocument(*_stateDoc);
-    size_t len = serializeJson(*_stateDoc, _stateBuf, kStateBufSize);
-    if (len > 0 && len < kStateBufSize) {
-      client->text(_stateBuf, len);
-    }
-  }
+  // Respuesta explícita (init/getState): siempre llega, aunque sea sólo la cabecera
+  WsClientState* st = findWsClientState(client->id(), false);
+  if (!refreshStateSections(st ? wsTopicStateSections(st->topics) : STATE_SEC_ALL)) return;
+  sendStateToClient(client, st);
 }
 
 void WebInterface::broadcastPadTrigger(int pad) {
   if (!initialized || !ws || ws->count() == 0) return;
   if (ESP.getFreeHeap() < 20000) return;
   
+  if (!topicHasWs(TOPIC_STEPS)) return;
+  
   // Stack buffer — zero heap allocation
   char buf[48];
   int len = snprintf(buf, sizeof(buf), "{\"type\":\"pad\",\"pad\":%d}", pad);
-  ws->textAll(buf, len);
+  wsTextTopic(TOPIC_STEPS, buf, len);
 }
 
 // --- Deferred broadcast flags (written from Core1, consumed by Core0 update) ---
-static volatile int _pendingBroadcastStep = -1;     // -1 = nothing pending
+// El cambio de patrón también llega desde Core0 (songChainPlay vía comando),
+// así que no puede ir por la cola SPSC: se mantiene el slot volatile.
 static volatile int _pendingSongPattern   = -1;     // -1 = nothing pending
 static volatile int _pendingSongLength    = 0;
 
 void WebInterface::broadcastStep(int step) {
   // Called from Core1 (stepChangeCallback) — do NOT touch ws here!
-  // Just set the volatile flag; update() on Core0 will do the actual broadcast.
-  _pendingBroadcastStep = step;
+  // Se encola con timestamp; update() en Core0 agrupa y envía.
+  _seqEvents.push(SEQEV_STEP, (uint8_t)step, (uint8_t)sequencer.getPatternLength(), micros());
+}
+
+void WebInterface::broadcastSeqTrigger(int track, uint8_t velocity) {
+  // Called from Core1 (stepCallback) — una entrada por hit, ratchets incluidos
+  _seqEvents.push(SEQEV_TRIGGER, (uint8_t)track, velocity, micros());
 }
 
 void WebInterface::broadcastSongPattern(int pattern, int songLength) {
@@ -2103,57 +3400,147 @@ void WebInterface::broadcastSongPattern(int pattern, int songLength) {
   _pendingSongPattern = pattern;   // write pattern LAST so consumer sees both
 }
 
-void WebInterface::update() {
-  if (!initialized || !ws || !server) return;
-
-  unsigned long now = millis();
-
-  // ── Deferred sample load — done here (systemTask, Core0) to avoid blocking AsyncWebServer task ──
-  // Note: loadSample calls transferSample() which feeds esp_task_wdt internally
-  int pendPad = _pendingLoadPad;
-  if (pendPad >= 0) {
-    _pendingLoadPad = -1;  // clear flag first
-    esp_task_wdt_reset();  // feed before starting long transfer
+// Vacía la cola de Core1 como mucho cada kSeqEventFrameMs: un frame 0xB4 con
+// todos los eventos (ningún step ni trigger se pierde) para clientes con
+// binProto >= 3; los antiguos reciben el último step en JSON cada 80 ms.
+static constexpr unsigned long kSeqEventFrameMs = 15;
 
-    bool loaded = false;
-    if (_uploadBuf && _uploadBufLen > 0) {
-      loaded = sampleManager.loadSampleFromBuffer(_uploadBuf, _uploadBufLen, pendPad);
+void WebInterface::flushSeqEvents(unsigned long now) {
+  int songPat = _pendingSongPattern;
+  if (songPat < 0 && (_seqEvents.empty() || now - _seqFrameMs < kSeqEventFrameMs)) return;
+
+  // Un hueco reservado para el evento de patrón
+  SeqEvent evs[SEQ_EVENT_MAX_PER_FRAME];
+  size_t n = _seqEvents.pop(evs, SEQ_EVENT_MAX_PER_FRAME - 1);
+  // Cola con más de un frame pendiente: no esperar a la siguiente ventana
+  if (n < SEQ_EVENT_MAX_PER_FRAME - 1) _seqFrameMs = now;
+  uint32_t nowUs = micros();
+  int songLen = _pendingSongLength;
+  if (songPat >= 0) {
+    _pendingSongPattern = -1;
+    evs[n].us = nowUs;
+    evs[n].type = SEQEV_PATTERN;
+    evs[n].a = (uint8_t)songPat;
+    evs[n].b = (uint8_t)songLen;
+    n++;
+  }
+  if (n == 0 || ws->count() == 0) return;
+  // La cola se vacía siempre; sin suscriptores de steps/transport no se codifica nada
+  const bool wantSteps = topicHasWs(TOPIC_STEPS);
+  const bool wantSong = songPat >= 0 && topicHasWs(TOPIC_TRANSPORT);
+  if (!wantSteps && !wantSong) return;
+
+  uint8_t frame[SEQ_EVENT_HEADER_SIZE + SEQ_EVENT_MAX_PER_FRAME * SEQ_EVENT_RECORD_SIZE];
+  uint16_t tempo10 = (uint16_t)(sequencer.getTempo() * 10.0f + 0.5f);
+  frame[0] = SEQ_EVENT_MAGIC;
+  frame[1] = (uint8_t)n;
+  frame[2] = sequencer.isPlaying() ? 0x01 : 0x00;
+  frame[3] = tempo10 & 0xFF;
+  frame[4] = tempo10 >> 8;
+  size_t len = SEQ_EVENT_HEADER_SIZE;
+  int lastStep = -1;
+  bool sawStepZero = false;
+  for (size_t i = 0; wantSteps && i < n; i++) {
+    uint32_t ago = (nowUs - evs[i].us) / 100;
+    if (ago > 0xFFFF) ago = 0xFFFF;
+    frame[len++] = evs[i].type;
+    frame[len++] = evs[i].a;
+    frame[len++] = evs[i].b;
+    frame[len++] = ago & 0xFF;
+    frame[len++] = ago >> 8;
+    if (evs[i].type == SEQEV_STEP) {
+      lastStep = evs[i].a;
+      if (lastStep == 0) sawStepZero = true;
+    }
+  }
+
+  // JSON legacy: mismo throttle que antes (80 ms, el step 0 siempre pasa)
+  char stepJson[32];
+  int stepLen = 0;
+  if (lastStep >= 0 && (now - _legacyStepMs >= 80 || sawStepZero)) {
+    _legacyStepMs = now;
+    stepLen = snprintf(stepJson, sizeof(stepJson), "{\"type\":\"step\",\"step\":%d}", lastStep);
+  }
+  char songJson[80];
+  int songLenJson = 0;
+  if (wantSong) {
+    songLenJson = snprintf(songJson, sizeof(songJson),
+      "{\"type\":\"songPattern\",\"pattern\":%d,\"songLength\":%d}", songPat, songLen);
+  }
+
+  // Steps/triggers se descartan en clientes lentos; el cambio de patrón no
+  uint8_t frameClass = (songPat >= 0) ? WS_FRAME_CRITICAL : WS_FRAME_LIVE;
+  for (auto& st : wsClientStates) {
+    if (st.clientId == 0xFFFFFFFF) continue;
+    AsyncWebSocketClient* c = ws->client(st.clientId);
+    const bool steps = st.topics & TOPIC_BIT(TOPIC_STEPS);
+    const bool song = songLenJson > 0 && (st.topics & TOPIC_BIT(TOPIC_TRANSPORT));
+    if (st.binProto >= 3 && steps) {
+      if (wsAllowSend(st, c, frameClass)) c->binary(frame, len);  // incluye el evento de patrón
+    } else {
+      if (steps && stepLen > 0 && wsAllowSend(st, c, WS_FRAME_LIVE)) c->text(stepJson, stepLen);
+      if (song && wsAllowSend(st, c, WS_FRAME_CRITICAL)) c->text(songJson, songLenJson);
     }
-    // Liberar buffer raw tras la carga (ya decodificado en PSRAM del sampleBuffer)
-    if (_uploadBuf) { free(_uploadBuf); _uploadBuf = nullptr; _uploadBufLen = 0; }
+  }
+}
 
-    esp_task_wdt_reset();  // feed after (transfer may take several seconds)
-    if (loaded) {
-      broadcastUploadComplete(pendPad, true, "Sample uploaded and loaded successfully");
-      broadcastSequencerState();
+// Strike de heap bajo con el perfilador activo: dejar en el log los 3 sitios
+// con más bytes vivos para saber quién retenía memoria antes del reinicio
+static void logTopHeapSites() {
+  if (!heapProfEnabled()) return;
+  HeapSiteStats top[3];
+  uint8_t nTop = 0;
+  uint8_t n = heapProfSiteCount();
+  for (uint8_t i = 0; i < n; i++) {
+    HeapSiteStats st;
+    if (!heapProfSite(i, &st) || st.liveBytes == 0) continue;
+    uint8_t pos = nTop < 3 ? nTop++ : 3;
+    while (pos > 0 && top[pos - 1].liveBytes < st.liveBytes) {
+      if (pos < 3) top[pos] = top[pos - 1];
+      pos--;
+    }
+    if (pos < 3) top[pos] = st;
+  }
+  for (uint8_t i = 0; i < nTop; i++) {
+    if (top[i].tag) {
+      syslog("HEAP", "  site %s live=%u peak=%u n=%u", top[i].tag,
+             top[i].liveBytes, top[i].peakBytes, top[i].allocs - top[i].frees);
     } else {
-      String errDetail = String(sampleManager.getLastParseError());
-      String errMsg = errDetail.length() ? "Failed to load: " + errDetail : "Failed to load sample";
-      broadcastUploadComplete(pendPad, false, errMsg);
+      syslog("HEAP", "  site 0x%08x live=%u peak=%u n=%u", (unsigned)top[i].caller,
+             top[i].liveBytes, top[i].peakBytes, top[i].allocs - top[i].frees);
     }
   }
+}
+
+void WebInterface::update() {
+  if (!initialized || !ws || !server) return;
+
+  unsigned long now = millis();
+
+  // ── Upload en streaming: SPI de lo ya convertido (systemTask, Core0) sin bloquear AsyncWebServer ──
+  pumpUploadStream(now);
+
+  // ── Valores PARAM coalescidos por el límite de entrada ──
+  flushCoalescedParams(now);
 
   // ── Consume deferred broadcasts from Core1 (thread-safe: only ws access from Core0) ──
-  int step = _pendingBroadcastStep;
-  if (step >= 0 && ws->count() > 0) {
-    _pendingBroadcastStep = -1;
-    static unsigned long lastStepBroadcast = 0;
-    if (now - lastStepBroadcast >= 80 || step == 0) {
-      lastStepBroadcast = now;
-      char buf[32];
-      int len = snprintf(buf, sizeof(buf), "{\"type\":\"step\",\"step\":%d}", step);
-      ws->textAll(buf, len);
-    }
+  flushSeqEvents(now);
+
+  // Logs SPI encolados desde Core1 (sólo con suscriptores de "logs")
+  flushSpiLogs();
+
+  // ACKs de comandos con "rid": frames SPI confirmados por Core1 y timeouts
+  flushCmdAcks(now);
+
+  // Prefetch de samples a SampleCache: un fichero por pasada, nunca durante un upload
+  if (_streamPad < 0) {
+    prefetchSongChain(now);
+    sampleManager.prefetchStep();
   }
-  int songPat = _pendingSongPattern;
-  if (songPat >= 0 && ws->count() > 0) {
-    _pendingSongPattern = -1;
-    int songLen = _pendingSongLength;
-    char buf[80];
-    int len = snprintf(buf, sizeof(buf),
-      "{\"type\":\"songPattern\",\"pattern\":%d,\"songLength\":%d}",
-      songPat, songLen);
-    ws->textAll(buf, len);
+
+  // Ecos de edición agrupados: un frame por ventana de kEditEchoWindowMs
+  if (_editEchoCount > 0 && now - _editEchoFirstMs >= kEditEchoWindowMs) {
+    flushEditEchoes();
   }
 
   // Skip periodic broadcasts during page transitions (2s window)
@@ -2162,9 +3549,10 @@ void WebInterface::update() {
     pageTransitionMs = 0;  // clear flag
   }
   
-  // Broadcast audio levels for all WS clients (main UI + /adm)
+  // Broadcast audio levels to "levels" subscribers (main UI + /adm, slaves UDP)
   static unsigned long lastAudioLevels = 0;
-  if (!pageLoading && now - lastAudioLevels >= 150 && ws->count() > 0) {
+  if (!pageLoading && now - lastAudioLevels >= 150 &&
+      (topicHasWs(TOPIC_LEVELS) || topicHasUdp(TOPIC_BIT(TOPIC_LEVELS)))) {
     lastAudioLevels = now;
 
     // Peak data is polled by SPIMaster::process() on Core1 —
@@ -2187,9 +3575,28 @@ void WebInterface::update() {
       if (mp > 1.0f) mp = 1.0f;
       levelBuf[17] = (uint8_t)(mp * 255.0f);
 
-      ws->binaryAll(levelBuf, 18);
+      // Meters: el frame más prescindible. Clientes lentos a 1/3 de la tasa
+      for (auto& st : wsClientStates) {
+        if (st.clientId == 0xFFFFFFFF || !(st.topics & TOPIC_BIT(TOPIC_LEVELS))) continue;
+        if (st.lagLevel == WS_LAG_SLOW && (st.meterTick++ % 3) != 0) continue;
+        AsyncWebSocketClient* c = ws->client(st.clientId);
+        if (wsAllowSend(st, c, WS_FRAME_LIVE)) c->binary(levelBuf, 18);
+      }
+      // Mismo frame por UDP a los slaves suscritos a "levels"
+      for (auto& entry : udpClients) {
+        if (!(entry.second.topics & TOPIC_BIT(TOPIC_LEVELS))) continue;
+        udp.beginPacket(entry.second.ip, entry.second.port);
+        udp.write(levelBuf, 18);
+        udp.endPacket();
+      }
     }
   }
+
+  static unsigned long lastWsLagCheck = 0;
+  if (now - lastWsLagCheck >= kWsLagCheckMs && ws->count() > 0) {
+    lastWsLagCheck = now;
+    assessWsBackpressure(now);
+  }
   
   // Limpiar WebSocket clients desconectados cada 2 segundos
   // Limpiar WebSocket clients desconectados cada segundo
@@ -2200,7 +3607,7 @@ void WebInterface::update() {
   }
 
   // Broadcast estado periódico (15s) — red de seguridad para sample info.
-  // Reducido de 5s a 15s para minimizar heap churn (~13KB por llamada).
+  // Con el snapshot versionado suele ser sólo la cabecera (~100 B por cliente).
   static unsigned long lastPeriodicState = 0;
   if (!pageLoading && ws->count() > 0 && now - lastPeriodicState >= 15000) {
     lastPeriodicState = now;
@@ -2244,10 +3651,16 @@ void WebInterface::update() {
     }
     
     // Safety net: if largest contiguous block stays critically low for
-    // 3 consecutive checks (30s), gracefully restart to avoid total lockup
-    if (maxBlock < 12000) {
+    // 3 consecutive checks (30s), gracefully restart to avoid total lockup.
+    // Desde la segunda lectura baja seguida, un cliente WS atrasado se cierra
+    // antes de sumar strike: liberar su cola es mejor que reiniciar.
+    if (maxBlock < 12000 && lowHeapStrikes >= 1 && kickWorstWsClient()) {
+      syslog("HEAP", "WARNING low block=%u strike=%d/3, ws client dropped",
+             (uint32_t)maxBlock, lowHeapStrikes);
+    } else if (maxBlock < 12000) {
       lowHeapStrikes++;
       syslog("HEAP", "WARNING low block=%u strike=%d/3", (uint32_t)maxBlock, lowHeapStrikes);
+      logTopHeapSites();
       if (lowHeapStrikes >= 3) {
         syslog("HEAP", "CRITICAL restarting due to sustained low heap");
         delay(100);
@@ -2294,93 +3707,230 @@ String WebInterface::getIP() {
   return WiFi.softAPIP().toString();
 }
 
+// Difusión JSON serializada en el slab (sin String intermedio en el heap interno)
+void WebInterface::wsTextAllJson(const JsonDocument& doc) {
+  if (!ws) return;
+  size_t len = measureJson(doc);
+  SlabBuffer buf(len + 1);
+  if (!buf.data()) return;
+  serializeJson(doc, buf.data(), buf.size());
+  ws->textAll(buf.data(), len);
+}
+
+// ═══════════════════════════════════════════════════════
+// INGRESS — token buckets por cliente (IngressLimiter.h)
+// ═══════════════════════════════════════════════════════
+IngressLimiter& WebInterface::wsIngress(uint32_t clientId) {
+  WsClientState* st = findWsClientState(clientId, false);
+  return st ? st->ingress : _ingressFallback;
+}
+
+// Primer campo obligatorio que falta (nullptr = completo)
+static const char* missingRequiredField(const WsCommandInfo& info, JsonVariantConst doc) {
+  uint32_t req = commandRequiredFields(info.id);
+  for (int i = 0; req; i++, req >>= 1) {
+    if ((req & 1u) && !doc.containsKey(kCommandRequiredFieldNames[i])) return kCommandRequiredFieldNames[i];
+  }
+  return nullptr;
+}
+
+IngressVerdict WebInterface::admitCommand(IngressLimiter& lim, uint32_t owner,
+                                          const WsCommandInfo& info, const JsonDocument& doc) {
+  // Antes del bucket: un comando incompleto no gasta token ni llega al handler
+  if (missingRequiredField(info, doc.as<JsonVariantConst>())) return ING_INVALID;
+  IngressClass cls = ingressClassOf(info);
+  if (lim.allow(cls, millis())) return ING_ADMIT;
+  if (cls == ING_PARAM && ingressCoalescePut(owner, info, doc)) return ING_COALESCED;
+  return ING_DROPPED;
+}
+
+// Camino común de las dos tramas WS tras decodificar (JSON de texto o 0xB1):
+// bucket por cliente/clase, campos obligatorios y ACK del "rid". Limitado o
+// incompleto → sin dispatch ni respuesta salvo el ACK (NACK "rate"/"args", o
+// ACK diferido si el PARAM se coalesció). false = no ejecutado.
+bool WebInterface::runWsCommand(AsyncWebSocketClient* client, const WsCommandInfo* info,
+                                const JsonDocument& doc, uint32_t rid, uint32_t rxUs) {
+  const uint32_t owner = client->id();
+  if (!info) {
+    if (rid) cmdAckNow(CMDACK_WS, owner, 0, rid, rxUs, CMDACK_ERR_UNKNOWN, false);
+    return false;
+  }
+  IngressVerdict verdict = admitCommand(wsIngress(owner), owner, *info, doc);
+  if (verdict != ING_ADMIT) {
+    if (rid) cmdAckNow(CMDACK_WS, owner, 0, rid, rxUs,
+                       verdict == ING_DROPPED ? CMDACK_ERR_RATE
+                       : verdict == ING_INVALID ? CMDACK_ERR_ARGS : CMDACK_OK,
+                       verdict == ING_COALESCED);
+    return false;
+  }
+  // CMDF_WS_ONLY: lo responde onWebSocketEvent después
+  const bool dispatch = !(info->flags & CMDF_WS_ONLY);
+  if (rid) {
+    uint8_t tag = cmdAckBegin(CMDACK_WS, owner, 0, rid, rxUs);
+    if (dispatch) dispatchCommand(*info, doc);
+    cmdAckEnd(tag, CMDACK_WS, owner, 0, rid, rxUs);
+  } else if (dispatch) {
+    dispatchCommand(*info, doc);
+  }
+  return true;
+}
+
+// Aplica los PARAM guardados (último valor por knob) a ritmo fijo desde systemTask
+void WebInterface::flushCoalescedParams(unsigned long now) {
+  if (now - _coalesceFlushMs < INGRESS_COALESCE_FLUSH_MS) return;
+  _coalesceFlushMs = now;
+  char json[INGRESS_COALESCE_JSON_MAX];
+  for (int n = 0; n < INGRESS_COALESCE_PER_TICK; n++) {
+    WsCmdId id;
+    if (ingressCoalesceTake(json, sizeof(json), &id) == 0) break;
+    const WsCommandInfo* info = commandById(id);
+    StaticJsonDocument<384> doc;
+    if (!info || deserializeJson(doc, json)) continue;
+    dispatchCommand(*info, doc, true);
+  }
+}
+
 // Procesar comandos JSON (compartido entre WebSocket y UDP)
+// ═══════════════════════════════════════════════════════
+// BATCH DE COMANDOS
+// ═══════════════════════════════════════════════════════
+// Un preset/undo de la UI son decenas de volúmenes, pans, filtros y envíos:
+// aquí se aplican en una pasada. Los frames SPI se acumulan en SPIMaster
+// (setters repetidos → último valor), los ecos van en un solo frame "batch"
+// y el resto de clientes recibe un único delta de estado.
+WebInterface::BatchResult WebInterface::applyBatch(JsonArrayConst cmds, bool atomic) {
+  CmdProfScope profScope(WSC_BATCH);
+  BatchResult r = {};
+  // WS/HTTP (async_tcp) y UDP (systemTask) pueden llegar a la vez: uno cada vez
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  TaskHandle_t expected = nullptr;
+  if (!__atomic_compare_exchange_n(&_batchTask, &expected, self, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+    r.busy = true;
+    return r;
+  }
+
+  flushEditEchoes();   // lo anterior al batch sale antes que sus ecos
+  const bool staged = spiMaster.beginBatch();
+  StaticJsonDocument<512> entry;
+  for (JsonVariantConst v : cmds) {
+    const WsCommandInfo* info = (r.applied < kBatchMaxCmds) ? commandLookup(v["cmd"] | "") : nullptr;
+    if (!info || (info->flags & CMDF_WS_ONLY) || missingRequiredField(*info, v) || !entry.set(v)) {
+      r.skipped++;
+      continue;
+    }
+    // coalesced = true: valores finales de un preset, no un knob en movimiento → sin throttle
+    dispatchCommand(*info, entry, true);
+    r.applied++;
+    r.flags |= info->flags;
+  }
+  // Atómico sólo tiene sentido con el transporte en marcha (si no, no hay step que partir)
+  r.atomic = atomic && staged && sequencer.isPlaying();
+  if (staged) r.spiFrames = spiMaster.endBatch(r.atomic);
+  __atomic_store_n(&_batchTask, (TaskHandle_t)nullptr, __ATOMIC_RELEASE);
+
+  flushEditEchoes();
+  pushStateToClients();
+  return r;
+}
+
+size_t WebInterface::formatBatchAck(char* buf, size_t cap, const BatchResult& r, long id) {
+  char idBuf[20] = "";
+  if (id >= 0) snprintf(idBuf, sizeof(idBuf), "\"id\":%ld,", id);
+  int n = r.busy
+    ? snprintf(buf, cap, "{\"type\":\"batchAck\",%s\"n\":0,\"error\":\"busy\"}", idBuf)
+    : snprintf(buf, cap, "{\"type\":\"batchAck\",%s\"n\":%u,\"skipped\":%u,\"spi\":%u,\"atomic\":%s}",
+               idBuf, r.applied, r.skipped, r.spiFrames, r.atomic ? "true" : "false");
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
+
 void WebInterface::processCommand(const JsonDocument& doc) {
+  // Dispatch O(1): hash del nombre → id (ver CommandTable.h)
+  const WsCommandInfo* info = commandLookup(doc["cmd"] | "");
+  if (!info || (info->flags & CMDF_WS_ONLY)) return;
+  dispatchCommand(*info, doc);
+}
+
+// Ejecuta un comando ya resuelto. doc trae los argumentos (JSON parseado
+// o campos decodificados de un frame binario, ver WsBinaryProtocol.h).
+// Comandos de edición de step cuyo eco va por el batcher sin forzar flush
+static bool isStepEditCommand(WsCmdId id) {
+  switch (id) {
+    case WSC_SET_STEP:
+    case WSC_SET_STEP_VELOCITY:
+    case WSC_SET_STEP_VOLUME_LOCK:
+    case WSC_SET_STEP_PROBABILITY:
+    case WSC_SET_STEP_CUTOFF_LOCK:
+    case WSC_SET_STEP_REVERB_SEND_LOCK:
+    case WSC_SET_STEP_RATCHET:
+    case WSC_SET_STEP_NOTE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void WebInterface::dispatchCommand(const WsCommandInfo& info, const JsonDocument& doc, bool coalesced) {
+  CmdProfScope profScope(info.id);
+
   // ── Heap guard: si queda poca memoria, descartamos el comando ──
   if (ESP.getFreeHeap() < 20000) {
     syslog("CMD", "DROPPED cmd heap=%u", ESP.getFreeHeap());
     return;
   }
 
-  String cmd = doc["cmd"];
-
   static unsigned long lastMasterFxCmdMs = 0;
   static unsigned long lastTrackFxCmdMs[24] = {};
   static unsigned long lastPadFxCmdMs = 0;
   static unsigned long lastVolumeCmdMs = 0;
-  const unsigned long nowCmdMs = millis();
-
-  bool isMasterFxFast =
-    (cmd == "setFilter") ||
-    (cmd == "setFilterCutoff") ||
-    (cmd == "setFilterResonance") ||
-    (cmd == "setBitCrush") ||
-    (cmd == "setDistortion") ||
-    (cmd == "setSampleRate") ||
-    (cmd == "setDelayTime") ||
-    (cmd == "setDelayFeedback") ||
-    (cmd == "setDelayMix") ||
-    (cmd == "setPhaserRate") ||
-    (cmd == "setPhaserDepth") ||
-    (cmd == "setPhaserFeedback") ||
-    (cmd == "setFlangerRate") ||
-    (cmd == "setFlangerDepth") ||
-    (cmd == "setFlangerFeedback") ||
-    (cmd == "setFlangerMix") ||
-    (cmd == "setCompressorThreshold") ||
-    (cmd == "setCompressorRatio") ||
-    (cmd == "setCompressorAttack") ||
-    (cmd == "setCompressorRelease") ||
-    (cmd == "setCompressorMakeupGain");
-
-  bool isTrackFxFast =
-    (cmd == "setTrackFilter") ||
-    (cmd == "setTrackDistortion") ||
-    (cmd == "setTrackBitCrush") ||
-    (cmd == "setTrackEcho") ||
-    (cmd == "setTrackFlanger") ||
-    (cmd == "setTrackCompressor");
-
-  bool isPadFxFast =
-    (cmd == "setPadFilter") ||
-    (cmd == "setPadDistortion") ||
-    (cmd == "setPadBitCrush");
-
-  bool isVolumeFast =
-    (cmd == "setSequencerVolume") ||
-    (cmd == "setLiveVolume") ||
-    (cmd == "setTrackVolume") ||
-    (cmd == "setVolume") ||
-    (cmd == "setLivePitch");
-
-  if (isMasterFxFast) {
-    if (nowCmdMs - lastMasterFxCmdMs < kFastMasterCmdMinMs) return;
-    lastMasterFxCmdMs = nowCmdMs;
-  } else if (isTrackFxFast) {
-    int tIdx = doc.containsKey("track") ? (int)doc["track"] : -1;
-    if (tIdx >= 0 && tIdx < 24) {
-      if (nowCmdMs - lastTrackFxCmdMs[tIdx] < kFastTrackCmdMinMs) return;
-      lastTrackFxCmdMs[tIdx] = nowCmdMs;
-    }
-  } else if (isPadFxFast) {
-    if (nowCmdMs - lastPadFxCmdMs < kFastPadCmdMinMs) return;
-    lastPadFxCmdMs = nowCmdMs;
-  } else if (isVolumeFast) {
-    if (nowCmdMs - lastVolumeCmdMs < kFastVolumeCmdMinMs) return;
-    lastVolumeCmdMs = nowCmdMs;
+
+  // Un valor coalescido es el último del knob: no puede perderse en el throttle
+  if ((info.flags & CMDF_FAST_MASK) && !coalesced) {
+    const unsigned long nowCmdMs = millis();
+    if (info.flags & CMDF_FAST_MASTER) {
+      if (nowCmdMs - lastMasterFxCmdMs < kFastMasterCmdMinMs) return;
+      lastMasterFxCmdMs = nowCmdMs;
+    } else if (info.flags & CMDF_FAST_TRACK) {
+      int tIdx = doc.containsKey("track") ? (int)doc["track"] : -1;
+      if (tIdx >= 0 && tIdx < 24) {
+        if (nowCmdMs - lastTrackFxCmdMs[tIdx] < kFastTrackCmdMinMs) return;
+        lastTrackFxCmdMs[tIdx] = nowCmdMs;
+      }
+    } else if (info.flags & CMDF_FAST_PAD) {
+      if (nowCmdMs - lastPadFxCmdMs < kFastPadCmdMinMs) return;
+      lastPadFxCmdMs = nowCmdMs;
+    } else if (info.flags & CMDF_FAST_VOLUME) {
+      if (nowCmdMs - lastVolumeCmdMs < kFastVolumeCmdMinMs) return;
+      lastVolumeCmdMs = nowCmdMs;
+    }
   }
-  
-  if (cmd == "hello" || cmd == "get_state" || cmd == "getState") {
-    return;
+
+  // Ecos pendientes antes de cualquier comando que no sea edición rápida, para
+  // que p.ej. un stepSet no llegue después del patrón nuevo de un selectPattern.
+  // Dentro de un batch se acumulan y salen en un solo frame al final.
+  if (!(info.flags & CMDF_FAST_MASK) && !isStepEditCommand(info.id) && !inBatch()) {
+    flushEditEchoes();
   }
-  else if (cmd == "trigger") {
+
+  // Snapshot de estado: los comandos rápidos sólo tocan mixer/FX; el resto puede
+  // tocar cualquier sección (el hash evita subir versión si nada cambió)
+  if (!(info.flags & CMDF_WS_ONLY)) {
+    markStateDirty((info.flags & CMDF_FAST_MASK) ? (STATE_SEC_MIXER | STATE_SEC_FX) : STATE_SEC_ALL);
+  }
+
+  switch (info.id) {
+  case WSC_HELLO:
+  case WSC_GET_STATE_LEGACY:
+  case WSC_GET_STATE: {
+    return;
+  } break;
+  case WSC_TRIGGER: {
     int pad = doc["pad"];
     if (pad < 0 || pad >= 24) return;  // 16 sequencer + 8 XTRA
     int velocity = doc.containsKey("vel") ? doc["vel"].as<int>() : 127;
     triggerPadWithLED(pad, velocity);
     broadcastPadTrigger(pad);
-  }
-  else if (cmd == "setStep") {
+  } break;
+  case WSC_SET_STEP: {
     int track = doc["track"];
     int step = doc["step"];
     if (track < 0 || track >= MAX_TRACKS || step < 0 || step >= STEPS_PER_PATTERN) return;
@@ -2416,40 +3966,37 @@ void WebInterface::processCommand(const JsonDocument& doc) {
         resp["step"] = step;
         resp["active"] = active;
         resp["noteLen"] = noteLen;
-        String out; serializeJson(resp, out);
-        if (ws) ws->textAll(out);
+        queueEditEcho(resp);
       }
       yield();
     }
-  }
-  else if (cmd == "start") {
+  } break;
+  case WSC_START: {
     sequencer.start();
     dsqUploadPatternDeferred(sequencer.getCurrentPattern());
     spiMaster.dsqControl(1);
     StaticJsonDocument<96> resp;
     resp["type"] = "playState";
     resp["playing"] = true;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "stop") {
+    wsTextAllJson(resp);
+  } break;
+  case WSC_STOP: {
     sequencer.stop();
     spiMaster.dsqControl(0);
     StaticJsonDocument<96> resp;
     resp["type"] = "playState";
     resp["playing"] = false;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "clearPattern") {
+    wsTextAllJson(resp);
+  } break;
+  case WSC_CLEAR_PATTERN: {
     int pattern = doc.containsKey("pattern") ? doc["pattern"].as<int>() : sequencer.getCurrentPattern();
     sequencer.clearPattern(pattern);
     yield();
     char buf[64];
     int blen = snprintf(buf, sizeof(buf), "{\"type\":\"patternCleared\",\"pattern\":%d}", pattern);
     if (ws && ws->count() > 0) ws->textAll(buf, blen);
-  }
-  else if (cmd == "clearPatterns") {
+  } break;
+  case WSC_CLEAR_PATTERNS: {
     // Bulk clear: {cmd:"clearPatterns", from:0, to:99}
     int from = doc.containsKey("from") ? doc["from"].as<int>() : 0;
     int to   = doc.containsKey("to")   ? doc["to"].as<int>()   : from;
@@ -2466,25 +4013,24 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       "{\"type\":\"patternsCleared\",\"from\":%d,\"to\":%d}", from, to);
     if (ws && ws->count() > 0) ws->textAll(buf, blen);
     syslog("CMD", "clearPatterns DONE heap=%u", ESP.getFreeHeap());
-  }
-  else if (cmd == "setSongMode") {
+  } break;
+  case WSC_SET_SONG_MODE: {
     bool enabled = doc["enabled"];
     int length = doc.containsKey("length") ? doc["length"].as<int>() : 1;
     sequencer.setSongLength(length);
     sequencer.setSongMode(enabled);
     broadcastSequencerState();
-  }
-  else if (cmd == "tempo") {
+  } break;
+  case WSC_TEMPO: {
     float tempo = doc["value"];
     sequencer.setTempo(tempo);
     spiMaster.setTempo(tempo);
     StaticJsonDocument<96> resp;
     resp["type"] = "tempoChange";
     resp["tempo"] = tempo;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setStepCount") {
+    wsTextAllJson(resp);
+  } break;
+  case WSC_SET_STEP_COUNT: {
     int count = doc["count"];
     if (count == 16 || count == 32 || count == 64) {
       sequencer.setPatternLength(count);
@@ -2492,11 +4038,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       StaticJsonDocument<96> resp;
       resp["type"] = "stepCount";
       resp["count"] = count;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      wsTextAllJson(resp);
     }
-  }
-  else if (cmd == "selectPattern") {
+  } break;
+  case WSC_SELECT_PATTERN: {
     int pattern = doc["index"];
     syslog("CMD", "selPat idx=%d heap=%u", pattern, ESP.getFreeHeap());
     sequencer.selectPattern(pattern);
@@ -2509,104 +4054,31 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       broadcastSequencerState();
       yield();
     } else if (ESP.getFreeHeap() > 35000) {
-      StaticJsonDocument<128> minState;
-      minState["type"] = "patternSelected";
-      minState["pattern"] = pattern;
-      String ms; serializeJson(minState, ms);
-      if (ws) ws->textAll(ms);
-    }
-    syslog("CMD", "selPat bcast done heap=%u", ESP.getFreeHeap());
-    
-    if (ESP.getFreeHeap() < 30000) {
-      syslog("CMD", "selPat SKIP pattern JSON (low heap)");
-      return;
-    }
-    yield();
-    int stepCount = sequencer.getPatternLength();
-    PsramJsonDocument patternDoc(stepCount > 16 ? 32768 : 14336);
-    patternDoc["type"] = "pattern";
-    patternDoc["index"] = pattern;
-    patternDoc["stepCount"] = stepCount;
-    
-    for (int track = 0; track < 16; track++) {
-      JsonArray trackSteps = patternDoc.createNestedArray(String(track));
-      for (int step = 0; step < stepCount; step++) {
-        trackSteps.add(sequencer.getStep(track, step));
-      }
-    }
-    
-    JsonObject velocitiesObj = patternDoc.createNestedObject("velocities");
-    for (int track = 0; track < 16; track++) {
-      JsonArray trackVels = velocitiesObj.createNestedArray(String(track));
-      for (int step = 0; step < stepCount; step++) {
-        trackVels.add(sequencer.getStepVelocity(track, step));
-      }
-    }
-
-    JsonObject volumeLocksObj = patternDoc.createNestedObject("volumeLocks");
-    for (int track = 0; track < 16; track++) {
-      JsonArray trackLocks = volumeLocksObj.createNestedArray(String(track));
-      for (int step = 0; step < stepCount; step++) {
-        if (sequencer.hasStepVolumeLock(track, step)) {
-          trackLocks.add(sequencer.getStepVolumeLock(track, step));
-        } else {
-          trackLocks.add(-1);
-        }
-      }
-    }
-
-    JsonObject probabilitiesObj = patternDoc.createNestedObject("probabilities");
-    for (int track = 0; track < 16; track++) {
-      JsonArray trackProb = probabilitiesObj.createNestedArray(String(track));
-      for (int step = 0; step < stepCount; step++) {
-        trackProb.add(sequencer.getStepProbability(track, step));
-      }
-    }
-
-    JsonObject ratchetsObj = patternDoc.createNestedObject("ratchets");
-    for (int track = 0; track < 16; track++) {
-      JsonArray trackRat = ratchetsObj.createNestedArray(String(track));
-      for (int step = 0; step < stepCount; step++) {
-        trackRat.add(sequencer.getStepRatchet(track, step));
-      }
+      StaticJsonDocument<128> minState;
+      minState["type"] = "patternSelected";
+      minState["pattern"] = pattern;
+      wsTextAllJson(minState);
     }
-
-    JsonObject cutoffLocksObj = patternDoc.createNestedObject("cutoffLocks");
-    for (int track = 0; track < 16; track++) {
-      JsonArray trackLocks = cutoffLocksObj.createNestedArray(String(track));
-      for (int step = 0; step < stepCount; step++) {
-        if (sequencer.hasStepCutoffLock(track, step)) {
-          trackLocks.add((int)sequencer.getStepCutoffLock(track, step));
-        } else {
-          trackLocks.add(-1);
-        }
-      }
+    syslog("CMD", "selPat bcast done heap=%u", ESP.getFreeHeap());
+    
+    // Clientes con binProto >= 2 reciben el frame binario; JSON sólo si queda alguno antiguo
+    if (!broadcastPatternBinary(pattern)) {
+      syslog("CMD", "selPat DONE (bin) heap=%u", ESP.getFreeHeap());
+      return;
     }
-
-    JsonObject reverbLocksObj = patternDoc.createNestedObject("reverbLocks");
-    for (int track = 0; track < 16; track++) {
-      JsonArray trackLocks = reverbLocksObj.createNestedArray(String(track));
-      for (int step = 0; step < stepCount; step++) {
-        if (sequencer.hasStepReverbSendLock(track, step)) {
-          trackLocks.add((int)sequencer.getStepReverbSendLock(track, step));
-        } else {
-          trackLocks.add(-1);
-        }
-      }
+    if (ESP.getFreeHeap() < 30000) {
+      syslog("CMD", "selPat SKIP pattern JSON (low heap)");
+      return;
     }
-    
-    // Serialize to PSRAM buffer to avoid String heap fragmentation
-    if (!_patternBuf) _patternBuf = (char*)ps_malloc(kPatternBufSize);
-    if (_patternBuf) {
-      size_t len = serializeJson(patternDoc, _patternBuf, kPatternBufSize);
-      syslog("CMD", "selPat JSON len=%u heap=%u", (unsigned)len, ESP.getFreeHeap());
-      if (len > 0 && len < kPatternBufSize && ws && ws->count() > 0) {
-        ws->textAll(_patternBuf, len);
-      }
+    yield();
+    size_t len = buildPatternJson(pattern, sequencer.getPatternLength(), false);
+    syslog("CMD", "selPat JSON len=%u heap=%u", (unsigned)len, ESP.getFreeHeap());
+    if (len > 0 && ws && ws->count() > 0) {
+      textToJsonPatternClients(_patternBuf, len, pattern);
     }
     syslog("CMD", "selPat DONE heap=%u", ESP.getFreeHeap());
-  }
-  else if (cmd == "loadSample") {
+  } break;
+  case WSC_LOAD_SAMPLE: {
     const char* family   = doc["family"];
     const char* filename = doc["filename"];
     int padIndex = doc["pad"];
@@ -2622,6 +4094,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     // preserved and reloads on reboot ("sin machacar el antiguo").
     String fullPath = String("/") + String(family) + "/" + String(filename);
     bool ok = sampleManager.loadSample(fullPath.c_str(), padIndex);
+    // Fichero añadido/borrado desde la última build del índice: corregir su entrada
+    sampleIndexRefresh(family, filename);
+    // Audición en el navegador: lo siguiente suele ser el vecino de la lista
+    if (ok) sampleManager.prefetchNeighbours(family, filename);
 
     if (ok) {
       // Apply trim markers if the user dragged the waveform start/end
@@ -2641,13 +4117,37 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       responseDoc["format"]   = detectSampleFormat(filename);
       responseDoc["quality"]  = "LittleFS";
 
-      String output;
-      serializeJson(responseDoc, output);
-      if (ws) ws->textAll(output);
-    }
-  }
+      wsTextTopicJson(TOPIC_SAMPLES, responseDoc);
+    }
+  } break;
+  // === Calidad del resampler (WAVs que no están a 44.1 kHz) ===
+  // quality: "fast" | "medium" | "high" o 0-2. Afecta a las cargas siguientes
+  case WSC_SET_RESAMPLE_QUALITY: {
+    int q = -1;
+    if (doc["quality"].is<const char*>()) {
+      const char* name = doc["quality"];
+      for (int i = 0; i < RS_Q_COUNT; i++) {
+        if (strcmp(name, resampleQualityName((ResampleQuality)i)) == 0) q = i;
+      }
+    } else if (doc["quality"].is<int>()) {
+      q = doc["quality"];
+    }
+    if (q < 0 || q >= RS_Q_COUNT) return;
+    sampleManager.setResampleQuality((ResampleQuality)q);
+    syslog("CMD", "resampleQuality=%s", resampleQualityName((ResampleQuality)q));
+  } break;
+  // === Presupuesto de SampleCache (PCM convertido en PSRAM) ===
+  // budgetKb: 0 = desactivada (vacía la caché y para el prefetch)
+  case WSC_SET_SAMPLE_CACHE: {
+    if (!doc.containsKey("budgetKb")) return;
+    long kb = doc["budgetKb"];
+    if (kb < 0) kb = 0;
+    if (kb > 6 * 1024) kb = 6 * 1024;   // 8 MB de PSRAM: dejar sitio a pads y patrones
+    sampleCacheSetBudget((uint32_t)kb * 1024);
+    syslog("CMD", "sampleCache budget=%ldKB", kb);
+  } break;
   // === Trim already-loaded sample ===
-  else if (cmd == "trimSample") {
+  case WSC_TRIM_SAMPLE: {
     int padIndex = doc["pad"];
     float trimStart = doc.containsKey("trimStart") ? (float)doc["trimStart"] : 0.0f;
     float trimEnd = doc.containsKey("trimEnd") ? (float)doc["trimEnd"] : 1.0f;
@@ -2658,57 +4158,41 @@ void WebInterface::processCommand(const JsonDocument& doc) {
         responseDoc["pad"] = padIndex;
         responseDoc["size"] = sampleManager.getSampleLength(padIndex) * 2;
         responseDoc["samples"] = sampleManager.getSampleLength(padIndex);
-        String output;
-        serializeJson(responseDoc, output);
-        if (ws) ws->textAll(output);
+        wsTextTopicJson(TOPIC_SAMPLES, responseDoc);
       }
     }
-  }
+  } break;
   // === XTRA PADS: list samples from /xtra folder ===
-  else if (cmd == "getXtraSamples") {
+  case WSC_GET_XTRA_SAMPLES: {
     StaticJsonDocument<2048> responseDoc;
     responseDoc["type"] = "xtraSampleList";
     
-    File dir = LittleFS.open("/xtra", "r");
-    if (dir && dir.isDirectory()) {
-      JsonArray samples = responseDoc.createNestedArray("samples");
-      File file = dir.openNextFile();
-      int count = 0;
-      while (file) {
-        if (!file.isDirectory()) {
-          String filename = file.name();
-          int lastSlash = filename.lastIndexOf('/');
-          if (lastSlash >= 0) filename = filename.substring(lastSlash + 1);
-          
-          if (isSupportedSampleFile(filename)) {
-            JsonObject sampleObj = samples.createNestedObject();
-            sampleObj["name"] = filename;
-            sampleObj["size"] = file.size();
-            count++;
-            if (count % 3 == 0) yield();
-          }
-        }
-        file.close();
-        file = dir.openNextFile();
+    JsonArray samples = responseDoc.createNestedArray("samples");
+    const SampleIndexEntry* entries;
+    uint16_t count;
+    // El doc enlaza los nombres del índice: lock hasta serializar
+    sampleIndexLock(UINT32_MAX);
+    if (sampleIndexFolder("xtra", &entries, &count)) {
+      for (uint16_t i = 0; i < count; i++) {
+        JsonObject sampleObj = samples.createNestedObject();
+        sampleObj["name"] = (const char*)entries[i].name;
+        sampleObj["size"] = entries[i].size;
       }
-      dir.close();
-    } else {
-      // Create /xtra if it doesn't exist
-      LittleFS.mkdir("/xtra");
-      responseDoc.createNestedArray("samples");
+    } else if (!LittleFS.exists("/xtra")) {
+      LittleFS.mkdir("/xtra");   // carpeta de usuario aún no creada
     }
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
+    wsTextAllJson(responseDoc);
+    sampleIndexUnlock();
+  } break;
   // === XTRA PADS: load sample from /xtra to a pad ===
-  else if (cmd == "loadXtraSample") {
+  case WSC_LOAD_XTRA_SAMPLE: {
     const char* filename = doc["filename"];
     int padIndex = doc["pad"];
     if (padIndex < 16 || padIndex >= 24) return;
 
     String fullPath = String("/xtra/") + String(filename);
+    if (filename) sampleIndexRefresh("xtra", filename);
     yield();
 
     // Notificar al cliente que empieza la transferencia SPI a la Daisy
@@ -2716,8 +4200,7 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       StaticJsonDocument<128> tDoc;
       tDoc["type"] = "xtraTransferring";
       tDoc["pad"]  = padIndex;
-      String tOut; serializeJson(tDoc, tOut);
-      if (ws) ws->textAll(tOut);
+      wsTextTopicJson(TOPIC_SAMPLES, tDoc);
     }
 
     if (sampleManager.loadSample(fullPath.c_str(), padIndex)) {
@@ -2727,16 +4210,14 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       responseDoc["pad"]      = padIndex;
       responseDoc["filename"] = filename;
       responseDoc["size"]     = sampleManager.getSampleLength(padIndex) * 2;
-      String output; serializeJson(responseDoc, output);
-      if (ws) ws->textAll(output);
+      wsTextTopicJson(TOPIC_SAMPLES, responseDoc);
 
       // También enviamos sampleLoaded para compatibilidad con waveform cache etc.
       responseDoc["type"] = "sampleLoaded";
-      output = ""; serializeJson(responseDoc, output);
-      if (ws) ws->textAll(output);
+      wsTextTopicJson(TOPIC_SAMPLES, responseDoc);
     }
-  }
-  else if (cmd == "mute") {
+  } break;
+  case WSC_MUTE: {
     int track = doc["track"];
     if (track < 0 || track >= 16) return;
     yield();
@@ -2747,11 +4228,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     muteDoc["type"] = "trackMuted";
     muteDoc["track"] = track;
     muteDoc["muted"] = muted;
-    String muteOutput;
-    serializeJson(muteDoc, muteOutput);
-    if (ws) ws->textAll(muteOutput);
-  }
-  else if (cmd == "solo") {
+    wsTextAllJson(muteDoc);
+  } break;
+  case WSC_SOLO: {
     int track = doc["track"];
     if (track < 0 || track >= 16) return;
     bool solo = doc["value"];
@@ -2760,11 +4239,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     soloDoc["type"] = "trackSolo";
     soloDoc["track"] = track;
     soloDoc["solo"] = solo;
-    String soloOutput;
-    serializeJson(soloDoc, soloOutput);
-    if (ws) ws->textAll(soloOutput);
-  }
-  else if (cmd == "toggleLoop") {
+    wsTextAllJson(soloDoc);
+  } break;
+  case WSC_TOGGLE_LOOP: {
     int track = doc["track"];
     if (track < 0 || track >= 24) return;
     yield();
@@ -2785,9 +4262,7 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       responseDoc["paused"] = false;
       responseDoc["loopType"] = 0;
       
-      String output;
-      serializeJson(responseDoc, output);
-      if (ws) ws->textAll(output);
+      wsTextAllJson(responseDoc);
     } else {
       // Sequencer tracks (0-15): step-based loop via Sequencer
       if (doc.containsKey("loopType")) {
@@ -2813,13 +4288,11 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       responseDoc["paused"] = sequencer.isLoopPaused(track);
       responseDoc["loopType"] = (int)sequencer.getLoopType(track);
       
-      String output;
-      serializeJson(responseDoc, output);
-      if (ws) ws->textAll(output);
+      wsTextAllJson(responseDoc);
     }
     yield();
-  }
-  else if (cmd == "setLoopType") {
+  } break;
+  case WSC_SET_LOOP_TYPE: {
     int track = doc["track"];
     int lt = doc["loopType"];
     if (track < 0 || track >= 16) return;
@@ -2833,12 +4306,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["paused"] = sequencer.isLoopPaused(track);
     responseDoc["loopType"] = lt;
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
+    wsTextAllJson(responseDoc);
     yield();
-  }
-  else if (cmd == "pauseLoop") {
+  } break;
+  case WSC_PAUSE_LOOP: {
     int track = doc["track"];
     if (track < 0 || track >= 16) return;
     sequencer.pauseLoop(track);
@@ -2849,347 +4320,305 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["active"] = sequencer.isLooping(track);
     responseDoc["paused"] = sequencer.isLoopPaused(track);
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setLedMonoMode") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_SET_LED_MONO_MODE: {
     bool monoMode = doc["value"];
     setLedMonoMode(monoMode);
     StaticJsonDocument<96> resp;
     resp["type"] = "ledMode"; resp["mono"] = monoMode;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setFilter") {
+    wsTextAllJson(resp);
+  } break;
+  case WSC_SET_FILTER: {
     int type = doc["type"];
     gMasterFilterType = type;
     spiMaster.setFilterType((FilterType)type);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "filterType"; resp["value"] = type;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setFilterCutoff") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_FILTER_CUTOFF: {
     float cutoff = doc["value"];
     gMasterFilterCutoff = cutoff;
     spiMaster.setFilterCutoff(cutoff);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "filterCutoff"; resp["value"] = cutoff;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setFilterResonance") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_FILTER_RESONANCE: {
     float resonance = doc["value"];
     gMasterFilterResonance = resonance;
     spiMaster.setFilterResonance(resonance);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "filterResonance"; resp["value"] = resonance;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setBitCrush") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_BIT_CRUSH: {
     int bits = doc["value"];
     gMasterBitCrushBits = bits;
     spiMaster.setBitDepth(bits);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "bitCrush"; resp["value"] = bits;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setDistortion") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_DISTORTION: {
     float amount = doc["value"];
     gMasterDistortion = amount;
     spiMaster.setDistortion(amount);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "distortion"; resp["value"] = amount;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setDistortionMode") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_DISTORTION_MODE: {
     int mode = doc["value"];
     spiMaster.setDistortionMode((DistortionMode)mode);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "distortionMode"; resp["value"] = mode;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setSampleRate") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_SAMPLE_RATE: {
     int rate = doc["value"];
     gMasterSampleRateReduction = rate;
     spiMaster.setSampleRateReduction(rate);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "sampleRate"; resp["value"] = rate;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
+    queueEditEcho(resp);
+  } break;
   // ============= NEW: Master Effects Commands =============
-  else if (cmd == "setDelayActive") {
+  case WSC_SET_DELAY_ACTIVE: {
     bool active = doc["value"];
     gMasterDelayActive = active;
     spiMaster.setDelayActive(active);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "delayActive"; resp["value"] = active;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setDelayTime") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_DELAY_TIME: {
     float ms = doc["value"];
     spiMaster.setDelayTime(ms);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "delayTime"; resp["value"] = ms;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setDelayFeedback") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_DELAY_FEEDBACK: {
     float fb = doc["value"];
     spiMaster.setDelayFeedback(fb / 100.0f);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "delayFeedback"; resp["value"] = fb;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setDelayMix") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_DELAY_MIX: {
     float mix = doc["value"];
     spiMaster.setDelayMix(mix / 100.0f);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "delayMix"; resp["value"] = mix;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setPhaserActive") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_PHASER_ACTIVE: {
     bool active = doc["value"];
     gMasterPhaserActive = active;
     spiMaster.setPhaserActive(active);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "phaserActive"; resp["value"] = active;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setPhaserRate") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_PHASER_RATE: {
     float rate = doc["value"];
     spiMaster.setPhaserRate(rate / 100.0f);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "phaserRate"; resp["value"] = rate;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setPhaserDepth") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_PHASER_DEPTH: {
     float depth = doc["value"];
     spiMaster.setPhaserDepth(depth / 100.0f);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "phaserDepth"; resp["value"] = depth;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setPhaserFeedback") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_PHASER_FEEDBACK: {
     float fb = doc["value"];
     spiMaster.setPhaserFeedback(fb / 100.0f);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "phaserFeedback"; resp["value"] = fb;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setFlangerActive") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_FLANGER_ACTIVE: {
     bool active = doc["value"];
     gMasterFlangerActive = active;
     spiMaster.setFlangerActive(active);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "flangerActive"; resp["value"] = active;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setFlangerRate") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_FLANGER_RATE: {
     float rate = doc["value"];
     spiMaster.setFlangerRate(rate / 100.0f);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "flangerRate"; resp["value"] = rate;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setFlangerDepth") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_FLANGER_DEPTH: {
     float depth = doc["value"];
     spiMaster.setFlangerDepth(depth / 100.0f);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "flangerDepth"; resp["value"] = depth;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setFlangerFeedback") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_FLANGER_FEEDBACK: {
     float fb = doc["value"];
     spiMaster.setFlangerFeedback(fb / 100.0f);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "flangerFeedback"; resp["value"] = fb;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setFlangerMix") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_FLANGER_MIX: {
     float mix = doc["value"];
     spiMaster.setFlangerMix(mix / 100.0f);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "flangerMix"; resp["value"] = mix;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setCompressorActive") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_COMPRESSOR_ACTIVE: {
     bool active = doc["value"];
     gMasterCompressorActive = active;
     spiMaster.setCompressorActive(active);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "compressorActive"; resp["value"] = active;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setCompressorThreshold") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_COMPRESSOR_THRESHOLD: {
     float thresh = doc["value"];
     spiMaster.setCompressorThreshold(thresh);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "compressorThreshold"; resp["value"] = thresh;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setCompressorRatio") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_COMPRESSOR_RATIO: {
     float ratio = doc["value"];
     spiMaster.setCompressorRatio(ratio);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "compressorRatio"; resp["value"] = ratio;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setCompressorAttack") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_COMPRESSOR_ATTACK: {
     float attack = doc["value"];
     spiMaster.setCompressorAttack(attack);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "compressorAttack"; resp["value"] = attack;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setCompressorRelease") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_COMPRESSOR_RELEASE: {
     float release = doc["value"];
     spiMaster.setCompressorRelease(release);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "compressorRelease"; resp["value"] = release;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setCompressorMakeupGain") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_COMPRESSOR_MAKEUP_GAIN: {
     float gain = doc["value"];
     spiMaster.setCompressorMakeupGain(gain);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "compressorMakeupGain"; resp["value"] = gain;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setReverbActive") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_REVERB_ACTIVE: {
     bool active = doc["value"];
     spiMaster.setReverbActive(active);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "reverbActive"; resp["value"] = active;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setReverbFeedback") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_REVERB_FEEDBACK: {
     float v = doc["value"];
     float feedback = (v > 1.0f) ? (v / 100.0f) : v;
     spiMaster.setReverbFeedback(feedback);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "reverbFeedback"; resp["value"] = feedback;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setReverbLpFreq") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_REVERB_LP_FREQ: {
     float hz = doc["value"];
     spiMaster.setReverbLpFreq(hz);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "reverbLpFreq"; resp["value"] = hz;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setReverbMix") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_REVERB_MIX: {
     float v = doc["value"];
     float mix = (v > 1.0f) ? (v / 100.0f) : v;
     spiMaster.setReverbMix(mix);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "reverbMix"; resp["value"] = mix;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setChorusActive") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_CHORUS_ACTIVE: {
     bool active = doc["value"];
     spiMaster.setChorusActive(active);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "chorusActive"; resp["value"] = active;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setChorusRate") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_CHORUS_RATE: {
     float rate = doc["value"];
     spiMaster.setChorusRate(rate);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "chorusRate"; resp["value"] = rate;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setChorusDepth") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_CHORUS_DEPTH: {
     float v = doc["value"];
     float depth = (v > 1.0f) ? (v / 100.0f) : v;
     spiMaster.setChorusDepth(depth);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "chorusDepth"; resp["value"] = depth;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setChorusMix") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_CHORUS_MIX: {
     float v = doc["value"];
     float mix = (v > 1.0f) ? (v / 100.0f) : v;
     spiMaster.setChorusMix(mix);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "chorusMix"; resp["value"] = mix;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setTremoloActive") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_TREMOLO_ACTIVE: {
     bool active = doc["value"];
     spiMaster.setTremoloActive(active);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "tremoloActive"; resp["value"] = active;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setTremoloRate") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_TREMOLO_RATE: {
     float rate = doc["value"];
     spiMaster.setTremoloRate(rate);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "tremoloRate"; resp["value"] = rate;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setTremoloDepth") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_TREMOLO_DEPTH: {
     float v = doc["value"];
     float depth = (v > 1.0f) ? (v / 100.0f) : v;
     spiMaster.setTremoloDepth(depth);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "tremoloDepth"; resp["value"] = depth;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setWavefolderGain") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_WAVEFOLDER_GAIN: {
     float gain = doc["value"];
     spiMaster.setWaveFolderGain(gain);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "wavefolderGain"; resp["value"] = gain;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setLimiterActive") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_LIMITER_ACTIVE: {
     bool active = doc["value"];
     spiMaster.setLimiterActive(active);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "limiterActive"; resp["value"] = active;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setTrackReverbSend") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_SET_TRACK_REVERB_SEND: {
     int track = doc["track"];
     int level = doc["value"];
     if (track >= 0 && track < 16) {
@@ -3199,11 +4628,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["track"] = track;
       resp["fx"] = "reverbSend";
       resp["value"] = constrain(level, 0, 100);
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackDelaySend") {
+  } break;
+  case WSC_SET_TRACK_DELAY_SEND: {
     int track = doc["track"];
     int level = doc["value"];
     if (track >= 0 && track < 16) {
@@ -3213,11 +4641,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["track"] = track;
       resp["fx"] = "delaySend";
       resp["value"] = constrain(level, 0, 100);
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackChorusSend") {
+  } break;
+  case WSC_SET_TRACK_CHORUS_SEND: {
     int track = doc["track"];
     int level = doc["value"];
     if (track >= 0 && track < 16) {
@@ -3227,11 +4654,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["track"] = track;
       resp["fx"] = "chorusSend";
       resp["value"] = constrain(level, 0, 100);
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackPan") {
+  } break;
+  case WSC_SET_TRACK_PAN: {
     int track = doc["track"];
     int pan = doc["value"];
     if (track >= 0 && track < 16) {
@@ -3241,11 +4667,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["track"] = track;
       resp["fx"] = "pan";
       resp["value"] = constrain(pan, -100, 100);
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackDspMute") {
+  } break;
+  case WSC_SET_TRACK_DSP_MUTE: {
     int track = doc["track"];
     bool mute = doc["value"];
     if (track >= 0 && track < 16) {
@@ -3256,11 +4681,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["track"] = track;
       resp["fx"] = "dspMute";
       resp["value"] = mute;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackSolo") {
+  } break;
+  case WSC_SET_TRACK_SOLO: {
     int track = doc["track"];
     bool solo = doc["value"];
     if (track >= 0 && track < 16) {
@@ -3270,11 +4694,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["track"] = track;
       resp["fx"] = "solo";
       resp["value"] = solo;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackPhaser") {
+  } break;
+  case WSC_SET_TRACK_PHASER: {
     int track = doc["track"];
     if (track >= 0 && track < 16) {
       bool active = doc.containsKey("active") ? doc["active"].as<bool>() : true;
@@ -3290,11 +4713,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["rate"] = rate;
       resp["depth"] = depth;
       resp["feedback"] = feedback;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackTremolo") {
+  } break;
+  case WSC_SET_TRACK_TREMOLO: {
     int track = doc["track"];
     if (track >= 0 && track < 16) {
       bool active = doc.containsKey("active") ? doc["active"].as<bool>() : true;
@@ -3312,11 +4734,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["depth"] = depth;
       resp["wave"] = wave;
       resp["target"] = target;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackPitch") {
+  } break;
+  case WSC_SET_TRACK_PITCH: {
     int track = doc["track"];
     int cents = doc["value"];
     if (track >= 0 && track < 16) {
@@ -3326,11 +4747,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["track"] = track;
       resp["fx"] = "pitchCents";
       resp["value"] = constrain(cents, -1200, 1200);
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackGate") {
+  } break;
+  case WSC_SET_TRACK_GATE: {
     int track = doc["track"];
     if (track >= 0 && track < 16) {
       bool active = doc.containsKey("active") ? doc["active"].as<bool>() : true;
@@ -3346,11 +4766,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["threshold"] = threshold;
       resp["attack"] = attack;
       resp["release"] = release;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackEq") {
+  } break;
+  case WSC_SET_TRACK_EQ: {
     int track = doc["track"];
     if (track >= 0 && track < 16) {
       int low = doc.containsKey("low") ? doc["low"].as<int>() : 0;
@@ -3364,33 +4783,32 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["low"] = constrain(low, -12, 12);
       resp["mid"] = constrain(mid, -12, 12);
       resp["high"] = constrain(high, -12, 12);
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackEqLow") {
+  } break;
+  case WSC_SET_TRACK_EQ_LOW: {
     int track = doc["track"];
     int value = doc["value"];
     if (track >= 0 && track < 16) {
       spiMaster.setTrackEqLow(track, (int8_t)constrain(value, -12, 12));
     }
-  }
-  else if (cmd == "setTrackEqMid") {
+  } break;
+  case WSC_SET_TRACK_EQ_MID: {
     int track = doc["track"];
     int value = doc["value"];
     if (track >= 0 && track < 16) {
       spiMaster.setTrackEqMid(track, (int8_t)constrain(value, -12, 12));
     }
-  }
-  else if (cmd == "setTrackEqHigh") {
+  } break;
+  case WSC_SET_TRACK_EQ_HIGH: {
     int track = doc["track"];
     int value = doc["value"];
     if (track >= 0 && track < 16) {
       spiMaster.setTrackEqHigh(track, (int8_t)constrain(value, -12, 12));
     }
-  }
+  } break;
   // ============= Per-Pad / Per-Track FX Commands =============
-  else if (cmd == "setPadDistortion") {
+  case WSC_SET_PAD_DISTORTION: {
     int pad = doc["pad"];
     float amount = doc["amount"];
     int mode = doc.containsKey("mode") ? (int)doc["mode"] : 0;
@@ -3402,11 +4820,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["fx"] = "distortion";
       resp["amount"] = amount;
       resp["mode"] = mode;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setPadBitCrush") {
+  } break;
+  case WSC_SET_PAD_BIT_CRUSH: {
     int pad = doc["pad"];
     int bits = doc["value"];
     if (pad >= 0 && pad < 24) {
@@ -3416,22 +4833,20 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["pad"] = pad;
       resp["fx"] = "bitcrush";
       resp["value"] = bits;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "clearPadFX") {
+  } break;
+  case WSC_CLEAR_PAD_FX: {
     int pad = doc["pad"];
     if (pad >= 0 && pad < 24) {
       spiMaster.clearPadFX(pad);
       StaticJsonDocument<96> resp;
       resp["type"] = "padFxCleared";
       resp["pad"] = pad;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      wsTextAllJson(resp);
     }
-  }
-  else if (cmd == "setTrackDistortion") {
+  } break;
+  case WSC_SET_TRACK_DISTORTION: {
     int track = doc["track"];
     float amount = doc["amount"];
     int mode = doc.containsKey("mode") ? (int)doc["mode"] : 0;
@@ -3443,11 +4858,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["fx"] = "distortion";
       resp["amount"] = amount;
       resp["mode"] = mode;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackBitCrush") {
+  } break;
+  case WSC_SET_TRACK_BIT_CRUSH: {
     int track = doc["track"];
     int bits = doc["value"];
     if (track >= 0 && track < 16) {
@@ -3457,23 +4871,21 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["track"] = track;
       resp["fx"] = "bitcrush";
       resp["value"] = bits;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "clearTrackFX") {
+  } break;
+  case WSC_CLEAR_TRACK_FX: {
     int track = doc["track"];
     if (track >= 0 && track < 16) {
       spiMaster.clearTrackFX(track);
       StaticJsonDocument<96> resp;
       resp["type"] = "trackFxCleared";
       resp["track"] = track;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      wsTextAllJson(resp);
     }
-  }
+  } break;
   // ============= REVERSE Command =============
-  else if (cmd == "setReverse") {
+  case WSC_SET_REVERSE: {
     bool value = doc["value"];
     StaticJsonDocument<128> resp;
     resp["type"] = "trackFxUpdate";
@@ -3484,21 +4896,19 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       if (track >= 0 && track < 16) {
         spiMaster.setReverseSample(track, value);
         resp["track"] = track;
-        String out; serializeJson(resp, out);
-        if (ws) ws->textAll(out);
+        wsTextAllJson(resp);
       }
     } else if (doc.containsKey("pad")) {
       int pad = doc["pad"];
       if (pad >= 0 && pad < 24) {
         spiMaster.setReverseSample(pad, value);
         resp["pad"] = pad;
-        String out; serializeJson(resp, out);
-        if (ws) ws->textAll(out);
+        wsTextAllJson(resp);
       }
     }
-  }
+  } break;
   // ============= PITCH SHIFT Command =============
-  else if (cmd == "setPitchShift") {
+  case WSC_SET_PITCH_SHIFT: {
     float value = doc["value"];
     StaticJsonDocument<128> resp;
     resp["type"] = "trackFxUpdate";
@@ -3509,21 +4919,19 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       if (track >= 0 && track < 16) {
         spiMaster.setTrackPitchShift(track, value);
         resp["track"] = track;
-        String out; serializeJson(resp, out);
-        if (ws) ws->textAll(out);
+        wsTextAllJson(resp);
       }
     } else if (doc.containsKey("pad")) {
       int pad = doc["pad"];
       if (pad >= 0 && pad < 24) {
         spiMaster.setTrackPitchShift(pad, value);
         resp["pad"] = pad;
-        String out; serializeJson(resp, out);
-        if (ws) ws->textAll(out);
+        wsTextAllJson(resp);
       }
     }
-  }
+  } break;
   // ============= STUTTER Command =============
-  else if (cmd == "setStutter") {
+  case WSC_SET_STUTTER: {
     bool value = false;
     if (doc.containsKey("value")) {
       value = doc["value"].as<bool>();
@@ -3541,21 +4949,19 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       if (track >= 0 && track < 16) {
         spiMaster.setStutter(track, value, interval);
         resp["track"] = track;
-        String out; serializeJson(resp, out);
-        if (ws) ws->textAll(out);
+        wsTextAllJson(resp);
       }
     } else if (doc.containsKey("pad")) {
       int pad = doc["pad"];
       if (pad >= 0 && pad < 24) {
         spiMaster.setStutter(pad, value, interval);
         resp["pad"] = pad;
-        String out; serializeJson(resp, out);
-        if (ws) ws->textAll(out);
+        wsTextAllJson(resp);
       }
     }
-  }
+  } break;
   // ============= PER-TRACK LIVE FX (SLAVE Controller) =============
-  else if (cmd == "setTrackEcho") {
+  case WSC_SET_TRACK_ECHO: {
     int track = doc["track"];
     if (track >= 0 && track < 16) {
       float time, feedback, mix;
@@ -3582,11 +4988,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["time"] = time;
       resp["feedback"] = feedback;
       resp["mix"] = mix;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackFlanger") {
+  } break;
+  case WSC_SET_TRACK_FLANGER: {
     int track = doc["track"];
     if (track >= 0 && track < 16) {
       float rate, depth, feedback;
@@ -3612,11 +5017,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["rate"] = rate;
       resp["depth"] = depth;
       resp["feedback"] = feedback;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setTrackCompressor") {
+  } break;
+  case WSC_SET_TRACK_COMPRESSOR: {
     int track = doc["track"];
     if (track >= 0 && track < 16) {
       float threshold, ratio;
@@ -3639,11 +5043,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["active"] = spiMaster.getTrackCompressorActive(track);
       resp["threshold"] = threshold;
       resp["ratio"] = ratio;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setSidechainPro") {
+  } break;
+  case WSC_SET_SIDECHAIN_PRO: {
     bool active = doc.containsKey("active") ? doc["active"].as<bool>() : true;
     int source = doc.containsKey("source") ? doc["source"].as<int>() : 0;
     float amountPct = doc.containsKey("amount") ? doc["amount"].as<float>() : 50.0f;
@@ -3671,10 +5074,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     resp["attack"] = attackMs;
     resp["release"] = releaseMs;
     resp["knee"] = knee;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "clearTrackLiveFX") {
+    wsTextAllJson(resp);
+  } break;
+  case WSC_CLEAR_TRACK_LIVE_FX: {
     int track = doc["track"];
     if (track >= 0 && track < 16) {
       spiMaster.clearTrackLiveFX(track);
@@ -3683,11 +5085,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["track"] = track;
       resp["fx"] = "cleared";
       resp["active"] = false;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setSequencerVolume") {
+  } break;
+  case WSC_SET_SEQUENCER_VOLUME: {
     int volume = constrain((int)doc["value"], 0, 150);
     spiMaster.setSequencerVolume(volume);
     
@@ -3696,11 +5097,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["type"] = "state";
     responseDoc["sequencerVolume"] = volume;
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setLiveVolume") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_SET_LIVE_VOLUME: {
     int volume = constrain((int)doc["value"], 0, 150);
     spiMaster.setLiveVolume(volume);
     
@@ -3709,36 +5108,31 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["type"] = "state";
     responseDoc["liveVolume"] = volume;
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setVolume") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_SET_VOLUME: {
     int volume = doc["value"];
     spiMaster.setMasterVolume(volume);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "volume"; resp["value"] = volume;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "stopAllSounds") {
+    queueEditEcho(resp);
+  } break;
+  case WSC_STOP_ALL_SOUNDS: {
     spiMaster.stopAll();
     StaticJsonDocument<64> resp;
     resp["type"] = "allStopped";
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
-  else if (cmd == "setLivePitch") {
+    wsTextAllJson(resp);
+  } break;
+  case WSC_SET_LIVE_PITCH: {
     float pitch = doc["pitch"].as<float>();
     pitch = constrain(pitch, 0.25f, 3.0f);
     spiMaster.setLivePitchShift(pitch);
     StaticJsonDocument<96> resp;
     resp["type"] = "masterFx"; resp["param"] = "livePitch"; resp["value"] = pitch;
-    String out; serializeJson(resp, out);
-    if (ws) ws->textAll(out);
-  }
+    queueEditEcho(resp);
+  } break;
   // ============= NEW: Per-Track Filter Commands =============
-  else if (cmd == "setTrackFilter") {
+  case WSC_SET_TRACK_FILTER: {
     int track = doc["track"];
     if (track < 0 || track >= 16) {
       return;
@@ -3760,11 +5154,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["cutoff"] = (int)cutoff;
     responseDoc["resonance"] = resonance;
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "clearTrackFilter") {
+    queueEditEcho(responseDoc);
+  } break;
+  case WSC_CLEAR_TRACK_FILTER: {
     int track = doc["track"];
     if (track < 0 || track >= 16) {
       return;
@@ -3777,12 +5169,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["track"] = track;
     responseDoc["activeFilters"] = spiMaster.getActiveTrackFiltersCount();
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
+    wsTextAllJson(responseDoc);
+  } break;
   // ============= NEW: Per-Pad Filter Commands =============
-  else if (cmd == "setPadFilter") {
+  case WSC_SET_PAD_FILTER: {
     int pad = doc["pad"];
     if (pad < 0 || pad >= 24) {
       return;
@@ -3801,11 +5191,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["success"] = success;
     responseDoc["activeFilters"] = spiMaster.getActivePadFiltersCount();
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "clearPadFilter") {
+    queueEditEcho(responseDoc);
+  } break;
+  case WSC_CLEAR_PAD_FILTER: {
     int pad = doc["pad"];
     if (pad < 0 || pad >= 24) {
       return;
@@ -3818,11 +5206,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["pad"] = pad;
     responseDoc["activeFilters"] = spiMaster.getActivePadFiltersCount();
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "getFilterPresets") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_GET_FILTER_PRESETS: {
     // Return list of available filter presets
     StaticJsonDocument<512> responseDoc;
     responseDoc["type"] = "filterPresets";
@@ -3838,12 +5224,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       preset["gain"] = fp->gain;
     }
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
+    wsTextAllJson(responseDoc);
+  } break;
   // ============= NEW: Step Velocity Commands =============
-  else if (cmd == "setStepVelocity") {
+  case WSC_SET_STEP_VELOCITY: {
     int track = doc["track"];
     int step = doc["step"];
     int velocity = doc["velocity"];
@@ -3884,12 +5268,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       responseDoc["step"] = step;
       responseDoc["velocity"] = velocity;
       
-      String output;
-      serializeJson(responseDoc, output);
-      if (ws) ws->textAll(output);
+      queueEditEcho(responseDoc);
     }
-  }
-  else if (cmd == "getStepVelocity") {
+  } break;
+  case WSC_GET_STEP_VELOCITY: {
     int track = doc["track"];
     int step = doc["step"];
     
@@ -3902,11 +5284,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["step"] = step;
     responseDoc["velocity"] = velocity;
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setStepVolumeLock") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_SET_STEP_VOLUME_LOCK: {
     int track = doc["track"];
     int step = doc["step"];
     bool enabled = doc.containsKey("enabled") ? doc["enabled"].as<bool>() : true;
@@ -3931,11 +5311,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["step"] = step;
     responseDoc["enabled"] = enabled;
     responseDoc["volume"] = constrain(volume, 0, 150);
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setStepProbability") {
+    queueEditEcho(responseDoc);
+  } break;
+  case WSC_SET_STEP_PROBABILITY: {
     int track = doc["track"];
     int step = doc["step"];
     int probability = doc.containsKey("probability") ? doc["probability"].as<int>() : 100;
@@ -3966,11 +5344,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["track"] = track;
     responseDoc["step"] = step;
     responseDoc["probability"] = constrain(probability, 0, 100);
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setStepCutoffLock") {
+    queueEditEcho(responseDoc);
+  } break;
+  case WSC_SET_STEP_CUTOFF_LOCK: {
     int track = doc["track"];
     int step = doc["step"];
     bool enabled = doc.containsKey("enabled") ? doc["enabled"].as<bool>() : true;
@@ -3995,11 +5371,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["step"] = step;
     responseDoc["enabled"] = enabled;
     responseDoc["cutoff"] = constrain(cutoff, 20, 20000);
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setStepReverbSendLock") {
+    queueEditEcho(responseDoc);
+  } break;
+  case WSC_SET_STEP_REVERB_SEND_LOCK: {
     int track = doc["track"];
     int step = doc["step"];
     bool enabled = doc.containsKey("enabled") ? doc["enabled"].as<bool>() : true;
@@ -4024,11 +5398,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["step"] = step;
     responseDoc["enabled"] = enabled;
     responseDoc["value"] = constrain(level, 0, 100);
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setStepRatchet") {
+    queueEditEcho(responseDoc);
+  } break;
+  case WSC_SET_STEP_RATCHET: {
     int track = doc["track"];
     int step = doc["step"];
     int ratchet = doc.containsKey("ratchet") ? doc["ratchet"].as<int>() : 1;
@@ -4048,11 +5420,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["track"] = track;
     responseDoc["step"] = step;
     responseDoc["ratchet"] = constrain(ratchet, 1, 4);
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setStepNote") {
+    queueEditEcho(responseDoc);
+  } break;
+  case WSC_SET_STEP_NOTE: {
     int track = doc["track"];
     int step = doc["step"];
     int note = doc.containsKey("note") ? doc["note"].as<int>() : 0;
@@ -4110,11 +5480,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
         outVoices.add(sequencer.getStepNoteVoice(respPattern, track, step, voice));
       }
       if (flags >= 0) resp["flags"] = flags;
-      String out; serializeJson(resp, out);
-      if (ws) ws->textAll(out);
+      queueEditEcho(resp);
     }
-  }
-  else if (cmd == "setHumanize") {
+  } break;
+  case WSC_SET_HUMANIZE: {
     int timing = doc.containsKey("timing") ? doc["timing"].as<int>() : 0;
     int velocity = doc.containsKey("velocity") ? doc["velocity"].as<int>() : 0;
     sequencer.setHumanize(timing, velocity);
@@ -4123,11 +5492,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["type"] = "humanizeSet";
     responseDoc["timing"] = sequencer.getHumanizeTimingMs();
     responseDoc["velocity"] = sequencer.getHumanizeVelocityAmount();
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "getStepVolumeLock") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_GET_STEP_VOLUME_LOCK: {
     int track = doc["track"];
     int step = doc["step"];
     if (track < 0 || track >= MAX_TRACKS || step < 0 || step >= STEPS_PER_PATTERN) return;
@@ -4141,11 +5508,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["step"] = step;
     responseDoc["enabled"] = enabled;
     responseDoc["volume"] = volume;
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "getStepCutoffLock") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_GET_STEP_CUTOFF_LOCK: {
     int track = doc["track"];
     int step = doc["step"];
     if (track < 0 || track >= MAX_TRACKS || step < 0 || step >= STEPS_PER_PATTERN) return;
@@ -4159,11 +5524,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["step"] = step;
     responseDoc["enabled"] = enabled;
     responseDoc["cutoff"] = cutoff;
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "getStepReverbSendLock") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_GET_STEP_REVERB_SEND_LOCK: {
     int track = doc["track"];
     int step = doc["step"];
     if (track < 0 || track >= MAX_TRACKS || step < 0 || step >= STEPS_PER_PATTERN) return;
@@ -4177,42 +5540,35 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["step"] = step;
     responseDoc["enabled"] = enabled;
     responseDoc["value"] = level;
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "get_pattern") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_GET_PATTERN_SYNC: {
     int patternNum = doc.containsKey("pattern") ? doc["pattern"].as<int>() : sequencer.getCurrentPattern();
     
     if (patternNum < 0 || patternNum >= MAX_PATTERNS) return;
 
-    PsramJsonDocument response(8192);
-    response["cmd"] = "pattern_sync";
-    response["pattern"] = patternNum;
-    response["stepCount"] = sequencer.getPatternLength();
-    
-    JsonArray data = response.createNestedArray("data");
-    for (int t = 0; t < MAX_TRACKS; t++) {
-      JsonArray track = data.createNestedArray();
-      for (int s = 0; s < STEPS_PER_PATTERN; s++) {
-        track.add(sequencer.getStep(patternNum, t, s) ? 1 : 0);
+    UdpClient* requester = findUdpClient(udp.remoteIP());
+    if (requester && requester->binProto >= 2) {
+      size_t binLen = encodePatternFrame(patternNum, 0);
+      if (binLen > 0) {
+        udp.beginPacket(udp.remoteIP(), udp.remotePort());
+        udp.write((uint8_t*)_patternBuf, binLen);
+        udp.endPacket();
+        return;
       }
     }
-    
+
     // Enviar UDP de vuelta al slave (solo si es una petición UDP)
     if (udp.remoteIP() != IPAddress(0, 0, 0, 0)) {
-      if (!_patternBuf) _patternBuf = (char*)ps_malloc(kPatternBufSize);
-      if (!_patternBuf) return;
-      size_t jsonLen = serializeJson(response, _patternBuf, kPatternBufSize);
-      if (jsonLen == 0 || jsonLen >= kPatternBufSize) return;
+      size_t jsonLen = buildPatternSyncJson(patternNum, false);
+      if (jsonLen == 0) return;
       udp.beginPacket(udp.remoteIP(), udp.remotePort());
       udp.write((uint8_t*)_patternBuf, jsonLen);
       udp.endPacket();
-      
     }
-  }
+  } break;
   // ============= NEW: Track Volume Commands =============
-  else if (cmd == "setTrackVolume") {
+  case WSC_SET_TRACK_VOLUME: {
     int track = doc["track"];
     int volume = constrain((int)doc["volume"], 0, 150);
     if (track < 0 || track >= 16) {
@@ -4228,11 +5584,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["track"] = track;
     responseDoc["volume"] = volume;
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "getTrackVolume") {
+    queueEditEcho(responseDoc);
+  } break;
+  case WSC_GET_TRACK_VOLUME: {
     int track = doc["track"];
     
     uint8_t volume = sequencer.getTrackVolume(track);
@@ -4243,11 +5597,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     responseDoc["track"] = track;
     responseDoc["volume"] = volume;
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "getTrackVolumes") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_GET_TRACK_VOLUMES: {
     // Send all track volumes
     StaticJsonDocument<256> responseDoc;
     responseDoc["type"] = "trackVolumes";
@@ -4257,11 +5609,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       volumes.add(sequencer.getTrackVolume(track));
     }
     
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setTrackSynthEngine") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_SET_TRACK_SYNTH_ENGINE: {
     int track = doc["track"];
     int engine = doc["engine"];
     syslog("CMD", "setEngine trk=%d eng=%d heap=%u", track, engine, ESP.getFreeHeap());
@@ -4289,8 +5639,8 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       track, engine);
     if (ws && ws->count() > 0) ws->textAll(buf, len);
     syslog("CMD", "setEngine DONE trk=%d eng=%d heap=%u", track, engine, ESP.getFreeHeap());
-  }
-  else if (cmd == "applyKitToAllPads") {
+  } break;
+  case WSC_APPLY_KIT_TO_ALL_PADS: {
     int engine = doc["engine"];
     syslog("CMD", "applyKitToAllPads engine=%d heap=%u", engine, ESP.getFreeHeap());
     if (engine < -1 || engine > 6) {
@@ -4326,11 +5676,9 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       engines.add((int)gTrackSynthEngine[track]);
     }
 
-    String output;
-    serializeJson(responseDoc, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setMidiScan") {
+    wsTextAllJson(responseDoc);
+  } break;
+  case WSC_SET_MIDI_SCAN: {
     bool enabled = doc["enabled"];
     if (midiController) {
       midiController->setScanEnabled(enabled);
@@ -4338,36 +5686,30 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       StaticJsonDocument<128> responseDoc;
       responseDoc["type"] = "midiScan";
       responseDoc["enabled"] = enabled;
-      String output;
-      serializeJson(responseDoc, output);
-      if (ws) ws->textAll(output);
+      wsTextAllJson(responseDoc);
     }
-  }
+  } break;
   // ══════════════════════════════════════════════════════
   // DAISY SD CARD COMMANDS
   // ══════════════════════════════════════════════════════
-  else if (cmd == "sdListKits") {
+  case WSC_SD_LIST_KITS: {
     SdKitListResponse kitList;
     if (spiMaster.sdGetKitList(kitList)) {
-      DynamicJsonDocument resp(2048);
+      SlabJsonDocument resp(2048);
       resp["type"] = "sdKitList";
       JsonArray kits = resp.createNestedArray("kits");
       for (int i = 0; i < kitList.count && i < 16; i++) {
         kits.add(String(kitList.kits[i]));
       }
-      String output;
-      serializeJson(resp, output);
-      if (ws) ws->textAll(output);
+      wsTextAllJson(resp);
     } else {
       StaticJsonDocument<128> resp;
       resp["type"] = "sdKitList";
       resp["error"] = "SPI timeout";
-      String output;
-      serializeJson(resp, output);
-      if (ws) ws->textAll(output);
+      wsTextAllJson(resp);
     }
-  }
-  else if (cmd == "sdLoadKit") {
+  } break;
+  case WSC_SD_LOAD_KIT: {
     const char* kit = doc["kit"];
     if (kit) {
       uint8_t startPad = doc.containsKey("startPad") ? doc["startPad"].as<uint8_t>() : 0;
@@ -4380,22 +5722,18 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["type"] = "sdLoadKitAck";
       resp["kit"] = kit;
       resp["ok"] = ok;
-      String output;
-      serializeJson(resp, output);
-      if (ws) ws->textAll(output);
+      wsTextAllJson(resp);
     }
-  }
-  else if (cmd == "sdUnloadKit") {
+  } break;
+  case WSC_SD_UNLOAD_KIT: {
     spiMaster.sdUnloadKit();
     clearDaisyPadFiles();
     StaticJsonDocument<64> resp;
     resp["type"] = "sdUnloadKitAck";
     resp["ok"] = true;
-    String output;
-    serializeJson(resp, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "sdLoadSample") {
+    wsTextAllJson(resp);
+  } break;
+  case WSC_SD_LOAD_SAMPLE: {
     int pad = doc["pad"];
     const char* folder = doc["folder"];
     const char* file   = doc["file"];
@@ -4413,31 +5751,27 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["file"] = file;
       resp["size"] = info.sizeBytes;
       resp["ok"]   = ok;
-      String output;
-      serializeJson(resp, output);
-      if (ws) ws->textAll(output);
+      wsTextAllJson(resp);
     }
-  }
-  else if (cmd == "sdListFolders") {
+  } break;
+  case WSC_SD_LIST_FOLDERS: {
     SdFolderListResponse folders;
     if (spiMaster.sdListFolders(folders)) {
-      DynamicJsonDocument resp(2048);
+      SlabJsonDocument resp(2048);
       resp["type"] = "sdFolderList";
       JsonArray arr = resp.createNestedArray("folders");
       for (int i = 0; i < folders.count && i < 16; i++) {
         arr.add(String(folders.names[i]));
       }
-      String output;
-      serializeJson(resp, output);
-      if (ws) ws->textAll(output);
+      wsTextAllJson(resp);
     }
-  }
-  else if (cmd == "sdListFiles") {
+  } break;
+  case WSC_SD_LIST_FILES: {
     const char* folder = doc["folder"];
     if (folder) {
       SdFileListResponse files;
       if (spiMaster.sdListFiles(folder, files)) {
-        DynamicJsonDocument resp(4096);
+        SlabJsonDocument resp(4096);
         resp["type"] = "sdFileList";
         resp["folder"] = folder;
         JsonArray arr = resp.createNestedArray("files");
@@ -4446,13 +5780,11 @@ void WebInterface::processCommand(const JsonDocument& doc) {
           f["name"] = String(files.files[i].name);
           f["size"] = files.files[i].sizeBytes;
         }
-        String output;
-        serializeJson(resp, output);
-        if (ws) ws->textAll(output);
+        wsTextAllJson(resp);
       }
     }
-  }
-  else if (cmd == "sdGetStatus") {
+  } break;
+  case WSC_SD_GET_STATUS: {
     SdStatusResponse sdStat;
     if (spiMaster.getCachedSdStatus(sdStat)) {
       clearDaisyPadFilesNotInMask(sdStat.samplesLoaded);
@@ -4468,21 +5800,17 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       resp["loaded"]    = loadedCount;
       resp["loadedMask"] = sdStat.samplesLoaded;
       resp["kit"]       = String(sdStat.currentKit);
-      String output;
-      serializeJson(resp, output);
-      if (ws) ws->textAll(output);
+      wsTextAllJson(resp);
     }
-  }
-  else if (cmd == "sdAbort") {
+  } break;
+  case WSC_SD_ABORT: {
     spiMaster.sdAbortLoad();
     StaticJsonDocument<64> resp;
     resp["type"] = "sdAbortAck";
     resp["ok"]   = true;
-    String output;
-    serializeJson(resp, output);
-    if (ws) ws->textAll(output);
-  }
-  else if (cmd == "setDaisyPerfStress") {
+    wsTextAllJson(resp);
+  } break;
+  case WSC_SET_DAISY_PERF_STRESS: {
     bool enabled = doc["enabled"] | false;
     bool resetMetrics = doc["resetMetrics"] | false;
     bool ok = spiMaster.setPerformanceStressMode(enabled, resetMetrics);
@@ -4492,58 +5820,56 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     resp["enabled"] = spiMaster.isPerformanceStressMode();
     resp["cpu"] = spiMaster.getCpuLoad();
     resp["cpuPeak"] = spiMaster.getCpuPeak();
-    String output;
-    serializeJson(resp, output);
-    if (ws) ws->textAll(output);
-  }
+    wsTextAllJson(resp);
+  } break;
   // ══════════════════════════════════════════════════════
   // SYNTH ENGINES — TR-808/909/505 + TB-303 + WTOSC + SH-101 + FM2Op
   // ══════════════════════════════════════════════════════
 
   // {"cmd":"synthTrigger","engine":0,"instrument":0,"velocity":100}
-  else if (cmd == "synthTrigger") {
+  case WSC_SYNTH_TRIGGER: {
     uint8_t engine     = doc["engine"]     | 0;
     uint8_t instrument = doc["instrument"] | 0;
     uint8_t velocity   = doc["velocity"]   | 100;
     float scaled = (velocity / 127.0f) * (spiMaster.getLiveVolume() / 100.0f);
     uint8_t outVelocity = (uint8_t)constrain((int)roundf(scaled * 127.0f), 1, 127);
     spiMaster.synthTrigger(engine, instrument, outVelocity);
-  }
+  } break;
 
   // {"cmd":"synthParam","engine":0,"instrument":0,"paramId":0,"value":0.5}
-  else if (cmd == "synthParam") {
+  case WSC_SYNTH_PARAM: {
     uint8_t engine     = doc["engine"]     | 0;
     uint8_t instrument = doc["instrument"] | 0;
     uint8_t paramId    = doc["paramId"]    | 0;
     float   value      = doc["value"]      | 0.5f;
     spiMaster.synthParam(engine, instrument, paramId, value);
-  }
+  } break;
 
   // {"cmd":"setWtNote","track":0,"note":60}
-  else if (cmd == "setWtNote") {
+  case WSC_SET_WT_NOTE: {
     int track = doc["track"] | 0;
     int note  = doc["note"]  | 60;
     if (track >= 0 && track < 16)
       spiMaster.synthParam(4, (uint8_t)track, 8, (float)note);
-  }
+  } break;
 
   // {"cmd":"synth303NoteOn","note":48,"accent":false,"slide":false}
-  else if (cmd == "synth303NoteOn") {
+  case WSC_SYNTH303_NOTE_ON: {
     uint8_t note   = doc["note"]   | 36;
     bool    accent = doc["accent"] | false;
     bool    slide  = doc["slide"]  | false;
     spiMaster.synth303NoteOn(note, accent, slide);
-  }
+  } break;
 
   // {"cmd":"synthNoteOnEx","engine":4,"note":60,"velocity":100,"accent":false,"slide":false}
-  else if (cmd == "synthNoteOnEx") {
+  case WSC_SYNTH_NOTE_ON_EX: {
     uint8_t engine   = doc["engine"]   | 3;
     uint8_t note     = doc["note"]     | 48;
     uint8_t velocity = doc["velocity"] | 100;
     bool    accent   = doc["accent"]   | false;
     bool    slide    = doc["slide"]    | false;
     spiMaster.synthNoteOnEx(engine, note, velocity, accent, slide);
-  }
+  } break;
 
   // v2.7 — {"cmd":"melodyRecNote","engine":4,"note":60}
   // Forwarded to all UDP slaves so the S3 melody screen can capture P4 piano
@@ -4551,30 +5877,30 @@ void WebInterface::processCommand(const JsonDocument& doc) {
   // v2.9 — Melody authoritative state. Master keeps engine/octave/grid/rec
   // and broadcasts melody_sync to ALL UDP slaves on every change so P4 piano
   // and S3 melody screen mirror each other automatically (just like pads).
-  else if (cmd == "melodyRecToggle") {
+  case WSC_MELODY_REC_TOGGLE: {
     uint8_t e = doc["engine"] | melodyEngine; if (e <= 6) melodyEngine = e;
     int o     = doc["octave"] | (int)melodyOctave; if (o >= 0 && o <= 9) melodyOctave = (uint8_t)o;
     melodyRecActive = doc["active"] | !melodyRecActive;
     if (melodyRecActive) { melodyClearGrid(); melodyStep = 0; }
     broadcastMelodySync();
-  }
-  else if (cmd == "melodySetEngine") {
+  } break;
+  case WSC_MELODY_SET_ENGINE: {
     uint8_t e = doc["engine"] | melodyEngine;
     if (e <= 6) melodyEngine = e;
     broadcastMelodySync();
-  }
-  else if (cmd == "melodySetOctave") {
+  } break;
+  case WSC_MELODY_SET_OCTAVE: {
     int o = doc["octave"] | (int)melodyOctave;
     if (o < 0) o = 0; if (o > 9) o = 9;
     melodyOctave = (uint8_t)o;
     broadcastMelodySync();
-  }
-  else if (cmd == "melodySetPad") {
+  } break;
+  case WSC_MELODY_SET_PAD: {
     int p = doc["pad"] | (int)melodyPad;
     if (p >= 0 && p < 16) melodyPad = (uint8_t)p;
     broadcastMelodySync();
-  }
-  else if (cmd == "melodyRecNote") {
+  } break;
+  case WSC_MELODY_REC_NOTE: {
     int note = doc["note"] | -1;
     Serial.printf("[MASTER melodyRecNote] rec=%d note=%d step=%u\n", (int)melodyRecActive, note, melodyStep);
     if (note >= 0 && note <= 127 && melodyRecActive) {
@@ -4588,8 +5914,8 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       }
       broadcastMelodySync();
     }
-  }
-  else if (cmd == "melodyAssign") {
+  } break;
+  case WSC_MELODY_ASSIGN: {
     uint8_t e = doc["engine"] | melodyEngine; if (e <= 6) melodyEngine = e;
     int o     = doc["octave"] | (int)melodyOctave; if (o >= 0 && o <= 9) melodyOctave = (uint8_t)o;
     int pad = doc["pad"] | (int)melodyPad;
@@ -4646,36 +5972,36 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       Serial.printf("[MASTER melodyAssign] pad=%d eng=%u oct=%u\n", pad, melodyEngine, melodyOctave);
       broadcastMelodySync();
     }
-  }
-  else if (cmd == "melodyClear") {
+  } break;
+  case WSC_MELODY_CLEAR: {
     melodyClearGrid(); melodyStep = 0;
     broadcastMelodySync();
-  }
+  } break;
 
   // {"cmd":"synth303NoteOff"}
-  else if (cmd == "synth303NoteOff") {
+  case WSC_SYNTH303_NOTE_OFF: {
     spiMaster.synth303NoteOff();
-  }
+  } break;
 
   // {"cmd":"synthNoteOff","engine":4,"track":0}
-  else if (cmd == "synthNoteOff") {
+  case WSC_SYNTH_NOTE_OFF: {
     uint8_t engine = doc["engine"] | 3;
     uint8_t track  = doc["track"]  | 0;
     if (track < 16 && engine <= 6) {
       spiMaster.synthNoteOff(engine, track);
     }
-  }
+  } break;
 
   // {"cmd":"synth303Param","paramId":0,"value":800.0}
-  else if (cmd == "synth303Param") {
+  case WSC_SYNTH303_PARAM: {
     uint8_t paramId = doc["paramId"] | 0;
     float   value   = doc["value"]   | 0.5f;
     spiMaster.synth303Param(paramId, value);
-  }
+  } break;
 
   // {"cmd":"synthActive","mask":123}   (bit0=808, bit1=909, bit2=505, bit3=303, bit4=WT, bit5=SH101, bit6=FM2Op)
   // {"cmd":"synthActive","mask":511}   (9 engines, 16-bit)
-  else if (cmd == "synthActive") {
+  case WSC_SYNTH_ACTIVE: {
     uint16_t mask = doc["mask"] | 0x01FF;
     if (mask > 0xFF) {
       spiMaster.synthSetActive16(mask);
@@ -4685,13 +6011,11 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     StaticJsonDocument<64> resp;
     resp["type"] = "synthActiveAck";
     resp["mask"] = mask;
-    String output;
-    serializeJson(resp, output);
-    if (ws) ws->textAll(output);
-  }
+    wsTextAllJson(resp);
+  } break;
 
   // {"cmd":"synthPreset","engine":5,"preset":2}
-  else if (cmd == "synthPreset") {
+  case WSC_SYNTH_PRESET: {
     uint8_t engine = doc["engine"] | 0;
     uint8_t preset = doc["preset"] | 0;
     spiMaster.synthPreset(engine, preset);
@@ -4700,96 +6024,94 @@ void WebInterface::processCommand(const JsonDocument& doc) {
     resp["type"] = "synthPresetAck";
     resp["engine"] = engine;
     resp["preset"] = preset;
-    String output;
-    serializeJson(resp, output);
-    if (ws) ws->textAll(output);
-  }
+    wsTextAllJson(resp);
+  } break;
 
   // ═══════════════════════════════════════════════════
   // NEW MASTER FX
   // ═══════════════════════════════════════════════════
 
   // {"cmd":"setMasterFxRoute","fxId":10,"connected":true}
-  else if (cmd == "setMasterFxRoute") {
+  case WSC_SET_MASTER_FX_ROUTE: {
     uint8_t fxId = doc["fxId"] | 0;
     bool connected = doc["connected"] | false;
     spiMaster.setMasterFxRoute(fxId, connected);
-  }
+  } break;
 
   // {"cmd":"setAutoWahActive","active":true}
-  else if (cmd == "setAutoWahActive") {
+  case WSC_SET_AUTO_WAH_ACTIVE: {
     bool active = doc["active"] | false;
     spiMaster.setAutoWahActive(active);
-  }
+  } break;
   // {"cmd":"setAutoWahLevel","level":80}
-  else if (cmd == "setAutoWahLevel") {
+  case WSC_SET_AUTO_WAH_LEVEL: {
     uint8_t level = doc["level"] | 80;
     spiMaster.setAutoWahLevel(level);
-  }
+  } break;
   // {"cmd":"setAutoWahMix","mix":50}
-  else if (cmd == "setAutoWahMix") {
+  case WSC_SET_AUTO_WAH_MIX: {
     uint8_t mix = doc["mix"] | 50;
     spiMaster.setAutoWahMix(mix);
-  }
+  } break;
 
   // {"cmd":"setStereoWidth","width":100}
-  else if (cmd == "setStereoWidth") {
+  case WSC_SET_STEREO_WIDTH: {
     uint8_t width = doc["width"] | 100;
     spiMaster.setStereoWidth(width);
-  }
+  } break;
 
   // {"cmd":"setTapeStop","mode":1}
-  else if (cmd == "setTapeStop") {
+  case WSC_SET_TAPE_STOP: {
     uint8_t mode = doc["mode"] | 0;
     spiMaster.setTapeStop(mode);
-  }
+  } break;
 
   // {"cmd":"setBeatRepeat","division":8}
-  else if (cmd == "setBeatRepeat") {
+  case WSC_SET_BEAT_REPEAT: {
     uint8_t division = doc["division"] | 0;
     spiMaster.setBeatRepeat(division);
-  }
+  } break;
 
   // {"cmd":"setDelayStereo","mode":1}
-  else if (cmd == "setDelayStereo") {
+  case WSC_SET_DELAY_STEREO: {
     uint8_t mode = doc["mode"] | 0;
     spiMaster.setDelayStereo(mode);
-  }
+  } break;
 
   // {"cmd":"setChorusStereo","mode":1}
-  else if (cmd == "setChorusStereo") {
+  case WSC_SET_CHORUS_STEREO: {
     uint8_t mode = doc["mode"] | 0;
     spiMaster.setChorusStereo(mode);
-  }
+  } break;
 
   // {"cmd":"setEarlyRefActive","active":true}
-  else if (cmd == "setEarlyRefActive") {
+  case WSC_SET_EARLY_REF_ACTIVE: {
     bool active = doc["active"] | false;
     spiMaster.setEarlyRefActive(active);
-  }
+  } break;
   // {"cmd":"setEarlyRefMix","mix":30}
-  else if (cmd == "setEarlyRefMix") {
+  case WSC_SET_EARLY_REF_MIX: {
     uint8_t mix = doc["mix"] | 30;
     spiMaster.setEarlyRefMix(mix);
-  }
+  } break;
 
   // ═══════════════════════════════════════════════════
   // CHOKE GROUPS
   // ═══════════════════════════════════════════════════
 
   // {"cmd":"setChokeGroup","pad":6,"group":1}
-  else if (cmd == "setChokeGroup") {
+  case WSC_SET_CHOKE_GROUP: {
     uint8_t pad = doc["pad"] | 0;
     uint8_t group = doc["group"] | 0;
     spiMaster.setChokeGroup(pad, group);
-  }
+  } break;
 
   // ═══════════════════════════════════════════════════
   // SONG CHAIN MODE
   // ═══════════════════════════════════════════════════
 
   // {"cmd":"songChainUpload","chain":[{"pattern":0,"repeats":4},{"pattern":1,"repeats":2}]}
-  else if (cmd == "songChainUpload") {
+  case WSC_SONG_CHAIN_UPLOAD: {
     JsonArrayConst arr = doc["chain"].as<JsonArrayConst>();
     if (!arr.isNull() && arr.size() > 0) {
       uint8_t count = min((int)arr.size(), (int)Sequencer::SONG_CHAIN_MAX);
@@ -4807,10 +6129,10 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       }
       spiMaster.songUpload(spiEntries, count);
     }
-  }
+  } break;
 
   // {"cmd":"songChainControl","action":1}  0=stop, 1=play, 2=reset
-  else if (cmd == "songChainControl") {
+  case WSC_SONG_CHAIN_CONTROL: {
     uint8_t action = doc["action"] | 0;
     if (action == 1) {
       sequencer.songChainPlay();
@@ -4823,33 +6145,35 @@ void WebInterface::processCommand(const JsonDocument& doc) {
       spiMaster.songControl(2);
     }
     broadcastSequencerState();
-  }
+  } break;
 
   // {"cmd":"songGetPos"}
-  else if (cmd == "songGetPos") {
+  case WSC_SONG_GET_POS: {
     StaticJsonDocument<128> resp;
     resp["type"] = "songPos";
     resp["idx"] = sequencer.getSongChainIdx();
     resp["pattern"] = sequencer.getCurrentPattern();
     resp["repeat"] = sequencer.getSongChainRepeatCnt();
     resp["active"] = sequencer.isSongChainActive();
-    String output;
-    serializeJson(resp, output);
-    if (ws) ws->textAll(output);
-  }
+    wsTextAllJson(resp);
+  } break;
 
   // ═══════════════════════════════════════════════════
   // PER-TRACK LFO CONFIG (Daisy-side)
   // ═══════════════════════════════════════════════════
 
   // {"cmd":"setTrackLfo","track":0,"wave":0,"target":3,"rate":100,"depth":500}
-  else if (cmd == "setTrackLfo") {
+  case WSC_SET_TRACK_LFO: {
     uint8_t track = doc["track"] | 0;
     uint8_t wave = doc["wave"] | 0;
     uint8_t target = doc["target"] | 0;
     uint16_t rate = doc["rate"] | 100;     // centésimas de Hz
     uint16_t depth = doc["depth"] | 500;   // milésimas
     spiMaster.setTrackLfoConfig(track, wave, target, rate, depth);
+  } break;
+
+  default:
+    break;
   }
 }
 
@@ -4873,10 +6197,21 @@ void WebInterface::updateUdpClient(IPAddress ip, uint16_t port) {
     client.port = port;
     client.lastSeen = millis();
     client.packetCount = 1;
+    client.binProto = 0;
+    client.topics = TOPIC_MASK_UDP_DEFAULT;
+    client.ingress.reset();
     udpClients[sKey] = client;
+    rebuildTopicSets();
   }
 }
 
+UdpClient* WebInterface::findUdpClient(IPAddress ip) {
+  char key[16];
+  snprintf(key, sizeof(key), "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+  auto it = udpClients.find(String(key));
+  return (it != udpClients.end()) ? &it->second : nullptr;
+}
+
 // Limpiar clientes UDP inactivos
 void WebInterface::cleanupStaleUdpClients() {
   unsigned long now = millis();
@@ -4893,12 +6228,15 @@ void WebInterface::cleanupStaleUdpClients() {
       ++it;
     }
   }
+  if (cleaned > 0) rebuildTopicSets();
 }
 
 // Manejar paquetes UDP entrantes (with crash protection)
 void WebInterface::handleUdp() {
   int packetSize = udp.parsePacket();
   if (packetSize <= 0) return;
+  CmdProfScope profScope(CMDPROF_PATH_UDP);
+  const uint32_t rxUs = micros();   // base de la latencia de los ACK
 
   // ── Heap guard: skip processing if memory is critical ──
   uint32_t freeHeap = ESP.getFreeHeap();
@@ -4925,7 +6263,7 @@ void WebInterface::handleUdp() {
 
   updateUdpClient(udp.remoteIP(), udp.remotePort());
 
-  StaticJsonDocument<4096> doc;
+  SlabJsonDocument doc(4096);   // slab PSRAM en vez de 4 KB de stack de systemTask
   DeserializationError error = deserializeJson(doc, incomingPacket);
 
   if (!error) {
@@ -4933,11 +6271,74 @@ void WebInterface::handleUdp() {
     bool syncAfter = shouldSendUdpStateSync(cmd);
     IPAddress remoteIp = udp.remoteIP();
     uint16_t remotePort = udp.remotePort();
-    processCommand(doc);
+    UdpClient* uc = findUdpClient(remoteIp);
+    if (uc && doc.containsKey("binProto")) {
+      uc->binProto = doc["binProto"] | 0;
+    }
+    IngressLimiter& ingress = uc ? uc->ingress : _ingressFallback;
+    // NACK de sync binario: sólo reenvío, sin {"s":"ok"} ni paso por dispatchCommand
+    if (strcmp(cmd, "sync_nack") == 0) {
+      if (ingress.allow(ING_EDIT, millis())) handleUdpSyncNack(doc, remoteIp, remotePort);
+      yield();
+      return;
+    }
+    // Token bucket por slave: PARAM limitado se aplica más tarde (último valor), el resto se descarta
+    const WsCommandInfo* info = commandLookup(cmd);
+    IngressVerdict verdict = info ? admitCommand(ingress, (uint32_t)remoteIp, *info, doc) : ING_ADMIT;
+    if (info && info->id == WSC_BATCH) {
+      BatchResult r = {};
+      if (verdict == ING_ADMIT) r = applyBatch(doc["cmds"], doc["atomic"] | false);
+      char reply[64];
+      int replyLen = (verdict != ING_ADMIT) ? snprintf(reply, sizeof(reply), "{\"s\":\"err\",\"m\":\"rate\"}")
+                   : r.busy ? snprintf(reply, sizeof(reply), "{\"s\":\"err\",\"m\":\"busy\"}")
+                   : snprintf(reply, sizeof(reply), "{\"s\":\"ok\",\"n\":%u,\"skipped\":%u}", r.applied, r.skipped);
+      udp.beginPacket(remoteIp, remotePort);
+      udp.write((const uint8_t*)reply, replyLen);
+      udp.endPacket();
+      if (r.flags & CMDF_UDP_SYNC) sendUdpStateSync(remoteIp, remotePort);
+      yield();
+      return;
+    }
+    // Topics de los syncs periódicos de este slave (state_sync, pattern, melody)
+    if (info && info->id == WSC_SUBSCRIBE && uc) {
+      if (verdict == ING_ADMIT) {
+        uc->topics = applySubscribe(uc->topics, doc);
+        rebuildTopicSets();
+      }
+      StaticJsonDocument<192> reply;
+      reply["s"] = verdict == ING_DROPPED ? "err" : "ok";
+      wsTopicMaskToJson(uc->topics, reply.createNestedArray("topics"));
+      char buf[160];
+      size_t replyLen = serializeJson(reply, buf, sizeof(buf));
+      udp.beginPacket(remoteIp, remotePort);
+      udp.write((const uint8_t*)buf, replyLen);
+      udp.endPacket();
+      yield();
+      return;
+    }
+    // "rid": la respuesta inmediata lo repite y el {"s":"ack"} llega al salir el SPI
+    const uint32_t rid = doc["rid"] | 0u;
+    uint8_t ackTag = 0;
+    if (verdict == ING_ADMIT && rid && info) ackTag = cmdAckBegin(CMDACK_UDP, (uint32_t)remoteIp, remotePort, rid, rxUs);
+    if (verdict == ING_ADMIT) processCommand(doc);
     udp.beginPacket(remoteIp, remotePort);
-    udp.print("{\"s\":\"ok\"}");
+    // "rate" = bucket vacío, "args" = falta un campo obligatorio (commandRequiredFields)
+    const char* errName = verdict == ING_DROPPED ? "rate" : verdict == ING_INVALID ? "args" : nullptr;
+    char reply[64];
+    int replyLen = errName
+        ? (rid ? snprintf(reply, sizeof(reply), "{\"s\":\"err\",\"m\":\"%s\",\"rid\":%lu}", errName, (unsigned long)rid)
+               : snprintf(reply, sizeof(reply), "{\"s\":\"err\",\"m\":\"%s\"}", errName))
+        : (rid ? snprintf(reply, sizeof(reply), "{\"s\":\"ok\",\"rid\":%lu}", (unsigned long)rid)
+               : snprintf(reply, sizeof(reply), "{\"s\":\"ok\"}"));
+    udp.write((const uint8_t*)reply, replyLen);
     udp.endPacket();
-    if (syncAfter) {
+    if (rid && verdict == ING_ADMIT) {
+      if (info) cmdAckEnd(ackTag, CMDACK_UDP, (uint32_t)remoteIp, remotePort, rid, rxUs);
+      else cmdAckNow(CMDACK_UDP, (uint32_t)remoteIp, remotePort, rid, rxUs, CMDACK_ERR_UNKNOWN, false);
+    } else if (rid && verdict == ING_COALESCED) {
+      cmdAckNow(CMDACK_UDP, (uint32_t)remoteIp, remotePort, rid, rxUs, CMDACK_OK, true);
+    }
+    if (syncAfter && verdict == ING_ADMIT) {
       sendUdpStateSync(remoteIp, remotePort);
     }
   } else {
@@ -4995,9 +6396,7 @@ void WebInterface::broadcastMIDIMessage(const MIDIMessage& msg) {
   doc["timestamp"] = msg.timestamp;
   doc["totalMessages"] = messageCount; // Contador acumulado
   
-  String output;
-  serializeJson(doc, output);
-  ws->textAll(output);
+  wsTextAllJson(doc);
 }
 
 void WebInterface::broadcastMIDIDeviceStatus(bool connected, const MIDIDeviceInfo& info) {
@@ -5014,9 +6413,7 @@ void WebInterface::broadcastMIDIDeviceStatus(bool connected, const MIDIDeviceInf
     doc["connectTime"] = info.connectTime;
   }
   
-  String output;
-  serializeJson(doc, output);
-  ws->textAll(output);
+  wsTextAllJson(doc);
   
 }
 
@@ -5034,6 +6431,10 @@ static String uploadErrorMsg = "";
 static int uploadLastPercent = -1;
 static constexpr bool UPLOAD_PROGRESS_WS_ENABLED = false;
 
+static portMUX_TYPE _uploadStreamMux = portMUX_INITIALIZER_UNLOCKED;
+static constexpr unsigned long kUploadStallMs = 10000;   // sin chunks HTTP → abortar
+static constexpr uint32_t kUploadSpiBurst = 32 * 1024;   // bytes SPI por update()
+
 void WebInterface::handleUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final) {
   if (index == 0) {
     // ── Primera parte: inicializar estado ──
@@ -5071,20 +6472,21 @@ void WebInterface::handleUpload(AsyncWebServerRequest *request, String filename,
       broadcastUploadComplete(uploadPad, false, uploadErrorMsg); return;
     }
 
-    // Liberar buffer anterior si existe
-    if (_uploadBuf) { free(_uploadBuf); _uploadBuf = nullptr; _uploadBufLen = 0; }
-
-    // Allocar en PSRAM
-    _uploadBuf = (uint8_t*)heap_caps_malloc(uploadSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!_uploadBuf) {
-      // fallback DRAM (solo para archivos pequeños)
-      _uploadBuf = (uint8_t*)heap_caps_malloc(uploadSize, MALLOC_CAP_8BIT);
-    }
-    if (!_uploadBuf) {
-      uploadError = true; uploadErrorMsg = "No memory for upload";
+    // Un upload a la vez: el anterior puede seguir enviándose por SPI
+    if (_streamPad >= 0) {
+      uploadError = true; uploadErrorMsg = "Another upload is in progress";
       broadcastUploadComplete(uploadPad, false, uploadErrorMsg); return;
     }
-    _uploadBufLen = 0;
+
+    // Content-Length (multipart incluido) acota el chunk data; el buffer del
+    // sample se reserva al llegar la cabecera "data", no el fichero completo
+    sampleManager.beginStreamLoad(uploadPad, uploadSize);
+    _streamFinal = false;
+    _streamFailed = false;
+    _streamSpiBegun = false;
+    _streamSpiSent = 0;
+    _streamLastFeedMs = millis();
+    _streamPad = uploadPad;
   }
 
   if (uploadError) {
@@ -5093,13 +6495,26 @@ void WebInterface::handleUpload(AsyncWebServerRequest *request, String filename,
     return;
   }
 
-  // ── Acumular datos en PSRAM ──
-  if (_uploadBuf && len > 0) {
-    size_t copy = len;
-    if (_uploadBufLen + copy > uploadSize) copy = uploadSize - _uploadBufLen;
-    memcpy(_uploadBuf + _uploadBufLen, data, copy);
-    _uploadBufLen += copy;
-    uploadReceived  = _uploadBufLen;
+  // ── Convertir el chunk directamente al buffer final ──
+  if (len > 0) {
+    portENTER_CRITICAL(&_uploadStreamMux);
+    bool live = (_streamPad == uploadPad) && !_streamFailed;
+    if (live) _streamFeeding = true;
+    portEXIT_CRITICAL(&_uploadStreamMux);
+
+    bool ok = live && sampleManager.feedStreamLoad(data, len);
+    _streamFeeding = false;
+    _streamLastFeedMs = millis();
+    if (!ok) {
+      uploadError = true;
+      uploadErrorMsg = live ? String(sampleManager.getLastParseError()) : String("Upload aborted");
+      _streamFailed = true;
+      broadcastUploadComplete(uploadPad, false, "Failed to load: " + uploadErrorMsg);
+      if (final) request->send(400, "application/json",
+        "{\"success\":false,\"message\":\"" + uploadErrorMsg + "\"}");
+      return;
+    }
+    uploadReceived = index + len;
 
     int percent = (uploadSize > 0) ? (int)(uploadReceived * 100 / uploadSize) : 0;
     if (UPLOAD_PROGRESS_WS_ENABLED && percent != uploadLastPercent && percent % 25 == 0) {
@@ -5111,11 +6526,17 @@ void WebInterface::handleUpload(AsyncWebServerRequest *request, String filename,
 
   // ── Upload completo ──
   if (final) {
-    // Responder HTTP 200 inmediatamente — no bloquear el task de AsyncWebServer
-    request->send(200, "application/json", "{\"success\":true,\"message\":\"Uploading...\"}");
-
-    // Activar carga diferida en update() (systemTask Core0)
-    _pendingLoadPad = uploadPad;
+    if (!sampleManager.finishStreamLoad()) {
+      String err = String(sampleManager.getLastParseError());
+      _streamFailed = true;
+      broadcastUploadComplete(uploadPad, false, "Failed to load: " + err);
+      request->send(400, "application/json",
+        "{\"success\":false,\"message\":\"" + err + "\"}");
+    } else {
+      // Responder HTTP 200 inmediatamente — el resto del SPI lo termina update()
+      _streamFinal.store(true, std::memory_order_release);
+      request->send(200, "application/json", "{\"success\":true,\"message\":\"Uploading...\"}");
+    }
 
     uploadPad = -1; uploadFilename = ""; uploadSize = 0;
     uploadReceived = 0; uploadError = false; uploadErrorMsg = "";
@@ -5123,6 +6544,65 @@ void WebInterface::handleUpload(AsyncWebServerRequest *request, String filename,
   }
 }
 
+void WebInterface::resetUploadStream() {
+  _streamSpiBegun = false;
+  _streamSpiSent = 0;
+  _streamSpiOk = true;
+  _streamFinal = false;
+  _streamFailed = false;
+  _streamPad = -1;
+}
+
+// Envía por SPI los bloques ya convertidos mientras siguen llegando chunks HTTP:
+// el upload termina en ~max(HTTP, SPI) en vez de HTTP + parseo + SPI
+void WebInterface::pumpUploadStream(unsigned long now) {
+  int pad = _streamPad;
+  if (pad < 0) return;
+  const WavStreamParser& wav = sampleManager.uploadStream();
+
+  bool finished = _streamFinal.load(std::memory_order_acquire);
+  bool stalled = !finished && (now - _streamLastFeedMs > kUploadStallMs);
+  if (_streamFailed || stalled) {
+    portENTER_CRITICAL(&_uploadStreamMux);
+    bool feeding = _streamFeeding;
+    if (!feeding) _streamFailed = true;
+    portEXIT_CRITICAL(&_uploadStreamMux);
+    if (feeding) return;  // reintentar en el siguiente update()
+    sampleManager.abortStreamLoad(_streamSpiBegun);
+    if (stalled) broadcastUploadComplete(pad, false, "Upload stalled");
+    resetUploadStream();
+    return;
+  }
+
+  if (!wav.hasFormat()) return;
+  const int16_t* buf = wav.buffer();
+  uint32_t totalBytes = wav.numSamples() * sizeof(int16_t);
+  if (!_streamSpiBegun) {
+    spiMaster.sampleStreamBegin(pad, wav.numSamples());
+    _streamSpiBegun = true;
+  }
+
+  // Sólo bloques completos de 512 B salvo el último
+  uint32_t readyBytes = wav.samplesReady() * sizeof(int16_t);
+  uint32_t limit = (readyBytes >= totalBytes) ? totalBytes : (readyBytes & ~511u);
+  if (limit > _streamSpiSent + kUploadSpiBurst) limit = _streamSpiSent + kUploadSpiBurst;
+  if (limit > _streamSpiSent) {
+    if (!spiMaster.sampleStreamData(pad, buf, _streamSpiSent, limit)) _streamSpiOk = false;
+    _streamSpiSent = limit;
+    esp_task_wdt_reset();
+  }
+
+  if (finished && _streamSpiSent >= totalBytes) {
+    if (!spiMaster.sampleStreamEnd(pad, buf, wav.numSamples())) _streamSpiOk = false;
+    sampleManager.commitStreamLoad(_streamSpiOk);
+    resetUploadStream();
+    esp_task_wdt_reset();
+    broadcastUploadComplete(pad, true, "Sample uploaded and loaded successfully");
+    markStateDirty(STATE_SEC_SAMPLES);
+    broadcastSequencerState();
+  }
+}
+
 void WebInterface::broadcastUploadProgress(int pad, int percent) {
   if (!initialized || !ws) return;
   
@@ -5131,9 +6611,7 @@ void WebInterface::broadcastUploadProgress(int pad, int percent) {
   doc["pad"] = pad;
   doc["percent"] = percent;
   
-  String output;
-  serializeJson(doc, output);
-  ws->textAll(output);
+  wsTextTopicJson(TOPIC_SAMPLES, doc);
 }
 
 void WebInterface::broadcastUploadComplete(int pad, bool success, const String& message) {
@@ -5145,9 +6623,7 @@ void WebInterface::broadcastUploadComplete(int pad, bool success, const String&
   doc["success"] = success;
   doc["message"] = message;
   
-  String output;
-  serializeJson(doc, output);
-  ws->textAll(output);
+  wsTextTopicJson(TOPIC_SAMPLES, doc);
 }
 
 void WebInterface::broadcastRaw(const char* json) {
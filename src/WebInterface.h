@@ -15,16 +15,42 @@
 #include <ArduinoJson.h>
 #include <map>
 #include <functional>
+#include <atomic>
 #include "MIDIController.h"
+#include "CommandTable.h"
+#include "UdpSync.h"
+#include "SeqEventRing.h"
+#include "IngressLimiter.h"
+#include "WsTopics.h"
+#include "CmdAck.h"
 
 #define UDP_PORT 8888  // Puerto para recibir comandos UDP
 
+// Secciones del snapshot de estado versionado (markStateDirty)
+#define STATE_SEC_TRANSPORT  0x01
+#define STATE_SEC_MIXER      0x02
+#define STATE_SEC_FX         0x04
+#define STATE_SEC_PATTERN    0x08
+#define STATE_SEC_SAMPLES    0x10
+#define STATE_SEC_ALL        0x1F
+
+// Backpressure WebSocket: clase de frame y nivel de retraso por cliente
+#define WS_FRAME_LIVE       0   // meters, steps: el siguiente sustituye al anterior
+#define WS_FRAME_STATE      1   // snapshot/delta: el cliente se recupera con el siguiente
+#define WS_FRAME_CRITICAL   2   // respuestas, ecos, patrones
+#define WS_LAG_OK           0
+#define WS_LAG_SLOW         1   // meters a 1/3 de frecuencia
+#define WS_LAG_CONGESTED    2   // sólo STATE/CRITICAL; desconexión si persiste
+
 // Estructura para trackear clientes UDP
 struct UdpClient {
   IPAddress ip;
   uint16_t port;
   unsigned long lastSeen;
   uint32_t packetCount;
+  uint8_t binProto;   // versión binaria anunciada por el slave ("binProto" en cualquier paquete)
+  uint8_t topics;     // TOPIC_BIT(...) de los syncs periódicos ({"cmd":"subscribe"})
+  IngressLimiter ingress;
 };
 
 class WebInterface {
@@ -42,8 +68,11 @@ public:
   
   void broadcastSequencerState();
   void sendSequencerStateToClient(AsyncWebSocketClient* client);
+  // Marca secciones del snapshot para reconstruir en el próximo envío de estado
+  void markStateDirty(uint8_t sections = STATE_SEC_ALL);
   void broadcastPadTrigger(int pad);
   void broadcastStep(int step);
+  void broadcastSeqTrigger(int track, uint8_t velocity);  // Core1: hit real del secuenciador
   void broadcastSongPattern(int pattern, int songLength);
   
   // MIDI functions
@@ -86,6 +115,7 @@ private:
   // Tracking de clientes UDP
   std::map<String, UdpClient> udpClients;
   void updateUdpClient(IPAddress ip, uint16_t port);
+  UdpClient* findUdpClient(IPAddress ip);
   void cleanupStaleUdpClients();
   
   void onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, 
@@ -99,10 +129,130 @@ private:
   void releaseWsReassemblySlot(uint32_t clientId);
   void releaseWsReassemblySlot(WsReassemblySlot* slot);
   WsReassemblySlot wsReassemblySlots[4];
+  // Estado por cliente WS (capacidades negociadas en "init")
+  struct WsClientState {
+    uint32_t clientId;   // 0xFFFFFFFF = libre
+    uint8_t binProto;    // 0 = sólo JSON, 2 = acepta frames de patrón binarios
+    bool stateDelta;     // anunció "sv" en init → acepta deltas de estado
+    bool editBatch;      // anunció "batch" en init → acepta {"type":"batch","msgs":[...]}
+    uint32_t stateVersion;  // última versión de estado entregada (0 = necesita completo)
+    // Backpressure (wsAllowSend / assessWsBackpressure)
+    uint8_t lagLevel;       // WS_LAG_OK / WS_LAG_SLOW / WS_LAG_CONGESTED
+    uint8_t meterTick;      // divisor de meters para clientes lentos
+    uint16_t maxQueue;      // pico de cola observado
+    uint32_t lagSinceMs;    // inicio del retraso continuo (0 = al día)
+    uint32_t dropped;       // frames descartados por backpressure
+    uint8_t topics;         // TOPIC_BIT(...) suscritos (WsTopics.h)
+    uint8_t patternSub;     // TOPIC_PATTERN_ANY o índice de patrón seguido
+    IngressLimiter ingress; // token buckets de entrada (IngressLimiter.h)
+    CmdAckStats ackStats;   // latencias de comandos con "rid" (CmdAck.h)
+
+    void reset(uint32_t id) {
+      clientId = id;
+      binProto = 0;
+      stateDelta = false;
+      editBatch = false;
+      stateVersion = 0;
+      lagLevel = 0;
+      meterTick = 0;
+      maxQueue = 0;
+      lagSinceMs = 0;
+      dropped = 0;
+      topics = TOPIC_MASK_DEFAULT;
+      patternSub = TOPIC_PATTERN_ANY;
+      ingress.reset();
+      ackStats.reset();
+    }
+  };
+  WsClientState wsClientStates[4];
+  WsClientState* findWsClientState(uint32_t clientId, bool create);
+  void releaseWsClientState(uint32_t clientId);
+  // Conjuntos de suscriptores por topic: bit i = wsClientStates[i]. Se recalculan
+  // en connect/disconnect/subscribe; un topic vacío no se codifica ni se envía
+  uint8_t _topicWs[TOPIC_COUNT] = {};
+  uint8_t _topicUdp = 0;                 // OR de UdpClient::topics
+  void rebuildTopicSets();
+  bool topicHasWs(WsTopic t) const { return _topicWs[t] != 0; }
+  bool topicHasUdp(uint8_t mask) const { return (_topicUdp & mask) != 0; }
+  // {"cmd":"subscribe","topics":[...]|"add":[...]|"remove":[...],"pattern":N} → máscara nueva
+  static uint8_t applySubscribe(uint8_t current, const JsonDocument& doc);
+  void handleWsSubscribe(AsyncWebSocketClient* client, const JsonDocument& doc);
+  void wsTextTopic(WsTopic t, const char* data, size_t len);
+  void wsTextTopicJson(WsTopic t, const JsonDocument& doc);
+  void flushSpiLogs();
+  // ACKs de comandos con "rid": tag SPI por comando, ACK al salir el último frame
+  uint8_t cmdAckBegin(CmdAckChannel ch, uint32_t owner, uint16_t port, uint32_t rid, uint32_t rxUs);
+  void cmdAckEnd(uint8_t tag, CmdAckChannel ch, uint32_t owner, uint16_t port, uint32_t rid, uint32_t rxUs);
+  // Resuelto sin pasar por SPI (rate, desconocido, coalescido)
+  void cmdAckNow(CmdAckChannel ch, uint32_t owner, uint16_t port, uint32_t rid, uint32_t rxUs,
+                 CmdAckError err, bool deferred);
+  void sendCmdAck(const CmdAckDone& d);
+  void flushCmdAcks(unsigned long now);
+  portMUX_TYPE _ackStatsMux = portMUX_INITIALIZER_UNLOCKED;   // ackStats: async_tcp + systemTask
+  unsigned long _lastAckStatsMs = 0;
+  // Song chain: mantener calientes en SampleCache los samples de las pistas
+  // que usan los próximos patrones
+  void prefetchSongChain(unsigned long now);
+  unsigned long _lastChainPrefetchMs = 0;
+  // Flow control por cliente: LIVE (meters, steps) se descarta primero,
+  // STATE (snapshot/delta, recuperable) después, CRITICAL sólo con la cola llena
+  bool wsAllowSend(WsClientState& st, AsyncWebSocketClient* c, uint8_t frameClass);
+  void assessWsBackpressure(unsigned long now);
+  bool kickWorstWsClient();
+  bool wsClientWantsBinaryPattern(AsyncWebSocketClient* client);
+  size_t encodePatternFrame(int pattern, uint8_t flags);  // → _patternBuf, 0 si falla
+  // Envía el patrón binario a los clientes que lo soportan; true si queda alguno que necesita JSON
+  bool broadcastPatternBinary(int pattern);
+  void textToJsonPatternClients(const char* json, size_t len, int pattern);
+  void sendStateToClient(AsyncWebSocketClient* client, WsClientState* st);
+  // Eventos step/trigger/pattern de Core1: frame 0xB4 por ventana para binProto >= 3
+  SeqEventRing _seqEvents;
+  unsigned long _seqFrameMs = 0;
+  unsigned long _legacyStepMs = 0;
+  void flushSeqEvents(unsigned long now);
+  // Eco de ediciones (stepSet, masterFx, trackFxSet...) agrupado en ventanas de
+  // kEditEchoWindowMs: el último valor por celda/parámetro gana, un frame por cliente
+  void queueEditEcho(const JsonDocument& resp);
+  void flushEditEchoes();
+  // Envelope {"cmd":"batch","cmds":[...],"atomic":bool} (WS, UDP y POST /api/batch):
+  // todos los comandos en una pasada, frames SPI coalescidos, ecos en un solo frame
+  // y un único delta de estado al final. atomic = SPI retenido hasta el siguiente step.
+  struct BatchResult {
+    uint16_t applied;
+    uint16_t skipped;     // sin "cmd", desconocido, CMDF_WS_ONLY o por encima del límite
+    uint16_t spiFrames;   // frames SPI tras coalescer
+    uint8_t  flags;       // OR de CMDF_* de los aplicados (CMDF_UDP_SYNC → state_sync)
+    bool     atomic;      // retenido de verdad (transporte en marcha)
+    bool     busy;        // otro batch en curso en otra task: no se aplicó nada
+  };
+  BatchResult applyBatch(JsonArrayConst cmds, bool atomic);
+  static size_t formatBatchAck(char* buf, size_t cap, const BatchResult& r, long id);  // id < 0 = sin id
+  TaskHandle_t _batchTask = nullptr;   // task con un applyBatch en curso (ecos sin flush por comando)
+  bool inBatch() const { return _batchTask && _batchTask == xTaskGetCurrentTaskHandle(); }
+  void pushStateToClients();   // delta de estado a cada cliente, sin el rate limit de broadcast
   void processCommand(const JsonDocument& doc);  // Función común para procesar comandos
+  void wsTextAllJson(const JsonDocument& doc);   // textAll serializado en SlabPool (sin String)
+  // JSON ya resuelto o frame binario; coalesced = valor PARAM guardado por IngressLimiter (sin throttle)
+  void dispatchCommand(const WsCommandInfo& info, const JsonDocument& doc, bool coalesced = false);
+  // Límite de entrada por cliente y clase; PARAM limitado se guarda y lo aplica flushCoalescedParams
+  IngressLimiter _ingressFallback;   // clientes sin slot (5º WS, UDP con la tabla llena)
+  unsigned long _coalesceFlushMs = 0;
+  IngressLimiter& wsIngress(uint32_t clientId);
+  IngressVerdict admitCommand(IngressLimiter& lim, uint32_t owner, const WsCommandInfo& info, const JsonDocument& doc);
+  // Admisión + ACK + dispatch de un comando WS ya decodificado (texto o 0xB1)
+  bool runWsCommand(AsyncWebSocketClient* client, const WsCommandInfo* info, const JsonDocument& doc,
+                    uint32_t rid, uint32_t rxUs);
+  void flushCoalescedParams(unsigned long now);
   void sendUdpStateSync(IPAddress ip, uint16_t port);
   void broadcastUdpStateSync();
   bool shouldSendUdpStateSync(const char* cmd) const;
+  // Sync binario 0xB3 (UdpSync.h) para slaves con binProto >= UDP_SYNC_BIN_PROTO
+  bool hasUdpSyncBinaryClients(uint8_t topics = TOPIC_MASK_ALL) const;
+  void writeUdpSyncMelody(UdpSyncWriter& w);
+  const UdpSyncPacket* encodeUdpSyncState();
+  const UdpSyncPacket* encodeUdpSyncMelody();
+  void sendUdpSyncPacket(const UdpSyncPacket* pkt, IPAddress ip, uint16_t port);
+  void handleUdpSyncNack(const JsonDocument& doc, IPAddress ip, uint16_t port);
   /* v2.6 — Push pattern + selected index to all UDP slaves (P4/S3).
    * Fixes bug where slaves displayed stale pattern after web changed it. */
   void broadcastUdpPatternSync(int patternNum);
@@ -129,10 +279,20 @@ private:
   // File upload handlers
   void handleUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final);
 
-  // Deferred sample load — set by handleUpload callback, consumed by update() in main loop
-  volatile int  _pendingLoadPad  = -1;  // pad index to load, -1 = none
-  uint8_t*      _uploadBuf       = nullptr;  // PSRAM buffer con WAV raw (válido hasta after deferred load)
-  size_t        _uploadBufLen    = 0;
+  // Upload en streaming — handleUpload convierte cada chunk HTTP al buffer final
+  // (SampleManager::feedStreamLoad); update() envía por SPI lo ya convertido en paralelo.
+  // Del parser, update() sólo lee lo publicado con release (hasFormat, samplesReady)
+  // y _streamFinal, que async_tcp publica con release después de finish()
+  volatile int  _streamPad       = -1;     // pad del upload en curso, -1 = ninguno
+  std::atomic<bool> _streamFinal{false};   // último chunk HTTP recibido y parser cerrado
+  volatile bool _streamFailed    = false;  // error de parseo/HTTP: update() aborta
+  volatile bool _streamFeeding   = false;  // handleUpload dentro de feed (no liberar)
+  volatile unsigned long _streamLastFeedMs = 0;
+  bool          _streamSpiBegun  = false;
+  uint32_t      _streamSpiSent   = 0;      // bytes ya enviados por SPI
+  bool          _streamSpiOk     = true;   // ningún chunk DATA perdido (dedup: se anota el hash)
+  void pumpUploadStream(unsigned long now);
+  void resetUploadStream();
 };
 
 #endif
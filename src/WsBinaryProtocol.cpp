@@ -0,0 +1,118 @@
+/*
+ * WsBinaryProtocol.cpp
+ * RED808 tabla de opcodes binarios v1 (ver WsBinaryProtocol.h)
+ */
+
+#include "WsBinaryProtocol.h"
+#include <string.h>
+#include <math.h>
+
+// Opcodes estables: no renumerar, sólo añadir al final.
+static const WsBinSchema kBinSchemas[] = {
+  // ── Sequencer ──
+  { 0x01, WSC_SET_STEP,             3, { {"track", WBF_U8}, {"step", WBF_U8}, {"active", WBF_BOOL} } },
+  { 0x02, WSC_SET_STEP,             4, { {"track", WBF_U8}, {"step", WBF_U8}, {"active", WBF_BOOL}, {"noteLen", WBF_U8} } },
+  { 0x03, WSC_SET_STEP,             4, { {"track", WBF_U8}, {"step", WBF_U8}, {"active", WBF_BOOL}, {"silent", WBF_BOOL} } },
+  { 0x04, WSC_SET_STEP_VELOCITY,    3, { {"track", WBF_U8}, {"step", WBF_U8}, {"velocity", WBF_U8} } },
+  { 0x05, WSC_SET_STEP_VELOCITY,    4, { {"track", WBF_U8}, {"step", WBF_U8}, {"velocity", WBF_U8}, {"silent", WBF_BOOL} } },
+  { 0x06, WSC_SET_STEP_PROBABILITY, 3, { {"track", WBF_U8}, {"step", WBF_U8}, {"probability", WBF_U8} } },
+  { 0x07, WSC_START,                0, {} },
+  { 0x08, WSC_STOP,                 0, {} },
+  { 0x09, WSC_TEMPO,                1, { {"value", WBF_F32} } },
+  { 0x0A, WSC_SELECT_PATTERN,       1, { {"index", WBF_U8} } },
+  // ── Mixer ──
+  { 0x0B, WSC_MUTE,                 2, { {"track", WBF_U8}, {"value", WBF_BOOL} } },
+  { 0x0C, WSC_SOLO,                 2, { {"track", WBF_U8}, {"value", WBF_BOOL} } },
+  { 0x0D, WSC_SET_TRACK_VOLUME,     2, { {"track", WBF_U8}, {"volume", WBF_U16} } },
+  { 0x0E, WSC_SET_VOLUME,           1, { {"value", WBF_U16} } },
+  { 0x0F, WSC_SET_SEQUENCER_VOLUME, 1, { {"value", WBF_U16} } },
+  { 0x10, WSC_SET_LIVE_VOLUME,      1, { {"value", WBF_U16} } },
+  { 0x11, WSC_SET_LIVE_PITCH,       1, { {"pitch", WBF_F32} } },
+  // ── Master FX ──
+  { 0x12, WSC_SET_FILTER_CUTOFF,    1, { {"value", WBF_F32} } },
+  { 0x13, WSC_SET_FILTER_RESONANCE, 1, { {"value", WBF_F32} } },
+  { 0x14, WSC_SET_DISTORTION,       1, { {"value", WBF_F32} } },
+  { 0x15, WSC_SET_BIT_CRUSH,        1, { {"value", WBF_U8} } },
+  { 0x16, WSC_SET_SAMPLE_RATE,      1, { {"value", WBF_U16} } },
+  { 0x17, WSC_SET_DELAY_TIME,       1, { {"value", WBF_F32} } },
+  { 0x18, WSC_SET_DELAY_FEEDBACK,   1, { {"value", WBF_F32} } },
+  { 0x19, WSC_SET_DELAY_MIX,        1, { {"value", WBF_F32} } },
+  { 0x1A, WSC_SET_PHASER_RATE,      1, { {"value", WBF_F32} } },
+  { 0x1B, WSC_SET_PHASER_DEPTH,     1, { {"value", WBF_F32} } },
+  { 0x1C, WSC_SET_FLANGER_RATE,     1, { {"value", WBF_F32} } },
+  { 0x1D, WSC_SET_FLANGER_DEPTH,    1, { {"value", WBF_F32} } },
+  // ── Track sends / live FX ──
+  { 0x1E, WSC_SET_TRACK_PAN,          2, { {"track", WBF_U8}, {"value", WBF_F32} } },
+  { 0x1F, WSC_SET_TRACK_REVERB_SEND,  2, { {"track", WBF_U8}, {"value", WBF_F32} } },
+  { 0x20, WSC_SET_TRACK_DELAY_SEND,   2, { {"track", WBF_U8}, {"value", WBF_F32} } },
+  { 0x21, WSC_SET_TRACK_CHORUS_SEND,  2, { {"track", WBF_U8}, {"value", WBF_F32} } },
+  { 0x22, WSC_SET_REVERSE,            2, { {"track", WBF_U8}, {"value", WBF_BOOL} } },
+  { 0x23, WSC_SET_REVERSE,            2, { {"pad", WBF_U8}, {"value", WBF_BOOL} } },
+  { 0x24, WSC_SET_PITCH_SHIFT,        2, { {"track", WBF_U8}, {"value", WBF_F32} } },
+  { 0x25, WSC_SET_PITCH_SHIFT,        2, { {"pad", WBF_U8}, {"value", WBF_F32} } },
+  { 0x26, WSC_SET_STUTTER,            3, { {"track", WBF_U8}, {"value", WBF_BOOL}, {"interval", WBF_U16} } },
+  { 0x27, WSC_SET_STUTTER,            3, { {"track", WBF_U8}, {"active", WBF_BOOL}, {"interval", WBF_U16} } },
+  { 0x28, WSC_SET_STUTTER,            3, { {"pad", WBF_U8}, {"active", WBF_BOOL}, {"interval", WBF_U16} } },
+  // ── Synth ──
+  { 0x29, WSC_SYNTH_NOTE_ON_EX,  5, { {"engine", WBF_U8}, {"note", WBF_U8}, {"velocity", WBF_U8}, {"accent", WBF_BOOL}, {"slide", WBF_BOOL} } },
+  { 0x2A, WSC_SYNTH_NOTE_OFF,    2, { {"track", WBF_U8}, {"engine", WBF_U8} } },
+  { 0x2B, WSC_SYNTH_PARAM,       4, { {"engine", WBF_U8}, {"instrument", WBF_U8}, {"paramId", WBF_U8}, {"value", WBF_F32} } },
+  { 0x2C, WSC_SYNTH303_PARAM,    2, { {"paramId", WBF_U8}, {"value", WBF_F32} } },
+};
+static constexpr size_t kBinSchemaCount = sizeof(kBinSchemas) / sizeof(kBinSchemas[0]);
+
+static const WsBinSchema* findSchema(uint8_t opcode) {
+  // Opcodes densos desde 0x01 → índice directo
+  if (opcode == 0 || opcode > kBinSchemaCount) return nullptr;
+  const WsBinSchema* s = &kBinSchemas[opcode - 1];
+  return (s->opcode == opcode) ? s : nullptr;
+}
+
+static size_t fieldSize(WsBinFieldType t) {
+  switch (t) {
+    case WBF_U16: return 2;
+    case WBF_F32: return 4;
+    default:      return 1;
+  }
+}
+
+const WsCommandInfo* wsBinaryDecode(const uint8_t* data, size_t len, JsonDocument& doc,
+                                    uint32_t* rid) {
+  if (!data || len < 2 || data[0] != WS_BIN_CMD_V1) return nullptr;
+  const WsBinSchema* schema = findSchema(data[1]);
+  if (!schema) return nullptr;
+
+  size_t need = 2;
+  for (uint8_t i = 0; i < schema->fieldCount; i++) need += fieldSize(schema->fields[i].type);
+  if (len != need && len != need + 2) return nullptr;
+  if (rid) *rid = (len == need + 2) ? (uint32_t)(data[need] | (data[need + 1] << 8)) : 0;
+
+  const uint8_t* p = data + 2;
+  for (uint8_t i = 0; i < schema->fieldCount; i++) {
+    const WsBinField& f = schema->fields[i];
+    switch (f.type) {
+      case WBF_U8:
+        doc[f.key] = p[0];
+        break;
+      case WBF_U16:
+        doc[f.key] = (uint16_t)(p[0] | (p[1] << 8));
+        break;
+      case WBF_F32: {
+        uint32_t bits = (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                        ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        float v;
+        memcpy(&v, &bits, sizeof(v));
+        if (!isfinite(v)) return nullptr;
+        // JSON.stringify(1.0) → "1": mantener el mismo tipo que vería el parser
+        if (v == floorf(v) && fabsf(v) < 16777216.0f) doc[f.key] = (long)v;
+        else doc[f.key] = v;
+        break;
+      }
+      case WBF_BOOL:
+        doc[f.key] = (p[0] != 0);
+        break;
+    }
+    p += fieldSize(f.type);
+  }
+  return commandById(schema->cmd);
+}
@@ -0,0 +1,62 @@
+/*
+ * WsBinaryProtocol.h
+ * RED808 protocolo binario WebSocket para comandos de alta frecuencia
+ * Browser → ESP32. El JSON de texto sigue siendo válido para todo lo demás.
+ */
+
+#ifndef WS_BINARY_PROTOCOL_H
+#define WS_BINARY_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+#include "CommandTable.h"
+
+// ═══════════════════════════════════════════════════════
+// FRAME FORMAT
+// ═══════════════════════════════════════════════════════
+// [0x90, pad, vel]                 trigger (legacy, sin versión)
+// [0x90, pad, vel, ridLo, ridHi]   trigger con ACK (rid 1..65535, ver CmdAck.h)
+// [0xB1, opcode, args...]          comando v1, args little-endian, tamaño fijo por opcode
+// [0xB1, opcode, args..., ridLo, ridHi]  igual con ACK (binProto >= 4)
+// [0xB2, ...]                      patrón completo (ver PatternCodec.h), ambos sentidos
+// [0xB4, ...]                      eventos del secuenciador (ver SeqEventRing.h), server → browser
+//
+// El servidor anuncia la versión en el mensaje "connected" ("binProto":4);
+// el cliente anuncia la suya en "init" para recibir patrones y eventos binarios.
+// El cliente sólo usa binario si el conjunto de claves del comando coincide
+// exactamente con el esquema del opcode; si no, envía JSON.
+// Mantener sincronizado con WS_BIN_SCHEMAS en data/web/app.js.
+
+#define WS_BIN_TRIGGER        0x90
+#define WS_BIN_CMD_V1         0xB1
+#define WS_BIN_PROTO_VERSION  4   // 1 = comandos 0xB1, 2 = + patrones 0xB2, 3 = + eventos 0xB4, 4 = + rid en 0xB1
+
+enum WsBinFieldType : uint8_t {
+  WBF_U8   = 0,   // 1 byte
+  WBF_U16  = 1,   // 2 bytes LE
+  WBF_F32  = 2,   // 4 bytes IEEE754 LE (entero si no tiene decimales, igual que JSON)
+  WBF_BOOL = 3    // 1 byte 0/1
+};
+
+#define WS_BIN_MAX_FIELDS 5
+
+struct WsBinField {
+  const char*    key;   // literal — ArduinoJson guarda el puntero, sin copia
+  WsBinFieldType type;
+};
+
+struct WsBinSchema {
+  uint8_t    opcode;
+  WsCmdId    cmd;
+  uint8_t    fieldCount;
+  WsBinField fields[WS_BIN_MAX_FIELDS];
+};
+
+// Decodifica un frame [0xB1, opcode, args...] en doc (sin parsear texto).
+// Devuelve la entrada de la tabla de comandos o nullptr si el frame no es válido.
+// rid (opcional): 0 o el rid de los 2 bytes finales
+const WsCommandInfo* wsBinaryDecode(const uint8_t* data, size_t len, JsonDocument& doc,
+                                    uint32_t* rid = nullptr);
+
+#endif // WS_BINARY_PROTOCOL_H
@@ -0,0 +1,58 @@
+/*
+ * WsTopics.cpp
+ * RED808 topics de suscripción (ver WsTopics.h)
+ */
+
+#include "WsTopics.h"
+#include "WebInterface.h"
+#include <string.h>
+
+static const char* const kTopicNames[TOPIC_COUNT] = {
+  "levels", "steps", "transport", "mixer", "pattern", "samples", "logs"
+};
+
+const char* wsTopicName(WsTopic t) {
+  return t < TOPIC_COUNT ? kTopicNames[t] : "?";
+}
+
+bool wsTopicFromName(const char* name, WsTopic* out) {
+  if (!name) return false;
+  for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+    if (strcmp(name, kTopicNames[i]) == 0) {
+      *out = (WsTopic)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint8_t wsTopicMaskFromJson(JsonVariantConst arr) {
+  uint8_t mask = 0;
+  for (JsonVariantConst v : arr.as<JsonArrayConst>()) {
+    WsTopic t;
+    if (wsTopicFromName(v.as<const char*>(), &t)) mask |= TOPIC_BIT(t);
+  }
+  return mask;
+}
+
+void wsTopicMaskToJson(uint8_t mask, JsonArray out) {
+  for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+    if (mask & TOPIC_BIT(i)) out.add(kTopicNames[i]);
+  }
+}
+
+uint8_t wsTopicStateSections(uint8_t mask) {
+  uint8_t sec = 0;
+  if (mask & TOPIC_BIT(TOPIC_TRANSPORT)) sec |= STATE_SEC_TRANSPORT;
+  if (mask & TOPIC_BIT(TOPIC_MIXER))     sec |= STATE_SEC_MIXER | STATE_SEC_FX;
+  if (mask & TOPIC_BIT(TOPIC_PATTERN))   sec |= STATE_SEC_PATTERN;
+  if (mask & TOPIC_BIT(TOPIC_SAMPLES))   sec |= STATE_SEC_SAMPLES;
+  return sec;
+}
+
+// step* (stepSet, stepVelocitySet, step*LockSet...) editan el patrón actual;
+// el resto (trackFxSet, padFxSet, trackVolumeSet, masterFx...) es mezcla
+WsTopic wsTopicOfEcho(const char* type) {
+  if (type && strncmp(type, "step", 4) == 0) return TOPIC_PATTERN;
+  return TOPIC_MIXER;
+}
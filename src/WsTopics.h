@@ -0,0 +1,49 @@
+/*
+ * WsTopics.h
+ * RED808 suscripción por topics de los streams salientes (WS y UDP):
+ * cada cliente declara qué pinta y el servidor no codifica ni envía
+ * lo que nadie ha pedido (meters, steps, estado, ecos, logs SPI).
+ */
+
+#ifndef WS_TOPICS_H
+#define WS_TOPICS_H
+
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+enum WsTopic : uint8_t {
+  TOPIC_LEVELS = 0,    // frame 0xAA de meters (150 ms) — sin nadie se para el polling SPI
+  TOPIC_STEPS,         // 0xB4 step/trigger, {"type":"step"}, {"type":"pad"}
+  TOPIC_TRANSPORT,     // sección transport del estado, songPattern
+  TOPIC_MIXER,         // secciones mixer + fx del estado, ecos de volumen/FX
+  TOPIC_PATTERN,       // sección pattern, frames de patrón, ecos de step (filtro "pattern":N)
+  TOPIC_SAMPLES,       // sección samples, upload/trim/sampleLoaded
+  TOPIC_LOGS,          // {"type":"spi_log"} — sólo con suscripción explícita
+  TOPIC_COUNT
+};
+
+#define TOPIC_BIT(t)         ((uint8_t)(1u << (t)))
+#define TOPIC_MASK_ALL       ((uint8_t)((1u << TOPIC_COUNT) - 1))
+// Clientes que no mandan "subscribe" reciben lo mismo que antes (todo menos logs)
+#define TOPIC_MASK_DEFAULT   ((uint8_t)(TOPIC_MASK_ALL & ~TOPIC_BIT(TOPIC_LOGS)))
+// Slaves UDP: los meters (0xAA binario) sólo a quien los pide con "subscribe"
+#define TOPIC_MASK_UDP_DEFAULT ((uint8_t)(TOPIC_MASK_DEFAULT & ~TOPIC_BIT(TOPIC_LEVELS)))
+#define TOPIC_PATTERN_ANY    0xFF
+
+const char* wsTopicName(WsTopic t);
+// false si el nombre no existe
+bool wsTopicFromName(const char* name, WsTopic* out);
+// ["levels","mixer",...] → máscara; nombres desconocidos se ignoran
+uint8_t wsTopicMaskFromJson(JsonVariantConst arr);
+void wsTopicMaskToJson(uint8_t mask, JsonArray out);
+
+// Secciones STATE_SEC_* que ve un cliente con esta máscara (0 = ningún "state")
+uint8_t wsTopicStateSections(uint8_t mask);
+// Topic de un eco de edición según su "type" (stepSet, trackFxSet...)
+WsTopic wsTopicOfEcho(const char* type);
+// patternSub = TOPIC_PATTERN_ANY o índice concreto
+inline bool wsTopicWantsPattern(uint8_t mask, uint8_t patternSub, int pattern) {
+  return (mask & TOPIC_BIT(TOPIC_PATTERN)) && (patternSub == TOPIC_PATTERN_ANY || patternSub == pattern);
+}
+
+#endif // WS_TOPICS_H
@@ -10,6 +10,8 @@
 #include "WebInterface.h"
 #include "MIDIController.h"
 #include "SysLog.h"
+#include "SampleIndex.h"
+#include "PcmStore.h"
 #if ENABLE_PHYSICAL_BUTTONS
 #include "PhysControlButtons.h"
 #endif
@@ -542,6 +544,15 @@ void setup() {
     // 3. Sample Manager (modo Daisy-first: sin precarga local en boot)
     sampleManager.begin();
     syslog("BOOT", "SampleManager OK, heap=%u", ESP.getFreeHeap());
+    // Índice de la librería (samples.idx de build o un único escaneo si falta)
+    if (sampleIndexBegin()) {
+        syslog("BOOT", "SampleIndex OK, %u samples", (unsigned)sampleIndexCount());
+    }
+    // PCM pre-convertido en la partición pcmstore (sólo el env redmaster-s3-r8n16-pcmstore)
+    if (pcmStoreBegin()) {
+        syslog("BOOT", "PcmStore OK, %u samples, %u KB", (unsigned)pcmStoreStats().entries,
+               (unsigned)(pcmStoreStats().imageBytes / 1024));
+    }
     bool shouldPreloadLocalSamples = BOOT_PRELOAD_LOCAL_SAMPLES;
     if (shouldPreloadLocalSamples) {
         SdStatusResponse sdStatus = {};
@@ -690,6 +701,7 @@ void setup() {
 
     // Step callback: cuando un track usa synth engine, enviar synthTrigger por SPI
     sequencer.setStepCallback([](int track, uint8_t velocity, uint8_t trackVolume, uint32_t noteLenSamples) {
+        webInterface.broadcastSeqTrigger(track, velocity);  // flash exacto en la UI (cola SPSC)
         int8_t engine = getTrackSynthEngine(track);
         if (engine < 0) return;  // sampler → la Daisy ya lo dispara internamente
         // Synth engine: el ESP32 envía el trigger por SPI
@@ -719,6 +731,7 @@ void setup() {
     // Callback para sincronización en tiempo real con la web
     sequencer.setStepChangeCallback([](int newStep) {
         webInterface.broadcastStep(newStep);
+        spiMaster.releaseBatch();   // batch atómico (applyBatch): sale en process(), tras los triggers del step
     });
     // Callback para cambio de patrón en song mode
     sequencer.setPatternChangeCallback([](int newPattern, int songLength) {
@@ -1106,12 +1119,14 @@ void setup() {
                 if (nowPlaying) { sequencer.start(); spiMaster.dsqControl(1); }
                 else            { sequencer.stop();  spiMaster.dsqControl(0); }
                 ctrlButtons.setLedState(btnIdx, nowPlaying);
+                webInterface.markStateDirty(STATE_SEC_TRANSPORT);
                 webInterface.broadcastSequencerState();
                 break;
             }
             case BTN_FUNC_STOP:
                 sequencer.stop(); spiMaster.dsqControl(0);
                 ctrlButtons.setLedState(btnIdx, false);
+                webInterface.markStateDirty(STATE_SEC_TRANSPORT);
                 webInterface.broadcastSequencerState();
                 break;
             case BTN_FUNC_NEXT_PATTERN:
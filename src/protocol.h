@@ -237,6 +237,16 @@ typedef struct __attribute__((packed)) {
 #define CMD_SD_GET_LOADED     0xB8  // Get currently loaded kit name + pad map
 #define CMD_SD_ABORT          0xB9  // Abort ongoing SD load operation
 
+// ═══════════════════════════════════════════════════════
+// COMMANDS: SAMPLE SLOTS (0xBA - 0xBB)
+//   Dedup de uploads: el master guarda XXH32 + longitud de lo que tiene
+//   cada pad de la Daisy y sólo envía audio que no esté ya allí.
+//   Hash = XXH32 semilla 0 sobre el int16 LE del pad (0 = vacío/desconocido).
+//   Firmware sin estos comandos: no responde a 0xBB y el master no usa 0xBA.
+// ═══════════════════════════════════════════════════════
+#define CMD_SAMPLE_COPY       0xBA  // Copiar el sample de un pad a otro (sin DATA)
+#define CMD_SAMPLE_HASHES     0xBB  // Hash + longitud de cada pad (tras reboot/reconexión)
+
 // ═══════════════════════════════════════════════════════
 // COMMANDS: SYNTH ENGINES (0xC0 - 0xCF)
 //   Daisy Seed onboard synthesis: TR-808, TR-909, TR-505,
@@ -853,6 +863,29 @@ typedef struct __attribute__((packed)) {
     uint8_t  padIndex;       // 0-23
 } SampleUnloadPayload;
 
+// CMD_SAMPLE_COPY (0xBA) — 12 bytes. La Daisy comprueba hash/longitud del
+// origen antes de copiar; si no coinciden ignora el comando (el destino queda
+// con hash 0 y el siguiente CMD_SAMPLE_HASHES lo refleja)
+typedef struct __attribute__((packed)) {
+    uint8_t  srcPad;         // 0-23
+    uint8_t  dstPad;         // 0-23
+    uint16_t reserved;
+    uint32_t hash;           // XXH32 esperado del origen
+    uint32_t totalSamples;
+} SampleCopyPayload;
+
+// CMD_SAMPLE_HASHES (0xBB) response — 4 + 8 × 24 = 196 bytes
+typedef struct __attribute__((packed)) {
+    uint32_t hash;           // 0 = pad vacío o hash no calculado (carga desde SD)
+    uint32_t totalSamples;
+} SampleSlotInfo;
+
+typedef struct __attribute__((packed)) {
+    uint8_t        count;    // pads reportados (= MAX_PADS de la Daisy)
+    uint8_t        reserved[3];
+    SampleSlotInfo slots[24];
+} SampleHashesResponse;
+
 // --- Status Responses ---
 typedef struct __attribute__((packed)) {
     float trackPeaks[16];    // 0.0-1.0 per track
@@ -0,0 +1,223 @@
+/*
+ * bench_command_table.cpp
+ * RED808 — lookup hash de CommandTable frente a la cadena strcmp anterior
+ * de processCommand() (comparación lineal en el orden histórico del X-macro)
+ * y frente a la cadena String if/else real de antes de la tabla, con los
+ * nombres de una traza de tools/loadtest.py
+ */
+// host-build: src/CommandTable.cpp test/host/shim/arduino_shim.cpp
+// host-flags: -Itest/host/shim
+
+#include <Arduino.h>
+#include "CommandTable.h"
+#include "host_check.h"
+#include <chrono>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define RED808_CMD_NAME(id, name, flags) name,
+static const char* const kNames[WSC_COUNT] = {
+  RED808_COMMAND_LIST(RED808_CMD_NAME)
+};
+#undef RED808_CMD_NAME
+
+// La cadena if/else original: cmd == "hello" ... en orden, primera que coincide
+static int strcmpChainLookup(const char* name) {
+  for (int i = 0; i < WSC_COUNT; i++) {
+    if (strcmp(kNames[i], name) == 0) return i;
+  }
+  return -1;
+}
+
+// ── processCommand() antes de CommandTable (49c581f) ──
+// String cmd = doc["cmd"]; los cuatro grupos de throttle se evalúan para
+// todo comando y luego el if/else. Un || de la cadena cuenta como
+// comparaciones seguidas. El String del shim no tiene SSO: los nombres de
+// <= 11 caracteres pagan aquí un malloc que el ESP32 se ahorra.
+static const char* const kBaselineMasterFx[] = {
+  "setFilter", "setFilterCutoff", "setFilterResonance", "setBitCrush", "setDistortion",
+  "setSampleRate", "setDelayTime", "setDelayFeedback", "setDelayMix", "setPhaserRate",
+  "setPhaserDepth", "setPhaserFeedback", "setFlangerRate", "setFlangerDepth", "setFlangerFeedback",
+  "setFlangerMix", "setCompressorThreshold", "setCompressorRatio", "setCompressorAttack",
+  "setCompressorRelease", "setCompressorMakeupGain",
+};
+static const char* const kBaselineTrackFx[] = {
+  "setTrackFilter", "setTrackDistortion", "setTrackBitCrush", "setTrackEcho", "setTrackFlanger",
+  "setTrackCompressor",
+};
+static const char* const kBaselinePadFx[] = {
+  "setPadFilter", "setPadDistortion", "setPadBitCrush",
+};
+static const char* const kBaselineVolume[] = {
+  "setSequencerVolume", "setLiveVolume", "setTrackVolume", "setVolume", "setLivePitch",
+};
+static const char* const kBaselineChain[] = {
+  "hello", "get_state", "getState", "trigger", "setStep", "start", "stop", "clearPattern",
+  "clearPatterns", "setSongMode", "tempo", "setStepCount", "selectPattern", "loadSample",
+  "trimSample", "getXtraSamples", "loadXtraSample", "mute", "solo", "toggleLoop", "setLoopType",
+  "pauseLoop", "setLedMonoMode", "setFilter", "setFilterCutoff", "setFilterResonance",
+  "setBitCrush", "setDistortion", "setDistortionMode", "setSampleRate", "setDelayActive",
+  "setDelayTime", "setDelayFeedback", "setDelayMix", "setPhaserActive", "setPhaserRate",
+  "setPhaserDepth", "setPhaserFeedback", "setFlangerActive", "setFlangerRate", "setFlangerDepth",
+  "setFlangerFeedback", "setFlangerMix", "setCompressorActive", "setCompressorThreshold",
+  "setCompressorRatio", "setCompressorAttack", "setCompressorRelease", "setCompressorMakeupGain",
+  "setReverbActive", "setReverbFeedback", "setReverbLpFreq", "setReverbMix", "setChorusActive",
+  "setChorusRate", "setChorusDepth", "setChorusMix", "setTremoloActive", "setTremoloRate",
+  "setTremoloDepth", "setWavefolderGain", "setLimiterActive", "setTrackReverbSend",
+  "setTrackDelaySend", "setTrackChorusSend", "setTrackPan", "setTrackDspMute", "setTrackSolo",
+  "setTrackPhaser", "setTrackTremolo", "setTrackPitch", "setTrackGate", "setTrackEq",
+  "setTrackEqLow", "setTrackEqMid", "setTrackEqHigh", "setPadDistortion", "setPadBitCrush",
+  "clearPadFX", "setTrackDistortion", "setTrackBitCrush", "clearTrackFX", "setReverse",
+  "setPitchShift", "setStutter", "setTrackEcho", "setTrackFlanger", "setTrackCompressor",
+  "setSidechainPro", "clearTrackLiveFX", "setSequencerVolume", "setLiveVolume", "setVolume",
+  "stopAllSounds", "setLivePitch", "setTrackFilter", "clearTrackFilter", "setPadFilter",
+  "clearPadFilter", "getFilterPresets", "setStepVelocity", "getStepVelocity", "setStepVolumeLock",
+  "setStepProbability", "setStepCutoffLock", "setStepReverbSendLock", "setStepRatchet",
+  "setStepNote", "setHumanize", "getStepVolumeLock", "getStepCutoffLock", "getStepReverbSendLock",
+  "get_pattern", "setTrackVolume", "getTrackVolume", "getTrackVolumes", "setTrackSynthEngine",
+  "applyKitToAllPads", "setMidiScan", "sdListKits", "sdLoadKit", "sdUnloadKit", "sdLoadSample",
+  "sdListFolders", "sdListFiles", "sdGetStatus", "sdAbort", "setDaisyPerfStress", "synthTrigger",
+  "synthParam", "setWtNote", "synth303NoteOn", "synthNoteOnEx", "melodyRecToggle",
+  "melodySetEngine", "melodySetOctave", "melodySetPad", "melodyRecNote", "melodyAssign",
+  "melodyClear", "synth303NoteOff", "synthNoteOff", "synth303Param", "synthActive", "synthPreset",
+  "setMasterFxRoute", "setAutoWahActive", "setAutoWahLevel", "setAutoWahMix", "setStereoWidth",
+  "setTapeStop", "setBeatRepeat", "setDelayStereo", "setChorusStereo", "setEarlyRefActive",
+  "setEarlyRefMix", "setChokeGroup", "songChainUpload", "songChainControl", "songGetPos",
+  "setTrackLfo",
+};
+
+#define COUNT_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+template <int N>
+static bool anyOf(const String& cmd, const char* const (&names)[N]) {
+  for (int i = 0; i < N; i++) {
+    if (cmd == names[i]) return true;
+  }
+  return false;
+}
+
+static int baselineStringChain(const char* name) {
+  String cmd = name;
+  int fast = anyOf(cmd, kBaselineMasterFx) ? 1 : anyOf(cmd, kBaselineTrackFx) ? 2
+           : anyOf(cmd, kBaselinePadFx) ? 3 : anyOf(cmd, kBaselineVolume) ? 4 : 0;
+  for (int i = 0; i < COUNT_OF(kBaselineChain); i++) {
+    if (cmd == kBaselineChain[i]) return i + fast;   // fast en el resultado: que no se elimine
+  }
+  return -1;
+}
+
+// Nombres de "cmd" de una traza JSONL ({"t":..,"via":..,"cmd":{"cmd":"X",..}})
+static std::vector<std::string> loadTraceNames(const char* path) {
+  std::vector<std::string> out;
+  FILE* f = fopen(path, "r");
+  if (!f) return out;
+  static const char kKey[] = "\"cmd\":{\"cmd\":\"";
+  char line[1024];
+  while (fgets(line, sizeof(line), f)) {
+    const char* p = strstr(line, kKey);
+    if (!p) continue;
+    p += sizeof(kKey) - 1;
+    const char* q = strchr(p, '"');
+    if (q) out.emplace_back(p, q - p);
+  }
+  fclose(f);
+  return out;
+}
+
+static volatile int sink = 0;
+
+template <typename F>
+static double nsPerLookup(const char* const* mix, int mixLen, int rounds, F fn) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < mixLen; i++) sink += fn(mix[i]);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)rounds * mixLen);
+}
+
+int main() {
+  commandTableInit();
+
+  // Correctitud: cada nombre resuelve a su id, nombres ajenos a nullptr
+  for (int i = 0; i < WSC_COUNT; i++) {
+    const WsCommandInfo* info = commandLookup(kNames[i]);
+    CHECK_MSG(info && info->id == i, "%s", kNames[i]);
+    CHECK(commandById((WsCmdId)i) == info);
+  }
+  CHECK(commandLookup(nullptr) == nullptr);
+  CHECK(commandLookup("") == nullptr);
+  CHECK(commandLookup("setFilterCutof") == nullptr);
+  CHECK(commandLookup("SETFILTERCUTOFF") == nullptr);
+  CHECK(commandById(WSC_COUNT) == nullptr);
+
+  // Campos obligatorios: nombres únicos y ninguna máscara fuera de la tabla
+  for (int i = 0; i < CMDR_FIELD_COUNT; i++) {
+    CHECK_MSG(kCommandRequiredFieldNames[i] && kCommandRequiredFieldNames[i][0], "campo %d", i);
+    for (int j = 0; j < i; j++) CHECK(strcmp(kCommandRequiredFieldNames[i], kCommandRequiredFieldNames[j]) != 0);
+  }
+  for (int i = 0; i < WSC_COUNT; i++) {
+    CHECK_MSG((commandRequiredFields((WsCmdId)i) >> CMDR_FIELD_COUNT) == 0, "%s", kNames[i]);
+  }
+  CHECK(commandRequiredFields(WSC_SET_TRACK_PAN) == (CMDR_TRACK | CMDR_VALUE));
+  CHECK(commandRequiredFields(WSC_SET_STEP) == (CMDR_TRACK | CMDR_STEP | CMDR_ACTIVE));
+  CHECK(commandRequiredFields(WSC_TRIGGER) == CMDR_PAD);
+  CHECK(commandRequiredFields(WSC_START) == 0);
+  CHECK(commandRequiredFields(WSC_BATCH) == 0);
+
+  // Mezcla de directo: knobs al final de la lista (peor caso de la cadena),
+  // triggers al principio y un comando desconocido
+  static const char* const kMix[] = {
+    "setFilterCutoff", "setTrackPan", "trigger", "synthParam", "synth303Param",
+    "setTrackVolume", "setStep", "setDelayMix", "getState", "setTrackLfo", "noSuchCommand",
+  };
+  const int mixLen = (int)(sizeof(kMix) / sizeof(kMix[0]));
+  const int rounds = 200000;
+
+  double chainNs = nsPerLookup(kMix, mixLen, rounds, [](const char* n) { return strcmpChainLookup(n); });
+  double hashNs = nsPerLookup(kMix, mixLen, rounds, [](const char* n) {
+    const WsCommandInfo* info = commandLookup(n);
+    return info ? (int)info->id : -1;
+  });
+
+  // Peor caso de la cadena: el último comando de la lista
+  const char* last[] = { kNames[WSC_COUNT - 1] };
+  double chainLastNs = nsPerLookup(last, 1, rounds, [](const char* n) { return strcmpChainLookup(n); });
+  double hashLastNs = nsPerLookup(last, 1, rounds, [](const char* n) {
+    const WsCommandInfo* info = commandLookup(n);
+    return info ? (int)info->id : -1;
+  });
+
+  printf("  %d comandos\n", (int)WSC_COUNT);
+  printf("  mezcla directo : strcmp %7.1f ns  hash %6.1f ns  (x%.1f)\n", chainNs, hashNs, chainNs / hashNs);
+  printf("  último comando : strcmp %7.1f ns  hash %6.1f ns  (x%.1f)\n", chainLastNs, hashLastNs, chainLastNs / hashLastNs);
+  CHECK(hashNs < chainNs);
+
+  // Traza grabada contra la cadena String real de antes
+  std::vector<std::string> traceNames = loadTraceNames("test/host/traces/live_mix.jsonl");
+  CHECK(!traceNames.empty());
+  std::vector<const char*> trace;
+  for (const std::string& n : traceNames) trace.push_back(n.c_str());
+  for (const char* n : trace) {
+    CHECK_MSG(baselineStringChain(n) >= 0, "%s", n);
+    CHECK_MSG(commandLookup(n) != nullptr, "%s", n);
+  }
+  if (!trace.empty()) {
+    const int traceLen = (int)trace.size();
+    const int traceRounds = 2000;
+    double baseNs = nsPerLookup(trace.data(), traceLen, traceRounds,
+                                [](const char* n) { return baselineStringChain(n); });
+    double traceChainNs = nsPerLookup(trace.data(), traceLen, traceRounds,
+                                      [](const char* n) { return strcmpChainLookup(n); });
+    double traceHashNs = nsPerLookup(trace.data(), traceLen, traceRounds, [](const char* n) {
+      const WsCommandInfo* info = commandLookup(n);
+      return info ? (int)info->id : -1;
+    });
+    printf("  traza (%d cmds): String 49c581f %7.1f ns  strcmp %6.1f ns  hash %6.1f ns  (x%.1f)\n",
+           traceLen, baseNs, traceChainNs, traceHashNs, baseNs / traceHashNs);
+    CHECK(traceHashNs < baseNs);
+  }
+
+  return hostCheckResult("command_table");
+}
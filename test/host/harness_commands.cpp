@@ -0,0 +1,408 @@
+/*
+ * harness_commands.cpp
+ * RED808 — arnés de host de la ruta de comandos: WebInterface real
+ * (processCommand vía frames WS JSON/0xB1 y handleUdp) enlazado contra
+ * AsyncWebSocket, WiFiUDP y SPIMaster de test/host/shim. Reproduce una traza
+ * de tools/loadtest.py con el reloj virtual y da, por canal y comando,
+ * latencia, asignaciones, bytes retenidos, pico de heap y frames SPI.
+ *
+ *   harness_commands [traza.jsonl] [--json]
+ *
+ * Sin argumentos: test/host/traces/live_mix.jsonl. Como app.js, los
+ * comandos WS con esquema binario salen como 0xB1 (trigger como 0x90);
+ * --json los manda todos como texto. La latencia es CPU del host: sirve para
+ * comparar cambios, no son µs del ESP32. /api/cmdprof (CmdProfiler) se
+ * imprime al final como referencia cruzada.
+ */
+// host-requires: ArduinoJson red808_protocol
+// host-build: src/WebInterface.cpp src/CommandTable.cpp src/IngressLimiter.cpp src/CmdAck.cpp
+// host-build: src/CmdProfiler.cpp src/WsBinaryProtocol.cpp src/WsTopics.cpp src/UdpSync.cpp
+// host-build: src/SeqEventRing.cpp src/PatternCodec.cpp src/JsonStream.cpp src/SlabPool.cpp
+// host-build: src/HeapProfiler.cpp src/Sequencer.cpp src/SampleManager.cpp src/WavStream.cpp
+// host-build: src/WavePeaks.cpp src/Resampler.cpp src/PcmConvert.cpp src/SampleHash.cpp
+// host-build: src/SampleIndex.cpp src/SampleCache.cpp src/PcmStore.cpp src/WebAssetCache.cpp
+// host-build: src/SysLog.cpp
+// host-build: test/host/shim/arduino_shim.cpp test/host/shim/host_heap.cpp test/host/shim/net_shim.cpp
+// host-build: test/host/shim/spi_master_stub.cpp test/host/shim/firmware_stubs.cpp
+// host-flags: -Itest/host/shim -DENABLE_PHYSICAL_BUTTONS=0
+// host-flags: -Wno-unused-parameter -Wno-unused-variable -Wno-unused-function -Wno-reorder
+// host-flags: -Wno-format -Wno-format-truncation -Wno-misleading-indentation
+// host-link: -Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <WiFiUdp.h>
+#include "WebInterface.h"
+#include "WsBinaryProtocol.h"
+#include "CmdProfiler.h"
+#include "host_firmware.h"
+#include "host_check.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+WebInterface webInterface;
+
+static constexpr uint16_t kSlavePort = 40000;
+static constexpr uint32_t kUpdatePeriodMs = 10;   // systemTask llama a update() cada ~10 ms
+static constexpr int kUdpSlaves = 8;
+static constexpr int kWsClients = 3;              // onWebSocketEvent rechaza el cuarto
+
+// ═══════════════════════════════════════════════════════
+// TRAZA
+// ═══════════════════════════════════════════════════════
+
+struct TraceEvent {
+  double tMs;
+  bool ws;
+  int src;
+  std::string cmd;    // objeto "cmd" serializado, sin "rid"
+};
+
+static bool loadTrace(const char* path, std::vector<TraceEvent>& out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[1024];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] != '{') continue;
+    StaticJsonDocument<1024> doc;
+    if (deserializeJson(doc, line)) continue;
+    TraceEvent ev;
+    ev.tMs = doc["t"] | 0.0;
+    ev.ws = strcmp(doc["via"] | "udp", "ws") == 0;
+    ev.src = doc["src"] | 0;
+    char buf[512];
+    size_t n = serializeJson(doc["cmd"], buf, sizeof(buf));
+    if (n == 0 || n >= sizeof(buf)) continue;
+    ev.cmd.assign(buf, n);
+    out.push_back(ev);
+  }
+  fclose(f);
+  std::stable_sort(out.begin(), out.end(), [](const TraceEvent& a, const TraceEvent& b) { return a.tMs < b.tMs; });
+  return true;
+}
+
+// ── Codificador 0xB1 (lo que hace app.js con WS_BIN_SCHEMAS) ──
+// Sólo los comandos de la mezcla de loadtest; el resto va en JSON
+struct BinEncoding {
+  const char* cmd;
+  uint8_t opcode;
+  uint8_t fieldCount;
+  const char* keys[3];
+  WsBinFieldType types[3];
+};
+
+static const BinEncoding kBinEncodings[] = {
+  { "setStep",         0x01, 3, { "track", "step", "active" }, { WBF_U8, WBF_U8, WBF_BOOL } },
+  { "tempo",           0x09, 1, { "value" },                   { WBF_F32 } },
+  { "setFilterCutoff", 0x12, 1, { "value" },                   { WBF_F32 } },
+  { "setTrackPan",     0x1E, 2, { "track", "value" },          { WBF_U8, WBF_F32 } },
+};
+
+static size_t putField(uint8_t* out, WsBinFieldType type, JsonVariantConst v) {
+  switch (type) {
+    case WBF_U16: {
+      uint16_t x = v.as<uint16_t>();
+      out[0] = (uint8_t)x;
+      out[1] = (uint8_t)(x >> 8);
+      return 2;
+    }
+    case WBF_F32: {
+      float x = v.as<float>();
+      memcpy(out, &x, 4);   // host little-endian como el ESP32
+      return 4;
+    }
+    case WBF_BOOL:
+      out[0] = v.as<bool>() ? 1 : 0;
+      return 1;
+    default:
+      out[0] = v.as<uint8_t>();
+      return 1;
+  }
+}
+
+// Frame binario con rid, o 0 si el comando no encaja en un esquema
+static size_t encodeBinary(const char* json, uint16_t rid, uint8_t* out) {
+  StaticJsonDocument<512> doc;
+  if (deserializeJson(doc, json)) return 0;
+  const char* cmd = doc["cmd"] | "";
+  if (strcmp(cmd, "trigger") == 0 && doc.size() == 3 && doc.containsKey("pad") && doc.containsKey("vel")) {
+    out[0] = WS_BIN_TRIGGER;
+    out[1] = doc["pad"].as<uint8_t>();
+    out[2] = doc["vel"].as<uint8_t>();
+    out[3] = (uint8_t)rid;
+    out[4] = (uint8_t)(rid >> 8);
+    return 5;
+  }
+  for (const BinEncoding& e : kBinEncodings) {
+    if (strcmp(cmd, e.cmd) != 0 || doc.size() != (size_t)e.fieldCount + 1) continue;
+    size_t n = 0;
+    out[n++] = WS_BIN_CMD_V1;
+    out[n++] = e.opcode;
+    for (uint8_t i = 0; i < e.fieldCount; i++) {
+      if (!doc.containsKey(e.keys[i])) return 0;
+      n += putField(out + n, e.types[i], doc[e.keys[i]]);
+    }
+    out[n++] = (uint8_t)rid;
+    out[n++] = (uint8_t)(rid >> 8);
+    return n;
+  }
+  return 0;
+}
+
+// Mismo JSON con "rid" al final
+static size_t withRid(const std::string& cmd, uint16_t rid, char* out, size_t cap) {
+  if (cmd.size() < 2 || cmd.back() != '}') return 0;
+  int n = snprintf(out, cap, "%.*s,\"rid\":%u}", (int)cmd.size() - 1, cmd.c_str(), (unsigned)rid);
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
+
+// ═══════════════════════════════════════════════════════
+// ACKS
+// ═══════════════════════════════════════════════════════
+// 0 = pendiente, 1 = ack ok, 2 = nack; los hooks no asignan memoria
+static uint8_t _ackState[65536];
+static uint32_t _acks = 0, _nacks = 0, _dupAcks = 0;
+
+static void noteAck(const char* msg, size_t len) {
+  const char* r = (const char*)memmem(msg, len, "\"rid\":", 6);
+  if (!r) return;
+  uint32_t rid = (uint32_t)strtoul(r + 6, nullptr, 10);
+  if (rid == 0 || rid > 0xFFFF) return;
+  if (_ackState[rid]) _dupAcks++;
+  bool ok = memmem(msg, len, "\"ok\":true", 9) != nullptr;
+  _ackState[rid] = ok ? 1 : 2;
+  if (ok) _acks++;
+  else _nacks++;
+}
+
+static void onWsText(AsyncWebSocketClient*, const char* msg, size_t len) {
+  if (len >= 13 && memcmp(msg, "{\"type\":\"ack\"", 13) == 0) noteAck(msg, len);
+}
+
+static void onUdpSend(IPAddress, uint16_t, const char* data, size_t len) {
+  if (len >= 10 && memcmp(data, "{\"s\":\"ack\"", 10) == 0) noteAck(data, len);
+}
+
+// ═══════════════════════════════════════════════════════
+// MEDIDA
+// ═══════════════════════════════════════════════════════
+
+struct Row {
+  std::vector<uint32_t> ns;
+  uint64_t allocs = 0;
+  uint64_t bytes = 0;
+  int64_t retained = 0;
+  size_t peak = 0;        // mayor subida transitoria de heap interno en un mensaje
+  uint64_t spiFrames = 0;
+};
+
+static int64_t _retainedTotal = 0;   // sólo lo medido: el arnés también asigna
+
+struct Probe {
+  HostHeapStats heap;
+  uint32_t spi;
+  std::chrono::steady_clock::time_point t;
+
+  void start() {
+    hostHeapResetPeak();
+    heap = hostHeapStats();
+    spi = hostSpiStats().frames;
+    t = std::chrono::steady_clock::now();
+  }
+
+  void stop(Row& row) const {
+    auto t1 = std::chrono::steady_clock::now();
+    const HostHeapStats h = hostHeapStats();   // copia antes de que push_back asigne
+    uint32_t spi1 = hostSpiStats().frames;
+    row.ns.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t).count());
+    for (int i = 0; i < 2; i++) {
+      row.allocs += h.allocs[i] - heap.allocs[i];
+      row.bytes += h.bytes[i] - heap.bytes[i];
+      row.retained += (int64_t)h.live[i] - (int64_t)heap.live[i];
+    }
+    for (int i = 0; i < 2; i++) _retainedTotal += (int64_t)h.live[i] - (int64_t)heap.live[i];
+    size_t rise = h.peak[HOST_HEAP_INTERNAL] - heap.live[HOST_HEAP_INTERNAL];
+    if (rise > row.peak) row.peak = rise;
+    row.spiFrames += spi1 - spi;
+  }
+};
+
+static std::map<std::string, Row> _rows;
+static uint64_t _virtualUs = 0;
+static uint32_t _lastUpdateMs = 0;
+static uint32_t _ridSeq = 0;
+static uint32_t _sentWithRid = 0;
+
+static AsyncWebSocket* _ws = nullptr;
+static std::vector<AsyncWebSocketClient*> _clients;
+
+static IPAddress slaveIp(int src) { return IPAddress(192, 168, 4, (uint8_t)(100 + src % kUdpSlaves)); }
+
+static void pumpUpdate() {
+  uint32_t nowMs = (uint32_t)(_virtualUs / 1000);
+  while (nowMs - _lastUpdateMs >= kUpdatePeriodMs) {
+    _lastUpdateMs += kUpdatePeriodMs;
+    Probe p;
+    p.start();
+    webInterface.update();
+    p.stop(_rows["loop update()"]);
+  }
+}
+
+static void advanceTo(double tMs) {
+  uint64_t us = (uint64_t)(tMs * 1000.0);
+  if (us > _virtualUs) {
+    hostClockAdvance(us - _virtualUs);
+    _virtualUs = us;
+  }
+  pumpUpdate();
+}
+
+static void sendUdp(int src, const char* json, size_t len) {
+  hostUdpInject(slaveIp(src), kSlavePort, (const uint8_t*)json, len);
+  webInterface.handleUdp();
+}
+
+static void runEvent(const TraceEvent& ev, bool forceJson) {
+  uint16_t rid = (uint16_t)(_ridSeq++ % 0xFFFF + 1);
+  _ackState[rid] = 0;
+  char json[600];
+  size_t jsonLen = withRid(ev.cmd, rid, json, sizeof(json));
+  if (jsonLen == 0) return;
+
+  char name[40];
+  StaticJsonDocument<512> doc;
+  deserializeJson(doc, ev.cmd.c_str());
+  snprintf(name, sizeof(name), "%s", doc["cmd"] | "?");
+
+  uint8_t bin[32];
+  size_t binLen = (ev.ws && !forceJson) ? encodeBinary(ev.cmd.c_str(), rid, bin) : 0;
+  std::string key = std::string(!ev.ws ? "udp  " : binLen ? "ws/b " : "ws   ") + name;
+  Row& row = _rows[key];
+
+  _sentWithRid++;
+  Probe p;
+  p.start();
+  if (!ev.ws) {
+    sendUdp(ev.src, json, jsonLen);
+  } else {
+    AsyncWebSocketClient* c = _clients[ev.src % _clients.size()];
+    if (binLen) _ws->hostFrame(c, WS_BINARY, bin, binLen);
+    else _ws->hostFrame(c, WS_TEXT, (const uint8_t*)json, jsonLen);
+  }
+  p.stop(row);
+}
+
+static uint32_t percentileNs(std::vector<uint32_t> v, int pct) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  size_t idx = std::min(v.size() - 1, v.size() * pct / 100);
+  return v[idx];
+}
+
+static void report() {
+  printf("  %-28s %6s %9s %9s %9s %8s %8s %9s %7s %6s\n",
+         "canal/comando", "n", "media µs", "p99 µs", "max µs", "allocs", "B/msg", "retenido", "pico B", "spi");
+  for (const auto& kv : _rows) {
+    const Row& r = kv.second;
+    if (r.ns.empty()) continue;
+    double n = (double)r.ns.size();
+    uint64_t sum = 0;
+    uint32_t mx = 0;
+    for (uint32_t x : r.ns) {
+      sum += x;
+      mx = std::max(mx, x);
+    }
+    printf("  %-28s %6zu %9.1f %9.1f %9.1f %8.1f %8.0f %9lld %7zu %6.2f\n",
+           kv.first.c_str(), r.ns.size(), sum / n / 1000.0, percentileNs(r.ns, 99) / 1000.0, mx / 1000.0,
+           r.allocs / n, r.bytes / n, (long long)r.retained, r.peak, r.spiFrames / n);
+  }
+  const HostHeapStats& h = hostHeapStats();
+  printf("  heap interno: vivo %zu B  pico %zu B de %zu  |  PSRAM: vivo %zu B  pico %zu B\n",
+         h.live[HOST_HEAP_INTERNAL], h.peak[HOST_HEAP_INTERNAL], HOST_HEAP_INTERNAL_SIZE,
+         h.live[HOST_HEAP_PSRAM], h.peak[HOST_HEAP_PSRAM]);
+  printf("  acks %u  nacks %u  (rid enviados %u)  udp salida %u paquetes\n",
+         _acks, _nacks, _sentWithRid, hostUdpStats().packetsOut);
+
+  // Referencia cruzada: lo mismo que devolvería /api/cmdprof
+  printf("  cmdprof:");
+  for (int p = 0; p < CMDPROF_PATH_COUNT; p++) {
+    CmdProfStats st;
+    cmdProfPath((CmdProfPath)p, &st);
+    if (st.count == 0) continue;
+    printf("  %s n=%u media=%u µs p99<=%u µs", cmdProfPathName((CmdProfPath)p), st.count,
+           st.totalUs / st.count, cmdProfPercentileUs(st, 99));
+  }
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  const char* tracePath = "test/host/traces/live_mix.jsonl";
+  bool forceJson = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) forceJson = true;
+    else tracePath = argv[i];
+  }
+
+  std::vector<TraceEvent> trace;
+  CHECK_MSG(loadTrace(tracePath, trace), "%s", tracePath);
+  CHECK(!trace.empty());
+  if (trace.empty()) return hostCheckResult("harness_commands");
+
+  CHECK(webInterface.begin("RED808", "", nullptr, nullptr, 0));
+  _ws = AsyncWebSocket::hostLast();
+  CHECK(_ws != nullptr);
+  if (!_ws) return hostCheckResult("harness_commands");
+  AsyncWebSocketClient::hostOnText = onWsText;
+  hostUdpOnSend(onUdpSend);
+
+  // Los clientes se presentan como en loadtest: hello UDP y conexión WS
+  for (int i = 0; i < kWsClients; i++) _clients.push_back(_ws->hostConnect());
+  for (int s = 0; s < kUdpSlaves; s++) {
+    static const char kHello[] = "{\"cmd\":\"hello\",\"device\":\"harness\"}";
+    sendUdp(s, kHello, sizeof(kHello) - 1);
+  }
+
+  // Pasada 0 de calentamiento (primeros syncs periódicos, snapshot de estado,
+  // cachés); las dos siguientes se miden y la segunda no debe dejar más heap
+  // vivo que la primera
+  const double spanMs = trace.back().tMs + 1000.0;
+  int64_t retainedAfter[3] = {};
+  for (int pass = 0; pass < 3; pass++) {
+    if (pass == 1) {
+      _rows.clear();
+      cmdProfEnable(true, true);
+      hostHeapResetPeak();
+    }
+    const double base = pass * spanMs;
+    for (const TraceEvent& ev : trace) {
+      advanceTo(base + ev.tMs);
+      runEvent(ev, forceJson);
+    }
+    advanceTo(base + spanMs);   // coalescidos, ecos y acks pendientes
+    retainedAfter[pass] = _retainedTotal;
+  }
+
+  report();
+
+  // Cada comando con rid recibe exactamente un ack o nack, aunque lo limite el ingress
+  uint32_t pending = 0;
+  for (uint32_t i = 0; i < _sentWithRid && i < 0xFFFF; i++) {
+    if (_ackState[i + 1] == 0) pending++;
+  }
+  CHECK_MSG(pending == 0, "%u rid sin ack", pending);
+  CHECK_MSG(_acks + _nacks == _sentWithRid, "acks %u + nacks %u != %u", _acks, _nacks, _sentWithRid);
+  CHECK(_dupAcks == 0);
+  CHECK(_acks > 0);
+  // Sin fugas entre las dos pasadas medidas
+  CHECK_MSG(retainedAfter[2] <= retainedAfter[1], "retenido %lld → %lld B",
+            (long long)retainedAfter[1], (long long)retainedAfter[2]);
+  CHECK(hostSpiStats().frames > 0);
+  CHECK(hostHeapStats().untracked == 0);
+
+  return hostCheckResult("harness_commands");
+}
@@ -0,0 +1,38 @@
+/*
+ * host_check.h
+ * RED808 mini-harness para tests de host (tools/host_tests.py)
+ * CHECK no aborta: cuenta fallos y el test devuelve hostCheckResult()
+ */
+
+#ifndef HOST_CHECK_H
+#define HOST_CHECK_H
+
+#include <stdio.h>
+
+static int hostCheckFailures = 0;
+static int hostCheckCount = 0;
+
+#define CHECK(cond) do { \
+  hostCheckCount++; \
+  if (!(cond)) { \
+    hostCheckFailures++; \
+    fprintf(stderr, "  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+  } \
+} while (0)
+
+#define CHECK_MSG(cond, ...) do { \
+  hostCheckCount++; \
+  if (!(cond)) { \
+    hostCheckFailures++; \
+    fprintf(stderr, "  FAIL %s:%d: %s — ", __FILE__, __LINE__, #cond); \
+    fprintf(stderr, __VA_ARGS__); \
+    fputc('\n', stderr); \
+  } \
+} while (0)
+
+static inline int hostCheckResult(const char* name) {
+  printf("  %s: %d checks, %d fallos\n", name, hostCheckCount, hostCheckFailures);
+  return hostCheckFailures ? 1 : 0;
+}
+
+#endif // HOST_CHECK_H
@@ -0,0 +1,102 @@
+/*
+ * Arduino.h (shim de host)
+ * RED808 — lo mínimo del core Arduino-ESP32 para compilar la ruta de
+ * comandos en Linux (test/host/harness_commands.cpp). Tiempo real del host,
+ * heap contado por host_heap.cpp (interna / PSRAM como en el ESP32-S3).
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <cmath>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "WString.h"
+#include "Print.h"
+#include "IPAddress.h"
+#include "esp_heap_caps.h"
+
+using std::min;
+using std::max;
+using std::abs;
+using std::isnan;
+using std::isinf;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define IRAM_ATTR
+#define EXT_RAM_BSS_ATTR
+#define HEX 16
+#define DEC 10
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define LOW  0
+#define HIGH 1
+#define INPUT  0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+uint32_t esp_random();
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+
+inline bool psramFound() { return true; }
+
+// ps_malloc & co.: bloques contados en el heap PSRAM simulado
+void* ps_malloc(size_t size);
+void* ps_calloc(size_t n, size_t size);
+void* ps_realloc(void* ptr, size_t size);
+
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+  uint32_t getHeapSize();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getPsramSize();
+  uint32_t getFreePsram();
+  uint32_t getFlashChipSize() { return 16u * 1024u * 1024u; }
+  const char* getChipModel() { return "host"; }
+  void restart();
+};
+extern EspClass ESP;
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t len) override;
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,11 @@
+/*
+ * AsyncWebSocket.h (shim de host)
+ * En el host el WebSocket vive en ESPAsyncWebServer.h.
+ */
+
+#ifndef HOST_ASYNC_WEB_SOCKET_H
+#define HOST_ASYNC_WEB_SOCKET_H
+
+#include "ESPAsyncWebServer.h"
+
+#endif // HOST_ASYNC_WEB_SOCKET_H
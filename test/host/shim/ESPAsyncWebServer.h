@@ -0,0 +1,220 @@
+/*
+ * ESPAsyncWebServer.h (shim de host)
+ * RED808 — AsyncWebServer / AsyncWebSocket sin TCP. Las rutas HTTP se
+ * registran y se ignoran; el WebSocket guarda el handler de onEvent() para
+ * que el arnés entregue frames con hostConnect() / hostFrame() igual que
+ * AsyncTCP (WS_EVT_CONNECT, WS_EVT_DATA con AwsFrameInfo).
+ * Lo que el firmware envía a cada cliente se cuenta en el propio cliente;
+ * el último frame de texto queda en un buffer fijo (sin asignar memoria).
+ */
+
+#ifndef HOST_ESP_ASYNC_WEB_SERVER_H
+#define HOST_ESP_ASYNC_WEB_SERVER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <functional>
+#include <list>
+
+// ── HTTP ──
+
+enum WebRequestMethod : uint8_t {
+  HTTP_GET = 0x01, HTTP_POST = 0x02, HTTP_DELETE = 0x04, HTTP_PUT = 0x08,
+  HTTP_PATCH = 0x10, HTTP_HEAD = 0x20, HTTP_OPTIONS = 0x40, HTTP_ANY = 0x7F
+};
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const String& name, const String& value) : name_(name), value_(value) {}
+  const String& name() const { return name_; }
+  const String& value() const { return value_; }
+
+private:
+  String name_;
+  String value_;
+};
+
+class AsyncWebServerResponse {
+public:
+  explicit AsyncWebServerResponse(int code) : code_(code) {}
+  virtual ~AsyncWebServerResponse() {}
+  void addHeader(const char*, const char*) {}
+  void addHeader(const String&, const String&) {}
+  int code() const { return code_; }
+
+private:
+  int code_;
+};
+
+typedef std::function<size_t(uint8_t* buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+
+class AsyncWebServerRequest {
+public:
+  void* _tempObject = nullptr;
+
+  void send(AsyncWebServerResponse* response) { delete response; }
+  void send(int, const char* = nullptr, const char* = nullptr) {}
+  void send(int code, const char* type, const String& content) { send(code, type, content.c_str()); }
+  void send(int code, const String& type, const String& content = String()) { send(code, type.c_str(), content.c_str()); }
+  void send(fs::FS&, const String&, const char* = nullptr) {}
+  AsyncWebServerResponse* beginResponse(int code) { return new AsyncWebServerResponse(code); }
+  AsyncWebServerResponse* beginResponse(int code, const char*, const uint8_t*, size_t) { return new AsyncWebServerResponse(code); }
+  AsyncWebServerResponse* beginResponse(int code, const char*, const String&) { return new AsyncWebServerResponse(code); }
+  AsyncWebServerResponse* beginResponse(fs::FS&, const String&, const char* = nullptr) { return new AsyncWebServerResponse(404); }
+  AsyncWebServerResponse* beginChunkedResponse(const char*, AwsResponseFiller) { return new AsyncWebServerResponse(200); }
+  void redirect(const char*) {}
+
+  bool hasParam(const char*, bool = false, bool = false) const { return false; }
+  bool hasParam(const String&, bool = false, bool = false) const { return false; }
+  AsyncWebParameter* getParam(const char*, bool = false, bool = false) const { return nullptr; }
+  AsyncWebParameter* getParam(const String&, bool = false, bool = false) const { return nullptr; }
+  bool hasHeader(const char*) const { return false; }
+  String header(const char*) const { return String(); }
+  const String& url() const { return url_; }
+  size_t contentLength() const { return 0; }
+
+private:
+  String url_;
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, const String& filename, size_t index,
+                           uint8_t* data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, uint8_t* data, size_t len,
+                           size_t index, size_t total)> ArBodyHandlerFunction;
+
+class AsyncWebHandler {
+public:
+  virtual ~AsyncWebHandler() {}
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler {};
+
+// ── WebSocket ──
+
+typedef enum { WS_DISCONNECTED, WS_CONNECTED, WS_DISCONNECTING } AwsClientStatus;
+typedef enum { WS_CONTINUATION, WS_TEXT, WS_BINARY, WS_DISCONNECT = 0x08, WS_PING, WS_PONG } AwsFrameType;
+typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+
+typedef struct {
+  uint8_t message_opcode;
+  uint32_t num;
+  uint8_t final;
+  uint8_t masked;
+  uint8_t opcode;
+  uint64_t len;
+  uint8_t mask[4];
+  uint64_t index;
+} AwsFrameInfo;
+
+class AsyncClient {
+public:
+  size_t space() const { return 5744; }   // ventana TCP de lwIP sin congestión
+};
+
+class AsyncWebSocketMessageBuffer {
+public:
+  explicit AsyncWebSocketMessageBuffer(size_t size);
+  ~AsyncWebSocketMessageBuffer();
+  uint8_t* get() { return data_; }
+  size_t length() const { return len_; }
+
+private:
+  uint8_t* data_;
+  size_t len_;
+};
+
+class AsyncWebSocket;
+
+class AsyncWebSocketClient {
+public:
+  AsyncWebSocketClient(AsyncWebSocket* server, uint32_t id) : server_(server), id_(id) {}
+
+  uint32_t id() const { return id_; }
+  AwsClientStatus status() const { return status_; }
+  IPAddress remoteIP() const { return IPAddress(192, 168, 4, (uint8_t)(2 + id_)); }
+  AsyncClient* client() { return &tcp_; }
+  AsyncWebSocket* server() { return server_; }
+  size_t queueLen() const { return 0; }
+  bool queueIsFull() const { return false; }
+  void setCloseClientOnQueueFull(bool) {}
+  void close(uint16_t code = 0, const char* = nullptr);
+
+  void text(const char* msg, size_t len);
+  void text(const char* msg) { text(msg, strlen(msg)); }
+  void text(const String& msg) { text(msg.c_str(), msg.length()); }
+  void text(AsyncWebSocketMessageBuffer* buffer);
+  void binary(const uint8_t* msg, size_t len);
+  void binary(const char* msg, size_t len) { binary((const uint8_t*)msg, len); }
+
+  // ── Sólo host ──
+  uint32_t hostTextFrames = 0;
+  uint32_t hostBinaryFrames = 0;
+  uint32_t hostBytesOut = 0;
+  const char* hostLastText() const { return lastText_; }
+  // Cada frame de texto enviado a cualquier cliente (acks, ecos, estado)
+  static void (*hostOnText)(AsyncWebSocketClient* client, const char* msg, size_t len);
+
+private:
+  AsyncWebSocket* server_;
+  uint32_t id_;
+  AwsClientStatus status_ = WS_CONNECTED;
+  AsyncClient tcp_;
+  char lastText_[512] = "";
+};
+
+typedef std::function<void(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type,
+                           void* arg, uint8_t* data, size_t len)> AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+  explicit AsyncWebSocket(const String& url) : url_(url) { hostLast_ = this; }
+
+  void onEvent(AwsEventHandler handler) { handler_ = handler; }
+  size_t count() const;
+  AsyncWebSocketClient* client(uint32_t id);
+  std::list<AsyncWebSocketClient>& getClients() { return clients_; }
+  void cleanupClients(uint16_t = 8);
+  void closeAll(uint16_t code = 0, const char* message = nullptr);
+
+  AsyncWebSocketMessageBuffer* makeBuffer(size_t size) { return new AsyncWebSocketMessageBuffer(size); }
+  void textAll(const char* msg, size_t len);
+  void textAll(const char* msg) { textAll(msg, strlen(msg)); }
+  void textAll(const String& msg) { textAll(msg.c_str(), msg.length()); }
+  void textAll(AsyncWebSocketMessageBuffer* buffer);
+  void binaryAll(const uint8_t* msg, size_t len);
+
+  // ── Sólo host: lo que haría AsyncTCP al recibir ──
+  AsyncWebSocketClient* hostConnect();
+  void hostDisconnect(AsyncWebSocketClient* client);
+  // Un mensaje completo en un frame (final, index 0)
+  void hostFrame(AsyncWebSocketClient* client, AwsFrameType opcode, const uint8_t* data, size_t len);
+  // El último creado: WebInterface guarda el suyo en un miembro privado
+  static AsyncWebSocket* hostLast() { return hostLast_; }
+
+private:
+  static AsyncWebSocket* hostLast_;
+  String url_;
+  AwsEventHandler handler_;
+  std::list<AsyncWebSocketClient> clients_;
+  uint32_t nextId_ = 1;
+};
+
+class AsyncWebServer {
+public:
+  explicit AsyncWebServer(uint16_t port) : port_(port) {}
+  void begin() {}
+  void end() {}
+  AsyncWebHandler& addHandler(AsyncWebHandler* handler) { return *handler; }
+  AsyncCallbackWebHandler& on(const char*, WebRequestMethodComposite, ArRequestHandlerFunction) { return handler_; }
+  AsyncCallbackWebHandler& on(const char*, WebRequestMethodComposite, ArRequestHandlerFunction,
+                              ArUploadHandlerFunction, ArBodyHandlerFunction = nullptr) { return handler_; }
+  void onNotFound(ArRequestHandlerFunction) {}
+
+private:
+  uint16_t port_;
+  AsyncCallbackWebHandler handler_;
+};
+
+#endif // HOST_ESP_ASYNC_WEB_SERVER_H
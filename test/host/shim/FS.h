@@ -0,0 +1,64 @@
+/*
+ * FS.h (shim de host)
+ * RED808 — fs::FS / fs::File de Arduino sobre un sistema de ficheros vacío:
+ * open() devuelve un File inválido y exists() es falso. La ruta de comandos
+ * que medimos no lee flash; los comandos de samples fallan como con la
+ * partición sin formatear.
+ */
+
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <Arduino.h>
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File : public Stream {
+public:
+  File() {}
+  explicit operator bool() const { return false; }
+  size_t write(uint8_t) override { return 0; }
+  size_t write(const uint8_t*, size_t) override { return 0; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t read(uint8_t*, size_t) { return 0; }
+  bool seek(uint32_t, SeekMode = SeekSet) { return false; }
+  size_t position() const { return 0; }
+  size_t size() const { return 0; }
+  void close() {}
+  const char* name() const { return ""; }
+  const char* path() const { return ""; }
+  bool isDirectory() const { return false; }
+  File openNextFile(const char* = "r") { return File(); }
+  time_t getLastWrite() { return 0; }
+};
+
+class FS {
+public:
+  File open(const char*, const char* = "r", bool = false) { return File(); }
+  File open(const String& path, const char* mode = "r", bool create = false) { return open(path.c_str(), mode, create); }
+  bool exists(const char*) { return false; }
+  bool exists(const String&) { return false; }
+  bool remove(const char*) { return false; }
+  bool remove(const String&) { return false; }
+  bool rename(const char*, const char*) { return false; }
+  bool rename(const String&, const String&) { return false; }
+  bool mkdir(const char*) { return false; }
+  bool mkdir(const String&) { return false; }
+  bool rmdir(const char*) { return false; }
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif // HOST_FS_H
@@ -0,0 +1,29 @@
+/*
+ * IPAddress.h (shim de host)
+ * RED808 — IPv4 de Arduino (comparación, toString).
+ */
+
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <stdint.h>
+#include "WString.h"
+
+class IPAddress {
+public:
+  IPAddress() : addr_(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : addr_((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+  IPAddress(uint32_t addr) : addr_(addr) {}
+
+  operator uint32_t() const { return addr_; }
+  bool operator==(const IPAddress& o) const { return addr_ == o.addr_; }
+  bool operator!=(const IPAddress& o) const { return addr_ != o.addr_; }
+  uint8_t operator[](int i) const { return (uint8_t)(addr_ >> (8 * i)); }
+  String toString() const;
+
+private:
+  uint32_t addr_;
+};
+
+#endif // HOST_IPADDRESS_H
@@ -0,0 +1,21 @@
+/*
+ * LittleFS.h (shim de host)
+ */
+
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include "FS.h"
+
+class LittleFSFS : public fs::FS {
+public:
+  bool begin(bool = false, const char* = "/littlefs", uint8_t = 10, const char* = "spiffs") { return true; }
+  void end() {}
+  bool format() { return true; }
+  size_t totalBytes() { return 1536u * 1024u; }
+  size_t usedBytes() { return 0; }
+};
+
+extern LittleFSFS LittleFS;
+
+#endif // HOST_LITTLEFS_H
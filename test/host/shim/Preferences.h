@@ -0,0 +1,34 @@
+/*
+ * Preferences.h (shim de host)
+ * NVS sin almacenamiento: las lecturas devuelven el valor por defecto.
+ */
+
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <Arduino.h>
+
+class Preferences {
+public:
+  bool begin(const char*, bool = false) { return true; }
+  void end() {}
+  bool clear() { return true; }
+  bool remove(const char*) { return true; }
+  bool isKey(const char*) { return false; }
+  uint8_t getUChar(const char*, uint8_t def = 0) { return def; }
+  size_t putUChar(const char*, uint8_t) { return 1; }
+  int32_t getInt(const char*, int32_t def = 0) { return def; }
+  size_t putInt(const char*, int32_t) { return 4; }
+  uint32_t getUInt(const char*, uint32_t def = 0) { return def; }
+  size_t putUInt(const char*, uint32_t) { return 4; }
+  bool getBool(const char*, bool def = false) { return def; }
+  size_t putBool(const char*, bool) { return 1; }
+  float getFloat(const char*, float def = 0.0f) { return def; }
+  size_t putFloat(const char*, float) { return 4; }
+  size_t getBytes(const char*, void*, size_t) { return 0; }
+  size_t putBytes(const char*, const void*, size_t len) { return len; }
+  String getString(const char*, const String& def = String()) { return def; }
+  size_t putString(const char*, const char* v) { return strlen(v); }
+};
+
+#endif // HOST_PREFERENCES_H
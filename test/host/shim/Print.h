@@ -0,0 +1,64 @@
+/*
+ * Print.h (shim de host)
+ * RED808 — Print / Stream de Arduino: lo que usan los módulos y ArduinoJson
+ * (ARDUINOJSON_ENABLE_ARDUINO_PRINT / _STREAM).
+ */
+
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "WString.h"
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (len--) n += write(*buf++);
+    return n;
+  }
+  size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t write(const char* buf, size_t len) { return write((const uint8_t*)buf, len); }
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write(s.c_str(), s.length()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int n, int base = 10) { return print(String(n, (unsigned char)base)); }
+  size_t print(unsigned int n, int base = 10) { return print(String(n, (unsigned char)base)); }
+  size_t print(long n, int base = 10) { return print(String(n, (unsigned char)base)); }
+  size_t print(unsigned long n, int base = 10) { return print(String(n, (unsigned char)base)); }
+  size_t print(double n, int digits = 2) { return print(String(n, (unsigned int)digits)); }
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(const T& v, int f) { size_t n = print(v, f); return n + println(); }
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long ms) { timeout_ = ms; }
+  size_t readBytes(char* buffer, size_t length) {
+    size_t n = 0;
+    while (n < length) {
+      int c = read();
+      if (c < 0) break;
+      buffer[n++] = (char)c;
+    }
+    return n;
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+  String readString();
+
+protected:
+  unsigned long timeout_ = 1000;
+};
+
+#endif // HOST_PRINT_H
@@ -0,0 +1,131 @@
+/*
+ * WString.h (shim de host)
+ * RED808 — String de Arduino sobre malloc/realloc, con la misma política de
+ * crecimiento que el core (reserve exacto + concat) para que las asignaciones
+ * contadas por el arnés de host se parezcan a las del firmware.
+ */
+
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class StringSumHelper;
+
+class String {
+public:
+  String(const char* cstr = "");
+  String(const char* cstr, unsigned int length);
+  String(const String& str);
+  String(String&& rval) noexcept;
+  explicit String(char c);
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimalPlaces = 2);
+  explicit String(double value, unsigned int decimalPlaces = 2);
+  ~String();
+
+  bool reserve(unsigned int size);
+  unsigned int length() const { return len_; }
+  const char* c_str() const { return buf_ ? buf_ : ""; }
+  bool isEmpty() const { return len_ == 0; }
+
+  String& operator=(const String& rhs);
+  String& operator=(String&& rval) noexcept;
+  String& operator=(const char* cstr);
+
+  bool concat(const String& str);
+  bool concat(const char* cstr);
+  bool concat(const char* cstr, unsigned int length);
+  bool concat(char c);
+  bool concat(unsigned char num);
+  bool concat(int num);
+  bool concat(unsigned int num);
+  bool concat(long num);
+  bool concat(unsigned long num);
+  bool concat(long long num);
+  bool concat(unsigned long long num);
+  bool concat(float num);
+  bool concat(double num);
+
+  template <typename T> String& operator+=(const T& rhs) { concat(rhs); return *this; }
+
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, const String& rhs);
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, const char* cstr);
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, char c);
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, int num);
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, unsigned int num);
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, long num);
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, unsigned long num);
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, float num);
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, double num);
+
+  int compareTo(const String& s) const;
+  bool equals(const String& s) const { return compareTo(s) == 0; }
+  bool equals(const char* cstr) const;
+  bool operator==(const String& rhs) const { return equals(rhs); }
+  bool operator==(const char* cstr) const { return equals(cstr); }
+  bool operator!=(const String& rhs) const { return !equals(rhs); }
+  bool operator!=(const char* cstr) const { return !equals(cstr); }
+  bool operator<(const String& rhs) const { return compareTo(rhs) < 0; }
+  bool equalsIgnoreCase(const String& s) const;
+  bool startsWith(const String& prefix) const;
+  bool startsWith(const String& prefix, unsigned int offset) const;
+  bool endsWith(const String& suffix) const;
+
+  char charAt(unsigned int index) const { return index < len_ ? buf_[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char& operator[](unsigned int index);
+  void setCharAt(unsigned int index, char c) { if (index < len_) buf_[index] = c; }
+
+  int indexOf(char ch, unsigned int fromIndex = 0) const;
+  int indexOf(const String& str, unsigned int fromIndex = 0) const;
+  int lastIndexOf(char ch) const;
+  int lastIndexOf(const String& str) const;
+  String substring(unsigned int beginIndex) const { return substring(beginIndex, len_); }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(char find, char replace);
+  void replace(const String& find, const String& replace);
+  void remove(unsigned int index);
+  void remove(unsigned int index, unsigned int count);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+private:
+  void invalidate();
+  bool changeBuffer(unsigned int maxStrLen);
+  String& copy(const char* cstr, unsigned int length);
+
+  char* buf_ = nullptr;
+  unsigned int cap_ = 0;
+  unsigned int len_ = 0;
+};
+
+class StringSumHelper : public String {
+public:
+  StringSumHelper(const String& s) : String(s) {}
+  StringSumHelper(const char* p) : String(p) {}
+  StringSumHelper(char c) : String(c) {}
+  StringSumHelper(int num) : String(num) {}
+  StringSumHelper(unsigned int num) : String(num) {}
+  StringSumHelper(long num) : String(num) {}
+  StringSumHelper(unsigned long num) : String(num) {}
+  StringSumHelper(float num) : String(num) {}
+  StringSumHelper(double num) : String(num) {}
+};
+
+inline bool operator==(const char* lhs, const String& rhs) { return rhs.equals(lhs); }
+
+#endif // HOST_WSTRING_H
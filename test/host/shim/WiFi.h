@@ -0,0 +1,48 @@
+/*
+ * WiFi.h (shim de host)
+ * RED808 — WiFiClass sin radio: siempre AP en 192.168.4.1, STA nunca conecta.
+ */
+
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+#include "esp_wifi.h"
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum { WIFI_POWER_19_5dBm = 78, WIFI_POWER_8_5dBm = 34 } wifi_power_t;
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t m) { mode_ = m; return true; }
+  wifi_mode_t getMode() const { return mode_; }
+  bool softAP(const char* ssid, const char* = nullptr, int ch = 1, int = 0, int = 4) {
+    snprintf(ssid_, sizeof(ssid_), "%s", ssid ? ssid : "");
+    channel_ = (uint8_t)ch;
+    return true;
+  }
+  bool softAPConfig(IPAddress, IPAddress, IPAddress) { return true; }
+  IPAddress softAPIP() const { return IPAddress(192, 168, 4, 1); }
+  String softAPSSID() const { return String(ssid_); }
+  uint8_t softAPgetStationNum() const { return 1; }
+  bool config(IPAddress, IPAddress, IPAddress, IPAddress = IPAddress()) { return true; }
+  wl_status_t begin(const char*, const char* = nullptr) { return WL_DISCONNECTED; }
+  wl_status_t status() const { return WL_DISCONNECTED; }
+  bool reconnect() { return false; }
+  IPAddress localIP() const { return IPAddress(); }
+  String SSID() const { return String(); }
+  uint8_t channel() const { return channel_; }
+  bool setSleep(bool) { return true; }
+  void persistent(bool) {}
+  bool setTxPower(wifi_power_t) { return true; }
+
+private:
+  wifi_mode_t mode_ = WIFI_OFF;
+  char ssid_[33] = "";
+  uint8_t channel_ = 1;
+};
+
+extern WiFiClass WiFi;
+
+#endif // HOST_WIFI_H
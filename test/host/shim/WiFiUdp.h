@@ -0,0 +1,50 @@
+/*
+ * WiFiUdp.h (shim de host)
+ * RED808 — WiFiUDP sin socket. El arnés mete datagramas con hostUdpInject()
+ * y parsePacket() los entrega de uno en uno; lo enviado se cuenta y el
+ * último datagrama queda en hostUdpLastSent() (sin asignar memoria).
+ */
+
+#ifndef HOST_WIFI_UDP_H
+#define HOST_WIFI_UDP_H
+
+#include <Arduino.h>
+
+struct HostUdpStats {
+  uint32_t packetsOut;
+  uint32_t bytesOut;
+};
+
+// Cola de entrada compartida (el firmware sólo tiene un WiFiUDP)
+bool hostUdpInject(IPAddress ip, uint16_t port, const uint8_t* data, size_t len);
+const char* hostUdpLastSent(size_t* len);
+HostUdpStats& hostUdpStats();
+// Cada datagrama enviado (endPacket), p. ej. para casar los {"s":"ack"}
+void hostUdpOnSend(void (*fn)(IPAddress ip, uint16_t port, const char* data, size_t len));
+
+class WiFiUDP : public Stream {
+public:
+  uint8_t begin(uint16_t port) { port_ = port; return 1; }
+  void stop() {}
+  int parsePacket();
+  int available() override;
+  int read() override;
+  int read(unsigned char* buf, size_t len);
+  int read(char* buf, size_t len) { return read((unsigned char*)buf, len); }
+  int peek() override;
+  IPAddress remoteIP() const { return remoteIp_; }
+  uint16_t remotePort() const { return remotePort_; }
+
+  int beginPacket(IPAddress ip, uint16_t port);
+  int endPacket();
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t len) override;
+  using Print::write;
+
+private:
+  uint16_t port_ = 0;
+  IPAddress remoteIp_;
+  uint16_t remotePort_ = 0;
+};
+
+#endif // HOST_WIFI_UDP_H
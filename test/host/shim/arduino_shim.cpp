@@ -0,0 +1,423 @@
+/*
+ * arduino_shim.cpp
+ * RED808 — core Arduino de host: String, Print, reloj, aleatorios, ESP,
+ * Serial (mudo), mutex recursivos de FreeRTOS y los globales WiFi/LittleFS.
+ * El reloj es el steady_clock del host más un desplazamiento: delay() no
+ * duerme, avanza el desplazamiento, y el arnés lo usa para reproducir los
+ * tiempos de una traza sin esperar (hostClockAdvance).
+ */
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <LittleFS.h>
+#include <freertos/semphr.h>
+#include <chrono>
+#include <mutex>
+#include <stdarg.h>
+#include <ctype.h>
+#include "host_firmware.h"
+
+EspClass ESP;
+HardwareSerial Serial;
+WiFiClass WiFi;
+LittleFSFS LittleFS;
+
+// ── Reloj ──
+static const auto _t0 = std::chrono::steady_clock::now();
+static uint64_t _clockOffsetUs = 0;
+
+static uint64_t nowUs() {
+  auto d = std::chrono::steady_clock::now() - _t0;
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(d).count() + _clockOffsetUs;
+}
+
+void hostClockAdvance(uint64_t us) { _clockOffsetUs += us; }
+unsigned long micros() { return (unsigned long)(uint32_t)nowUs(); }
+unsigned long millis() { return (unsigned long)(uint32_t)(nowUs() / 1000); }
+void delay(uint32_t ms) { hostClockAdvance((uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us) { hostClockAdvance(us); }
+void yield() {}
+
+// ── Aleatorios y utilidades ──
+long random(long max) { return max > 0 ? rand() % max : 0; }
+long random(long min, long max) { return max > min ? min + rand() % (max - min) : min; }
+void randomSeed(unsigned long seed) { srand((unsigned)seed); }
+uint32_t esp_random() { return ((uint32_t)rand() << 16) ^ (uint32_t)rand(); }
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  if (inMax == inMin) return outMin;
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+void EspClass::restart() {
+  fprintf(stderr, "ESP.restart() en host\n");
+  exit(2);
+}
+
+// Serial mudo: el arnés mide la ruta de comandos, no el log de depuración
+size_t HardwareSerial::write(uint8_t) { return 1; }
+size_t HardwareSerial::write(const uint8_t*, size_t len) { return len; }
+
+// ── FreeRTOS ──
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  static int mainTask;
+  return &mainTask;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return new std::recursive_mutex(); }
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t wait) {
+  auto* m = static_cast<std::recursive_mutex*>(sem);
+  if (wait == 0) return m->try_lock() ? pdTRUE : pdFALSE;
+  m->lock();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) {
+  static_cast<std::recursive_mutex*>(sem)->unlock();
+  return pdTRUE;
+}
+
+// ── Print / Stream ──
+size_t Print::printf(const char* fmt, ...) {
+  char small[64];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(small, sizeof(small), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  if ((size_t)n < sizeof(small)) return write((const uint8_t*)small, n);
+  // Como el core: más de 64 B va a un buffer del heap
+  char* big = (char*)malloc(n + 1);
+  if (!big) return 0;
+  va_start(ap, fmt);
+  vsnprintf(big, n + 1, fmt, ap);
+  va_end(ap);
+  size_t w = write((const uint8_t*)big, n);
+  free(big);
+  return w;
+}
+
+String Stream::readString() {
+  String s;
+  int c;
+  while ((c = read()) >= 0) s += (char)c;
+  return s;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(buf);
+}
+
+// ═══════════════════════════════════════════════════════
+// String — misma política de memoria que WString.cpp del core
+// ═══════════════════════════════════════════════════════
+
+String::String(const char* cstr) { if (cstr) copy(cstr, strlen(cstr)); }
+String::String(const char* cstr, unsigned int length) { if (cstr) copy(cstr, length); }
+String::String(const String& str) { *this = str; }
+String::String(String&& rval) noexcept : buf_(rval.buf_), cap_(rval.cap_), len_(rval.len_) {
+  rval.buf_ = nullptr;
+  rval.cap_ = rval.len_ = 0;
+}
+String::String(char c) { char b[2] = { c, 0 }; *this = b; }
+
+static void utoaBase(unsigned long long v, unsigned char base, char* out) {
+  char tmp[66];
+  int i = 0;
+  if (base < 2 || base > 36) base = 10;
+  do {
+    int d = (int)(v % base);
+    tmp[i++] = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+    v /= base;
+  } while (v);
+  int j = 0;
+  while (i) out[j++] = tmp[--i];
+  out[j] = 0;
+}
+
+static void itoaBase(long long v, unsigned char base, char* out) {
+  if (v < 0 && base == 10) {
+    out[0] = '-';
+    utoaBase((unsigned long long)(-(v + 1)) + 1, base, out + 1);
+  } else {
+    utoaBase((unsigned long long)v, base, out);
+  }
+}
+
+String::String(unsigned char value, unsigned char base) { char b[66]; utoaBase(value, base, b); *this = b; }
+String::String(int value, unsigned char base) { char b[67]; itoaBase(value, base, b); *this = b; }
+String::String(unsigned int value, unsigned char base) { char b[66]; utoaBase(value, base, b); *this = b; }
+String::String(long value, unsigned char base) { char b[67]; itoaBase(value, base, b); *this = b; }
+String::String(unsigned long value, unsigned char base) { char b[66]; utoaBase(value, base, b); *this = b; }
+String::String(long long value, unsigned char base) { char b[67]; itoaBase(value, base, b); *this = b; }
+String::String(unsigned long long value, unsigned char base) { char b[66]; utoaBase(value, base, b); *this = b; }
+
+String::String(float value, unsigned int decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned int decimalPlaces) {
+  char b[64];
+  snprintf(b, sizeof(b), "%.*f", (int)decimalPlaces, value);
+  *this = b;
+}
+
+String::~String() { free(buf_); }
+
+void String::invalidate() {
+  free(buf_);
+  buf_ = nullptr;
+  cap_ = len_ = 0;
+}
+
+bool String::reserve(unsigned int size) {
+  if (buf_ && cap_ >= size) return true;
+  if (changeBuffer(size)) {
+    if (len_ == 0) buf_[0] = 0;
+    return true;
+  }
+  return false;
+}
+
+bool String::changeBuffer(unsigned int maxStrLen) {
+  char* nb = (char*)realloc(buf_, maxStrLen + 1);
+  if (!nb) return false;
+  buf_ = nb;
+  cap_ = maxStrLen;
+  return true;
+}
+
+String& String::copy(const char* cstr, unsigned int length) {
+  if (!reserve(length)) {
+    invalidate();
+    return *this;
+  }
+  len_ = length;
+  memmove(buf_, cstr, length);
+  buf_[length] = 0;
+  return *this;
+}
+
+String& String::operator=(const String& rhs) {
+  if (this == &rhs) return *this;
+  if (rhs.buf_) copy(rhs.buf_, rhs.len_);
+  else invalidate();
+  return *this;
+}
+
+String& String::operator=(String&& rval) noexcept {
+  if (this != &rval) {
+    free(buf_);
+    buf_ = rval.buf_;
+    cap_ = rval.cap_;
+    len_ = rval.len_;
+    rval.buf_ = nullptr;
+    rval.cap_ = rval.len_ = 0;
+  }
+  return *this;
+}
+
+String& String::operator=(const char* cstr) {
+  if (cstr) copy(cstr, strlen(cstr));
+  else invalidate();
+  return *this;
+}
+
+bool String::concat(const char* cstr, unsigned int length) {
+  if (!cstr) return false;
+  if (length == 0) return true;
+  unsigned int newlen = len_ + length;
+  if (!reserve(newlen)) return false;
+  memmove(buf_ + len_, cstr, length);
+  len_ = newlen;
+  buf_[len_] = 0;
+  return true;
+}
+
+bool String::concat(const String& s) {
+  if (&s == this) {
+    String copy(s);
+    return concat(copy.c_str(), copy.length());
+  }
+  return concat(s.c_str(), s.length());
+}
+bool String::concat(const char* cstr) { return cstr ? concat(cstr, strlen(cstr)) : false; }
+bool String::concat(char c) { return concat(&c, 1); }
+bool String::concat(unsigned char num) { return concat(String(num)); }
+bool String::concat(int num) { return concat(String(num)); }
+bool String::concat(unsigned int num) { return concat(String(num)); }
+bool String::concat(long num) { return concat(String(num)); }
+bool String::concat(unsigned long num) { return concat(String(num)); }
+bool String::concat(long long num) { return concat(String(num)); }
+bool String::concat(unsigned long long num) { return concat(String(num)); }
+bool String::concat(float num) { return concat(String(num)); }
+bool String::concat(double num) { return concat(String(num)); }
+
+StringSumHelper& operator+(const StringSumHelper& lhs, const String& rhs) {
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(rhs);
+  return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, const char* cstr) {
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(cstr);
+  return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, char c) {
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(c);
+  return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, int num) {
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(num);
+  return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, unsigned int num) {
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(num);
+  return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, long num) {
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(num);
+  return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, unsigned long num) {
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(num);
+  return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, float num) {
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(num);
+  return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, double num) {
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(num);
+  return a;
+}
+
+int String::compareTo(const String& s) const { return strcmp(c_str(), s.c_str()); }
+bool String::equals(const char* cstr) const { return strcmp(c_str(), cstr ? cstr : "") == 0; }
+
+bool String::equalsIgnoreCase(const String& s) const {
+  if (len_ != s.len_) return false;
+  for (unsigned int i = 0; i < len_; i++) {
+    if (tolower((unsigned char)buf_[i]) != tolower((unsigned char)s.buf_[i])) return false;
+  }
+  return true;
+}
+
+bool String::startsWith(const String& prefix) const {
+  return len_ >= prefix.len_ && startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+  if (offset > len_ || prefix.len_ > len_ - offset) return false;
+  return strncmp(c_str() + offset, prefix.c_str(), prefix.len_) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+  if (len_ < suffix.len_) return false;
+  return strcmp(c_str() + len_ - suffix.len_, suffix.c_str()) == 0;
+}
+
+char& String::operator[](unsigned int index) {
+  static char dummy;
+  if (index >= len_ || !buf_) {
+    dummy = 0;
+    return dummy;
+  }
+  return buf_[index];
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+  if (fromIndex >= len_) return -1;
+  const char* p = strchr(buf_ + fromIndex, ch);
+  return p ? (int)(p - buf_) : -1;
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const {
+  if (fromIndex >= len_) return -1;
+  const char* p = strstr(buf_ + fromIndex, str.c_str());
+  return p ? (int)(p - buf_) : -1;
+}
+
+int String::lastIndexOf(char ch) const {
+  const char* p = len_ ? strrchr(buf_, ch) : nullptr;
+  return p ? (int)(p - buf_) : -1;
+}
+
+int String::lastIndexOf(const String& str) const {
+  if (str.len_ == 0 || str.len_ > len_) return -1;
+  for (int i = (int)(len_ - str.len_); i >= 0; i--) {
+    if (strncmp(buf_ + i, str.c_str(), str.len_) == 0) return i;
+  }
+  return -1;
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+  if (left > right) {
+    unsigned int t = right;
+    right = left;
+    left = t;
+  }
+  if (left >= len_) return String();
+  if (right > len_) right = len_;
+  return String(buf_ + left, right - left);
+}
+
+void String::replace(char find, char replace) {
+  for (unsigned int i = 0; i < len_; i++) {
+    if (buf_[i] == find) buf_[i] = replace;
+  }
+}
+
+void String::replace(const String& find, const String& replace) {
+  if (len_ == 0 || find.len_ == 0) return;
+  String out;
+  unsigned int i = 0;
+  while (i < len_) {
+    if (i + find.len_ <= len_ && strncmp(buf_ + i, find.c_str(), find.len_) == 0) {
+      out.concat(replace);
+      i += find.len_;
+    } else {
+      out.concat(buf_[i++]);
+    }
+  }
+  *this = static_cast<String&&>(out);
+}
+
+void String::remove(unsigned int index) { remove(index, (unsigned int)-1); }
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index >= len_ || count == 0) return;
+  if (count > len_ - index) count = len_ - index;
+  memmove(buf_ + index, buf_ + index + count, len_ - index - count + 1);
+  len_ -= count;
+}
+
+void String::toLowerCase() {
+  for (unsigned int i = 0; i < len_; i++) buf_[i] = (char)tolower((unsigned char)buf_[i]);
+}
+
+void String::toUpperCase() {
+  for (unsigned int i = 0; i < len_; i++) buf_[i] = (char)toupper((unsigned char)buf_[i]);
+}
+
+void String::trim() {
+  if (!buf_ || len_ == 0) return;
+  unsigned int b = 0, e = len_;
+  while (b < e && isspace((unsigned char)buf_[b])) b++;
+  while (e > b && isspace((unsigned char)buf_[e - 1])) e--;
+  len_ = e - b;
+  if (b) memmove(buf_, buf_ + b, len_);
+  buf_[len_] = 0;
+}
+
+long String::toInt() const { return buf_ ? atol(buf_) : 0; }
+float String::toFloat() const { return buf_ ? (float)atof(buf_) : 0.0f; }
+double String::toDouble() const { return buf_ ? atof(buf_) : 0.0; }
@@ -0,0 +1,12 @@
+/*
+ * esp_err.h (shim de host)
+ */
+
+#ifndef HOST_ESP_ERR_H
+#define HOST_ESP_ERR_H
+
+typedef int esp_err_t;
+#define ESP_OK   0
+#define ESP_FAIL -1
+
+#endif // HOST_ESP_ERR_H
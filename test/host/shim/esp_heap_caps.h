@@ -0,0 +1,27 @@
+/*
+ * esp_heap_caps.h (shim de host)
+ * RED808 — heap_caps_* sobre el contador de host_heap.cpp: dos heaps
+ * simulados (interna y PSRAM) con el tamaño nominal del ESP32-S3.
+ */
+
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT     (1u << 2)
+#define MALLOC_CAP_SPIRAM   (1u << 10)
+#define MALLOC_CAP_INTERNAL (1u << 11)
+#define MALLOC_CAP_DEFAULT  (1u << 12)
+
+void* heap_caps_malloc(size_t size, uint32_t caps);
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps);
+void heap_caps_free(void* ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_total_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+
+#endif // HOST_ESP_HEAP_CAPS_H
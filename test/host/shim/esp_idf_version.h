@@ -0,0 +1,12 @@
+/*
+ * esp_idf_version.h (shim de host)
+ * Versión del IDF de arduino-esp32 3.x.
+ */
+
+#ifndef HOST_ESP_IDF_VERSION_H
+#define HOST_ESP_IDF_VERSION_H
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch) (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(5, 1, 4)
+
+#endif // HOST_ESP_IDF_VERSION_H
@@ -0,0 +1,12 @@
+/*
+ * esp_task_wdt.h (shim de host)
+ */
+
+#ifndef HOST_ESP_TASK_WDT_H
+#define HOST_ESP_TASK_WDT_H
+
+#include "esp_err.h"
+
+inline esp_err_t esp_task_wdt_reset() { return 0; }
+
+#endif // HOST_ESP_TASK_WDT_H
@@ -0,0 +1,33 @@
+/*
+ * esp_wifi.h (shim de host)
+ * RED808 — sólo lo que begin() toca para ajustar el AP (protocolo, beacon).
+ */
+
+#ifndef HOST_ESP_WIFI_H
+#define HOST_ESP_WIFI_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum { WIFI_IF_STA = 0, WIFI_IF_AP = 1 } wifi_interface_t;
+
+#define WIFI_PROTOCOL_11B 1
+#define WIFI_PROTOCOL_11G 2
+#define WIFI_PROTOCOL_11N 4
+
+typedef struct {
+  uint8_t ssid[32];
+  uint8_t password[64];
+  uint8_t channel;
+  uint16_t beacon_interval;
+} wifi_ap_config_t;
+
+typedef union {
+  wifi_ap_config_t ap;
+} wifi_config_t;
+
+inline esp_err_t esp_wifi_set_protocol(wifi_interface_t, uint8_t) { return ESP_OK; }
+inline esp_err_t esp_wifi_get_config(wifi_interface_t, wifi_config_t* conf) { *conf = wifi_config_t(); return ESP_OK; }
+inline esp_err_t esp_wifi_set_config(wifi_interface_t, wifi_config_t*) { return ESP_OK; }
+
+#endif // HOST_ESP_WIFI_H
@@ -0,0 +1,92 @@
+/*
+ * firmware_stubs.cpp
+ * RED808 — lo que en el firmware pone main.cpp (globales y helpers que
+ * WebInterface declara extern) y un MIDIController sin USB. Los helpers
+ * hacen lo mismo que en main.cpp salvo el LED RGB y el paso a Core1.
+ */
+
+#include <Arduino.h>
+#include "MIDIController.h"
+#include "SPIMaster.h"
+#include "SampleManager.h"
+#include "Sequencer.h"
+
+SPIMaster spiMaster;
+SampleManager sampleManager;
+Sequencer sequencer;
+
+volatile int8_t gTrackSynthEngine[16] = {
+  -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+void setTrackSynthEngine(int track, int8_t engine) {
+  if (track < 0 || track >= 16) return;
+  if (engine < -1 || engine > 6) return;
+  gTrackSynthEngine[track] = engine;
+}
+
+void setAllTrackSynthEngines(int8_t engine) {
+  if (engine < -1 || engine > 6) return;
+  for (int i = 0; i < 16; i++) gTrackSynthEngine[i] = engine;
+}
+
+void setLedMonoMode(bool) {}
+
+// Mismo reparto que main.cpp: pista con motor de síntesis → synth, si no → sample
+void triggerPadWithLED(int track, uint8_t velocity) {
+  int8_t engine = (track >= 0 && track < 16) ? gTrackSynthEngine[track] : -1;
+  if (engine == 3) {
+    spiMaster.synth303NoteOn(48, false, false);
+  } else if (engine >= 0 && engine <= 6) {
+    spiMaster.synthTrigger((uint8_t)engine, (uint8_t)track, velocity);
+  } else {
+    spiMaster.triggerSampleLive(track, velocity);
+  }
+}
+
+// En el firmware Core1 sube el patrón en su bucle; aquí no hay Core1
+void dsqUploadPatternDeferred(int) {}
+
+void dsqUploadPattern(int pattern) {
+  const int len = sequencer.getPatternLength();
+  for (int trk = 0; trk < DSQ_TRACKS; trk++) {
+    spiMaster.dsqSetLength((uint8_t)len);
+    spiMaster.dsqUploadTrack((uint8_t)pattern, (uint8_t)trk, nullptr, 0);
+  }
+}
+
+// ── MIDIController sin USB: mapeo por defecto 36.. → pads 0.. ──
+MIDIController::MIDIController()
+    : clientHandle(nullptr), hostTaskHandle(nullptr), initialized(false), hostInitialized(false),
+      deviceHandle(nullptr), midiTransfer(nullptr), midiEndpointAddress(0), midiMaxPacketSize(0),
+      interfaceNum(-1), deviceInfo(), historyIndex(0), historyCount(0), totalMessages(0),
+      messagesPerSecond(0), lastSecondTime(0), messagesThisSecond(0), mappingCount(0), scanEnabled(false) {
+  initializeDefaultMappings();
+}
+
+MIDIController::~MIDIController() {}
+
+bool MIDIController::begin() { return false; }
+void MIDIController::update() {}
+
+void MIDIController::initializeDefaultMappings() {
+  mappingCount = 16;
+  for (int i = 0; i < mappingCount; i++) noteMappings[i] = { (uint8_t)(36 + i), (int8_t)i, true };
+}
+
+void MIDIController::resetToDefaultMapping() { initializeDefaultMappings(); }
+
+void MIDIController::setPadMapping(int8_t pad, uint8_t newNote) {
+  for (int i = 0; i < mappingCount; i++) {
+    if (noteMappings[i].pad == pad) noteMappings[i].note = newNote;
+  }
+}
+
+const MIDINoteMapping* MIDIController::getAllMappings(int& count) const {
+  count = mappingCount;
+  return noteMappings;
+}
+
+void MIDIController::saveMappings() {}
+void MIDIController::loadMappings() {}
@@ -0,0 +1,37 @@
+/*
+ * freertos/FreeRTOS.h (shim de host)
+ * RED808 — tipos y macros de FreeRTOS que usan los módulos. El arnés de host
+ * es de un solo hilo: las secciones críticas no hacen nada y los mutex
+ * recursivos son std::recursive_mutex (arduino_shim.cpp).
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef void* QueueHandle_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+#define portMAX_DELAY 0xFFFFFFFFu
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+typedef struct { volatile int depth; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(m) ((void)((m)->depth++))
+#define portEXIT_CRITICAL(m)  ((void)((m)->depth--))
+#define portENTER_CRITICAL_ISR(m) portENTER_CRITICAL(m)
+#define portEXIT_CRITICAL_ISR(m)  portEXIT_CRITICAL(m)
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,11 @@
+/*
+ * freertos/queue.h (shim de host)
+ * SPIMaster.h sólo declara el QueueHandle_t; el stub no crea colas.
+ */
+
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+
+#endif // HOST_FREERTOS_QUEUE_H
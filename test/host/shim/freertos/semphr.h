@@ -0,0 +1,15 @@
+/*
+ * freertos/semphr.h (shim de host)
+ * Sólo los mutex recursivos (SampleIndex, SampleCache).
+ */
+
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t wait);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem);
+
+#endif // HOST_FREERTOS_SEMPHR_H
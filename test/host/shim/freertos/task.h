@@ -0,0 +1,14 @@
+/*
+ * freertos/task.h (shim de host)
+ */
+
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+inline void vTaskDelay(TickType_t) {}
+inline TickType_t xTaskGetTickCount() { return 0; }
+
+#endif // HOST_FREERTOS_TASK_H
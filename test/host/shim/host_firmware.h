@@ -0,0 +1,44 @@
+/*
+ * host_firmware.h
+ * RED808 — contadores de los shims de host que lee el arnés de comandos
+ * (test/host/harness_commands.cpp): frames hacia la Daisy y heap simulado.
+ */
+
+#ifndef HOST_FIRMWARE_H
+#define HOST_FIRMWARE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ── Reloj (arduino_shim.cpp): delay() y el arnés adelantan millis()/micros() ──
+void hostClockAdvance(uint64_t us);
+
+// ── SPIMaster (spi_master_stub.cpp) ──
+struct HostSpiStats {
+  uint32_t frames;   // sendCommand(): lo que el firmware mandaría a la Daisy
+  uint32_t staged;   // de ellos, absorbidos por un batch abierto
+};
+HostSpiStats& hostSpiStats();
+
+// ── Heap (host_heap.cpp) ──
+// Dos heaps como el ESP32-S3 con PSRAM: malloc() < 4096 B va a la interna
+// (CONFIG_SPIRAM_MALLOC_ALWAYSINTERNAL), el resto, ps_malloc() y
+// MALLOC_CAP_SPIRAM a PSRAM. Tamaños nominales: lo que queda libre con WiFi,
+// AsyncTCP y las tareas en marcha (orden de magnitud, no una medida).
+enum HostHeapId : uint8_t { HOST_HEAP_INTERNAL = 0, HOST_HEAP_PSRAM = 1 };
+static constexpr size_t HOST_HEAP_INTERNAL_SIZE = 192u * 1024u;
+static constexpr size_t HOST_HEAP_PSRAM_SIZE = 8u * 1024u * 1024u;
+static constexpr size_t HOST_PSRAM_MALLOC_MIN = 4096;
+
+struct HostHeapStats {
+  uint64_t allocs[2];   // llamadas que devolvieron bloque
+  uint64_t frees[2];
+  uint64_t bytes[2];    // bytes pedidos (acumulado)
+  size_t live[2];       // bytes vivos
+  size_t peak[2];       // máximo de live desde hostHeapResetPeak()
+  uint32_t untracked;   // tabla llena: bloques sin contar
+};
+HostHeapStats& hostHeapStats();
+void hostHeapResetPeak();
+
+#endif // HOST_FIRMWARE_H
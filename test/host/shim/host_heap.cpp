@@ -0,0 +1,184 @@
+/*
+ * host_heap.cpp
+ * RED808 — heap contado para el arnés de host. Se enlaza con
+ *   -Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc
+ * y sustituye operator new/delete, así que todo lo que asignan los módulos
+ * del firmware (String, ArduinoJson, new) pasa por aquí. Cada bloque vivo
+ * queda en una tabla abierta (puntero → tamaño, heap) sin tocar el bloque;
+ * lo que libc/libstdc++ asignan por dentro no se ve y se libera tal cual.
+ */
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <new>
+#include "host_firmware.h"
+
+extern "C" {
+void* __real_malloc(size_t size);
+void __real_free(void* ptr);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+}
+
+static HostHeapStats _heap;
+
+// ── Tabla de bloques vivos: sondeo lineal, borrado con desplazamiento ──
+static constexpr size_t kSlots = 1u << 17;
+struct HeapSlot {
+  void* ptr;
+  uint32_t size;
+  uint8_t heap;
+};
+static HeapSlot _slots[kSlots];
+static size_t _used = 0;
+
+static inline size_t slotOf(const void* p) {
+  uint64_t h = (uint64_t)(uintptr_t)p * 0x9E3779B97F4A7C15ull;
+  return (size_t)(h >> 47) & (kSlots - 1);
+}
+
+static void track(void* p, size_t size, uint8_t heap) {
+  if (!p) return;
+  if (_used >= kSlots - kSlots / 8) { _heap.untracked++; return; }
+  size_t i = slotOf(p);
+  while (_slots[i].ptr && _slots[i].ptr != p) i = (i + 1) & (kSlots - 1);
+  if (!_slots[i].ptr) _used++;
+  else _heap.live[_slots[i].heap] -= _slots[i].size;   // libc lo liberó sin pasar por aquí
+  _slots[i] = { p, (uint32_t)size, heap };
+  _heap.allocs[heap]++;
+  _heap.bytes[heap] += size;
+  _heap.live[heap] += size;
+  if (_heap.live[heap] > _heap.peak[heap]) _heap.peak[heap] = _heap.live[heap];
+}
+
+static void untrack(void* p) {
+  if (!p) return;
+  size_t i = slotOf(p);
+  while (_slots[i].ptr != p) {
+    if (!_slots[i].ptr) return;   // no es nuestro
+    i = (i + 1) & (kSlots - 1);
+  }
+  _heap.frees[_slots[i].heap]++;
+  _heap.live[_slots[i].heap] -= _slots[i].size;
+  _used--;
+  // Backward-shift: recolocar los que venían detrás del hueco
+  size_t hole = i;
+  for (size_t j = (i + 1) & (kSlots - 1); _slots[j].ptr; j = (j + 1) & (kSlots - 1)) {
+    size_t home = slotOf(_slots[j].ptr);
+    bool movable = (hole <= j) ? (home <= hole || home > j) : (home <= hole && home > j);
+    if (movable) {
+      _slots[hole] = _slots[j];
+      hole = j;
+    }
+  }
+  _slots[hole] = HeapSlot();
+}
+
+static inline uint8_t defaultHeap(size_t size) {
+  return size >= HOST_PSRAM_MALLOC_MIN ? HOST_HEAP_PSRAM : HOST_HEAP_INTERNAL;
+}
+
+static void* countedAlloc(size_t size, uint8_t heap) {
+  void* p = __real_malloc(size ? size : 1);
+  track(p, size, heap);
+  return p;
+}
+
+static void* countedRealloc(void* ptr, size_t size, int heap) {
+  if (!ptr) return countedAlloc(size, heap < 0 ? defaultHeap(size) : (uint8_t)heap);
+  untrack(ptr);
+  void* p = __real_realloc(ptr, size ? size : 1);
+  track(p, size, heap < 0 ? defaultHeap(size) : (uint8_t)heap);
+  return p;
+}
+
+HostHeapStats& hostHeapStats() { return _heap; }
+
+void hostHeapResetPeak() {
+  _heap.peak[0] = _heap.live[0];
+  _heap.peak[1] = _heap.live[1];
+}
+
+// ── libc ──
+extern "C" {
+void* __wrap_malloc(size_t size) { return countedAlloc(size, defaultHeap(size)); }
+void __wrap_free(void* ptr) {
+  untrack(ptr);
+  __real_free(ptr);
+}
+void* __wrap_calloc(size_t n, size_t size) {
+  void* p = __real_calloc(n, size);
+  track(p, n * size, defaultHeap(n * size));
+  return p;
+}
+void* __wrap_realloc(void* ptr, size_t size) { return countedRealloc(ptr, size, -1); }
+}
+
+// ── C++ ──
+void* operator new(size_t size) {
+  void* p = countedAlloc(size, defaultHeap(size));
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size, defaultHeap(size)); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size, defaultHeap(size)); }
+void operator delete(void* ptr) noexcept { __wrap_free(ptr); }
+void operator delete[](void* ptr) noexcept { __wrap_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { __wrap_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { __wrap_free(ptr); }
+
+// ── Arduino-ESP32 / IDF ──
+void* ps_malloc(size_t size) { return countedAlloc(size, HOST_HEAP_PSRAM); }
+
+void* ps_calloc(size_t n, size_t size) {
+  void* p = __real_calloc(n, size);
+  track(p, n * size, HOST_HEAP_PSRAM);
+  return p;
+}
+
+void* ps_realloc(void* ptr, size_t size) { return countedRealloc(ptr, size, HOST_HEAP_PSRAM); }
+
+static inline int capsHeap(uint32_t caps, size_t size) {
+  if (caps & MALLOC_CAP_SPIRAM) return HOST_HEAP_PSRAM;
+  if (caps & MALLOC_CAP_INTERNAL) return HOST_HEAP_INTERNAL;
+  return defaultHeap(size);
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) { return countedAlloc(size, (uint8_t)capsHeap(caps, size)); }
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+  void* p = __real_calloc(n, size);
+  track(p, n * size, (uint8_t)capsHeap(caps, n * size));
+  return p;
+}
+
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) { return countedRealloc(ptr, size, capsHeap(caps, size)); }
+void heap_caps_free(void* ptr) { __wrap_free(ptr); }
+
+static size_t heapSize(uint32_t caps) {
+  return (caps & MALLOC_CAP_SPIRAM) ? HOST_HEAP_PSRAM_SIZE : HOST_HEAP_INTERNAL_SIZE;
+}
+
+static size_t heapFree(uint32_t caps) {
+  uint8_t h = (caps & MALLOC_CAP_SPIRAM) ? HOST_HEAP_PSRAM : HOST_HEAP_INTERNAL;
+  size_t total = heapSize(caps);
+  return _heap.live[h] < total ? total - _heap.live[h] : 0;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) { return heapFree(caps); }
+size_t heap_caps_get_total_size(uint32_t caps) { return heapSize(caps); }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return heapFree(caps); }
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+  uint8_t h = (caps & MALLOC_CAP_SPIRAM) ? HOST_HEAP_PSRAM : HOST_HEAP_INTERNAL;
+  size_t total = heapSize(caps);
+  return _heap.peak[h] < total ? total - _heap.peak[h] : 0;
+}
+
+uint32_t EspClass::getFreeHeap() { return (uint32_t)heapFree(MALLOC_CAP_INTERNAL); }
+uint32_t EspClass::getHeapSize() { return (uint32_t)HOST_HEAP_INTERNAL_SIZE; }
+uint32_t EspClass::getMinFreeHeap() { return (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL); }
+uint32_t EspClass::getMaxAllocHeap() { return (uint32_t)heapFree(MALLOC_CAP_INTERNAL); }
+uint32_t EspClass::getPsramSize() { return (uint32_t)HOST_HEAP_PSRAM_SIZE; }
+uint32_t EspClass::getFreePsram() { return (uint32_t)heapFree(MALLOC_CAP_SPIRAM); }
@@ -0,0 +1,213 @@
+/*
+ * net_shim.cpp
+ * RED808 — WiFiUDP y AsyncWebSocket de host (ver WiFiUdp.h y
+ * ESPAsyncWebServer.h). Sin sockets: entradas inyectadas por el arnés,
+ * salidas contadas. La cola de datagramas es fija para no meter
+ * asignaciones del shim en las cuentas de heap.
+ */
+
+#include <WiFiUdp.h>
+#include <ESPAsyncWebServer.h>
+
+// ═══════════════════════════════════════════════════════
+// WiFiUDP
+// ═══════════════════════════════════════════════════════
+
+static constexpr size_t kUdpQueue = 16;
+static constexpr size_t kUdpMaxBytes = 1500;
+
+struct HostDatagram {
+  IPAddress ip;
+  uint16_t port;
+  uint16_t len;
+  uint8_t data[kUdpMaxBytes];
+};
+
+static HostDatagram _udpIn[kUdpQueue];
+static size_t _udpHead = 0, _udpCount = 0;
+static HostDatagram _udpCur;          // el que está leyendo el firmware
+static size_t _udpCurPos = 0;
+static bool _udpCurValid = false;
+static char _udpOut[kUdpMaxBytes + 1];
+static size_t _udpOutLen = 0;
+static char _udpLast[kUdpMaxBytes + 1];
+static size_t _udpLastLen = 0;
+static HostUdpStats _udpStats;
+static IPAddress _udpOutIp;
+static uint16_t _udpOutPort = 0;
+static void (*_udpOnSend)(IPAddress, uint16_t, const char*, size_t) = nullptr;
+
+bool hostUdpInject(IPAddress ip, uint16_t port, const uint8_t* data, size_t len) {
+  if (_udpCount >= kUdpQueue || len > kUdpMaxBytes) return false;
+  HostDatagram& d = _udpIn[(_udpHead + _udpCount) % kUdpQueue];
+  d.ip = ip;
+  d.port = port;
+  d.len = (uint16_t)len;
+  memcpy(d.data, data, len);
+  _udpCount++;
+  return true;
+}
+
+const char* hostUdpLastSent(size_t* len) {
+  if (len) *len = _udpLastLen;
+  return _udpLast;
+}
+
+HostUdpStats& hostUdpStats() { return _udpStats; }
+
+void hostUdpOnSend(void (*fn)(IPAddress, uint16_t, const char*, size_t)) { _udpOnSend = fn; }
+
+int WiFiUDP::parsePacket() {
+  _udpCurValid = false;
+  if (_udpCount == 0) return 0;
+  _udpCur = _udpIn[_udpHead];
+  _udpHead = (_udpHead + 1) % kUdpQueue;
+  _udpCount--;
+  _udpCurPos = 0;
+  _udpCurValid = true;
+  remoteIp_ = _udpCur.ip;
+  remotePort_ = _udpCur.port;
+  return _udpCur.len;
+}
+
+int WiFiUDP::available() { return _udpCurValid ? (int)(_udpCur.len - _udpCurPos) : 0; }
+
+int WiFiUDP::read() {
+  if (available() <= 0) return -1;
+  return _udpCur.data[_udpCurPos++];
+}
+
+int WiFiUDP::read(unsigned char* buf, size_t len) {
+  size_t n = (size_t)available();
+  if (n > len) n = len;
+  memcpy(buf, _udpCur.data + _udpCurPos, n);
+  _udpCurPos += n;
+  return (int)n;
+}
+
+int WiFiUDP::peek() { return available() > 0 ? _udpCur.data[_udpCurPos] : -1; }
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+  _udpOutIp = ip;
+  _udpOutPort = port;
+  _udpOutLen = 0;
+  return 1;
+}
+
+size_t WiFiUDP::write(uint8_t c) { return write(&c, 1); }
+
+size_t WiFiUDP::write(const uint8_t* buf, size_t len) {
+  size_t n = len;
+  if (n > kUdpMaxBytes - _udpOutLen) n = kUdpMaxBytes - _udpOutLen;
+  memcpy(_udpOut + _udpOutLen, buf, n);
+  _udpOutLen += n;
+  return len;
+}
+
+int WiFiUDP::endPacket() {
+  memcpy(_udpLast, _udpOut, _udpOutLen);
+  _udpLast[_udpOutLen] = 0;
+  _udpLastLen = _udpOutLen;
+  _udpStats.packetsOut++;
+  _udpStats.bytesOut += (uint32_t)_udpOutLen;
+  _udpOutLen = 0;
+  if (_udpOnSend) _udpOnSend(_udpOutIp, _udpOutPort, _udpLast, _udpLastLen);
+  return 1;
+}
+
+// ═══════════════════════════════════════════════════════
+// AsyncWebSocket
+// ═══════════════════════════════════════════════════════
+
+// El buffer compartido de la librería vive en el heap (se cuenta)
+AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(size_t size)
+    : data_((uint8_t*)malloc(size + 1)), len_(data_ ? size : 0) {}
+
+AsyncWebSocketMessageBuffer::~AsyncWebSocketMessageBuffer() { free(data_); }
+
+void AsyncWebSocketClient::close(uint16_t, const char*) { status_ = WS_DISCONNECTED; }
+
+void AsyncWebSocketClient::text(const char* msg, size_t len) {
+  if (status_ != WS_CONNECTED) return;
+  hostTextFrames++;
+  hostBytesOut += (uint32_t)len;
+  size_t n = len < sizeof(lastText_) - 1 ? len : sizeof(lastText_) - 1;
+  memcpy(lastText_, msg, n);
+  lastText_[n] = 0;
+  if (hostOnText) hostOnText(this, msg, len);
+}
+
+void AsyncWebSocketClient::text(AsyncWebSocketMessageBuffer* buffer) {
+  if (!buffer) return;
+  text((const char*)buffer->get(), buffer->length());
+  delete buffer;   // la librería lo suelta al salir el último envío
+}
+
+void AsyncWebSocketClient::binary(const uint8_t* msg, size_t len) {
+  (void)msg;
+  if (status_ != WS_CONNECTED) return;
+  hostBinaryFrames++;
+  hostBytesOut += (uint32_t)len;
+}
+
+void (*AsyncWebSocketClient::hostOnText)(AsyncWebSocketClient*, const char*, size_t) = nullptr;
+AsyncWebSocket* AsyncWebSocket::hostLast_ = nullptr;
+
+size_t AsyncWebSocket::count() const {
+  size_t n = 0;
+  for (const auto& c : clients_) {
+    if (c.status() == WS_CONNECTED) n++;
+  }
+  return n;
+}
+
+AsyncWebSocketClient* AsyncWebSocket::client(uint32_t id) {
+  for (auto& c : clients_) {
+    if (c.id() == id && c.status() == WS_CONNECTED) return &c;
+  }
+  return nullptr;
+}
+
+void AsyncWebSocket::cleanupClients(uint16_t) {}
+
+void AsyncWebSocket::closeAll(uint16_t code, const char* message) {
+  for (auto& c : clients_) c.close(code, message);
+}
+
+void AsyncWebSocket::textAll(const char* msg, size_t len) {
+  for (auto& c : clients_) c.text(msg, len);
+}
+
+void AsyncWebSocket::textAll(AsyncWebSocketMessageBuffer* buffer) {
+  if (!buffer) return;
+  textAll((const char*)buffer->get(), buffer->length());
+  delete buffer;
+}
+
+void AsyncWebSocket::binaryAll(const uint8_t* msg, size_t len) {
+  for (auto& c : clients_) c.binary(msg, len);
+}
+
+AsyncWebSocketClient* AsyncWebSocket::hostConnect() {
+  clients_.emplace_back(this, nextId_++);
+  AsyncWebSocketClient* c = &clients_.back();
+  if (handler_) handler_(this, c, WS_EVT_CONNECT, nullptr, nullptr, 0);
+  return c;
+}
+
+void AsyncWebSocket::hostDisconnect(AsyncWebSocketClient* client) {
+  if (!client) return;
+  if (handler_) handler_(this, client, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+  client->close();
+}
+
+void AsyncWebSocket::hostFrame(AsyncWebSocketClient* client, AwsFrameType opcode, const uint8_t* data, size_t len) {
+  if (!handler_ || !client) return;
+  AwsFrameInfo info = {};
+  info.message_opcode = (uint8_t)opcode;
+  info.opcode = (uint8_t)opcode;
+  info.final = 1;
+  info.index = 0;
+  info.len = len;
+  handler_(this, client, WS_EVT_DATA, &info, const_cast<uint8_t*>(data), len);
+}
@@ -0,0 +1,276 @@
+/*
+ * spi_master_stub.cpp (host)
+ * RED808 — SPIMaster sin bus para el arnés de comandos: cada método que en el
+ * firmware genera un frame hacia la Daisy pasa por sendCommand(), que sólo
+ * lo cuenta (hostSpiStats). Sin cola ni Core1: los frames "salen" al
+ * instante, así que endTag() devuelve queued=0 y el ACK se resuelve en
+ * cmdAckEnd(). Las consultas a la Daisy (sd*, request*, ping...) fallan como
+ * con la Daisy desconectada. Los setters con getter inline guardan el valor.
+ */
+
+#include "SPIMaster.h"
+#include "host_firmware.h"
+
+static HostSpiStats _spiStats;
+static const FilterPreset kHostFilterPreset = { FILTER_NONE, 1000.0f, 1.0f, 0.0f, "None" };
+
+HostSpiStats& hostSpiStats() { return _spiStats; }
+
+SPIMaster::SPIMaster() {
+  memset(static_cast<void*>(this), 0, sizeof(*this));
+  lastPingRttMs = -1.0f;
+  cachedMasterVolume = 100;
+  cachedSeqVolume = 100;
+  cachedLiveVolume = 100;
+  cachedLivePitch = 1.0f;
+  cachedLimiterActive = true;
+}
+
+SPIMaster::~SPIMaster() {}
+
+bool SPIMaster::begin() { stm32Connected = true; return true; }
+void SPIMaster::process() {}
+
+// ── Punto único de salida: cuenta el frame (o lo deja en el batch abierto) ──
+bool SPIMaster::sendCommand(uint8_t, const void*, uint16_t) {
+  _spiStats.frames++;
+  if (batchState == SPI_BATCH_STAGING) {
+    batchCount++;
+    _spiStats.staged++;
+    if (tagCtxOpen) tagCtx[0].res.staged++;
+  } else if (tagCtxOpen) {
+    tagCtx[0].res.queued++;
+  }
+  return true;
+}
+
+bool SPIMaster::beginBatch() {
+  batchState = SPI_BATCH_STAGING;
+  batchCount = 0;
+  return true;
+}
+
+uint16_t SPIMaster::endBatch(bool) {
+  uint16_t n = batchCount;
+  batchState = SPI_BATCH_IDLE;
+  batchCount = 0;
+  return n;
+}
+
+void SPIMaster::releaseBatch() {}
+
+void SPIMaster::beginTag(uint8_t tag) {
+  tagCtx[0].tag = tag;
+  tagCtx[0].res = SpiTagResult();
+  tagCtxOpen = 1;
+}
+
+SpiTagResult SPIMaster::endTag() {
+  SpiTagResult r = tagCtx[0].res;
+  tagCtxOpen = 0;
+  r.queued = 0;   // ya "enviados": nada que esperar en popTagCompletion()
+  return r;
+}
+
+bool SPIMaster::popTagCompletion(SpiTagCompletion*) { return false; }
+
+const FilterPreset* SPIMaster::getFilterPreset(FilterType) { return &kHostFilterPreset; }
+const char* SPIMaster::getFilterName(FilterType) { return kHostFilterPreset.name; }
+
+// ── Resto de la API: cuenta el frame y devuelve lo que daría una Daisy muda ──
+void SPIMaster::triggerSampleSequencer(int, uint8_t, uint8_t, uint32_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::triggerSampleLive(int, uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::triggerSample(int, uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::stopSample(int) { sendCommand(0, nullptr, 0); }
+void SPIMaster::stopAll() { sendCommand(0, nullptr, 0); }
+void SPIMaster::triggerSidechain(int) { sendCommand(0, nullptr, 0); }
+bool SPIMaster::triggerBulk(const TriggerSeqPayload*, uint8_t) { sendCommand(0, nullptr, 0); return true; }
+void SPIMaster::setMasterVolume(uint8_t volume) { cachedMasterVolume = volume; sendCommand(0, nullptr, 0); }
+uint8_t SPIMaster::getMasterVolume() { return cachedMasterVolume; }
+void SPIMaster::setSequencerVolume(uint8_t volume) { cachedSeqVolume = volume; sendCommand(0, nullptr, 0); }
+uint8_t SPIMaster::getSequencerVolume() { return cachedSeqVolume; }
+void SPIMaster::setLiveVolume(uint8_t volume) { cachedLiveVolume = volume; sendCommand(0, nullptr, 0); }
+uint8_t SPIMaster::getLiveVolume() { return cachedLiveVolume; }
+void SPIMaster::setTrackVolume(int, uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setLivePitchShift(float pitch) { cachedLivePitch = pitch; sendCommand(0, nullptr, 0); }
+float SPIMaster::getLivePitchShift() { return cachedLivePitch; }
+void SPIMaster::setTempo(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setFilterType(FilterType) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setFilterCutoff(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setFilterResonance(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setBitDepth(uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setDistortion(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setDistortionMode(DistortionMode) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setSampleRateReduction(uint32_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setDelayActive(bool) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setDelayTime(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setDelayFeedback(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setDelayMix(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setPhaserActive(bool) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setPhaserRate(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setPhaserDepth(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setPhaserFeedback(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setFlangerActive(bool) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setFlangerRate(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setFlangerDepth(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setFlangerFeedback(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setFlangerMix(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setCompressorActive(bool) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setCompressorThreshold(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setCompressorRatio(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setCompressorAttack(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setCompressorRelease(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setCompressorMakeupGain(float) { sendCommand(0, nullptr, 0); }
+bool SPIMaster::setTrackFilter(int, FilterType, float, float, float) { sendCommand(0, nullptr, 0); return true; }
+void SPIMaster::clearTrackFilter(int) { sendCommand(0, nullptr, 0); }
+FilterType SPIMaster::getTrackFilter(int) { return FilterType(); }
+int SPIMaster::getActiveTrackFiltersCount() { return 0; }
+bool SPIMaster::setPadFilter(int, FilterType, float, float, float) { sendCommand(0, nullptr, 0); return true; }
+void SPIMaster::clearPadFilter(int) { sendCommand(0, nullptr, 0); }
+FilterType SPIMaster::getPadFilter(int) { return FilterType(); }
+int SPIMaster::getActivePadFiltersCount() { return 0; }
+void SPIMaster::setPadDistortion(int, float, DistortionMode) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setPadBitCrush(int, uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::clearPadFX(int) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackDistortion(int, float, DistortionMode) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackBitCrush(int, uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::clearTrackFX(int) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackEcho(int, bool, float, float, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackFlanger(int, bool, float, float, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackCompressor(int, bool, float, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::clearTrackLiveFX(int) { sendCommand(0, nullptr, 0); }
+bool SPIMaster::getTrackEchoActive(int) const { return true; }
+bool SPIMaster::getTrackFlangerActive(int) const { return true; }
+bool SPIMaster::getTrackCompressorActive(int) const { return true; }
+void SPIMaster::setTrackReverbSend(int track, uint8_t level) {
+  if (track >= 0 && track < MAX_AUDIO_TRACKS) cachedTrackReverbSend[track] = level;
+  sendCommand(0, nullptr, 0);
+}
+void SPIMaster::setTrackDelaySend(int track, uint8_t level) {
+  if (track >= 0 && track < MAX_AUDIO_TRACKS) cachedTrackDelaySend[track] = level;
+  sendCommand(0, nullptr, 0);
+}
+void SPIMaster::setTrackChorusSend(int track, uint8_t level) {
+  if (track >= 0 && track < MAX_AUDIO_TRACKS) cachedTrackChorusSend[track] = level;
+  sendCommand(0, nullptr, 0);
+}
+void SPIMaster::setTrackPan(int track, int8_t pan) {
+  if (track >= 0 && track < MAX_AUDIO_TRACKS) cachedTrackPan[track] = pan;
+  sendCommand(0, nullptr, 0);
+}
+void SPIMaster::setTrackMute(int track, bool mute) {
+  if (track >= 0 && track < MAX_AUDIO_TRACKS) cachedTrackMute[track] = mute;
+  sendCommand(0, nullptr, 0);
+}
+void SPIMaster::setTrackSolo(int track, bool solo) {
+  if (track >= 0 && track < MAX_AUDIO_TRACKS) cachedTrackSolo[track] = solo;
+  sendCommand(0, nullptr, 0);
+}
+void SPIMaster::setTrackPhaser(int, bool, float, float, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackTremolo(int, bool, float, float, uint8_t, uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackPitch(int, int16_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackGate(int, bool, float, float, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackEqLow(int, int8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackEqMid(int, int8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackEqHigh(int, int8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackEq(int, int8_t, int8_t, int8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setReverbActive(bool active) { cachedReverbActive = active; sendCommand(0, nullptr, 0); }
+void SPIMaster::setReverbFeedback(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setReverbLpFreq(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setReverbMix(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setReverb(bool, float, float, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setChorusActive(bool active) { cachedChorusActive = active; sendCommand(0, nullptr, 0); }
+void SPIMaster::setChorusRate(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setChorusDepth(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setChorusMix(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setChorus(bool, float, float, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTremoloActive(bool active) { cachedTremoloActive = active; sendCommand(0, nullptr, 0); }
+void SPIMaster::setTremoloRate(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTremoloDepth(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTremolo(bool, float, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setWaveFolderGain(float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setLimiterActive(bool active) { cachedLimiterActive = active; sendCommand(0, nullptr, 0); }
+void SPIMaster::setMasterFxRoute(uint8_t, bool) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setAutoWahActive(bool) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setAutoWahLevel(uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setAutoWahMix(uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setStereoWidth(uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTapeStop(uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setBeatRepeat(uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setDelayStereo(uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setChorusStereo(uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setEarlyRefActive(bool) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setEarlyRefMix(uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setChokeGroup(uint8_t pad, uint8_t group) {
+  if (pad < MAX_AUDIO_TRACKS) cachedChokeGroup[pad] = group;
+  sendCommand(0, nullptr, 0);
+}
+bool SPIMaster::songUpload(const SongEntry*, uint8_t) { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::songControl(uint8_t) { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::songGetPos(uint8_t&, uint8_t&, uint8_t&) { sendCommand(0, nullptr, 0); return false; }
+void SPIMaster::setTrackLfoConfig(uint8_t, uint8_t, uint8_t, uint16_t, uint16_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setSidechain(bool, int, uint16_t, float, float, float, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::clearSidechain() { sendCommand(0, nullptr, 0); }
+void SPIMaster::setPadLoop(int, bool) { sendCommand(0, nullptr, 0); }
+bool SPIMaster::isPadLooping(int) { return true; }
+void SPIMaster::setReverseSample(int, bool) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setTrackPitchShift(int, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::setStutter(int, bool, int) { sendCommand(0, nullptr, 0); }
+bool SPIMaster::setSampleBuffer(int, int16_t*, uint32_t, uint32_t) { sendCommand(0, nullptr, 0); return true; }
+bool SPIMaster::transferSample(int, int16_t*, uint32_t, uint32_t) { sendCommand(0, nullptr, 0); return true; }
+void SPIMaster::sampleStreamBegin(int, uint32_t) { sendCommand(0, nullptr, 0); }
+bool SPIMaster::sampleStreamData(int, const int16_t*, uint32_t, uint32_t) { sendCommand(0, nullptr, 0); return true; }
+bool SPIMaster::sampleStreamEnd(int, const int16_t*, uint32_t) { sendCommand(0, nullptr, 0); return true; }
+void SPIMaster::unloadSample(int) { sendCommand(0, nullptr, 0); }
+void SPIMaster::unloadAllSamples() { sendCommand(0, nullptr, 0); }
+bool SPIMaster::confirmSlotContent(int, uint32_t, uint32_t) { sendCommand(0, nullptr, 0); return false; }
+void SPIMaster::noteSlotContent(int, uint32_t, uint32_t) {  }
+void SPIMaster::invalidateSlots(int, int) {  }
+bool SPIMaster::syncSlotHashes() { sendCommand(0, nullptr, 0); return false; }
+DaisySlot SPIMaster::getSlot(int) { return DaisySlot(); }
+bool SPIMaster::sdListFolders(SdFolderListResponse&) { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::sdListFiles(const char*, SdFileListResponse&) { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::sdGetFileInfo(const char*, const char*, SdFileInfoResponse&) { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::sdLoadSample(int, const char*, const char*) { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::sdLoadKit(const char*, uint8_t, uint8_t) { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::sdGetKitList(SdKitListResponse&) { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::sdGetStatus(SdStatusResponse&) { sendCommand(0, nullptr, 0); return false; }
+void SPIMaster::sdUnloadKit() { sendCommand(0, nullptr, 0); }
+bool SPIMaster::sdGetLoadedKit(SdStatusResponse&) { sendCommand(0, nullptr, 0); return false; }
+void SPIMaster::sdAbortLoad() { sendCommand(0, nullptr, 0); }
+float SPIMaster::getTrackPeak(int) { return 0; }
+float SPIMaster::getMasterPeak() { return 0; }
+void SPIMaster::getTrackPeaks(float*, int) {  }
+bool SPIMaster::requestPeaks() { sendCommand(0, nullptr, 0); return false; }
+void SPIMaster::setPeakPolling(bool) {  }
+bool SPIMaster::requestActiveVoices() { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::requestCpuLoad() { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::requestStatus() { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::setPerformanceStressMode(bool, bool) { sendCommand(0, nullptr, 0); return true; }
+int SPIMaster::getActiveVoices() { return 0; }
+float SPIMaster::getCpuLoad() { return 0; }
+bool SPIMaster::getStatusSnapshot(StatusResponse&) { return false; }
+bool SPIMaster::ping(uint32_t&) { sendCommand(0, nullptr, 0); return false; }
+void SPIMaster::resetDSP() { sendCommand(0, nullptr, 0); }
+bool SPIMaster::requestEvents(EventsResponse&) { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::drainEvents() { sendCommand(0, nullptr, 0); return false; }
+void SPIMaster::synthTrigger(uint8_t, uint8_t, uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::synthParam(uint8_t, uint8_t, uint8_t, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::synth303NoteOn(uint8_t, bool, bool) { sendCommand(0, nullptr, 0); }
+void SPIMaster::synth303NoteOff() { sendCommand(0, nullptr, 0); }
+void SPIMaster::synth303Param(uint8_t, float) { sendCommand(0, nullptr, 0); }
+void SPIMaster::synthNoteOnEx(uint8_t, uint8_t, uint8_t, bool, bool) { sendCommand(0, nullptr, 0); }
+void SPIMaster::synthNoteOff(uint8_t, uint8_t) { sendCommand(0, nullptr, 0); }
+void SPIMaster::synthSetActive(uint8_t engineMask) { cachedSynthActiveMask16 = engineMask; sendCommand(0, nullptr, 0); }
+void SPIMaster::synthSetActive16(uint16_t engineMask16) { cachedSynthActiveMask16 = engineMask16; sendCommand(0, nullptr, 0); }
+void SPIMaster::synthPreset(uint8_t, uint8_t) { sendCommand(0, nullptr, 0); }
+bool SPIMaster::dsqUploadTrack(uint8_t, uint8_t, const DsqStepPkt*, uint8_t) { sendCommand(0, nullptr, 0); return true; }
+bool SPIMaster::dsqSetStep(uint8_t, uint8_t, uint8_t, bool, uint8_t, uint8_t, uint8_t) { sendCommand(0, nullptr, 0); return true; }
+bool SPIMaster::dsqControl(uint8_t) { sendCommand(0, nullptr, 0); return true; }
+bool SPIMaster::dsqSelectPattern(uint8_t) { sendCommand(0, nullptr, 0); return true; }
+bool SPIMaster::dsqSetLength(uint8_t) { sendCommand(0, nullptr, 0); return true; }
+bool SPIMaster::dsqSetMute(uint8_t, bool) { sendCommand(0, nullptr, 0); return true; }
+bool SPIMaster::dsqSetSwing(uint8_t) { sendCommand(0, nullptr, 0); return true; }
+bool SPIMaster::dsqSetParamLock(uint8_t, uint8_t, uint8_t, bool, uint16_t, bool, uint8_t, bool, uint8_t) { sendCommand(0, nullptr, 0); return true; }
+bool SPIMaster::dsqGetPos(uint8_t&, uint8_t&, bool&) { sendCommand(0, nullptr, 0); return false; }
+bool SPIMaster::dsqSetTrackEngine(uint8_t, int8_t) { sendCommand(0, nullptr, 0); return true; }
@@ -0,0 +1,16 @@
+/*
+ * usb/usb_host.h (shim de host)
+ * Sólo los tipos que declara MIDIController.h (sin USB en el host).
+ */
+
+#ifndef HOST_USB_HOST_H
+#define HOST_USB_HOST_H
+
+#include <stdint.h>
+
+typedef struct usb_host_client_s* usb_host_client_handle_t;
+typedef struct usb_device_s* usb_device_handle_t;
+typedef struct { int event; } usb_host_client_event_msg_t;
+typedef struct usb_transfer_s usb_transfer_t;
+
+#endif // HOST_USB_HOST_H
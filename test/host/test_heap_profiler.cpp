@@ -0,0 +1,219 @@
+/*
+ * test_heap_profiler.cpp
+ * RED808 — HeapProfiler en host con trazado activo: contabilidad por tag,
+ * detección de una fuga y el informe de fragmentación sobre un arena simulado
+ */
+// host-build: src/HeapProfiler.cpp
+// host-flags: -DRED808_HEAP_PROFILE=1
+
+#include "HeapProfiler.h"
+#include "host_check.h"
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+static bool findSite(const char* tag, HeapSiteStats* out) {
+  for (uint8_t i = 0; i < heapProfSiteCount(); i++) {
+    if (heapProfSite(i, out) && out->tag == tag) return true;
+  }
+  return false;
+}
+
+static const char* const kTagWs = "test.ws";
+static const char* const kTagLeak = "test.leak";
+static const char* const kTagRealloc = "test.realloc";
+
+static void testTagAccounting() {
+  HeapSiteStats st;
+  void* a = hpAlloc(100, HP_HEAP_DEFAULT, kTagWs);
+  void* b = hpCalloc(10, 30, HP_HEAP_DEFAULT, kTagWs);
+  CHECK(a && b);
+  CHECK(((uint8_t*)b)[0] == 0 && ((uint8_t*)b)[299] == 0);
+  CHECK(findSite(kTagWs, &st));
+  CHECK(st.allocs == 2 && st.frees == 0);
+  CHECK(st.liveBytes == 400 && st.peakBytes == 400);
+
+  hpFree(a);
+  hpFree(b);
+  CHECK(findSite(kTagWs, &st));
+  CHECK(st.frees == 2 && st.liveBytes == 0 && st.peakBytes == 400);
+
+  // Mismo tag en PSRAM es otro sitio
+  void* p = hpAlloc(64, HP_HEAP_PSRAM, kTagWs);
+  uint8_t sitesWithTag = 0;
+  for (uint8_t i = 0; i < heapProfSiteCount(); i++) {
+    HeapSiteStats s;
+    if (heapProfSite(i, &s) && s.tag == kTagWs) sitesWithTag++;
+  }
+  CHECK(sitesWithTag == 2);
+  hpFree(p);
+
+  // realloc: el bloque cambia de tamaño sin duplicar la cuenta
+  void* r = hpRealloc(nullptr, 32, HP_HEAP_DEFAULT, kTagRealloc);
+  memset(r, 0x5A, 32);
+  r = hpRealloc(r, 4096, HP_HEAP_DEFAULT, kTagRealloc);
+  CHECK(r && ((uint8_t*)r)[31] == 0x5A);
+  CHECK(findSite(kTagRealloc, &st));
+  CHECK(st.liveBytes == 4096 && st.allocs == 2 && st.frees == 1);
+  hpFree(r);
+  CHECK(findSite(kTagRealloc, &st));
+  CHECK(st.liveBytes == 0);
+
+  // Un tamaño imposible es un fallo contado, no un bloque corrupto
+  CHECK(hpAlloc(SIZE_MAX - 4, HP_HEAP_DEFAULT, kTagWs) == nullptr);
+  CHECK(hpCalloc(SIZE_MAX / 2, 4, HP_HEAP_DEFAULT, kTagWs) == nullptr);
+  CHECK(findSite(kTagWs, &st));
+  CHECK(st.failed == 1);   // calloc desbordado no llega al allocator
+
+  // Sin tag: el sitio es la dirección de retorno
+  void* c = hpAlloc(8, HP_HEAP_DEFAULT, nullptr);
+  bool callerSite = false;
+  for (uint8_t i = 0; i < heapProfSiteCount(); i++) {
+    HeapSiteStats s;
+    if (heapProfSite(i, &s) && !s.tag && s.caller && s.liveBytes == 8) callerSite = true;
+  }
+  CHECK(callerSite);
+  hpFree(c);
+}
+
+// Fuga: un "handler" que olvida liberar uno de cada cuatro buffers
+static void testLeakDetection() {
+  std::vector<void*> kept;
+  for (int i = 0; i < 200; i++) {
+    void* buf = hpAlloc(256, HP_HEAP_DEFAULT, kTagLeak);
+    if (i % 4 == 0) kept.push_back(buf);   // nunca se libera
+    else hpFree(buf);
+  }
+  HeapSiteStats st;
+  CHECK(findSite(kTagLeak, &st));
+  CHECK(st.allocs == 200 && st.frees == 150);
+  CHECK(st.allocs - st.frees == kept.size());
+  CHECK(st.liveBytes == 50 * 256);
+
+  // El sitio con fuga es el de más bytes vivos (lo que logTopHeapSites lista)
+  uint32_t maxLive = 0;
+  const char* maxTag = nullptr;
+  for (uint8_t i = 0; i < heapProfSiteCount(); i++) {
+    HeapSiteStats s;
+    if (heapProfSite(i, &s) && s.liveBytes > maxLive) { maxLive = s.liveBytes; maxTag = s.tag; }
+  }
+  CHECK(maxTag == kTagLeak);
+
+  for (void* p : kept) hpFree(p);
+  CHECK(findSite(kTagLeak, &st));
+  CHECK(st.liveBytes == 0 && st.allocs == st.frees);
+}
+
+// Tabla de sitios llena: lo que no cabe cuenta en untracked y sigue funcionando
+static void testSiteOverflow() {
+  static char tags[HP_MAX_SITES + 4][8];
+  uint32_t before = heapProfUntracked();
+  for (int i = 0; i < HP_MAX_SITES + 4; i++) {
+    snprintf(tags[i], sizeof(tags[i]), "t%d", i);
+    void* p = hpAlloc(16, HP_HEAP_DEFAULT, tags[i]);
+    CHECK(p != nullptr);
+    hpFree(p);
+  }
+  CHECK(heapProfSiteCount() == HP_MAX_SITES);
+  CHECK(heapProfUntracked() > before);
+}
+
+// ── Fragmentación ────────────────────────────────────────────────────────────
+// Arena first-fit de 64 KB: reproduce el patrón que fragmentaba la RAM interna
+// (buffers de frame de vida corta intercalados con bloques de vida larga) y
+// genera el informe con los mismos helpers que el walker del ESP32.
+
+struct ArenaBlock { uint32_t off, size; bool used; };
+
+struct Arena {
+  std::vector<ArenaBlock> blocks;
+  explicit Arena(uint32_t size) { blocks.push_back({0, size, false}); }
+
+  int alloc(uint32_t size) {
+    size = (size + 7) & ~7u;
+    for (size_t i = 0; i < blocks.size(); i++) {
+      ArenaBlock& b = blocks[i];
+      if (b.used || b.size < size) continue;
+      if (b.size > size) blocks.insert(blocks.begin() + i + 1, {b.off + size, b.size - size, false});
+      blocks[i].size = size;
+      blocks[i].used = true;
+      return (int)blocks[i].off;
+    }
+    return -1;
+  }
+
+  void release(int off) {
+    for (size_t i = 0; i < blocks.size(); i++) {
+      if ((int)blocks[i].off != off) continue;
+      blocks[i].used = false;
+      if (i + 1 < blocks.size() && !blocks[i + 1].used) {
+        blocks[i].size += blocks[i + 1].size;
+        blocks.erase(blocks.begin() + i + 1);
+      }
+      if (i > 0 && !blocks[i - 1].used) {
+        blocks[i - 1].size += blocks[i].size;
+        blocks.erase(blocks.begin() + i);
+      }
+      return;
+    }
+  }
+
+  void report(HeapFreeInfo* info) const {
+    memset(info, 0, sizeof(*info));
+    for (const ArenaBlock& b : blocks) {
+      if (b.used) continue;
+      info->totalFree += b.size;
+      info->freeBlocks++;
+      if (b.size > info->largestFree) info->largestFree = b.size;
+      heapProfHistAdd(info, b.size);
+    }
+    info->histValid = true;
+  }
+};
+
+static void testFragmentationReport() {
+  CHECK(heapProfBin(0) == 0 && heapProfBin(63) == 0 && heapProfBin(64) == 1);
+  CHECK(heapProfBin(1023) == 2 && heapProfBin(1024) == 3);
+  CHECK(heapProfBin(256 * 1024) == HP_HIST_BINS - 1 && heapProfBin(UINT32_MAX) == HP_HIST_BINS - 1);
+  CHECK(strcmp(heapProfBinLabel(0), "<64") == 0 && strcmp(heapProfBinLabel(HP_HIST_BINS), "?") == 0);
+
+  Arena arena(64 * 1024);
+  HeapFreeInfo fi;
+  arena.report(&fi);
+  CHECK(heapProfFragPct(fi) == 0 && fi.freeBlocks == 1 && fi.hist[heapProfBin(64 * 1024)] == 1);
+
+  // Frame de 1 KB + bloque de vida larga de 200 B, alternados hasta llenar
+  std::vector<int> frames;
+  for (;;) {
+    int f = arena.alloc(1024);
+    if (f < 0) break;
+    frames.push_back(f);
+    if (arena.alloc(200) < 0) break;
+  }
+  for (int f : frames) arena.release(f);
+  arena.report(&fi);
+
+  // Hay ~50 KB libres pero ningún hueco cabe un buffer de 4 KB
+  CHECK(fi.totalFree > 40 * 1024);
+  CHECK(fi.largestFree < 4096);
+  CHECK(fi.freeBlocks >= frames.size() - 1);
+  CHECK_MSG(heapProfFragPct(fi) >= 90, "frag=%u", heapProfFragPct(fi));
+  CHECK(fi.hist[heapProfBin(1024)] >= frames.size() - 1);
+  uint32_t counted = 0;
+  for (int b = 0; b < HP_HIST_BINS; b++) counted += fi.hist[b];
+  CHECK(counted == fi.freeBlocks);
+
+  HeapFreeInfo empty = {};
+  CHECK(heapProfFragPct(empty) == 0);
+  // En host no hay heap propio: el informe real sólo existe en el ESP32
+  CHECK(!heapProfFreeInfo(HP_HEAP_DEFAULT, &fi));
+}
+
+int main() {
+  CHECK(heapProfEnabled());
+  testTagAccounting();
+  testLeakDetection();
+  testFragmentationReport();
+  testSiteOverflow();   // el último: llena la tabla de sitios
+  return hostCheckResult("heap_profiler");
+}
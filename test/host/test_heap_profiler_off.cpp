@@ -0,0 +1,43 @@
+/*
+ * test_heap_profiler_off.cpp
+ * RED808 — HeapProfiler en host sin trazado: los wrappers son el allocator
+ */
+// host-build: src/HeapProfiler.cpp
+// host-flags: -DRED808_HEAP_PROFILE=0
+
+#include "HeapProfiler.h"
+#include "host_check.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main() {
+  CHECK(!heapProfEnabled());
+
+  uint8_t* p = (uint8_t*)hpCalloc(16, 8, HP_HEAP_PSRAM, "off.calloc");
+  CHECK(p && p[0] == 0 && p[127] == 0);
+  p = (uint8_t*)hpRealloc(p, 1024, HP_HEAP_PSRAM, "off.calloc");
+  CHECK(p != nullptr);
+  hpFree(p);
+
+  // Sin cabecera: un bloque de los wrappers se puede liberar con free()
+  void* q = hpAlloc(32, HP_HEAP_DEFAULT, "off.alloc");
+  CHECK(q != nullptr);
+  free(q);
+
+  CHECK(hpCalloc(SIZE_MAX / 2, 4, HP_HEAP_DEFAULT, nullptr) == nullptr);
+  CHECK(heapProfSiteCount() == 0 && heapProfUntracked() == 0);
+  HeapSiteStats st;
+  CHECK(!heapProfSite(0, &st));
+
+  // El histograma no depende del trazado
+  HeapFreeInfo fi = {};
+  heapProfHistAdd(&fi, 100);
+  heapProfHistAdd(&fi, 5000);
+  CHECK(fi.hist[1] == 1 && fi.hist[4] == 1);
+  fi.totalFree = 1000;
+  fi.largestFree = 250;
+  CHECK(heapProfFragPct(fi) == 75);
+
+  return hostCheckResult("heap_profiler_off");
+}
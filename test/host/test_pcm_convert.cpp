@@ -0,0 +1,195 @@
+/*
+ * test_pcm_convert.cpp
+ * RED808 — kernels de PcmConvert frente a la conversión frame a frame
+ * anterior (parseWavFile / parseWavFromBuffer / WavStreamParser), para todos
+ * los formatos, canales, alineaciones de la fuente y colas de bloque.
+ */
+// host-build: src/PcmConvert.cpp
+
+#include "PcmConvert.h"
+#include "host_check.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// ── Referencias: el código por frame previo a los kernels ────────────────────
+
+static int16_t refS24(const uint8_t* b) {
+  int32_t v = (int32_t)b[0] | ((int32_t)b[1] << 8) | ((int32_t)b[2] << 16);
+  if (v & 0x00800000) v |= ~0x00FFFFFF;  // sign-extend
+  return (int16_t)(v >> 8);
+}
+
+static int16_t refS16(const uint8_t* b) { return (int16_t)(b[0] | (b[1] << 8)); }
+
+// parseWavFromBuffer / WavStreamParser::convertFrame (16 y 24 bit)
+static int16_t refFrameBuffer(const uint8_t* f, uint16_t bits, uint8_t channels) {
+  if (bits == 16) {
+    int16_t l = refS16(f);
+    return (channels == 1) ? l : (int16_t)(((int32_t)l + refS16(f + 2)) / 2);
+  }
+  int16_t l = refS24(f);
+  return (channels == 1) ? l : (int16_t)(((int32_t)l + refS24(f + 3)) / 2);
+}
+
+// parseWavFile estéreo 16-bit: (L/2) + (R/2)
+static int16_t refFrameFileS16Stereo(const uint8_t* f) {
+  return (int16_t)((refS16(f) / 2) + (refS16(f + 2) / 2));
+}
+
+// u8 y float32 no existían antes de los kernels: referencia escalar de su
+// definición (centro 128 × 256; float × 32767 redondeado y saturado)
+static int16_t refU8(uint8_t b) { return (int16_t)(((int32_t)b - 128) * 256); }
+static int16_t refF32(const uint8_t* p) {
+  float x;
+  memcpy(&x, p, 4);
+  if (isnan(x)) return 0;
+  if (x >= 1.0f) return 32767;
+  if (x <= -1.0f) return -32767;
+  return (int16_t)lrintf(truncf(x * 32767.0f + (x < 0.0f ? -0.5f : 0.5f)));
+}
+static int16_t refFrameNew(const uint8_t* f, PcmFormat fmt, uint8_t channels) {
+  int32_t l, r;
+  if (fmt == PCM_U8) {
+    l = refU8(f[0]);
+    r = channels == 2 ? refU8(f[1]) : 0;
+  } else {
+    l = refF32(f);
+    r = channels == 2 ? refF32(f + 4) : 0;
+  }
+  return channels == 1 ? (int16_t)l : (int16_t)((l + r) / 2);
+}
+
+// ── Datos de prueba ──────────────────────────────────────────────────────────
+
+static uint32_t rngState = 0x808u;
+static uint32_t rng() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+// Bytes aleatorios con extremos intercalados (±full scale, 0, -1, impares)
+static void fillInteger(uint8_t* p, size_t n, size_t sampleBytes) {
+  static const uint8_t kEdges[][3] = {
+    {0x00, 0x00, 0x80}, {0xFF, 0xFF, 0x7F}, {0x00, 0x00, 0x00}, {0xFF, 0xFF, 0xFF},
+    {0x01, 0x00, 0x00}, {0xFF, 0x80, 0x00}, {0x00, 0x01, 0x80}, {0x80, 0x7F, 0xFF},
+  };
+  for (size_t i = 0; i < n; i++) p[i] = (uint8_t)rng();
+  for (size_t i = 0; i + sampleBytes <= n; i += sampleBytes * 5) {
+    const uint8_t* e = kEdges[rng() % 8];
+    for (size_t b = 0; b < sampleBytes; b++) p[i + b] = e[3 - sampleBytes + b];
+  }
+}
+
+static void fillFloat(uint8_t* p, size_t frames, uint8_t channels) {
+  static const float kEdges[] = {0.0f, -0.0f, 1.0f, -1.0f, 1.5f, -3.0f, 0.5f / 32767.0f,
+                                 -0.5f / 32767.0f, 0.99999f, -0.99999f, NAN, INFINITY, -INFINITY};
+  for (size_t i = 0; i < frames * channels; i++) {
+    float x = (rng() % 7 == 0) ? kEdges[rng() % 13] : ((float)(int32_t)rng() / 2147483648.0f) * 1.1f;
+    memcpy(p + i * 4, &x, 4);
+  }
+}
+
+// ── Tests ────────────────────────────────────────────────────────────────────
+
+struct Case {
+  uint16_t audioFormat;
+  uint16_t bits;
+  uint8_t channels;
+};
+
+static const Case kCases[] = {
+  {1, 8, 1}, {1, 8, 2}, {1, 16, 1}, {1, 16, 2}, {1, 24, 1}, {1, 24, 2},
+  {0xFFFE, 16, 2}, {0xFFFE, 24, 2}, {3, 32, 1}, {3, 32, 2},
+};
+
+// Tamaños de bloque: colas de 0-3 frames tras los grupos de 4, y un staging entero
+static const size_t kFrameCounts[] = {0, 1, 2, 3, 4, 5, 7, 8, 13, 37, 1000, PCM_STAGING_BYTES / 6};
+
+static void testAgainstPerFrame() {
+  std::vector<uint8_t> raw(PCM_STAGING_BYTES * 2 + 16);
+  std::vector<int16_t> out(PCM_STAGING_BYTES + 8);
+
+  for (const Case& c : kCases) {
+    PcmSpec spec;
+    char err[48];
+    CHECK(pcmSpecFromWav(c.audioFormat, c.bits, c.channels, &spec, err, sizeof(err)));
+    CHECK(spec.frameBytes == (c.bits / 8) * c.channels);
+
+    for (size_t frames : kFrameCounts) {
+      // Desplazamiento 0 = palabras de 32 bit; 1-3 = ruta byte a byte (chunks HTTP)
+      for (size_t offset = 0; offset < 4; offset++) {
+        uint8_t* src = raw.data() + offset;
+        if (spec.format == PCM_F32) fillFloat(src, frames, c.channels);
+        else fillInteger(src, frames * spec.frameBytes, c.bits / 8);
+
+        int16_t* dst = out.data();
+        dst[frames] = 0x5A5A;   // centinela: no escribir de más
+        pcmConvert(spec, src, dst, frames);
+        CHECK(dst[frames] == 0x5A5A);
+
+        size_t mismatches = 0, first = 0;
+        for (size_t i = 0; i < frames; i++) {
+          const uint8_t* f = src + i * spec.frameBytes;
+          int16_t want = (spec.format == PCM_S16 || spec.format == PCM_S24)
+                           ? refFrameBuffer(f, c.bits, c.channels)
+                           : refFrameNew(f, spec.format, c.channels);
+          if (dst[i] != want && mismatches++ == 0) first = i;
+        }
+        CHECK_MSG(mismatches == 0, "fmt=%u bits=%u ch=%u frames=%zu off=%zu: %zu distintos (primero %zu)",
+                  c.audioFormat, c.bits, c.channels, frames, offset, mismatches, first);
+      }
+    }
+  }
+}
+
+// Única diferencia documentada: s16 estéreo de parseWavFile truncaba cada
+// canal por separado. Como mucho 1 LSB, y sólo si algún canal es impar.
+static void testParseWavFileStereo16() {
+  const size_t frames = 4096;
+  std::vector<uint8_t> raw(frames * 4);
+  std::vector<int16_t> out(frames);
+  fillInteger(raw.data(), raw.size(), 2);
+  PcmSpec spec;
+  char err[48];
+  CHECK(pcmSpecFromWav(1, 16, 2, &spec, err, sizeof(err)));
+  pcmConvert(spec, raw.data(), out.data(), frames);
+
+  size_t differ = 0;
+  bool onlyWithOdd = true, withinOne = true;
+  for (size_t i = 0; i < frames; i++) {
+    const uint8_t* f = raw.data() + i * 4;
+    int16_t old = refFrameFileS16Stereo(f);
+    if (out[i] == old) continue;
+    differ++;
+    if (abs(out[i] - old) > 1) withinOne = false;
+    if ((refS16(f) & 1) == 0 && (refS16(f + 2) & 1) == 0) onlyWithOdd = false;
+  }
+  CHECK(withinOne);
+  CHECK(onlyWithOdd);
+  CHECK(differ > 0);   // con datos aleatorios la diferencia aparece
+  printf("  s16 estéreo vs parseWavFile anterior: %zu/%zu frames difieren en 1 LSB\n", differ, frames);
+}
+
+static void testUnsupportedSpecs() {
+  PcmSpec spec;
+  char err[48];
+  CHECK(!pcmSpecFromWav(2, 16, 1, &spec, err, sizeof(err)));     // ADPCM
+  CHECK(!pcmSpecFromWav(1, 12, 1, &spec, err, sizeof(err)));
+  CHECK(!pcmSpecFromWav(1, 32, 1, &spec, err, sizeof(err)));     // s32 entero
+  CHECK(!pcmSpecFromWav(3, 64, 1, &spec, err, sizeof(err)));     // double
+  CHECK(!pcmSpecFromWav(1, 16, 0, &spec, err, sizeof(err)));
+  CHECK(!pcmSpecFromWav(1, 16, 6, &spec, err, sizeof(err)));
+  CHECK(strstr(err, "channel") != nullptr);
+  CHECK(PCM_STAGING_BYTES % 6 == 0 && PCM_STAGING_BYTES % 8 == 0);
+}
+
+int main() {
+  testAgainstPerFrame();
+  testParseWavFileStereo16();
+  testUnsupportedSpecs();
+  return hostCheckResult("pcm_convert");
+}
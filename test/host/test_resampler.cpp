@@ -0,0 +1,156 @@
+/*
+ * test_resampler.cpp
+ * RED808 — Resampler frente al resample ideal (seno analítico en los
+ * instantes n·src/dst): longitud, SNR, rizado de la banda de paso, alias
+ * y troceo del streaming. Cubre ratios de tabla directa (48k, 22.05k) y
+ * ratios que interpolan coeficientes (44056 Hz → L = 11025).
+ */
+// host-build: src/Resampler.cpp src/HeapProfiler.cpp
+
+#include "Resampler.h"
+#include "host_check.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+static const double kPi = 3.14159265358979323846;
+static const double kAmp = 16000.0;
+
+static std::vector<int16_t> sine(uint32_t rate, double hz, uint32_t frames) {
+  std::vector<int16_t> v(frames);
+  for (uint32_t i = 0; i < frames; i++) v[i] = (int16_t)lrint(kAmp * sin(2.0 * kPi * hz * i / rate));
+  return v;
+}
+
+// Conversión completa; chunk 0 = de una vez
+static std::vector<int16_t> convert(Resampler& rs, uint32_t src, ResampleQuality q,
+                                    const std::vector<int16_t>& in, size_t chunk) {
+  std::vector<int16_t> out;
+  if (!rs.begin(src, RS_TARGET_RATE, q, (uint32_t)in.size())) return out;
+  out.resize(rs.outputLength());
+  size_t w = 0, pos = 0;
+  while (pos < in.size()) {
+    size_t n = chunk ? (size_t)(1 + rand() % chunk) : in.size();
+    if (n > in.size() - pos) n = in.size() - pos;
+    w += rs.process(in.data() + pos, n, out.data() + w, out.size() - w);
+    pos += n;
+  }
+  w += rs.flush(out.data() + w, out.size() - w);
+  out.resize(w);
+  return out;
+}
+
+// SNR (dB) frente al seno ideal en la salida, fuera de los bordes del filtro
+static double snrIdeal(const std::vector<int16_t>& y, double hz) {
+  double sig = 0.0, err = 0.0;
+  for (size_t n = 256; n + 256 < y.size(); n++) {
+    double ideal = kAmp * sin(2.0 * kPi * hz * n / RS_TARGET_RATE);
+    sig += ideal * ideal;
+    err += (y[n] - ideal) * (y[n] - ideal);
+  }
+  return 10.0 * log10(sig / (err > 0.0 ? err : 1e-9));
+}
+
+// Amplitud (dB respecto a kAmp) del tono hz en la salida, ajuste seno/coseno
+static double toneDb(const std::vector<int16_t>& y, double hz) {
+  double a = 0.0, b = 0.0;
+  size_t n0 = 256, n1 = y.size() - 256;
+  for (size_t n = n0; n < n1; n++) {
+    double ph = 2.0 * kPi * hz * n / RS_TARGET_RATE;
+    a += y[n] * cos(ph);
+    b += y[n] * sin(ph);
+  }
+  double amp = 2.0 * sqrt(a * a + b * b) / (double)(n1 - n0);
+  return 20.0 * log10(amp / kAmp);
+}
+
+// Energía total (dB respecto a un seno de amplitud kAmp): para el alias
+static double rmsDb(const std::vector<int16_t>& y) {
+  double e = 0.0;
+  size_t n0 = 256, n1 = y.size() - 256;
+  for (size_t n = n0; n < n1; n++) e += (double)y[n] * y[n];
+  double rms = sqrt(e / (double)(n1 - n0));
+  return 20.0 * log10((rms + 1e-9) / (kAmp / sqrt(2.0)));
+}
+
+static void checkLengthAndSnr(Resampler& rs, uint32_t src, ResampleQuality q, double minSnr) {
+  const uint32_t frames = 50000;
+  uint64_t expected = ((uint64_t)frames * RS_TARGET_RATE + src - 1) / src;
+  static const double kTones[] = { 440.0, 1000.0, 5000.0, 12000.0 };
+  for (double hz : kTones) {
+    // Sólo tonos de la banda plana (0.6·Nyquist del rate menor)
+    if (hz > 0.3 * (src < RS_TARGET_RATE ? src : RS_TARGET_RATE)) continue;
+    std::vector<int16_t> y = convert(rs, src, q, sine(src, hz, frames), 0);
+    CHECK_MSG(y.size() == expected, "%u Hz: %zu salidas, esperadas %llu",
+              (unsigned)src, y.size(), (unsigned long long)expected);
+    if (y.size() < 1024) continue;
+    double snr = snrIdeal(y, hz);
+    CHECK_MSG(snr >= minSnr, "%u Hz %s, tono %.0f Hz: SNR %.1f dB < %.1f",
+              (unsigned)src, resampleQualityName(q), hz, snr, minSnr);
+  }
+}
+
+int main() {
+  Resampler rs;
+
+  // Mismo rate: no hay nada que hacer
+  CHECK(!rs.begin(RS_TARGET_RATE, RS_TARGET_RATE, RS_Q_MEDIUM, 1000));
+  CHECK(!rs.begin(0, RS_TARGET_RATE, RS_Q_MEDIUM, 1000));
+
+  // ── Longitud exacta y SNR frente al resample ideal ──
+  // 44056 → 44100 (L = 11025 > RS_MAX_PHASES) es el caso que antes se
+  // aproximaba a 502/501: tono desplazado ~1e-3, SNR ~ -3 dB y 48 salidas de más
+  checkLengthAndSnr(rs, 44056, RS_Q_MEDIUM, 60.0);
+  checkLengthAndSnr(rs, 44056, RS_Q_HIGH, 70.0);
+  checkLengthAndSnr(rs, 44101, RS_Q_MEDIUM, 60.0);
+  checkLengthAndSnr(rs, 48000, RS_Q_MEDIUM, 60.0);
+  checkLengthAndSnr(rs, 48000, RS_Q_HIGH, 70.0);
+  checkLengthAndSnr(rs, 22050, RS_Q_MEDIUM, 60.0);
+  checkLengthAndSnr(rs, 96000, RS_Q_MEDIUM, 60.0);
+  checkLengthAndSnr(rs, 32000, RS_Q_FAST, 45.0);
+
+  // ── Rizado de la banda de paso ──
+  static const uint32_t kRippleRates[] = { 48000, 44056, 22050 };
+  for (uint32_t src : kRippleRates) {
+    // medium: plano hasta ~0.75·Nyquist del rate menor; se mide hasta 0.6
+    double edge = 0.6 * 0.5 * (src < RS_TARGET_RATE ? src : RS_TARGET_RATE);
+    double lo = 1e9, hi = -1e9;
+    for (double hz = 100.0; hz <= edge; hz += 500.0) {
+      double db = toneDb(convert(rs, src, RS_Q_MEDIUM, sine(src, hz, 20000), 0), hz);
+      if (db < lo) lo = db;
+      if (db > hi) hi = db;
+    }
+    CHECK_MSG(hi - lo < 0.05 && lo > -0.05 && hi < 0.05, "%u Hz: rizado %.4f..%.4f dB",
+              (unsigned)src, lo, hi);
+  }
+
+  // ── Alias al decimar: tonos por encima del Nyquist de 44.1k ──
+  static const double kAliasTones[] = { 22800.0, 23500.0 };
+  for (double hz : kAliasTones) {
+    double db = rmsDb(convert(rs, 48000, RS_Q_MEDIUM, sine(48000, hz, 20000), 0));
+    CHECK_MSG(db < -60.0, "48k, tono %.0f Hz: alias %.1f dB", hz, db);
+    db = rmsDb(convert(rs, 48000, RS_Q_HIGH, sine(48000, hz, 20000), 0));
+    CHECK_MSG(db < -80.0, "48k high, tono %.0f Hz: alias %.1f dB", hz, db);
+  }
+  // 96k: todo lo que está entre 22.05k y 48k tiene que desaparecer
+  for (double hz = 24000.0; hz < 47000.0; hz += 4000.0) {
+    double db = rmsDb(convert(rs, 96000, RS_Q_MEDIUM, sine(96000, hz, 20000), 0));
+    CHECK_MSG(db < -60.0, "96k, tono %.0f Hz: alias %.1f dB", hz, db);
+  }
+
+  // ── Streaming: cualquier troceo da la misma salida que de una vez ──
+  static const uint32_t kStreamRates[] = { 44056, 48000, 22050, 96000 };
+  for (uint32_t src : kStreamRates) {
+    std::vector<int16_t> in = sine(src, 3000.0, 30000);
+    for (size_t i = 0; i < in.size(); i += 97) in[i] = (int16_t)(rand() % 20000 - 10000);
+    std::vector<int16_t> ref = convert(rs, src, RS_Q_MEDIUM, in, 0);
+    for (size_t chunk : { (size_t)1, (size_t)7, (size_t)300, (size_t)2000 }) {
+      std::vector<int16_t> got = convert(rs, src, RS_Q_MEDIUM, in, chunk);
+      CHECK_MSG(got == ref, "%u Hz, trozos <= %zu: difiere del one-shot", (unsigned)src, chunk);
+    }
+  }
+
+  rs.release();
+  return hostCheckResult("test_resampler");
+}
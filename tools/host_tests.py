@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+RED808 tests y benchmarks de host (sin ESP32).
+
+Compila cada test/host/*.cpp con g++ junto a los módulos de src/ que declara
+en su cabecera y lo ejecuta (desde la raíz del repo). Claves de cabecera,
+repetibles:
+  // host-build: src/CommandTable.cpp src/Resampler.cpp
+  // host-flags: -DRED808_HEAP_PROFILE=1
+  // host-link: -Wl,--wrap=malloc
+  // host-requires: ArduinoJson red808_protocol
+host-requires marca dependencias de fuera del repo; si falta alguna el test
+sale como SKIP, no como fallo:
+  ArduinoJson       ARDUINOJSON_DIR o .pio/libdeps/*/ArduinoJson/src (pio run)
+  red808_protocol   ../shared/red808_protocol_codes.h junto al repo
+Sale con código != 0 si algún test no compila o devuelve error.
+
+Uso:
+  python tools/host_tests.py                  # todos
+  python tools/host_tests.py resampler        # sólo los que contienen "resampler"
+  python tools/host_tests.py --cxx clang++ --keep
+"""
+
+import argparse
+import glob
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+TEST_DIR = os.path.join(ROOT, "test", "host")
+CXXFLAGS = ["-std=gnu++17", "-O2", "-Wall", "-Wextra", "-I" + os.path.join(ROOT, "src"), "-I" + TEST_DIR]
+
+
+def header_list(path, key):
+    out = []
+    rx = re.compile(r"^//\s*" + key + r":\s*(.*)$")
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            m = rx.match(line.strip())
+            if m:
+                out.extend(m.group(1).split())
+    return out
+
+
+def require_arduinojson():
+    dirs = [os.environ.get("ARDUINOJSON_DIR", "")]
+    dirs += sorted(glob.glob(os.path.join(ROOT, ".pio", "libdeps", "*", "ArduinoJson", "src")))
+    for d in dirs:
+        if d and os.path.isfile(os.path.join(d, "ArduinoJson.h")):
+            # Sin ARDUINO definido hay que pedir el soporte de String/Stream/Print
+            return ["-I" + d, "-DARDUINOJSON_ENABLE_ARDUINO_STRING=1", "-DARDUINOJSON_ENABLE_ARDUINO_STREAM=1",
+                    "-DARDUINOJSON_ENABLE_ARDUINO_PRINT=1", "-DARDUINOJSON_ENABLE_PROGMEM=0"]
+    return None
+
+
+def require_protocol():
+    # src/protocol.h lo incluye como ../../shared/red808_protocol_codes.h
+    path = os.path.join(os.path.dirname(ROOT), "shared", "red808_protocol_codes.h")
+    return [] if os.path.isfile(path) else None
+
+
+REQUIRES = {"ArduinoJson": require_arduinojson, "red808_protocol": require_protocol}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("filter", nargs="*", help="subcadenas del nombre del test")
+    ap.add_argument("--cxx", default=os.environ.get("CXX", "g++"))
+    ap.add_argument("--keep", action="store_true", help="no borrar los binarios")
+    args = ap.parse_args()
+
+    tests = sorted(f for f in os.listdir(TEST_DIR) if f.endswith(".cpp"))
+    if args.filter:
+        tests = [t for t in tests if any(s in t for s in args.filter)]
+    if not tests:
+        print("sin tests")
+        return 1
+
+    build = tempfile.mkdtemp(prefix="red808_host_")
+    failed = []
+    skipped = []
+    for t in tests:
+        src = os.path.join(TEST_DIR, t)
+        deps = [os.path.join(ROOT, d) for d in header_list(src, "host-build")]
+        flags = header_list(src, "host-flags")
+        missing = []
+        for req in header_list(src, "host-requires"):
+            extra = REQUIRES[req]() if req in REQUIRES else None
+            if extra is None:
+                missing.append(req)
+            else:
+                flags += extra
+        print(f"── {t}")
+        if missing:
+            print("  SKIP: falta " + ", ".join(missing))
+            skipped.append(t)
+            continue
+        exe = os.path.join(build, t[:-4])
+        cmd = [args.cxx] + CXXFLAGS + flags + [src] + deps + ["-o", exe] + header_list(src, "host-link") + ["-lpthread"]
+        if subprocess.call(cmd, cwd=ROOT) != 0:
+            failed.append(t + " (compila)")
+            continue
+        if subprocess.call([exe], cwd=ROOT) != 0:
+            failed.append(t)
+
+    if not args.keep:
+        shutil.rmtree(build, ignore_errors=True)
+    print()
+    if failed:
+        print("FALLAN: " + ", ".join(failed))
+        return 1
+    ran = len(tests) - len(skipped)
+    print(f"OK: {ran} tests" + (f" ({len(skipped)} SKIP: {', '.join(skipped)})" if skipped else ""))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
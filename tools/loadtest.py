@@ -0,0 +1,357 @@
+#!/usr/bin/env python3
+"""
+RED808 carga sintética / replay contra el master real.
+
+Simula N slaves UDP y M navegadores WebSocket enviando comandos a ritmo
+configurable (o reproduciendo una traza grabada) y al final imprime:
+  - RTT por slave UDP (envío → {"s":"ok"}), lado cliente
+  - latencia por comando y por canal medida en el ESP32 (/api/cmdprof)
+  - heap mínimo / bloque mayor durante la ventana y slabs (/api/sysinfo)
+
+Uso:
+  python tools/loadtest.py --host 192.168.4.1 --udp 10 --udp-rate 50 --ws 3 --seconds 30
+  python tools/loadtest.py --trace sesion.jsonl --speed 2
+  python tools/loadtest.py --record sesion.jsonl        # graba lo enviado
+  python tools/loadtest.py --write-trace mezcla.jsonl   # sin red: sólo la traza
+
+Traza (JSONL): una línea por comando
+  {"t": 12.5, "via": "udp", "src": 3, "cmd": {"cmd": "setFilterCutoff", "value": 800}}
+t en ms desde el inicio, via "udp"|"ws", src = índice de slave / navegador.
+Las trazas también las reproduce sin hardware test/host/harness_commands.cpp.
+
+WebSocket requiere el paquete "websockets" (pip install websockets); sin él
+sólo se ejecuta la parte UDP.
+"""
+
+import argparse
+import asyncio
+import json
+import random
+import statistics
+import sys
+import time
+import urllib.request
+
+UDP_PORT = 8888  # UDP_PORT en WebInterface.h
+
+# Mezcla por defecto: mayoría de knobs (ruta PARAM/coalesce), triggers y
+# alguna edición de step / consulta de estado, como un directo real
+DEFAULT_MIX = [
+    (40, lambda r: {"cmd": "setFilterCutoff", "value": r.randint(100, 12000)}),
+    (15, lambda r: {"cmd": "setTrackPan", "track": r.randrange(16), "value": r.randint(-100, 100)}),
+    (10, lambda r: {"cmd": "setTrackDistortion", "track": r.randrange(16), "amount": r.random()}),
+    (20, lambda r: {"cmd": "trigger", "pad": r.randrange(16), "vel": r.randint(40, 127)}),
+    (8,  lambda r: {"cmd": "setStep", "track": r.randrange(16), "step": r.randrange(16),
+                    "active": r.random() < 0.5}),
+    (4,  lambda r: {"cmd": "tempo", "value": r.randint(90, 160)}),
+    (3,  lambda r: {"cmd": "getState"}),
+]
+
+
+def pick(rng, mix):
+    total = sum(w for w, _ in mix)
+    x = rng.uniform(0, total)
+    for w, make in mix:
+        x -= w
+        if x <= 0:
+            return make(rng)
+    return mix[-1][1](rng)
+
+
+def http(host, method, path, timeout=3.0):
+    req = urllib.request.Request(f"http://{host}{path}", method=method)
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as resp:
+            return json.loads(resp.read().decode("utf-8") or "{}")
+    except Exception as exc:  # noqa: BLE001 — herramienta de banco, basta con avisar
+        print(f"[loadtest] {method} {path} falló: {exc}", file=sys.stderr)
+        return None
+
+
+# ═══════════════════════════════════════════════════════
+# UDP
+# ═══════════════════════════════════════════════════════
+class UdpSlave(asyncio.DatagramProtocol):
+    """Un slave: las respuestas llegan en orden, así que basta con una FIFO."""
+
+    def __init__(self):
+        self.pending = []
+        self.rtt_ms = []
+        self.sent = 0
+        self.ok = 0
+        self.rate_limited = 0
+        self.errors = 0
+        self.transport = None
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def send(self, obj):
+        self.pending.append(time.perf_counter())
+        self.transport.sendto(json.dumps(obj, separators=(",", ":")).encode())
+        self.sent += 1
+
+    def datagram_received(self, data, addr):
+        if data[:1] != b"{":
+            return  # sync binario (0xA5...) u otros broadcasts
+        try:
+            msg = json.loads(data)
+        except ValueError:
+            return
+        if "s" not in msg:
+            return  # state_sync / broadcasts, no es respuesta a un comando
+        if self.pending:
+            self.rtt_ms.append((time.perf_counter() - self.pending.pop(0)) * 1000.0)
+        if msg["s"] == "ok":
+            self.ok += 1
+        elif msg.get("m") == "rate":
+            self.rate_limited += 1
+        else:
+            self.errors += 1
+
+
+# ═══════════════════════════════════════════════════════
+# WEBSOCKET
+# ═══════════════════════════════════════════════════════
+class WsBrowser:
+    def __init__(self):
+        self.sent = 0
+        self.received = 0
+        self.rx_bytes = 0
+        self.ws = None
+
+    async def connect(self, host):
+        import websockets  # noqa: PLC0415 — dependencia opcional
+        self.ws = await websockets.connect(f"ws://{host}/ws", max_size=None)
+        asyncio.ensure_future(self._drain())
+
+    async def _drain(self):
+        try:
+            async for msg in self.ws:
+                self.received += 1
+                self.rx_bytes += len(msg)
+        except Exception:  # noqa: BLE001 — cierre al final de la prueba
+            pass
+
+    async def send(self, obj):
+        await self.ws.send(json.dumps(obj, separators=(",", ":")))
+        self.sent += 1
+
+
+# ═══════════════════════════════════════════════════════
+# GENERADORES
+# ═══════════════════════════════════════════════════════
+async def synthetic(sender, rate_hz, seconds, rng):
+    if rate_hz <= 0:
+        return
+    period = 1.0 / rate_hz
+    t_end = time.perf_counter() + seconds
+    next_t = time.perf_counter() + rng.uniform(0, period)
+    while True:
+        now = time.perf_counter()
+        if now >= t_end:
+            return
+        if next_t > now:
+            await asyncio.sleep(next_t - now)
+        res = sender(pick(rng, DEFAULT_MIX))
+        if asyncio.iscoroutine(res):
+            await res
+        next_t += period
+
+
+def synthetic_trace(args, rng):
+    """La misma mezcla que synthetic() con el reloj calculado, sin red"""
+    events = []
+    sources = [("udp", i, args.udp_rate) for i in range(args.udp)]
+    sources += [("ws", i, args.ws_rate) for i in range(args.ws)]
+    for via, src, rate_hz in sources:
+        if rate_hz <= 0:
+            continue
+        r = random.Random(rng.random())
+        period = 1.0 / rate_hz
+        t = r.uniform(0, period)
+        while t < args.seconds:
+            events.append({"t": round(t * 1000.0, 2), "via": via, "src": src, "cmd": pick(r, DEFAULT_MIX)})
+            t += period
+    events.sort(key=lambda e: e["t"])
+    return events
+
+
+def write_trace(path, events):
+    with open(path, "w", encoding="utf-8") as f:
+        for ev in events:
+            f.write(json.dumps(ev, separators=(",", ":")) + "\n")
+
+
+class Recorder:
+    """--record: cada comando enviado, en formato de traza"""
+
+    def __init__(self):
+        self.t0 = time.perf_counter()
+        self.events = []
+
+    def wrap(self, via, src, send):
+        def sender(obj):
+            self.events.append({"t": round((time.perf_counter() - self.t0) * 1000.0, 2),
+                                "via": via, "src": src, "cmd": obj})
+            return send(obj)
+        return sender
+
+
+async def replay(trace, udp_slaves, browsers, speed):
+    t0 = time.perf_counter()
+    for ev in trace:
+        due = t0 + ev["t"] / 1000.0 / speed
+        delay = due - time.perf_counter()
+        if delay > 0:
+            await asyncio.sleep(delay)
+        src = int(ev.get("src", 0))
+        if ev.get("via", "udp") == "ws":
+            if browsers:
+                await browsers[src % len(browsers)].send(ev["cmd"])
+        elif udp_slaves:
+            udp_slaves[src % len(udp_slaves)].send(ev["cmd"])
+
+
+def load_trace(path):
+    with open(path, encoding="utf-8") as f:
+        events = [json.loads(line) for line in f if line.strip()]
+    events.sort(key=lambda e: e["t"])
+    return events
+
+
+# ═══════════════════════════════════════════════════════
+# INFORME
+# ═══════════════════════════════════════════════════════
+def pct(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def report(udp_slaves, browsers, prof, sys_before, sys_after, seconds):
+    print()
+    print(f"══ Cliente ({seconds:.1f} s) ══")
+    if udp_slaves:
+        rtt = [x for s in udp_slaves for x in s.rtt_ms]
+        sent = sum(s.sent for s in udp_slaves)
+        print(f"UDP  {len(udp_slaves)} slaves  enviados={sent}  ok={sum(s.ok for s in udp_slaves)}"
+              f"  rate={sum(s.rate_limited for s in udp_slaves)}  err={sum(s.errors for s in udp_slaves)}"
+              f"  sin respuesta={sum(len(s.pending) for s in udp_slaves)}")
+        if rtt:
+            print(f"     RTT ms  p50={pct(rtt, 50):.1f}  p99={pct(rtt, 99):.1f}  max={max(rtt):.1f}"
+                  f"  media={statistics.mean(rtt):.1f}")
+    if browsers:
+        print(f"WS   {len(browsers)} navegadores  enviados={sum(b.sent for b in browsers)}"
+              f"  recibidos={sum(b.received for b in browsers)}"
+              f"  rx={sum(b.rx_bytes for b in browsers) / 1024:.0f} KB")
+
+    if prof:
+        print()
+        print(f"══ ESP32 /api/cmdprof (ventana {prof.get('windowMs', 0)} ms) ══")
+        print(f"heap mínimo={prof.get('minFreeHeap')}  bloque mayor mínimo={prof.get('minLargest')}")
+        hdr = f"{'ruta/comando':<26}{'n':>7}{'avg µs':>9}{'p50':>8}{'p99':>8}{'max':>8}{'heap+':>8}"
+        print(hdr)
+        print("─" * len(hdr))
+        rows = [(k, v) for k, v in prof.get("paths", {}).items()]
+        rows += [(c["cmd"], c) for c in sorted(prof.get("cmds", []), key=lambda c: -c["n"] * c["avgUs"])]
+        for name, st in rows:
+            if not st.get("n"):
+                continue
+            print(f"{name:<26}{st['n']:>7}{st['avgUs']:>9}{st['p50Us']:>8}{st['p99Us']:>8}"
+                  f"{st['maxUs']:>8}{st['heapMax']:>8}")
+
+    if sys_before and sys_after:
+        print()
+        print("══ Heap (sysinfo antes → después) ══")
+        for key in ("heapFree", "heapLargestBlock", "psramFree"):
+            if key in sys_before and key in sys_after:
+                print(f"{key:<18}{sys_before[key]:>10} → {sys_after[key]:>10}"
+                      f"  ({sys_after[key] - sys_before[key]:+d})")
+        for before, after in zip(sys_before.get("slab", []), sys_after.get("slab", [])):
+            print(f"slab {after['size']:>6} B  peak={after.get('peak')}  fallback "
+                  f"{before.get('fallback', 0)} → {after.get('fallback', 0)}")
+
+
+async def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default="192.168.4.1")
+    ap.add_argument("--udp", type=int, default=10, help="slaves UDP simulados")
+    ap.add_argument("--udp-rate", type=float, default=30.0, help="comandos/s por slave")
+    ap.add_argument("--ws", type=int, default=2, help="navegadores WebSocket simulados")
+    ap.add_argument("--ws-rate", type=float, default=20.0, help="comandos/s por navegador")
+    ap.add_argument("--seconds", type=float, default=20.0)
+    ap.add_argument("--trace", help="JSONL a reproducir en vez de la mezcla sintética")
+    ap.add_argument("--speed", type=float, default=1.0, help="factor de velocidad del replay")
+    ap.add_argument("--seed", type=int, default=808)
+    ap.add_argument("--no-prof", action="store_true", help="no activar /api/cmdprof")
+    ap.add_argument("--record", help="graba los comandos enviados como traza JSONL")
+    ap.add_argument("--write-trace", help="escribe la mezcla sintética como traza JSONL y sale (sin red)")
+    args = ap.parse_args()
+
+    rng = random.Random(args.seed)
+    if args.write_trace:
+        events = synthetic_trace(args, rng)
+        write_trace(args.write_trace, events)
+        print(f"[loadtest] {len(events)} comandos → {args.write_trace}")
+        return
+    loop = asyncio.get_running_loop()
+    trace = load_trace(args.trace) if args.trace else None
+    if trace:
+        args.udp = max(args.udp, 1 + max((int(e.get("src", 0)) for e in trace if e.get("via", "udp") == "udp"),
+                                         default=-1))
+
+    udp_slaves = []
+    for _ in range(args.udp):
+        _, proto = await loop.create_datagram_endpoint(UdpSlave, remote_addr=(args.host, UDP_PORT))
+        proto.send({"cmd": "hello", "device": "loadtest"})
+        udp_slaves.append(proto)
+
+    browsers = []
+    if args.ws > 0:
+        try:
+            for _ in range(args.ws):
+                b = WsBrowser()
+                await b.connect(args.host)
+                browsers.append(b)
+        except ImportError:
+            print("[loadtest] falta 'websockets' (pip install websockets): sólo UDP", file=sys.stderr)
+
+    await asyncio.sleep(1.0)  # hello / estado inicial fuera de la ventana
+    sys_before = http(args.host, "GET", "/api/sysinfo")
+    if not args.no_prof:
+        http(args.host, "POST", "/api/cmdprof?enable=1&reset=1")
+
+    t0 = time.perf_counter()
+    recorder = Recorder() if args.record else None
+    if trace:
+        await replay(trace, udp_slaves, browsers, args.speed)
+    else:
+        def sender(via, i, obj):
+            return recorder.wrap(via, i, obj.send) if recorder else obj.send
+        jobs = [synthetic(sender("udp", i, s), args.udp_rate, args.seconds, random.Random(rng.random()))
+                for i, s in enumerate(udp_slaves)]
+        jobs += [synthetic(sender("ws", i, b), args.ws_rate, args.seconds, random.Random(rng.random()))
+                 for i, b in enumerate(browsers)]
+        await asyncio.gather(*jobs)
+    if recorder:
+        write_trace(args.record, recorder.events)
+    await asyncio.sleep(0.5)  # últimas respuestas y flush de coalesce
+    elapsed = time.perf_counter() - t0
+
+    prof = None if args.no_prof else http(args.host, "GET", "/api/cmdprof", timeout=5.0)
+    if not args.no_prof:
+        http(args.host, "POST", "/api/cmdprof?enable=0")
+    sys_after = http(args.host, "GET", "/api/sysinfo")
+
+    for b in browsers:
+        await b.ws.close()
+    for s in udp_slaves:
+        s.transport.close()
+
+    report(udp_slaves, browsers, prof, sys_before, sys_after, elapsed)
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
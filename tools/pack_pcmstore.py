@@ -0,0 +1,271 @@
+#!/usr/bin/env python3
+"""
+RED808 empaquetador de la partición "pcmstore" (src/PcmStore.h).
+
+Convierte los WAV de data/ al formato que recibe la Daisy (int16 mono a
+44.1 kHz, mismo resultado bit a bit que PcmConvert en el firmware) y los
+escribe contiguos tras un índice ordenado por (carpeta, nombre). El firmware
+mapea la partición y carga esos samples sin abrir el WAV ni convertir nada.
+
+Sólo entran WAV a 44.1 kHz: los demás rates pasan por el resampler del
+firmware y siguen cargándose desde LittleFS. Se empaqueta por carpetas en el
+orden de --folders (primero el kit de arranque) hasta llenar la partición.
+Cada entrada guarda el tamaño y el CRC-32 del WAV de data/, los mismos que
+prepare_data_gz.py escribe en samples.idx. Si el LittleFS del equipo trae
+otro WAV (otro tamaño o CRC en samples.idx) el firmware ignora su entrada sin
+abrir el fichero: hay que volver a empaquetar después de cada buildfs.
+
+La partición sólo existe en el env redmaster-s3-r8n16-pcmstore
+(partitions_pcmstore.csv); ver flash_esp32.ps1 -PcmStore.
+
+Uso:
+  python tools/pack_pcmstore.py
+  python tools/pack_pcmstore.py --folders "RED 808 KARZ" BD SD --out pcmstore.bin
+  esptool.py --chip esp32s3 write_flash 0xC10000 .pio/build/redmaster-s3-r8n16-pcmstore/pcmstore.bin
+  (flash_esp32.ps1 -PcmStore lo flashea junto con LittleFS si existe)
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+from pathlib import Path
+
+# Mantener sincronizado con PcmStore.h / PcmStore.cpp
+_MAGIC = b"R8PC"
+_VERSION = 3
+_HEADER = struct.Struct("<4sHHIIIIII")          # 32 B
+_ENTRY = struct.Struct("<16s40sIIIII")          # 76 B
+_MAX_ENTRIES = 1024
+_RATE = 44100                                   # RS_TARGET_RATE
+_LABEL = "pcmstore"
+
+_FMT_PCM, _FMT_FLOAT, _FMT_EXT = 1, 3, 0xFFFE
+_SKIP_DIRS = {"web", "midi"}
+# Kit por defecto de main.cpp y familias en orden de pad; el resto después
+_DEFAULT_ORDER = ["RED 808 KARZ", "BD", "SD", "CH", "OH", "CY", "CP", "RS", "CB",
+                  "LT", "MT", "HT", "MA", "CL", "HC", "MC", "LC", "xtra"]
+
+
+# ── XXH32 (SampleHash.cpp) ──
+
+_P1, _P2, _P3, _P4, _P5 = 2654435761, 2246822519, 3266489917, 668265263, 374761393
+_M32 = 0xFFFFFFFF
+
+
+def _rotl(x, r):
+    return ((x << r) | (x >> (32 - r))) & _M32
+
+
+def xxh32(data: bytes, seed: int = 0) -> int:
+    n = len(data)
+    p = 0
+    if n >= 16:
+        v1 = (seed + _P1 + _P2) & _M32
+        v2 = (seed + _P2) & _M32
+        v3 = seed
+        v4 = (seed - _P1) & _M32
+        words = struct.unpack_from(f"<{(n // 16) * 4}I", data)
+        for i in range(0, len(words), 4):
+            v1 = (_rotl((v1 + words[i] * _P2) & _M32, 13) * _P1) & _M32
+            v2 = (_rotl((v2 + words[i + 1] * _P2) & _M32, 13) * _P1) & _M32
+            v3 = (_rotl((v3 + words[i + 2] * _P2) & _M32, 13) * _P1) & _M32
+            v4 = (_rotl((v4 + words[i + 3] * _P2) & _M32, 13) * _P1) & _M32
+        p = (n // 16) * 16
+        h = (_rotl(v1, 1) + _rotl(v2, 7) + _rotl(v3, 12) + _rotl(v4, 18)) & _M32
+    else:
+        h = (seed + _P5) & _M32
+    h = (h + n) & _M32
+    while p + 4 <= n:
+        h = (_rotl((h + struct.unpack_from("<I", data, p)[0] * _P3) & _M32, 17) * _P4) & _M32
+        p += 4
+    while p < n:
+        h = (_rotl((h + data[p] * _P5) & _M32, 11) * _P1) & _M32
+        p += 1
+    h ^= h >> 15
+    h = (h * _P2) & _M32
+    h ^= h >> 13
+    h = (h * _P3) & _M32
+    h ^= h >> 16
+    return h
+
+
+def sample_hash(pcm: bytes) -> int:
+    """sampleHash(): 0 queda reservado para "desconocido"."""
+    h = xxh32(pcm)
+    return h or 1
+
+
+# ── WAV → int16 mono (PcmConvert.cpp) ──
+
+def _mix2(l, r):
+    s = l + r
+    return -((-s) // 2) if s < 0 else s // 2     # división C: trunca hacia cero
+
+
+def _f32_to_s16(x):
+    if x != x:
+        return 0
+    if x >= 1.0:
+        return 32767
+    if x <= -1.0:
+        return -32767
+    # float32 como en el firmware: x * 32767.0f ± 0.5f, truncado
+    v = struct.unpack("<f", struct.pack("<f", x * 32767.0))[0]
+    v = struct.unpack("<f", struct.pack("<f", v + (-0.5 if x < 0.0 else 0.5)))[0]
+    return int(v)
+
+
+def wav_to_pcm(raw: bytes):
+    """(pcm bytes, motivo) — pcm None si el WAV no entra en la partición."""
+    if len(raw) < 12 or raw[:4] != b"RIFF" or raw[8:12] != b"WAVE":
+        return None, "no es WAV"
+    pos, fmt = 12, None
+    while pos + 8 <= len(raw):
+        cid, size = raw[pos:pos + 4], struct.unpack_from("<I", raw, pos + 4)[0]
+        body = pos + 8
+        if cid == b"fmt ":
+            if size < 16:
+                return None, "fmt corto"
+            afmt, channels, rate = struct.unpack_from("<HHI", raw, body)
+            bits = struct.unpack_from("<H", raw, body + 14)[0]
+            fmt = (afmt, channels, rate, bits)
+        elif cid == b"data":
+            break
+        pos = body + size + (size & 1)
+    else:
+        return None, "sin chunk data"
+    if not fmt:
+        return None, "sin chunk fmt"
+    afmt, channels, rate, bits = fmt
+    if rate != _RATE:
+        return None, f"{rate} Hz (lo convierte el firmware)"
+    if afmt not in (_FMT_PCM, _FMT_EXT, _FMT_FLOAT) or channels not in (1, 2):
+        return None, f"formato {afmt}/{channels} canales"
+    if afmt == _FMT_FLOAT and bits != 32:
+        return None, f"float de {bits} bits"
+    if afmt != _FMT_FLOAT and bits not in (8, 16, 24):
+        return None, f"PCM de {bits} bits"
+    frame = (bits // 8) * channels
+    frames = size // frame
+    data = raw[body:body + frames * frame]
+    if len(data) < frames * frame:
+        return None, "data truncado"
+    if frames == 0:
+        return None, "vacío"
+
+    if afmt == _FMT_FLOAT:
+        vals = [_f32_to_s16(v) for v in struct.unpack(f"<{frames * channels}f", data)]
+    elif bits == 16:
+        vals = list(struct.unpack(f"<{frames * channels}h", data))
+    elif bits == 24:
+        # >> 8 del valor de 24 bits = los dos bytes altos
+        vals = [struct.unpack_from("<h", data, i + 1)[0] for i in range(0, len(data), 3)]
+    else:
+        vals = [(b - 128) * 256 for b in data]
+    if channels == 2:
+        vals = [_mix2(vals[i], vals[i + 1]) for i in range(0, len(vals), 2)]
+    return struct.pack(f"<{len(vals)}h", *vals), None
+
+
+# ── Partición ──
+
+def _parse_int(s):
+    s = s.strip()
+    mult = 1
+    if s[-1:] in ("K", "k"):
+        s, mult = s[:-1], 1024
+    elif s[-1:] in ("M", "m"):
+        s, mult = s[:-1], 1024 * 1024
+    return int(s, 0) * mult
+
+
+def find_partition(csv_path: Path, label: str):
+    for line in csv_path.read_text(encoding="utf-8").splitlines():
+        line = line.split("#", 1)[0].strip()
+        if not line:
+            continue
+        cols = [c.strip() for c in line.split(",")]
+        if len(cols) >= 5 and cols[0] == label:
+            return _parse_int(cols[3]), _parse_int(cols[4])
+    return None
+
+
+def build_image(data_dir: Path, order, capacity: int, verbose: bool):
+    folders = [d for d in order if (data_dir / d).is_dir()]
+    folders += sorted(p.name for p in data_dir.iterdir()
+                      if p.is_dir() and p.name not in _SKIP_DIRS and p.name not in folders)
+
+    packed = []          # (folder b, name b, srcSize, srcCrc, pcm, hash)
+    used = 0
+    full = False
+    for folder in folders:
+        fb = folder.encode("utf-8")
+        for f in sorted((data_dir / folder).iterdir()):
+            if not f.is_file() or f.suffix.lower() != ".wav":
+                continue
+            nb = f.name.encode("utf-8")
+            if len(fb) >= 16 or len(nb) >= 40:
+                print(f"[pcmstore] {folder}/{f.name}: nombre demasiado largo, se omite")
+                continue
+            raw = f.read_bytes()
+            pcm, why = wav_to_pcm(raw)
+            if pcm is None:
+                if verbose:
+                    print(f"[pcmstore] {folder}/{f.name}: {why}, se omite")
+                continue
+            size = (len(pcm) + 3) & ~3
+            index = _HEADER.size + (len(packed) + 1) * _ENTRY.size
+            if len(packed) >= _MAX_ENTRIES or index + used + size > capacity:
+                full = True
+                break
+            crc = zlib.crc32(raw) or 1                # como srcCrc en samples.idx
+            packed.append((fb, nb, len(raw), crc, pcm, sample_hash(pcm)))
+            used += size
+        if full:
+            print(f"[pcmstore] partición llena en {folder}/: el resto se carga desde LittleFS")
+            break
+
+    # Índice ordenado como SampleIndex (bytes de carpeta y nombre) y PCM en el mismo orden
+    packed.sort(key=lambda e: (e[0], e[1]))
+    offset = (_HEADER.size + len(packed) * _ENTRY.size + 3) & ~3
+    entries, blobs = [], []
+    for fb, nb, src_size, crc, pcm, h in packed:
+        entries.append(_ENTRY.pack(fb, nb, src_size, crc, offset, len(pcm) // 2, h))
+        pad = (-len(pcm)) & 3
+        blobs.append(pcm + b"\0" * pad)
+        offset += len(pcm) + pad
+    index = b"".join(entries)
+    head_len = _HEADER.size + len(index)
+    gap = b"\0" * (((head_len + 3) & ~3) - head_len)
+    header = _HEADER.pack(_MAGIC, _VERSION, _ENTRY.size, len(packed), _RATE, offset,
+                          xxh32(index), 0, 0)
+    return header + index + gap + b"".join(blobs), packed
+
+
+def main():
+    root = Path(__file__).resolve().parent.parent
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--data", type=Path, default=root / "data", help="carpeta con la librería (la de buildfs)")
+    ap.add_argument("--partitions", type=Path, default=root / "partitions_pcmstore.csv")
+    ap.add_argument("--out", type=Path, default=root / ".pio" / "build" / "redmaster-s3-r8n16-pcmstore" / "pcmstore.bin")
+    ap.add_argument("--folders", nargs="+", default=_DEFAULT_ORDER, help="orden de empaquetado")
+    ap.add_argument("-v", "--verbose", action="store_true", help="listar los WAV que no entran")
+    args = ap.parse_args()
+
+    part = find_partition(args.partitions, _LABEL)
+    if not part:
+        sys.exit(f"[pcmstore] {args.partitions} no tiene partición '{_LABEL}'")
+    part_offset, part_size = part
+
+    image, packed = build_image(args.data, args.folders, part_size, args.verbose)
+    if not packed:
+        sys.exit("[pcmstore] ningún WAV a 44.1 kHz que empaquetar")
+    args.out.parent.mkdir(parents=True, exist_ok=True)
+    args.out.write_bytes(image)
+    print(f"[pcmstore] {len(packed)} samples, {len(image) // 1024}/{part_size // 1024} KB → {args.out}")
+    print(f"[pcmstore] flashear: esptool.py --chip esp32s3 write_flash 0x{part_offset:X} {args.out}")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,6 +1,9 @@
 from pathlib import Path
 from shutil import copy2, copytree, rmtree
 import gzip
+import hashlib
+import struct
+import zlib
 from SCons.Script import COMMAND_LINE_TARGETS
 
 Import("env")
@@ -11,6 +14,96 @@ def _is_uploadfs_target() -> bool:
     return "uploadfs" in targets or "buildfs" in targets
 
 
+# ── Índice binario de samples (/samples.idx) ──
+# Mantener sincronizado con SampleIndex.h: cabecera 16 B + registros de 84 B
+# ordenados por (carpeta, nombre) en bytes, igual que strcmp en el firmware.
+# srcCrc (CRC-32 del fichero) es lo que compara PcmStore con pack_pcmstore.py.
+_IDX_MAGIC = b"S8IX"
+_IDX_VERSION = 2
+_IDX_RECORD = struct.Struct("<16s40sIIIHBBBB3s3xI")
+_IDX_SKIP_DIRS = {"web", "midi"}
+_FMT_WAV, _FMT_RAW = 1, 2
+_RAW_RATE = 48000  # SAMPLE_RATE en SPIMaster.h
+
+
+def _wav_info(raw: bytes):
+    """(rate, channels, bits, frames, peak) o None si el WAV no se puede leer."""
+    if len(raw) < 12 or raw[:4] != b"RIFF" or raw[8:12] != b"WAVE":
+        return None
+    pos, fmt = 12, None
+    while pos + 8 <= len(raw):
+        cid, size = raw[pos:pos + 4], struct.unpack_from("<I", raw, pos + 4)[0]
+        body = pos + 8
+        if cid == b"fmt " and size >= 16:
+            _, channels, rate = struct.unpack_from("<HHI", raw, body)
+            bits = struct.unpack_from("<H", raw, body + 14)[0]
+            fmt = (rate, channels, bits)
+        elif cid == b"data" and fmt:
+            rate, channels, bits = fmt
+            data = raw[body:body + size]
+            frame = (bits // 8) * channels
+            if frame == 0:
+                return None
+            frames = len(data) // frame
+            return (rate, channels, bits, frames, _pcm_peak(data, bits))
+        pos = body + size + (size & 1)
+    return None
+
+
+def _pcm_peak(data: bytes, bits: int) -> int:
+    """|pico| en escala 16-bit sobre todos los canales (0xFFFF = sin medir)."""
+    peak = 0
+    if bits == 16:
+        n = len(data) // 2
+        for v in struct.unpack_from(f"<{n}h", data):
+            peak = max(peak, abs(v))
+    elif bits == 24:
+        for i in range(0, len(data) - 2, 3):
+            v = int.from_bytes(data[i:i + 3], "little", signed=True) >> 8
+            peak = max(peak, abs(v))
+    else:
+        return 0xFFFF
+    return min(peak, 32767)
+
+
+def _knobs_from_name(folder: str, name: str):
+    """BD2550.WAV → [25, 50]: prefijo de familia + pares de dígitos (máx. 3)."""
+    stem = name.rsplit(".", 1)[0]
+    if not stem.upper().startswith(folder.upper()):
+        return []
+    digits = stem[len(folder):]
+    if not digits or not digits.isdigit() or len(digits) % 2 or len(digits) > 6:
+        return []
+    return [int(digits[i:i + 2]) for i in range(0, len(digits), 2)]
+
+
+def _write_sample_index(root: Path) -> None:
+    records = []
+    for folder in sorted(p for p in root.iterdir() if p.is_dir() and p.name not in _IDX_SKIP_DIRS):
+        fb = folder.name.encode("utf-8")
+        for f in sorted(folder.iterdir()):
+            if not f.is_file() or f.suffix.lower() not in {".wav", ".raw"}:
+                continue
+            nb = f.name.encode("utf-8")
+            if len(fb) >= 16 or len(nb) >= 40:
+                print(f"[prepare_data_gz] warning: {folder.name}/{f.name} no cabe en samples.idx, se omite")
+                continue
+            raw = f.read_bytes()
+            if f.suffix.lower() == ".raw":
+                fmt, info = _FMT_RAW, (_RAW_RATE, 1, 16, len(raw) // 2, _pcm_peak(raw, 16))
+            else:
+                fmt, info = _FMT_WAV, _wav_info(raw) or (0, 0, 0, 0, 0xFFFF)
+            rate, channels, bits, frames, peak = info
+            knobs = _knobs_from_name(folder.name, f.name)
+            records.append((fb, nb, _IDX_RECORD.pack(
+                fb, nb, len(raw), frames, rate, peak, channels, bits, fmt,
+                len(knobs), bytes(knobs + [0] * (3 - len(knobs))), zlib.crc32(raw) or 1)))
+    records.sort(key=lambda r: (r[0], r[1]))
+    header = _IDX_MAGIC + struct.pack("<HHII", _IDX_VERSION, _IDX_RECORD.size, len(records), 0)
+    (root / "samples.idx").write_bytes(header + b"".join(r[2] for r in records))
+    print(f"[prepare_data_gz] samples.idx: {len(records)} samples")
+
+
 def _sync_data_to_data_gz(project_dir: Path) -> None:
     src = project_dir / "data"
     dst = project_dir / "data_gz"
@@ -23,17 +116,25 @@ def _sync_data_to_data_gz(project_dir: Path) -> None:
         rmtree(dst)
 
     copytree(src, dst)
+    _write_sample_index(dst)
 
     web_dir = dst / "web"
     if web_dir.exists():
         gz_created = 0
-        for p in web_dir.rglob("*"):
-            if p.is_file() and p.suffix in {".js", ".css", ".html"}:
+        etags = []
+        for p in sorted(web_dir.rglob("*")):
+            if not p.is_file() or p.suffix == ".gz":
+                continue
+            with p.open("rb") as fin:
+                raw = fin.read()
+            # ETag fuerte del fuente sin comprimir (WebAssetCache lo sirve tal cual)
+            etags.append(f"{p.name} {hashlib.sha1(raw).hexdigest()[:16]}")
+            if p.suffix in {".js", ".css", ".html"}:
                 gz_path = Path(str(p) + ".gz")
-                with p.open("rb") as fin:
-                    raw = fin.read()
-                with gzip.open(gz_path, "wb", compresslevel=9) as fout:
-                    fout.write(raw)
+                # mtime=0: mismo fuente → mismo .gz byte a byte
+                with gz_path.open("wb") as fraw:
+                    with gzip.GzipFile(fileobj=fraw, mode="wb", compresslevel=9, mtime=0) as fout:
+                        fout.write(raw)
                 gz_created += 1
 
         removed = 0
@@ -41,6 +142,7 @@ def _sync_data_to_data_gz(project_dir: Path) -> None:
             if p.is_file() and p.suffix in {".js", ".css", ".html"} and not p.name.endswith(".gz"):
                 p.unlink()
                 removed += 1
+        (web_dir / "etags.txt").write_text("\n".join(etags) + "\n", encoding="ascii")
         print(f"[prepare_data_gz] data_gz listo. Generados {gz_created} .gz, eliminados {removed} assets web sin comprimir")
     else:
         print("[prepare_data_gz] warning: no se encontró data/web en staging")
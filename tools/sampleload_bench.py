@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""
+RED808 banco de carga de samples contra el master real.
+
+Manda "loadSample" por UDP para cada fichero y lee el tiempo que midió el
+ESP32 (lectura LittleFS + conversión a int16 mono, sin el SPI) del bloque
+"sampleLoad" de /api/sysinfo. Sirve para comparar formatos (16/24-bit,
+mono/estéreo, float) y versiones del firmware. Desde la caché de PCM
+(SampleCache) la segunda carga del mismo fichero es una copia en PSRAM: la
+columna "caché" cuenta esas cargas; --budget-kb 0 la desactiva para medir
+siempre lectura + conversión. Los WAV empaquetados en la partición pcmstore
+(tools/pack_pcmstore.py) no leen nada: la columna "flash" cuenta esas cargas.
+
+Uso:
+  python tools/sampleload_bench.py --host 192.168.4.1 --family BD BD0000.wav BD2525.wav
+  python tools/sampleload_bench.py --family SD --repeat 5 --pad 1 SD0010.wav
+"""
+
+import argparse
+import json
+import socket
+import statistics
+import sys
+import time
+import urllib.request
+
+UDP_PORT = 8888  # UDP_PORT en WebInterface.h
+
+
+def sysinfo(host, timeout=3.0):
+    with urllib.request.urlopen(f"http://{host}/api/sysinfo", timeout=timeout) as resp:
+        return json.loads(resp.read().decode("utf-8") or "{}")
+
+
+def load_once(sock, host, family, filename, pad, timeout):
+    before = sysinfo(host).get("sampleLoad", {}).get("n", 0)
+    cmd = {"cmd": "loadSample", "family": family, "filename": filename, "pad": pad}
+    sock.sendto(json.dumps(cmd).encode(), (host, UDP_PORT))
+    try:
+        sock.recvfrom(512)  # {"s":"ok"}
+    except socket.timeout:
+        pass
+    # loadSample es síncrono en systemTask: el contador sube al terminar
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        sl = sysinfo(host).get("sampleLoad", {})
+        if sl.get("n", 0) > before:
+            return sl
+        time.sleep(0.1)
+    return None
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default="192.168.4.1")
+    ap.add_argument("--family", required=True, help="carpeta de la familia (BD, SD, ...)")
+    ap.add_argument("--pad", type=int, default=0)
+    ap.add_argument("--repeat", type=int, default=3)
+    ap.add_argument("--timeout", type=float, default=10.0, help="espera máxima por carga (s)")
+    ap.add_argument("--budget-kb", type=int, default=None, help="fija el presupuesto de SampleCache antes de medir")
+    ap.add_argument("files", nargs="+")
+    args = ap.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(2.0)
+    if args.budget_kb is not None:
+        sock.sendto(json.dumps({"cmd": "setSampleCache", "budgetKb": args.budget_kb}).encode(), (args.host, UDP_PORT))
+        try:
+            sock.recvfrom(512)
+        except socket.timeout:
+            pass
+
+    print(f"{'fichero':<24} {'KB':>7} {'med ms':>8} {'máx ms':>8} {'MB/s':>6} {'caché':>6} {'flash':>6}")
+    for name in args.files:
+        times = []
+        size = 0
+        hits = 0
+        stored = 0
+        for _ in range(args.repeat):
+            sl = load_once(sock, args.host, args.family, name, args.pad, args.timeout)
+            if sl is None:
+                print(f"[bench] {name}: sin respuesta (¿no existe o formato no soportado?)", file=sys.stderr)
+                break
+            times.append(sl["lastUs"] / 1000.0)
+            size = sl["lastBytes"]
+            hits += 1 if sl.get("cached") else 0
+            stored += 1 if sl.get("stored") else 0
+        if not times:
+            continue
+        med = statistics.median(times)
+        rate = (size / 1e6) / (med / 1000.0) if med > 0 else 0.0
+        print(f"{name:<24} {size / 1024:>7.0f} {med:>8.1f} {max(times):>8.1f} {rate:>6.2f} {hits:>6} {stored:>6}")
+
+    info = sysinfo(args.host)
+    sl = info.get("sampleLoad", {})
+    sc = info.get("sampleCache", {})
+    ps = info.get("pcmStore", {})
+    print(f"\nacumulado ESP32: {sl.get('n', 0)} cargas ({sl.get('cacheHits', 0)} de caché), "
+          f"{sl.get('kbps', 0)} KB/s, peor {sl.get('maxUs', 0) / 1000:.1f} ms")
+    print(f"SampleCache: {sc.get('entries', 0)} entradas, {sc.get('bytes', 0) // 1024}/{sc.get('budget', 0) // 1024} KB, "
+          f"prefetch {sc.get('prefetched', 0)}")
+    if ps.get("ready"):
+        print(f"pcmstore: {ps.get('entries', 0)} samples, {ps.get('usedKb', 0)}/{ps.get('sizeKb', 0)} KB, "
+              f"{sl.get('storeHits', 0)} cargas, {ps.get('stale', 0)} caducadas")
+
+
+if __name__ == "__main__":
+    main()